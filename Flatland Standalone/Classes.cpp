@@ -15,6 +15,7 @@
 #include "Parser.h"
 #include "Platform.h"
 #include "Plugin.h"
+#include "Portable.h"
 #include "Spans.h"
 #include "SimKin.h"
 #include "Utils.h"
@@ -1224,6 +1225,7 @@ spolygon::create_spoint_list(int set_spoints)
 
 span::span()
 {
+	cache_entry_ptr = NULL;
 	next_span_ptr = NULL;
 }
 
@@ -1312,12 +1314,62 @@ span_row::span_row()
 {
 	opaque_span_list = NULL;
 	transparent_span_list = NULL;
+	run_list = NULL;
+	runs = 0;
+	max_runs = 0;
+	covered_pixels = 0;
 }
 
-// Default destructor does nothing.
+// Default destructor deletes the coverage run list.
 
 span_row::~span_row()
 {
+	if (run_list != NULL)
+		DELARRAY(run_list, coverage_run, max_runs);
+}
+
+// Method to make room for a new coverage run at the given position in the
+// coverage run list, growing the list if it's full.  A pointer to the new
+// coverage run is returned, or NULL if we are out of memory.
+
+coverage_run *
+span_row::insert_run(int run_no)
+{
+	coverage_run *new_run_list;
+	int new_max_runs;
+
+	// If the coverage run list is full, double its size.
+
+	if (runs == max_runs) {
+		new_max_runs = max_runs > 0 ? max_runs * 2 : 16;
+		NEWARRAY(new_run_list, coverage_run, new_max_runs);
+		if (new_run_list == NULL)
+			return(NULL);
+		if (run_list != NULL) {
+			memcpy(new_run_list, run_list, runs * sizeof(coverage_run));
+			DELARRAY(run_list, coverage_run, max_runs);
+		}
+		run_list = new_run_list;
+		max_runs = new_max_runs;
+	}
+
+	// Move the coverage runs at or after the given position up one place.
+
+	memmove(&run_list[run_no + 1], &run_list[run_no], 
+		(runs - run_no) * sizeof(coverage_run));
+	runs++;
+	return(&run_list[run_no]);
+}
+
+// Method to remove the coverage run at the given position in the coverage run
+// list.
+
+void
+span_row::remove_run(int run_no)
+{
+	runs--;
+	memmove(&run_list[run_no], &run_list[run_no + 1],
+		(runs - run_no) * sizeof(coverage_run));
 }
 
 //------------------------------------------------------------------------------
@@ -1330,6 +1382,7 @@ span_buffer::span_buffer()
 {
 	rows = 0;
 	buffer_ptr = NULL;
+	covered_rows = 0;
 }
 
 // Default destructor deletes the span buffer.
@@ -1352,7 +1405,8 @@ span_buffer::create_buffer(int set_rows)
 	return(true);
 }
 
-// Method to clear the span buffer.
+// Method to clear the span buffer.  The spans themselves are reclaimed in one
+// step when the frame arena is reset at the start of the frame.
 
 void 
 span_buffer::clear_buffer()
@@ -1361,7 +1415,10 @@ span_buffer::clear_buffer()
 		span_row *span_row_ptr = &buffer_ptr[row];
 		span_row_ptr->opaque_span_list = NULL;
 		span_row_ptr->transparent_span_list = NULL;
+		span_row_ptr->runs = 0;
+		span_row_ptr->covered_pixels = 0;
 	}
+	covered_rows = 0;
 }
 
 // Method to return the pointer to a span buffer row.
@@ -1387,7 +1444,9 @@ cache_entry::cache_entry()
 	pixmap_ptr = NULL;
 	frame_no = -1;
 	lit_image_ptr = NULL;
+	lit_image_levels = 0;
 	hardware_texture_ptr = NULL;
+	prev_cache_entry_ptr = NULL;
 	next_cache_entry_ptr = NULL;
 }
 
@@ -1438,20 +1497,28 @@ cache_entry::create_image_buffer(int image_size_index)
 // Texture cache.
 //------------------------------------------------------------------------------
 
-// Default constructor initialises the cache entry list.
+// Default constructor initialises the cache entry lists.
 
 cache::cache()
 {
 	image_size_index = 0;
+	cache_entry_size = 0;
 	cache_entry_list = NULL;
+	last_cache_entry_ptr = NULL;
+	free_cache_entry_list = NULL;
 }
 
-// Constructor to initialis the cache entry list and set a image size index.
+// Constructor to initialise the cache entry lists and set a image size index.
+// The cache entry size is set by create_image_caches(), and again when each
+// cache entry is created.
 
 cache::cache(int size_index)
 {
 	image_size_index = size_index;
+	cache_entry_size = 0;
 	cache_entry_list = NULL;
+	last_cache_entry_ptr = NULL;
+	free_cache_entry_list = NULL;
 }
 
 // Default destructor deletes the cache entries.
@@ -1466,10 +1533,13 @@ cache::~cache()
 		cache_entry_ptr = next_cache_entry_ptr;
 	}
 	cache_entry_list = NULL;
-
+	last_cache_entry_ptr = NULL;
+	while (free_cache_entry_list != NULL)
+		delete_free_cache_entry();
 }
 
-// Method to add a new cache entry to the list, and to return a pointer to it.
+// Method to add a new cache entry to the head of the list, and to return a
+// pointer to it.
 
 cache_entry *
 cache::add_cache_entry(void)
@@ -1489,13 +1559,108 @@ cache::add_cache_entry(void)
 		return(NULL);
 	}
 
+	// Remember the size of a cache entry.  Hardware textures are always 32
+	// bits per texel.
+
+	if (hardware_acceleration) {
+		int image_dimensions = image_dimensions_list[image_size_index];
+		cache_entry_size = image_dimensions * image_dimensions * 4;
+	} else
+		cache_entry_size = cache_entry_ptr->lit_image_size;
+
 	// Add the cache entry to the head of the list.
 
+	link_cache_entry(cache_entry_ptr);
+	return(cache_entry_ptr);
+}
+
+// Method to link a cache entry to the head of the list, making it the most
+// recently used.
+
+void
+cache::link_cache_entry(cache_entry *cache_entry_ptr)
+{
+	cache_entry_ptr->prev_cache_entry_ptr = NULL;
 	cache_entry_ptr->next_cache_entry_ptr = cache_entry_list;
+	if (cache_entry_list != NULL)
+		cache_entry_list->prev_cache_entry_ptr = cache_entry_ptr;
+	else
+		last_cache_entry_ptr = cache_entry_ptr;
 	cache_entry_list = cache_entry_ptr;
+}
+
+// Method to unlink a cache entry from the list.
+
+void
+cache::unlink_cache_entry(cache_entry *cache_entry_ptr)
+{
+	if (cache_entry_ptr->prev_cache_entry_ptr != NULL)
+		cache_entry_ptr->prev_cache_entry_ptr->next_cache_entry_ptr = 
+			cache_entry_ptr->next_cache_entry_ptr;
+	else
+		cache_entry_list = cache_entry_ptr->next_cache_entry_ptr;
+	if (cache_entry_ptr->next_cache_entry_ptr != NULL)
+		cache_entry_ptr->next_cache_entry_ptr->prev_cache_entry_ptr =
+			cache_entry_ptr->prev_cache_entry_ptr;
+	else
+		last_cache_entry_ptr = cache_entry_ptr->prev_cache_entry_ptr;
+	cache_entry_ptr->prev_cache_entry_ptr = NULL;
+	cache_entry_ptr->next_cache_entry_ptr = NULL;
+}
+
+// Method to move a cache entry to the head of the list, making it the most
+// recently used.
+
+void
+cache::touch_cache_entry(cache_entry *cache_entry_ptr)
+{
+	if (cache_entry_ptr != cache_entry_list) {
+		unlink_cache_entry(cache_entry_ptr);
+		link_cache_entry(cache_entry_ptr);
+	}
+}
+
+// Method to remove a cache entry from the list and add it to the free list,
+// after removing it's reference from the pixmap that has been using it.
+
+void
+cache::free_cache_entry(cache_entry *cache_entry_ptr)
+{
+	if (cache_entry_ptr->pixmap_ptr != NULL) {
+		cache_entry_ptr->pixmap_ptr->cache_entry_list[
+			cache_entry_ptr->brightness_index] = NULL;
+		cache_entry_ptr->pixmap_ptr = NULL;
+	}
+	unlink_cache_entry(cache_entry_ptr);
+	cache_entry_ptr->next_cache_entry_ptr = free_cache_entry_list;
+	free_cache_entry_list = cache_entry_ptr;
+}
+
+// Method to remove the first cache entry from the free list, add it to the
+// head of the list, and return a pointer to it.  NULL is returned if the free
+// list is empty.
+
+cache_entry *
+cache::get_free_cache_entry(void)
+{
+	cache_entry *cache_entry_ptr = free_cache_entry_list;
+	if (cache_entry_ptr != NULL) {
+		free_cache_entry_list = cache_entry_ptr->next_cache_entry_ptr;
+		link_cache_entry(cache_entry_ptr);
+	}
 	return(cache_entry_ptr);
 }
 
+// Method to delete the first cache entry in the free list.
+
+void
+cache::delete_free_cache_entry(void)
+{
+	cache_entry *cache_entry_ptr = free_cache_entry_list;
+	free_cache_entry_list = cache_entry_ptr->next_cache_entry_ptr;
+	DEL(cache_entry_ptr, cache_entry);
+}
+
 //==============================================================================
 // Texture map classes.
 //==============================================================================
@@ -1528,22 +1693,15 @@ pixmap::~pixmap()
 {
 	if (image_ptr != NULL)
 		DELBASEARRAY(image_ptr, imagebyte, image_size);
-	for (int index = 0; index < BRIGHTNESS_LEVELS; index++) {
-		cache_entry *cache_entry_ptr = cache_entry_list[index];
-		if (cache_entry_ptr != NULL)
-			cache_entry_ptr->pixmap_ptr = NULL;
-	}
+	release_cache_entries(this);
 }
 
+// Method to release the cache entries, so that they can be reused.
+
 void 
 pixmap::clear_cache_entries()
 {
-	for (int index = 0; index < BRIGHTNESS_LEVELS; index++) {
-		cache_entry *cache_entry_ptr = cache_entry_list[index];
-		if (cache_entry_ptr != NULL)
-			cache_entry_ptr->pixmap_ptr = NULL;
-		cache_entry_list[index] = NULL;
-	}
+	release_cache_entries(this);
 }
 
 //------------------------------------------------------------------------------
@@ -1823,6 +1981,7 @@ light::light()
 	set_radius(1.0f);
 	set_cone_angle(45.0f);
 	flood = false;
+	stamp = ++lighting_stamp;
 	next_light_ptr = NULL;
 }
 
@@ -1843,6 +2002,7 @@ light::set_direction(direction light_direction)
 	dir.set(0.0, 0.0, 1.0);
 	dir.rotate_x(-curr_dir.angle_x);
 	dir.rotate_y(curr_dir.angle_y);
+	stamp = ++lighting_stamp;
 }
 
 // Method to set the light direction range.
@@ -1924,6 +2084,7 @@ light::set_intensity(float light_intensity)
 	lit_colour.red = colour.red * intensity;
 	lit_colour.green = colour.green * intensity;
 	lit_colour.blue = colour.blue * intensity;
+	stamp = ++lighting_stamp;
 }
 
 // Method to set the light intensity range.
@@ -1953,6 +2114,7 @@ light::set_radius(float light_radius)
 {
 	radius = light_radius;
 	one_on_radius = 1.0f / radius;
+	stamp = ++lighting_stamp;
 }
 
 // Method to set the cone angle, and compute associated values.
@@ -1963,6 +2125,7 @@ light::set_cone_angle(float light_cone_angle)
 	cone_angle = light_cone_angle;
 	cos_cone_angle = cosf(RAD(light_cone_angle));
 	cone_angle_M = 1.0f / (1.0f - cos_cone_angle);
+	stamp = ++lighting_stamp;
 }
 
 //------------------------------------------------------------------------------
@@ -2775,6 +2938,10 @@ block_def::block_def()
 	last_trigger_ptr = NULL;
 	free_block_list = NULL;
 	used_block_list = NULL;
+	shared_vertex_list = NULL;
+	shared_polygon_list = NULL;
+	shared_col_mesh_ptr = NULL;
+	shared_col_mesh_size = 0;
 	root_polygon_ref = 0;
 	BSP_tree = NULL;
 	block_orientation.set(0.0f, 0.0f, 0.0f);
@@ -2833,6 +3000,16 @@ block_def::~block_def()
 	if (polygon_def_list != NULL)
 		DELARRAY(polygon_def_list, polygon_def, polygons);
 
+	// Delete the geometry shared by blocks.
+
+	if (shared_vertex_list != NULL)
+		DELARRAY(shared_vertex_list, vertex, vertices);
+	if (shared_polygon_list != NULL)
+		DELARRAY(shared_polygon_list, polygon, polygons);
+	if (shared_col_mesh_ptr != NULL)
+		DELBASEARRAY((colmeshbyte *)shared_col_mesh_ptr, colmeshbyte,
+			shared_col_mesh_size);
+
 	// Delete the list of lights.
 
 	while (light_list != NULL) {
@@ -3149,27 +3326,37 @@ block_def::new_block(square *square_ptr)
 			return(NULL);
 		block_ptr->block_def_ptr = this;
 
-		// Create the vertex list, polygon list and active light list for this
-		// block.
+		// If this block can share the geometry of the block definition, it
+		// only needs a polygon active list and active light list.
 
-		if (!block_ptr->create_vertex_list(vertices) ||
-			!block_ptr->create_polygon_list(polygons) ||
-			!block_ptr->create_active_light_list()) {
-			DEL(block_ptr, block);
-			return(NULL);
+		if (shares_geometry()) {
+			if (!block_ptr->create_polygon_active_list(polygons) ||
+				!block_ptr->create_active_light_list()) {
+				DEL(block_ptr, block);
+				return(NULL);
+			}
 		}
 
-		// Create the collision mesh structure for this block.
+		// Otherwise create the vertex list, polygon list, active light list
+		// and collision mesh structure for this block.
 
-		if (type == STRUCTURAL_BLOCK) {
-			if (!COL_createBlockColMesh(block_ptr)) {
+		else {
+			if (!block_ptr->create_vertex_list(vertices) ||
+				!block_ptr->create_polygon_list(polygons) ||
+				!block_ptr->create_active_light_list()) {
 				DEL(block_ptr, block);
 				return(NULL);
 			}
-		} else {
-			if (!COL_createSpriteColMesh(block_ptr)) {
-				DEL(block_ptr, block);
-				return(NULL);
+			if (type == STRUCTURAL_BLOCK) {
+				if (!COL_createBlockColMesh(block_ptr)) {
+					DEL(block_ptr, block);
+					return(NULL);
+				}
+			} else {
+				if (!COL_createSpriteColMesh(block_ptr)) {
+					DEL(block_ptr, block);
+					return(NULL);
+				}
 			}
 		}
 
@@ -3273,12 +3460,19 @@ block_def::new_block(square *square_ptr)
 	block_ptr->set_active_lights = true;
 	block_ptr->current_frame = -1;
 
-	// Initialise the polygon list.
+	// Make all polygons active.  If the block can share the geometry of the
+	// block definition, use it, otherwise initialise the block's own polygon
+	// list.
 
-	for (index = 0; index < polygons; index++) {
-		polygon *polygon_ptr = &block_ptr->polygon_list[index];
-		polygon_ptr->polygon_def_ptr = &polygon_def_list[index];
-		polygon_ptr->active = true;
+	for (index = 0; index < polygons; index++)
+		block_ptr->polygon_active_list[index] = true;
+	if (shares_geometry()) {
+		if (!block_ptr->share_geometry())
+			return(NULL);
+	} else {
+		for (index = 0; index < polygons; index++)
+			block_ptr->polygon_list[index].polygon_def_ptr = 
+				&polygon_def_list[index];
 	}
 
 	// Initialise the light list for this block.  Note that we must not
@@ -3356,6 +3550,65 @@ block_def::new_block(square *square_ptr)
 	return(block_ptr);
 }
 
+// Method to determine whether blocks of this definition can share its geometry
+// until they are changed.  Sprites need their own geometry, and animated blocks
+// already share the frame vertex lists.
+
+bool
+block_def::shares_geometry(void)
+{
+	return(type == STRUCTURAL_BLOCK && !animated);
+}
+
+// Method to create the oriented vertex list, polygon list and collision mesh
+// shared by blocks of this definition, if they don't already exist.  FALSE is
+// returned if the geometry can't be shared or we ran out of memory.
+
+bool
+block_def::create_shared_geometry(void)
+{
+	block *block_ptr;
+	int index;
+
+	if (!shares_geometry())
+		return(false);
+	if (shared_col_mesh_ptr != NULL)
+		return(true);
+
+	// Create a block with geometry of its own, and transform it into its
+	// final orientation.
+
+	NEW(block_ptr, block);
+	if (block_ptr == NULL)
+		return(false);
+	block_ptr->block_def_ptr = this;
+	block_ptr->square_ptr = NULL;
+	if (!block_ptr->create_vertex_list(vertices) ||
+		!block_ptr->create_polygon_list(polygons) ||
+		!COL_createBlockColMesh(block_ptr)) {
+		DEL(block_ptr, block);
+		return(false);
+	}
+	block_ptr->block_orientation = block_orientation;
+	block_ptr->block_origin = block_origin;
+	for (index = 0; index < polygons; index++)
+		block_ptr->polygon_list[index].polygon_def_ptr = &polygon_def_list[index];
+	block_ptr->reset_vertices();
+	block_ptr->orient();
+
+	// Take the block's geometry as the shared geometry, then delete the block.
+
+	shared_vertex_list = block_ptr->vertex_list;
+	shared_polygon_list = block_ptr->polygon_list;
+	shared_col_mesh_ptr = block_ptr->col_mesh_ptr;
+	shared_col_mesh_size = block_ptr->col_mesh_size;
+	block_ptr->vertex_list = NULL;
+	block_ptr->polygon_list = NULL;
+	block_ptr->col_mesh_ptr = NULL;
+	DEL(block_ptr, block);
+	return(true);
+}
+
 // Method to create a simplified version of a block, just enough to render its polygons.
 
 block *
@@ -3393,7 +3646,7 @@ block_def::create_simplified_block()
 	for (int index = 0; index < polygons; index++) {
 		polygon *polygon_ptr = &block_ptr->polygon_list[index];
 		polygon_ptr->polygon_def_ptr = &polygon_def_list[index];
-		polygon_ptr->active = true;
+		block_ptr->polygon_active_list[index] = true;
 	}
 
 	// If the block is a structural block, transform it into it's final
@@ -3906,6 +4159,8 @@ block::block()
 	next_repeat = false;
 	polygons = 0;
 	polygon_list = NULL;
+	polygon_active_list = NULL;
+	shared_geometry = false;
 	pixmap_index = 0;
 	requires_col_mesh = true;
 	col_mesh_ptr = NULL;
@@ -3915,12 +4170,19 @@ block::block()
 	light_list = NULL;
 	active_light_list = NULL;
 	set_active_lights = false;
+	lit_polygon_list = NULL;
+	lit_colour_list = NULL;
+	lit_colours = 0;
+	lit_stamp = 0;
 	sound_list = NULL;
 	popup_list = NULL;
 	trigger_list = NULL;
 	entrance_ptr = NULL;
 	exit_ptr = NULL;
 	next_block_ptr = NULL;
+	in_movable_grid = false;
+	movable_cell = -1;
+	next_cell_block_ptr = NULL;
 }
 
 // Default destructor deletes all data.
@@ -3932,25 +4194,34 @@ block::~block()
 	popup *next_popup_ptr;
 	trigger *next_trigger_ptr;
 
-	// Delete the vertex list.
+	// Delete the vertex list, polygon list and collision mesh, unless they
+	// are shared with the block definition.
 
-	if (current_frame == -1 && vertex_list != NULL)
-		DELARRAY(vertex_list, vertex, vertices);
+	if (!shared_geometry) {
+		if (current_frame == -1 && vertex_list != NULL)
+			DELARRAY(vertex_list, vertex, vertices);
+		if (polygon_list != NULL)
+			DELARRAY(polygon_list, polygon, polygons);
+		if (col_mesh_ptr != NULL)
+			DELBASEARRAY((colmeshbyte *)col_mesh_ptr, colmeshbyte, col_mesh_size);
+	}
 
-	// Delete the polygon list.
+	// Delete the polygon active list.
 
-	if (polygon_list != NULL)
-		DELARRAY(polygon_list, polygon, polygons);
+	if (polygon_active_list != NULL)
+		DELARRAY(polygon_active_list, bool, polygons);
 
 	// Delete the active light list.
 
 	if (active_light_list != NULL)
 		DELARRAY(active_light_list, light_ref, max_active_lights);
 
-	// Delete the collision mesh.
+	// Delete the lit polygon list and lit colour list.
 
-	if (col_mesh_ptr != NULL)
-		DELBASEARRAY((colmeshbyte *)col_mesh_ptr, colmeshbyte, col_mesh_size);
+	if (lit_polygon_list != NULL)
+		DELARRAY(lit_polygon_list, lit_polygon, polygons);
+	if (lit_colour_list != NULL)
+		DELARRAY(lit_colour_list, RGBcolour, lit_colours);
 
 	// Destroy the block and vertex SimKin objects, if they exist.
 
@@ -4022,7 +4293,7 @@ block::create_vertex_list(int set_vertices)
 	return(true);
 }
 
-// Method to create the polygon list.
+// Method to create the polygon list and polygon active list.
 
 bool
 block::create_polygon_list(int set_polygons)
@@ -4033,6 +4304,20 @@ block::create_polygon_list(int set_polygons)
 		if (polygon_list == NULL)
 			return(false);
 	}
+	return(create_polygon_active_list(set_polygons));
+}
+
+// Method to create the polygon active list.
+
+bool
+block::create_polygon_active_list(int set_polygons)
+{
+	polygons = set_polygons;
+	if (polygons > 0) {
+		NEWARRAY(polygon_active_list, bool, polygons);
+		if (polygon_active_list == NULL)
+			return(false);
+	}
 	return(true);
 }
 
@@ -4049,11 +4334,138 @@ block::create_active_light_list(void)
 	return(true);
 }
 
+// Method to create the lit polygon list, and the lit colour list with room for
+// every vertex of every polygon.  The cached lighting starts out invalid.
+
+bool
+block::create_lit_polygon_list(void)
+{
+	int index;
+
+	lit_colours = 0;
+	for (index = 0; index < polygons; index++)
+		lit_colours += polygon_list[index].polygon_def_ptr->vertices;
+	if (polygons > 0) {
+		NEWARRAY(lit_polygon_list, lit_polygon, polygons);
+		if (lit_polygon_list == NULL)
+			return(false);
+	}
+	if (lit_colours > 0) {
+		NEWARRAY(lit_colour_list, RGBcolour, lit_colours);
+		if (lit_colour_list == NULL) {
+			DELARRAY(lit_polygon_list, lit_polygon, polygons);
+			lit_polygon_list = NULL;
+			return(false);
+		}
+	}
+	lit_colours = 0;
+	for (index = 0; index < polygons; index++) {
+		lit_polygon_list[index].stamp = 0;
+		lit_polygon_list[index].colour_list = &lit_colour_list[lit_colours];
+		lit_colours += polygon_list[index].polygon_def_ptr->vertices;
+	}
+	invalidate_lighting();
+	return(true);
+}
+
+// Method to invalidate the cached lighting of the block's polygons.
+
+void
+block::invalidate_lighting(void)
+{
+	lit_stamp = ++lighting_stamp;
+}
+
+// Method to make the block use the geometry shared by its block definition,
+// deleting any geometry of its own.  FALSE is returned if the geometry can't be
+// shared.
+
+bool
+block::share_geometry(void)
+{
+	if (!block_def_ptr->create_shared_geometry())
+		return(false);
+	if (!shared_geometry) {
+		if (vertex_list != NULL)
+			DELARRAY(vertex_list, vertex, vertices);
+		if (polygon_list != NULL)
+			DELARRAY(polygon_list, polygon, polygons);
+		if (col_mesh_ptr != NULL)
+			DELBASEARRAY((colmeshbyte *)col_mesh_ptr, colmeshbyte, col_mesh_size);
+	}
+	vertices = block_def_ptr->vertices;
+	vertex_list = block_def_ptr->shared_vertex_list;
+	polygon_list = block_def_ptr->shared_polygon_list;
+	col_mesh_ptr = block_def_ptr->shared_col_mesh_ptr;
+	col_mesh_size = block_def_ptr->shared_col_mesh_size;
+	shared_geometry = true;
+	return(true);
+}
+
+// Method to give the block its own copy of the geometry it shares with its
+// block definition, which must be done before the geometry is changed.  FALSE
+// is returned if we ran out of memory.
+
+bool
+block::unshare_geometry(void)
+{
+	vertex *new_vertex_list;
+	polygon *new_polygon_list;
+	int index;
+
+	if (!shared_geometry)
+		return(true);
+
+	// Create the new vertex and polygon lists.
+
+	new_vertex_list = NULL;
+	if (vertices > 0) {
+		NEWARRAY(new_vertex_list, vertex, vertices);
+		if (new_vertex_list == NULL)
+			return(false);
+	}
+	new_polygon_list = NULL;
+	if (polygons > 0) {
+		NEWARRAY(new_polygon_list, polygon, polygons);
+		if (new_polygon_list == NULL) {
+			if (new_vertex_list != NULL)
+				DELARRAY(new_vertex_list, vertex, vertices);
+			return(false);
+		}
+	}
+
+	// Create the new collision mesh structure.  If this fails the shared
+	// collision mesh remains in place.
+
+	if (!COL_createBlockColMesh(this)) {
+		if (new_vertex_list != NULL)
+			DELARRAY(new_vertex_list, vertex, vertices);
+		if (new_polygon_list != NULL)
+			DELARRAY(new_polygon_list, polygon, polygons);
+		return(false);
+	}
+
+	// Copy the shared vertices and polygons, and compute the collision mesh
+	// from them.
+
+	for (index = 0; index < vertices; index++)
+		new_vertex_list[index] = vertex_list[index];
+	for (index = 0; index < polygons; index++)
+		new_polygon_list[index] = polygon_list[index];
+	vertex_list = new_vertex_list;
+	polygon_list = new_polygon_list;
+	shared_geometry = false;
+	COL_convertBlockToColMesh(this);
+	return(true);
+}
+
 // Method to reset the vertices to those found in the block definition.
 
 void
 block::reset_vertices(void)
 {
+	if (!unshare_geometry())
+		return;
 	for (int index = 0; index < vertices; index++)
 		vertex_list[index] = block_def_ptr->vertex_list[index];
 }
@@ -4075,10 +4487,34 @@ block::update(void)
 		polygon_ptr->compute_plane_offset(vertex_list);
 	}
 
-	// Calculate the block's collision mesh.
+	// Calculate the block's collision mesh.  If it's triangles have already
+	// been built, they only need to be refitted to the new vertices.
 
 	if (requires_col_mesh) {
-		COL_convertBlockToColMesh(this);
+		if (col_mesh_ptr->topologyBuilt)
+			COL_refitBlockColMesh(this);
+		else
+			COL_convertBlockToColMesh(this);
+	}
+
+	// The cached lighting of the polygons is no longer valid.
+
+	invalidate_lighting();
+
+	// If this is a movable block, it's collision box may have grown, so the
+	// movable block grid must be updated.
+
+	if (block_def_ptr->movable)
+		update_movable_block_in_grid(this);
+
+	// If this is a fixed block, the bounding box of the chunk it's in must be
+	// recomputed.
+
+	if (square_ptr != NULL && !block_def_ptr->movable) {
+		int column, row, level;
+
+		world_ptr->get_square_location(square_ptr, &column, &row, &level);
+		world_ptr->invalidate_chunk(column, row, level);
 	}
 }
 
@@ -4090,6 +4526,11 @@ block::orient(void)
 	int index;
 	vertex *vertex_ptr;
 
+	// Make sure the block has its own geometry before changing it.
+
+	if (!unshare_geometry())
+		return;
+
 	// If a compass direction was given, first tilt the block so that the top
 	// points in the given compass direction, then rotate the block around the
 	// axis pointing in that direction, using the block origin as the central
@@ -4157,6 +4598,11 @@ block::rotate_x(float angle)
 {
 	vertex *vertex_ptr;
 
+	// Make sure the block has its own geometry before changing it.
+
+	if (!unshare_geometry())
+		return;
+
 	// Perform the rotation around the X axis.
 
 	for (int index = 0; index < vertices; index++) {
@@ -4178,6 +4624,11 @@ block::rotate_y(float angle)
 {
 	vertex *vertex_ptr;
 
+	// Make sure the block has its own geometry before changing it.
+
+	if (!unshare_geometry())
+		return;
+
     if (block_def_ptr->animated) {
 
 		// Perform the rotation around the Y axis.
@@ -4215,6 +4666,11 @@ block::rotate_z(float angle)
 {
 	vertex *vertex_ptr;
 
+	// Make sure the block has its own geometry before changing it.
+
+	if (!unshare_geometry())
+		return;
+
 	// Perform the rotation around the Z axis.
 
 	for (int index = 0; index < vertices; index++) {
@@ -4328,6 +4784,79 @@ square::~square()
 	}
 }
 
+//------------------------------------------------------------------------------
+// Square chunk class.
+//------------------------------------------------------------------------------
+
+// Default constructor marks the chunk's summary as needing to be computed.
+
+square_chunk::square_chunk()
+{
+	bounds_valid = false;
+	blocks = 0;
+	bounded = false;
+	occludable = false;
+}
+
+// Method to recompute the number of blocks in the chunk and the bounding box
+// enclosing them.  If any block has no collision mesh the chunk has no usable
+// bounding box, and if any block is a sprite it can't be tested for occlusion.
+
+void
+square_chunk::update_bounds(void)
+{
+	int square_no;
+	block *block_ptr;
+	COL_MESH *col_mesh_ptr;
+	vertex block_min_bbox, block_max_bbox;
+
+	blocks = 0;
+	bounded = true;
+	occludable = true;
+	for (square_no = 0; square_no < CHUNK_SQUARES; square_no++) {
+		block_ptr = square_list[square_no].block_ptr;
+		if (block_ptr == NULL)
+			continue;
+		if (block_ptr->block_def_ptr->type & SPRITE_BLOCK)
+			occludable = false;
+
+		// Extend the chunk's bounding box to include the block's bounding box,
+		// if it has one.
+
+		col_mesh_ptr = block_ptr->col_mesh_ptr;
+		if (col_mesh_ptr == NULL) {
+			bounded = false;
+			occludable = false;
+		} else {
+			block_min_bbox.x = col_mesh_ptr->minBox.x + block_ptr->translation.x;
+			block_min_bbox.y = col_mesh_ptr->minBox.y + block_ptr->translation.y;
+			block_min_bbox.z = col_mesh_ptr->minBox.z + block_ptr->translation.z;
+			block_max_bbox.x = col_mesh_ptr->maxBox.x + block_ptr->translation.x;
+			block_max_bbox.y = col_mesh_ptr->maxBox.y + block_ptr->translation.y;
+			block_max_bbox.z = col_mesh_ptr->maxBox.z + block_ptr->translation.z;
+			if (blocks == 0) {
+				min_bbox = block_min_bbox;
+				max_bbox = block_max_bbox;
+			} else {
+				if (block_min_bbox.x < min_bbox.x)
+					min_bbox.x = block_min_bbox.x;
+				if (block_min_bbox.y < min_bbox.y)
+					min_bbox.y = block_min_bbox.y;
+				if (block_min_bbox.z < min_bbox.z)
+					min_bbox.z = block_min_bbox.z;
+				if (block_max_bbox.x > max_bbox.x)
+					max_bbox.x = block_max_bbox.x;
+				if (block_max_bbox.y > max_bbox.y)
+					max_bbox.y = block_max_bbox.y;
+				if (block_max_bbox.z > max_bbox.z)
+					max_bbox.z = block_max_bbox.z;
+			}
+		}
+		blocks++;
+	}
+	bounds_valid = true;
+}
+
 //------------------------------------------------------------------------------
 // World class.
 //------------------------------------------------------------------------------
@@ -4338,40 +4867,131 @@ world::world()
 {
 	map_style = SINGLE_MAP;
 	ground_level_exists = false;
-	square_map = NULL;
+	chunk_map = NULL;
+	chunk_list = NULL;
+	chunks = 0;
+	max_chunks = 0;
 	level_entity_list = NULL;
 	audio_scale = 2.0f / units_per_block;
 }
 
-// Default destructor deletes the square map and level entity list, if they exist.
+// Default destructor deletes the chunk map, the allocated chunks and the level
+// entity list, if they exist.
 
 world::~world()
 {
-	if (square_map != NULL)
-		DELARRAY(square_map, square, columns * rows * levels);
+	if (chunk_map != NULL)
+		DELARRAY(chunk_map, square_chunk *, chunk_columns * chunk_rows * chunk_levels);
+	if (chunk_list != NULL) {
+		for (int index = 0; index < chunks; index++)
+			DEL(chunk_list[index], square_chunk);
+		DELARRAY(chunk_list, square_chunk *, max_chunks);
+	}
 	if (level_entity_list != NULL)
 		DELARRAY(level_entity_list, entity *, levels);
 }
 
-// Method to create the square map and level entity list.
+// Method to create the chunk map and level entity list.  The chunks of squares
+// are only allocated when a square in them is first written to.
 // It is assumed the dimensions for the square map are already set.
 
 bool
 world::create_square_map(void)
 {
-	NEWARRAY(square_map, square, columns * rows * levels);
+	chunk_columns = (columns + CHUNK_COLUMNS - 1) >> CHUNK_COLUMN_SHIFT;
+	chunk_rows = (rows + CHUNK_ROWS - 1) >> CHUNK_ROW_SHIFT;
+	chunk_levels = (levels + CHUNK_LEVELS - 1) >> CHUNK_LEVEL_SHIFT;
+	NEWARRAY(chunk_map, square_chunk *, chunk_columns * chunk_rows * chunk_levels);
+	if (chunk_map != NULL)
+		memset(chunk_map, 0, chunk_columns * chunk_rows * chunk_levels * sizeof(square_chunk *));
 	NEWARRAY(level_entity_list, entity *, levels);
-	return(square_map != NULL && level_entity_list != NULL);
+	return(chunk_map != NULL && level_entity_list != NULL);
+}
+
+// Method to create the chunk at a given position in the chunk map.  The chunk
+// is also inserted into the chunk list, which is kept sorted by address so that
+// the chunk holding a square can be found with a binary search.
+
+square_chunk *
+world::create_chunk(int chunk_column, int chunk_row, int chunk_level)
+{
+	square_chunk *chunk_ptr;
+	square_chunk **new_chunk_list;
+	int new_max_chunks;
+	int index;
+
+	// If the chunk list is full, double its size.
+
+	if (chunks == max_chunks) {
+		new_max_chunks = max_chunks > 0 ? max_chunks * 2 : 64;
+		NEWARRAY(new_chunk_list, square_chunk *, new_max_chunks);
+		if (new_chunk_list == NULL)
+			return(NULL);
+		if (chunk_list != NULL) {
+			memcpy(new_chunk_list, chunk_list, chunks * sizeof(square_chunk *));
+			DELARRAY(chunk_list, square_chunk *, max_chunks);
+		}
+		chunk_list = new_chunk_list;
+		max_chunks = new_max_chunks;
+	}
+
+	// Create the chunk and set the map position of its first square.
+
+	NEW(chunk_ptr, square_chunk);
+	if (chunk_ptr == NULL)
+		return(NULL);
+	chunk_ptr->column = chunk_column << CHUNK_COLUMN_SHIFT;
+	chunk_ptr->row = chunk_row << CHUNK_ROW_SHIFT;
+	chunk_ptr->level = chunk_level << CHUNK_LEVEL_SHIFT;
+
+	// Insert the chunk into the chunk list in address order, and store it in
+	// the chunk map.
+
+	for (index = chunks; index > 0 && chunk_list[index - 1] > chunk_ptr; index--)
+		chunk_list[index] = chunk_list[index - 1];
+	chunk_list[index] = chunk_ptr;
+	chunks++;
+	chunk_map[(chunk_level * chunk_rows + chunk_row) * chunk_columns + chunk_column] = chunk_ptr;
+	return(chunk_ptr);
 }
 
-// Method to return a pointer to the square at a given map position.
+// Method to return a pointer to the square at a given map position, creating
+// the chunk that holds it if necessary.  NULL is returned if the map position
+// is invalid or the chunk could not be created.
 
 square *
 world::get_square_ptr(int column, int row, int level)
 {
+	square_chunk *chunk_ptr;
+	int chunk_column, chunk_row, chunk_level;
+
 	if (column < 0 || column >= columns || row < 0 || row >= rows || level < 0 || level >= levels)
 		return(NULL);
-	return(&square_map[(level * rows + row) * columns + column]);
+	chunk_column = column >> CHUNK_COLUMN_SHIFT;
+	chunk_row = row >> CHUNK_ROW_SHIFT;
+	chunk_level = level >> CHUNK_LEVEL_SHIFT;
+	chunk_ptr = chunk_map[(chunk_level * chunk_rows + chunk_row) * chunk_columns + chunk_column];
+	if (chunk_ptr == NULL && (chunk_ptr = create_chunk(chunk_column, chunk_row, chunk_level)) == NULL)
+		return(NULL);
+	return(&chunk_ptr->square_list[CHUNK_SQUARE_INDEX(column, row, level)]);
+}
+
+// Method to return a pointer to the square at a given map position, or NULL if
+// the map position is invalid or the chunk that would hold it doesn't exist
+// (in which case the square is empty).
+
+square *
+world::find_square_ptr(int column, int row, int level)
+{
+	square_chunk *chunk_ptr;
+
+	if (column < 0 || column >= columns || row < 0 || row >= rows || level < 0 || level >= levels)
+		return(NULL);
+	chunk_ptr = chunk_map[((level >> CHUNK_LEVEL_SHIFT) * chunk_rows + (row >> CHUNK_ROW_SHIFT)) *
+		chunk_columns + (column >> CHUNK_COLUMN_SHIFT)];
+	if (chunk_ptr == NULL)
+		return(NULL);
+	return(&chunk_ptr->square_list[CHUNK_SQUARE_INDEX(column, row, level)]);
 }
 
 // Method to return a pointer to the block at a given map position.
@@ -4379,12 +4999,29 @@ world::get_square_ptr(int column, int row, int level)
 block *
 world::get_block_ptr(int column, int row, int level)
 {
-	square *square_ptr = get_square_ptr(column, row, level);
+	square *square_ptr = find_square_ptr(column, row, level);
 	if (square_ptr != NULL)
 		return(square_ptr->block_ptr);
 	return(NULL);
 }
 
+// Method to mark the summary of the chunk holding the square at a given map
+// position as stale, after a block on that square has been added, removed or
+// changed shape.
+
+void
+world::invalidate_chunk(int column, int row, int level)
+{
+	square_chunk *chunk_ptr;
+
+	if (column < 0 || column >= columns || row < 0 || row >= rows || level < 0 || level >= levels)
+		return;
+	chunk_ptr = chunk_map[((level >> CHUNK_LEVEL_SHIFT) * chunk_rows + (row >> CHUNK_ROW_SHIFT)) *
+		chunk_columns + (column >> CHUNK_COLUMN_SHIFT)];
+	if (chunk_ptr != NULL)
+		chunk_ptr->bounds_valid = false;
+}
+
 // Method to return a pointer to the entity for a given level.
 
 entity *
@@ -4409,19 +5046,29 @@ world::set_level_entity(int level, entity *entity_ptr)
 void 
 world::get_square_location(square *square_ptr, int *column_ptr, int *row_ptr, int *level_ptr)
 {
+	square_chunk *chunk_ptr;
+	int min_index, max_index, index;
 	int offset;
 
-	// Determine the offset of the square from the beginning of the square map.
-	// NOTE: Visual C++ generates an array index from the subtraction of two
-	// pointers; I don't know if this is standard C++ semantics or not.
+	// Find the chunk holding the square, which is the last chunk in the chunk
+	// list whose address is not above the square's address.
 
-	offset = square_ptr - square_map;
+	min_index = 0;
+	max_index = chunks - 1;
+	while (min_index < max_index) {
+		index = (min_index + max_index + 1) >> 1;
+		if (chunk_list[index]->square_list > square_ptr)
+			max_index = index - 1;
+		else
+			min_index = index;
+	}
+	chunk_ptr = chunk_list[min_index];
 
-	// Determine which level, row and column the square is on.
+	// Determine the offset of the square from the beginning of the chunk, and
+	// from that which level, row and column the square is on.
 
-	*level_ptr = offset / (rows * columns);
-	offset = offset % (rows * columns);
-	*row_ptr = offset / columns;
-	offset = offset % columns;
-	*column_ptr = offset;
+	offset = square_ptr - chunk_ptr->square_list;
+	*level_ptr = chunk_ptr->level + (offset >> (CHUNK_ROW_SHIFT + CHUNK_COLUMN_SHIFT));
+	*row_ptr = chunk_ptr->row + ((offset >> CHUNK_COLUMN_SHIFT) & (CHUNK_ROWS - 1));
+	*column_ptr = chunk_ptr->column + (offset & (CHUNK_COLUMNS - 1));
 }
\ No newline at end of file
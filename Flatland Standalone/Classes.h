@@ -10,7 +10,7 @@
 #define static
 #endif
 
-#include "collision\collision.h"
+#include "Collision/Collision.h"
 
 // Type definitions for various integer types.
 
@@ -85,6 +85,21 @@ typedef int fixed;
 #define NULL_BLOCK_SYMBOL		'.'
 #define GROUND_BLOCK_SYMBOL		' '
 
+// Dimensions of a chunk of squares in the world map, the number of squares in
+// a chunk, and a macro to compute the index of a square within its chunk.
+
+#define CHUNK_COLUMN_SHIFT		4
+#define CHUNK_ROW_SHIFT			4
+#define CHUNK_LEVEL_SHIFT		2
+#define CHUNK_COLUMNS			(1 << CHUNK_COLUMN_SHIFT)
+#define CHUNK_ROWS				(1 << CHUNK_ROW_SHIFT)
+#define CHUNK_LEVELS			(1 << CHUNK_LEVEL_SHIFT)
+#define CHUNK_SQUARES			(CHUNK_COLUMNS * CHUNK_ROWS * CHUNK_LEVELS)
+#define CHUNK_SQUARE_INDEX(column,row,level) \
+	((((level) & (CHUNK_LEVELS - 1)) << (CHUNK_ROW_SHIFT + CHUNK_COLUMN_SHIFT)) | \
+	 (((row) & (CHUNK_ROWS - 1)) << CHUNK_COLUMN_SHIFT) | \
+	 ((column) & (CHUNK_COLUMNS - 1)))
+
 // Trinometry macros.
 
 #define PI			3.141592654f
@@ -794,7 +809,8 @@ struct span_data {
 // Span buffer element.
 //------------------------------------------------------------------------------
 
-struct pixmap;							// Forward declaration.
+struct pixmap;							// Forward declarations.
+struct cache_entry;
 
 struct span {
 	int sy;								// Screen y coordinate for span.
@@ -806,6 +822,7 @@ struct span {
 	pixmap *pixmap_ptr;					// Pixmap to render on span (or NULL).
 	pixel colour_pixel;					// Colour to render on span.
 	int brightness_index;				// Brightness index for span.
+	cache_entry *cache_entry_ptr;		// Cache entry for pixmap (or NULL).
 	span *next_span_ptr;				// Pointer to next span in list.
 
 	span();
@@ -814,6 +831,16 @@ struct span {
 	bool span_in_front(span *span_ptr);
 };
 
+//------------------------------------------------------------------------------
+// Span buffer coverage run, representing a run of adjacent opaque spans.
+//------------------------------------------------------------------------------
+
+struct coverage_run {
+	int start_sx;					// Start screen x coordinate for run.
+	int end_sx;						// End screen x coordinate + 1 for run.
+	span *last_span_ptr;			// Last opaque span in run.
+};
+
 //------------------------------------------------------------------------------
 // Span buffer row element.
 //------------------------------------------------------------------------------
@@ -821,9 +848,15 @@ struct span {
 struct span_row {
 	span *opaque_span_list;			// Opaque spans (sorted left to right).
 	span *transparent_span_list;	// Transparent spans (sorted back to front).
+	coverage_run *run_list;			// Coverage runs (sorted left to right).
+	int runs;						// Number of coverage runs.
+	int max_runs;					// Maximum coverage runs before growing.
+	int covered_pixels;				// Pixels covered by opaque spans.
 
 	span_row();
 	~span_row();
+	coverage_run *insert_run(int run_no);
+	void remove_run(int run_no);
 };
 
 //------------------------------------------------------------------------------
@@ -833,6 +866,7 @@ struct span_row {
 struct span_buffer {
 	int rows;					// Number of span buffer rows.
 	span_row *buffer_ptr;		// Pointer to span buffer rows.
+	int covered_rows;			// Rows fully covered by opaque spans.
 
 	span_buffer();
 	~span_buffer();
@@ -859,7 +893,9 @@ struct cache_entry {
 	int lit_image_size;					// Size of lit image, in bytes.
 	int lit_image_mask;					// u/v coordinate mask.
 	int lit_image_shift;				// v coordinate shift.
+	int lit_image_levels;				// Number of mipmap levels in lit image.
 	void *hardware_texture_ptr;			// Pointer to hardware texture.
+	cache_entry *prev_cache_entry_ptr;	// Pointer to previous cache entry.
 	cache_entry *next_cache_entry_ptr;	// Pointer to next cache entry in list.
 
 	cache_entry();
@@ -873,12 +909,21 @@ struct cache_entry {
 
 struct cache {
 	int image_size_index;			// Size of images stored in this cache.
-	cache_entry *cache_entry_list;	// Linked list of cache entries.
+	int cache_entry_size;			// Size of each cache entry, in bytes.
+	cache_entry *cache_entry_list;	// Cache entries (most recently used first).
+	cache_entry *last_cache_entry_ptr;	// Least recently used cache entry.
+	cache_entry *free_cache_entry_list;	// Cache entries not in use.
 
 	cache();
 	cache(int size_index);
 	~cache();
 	cache_entry *add_cache_entry(void);
+	void link_cache_entry(cache_entry *cache_entry_ptr);
+	void unlink_cache_entry(cache_entry *cache_entry_ptr);
+	void touch_cache_entry(cache_entry *cache_entry_ptr);
+	void free_cache_entry(cache_entry *cache_entry_ptr);
+	cache_entry *get_free_cache_entry(void);
+	void delete_free_cache_entry(void);
 };
 
 //==============================================================================
@@ -998,6 +1043,7 @@ struct light {
 	float cos_cone_angle;			// Cosine of cone angle.
 	float cone_angle_M;				// 1 / (1 - cosine of cone angle).
 	bool flood;						// TRUE if flood light (no light dropoff).
+	unsigned int stamp;				// Lighting stamp of last change.
 	light *next_light_ptr;			// Pointer to next light in list.
 
 	light();
@@ -1119,6 +1165,14 @@ struct action {
 // Script definition class.
 //------------------------------------------------------------------------------
 
+// Number of script threads, which is the most scripts that can be executing at
+// once, the time slice given to a script that is executed on its own, and the
+// time that all executing scripts share each frame.
+
+#define SCRIPT_THREADS				8
+#define SCRIPT_TIME_SLICE_MS		10
+#define SCRIPT_FRAME_BUDGET_MS		10
+
 struct script_def {
 	unsigned int ID;
 	string script;
@@ -1330,7 +1384,6 @@ struct polygon_def {
 
 struct polygon {
 	polygon_def *polygon_def_ptr;		// Pointer to polygon definition.
-	bool active;						// TRUE if polygon is active.
 	vertex centroid;					// Centroid of polygon.
 	vector normal_vector;				// Surface normal vector.
 	float plane_offset;					// Offset in plane equation.
@@ -1423,6 +1476,10 @@ struct block_def {
 	trigger *last_trigger_ptr;				// Pointer to last trigger in list (if any).
 	block *free_block_list;					// List of free blocks (if any).
 	block *used_block_list;					// List of used blocks (if any).
+	vertex *shared_vertex_list;				// Oriented vertex list shared by blocks.
+	polygon *shared_polygon_list;			// Polygon list shared by blocks.
+	COL_MESH *shared_col_mesh_ptr;			// Collision mesh shared by blocks.
+	int shared_col_mesh_size;				// Size of shared collision mesh in bytes.
 	int root_polygon_ref;					// Root polygon reference in BSP tree.
 	BSP_node *BSP_tree;						// Pointer to BSP tree (if any).
 	orientation block_orientation;			// Orientation of structural block.
@@ -1444,6 +1501,8 @@ struct block_def {
 	void create_vertex_list(int set_vertices);
 	void create_polygon_def_list(int set_polygons);
 	void dup_block_def(block_def *block_def_ptr);
+	bool shares_geometry(void);
+	bool create_shared_geometry(void);
 	block *create_simplified_block();
 	block *new_block(square *square_ptr);
 	block *del_block(block *block_ptr);
@@ -1463,7 +1522,7 @@ struct skybox_def {
 	texture *skybox_texture_list[6];
 
 	skybox_def(blockset *blockset_ptr, string skybox_texture_URL);
-	skybox_def::skybox_def(blockset *blockset_ptr, string skybox_left_texture_URL, string skybox_right_texture_URL,
+	skybox_def(blockset *blockset_ptr, string skybox_left_texture_URL, string skybox_right_texture_URL,
 		string skybox_up_texture_URL, string skybox_down_texture_URL, string skybox_front_texture_URL, string skybox_back_texture_URL);
 	~skybox_def();
 };
@@ -1560,6 +1619,17 @@ struct blockset_list {
 // Block and map classes.
 //==============================================================================
 
+//------------------------------------------------------------------------------
+// Lit polygon class, holding the cached lighting of a block polygon.
+//------------------------------------------------------------------------------
+
+struct lit_polygon {
+	unsigned int stamp;				// Lighting stamp when polygon was lit.
+	bool front_face;				// TRUE if front face was lit.
+	float brightness;				// Brightness at centroid.
+	RGBcolour *colour_list;			// Lit colour of each vertex.
+};
+
 //------------------------------------------------------------------------------
 // Block class.
 //------------------------------------------------------------------------------
@@ -1577,6 +1647,8 @@ struct block {
 	vertex *vertex_list;			// List of all vertices.
 	int polygons;					// Size of polygon list. 
 	polygon *polygon_list;			// List of all polygons in block.
+	bool *polygon_active_list;		// TRUE for each polygon that is active.
+	bool shared_geometry;			// TRUE if geometry is block definition's.
 	orientation block_orientation;	// Orientation of structural block.
 	vertex block_origin;			// Origin of structural block.
 	float sprite_angle;				// Angle of sprite (if applicable).
@@ -1593,6 +1665,11 @@ struct block {
 	light *light_list;				// List of lights in block.
 	light_ref *active_light_list;	// List of lights illuminating block.
 	bool set_active_lights;			// TRUE if active lights need to be set.
+	lit_polygon *lit_polygon_list;	// Cached lighting of each polygon.
+	RGBcolour *lit_colour_list;		// Cached lit colours of all vertices.
+	int lit_colours;				// Size of lit colour list.
+	unsigned int lit_stamp;			// Lighting stamp of last block change.
+	vertex lit_translation;			// Translation when block was last lit.
 	sound *sound_list;				// List of sounds in block.
 	int popup_trigger_flags;		// Popup trigger flags.
 	popup *popup_list;				// List of popups in block.
@@ -1601,6 +1678,9 @@ struct block {
 	hyperlink *exit_ptr;			// Pointer to exit (if any).
 	entrance *entrance_ptr;			// Pointer to entrance (if any).
 	block *next_block_ptr;			// Pointer to next block in list.
+	bool in_movable_grid;			// TRUE if block is in movable block grid.
+	int movable_cell;				// Movable block grid cell (-1 if none).
+	block *next_cell_block_ptr;		// Next block in movable block grid cell.
 	block *next_used_block_ptr;		// Pointer to next block in used list.
 	block *prev_used_block_ptr;		// Pointer to previous block in used list.
 
@@ -1608,7 +1688,12 @@ struct block {
 	~block();
 	bool create_vertex_list(int set_vertices);
 	bool create_polygon_list(int set_polygons);
+	bool create_polygon_active_list(int set_polygons);
 	bool create_active_light_list(void);
+	bool create_lit_polygon_list(void);
+	void invalidate_lighting(void);
+	bool share_geometry(void);
+	bool unshare_geometry(void);
 	void reset_vertices(void);
 	void update(void);
 	void orient(void);
@@ -1639,6 +1724,23 @@ struct square {
 	~square();
 };
 
+//------------------------------------------------------------------------------
+// Square chunk class.
+//------------------------------------------------------------------------------
+
+struct square_chunk {
+	int column, row, level;				// Map position of first square.
+	bool bounds_valid;					// FALSE if the summary below is stale.
+	int blocks;							// Number of fixed blocks in chunk.
+	bool bounded;						// TRUE if every block has a bounding box.
+	bool occludable;					// TRUE if bounded and has no sprites.
+	vertex min_bbox, max_bbox;			// Bounding box of all blocks in chunk.
+	square square_list[CHUNK_SQUARES];	// Squares in level, row, column order.
+
+	square_chunk();
+	void update_bounds(void);
+};
+
 //------------------------------------------------------------------------------
 // World class.
 //------------------------------------------------------------------------------
@@ -1649,15 +1751,24 @@ struct world {
 	int columns;					// Number of columns in square map.
 	int rows;						// Number of rows in square map.
 	int levels;						// Number of levels in square map.
-	square *square_map;				// Map of squares.
+	int chunk_columns;				// Number of columns in chunk map.
+	int chunk_rows;					// Number of rows in chunk map.
+	int chunk_levels;				// Number of levels in chunk map.
+	square_chunk **chunk_map;		// Map of chunks (NULL if not allocated).
+	square_chunk **chunk_list;		// Allocated chunks, sorted by address.
+	int chunks;						// Number of allocated chunks.
+	int max_chunks;					// Maximum chunks in chunk list.
 	entity **level_entity_list;		// Array of level entities.
 	float audio_scale;				// Audio scale (in metres per unit).
 
 	world();
 	~world();
 	bool create_square_map(void);
+	square_chunk *create_chunk(int chunk_column, int chunk_row, int chunk_level);
 	square *get_square_ptr(int column, int row, int level);
+	square *find_square_ptr(int column, int row, int level);
 	block *get_block_ptr(int column, int row, int level);
+	void invalidate_chunk(int column, int row, int level);
 	entity *get_level_entity(int level);
 	void set_level_entity(int level, entity *entity_ptr);
 	void get_square_location(square *square_ptr, int *column_ptr, int *row_ptr, int *level_ptr);
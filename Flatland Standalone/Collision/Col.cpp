@@ -11,10 +11,17 @@
 
 #include <stdio.h>
 #include <math.h>
-#include "col.h"
-#include "..\classes.h"
-#include "..\main.h"
-#include "..\parser.h"
+#include "Col.h"
+#include "../Classes.h"
+#include "../Main.h"
+#include "../Parser.h"
+
+	//------ SSE2 is used to reject a group of polys at once ---
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COL_SSE2
+#include <emmintrin.h>
+#endif
 
 
 /*--------------------------------------------------------------
@@ -663,6 +670,82 @@ bool	COL_checkAABoxAgainstMesh(COL_MESH *colMesh_p, VEC3 *meshOffs_p,
 }
 
 
+/*--------------------------------------------------------------
+
+	Return a mask of the polys in a group that face into the
+	movement vector (or are double-sided) and whose bounding
+	boxes overlap the AA box, one poly at a time.  This is
+	used where SSE2 isn't available, and the tests check the
+	SSE2 version against it.
+
+--------------------------------------------------------------*/
+
+int		COL_getMeshCollisionMaskScalar(COL_POLY4 *polys_p, VEC3 *movementVec_p,
+									   VEC3 *boxMin_p, VEC3 *boxMax_p)
+{
+	int		i, mask;
+	float	dot;
+
+	mask = 0;
+	for (i=0; i<COL_POLY_LANES; i++)
+	{
+		dot = (polys_p->normalX[i] * movementVec_p->x) + 
+			(polys_p->normalY[i] * movementVec_p->y) +
+			(polys_p->normalZ[i] * movementVec_p->z);
+		if ((polys_p->doubleSided[i] || dot < 0) &&
+			!(boxMax_p->x < polys_p->minX[i] || boxMin_p->x > polys_p->maxX[i] ||
+			  boxMax_p->y < polys_p->minY[i] || boxMin_p->y > polys_p->maxY[i] ||
+			  boxMax_p->z < polys_p->minZ[i] || boxMin_p->z > polys_p->maxZ[i]))
+			mask |= 1 << i;
+	}
+	return(mask);
+}
+
+
+/*--------------------------------------------------------------
+
+	Return a mask of the polys in a group that face into the
+	movement vector (or are double-sided) and whose bounding
+	boxes overlap the AA box.  The tests are the same ones
+	'COL_checkMeshCollision' and 'COL_isIntersecting' start
+	with, so any poly left out of the mask would have been
+	rejected by them anyway.
+
+--------------------------------------------------------------*/
+
+int		COL_getMeshCollisionMask(COL_POLY4 *polys_p, VEC3 *movementVec_p,
+								 VEC3 *boxMin_p, VEC3 *boxMax_p)
+{
+#ifdef COL_SSE2
+	__m128	dot, keep;
+
+
+	//------ Facing test ---------------------------------------
+
+	dot = _mm_add_ps(_mm_add_ps(
+		_mm_mul_ps(_mm_loadu_ps(polys_p->normalX), _mm_set1_ps(movementVec_p->x)),
+		_mm_mul_ps(_mm_loadu_ps(polys_p->normalY), _mm_set1_ps(movementVec_p->y))),
+		_mm_mul_ps(_mm_loadu_ps(polys_p->normalZ), _mm_set1_ps(movementVec_p->z)));
+	keep = _mm_or_ps(_mm_castsi128_ps(_mm_loadu_si128((__m128i *)polys_p->doubleSided)),
+		_mm_cmplt_ps(dot, _mm_setzero_ps()));
+
+
+	//------ Bounding box test ---------------------------------
+
+	keep = _mm_and_ps(keep, _mm_cmpnlt_ps(_mm_set1_ps(boxMax_p->x), _mm_loadu_ps(polys_p->minX)));
+	keep = _mm_and_ps(keep, _mm_cmpngt_ps(_mm_set1_ps(boxMin_p->x), _mm_loadu_ps(polys_p->maxX)));
+	keep = _mm_and_ps(keep, _mm_cmpnlt_ps(_mm_set1_ps(boxMax_p->y), _mm_loadu_ps(polys_p->minY)));
+	keep = _mm_and_ps(keep, _mm_cmpngt_ps(_mm_set1_ps(boxMin_p->y), _mm_loadu_ps(polys_p->maxY)));
+	keep = _mm_and_ps(keep, _mm_cmpnlt_ps(_mm_set1_ps(boxMax_p->z), _mm_loadu_ps(polys_p->minZ)));
+	keep = _mm_and_ps(keep, _mm_cmpngt_ps(_mm_set1_ps(boxMin_p->z), _mm_loadu_ps(polys_p->maxZ)));
+	return(_mm_movemask_ps(keep));
+#else
+	return(COL_getMeshCollisionMaskScalar(polys_p, movementVec_p, boxMin_p,
+		boxMax_p));
+#endif
+}
+
+
 /*--------------------------------------------------------------
 
 	Check whether a Axis Aligned bounding box has collided 
@@ -676,23 +759,48 @@ bool	COL_checkMeshCollision(COL_MESH *colMesh_p, VEC3 *meshOffs_p,
 								COL_AABOX *aaBox_p, VEC3 *boxCentre_p)
 {
 	bool	collided;
-	int		i;
-	VEC3	movementVec;
+	int		i, group, mask;
+	VEC3	movementVec,
+			boxPos, boxMin, boxMax;
 
    	movementVec.x = x - oldX;
 	movementVec.y = y - oldY;
 	movementVec.z = z - oldZ;
 	VEC_normalise(&movementVec);
 
+	//------ The AA box relative to the mesh, computed the -----
+	//------ same way as in 'COL_isIntersecting' ---------------
+
+	boxMax.x = (boxPos.x = boxCentre_p->x - meshOffs_p->x) + aaBox_p->maxDim.x;
+	boxMin.x = boxPos.x - aaBox_p->maxDim.x;
+	boxMax.y = (boxPos.y = boxCentre_p->y - meshOffs_p->y) + aaBox_p->maxDim.y;
+	boxMin.y = boxPos.y - aaBox_p->maxDim.y;
+	boxMax.z = (boxPos.z = boxCentre_p->z - meshOffs_p->z) + aaBox_p->maxDim.z;
+	boxMin.z = boxPos.z - aaBox_p->maxDim.z;
+
 	collided = false;
+	mask = 0;
 	for (i=0; i<colMesh_p->numPolys; i++)
 	{
 		//------ Check the movement vector against the ---------
-		//------ normal of the poly...if it's single-sided and -
-		//------ facing away from us, ignore it ----------------
+		//------ normal of each poly in the group, and the -----
+		//------ bounding boxes...if a poly is single-sided ----
+		//------ and facing away from us, or nowhere near the --
+		//------ box, ignore it --------------------------------
+
+		if ((i % COL_POLY_LANES) == 0)
+		{
+			group = i / COL_POLY_LANES;
+			mask = COL_getMeshCollisionMask(&colMesh_p->p4[group],
+				&movementVec, &boxMin, &boxMax);
+			if (mask == 0)
+			{
+				i += COL_POLY_LANES - 1;
+				continue;
+			}
+		}
 
-		if (colMesh_p->p[i].double_sided ||
-			VEC_dot(&colMesh_p->p[i].normal, &movementVec) < 0)
+		if (mask & (1 << (i % COL_POLY_LANES)))
 		{
 			if (COL_isIntersecting(colMesh_p, meshOffs_p, i, aaBox_p,
 				boxCentre_p))
@@ -992,6 +1100,86 @@ float		COL_aaboxAndRaysAgainstPoly(VEC3 *rays_p, COL_MESH *colMesh_p,
 }
 
 
+/*--------------------------------------------------------------
+
+	Return a mask of the polys in a group that face the ray 
+	going down (or are double-sided) and whose bounding boxes
+	overlap the AA box, one poly at a time.  This is used 
+	where SSE2 isn't available, and the tests check the SSE2
+	version against it.
+
+--------------------------------------------------------------*/
+
+int		COL_getShadowMaskScalar(COL_POLY4 *polys_p, VEC3 *pos_p, VEC3 *boxMin_p,
+								VEC3 *boxMax_p)
+{
+	int		i, mask;
+	float	s;
+
+	mask = 0;
+	for (i=0; i<COL_POLY_LANES; i++)
+	{
+		s = (g_rayGoingDown.x * polys_p->normalX[i]) +
+			(g_rayGoingDown.y * polys_p->normalY[i]) +
+			(g_rayGoingDown.z * polys_p->normalZ[i]);
+		if ((polys_p->doubleSided[i] || !(s >= 0)) &&
+			!(boxMax_p->x < (polys_p->minX[i] + pos_p->x) ||
+			  boxMin_p->x > (polys_p->maxX[i] + pos_p->x) ||
+			  boxMax_p->z < (polys_p->minZ[i] + pos_p->z) ||
+			  boxMin_p->z > (polys_p->maxZ[i] + pos_p->z) ||
+			  boxMax_p->y < (polys_p->minY[i] + pos_p->y)))
+			mask |= 1 << i;
+	}
+	return(mask);
+}
+
+
+/*--------------------------------------------------------------
+
+	Return a mask of the polys in a group that face the ray 
+	going down (or are double-sided) and whose bounding boxes
+	overlap the AA box.  The tests are the same ones that 
+	'COL_aaboxAndRaysAgainstPoly' starts with, so any poly 
+	left out of the mask would have been rejected by it anyway.
+
+--------------------------------------------------------------*/
+
+int		COL_getShadowMask(COL_POLY4 *polys_p, VEC3 *pos_p, VEC3 *boxMin_p,
+						  VEC3 *boxMax_p)
+{
+#ifdef COL_SSE2
+	__m128	s, keep;
+
+
+	//------ Facing test ---------------------------------------
+
+	s = _mm_add_ps(_mm_add_ps(
+		_mm_mul_ps(_mm_set1_ps(g_rayGoingDown.x), _mm_loadu_ps(polys_p->normalX)),
+		_mm_mul_ps(_mm_set1_ps(g_rayGoingDown.y), _mm_loadu_ps(polys_p->normalY))),
+		_mm_mul_ps(_mm_set1_ps(g_rayGoingDown.z), _mm_loadu_ps(polys_p->normalZ)));
+	keep = _mm_or_ps(_mm_castsi128_ps(_mm_loadu_si128((__m128i *)polys_p->doubleSided)),
+		_mm_cmpnge_ps(s, _mm_setzero_ps()));
+
+
+	//------ Bounding box test ---------------------------------
+
+	keep = _mm_and_ps(keep, _mm_cmpnlt_ps(_mm_set1_ps(boxMax_p->x),
+		_mm_add_ps(_mm_loadu_ps(polys_p->minX), _mm_set1_ps(pos_p->x))));
+	keep = _mm_and_ps(keep, _mm_cmpngt_ps(_mm_set1_ps(boxMin_p->x),
+		_mm_add_ps(_mm_loadu_ps(polys_p->maxX), _mm_set1_ps(pos_p->x))));
+	keep = _mm_and_ps(keep, _mm_cmpnlt_ps(_mm_set1_ps(boxMax_p->z),
+		_mm_add_ps(_mm_loadu_ps(polys_p->minZ), _mm_set1_ps(pos_p->z))));
+	keep = _mm_and_ps(keep, _mm_cmpngt_ps(_mm_set1_ps(boxMin_p->z),
+		_mm_add_ps(_mm_loadu_ps(polys_p->maxZ), _mm_set1_ps(pos_p->z))));
+	keep = _mm_and_ps(keep, _mm_cmpnlt_ps(_mm_set1_ps(boxMax_p->y),
+		_mm_add_ps(_mm_loadu_ps(polys_p->minY), _mm_set1_ps(pos_p->y))));
+	return(_mm_movemask_ps(keep));
+#else
+	return(COL_getShadowMaskScalar(polys_p, pos_p, boxMin_p, boxMax_p));
+#endif
+}
+
+
 /*--------------------------------------------------------------
 
 	Find the highest shadow point beneath the top of the 
@@ -1004,10 +1192,11 @@ float	COL_getShadowHeight(COL_MESH **colMeshes_pp, VEC3 *pos_p, int numMeshes,
 							float x, float y, float z,                       
 							COL_AABOX *aaBox_p, float maxStepHeight)
 {
-	int			i, j;
+	int			i, j, group, lanes, mask;
 	VEC3		ray[4],
 				poi,
-				centreDownBox;
+				centreDownBox,
+				boxMin, boxMax;
 	float		nearestY, highestY;
 	COL_MESH	*colMesh_p;
 	COL_AABOX	downBox;
@@ -1062,6 +1251,17 @@ float	COL_getShadowHeight(COL_MESH **colMeshes_pp, VEC3 *pos_p, int numMeshes,
 
 	nearestY = y - units_per_block;
 
+	//------ The ray going down and the AA box, computed the ---
+	//------ same way as in 'COL_aaboxAndRaysAgainstPoly' ------
+
+  	g_rayGoingDown.y = -(ray[0].y+0.5f);
+
+	boxMax.x = centreDownBox.x+downBox.maxDim.x;
+	boxMin.x = centreDownBox.x-downBox.maxDim.x;
+	boxMax.y = centreDownBox.y+downBox.maxDim.y;
+	boxMax.z = centreDownBox.z+downBox.maxDim.z;
+	boxMin.z = centreDownBox.z-downBox.maxDim.z;
+
  	for (j=0; j<numMeshes; j++)
 	{
 		colMesh_p = colMeshes_pp[j];
@@ -1069,14 +1269,32 @@ float	COL_getShadowHeight(COL_MESH **colMeshes_pp, VEC3 *pos_p, int numMeshes,
 		if (COL_checkAABoxAgainstMesh(colMesh_p, &pos_p[j], &downBox,
 			&centreDownBox))
 		{
-			for (i=0; i<colMesh_p->numPolys; i++)
+			for (group=0; group<colMesh_p->numPolyGroups; group++)
 			{
-				highestY = COL_aaboxAndRaysAgainstPoly((VEC3 *)&ray, colMesh_p,
-					&pos_p[j], i, &poi, &downBox, &centreDownBox, 
-					y, maxStepHeight);
+				lanes = colMesh_p->numPolys - group * COL_POLY_LANES;
+				if (lanes > COL_POLY_LANES)
+					lanes = COL_POLY_LANES;
+				mask = COL_getShadowMask(&colMesh_p->p4[group], &pos_p[j],
+					&boxMin, &boxMax) & ((1 << lanes) - 1);
 
-				if (highestY > nearestY)
-					nearestY = highestY;
+				//------ A rejected poly counts as a height of -1, 
+				//------ as it always has ----------------------
+
+				if (mask != (1 << lanes) - 1 && -1 > nearestY)
+					nearestY = -1;
+
+				for (i=0; i<lanes; i++)
+				{
+					if (!(mask & (1 << i)))
+						continue;
+
+					highestY = COL_aaboxAndRaysAgainstPoly((VEC3 *)&ray,
+						colMesh_p, &pos_p[j], group * COL_POLY_LANES + i, &poi,
+						&downBox, &centreDownBox, y, maxStepHeight);
+
+					if (highestY > nearestY)
+						nearestY = highestY;
+				}
 			}
 		}
 	}
@@ -1343,6 +1561,379 @@ void	COL_checkCollisions(COL_MESH **colMeshes_pp, VEC3 *pos_p, int numMeshes,
 }
 
 
+/*--------------------------------------------------------------
+
+	Project a moving AA box and a poly onto a separating axis,
+	and narrow the interval of time during which they overlap.
+	Return FALSE if they never overlap along this axis.
+
+--------------------------------------------------------------*/
+
+static bool
+COL_sweepAxis(VEC3 *axis_p, VEC3 *v0_p, VEC3 *v1_p, VEC3 *v2_p,
+			  VEC3 *centre_p, VEC3 *maxDim_p, VEC3 *move_p,
+			  float *enter_p, float *exit_p, VEC3 *normal_p)
+{
+	float	p0, p1, p2,
+			polyMin, polyMax,
+			boxCentre, boxRadius,
+			speed,
+			enter, exit;
+
+
+	//------ Project the poly and the box onto the axis --------
+
+	p0 = VEC_dot(axis_p, v0_p);
+	p1 = VEC_dot(axis_p, v1_p);
+	p2 = VEC_dot(axis_p, v2_p);
+	polyMin = MIN(p0, MIN(p1, p2));
+	polyMax = MAX(p0, MAX(p1, p2));
+
+	boxCentre = VEC_dot(axis_p, centre_p);
+	boxRadius = maxDim_p->x * FABS(axis_p->x) + maxDim_p->y * FABS(axis_p->y) +
+		maxDim_p->z * FABS(axis_p->z);
+	speed = VEC_dot(axis_p, move_p);
+
+
+	//------ If the box isn't moving along this axis, it -------
+	//------ either always or never overlaps the poly ----------
+
+	if (speed == 0.0f)
+		return(boxCentre + boxRadius >= polyMin &&
+			boxCentre - boxRadius <= polyMax);
+
+
+	//------ Otherwise work out when it enters and leaves ------
+
+	if (speed > 0.0f)
+	{
+		enter = (polyMin - (boxCentre + boxRadius)) / speed;
+		exit = (polyMax - (boxCentre - boxRadius)) / speed;
+	}
+	else
+	{
+		enter = (polyMax - (boxCentre - boxRadius)) / speed;
+		exit = (polyMin - (boxCentre + boxRadius)) / speed;
+	}
+
+	if (enter > *enter_p)
+	{
+		*enter_p = enter;
+
+		//------ The contact normal points back against the ----
+		//------ movement --------------------------------------
+
+		if (speed > 0.0f)
+			VEC_set(normal_p, -axis_p->x, -axis_p->y, -axis_p->z);
+		else
+			VEC_set(normal_p, axis_p->x, axis_p->y, axis_p->z);
+	}
+	if (exit < *exit_p)
+		*exit_p = exit;
+	return(*enter_p <= *exit_p);
+}
+
+
+/*--------------------------------------------------------------
+
+	Sweep an AA box against a poly, using the separating axis
+	test on the box axes, the poly normal and the cross 
+	products of the box axes with the poly edges.  The axes
+	needn't be unit length, since only the ratios of the 
+	projections matter.  Return the 
+	fraction of the movement at which they first touch, or 1
+	if they don't.  Polys the box already overlaps are 
+	ignored, so that it can always move out of them.
+
+--------------------------------------------------------------*/
+
+static float
+COL_sweepAABoxAgainstPoly(COL_MESH *colMesh_p, int polyNum, 
+						  VEC3 *centre_p, VEC3 *maxDim_p, VEC3 *move_p,
+						  VEC3 *normal_p)
+{
+	int			i, j;
+	float		enter, exit, len;
+	VEC3		axis, boxAxis, contactNormal,
+				*v0, *v1, *v2, *edge_p;
+	COL_POLY3	*poly_p;
+
+
+	poly_p = &colMesh_p->p[polyNum];
+	v0 = &colMesh_p->v[poly_p->vIdx[0]];
+	v1 = &colMesh_p->v[poly_p->vIdx[1]];
+	v2 = &colMesh_p->v[poly_p->vIdx[2]];
+
+	enter = -1.0f;
+	exit = 2.0f;
+	VEC_set(&contactNormal, 0.0f, 0.0f, 0.0f);
+
+
+	//------ The box axes --------------------------------------
+
+	for (i=0; i<3; i++)
+	{
+		VEC_set(&axis, i == 0 ? 1.0f : 0.0f, i == 1 ? 1.0f : 0.0f, 
+			i == 2 ? 1.0f : 0.0f);
+		if (!COL_sweepAxis(&axis, v0, v1, v2, centre_p, maxDim_p, move_p,
+			&enter, &exit, &contactNormal))
+			return(1.0f);
+	}
+
+
+	//------ The poly normal -----------------------------------
+
+	if (!COL_sweepAxis(&poly_p->normal, v0, v1, v2, centre_p, maxDim_p, 
+		move_p, &enter, &exit, &contactNormal))
+		return(1.0f);
+
+
+	//------ The box axes crossed with the poly edges ----------
+
+	for (i=0; i<3; i++)
+	{
+		edge_p = &colMesh_p->e[poly_p->edgeIdx[i]];
+		for (j=0; j<3; j++)
+		{
+			VEC_set(&boxAxis, j == 0 ? 1.0f : 0.0f, j == 1 ? 1.0f : 0.0f, 
+				j == 2 ? 1.0f : 0.0f);
+			VEC_set(&axis, 
+				boxAxis.y * edge_p->z - boxAxis.z * edge_p->y,
+				boxAxis.z * edge_p->x - boxAxis.x * edge_p->z,
+				boxAxis.x * edge_p->y - boxAxis.y * edge_p->x);
+
+			//------ Skip edges parallel to this box axis ------
+
+			if (VEC_dot(&axis, &axis) < EPSILON)
+				continue;
+			if (!COL_sweepAxis(&axis, v0, v1, v2, centre_p, maxDim_p, 
+				move_p, &enter, &exit, &contactNormal))
+				return(1.0f);
+		}
+	}
+
+
+	//------ Only a contact during the movement counts ---------
+
+	if (enter < 0.0f || enter > 1.0f)
+		return(1.0f);
+
+	//------ The cross product axes aren't unit length, so -----
+	//------ normalise the contact normal.  If the box starts --
+	//------ touching the poly no axis sets it, so use the -----
+	//------ poly normal instead -------------------------------
+
+	len = (float)sqrt(VEC_dot(&contactNormal, &contactNormal));
+	if (len < EPSILON)
+	{
+		*normal_p = poly_p->normal;
+		VEC_normalise(normal_p);
+	}
+	else
+		VEC_set(normal_p, contactNormal.x / len, contactNormal.y / len,
+			contactNormal.z / len);
+	return(enter);
+}
+
+
+/*--------------------------------------------------------------
+
+	Sweep an AA box along a movement vector through multiple
+	collision meshes.  Return the fraction of the movement at
+	which it first touches a poly (1 if it never does), and 
+	the normal of the contact.
+
+--------------------------------------------------------------*/
+
+float	COL_sweepAABox(COL_MESH **colMeshes_pp, VEC3 *pos_p, int numMeshes,
+					   COL_AABOX *aaBox_p, VEC3 *start_p, VEC3 *move_p,
+					   VEC3 *normal_p)
+{
+	int			i, j, group, mask;
+	float		toi, polyToi;
+	VEC3		centre, meshCentre, sweepCentre,
+				boxMin, boxMax,
+				polyNormal;
+	COL_AABOX	sweepBox;
+	COL_MESH	*colMesh_p;
+
+
+	toi = 1.0f;
+	VEC_set(normal_p, 0.0f, 0.0f, 0.0f);
+	if (move_p->x == 0.0f && move_p->y == 0.0f && move_p->z == 0.0f)
+		return(toi);
+
+
+	//------ The box that encloses the whole sweep -------------
+
+	VEC_add(start_p, &aaBox_p->offsToCentre, &centre);
+	sweepBox.maxDim.x = aaBox_p->maxDim.x + FABS(move_p->x) * 0.5f;
+	sweepBox.maxDim.y = aaBox_p->maxDim.y + FABS(move_p->y) * 0.5f;
+	sweepBox.maxDim.z = aaBox_p->maxDim.z + FABS(move_p->z) * 0.5f;
+	VEC_set(&sweepBox.offsToCentre, 0.0f, 0.0f, 0.0f);
+	VEC_set(&sweepCentre, centre.x + move_p->x * 0.5f, 
+		centre.y + move_p->y * 0.5f, centre.z + move_p->z * 0.5f);
+
+	for (i=0; i<numMeshes; i++)
+	{
+		colMesh_p = colMeshes_pp[i];
+		if (!COL_checkAABoxAgainstMesh(colMesh_p, &pos_p[i], &sweepBox,
+			&sweepCentre))
+			continue;
+
+		//------ Work in the mesh's space ----------------------
+
+		VEC_sub(&centre, &pos_p[i], &meshCentre);
+		VEC_set(&boxMin, sweepCentre.x - pos_p[i].x - sweepBox.maxDim.x,
+			sweepCentre.y - pos_p[i].y - sweepBox.maxDim.y,
+			sweepCentre.z - pos_p[i].z - sweepBox.maxDim.z);
+		VEC_set(&boxMax, sweepCentre.x - pos_p[i].x + sweepBox.maxDim.x,
+			sweepCentre.y - pos_p[i].y + sweepBox.maxDim.y,
+			sweepCentre.z - pos_p[i].z + sweepBox.maxDim.z);
+
+		//------ Only polys that face into the movement and ----
+		//------ overlap the sweep need the full test (the -----
+		//------ facing test only needs the sign of the dot ----
+		//------ product, so the movement isn't normalised) ----
+
+		for (group=0; group<colMesh_p->numPolyGroups; group++)
+		{
+			mask = COL_getMeshCollisionMask(&colMesh_p->p4[group], 
+				move_p, &boxMin, &boxMax);
+			for (j=0; mask != 0; j++, mask >>= 1)
+			{
+				if (!(mask & 1))
+					continue;
+				polyToi = COL_sweepAABoxAgainstPoly(colMesh_p,
+					group * COL_POLY_LANES + j, &meshCentre, &aaBox_p->maxDim,
+					move_p, &polyNormal);
+				if (polyToi < toi)
+				{
+					toi = polyToi;
+					*normal_p = polyNormal;
+				}
+			}
+		}
+	}
+	return(toi);
+}
+
+
+/*--------------------------------------------------------------
+
+	Move an AA box along a movement vector, stopping just short
+	of any poly it runs into and sliding the rest of the way
+	along it.  Up to COL_MAX_SLIDES contacts are resolved in 
+	one call, so the cost is bounded however far it moves.
+
+--------------------------------------------------------------*/
+
+void	COL_slideAABox(COL_MESH **colMeshes_pp, VEC3 *pos_p, int numMeshes,
+					   COL_AABOX *aaBox_p, VEC3 *position_p, VEC3 *move_p)
+{
+	int			slide;
+	float		toi, len, dist;
+	VEC3		remaining, normal;
+
+
+	remaining = *move_p;
+	for (slide=0; slide<COL_MAX_SLIDES; slide++)
+	{
+		toi = COL_sweepAABox(colMeshes_pp, pos_p, numMeshes, aaBox_p,
+			position_p, &remaining, &normal);
+
+		//------ Nothing in the way, so do the whole move ------
+
+		if (toi >= 1.0f)
+		{
+			VEC_add(position_p, &remaining, position_p);
+			return;
+		}
+
+		//------ Move up to the contact, backing off a little -
+		//------ so we don't start the next sweep touching -----
+
+		len = (float)sqrt(VEC_dot(&remaining, &remaining));
+		toi -= COL_SWEEP_SKIN / len;
+		if (toi < 0.0f)
+			toi = 0.0f;
+		position_p->x += remaining.x * toi;
+		position_p->y += remaining.y * toi;
+		position_p->z += remaining.z * toi;
+
+		//------ Slide the rest of the move along the poly -----
+
+		remaining.x *= 1.0f - toi;
+		remaining.y *= 1.0f - toi;
+		remaining.z *= 1.0f - toi;
+		dist = VEC_dot(&remaining, &normal);
+		if (dist < 0.0f)
+		{
+			remaining.x -= normal.x * dist;
+			remaining.y -= normal.y * dist;
+			remaining.z -= normal.z * dist;
+		}
+		if (VEC_dot(&remaining, &remaining) < COL_SWEEP_SKIN * COL_SWEEP_SKIN)
+			return;
+	}
+}
+
+
+/*--------------------------------------------------------------
+
+	Move an AA box along a movement vector.  The sweep box, 
+	which may have its bottom raised so that low steps don't 
+	stop it, slides along anything it runs into.  Then the 
+	full box is checked where the slide ends, with no further 
+	movement, which steps it up onto anything no higher than
+	maxStepHeight and finds the shadow height below it.  If it
+	stepped up, the rest of the move is made from the new 
+	height, so that a flight of steps can be climbed in one 
+	move, up to COL_MAX_MOVE_STEPS times.
+
+--------------------------------------------------------------*/
+
+void	COL_moveAABox(COL_MESH **colMeshes_pp, VEC3 *pos_p, int numMeshes,
+					  COL_AABOX *aaBox_p, COL_AABOX *sweepBox_p,
+					  VEC3 *position_p, VEC3 *move_p,
+					  float *shadowHeight, float maxStepHeight)
+{
+	int			step;
+	VEC3		slideEnd, newPos, remaining;
+
+
+	remaining = *move_p;
+	for (step=0; step<COL_MAX_MOVE_STEPS; step++)
+	{
+		//------ Slide the sweep box, then check the full box --
+		//------ where it stopped ------------------------------
+
+		slideEnd = *position_p;
+		COL_slideAABox(colMeshes_pp, pos_p, numMeshes, sweepBox_p, &slideEnd,
+			&remaining);
+		newPos = slideEnd;
+		COL_checkCollisions(colMeshes_pp, pos_p, numMeshes, 
+			&newPos.x, &newPos.y, &newPos.z, 
+			slideEnd.x, slideEnd.y, slideEnd.z,
+			shadowHeight, maxStepHeight, aaBox_p);
+
+		//------ Work out how much of the move is left ---------
+
+		remaining.x -= slideEnd.x - position_p->x;
+		remaining.y -= slideEnd.y - position_p->y;
+		remaining.z -= slideEnd.z - position_p->z;
+		*position_p = newPos;
+
+		//------ Stop unless the box stepped up, and some of ---
+		//------ the move is left in the original direction ----
+
+		if (newPos.y <= slideEnd.y ||
+			VEC_dot(&remaining, move_p) <= COL_SWEEP_SKIN * COL_SWEEP_SKIN)
+			return;
+	}
+}
+
+
 /*--------------------------------------------------------------
 
 	Initialise the collision
@@ -12,8 +12,8 @@
 
 --------------------------------------------------------------*/
 
-#include "vec.h"
-#include "maths.h"
+#include "Vec.h"
+#include "Maths.h"
 
 
 /*--------------------------------------------------------------
@@ -53,6 +53,12 @@
 
 #define	COL_SHADOW_TOLERANCE		0.1f
 
+#define	COL_POLY_LANES				4
+
+#define	COL_MAX_SLIDES				4
+#define	COL_SWEEP_SKIN				0.01f
+#define	COL_MAX_MOVE_STEPS			8
+
 
 /*--------------------------------------------------------------
 
@@ -282,6 +288,27 @@ struct	COL_POLY3
 };
 
 
+	//------ The same polys packed four at a time, so the ------
+	//------ rejection tests can be done on a whole group ------
+
+struct	COL_POLY4
+{
+	float	minX[COL_POLY_LANES];
+	float	minY[COL_POLY_LANES];
+	float	minZ[COL_POLY_LANES];
+
+	float	maxX[COL_POLY_LANES];
+	float	maxY[COL_POLY_LANES];
+	float	maxZ[COL_POLY_LANES];
+
+	float	normalX[COL_POLY_LANES];
+	float	normalY[COL_POLY_LANES];
+	float	normalZ[COL_POLY_LANES];
+
+	int		doubleSided[COL_POLY_LANES];	// All bits set if double-sided
+};
+
+
 struct	COL_MESH
 {
 	int			numPolys;
@@ -294,6 +321,11 @@ struct	COL_MESH
 	VEC3		*v;					// vertices
 	VEC3		*e;					// edges
 	COL_POLY3	*p;					// polys
+
+	int			numPolyGroups;
+	COL_POLY4	*p4;				// polys in groups of COL_POLY_LANES
+
+	bool		topologyBuilt;		// TRUE if the polys can be refitted
 };
 
 
@@ -326,6 +358,30 @@ void		COL_checkCollisions(COL_MESH **colMeshes_pp, VEC3 *pos_p, int numMeshes,
 								float maxStepHeight,
 								COL_AABOX *aaBox_p);
 
+float		COL_sweepAABox(COL_MESH **colMeshes_pp, VEC3 *pos_p, int numMeshes,
+						   COL_AABOX *aaBox_p, VEC3 *start_p, VEC3 *move_p,
+						   VEC3 *normal_p);
+
+void		COL_slideAABox(COL_MESH **colMeshes_pp, VEC3 *pos_p, int numMeshes,
+						   COL_AABOX *aaBox_p, VEC3 *position_p, VEC3 *move_p);
+
+void		COL_moveAABox(COL_MESH **colMeshes_pp, VEC3 *pos_p, int numMeshes,
+						  COL_AABOX *aaBox_p, COL_AABOX *sweepBox_p,
+						  VEC3 *position_p, VEC3 *move_p,
+						  float *shadowHeight, float maxStepHeight);
+
+	//------ The poly group rejection tests, and the scalar ---
+	//------ versions the SSE2 ones are checked against -------
+
+int			COL_getMeshCollisionMask(COL_POLY4 *polys_p, VEC3 *movementVec_p,
+									 VEC3 *boxMin_p, VEC3 *boxMax_p);
+int			COL_getMeshCollisionMaskScalar(COL_POLY4 *polys_p, VEC3 *movementVec_p,
+										   VEC3 *boxMin_p, VEC3 *boxMax_p);
+int			COL_getShadowMask(COL_POLY4 *polys_p, VEC3 *pos_p, VEC3 *boxMin_p,
+							  VEC3 *boxMax_p);
+int			COL_getShadowMaskScalar(COL_POLY4 *polys_p, VEC3 *pos_p, VEC3 *boxMin_p,
+									VEC3 *boxMax_p);
+
 void		COL_init(void);
 void		COL_exit(void);
 
@@ -5,12 +5,13 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
-#include "collision.h"
-#include "..\Classes.h"
-#include "..\Main.h"
-#include "..\Parser.h"
-#include "..\Memory.h"
+#include "Collision.h"
+#include "../Classes.h"
+#include "../Main.h"
+#include "../Parser.h"
+#include "../Memory.h"
 
 //-----------------------------------------------------------------------------
 // Create a collision mesh of the given size.
@@ -21,12 +22,14 @@ COL_createColMesh(block *block_ptr, int vertices, int edges, int triangles)
 {
 	byte *temp_ptr;
 	COL_MESH *col_mesh_ptr;
-	int col_mesh_size;
+	int col_mesh_size, poly_groups;
 
 	// Compute the size of the collision mesh structure.
 
+	poly_groups = (triangles + COL_POLY_LANES - 1) / COL_POLY_LANES;
 	col_mesh_size = sizeof(COL_MESH) + vertices * sizeof(VEC3) + 
-		edges * sizeof(VEC3) + triangles * sizeof(COL_POLY3);
+		edges * sizeof(VEC3) + triangles * sizeof(COL_POLY3) +
+		poly_groups * sizeof(COL_POLY4);
 
 	// Allocate the collision mesh structure.
 
@@ -43,12 +46,16 @@ COL_createColMesh(block *block_ptr, int vertices, int edges, int triangles)
 	col_mesh_ptr->e = (VEC3 *)temp_ptr;
 	temp_ptr += sizeof(VEC3) * edges;
 	col_mesh_ptr->p = (COL_POLY3 *)temp_ptr;
+	temp_ptr += sizeof(COL_POLY3) * triangles;
+	col_mesh_ptr->p4 = (COL_POLY4 *)temp_ptr;
 
 	// Set up the list sizes.
 
 	col_mesh_ptr->numVerts = vertices;
 	col_mesh_ptr->numEdges = edges;
 	col_mesh_ptr->numPolys = triangles;
+	col_mesh_ptr->numPolyGroups = poly_groups;
+	col_mesh_ptr->topologyBuilt = false;
 
 	// Store the collision mesh pointer and size in the block.
 
@@ -57,6 +64,38 @@ COL_createColMesh(block *block_ptr, int vertices, int edges, int triangles)
 	return(true);
 }
 
+//-----------------------------------------------------------------------------
+// Pack the bounding boxes, normals and double-sided flags of the polygons in
+// a collision mesh into groups, so that they can be rejected several at a
+// time.  Unused lanes in the last group are zeroed.
+//-----------------------------------------------------------------------------
+
+static void
+COL_packColMeshPolys(COL_MESH *mesh_ptr)
+{
+	int index, group, lane;
+	COL_POLY3 *poly_ptr;
+	COL_POLY4 *group_ptr;
+
+	memset(mesh_ptr->p4, 0, mesh_ptr->numPolyGroups * sizeof(COL_POLY4));
+	for (index = 0; index < mesh_ptr->numPolys; index++) {
+		poly_ptr = &mesh_ptr->p[index];
+		group = index / COL_POLY_LANES;
+		lane = index % COL_POLY_LANES;
+		group_ptr = &mesh_ptr->p4[group];
+		group_ptr->minX[lane] = poly_ptr->min.x;
+		group_ptr->minY[lane] = poly_ptr->min.y;
+		group_ptr->minZ[lane] = poly_ptr->min.z;
+		group_ptr->maxX[lane] = poly_ptr->max.x;
+		group_ptr->maxY[lane] = poly_ptr->max.y;
+		group_ptr->maxZ[lane] = poly_ptr->max.z;
+		group_ptr->normalX[lane] = poly_ptr->normal.x;
+		group_ptr->normalY[lane] = poly_ptr->normal.y;
+		group_ptr->normalZ[lane] = poly_ptr->normal.z;
+		group_ptr->doubleSided[lane] = poly_ptr->double_sided ? -1 : 0;
+	}
+}
+
 //-----------------------------------------------------------------------------
 //	Create a collision mesh for a block.
 //-----------------------------------------------------------------------------
@@ -95,59 +134,104 @@ COL_convertBlockToColMesh(block *block_ptr)
 	block_def	*block_def_ptr;
 	int			i, j, k, n,
 				v[3],
-				numVerts,
-				numEdges, thisEdge,
-				numTris;
-	VEC3		meshMin, meshMax;
+				thisEdge;
 	COL_POLY3	*poly_ptr;
 	polygon		*polygon_ptr;
 	polygon_def	*polygon_def_ptr;
 	part		*part_ptr;
 
 
-	//------ Initialise the min/max box ----------------------------
-
-	VEC_set(&meshMin, 999999.0f, 999999.0f, 999999.0f);
-	VEC_set(&meshMax, -999999.0f, -999999.0f, -999999.0f);
-
-	
 	//------ Get the mesh data -------------------------------------
 
 	mesh_ptr = block_ptr->col_mesh_ptr;
-	numVerts = mesh_ptr->numVerts;
-	numEdges = mesh_ptr->numEdges;
-	numTris = mesh_ptr->numPolys;
 
 
-	// Compute the edge list for the solid polygons.
+	//------ Create the triangle topology ----------------------
 
+	i = 0;
 	thisEdge = 0;
 	block_def_ptr = block_ptr->block_def_ptr;
-	for (i = 0; i < block_def_ptr->polygons; i++) {
-		polygon_def_ptr = &block_def_ptr->polygon_def_list[i];
+	for (k = 0; k < block_def_ptr->polygons; k++) {
+		bool double_sided;
+
+		// Get a pointer to this polygon and it's part.  If this polygon is
+		// not solid, ignore it.
+
+		polygon_ptr = &block_ptr->polygon_list[k];
+		polygon_def_ptr = polygon_ptr->polygon_def_ptr;
 		part_ptr = polygon_def_ptr->part_ptr;
 		if (!part_ptr->solid)
 			continue;
 
+		// Determine whether or not the polygon is double-sided.
+
+		double_sided = block_def_ptr->part_list[polygon_def_ptr->part_no].faces 
+			!= 1;
+
+		//------ If this poly has more than three vertices -----
+		//------ then we need to tesselate it into tri's -------
+
+		v[0] = polygon_def_ptr->vertex_def_list[0].vertex_no;
+
 		for (n = 0; n < polygon_def_ptr->vertices - 2; n++) {
-			v[0] = polygon_def_ptr->vertex_def_list[0].vertex_no;
-			v[1] = polygon_def_ptr->vertex_def_list[n+1].vertex_no;
-			v[2] = polygon_def_ptr->vertex_def_list[n+2].vertex_no;
+			poly_ptr = &mesh_ptr->p[i];
+
+			// Set the polygon's double-sided flag.
+
+			poly_ptr->double_sided = double_sided;
+
+			v[1] = polygon_def_ptr->vertex_def_list[n + 1].vertex_no;
+			v[2] = polygon_def_ptr->vertex_def_list[n + 2].vertex_no;
 
 			for (j = 0; j < 3; j++) {
-				mesh_ptr->e[thisEdge].x = 
-					block_ptr->vertex_list[v[(j + 1) % 3]].x -
-					block_ptr->vertex_list[v[j]].x;
-				mesh_ptr->e[thisEdge].y = 
-					block_ptr->vertex_list[v[(j + 1) % 3]].y -
-					block_ptr->vertex_list[v[j]].y;
-				mesh_ptr->e[thisEdge].z = 
-					block_ptr->vertex_list[v[(j + 1) % 3]].z -
-					block_ptr->vertex_list[v[j]].z;
+				poly_ptr->vIdx[j] = v[j];
+				poly_ptr->edgeIdx[j] = thisEdge;
 				thisEdge++;
 			}
+
+			i++;
 		}
 	}
+	mesh_ptr->topologyBuilt = true;
+
+
+	//------ Now fill in the geometry --------------------------
+
+	COL_refitBlockColMesh(block_ptr);
+}
+
+//-----------------------------------------------------------------------------
+// Refit the collision mesh of a block to the block's current vertices.  The
+// triangles and edges must already have been built by
+// COL_convertBlockToColMesh; only the vertices, edge vectors, normals and
+// bounding boxes are recomputed, so this is cheap enough to do every time a
+// spinning or animated block changes.
+//-----------------------------------------------------------------------------
+
+void
+COL_refitBlockColMesh(block *block_ptr)
+{
+	COL_MESH	*mesh_ptr;
+	block_def	*block_def_ptr;
+	int			i, j, k, n;
+	VEC3		meshMin, meshMax,
+				*v0, *v1;
+	COL_POLY3	*poly_ptr;
+	polygon		*polygon_ptr;
+	polygon_def	*polygon_def_ptr;
+	part		*part_ptr;
+
+
+	//------ Initialise the min/max box ----------------------------
+
+	VEC_set(&meshMin, 999999.0f, 999999.0f, 999999.0f);
+	VEC_set(&meshMax, -999999.0f, -999999.0f, -999999.0f);
+
+	
+	//------ Get the mesh data -------------------------------------
+
+	mesh_ptr = block_ptr->col_mesh_ptr;
+	block_def_ptr = block_ptr->block_def_ptr;
 
 
 	//------ Copy the vertex data ------------------------------
@@ -158,15 +242,14 @@ COL_convertBlockToColMesh(block *block_ptr)
 		mesh_ptr->v[i].z = block_ptr->vertex_list[i].z;
 	}
 
-	//------ Create the polygon data ---------------------------
+
+	//------ Update the polygon data ---------------------------
 
 	i = 0;
-	thisEdge = 0;
 	for (k = 0; k < block_def_ptr->polygons; k++) {
-		bool double_sided;
 
 		// Get a pointer to this polygon and it's part.  If this polygon is
-		// not solid, ignore it.
+		// not solid, it has no triangles in the mesh.
 
 		polygon_ptr = &block_ptr->polygon_list[k];
 		polygon_def_ptr = polygon_ptr->polygon_def_ptr;
@@ -174,60 +257,48 @@ COL_convertBlockToColMesh(block *block_ptr)
 		if (!part_ptr->solid)
 			continue;
 
-		// Determine whether or not the polygon is double-sided.
-
-		double_sided = block_def_ptr->part_list[polygon_def_ptr->part_no].faces 
-			!= 1;
-
-		//------ If this poly has more than three vertices -----
-		//------ then we need to tesselate it into tri's -------
-
-		v[0] = polygon_def_ptr->vertex_def_list[0].vertex_no;
-
 		for (n = 0; n < polygon_def_ptr->vertices - 2; n++) {
 			poly_ptr = &mesh_ptr->p[i];
 
-			// Set the polygon's double-sided flag.
-
-			poly_ptr->double_sided = double_sided;
-
 			poly_ptr->normal.x = polygon_ptr->normal_vector.dx;
 			poly_ptr->normal.y = polygon_ptr->normal_vector.dy;
 			poly_ptr->normal.z = polygon_ptr->normal_vector.dz;
 
 			VEC_normalise(&poly_ptr->normal);
 
-			v[1] = polygon_def_ptr->vertex_def_list[n + 1].vertex_no;
-			v[2] = polygon_def_ptr->vertex_def_list[n + 2].vertex_no;
-
 			for (j = 0; j < 3; j++) {
-				poly_ptr->vIdx[j] = v[j];
-				poly_ptr->edgeIdx[j] = thisEdge;
-				thisEdge++;
+
+				//------ Compute the edge vector ---------------
+
+				v0 = &mesh_ptr->v[poly_ptr->vIdx[j]];
+				v1 = &mesh_ptr->v[poly_ptr->vIdx[(j + 1) % 3]];
+				mesh_ptr->e[poly_ptr->edgeIdx[j]].x = v1->x - v0->x;
+				mesh_ptr->e[poly_ptr->edgeIdx[j]].y = v1->y - v0->y;
+				mesh_ptr->e[poly_ptr->edgeIdx[j]].z = v1->z - v0->z;
 
 				if (j == 0) {
-					poly_ptr->min.x = block_ptr->vertex_list[v[0]].x;
-					poly_ptr->min.y = block_ptr->vertex_list[v[0]].y;
-					poly_ptr->min.z = block_ptr->vertex_list[v[0]].z;
+					poly_ptr->min.x = v0->x;
+					poly_ptr->min.y = v0->y;
+					poly_ptr->min.z = v0->z;
 
-					poly_ptr->max.x = block_ptr->vertex_list[v[0]].x;
-					poly_ptr->max.y = block_ptr->vertex_list[v[0]].y;
-					poly_ptr->max.z = block_ptr->vertex_list[v[0]].z;
+					poly_ptr->max.x = v0->x;
+					poly_ptr->max.y = v0->y;
+					poly_ptr->max.z = v0->z;
 				} else {
-					if (block_ptr->vertex_list[v[j]].x < poly_ptr->min.x)
-						poly_ptr->min.x = block_ptr->vertex_list[v[j]].x;
-					if (block_ptr->vertex_list[v[j]].x > poly_ptr->max.x)
-						poly_ptr->max.x = block_ptr->vertex_list[v[j]].x;
-
-					if (block_ptr->vertex_list[v[j]].y < poly_ptr->min.y)
-						poly_ptr->min.y = block_ptr->vertex_list[v[j]].y;
-					if (block_ptr->vertex_list[v[j]].y > poly_ptr->max.y)
-						poly_ptr->max.y = block_ptr->vertex_list[v[j]].y;
-
-					if (block_ptr->vertex_list[v[j]].z < poly_ptr->min.z)
-						poly_ptr->min.z = block_ptr->vertex_list[v[j]].z;
-					if (block_ptr->vertex_list[v[j]].z > poly_ptr->max.z)
-						poly_ptr->max.z = block_ptr->vertex_list[v[j]].z;
+					if (v0->x < poly_ptr->min.x)
+						poly_ptr->min.x = v0->x;
+					if (v0->x > poly_ptr->max.x)
+						poly_ptr->max.x = v0->x;
+
+					if (v0->y < poly_ptr->min.y)
+						poly_ptr->min.y = v0->y;
+					if (v0->y > poly_ptr->max.y)
+						poly_ptr->max.y = v0->y;
+
+					if (v0->z < poly_ptr->min.z)
+						poly_ptr->min.z = v0->z;
+					if (v0->z > poly_ptr->max.z)
+						poly_ptr->max.z = v0->z;
 				}
 			}
 
@@ -274,6 +345,10 @@ COL_convertBlockToColMesh(block *block_ptr)
 	mesh_ptr->maxBox.x = meshMax.x;
 	mesh_ptr->maxBox.y = meshMax.y;
 	mesh_ptr->maxBox.z = meshMax.z;
+
+	//------ Pack the polygons for the rejection tests ---------
+
+	COL_packColMeshPolys(mesh_ptr);
 }
 
 //-----------------------------------------------------------------------------
@@ -317,6 +392,11 @@ COL_convertSpriteToColMesh(COL_MESH *mesh_ptr, float minX, float minY,
 	numVerts = 8;
 	numEdges = numTris * 3;
 
+	//------ This isn't a block's topology, so it can't be -----
+	//------ refitted ------------------------------------------
+
+	mesh_ptr->topologyBuilt = false;
+
 	//------ Set the 8 vertices --------------------------------
 
 	v[0].x = minX;
@@ -538,4 +618,8 @@ COL_convertSpriteToColMesh(COL_MESH *mesh_ptr, float minX, float minY,
 	mesh_ptr->maxBox.x = meshMax.x;
 	mesh_ptr->maxBox.y = meshMax.y;
 	mesh_ptr->maxBox.z = meshMax.z;
+
+	//------ Pack the polygons for the rejection tests ---------
+
+	COL_packColMeshPolys(mesh_ptr);
 }
\ No newline at end of file
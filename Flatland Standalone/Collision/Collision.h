@@ -21,7 +21,7 @@
 
 --------------------------------------------------------------*/
 
-#include "col.h"
+#include "Col.h"
 struct block;
 struct block_def;
 
@@ -52,6 +52,9 @@ COL_createBlockColMesh(block *block_ptr);
 void 
 COL_convertBlockToColMesh(block *block_ptr);
 
+void
+COL_refitBlockColMesh(block *block_ptr);
+
 bool
 COL_createSpriteColMesh(block *block_ptr);
 
@@ -10,8 +10,8 @@
 --------------------------------------------------------------*/
 
 #include <math.h>
-#include "mat.h"
-#include "maths.h"
+#include "Mat.h"
+#include "Maths.h"
 
 
 /*--------------------------------------------------------------
@@ -12,7 +12,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
-#include "maths.h"
+#include "Maths.h"
 #include "../Classes.h"
 #include "../Memory.h"
 
@@ -9,8 +9,8 @@
 
 --------------------------------------------------------------*/
 
-#include "vec.h"
-#include "maths.h"
+#include "Vec.h"
+#include "Maths.h"
 
 
 /*--------------------------------------------------------------
@@ -12,7 +12,7 @@
 
 --------------------------------------------------------------*/
 
-#include "mat.h"
+#include "Mat.h"
 
 /*--------------------------------------------------------------
 
@@ -8,8 +8,6 @@
 #include <string.h>
 #include <limits.h>
 #include <math.h>
-#include <direct.h>
-#include <io.h>
 #include "Classes.h"
 #include "Fileio.h"
 #include "Image.h"
@@ -19,6 +17,7 @@
 #include "Parser.h"
 #include "Platform.h"
 #include "Plugin.h"
+#include "Portable.h"
 #include "Render.h"
 #include "Spans.h"
 #include "Tags.h"
@@ -655,7 +654,7 @@ parse_part_tag(blockset *blockset_ptr, block_def *block_def_ptr)
 	part_ptr = part_list;
 	while (part_ptr != NULL) {
 		if (!_stricmp(part_name, part_ptr->name))
-			error("Duplicate part name \"%s\"", part_name);
+			error("Duplicate part name \"%s\"", (char *)part_name);
 		part_ptr = part_ptr->next_part_ptr;
 	}
 
@@ -1058,7 +1057,7 @@ parse_point_light_tag(light *&light_list, light *&last_light_ptr, bool allow_rep
 	else {
 		if (strlen(light_name) > 0 && 
 			find_light(light_list, light_name) != NULL) {
-			warning("Duplicate light with name \"%s\"", light_name);
+			warning("Duplicate light with name \"%s\"", (char *)light_name);
 			return(NULL);
 		}
 		light_ptr = NULL;
@@ -1183,7 +1182,7 @@ parse_popup_tag(popup *&popup_list, popup *&last_popup_ptr, bool allow_replaceme
 	else {
 		if (strlen(popup_name) > 0 && 
 			find_popup(popup_list, popup_name) != NULL) {
-			warning("duplicate popup with name \"%s\"", popup_name);
+			warning("duplicate popup with name \"%s\"", (char *)popup_name);
 			return(NULL);
 		}
 		popup_ptr = NULL;
@@ -1260,7 +1259,7 @@ parse_popup_tag(popup *&popup_list, popup *&last_popup_ptr, bool allow_replaceme
 	if (parsed_attribute[POPUP_IMAGEMAP]) {
 		popup_ptr->imagemap_name = popup_imagemap;
 		if ((popup_ptr->imagemap_ptr = find_imagemap(popup_imagemap)) == NULL)
-			warning("There is no imagemap with name \"%s\"", popup_imagemap);
+			warning("There is no imagemap with name \"%s\"", (char *)popup_imagemap);
 	}
 
 	// Initialise the popup with whatever additional optional parameters were 
@@ -1322,7 +1321,7 @@ parse_sound_tag(sound *&sound_list, sound *&last_sound_ptr, bool allow_replaceme
 		if (sound_ptr != NULL && sound_ptr->wave_ptr == NULL &&
 			!parsed_attribute[SOUND_FILE]) {
 			warning("sound with name \"%s\" does not have a wave file assigned, "
-				"and there is no <I>file</I> attribute present", sound_name);
+				"and there is no <I>file</I> attribute present", (char *)sound_name);
 			return(NULL);
 		}
 	}
@@ -1335,7 +1334,7 @@ parse_sound_tag(sound *&sound_list, sound *&last_sound_ptr, bool allow_replaceme
 	else {
 		if (strlen(sound_name) > 0 && 
 			find_sound(sound_list, sound_name) != NULL) {
-			warning("duplicate sound with name \"%s\"", sound_name);
+			warning("duplicate sound with name \"%s\"", (char *)sound_name);
 			return(NULL);
 		}
 		sound_ptr = NULL;
@@ -1346,7 +1345,7 @@ parse_sound_tag(sound *&sound_list, sound *&last_sound_ptr, bool allow_replaceme
 
 	if (parsed_attribute[SOUND_FILE]) {
 		if ((wave_ptr = load_wave(blockset_ptr, sound_file)) == NULL) {
-			warning("Unable to download wave file from %s", sound_file);
+			warning("Unable to download wave file from %s", (char *)sound_file);
 			return(NULL);
 		}
 	}
@@ -1447,7 +1446,7 @@ parse_spot_light_tag(light *&light_list,  light *&last_light_ptr, bool allow_rep
 	else {
 		if (strlen(light_name) > 0 && 
 			find_light(light_list, light_name) != NULL) {
-			warning("duplicate light with name \"%s\"", light_name);
+			warning("duplicate light with name \"%s\"", (char *)light_name);
 			return(NULL);
 		}
 		light_ptr = NULL;
@@ -1699,7 +1698,7 @@ parse_block_tag(blockset *blockset_ptr)
 	file_path += style_block_file;
 	if (!push_zip_file(file_path, true))
 		error("Unable to open block file %s in the %s blockset", 
-			style_block_file, blockset_ptr->name);
+			(char *)style_block_file, (char *)blockset_ptr->name);
 
 	// Create a new block definition.  If we're out of memory, ignore this
 	// block.
@@ -1878,7 +1877,7 @@ parse_placeholder_tag(blockset *blockset_ptr)
 	if ((texture_ptr = load_texture(blockset_ptr, placeholder_texture, false)) == NULL || 
 		(texture_ptr->blockset_ptr == NULL && (!download_URL(texture_ptr->URL, NULL, false) ||
 		 !load_image(texture_ptr->URL, curr_file_path, texture_ptr)))) {
-		warning("Unable to download placeholder texture from %s", placeholder_texture);
+		warning("Unable to download placeholder texture from %s", (char *)placeholder_texture);
 		if (texture_ptr != NULL)
 			DEL(texture_ptr, texture);
 		return;
@@ -1950,7 +1949,7 @@ parse_skybox_tag(blockset *blockset_ptr)
 		for (int i = 0; i < 6; i++) {
 			if (!parsed_attribute[SKYBOX_LEFT + i]) {
 				got_all_attributes = false;
-				warning("Missing <I>%s</I> attribute in <I>skybox</I> tag", skybox_sides[i]);
+				warning("Missing <I>%s</I> attribute in <I>skybox</I> tag", (char *)skybox_sides[i]);
 			}
 		}
 		if (got_all_attributes) {
@@ -2013,7 +2012,7 @@ parse_ambient_sound_tag(void)
 
 	if ((wave_ptr = load_wave(custom_blockset_ptr, ambient_sound_file)) == 
 		NULL) {
-		warning("Unable to download wave from URL %s", ambient_sound_file);
+		warning("Unable to download wave from URL %s", (char *)ambient_sound_file);
 		return;
 	}
 
@@ -2092,13 +2091,13 @@ parse_blockset(char *blockset_URL, bool show_title)
 	// Set the title to reflect we're trying to load a blockset, if requested.
 
 	if (show_title) {
-		set_title("Loading %s blockset", blockset_name);
+		set_title("Loading %s blockset", (char *)blockset_name);
 	}
 
 	// Open the blockset.
 
 	if (!open_blockset(blockset_URL, blockset_name)) {
-		warning("Unable to open the %s blockset with URL %s", blockset_name, blockset_URL);
+		warning("Unable to open the %s blockset with URL %s", (char *)blockset_name, (char *)blockset_URL);
 		return NULL;
 	}
 
@@ -2108,7 +2107,7 @@ parse_blockset(char *blockset_URL, bool show_title)
 	style_file_name = blockset_name;
 	style_file_name += ".style";
 	if (!push_zip_file(style_file_name, true)) {
-		warning("Unable to open %s from the %s blockset", style_file_name, blockset_name);
+		warning("Unable to open %s from the %s blockset", (char *)style_file_name, (char *)blockset_name);
 		return NULL;
 	}
 
@@ -2180,7 +2179,7 @@ parse_blockset_tag(void)
 
 	ext_ptr = strrchr(blockset_href, '.');
 	if (ext_ptr == NULL || _stricmp(ext_ptr, ".bset")) {
-		warning("URL %s is not a blockset", blockset_href);
+		warning("URL %s is not a blockset", (char *)blockset_href);
 		return;
 	}
 
@@ -3472,6 +3471,21 @@ insert_missing_level_tags(int first_level_number, int last_level_number)
 	}
 }
 
+//------------------------------------------------------------------------------
+// Set the block symbol of a square on the map, creating the chunk of the map
+// that holds it if necessary.
+//------------------------------------------------------------------------------
+
+static void
+set_square_symbol(int column, int row, int level, word block_symbol)
+{
+	square *square_ptr;
+
+	if ((square_ptr = world_ptr->get_square_ptr(column, row, level)) == NULL)
+		memory_error("square map");
+	square_ptr->curr_block_symbol = block_symbol;
+}
+
 //------------------------------------------------------------------------------
 // Parse the level tag.
 //------------------------------------------------------------------------------
@@ -3484,7 +3498,6 @@ parse_level_tag(void)
 	char ch1, ch2;
 	int max_level_number;
 	int column, row, level;
-	square *row_ptr;
 
 	// If the number parameter was not given, use the last level number + 1, and add the number attribute to the tag.
 
@@ -3541,13 +3554,11 @@ parse_level_tag(void)
 		while (ch1 == ' ' || ch1 == '\t')
 			ch1 = *++line_ptr;
 		
-		// Get a pointer to the row in the map.
-
-		row_ptr = world_ptr->get_square_ptr(0, row, level);
-
 		// Parse the block single or double character symbols in this row,
 		// until the expected number of symbols have been parsed or the end of
-		// the line has been reached.  Whitespace is ignored.
+		// the line has been reached.  Whitespace is ignored, and only squares
+		// with a symbol other than the NULL block symbol are stored, so that
+		// the chunks of the map that are empty are never allocated.
 
 		column = 0;
 		switch (world_ptr->map_style) {
@@ -3555,9 +3566,8 @@ parse_level_tag(void)
 			while (ch1 != '\0' && ch1 != '\n' && column < world_ptr->columns) {
 				if (not_single_symbol(ch1, false))
 					warning("Symbol at location (%d, %d, %d) was invalid", column + 1, row + 1, level_number);
-				else
-					row_ptr->curr_block_symbol = ch1;
-				row_ptr++;
+				else if (ch1 != NULL_BLOCK_SYMBOL)
+					set_square_symbol(column, row, level, ch1);
 				column++;
 				ch1 = *++line_ptr;
 				while (ch1 == ' ' || ch1 == '\t')
@@ -3574,11 +3584,11 @@ parse_level_tag(void)
 						ch1 = ch2;
 						break;
 					}
-				} else if (ch1 == '.')
-					row_ptr->curr_block_symbol = ch2;
-				else	
-					row_ptr->curr_block_symbol = (ch1 << 7) + ch2;
-				row_ptr++;
+				} else if (ch1 == '.') {
+					if (ch2 != NULL_BLOCK_SYMBOL)
+						set_square_symbol(column, row, level, ch2);
+				} else	
+					set_square_symbol(column, row, level, (ch1 << 7) + ch2);
 				column++;
 				ch1 = *++line_ptr;
 				while (ch1 == ' ' || ch1 == '\t')
@@ -3870,10 +3880,10 @@ parse_next_create_tag(int tag_token, tag_def *create_tag_list,
 			if (custom_block_def_ptr->allow_entrance) {
 				parse_entrance_tag(&custom_block_def_ptr->entrance_ptr);
 			} else {
-				warning("Block with name \"%s\" does not permit an entrance", custom_block_def_ptr->name);
+				warning("Block with name \"%s\" does not permit an entrance", (char *)custom_block_def_ptr->name);
 			}
 		} else {
-			warning("Duplicate entrance tag in block with name \"%s\"", custom_block_def_ptr->name);
+			warning("Duplicate entrance tag in block with name \"%s\"", (char *)custom_block_def_ptr->name);
 		}
 		break;
 
@@ -3883,7 +3893,7 @@ parse_next_create_tag(int tag_token, tag_def *create_tag_list,
 			custom_block_def_ptr->custom_exit = true;
 			parse_exit_tag(custom_block_def_ptr->exit_ptr);
 		} else {
-			warning("Duplicate exit tag in block with name \"%s\"", custom_block_def_ptr->name);
+			warning("Duplicate exit tag in block with name \"%s\"", (char *)custom_block_def_ptr->name);
 		}
 		break;
 
@@ -3930,11 +3940,11 @@ parse_next_create_tag(int tag_token, tag_def *create_tag_list,
 			// Download and open the file specified in the HREF attribute.
 
 			if (!download_URL(import_href, NULL, true)) {
-				warning("Unable to import file from URL %s", import_href);
+				warning("Unable to import file from URL %s", (char *)import_href);
 				break;
 			}
 			if (!push_file(curr_file_path, import_href, true)) {
-				warning("Unable to open file %s", curr_file_path);
+				warning("Unable to open file %s", (char *)curr_file_path);
 				break;
 			}
 
@@ -3977,22 +3987,22 @@ parse_create_tag(void)
 
 	if (string_to_single_symbol(create_block, &single_symbol, true)) {
 		if (world_ptr->map_style == DOUBLE_MAP && min_rover_version >= 0x03000000) {
-			warning("Expected a double-character symbol rather than \"%s\"", create_block);
+			warning("Expected a double-character symbol rather than \"%s\"", (char *)create_block);
 			return;
 		} else if ((block_def_ptr = get_block_def(single_symbol)) == NULL) {
-			warning("There is no block with single symbol \"%s\"", create_block);
+			warning("There is no block with single symbol \"%s\"", (char *)create_block);
 			return;
 		}
 	} else if (string_to_double_symbol(create_block, &double_symbol, true)) {
 		if (world_ptr->map_style == SINGLE_MAP && min_rover_version >= 0x03000000) {
-			warning("Expected a single-character symbol rather than \"%s\"", create_block);
+			warning("Expected a single-character symbol rather than \"%s\"", (char *)create_block);
 			return;
 		} else if ((block_def_ptr = get_block_def(double_symbol)) == NULL) {
-			warning("There is no block with double symbol \"%s\"", create_block);
+			warning("There is no block with double symbol \"%s\"", (char *)create_block);
 			return;
 		}
 	} else if ((block_def_ptr = get_block_def(create_block)) == NULL) {
-		warning("There is no block with name \"%s\"", create_block);
+		warning("There is no block with name \"%s\"", (char *)create_block);
 		return;
 	}
 
@@ -4132,11 +4142,11 @@ parse_next_body_tag(int tag_token, bool allow_import_tag)
 			// Download and open the file specified in the HREF attribute.
 
 			if (!download_URL(import_href, NULL, true)) {
-				warning("Unable to import file from URL %s", import_href);
+				warning("Unable to import file from URL %s", (char *)import_href);
 				break;
 			}
 			if (!push_file(curr_file_path, import_href, true)) {
-				warning("Unable to open file %s", curr_file_path);
+				warning("Unable to open file %s", (char *)curr_file_path);
 				break;
 			}
 
@@ -4385,10 +4395,8 @@ parse_body_tags(void)
 
 	if (world_ptr->ground_level_exists)
 		for (int row = 0; row < world_ptr->rows; row++)
-			for (int column = 0; column < world_ptr->columns; column++) {
-				square *square_ptr = world_ptr->get_square_ptr(column, row, 0);
-				square_ptr->curr_block_symbol = GROUND_BLOCK_SYMBOL;
-			}
+			for (int column = 0; column < world_ptr->columns; column++)
+				set_square_symbol(column, row, 0, GROUND_BLOCK_SYMBOL);
 
 	// Initialise some state variables.
 
@@ -4590,7 +4598,7 @@ parse_spot_file()
 
 			if (!push_zip_file_with_ext(".3dml", true)) {
 				close_zip_archive();
-				error("Unable to open a 3DML file inside zip file %s", curr_spot_URL);
+				error("Unable to open a 3DML file inside zip file %s", (char *)curr_spot_URL);
 			}
 
 			// Close the zip archive; the spot file has already been read into a
@@ -4602,7 +4610,7 @@ parse_spot_file()
 		// Otherwise open the spot file as an ordinary text file.
 
 		else if (!push_file(curr_file_path, curr_spot_URL, true))
-			error("Unable to open 3DML file %s", curr_spot_URL);
+			error("Unable to open 3DML file %s", (char *)curr_spot_URL);
 	}
 
 	// If there is not a current spot URL, we are loading a string as a new spot.
@@ -4825,39 +4833,37 @@ save_spot_file(const char *spot_file_path)
 			*map_level_ptr++ = '\t';
 			*map_level_ptr++ = '\t';
 
-			// Get a pointer to the first square of the row in the map, and output a row of single or double symbols
-
-			square *square_ptr = world_ptr->get_square_ptr(0, row, level);
-
-			// Output a row of single or double symbols into the new map text.
+			// Output a row of single or double symbols into the new map text.  Squares in chunks that
+			// were never allocated are empty.
 
 			for (int column = 0; column < world_ptr->columns; column++) {
+				square *square_ptr = world_ptr->find_square_ptr(column, row, level);
+				word block_symbol = square_ptr != NULL ? square_ptr->curr_block_symbol : NULL_BLOCK_SYMBOL;
 				if (world_ptr->map_style == DOUBLE_MAP && column > 0) {
 					*map_level_ptr++ = ' ';
 				}
 				switch (world_ptr->map_style) {
 				case SINGLE_MAP:
-					*map_level_ptr++ = (char)square_ptr->curr_block_symbol;
+					*map_level_ptr++ = (char)block_symbol;
 					break;
 				case DOUBLE_MAP:
 					{
-						char ch = (char)(square_ptr->curr_block_symbol >> 7);
+						char ch = (char)(block_symbol >> 7);
 						*map_level_ptr++ = ch == 0 ? '.' : ch;
-						*map_level_ptr++ = (char)(square_ptr->curr_block_symbol & 127);
+						*map_level_ptr++ = (char)(block_symbol & 127);
 					}
 				}
 
 				// Look up the block definition for this symbol, and if its a custom exact duplicate mark it as
 				// referenced.  Also mark the blockset of the block definition as referenced.
 
-				block_def_ptr = block_symbol_table[square_ptr->curr_block_symbol];
+				block_def_ptr = block_symbol_table[block_symbol];
 				if (block_def_ptr) {
 					if (block_def_ptr->custom && block_def_ptr->exact_duplicate) {
 						block_def_ptr->referenced = true;
 					}
 					block_def_ptr->blockset_ptr->referenced = true;
 				}
-				square_ptr++;
 			}
 			*map_level_ptr++ = '\n';
 	
@@ -5069,6 +5075,9 @@ load_config_file(void)
 	int visible_block_radius_value;
 	int curr_move_rate_value, curr_turn_rate_value;
 	int force_software_rendering_value;
+	int render_thread_count_value;
+	int texture_cache_size_value;
+	int texel_shading_value;
 	float brightness_value;
 
 	// Initialise the configuration options with their default values.
@@ -5079,6 +5088,9 @@ load_config_file(void)
 	curr_turn_rate_value = DEFAULT_TURN_RATE;
 	min_blockset_update_period = SECONDS_PER_WEEK;
 	force_software_rendering_value = 0;
+	render_thread_count_value = 0;
+	texture_cache_size_value = DEFAULT_TEXTURE_CACHE_SIZE;
+	texel_shading_value = 0;
 	brightness_value = 0.0f;
 
 	// First attempt to parse the configuration file.
@@ -5102,6 +5114,12 @@ load_config_file(void)
 					read_config_bool(value, &force_software_rendering_value);
 				else if (!_stricmp(name, "brightness"))
 					read_config_float(value, &brightness_value);
+				else if (!_stricmp(name, "render threads"))
+					read_config_int(value, &render_thread_count_value);
+				else if (!_stricmp(name, "texture cache size"))
+					read_config_int(value, &texture_cache_size_value);
+				else if (!_stricmp(name, "shade textures per texel"))
+					read_config_bool(value, &texel_shading_value);
 			}
 		fclose(fp);
 	}
@@ -5114,6 +5132,9 @@ load_config_file(void)
 	curr_turn_rate.set(curr_turn_rate_value);
 	force_software_rendering.set(force_software_rendering_value ? true : false);
 	master_brightness.set(brightness_value / 100.0f);
+	render_thread_count.set(render_thread_count_value);
+	texture_cache_size.set(texture_cache_size_value);
+	texel_shading.set(texel_shading_value ? true : false);
 }
 
 //------------------------------------------------------------------------------
@@ -5175,6 +5196,9 @@ save_config_file(void)
 		write_config_int(fp, "minimum blockset update period", min_blockset_update_period / SECONDS_PER_DAY, "days");
 		write_config_bool(fp, "force software rendering", force_software_rendering.get());
 		write_config_float(fp, "brightness", master_brightness.get() * 100.0f, "% relative to ambient light");
+		write_config_int(fp, "render threads", render_thread_count.get(), "threads (0 = one per processor)");
+		write_config_int(fp, "texture cache size", texture_cache_size.get(), "megabytes (0 = only what each frame needs)");
+		write_config_bool(fp, "shade textures per texel", texel_shading.get());
 		fclose(fp);
 	}
 }
@@ -5247,7 +5271,7 @@ new_cached_blockset(const char *path, const char *href, int size, time_t updated
 	// Extract the blockset file name, replace the ".bset" extension with
 	// ".style" to obtain the style file name.
 
-	name_ptr = strrchr(path, '\\');
+	name_ptr = strrchr(path, PATH_SEPARATOR);
 	name = name_ptr + 1;
 	ext_ptr = strrchr(name, '.');
 	name.truncate(ext_ptr - (char *)name);
@@ -5445,7 +5469,7 @@ find_cached_blocksets(const char *dir_path)
 		if (file_info.attrib & _A_SUBDIR) {
 			path = dir_path;
 			path += file_info.name;
-			path += "\\";
+			path += PATH_SEPARATOR_STRING;
 			find_cached_blocksets(path);
 		}
 
@@ -5606,7 +5630,7 @@ check_for_blockset_update(const char *version_file_URL,
 	if (blockset_version_id > blockset_version && 
 		query("New version of blockset available", true, 
 			"Version %s of the %s blockset is available for download.\n\n%s\n\nWould you like to download it now?", 
-			(char *)version_number_to_string(blockset_version_id), blockset_name, message))
+			(char *)version_number_to_string(blockset_version_id), (char *)blockset_name, (char *)message))
 		return(true);
 
 	// Indicate no update is available or requested.
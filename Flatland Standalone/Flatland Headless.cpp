@@ -0,0 +1,474 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Command-line runner for the headless platform in Posix.cpp.  It loads a
+// spot, moves the player along a scripted camera path, optionally dumps the
+// rendered frames as PPM images and the spans of the last frame, and reports
+// how long each frame took.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "Classes.h"
+#include "Platform.h"
+#include "Plugin.h"
+#include "Spans.h"
+
+//------------------------------------------------------------------------------
+// Local definitions.
+//------------------------------------------------------------------------------
+
+// Default settings.
+
+#define DEFAULT_FRAMES			300
+#define DEFAULT_TIME_STEP_MS	33
+#define DEFAULT_TIMEOUT_SECS	60
+
+// A segment of the camera path: the player moves with the given deltas
+// (in the range -1 to 1, as if the movement keys were held down) for the
+// given number of frames.
+
+struct path_segment {
+	int frames;
+	float move_delta, side_delta, turn_delta, look_delta;
+};
+
+// Command line settings.
+
+static const char *spot_file_path;
+static const char *path_file_path;
+static const char *dump_dir_path;
+static const char *timing_file_path;
+static const char *span_file_path;
+static int dump_every;
+static int window_width_arg, window_height_arg;
+static int time_step_ms_arg;
+static int timeout_secs;
+static int requested_frames;
+
+// The camera path, and the total number of frames it covers.
+
+static path_segment *path_segment_list;
+static int path_segments;
+static int total_frames;
+
+// The current path segment, and the frame it ends on.
+
+static int curr_segment_index;
+static int curr_segment_end_frame;
+
+// Number of frames displayed so far, the time the last one was displayed,
+// and the time each frame took to render (the time between it and the
+// previous frame being displayed).
+
+static int frames_displayed;
+static std::chrono::steady_clock::time_point last_frame_time;
+static float *frame_time_list;
+
+// The file the spans of the last frame are written to.
+
+static FILE *span_fp;
+
+//------------------------------------------------------------------------------
+// Display the usage message.
+//------------------------------------------------------------------------------
+
+static void
+usage(const char *program_name)
+{
+	fprintf(stderr,
+		"Usage: %s [options] spot-file\n"
+		"  -w width     Width of the frame buffer (default 640)\n"
+		"  -h height    Height of the frame buffer (default 480)\n"
+		"  -p path-file Camera path, one \"frames move side turn look\" per line\n"
+		"  -f frames    Frames to render if there is no camera path (default %d)\n"
+		"  -d dir       Directory to dump frames into, as PPM images\n"
+		"  -e n         Only dump every nth frame (default 1)\n"
+		"  -s ms        Fixed time step per frame, or 0 for real time (default %d)\n"
+		"  -t secs      Give up if no frame is rendered for this long (default %d)\n"
+		"  -c csv-file  File to write the time taken by each frame to\n"
+		"  -r span-file File to write the spans added in the last frame to\n",
+		program_name, DEFAULT_FRAMES, DEFAULT_TIME_STEP_MS, DEFAULT_TIMEOUT_SECS);
+}
+
+//------------------------------------------------------------------------------
+// Parse the command line, returning FALSE if it's invalid.
+//------------------------------------------------------------------------------
+
+static bool
+parse_command_line(int argc, char *argv[])
+{
+	int index;
+	char option;
+	const char *value;
+
+	window_width_arg = 0;
+	window_height_arg = 0;
+	requested_frames = DEFAULT_FRAMES;
+	dump_every = 1;
+	time_step_ms_arg = DEFAULT_TIME_STEP_MS;
+	timeout_secs = DEFAULT_TIMEOUT_SECS;
+	for (index = 1; index < argc; index++) {
+
+		// The only argument that isn't an option is the spot file path.
+
+		if (argv[index][0] != '-') {
+			if (spot_file_path != NULL)
+				return(false);
+			spot_file_path = argv[index];
+			continue;
+		}
+
+		// Every option takes a value.
+
+		if (argv[index][1] == '\0' || argv[index][2] != '\0' || index + 1 == argc)
+			return(false);
+		option = argv[index][1];
+		value = argv[++index];
+		switch (option) {
+		case 'w':
+			window_width_arg = atoi(value);
+			break;
+		case 'h':
+			window_height_arg = atoi(value);
+			break;
+		case 'p':
+			path_file_path = value;
+			break;
+		case 'f':
+			requested_frames = atoi(value);
+			break;
+		case 'd':
+			dump_dir_path = value;
+			break;
+		case 'e':
+			dump_every = atoi(value);
+			break;
+		case 's':
+			time_step_ms_arg = atoi(value);
+			break;
+		case 't':
+			timeout_secs = atoi(value);
+			break;
+		case 'c':
+			timing_file_path = value;
+			break;
+		case 'r':
+			span_file_path = value;
+			break;
+		default:
+			return(false);
+		}
+	}
+
+	// Check the settings are sensible.
+
+	return(spot_file_path != NULL && window_width_arg >= 0 &&
+		window_height_arg >= 0 && requested_frames > 0 && dump_every > 0 &&
+		time_step_ms_arg >= 0 && timeout_secs >= 0);
+}
+
+//------------------------------------------------------------------------------
+// Load the camera path from a file.  Blank lines and lines beginning with '#'
+// are ignored.
+//------------------------------------------------------------------------------
+
+static bool
+load_camera_path(const char *file_path)
+{
+	FILE *fp;
+	char line[BUFSIZ];
+	char *line_ptr;
+	int line_no, max_segments;
+	path_segment segment, *new_segment_list;
+
+	if ((fp = fopen(file_path, "r")) == NULL) {
+		fprintf(stderr, "Unable to open camera path file %s\n", file_path);
+		return(false);
+	}
+	max_segments = 0;
+	line_no = 0;
+	while (fgets(line, BUFSIZ, fp) != NULL) {
+		line_no++;
+
+		// Skip blank lines and comments.
+
+		line_ptr = line;
+		while (*line_ptr == ' ' || *line_ptr == '\t')
+			line_ptr++;
+		if (*line_ptr == '#' || *line_ptr == '\n' || *line_ptr == '\r' ||
+			*line_ptr == '\0')
+			continue;
+
+		// Parse the segment.
+
+		if (sscanf(line_ptr, "%d %f %f %f %f", &segment.frames,
+			&segment.move_delta, &segment.side_delta, &segment.turn_delta,
+			&segment.look_delta) != 5 || segment.frames <= 0) {
+			fprintf(stderr, "Invalid camera path segment on line %d of %s\n",
+				line_no, file_path);
+			fclose(fp);
+			return(false);
+		}
+
+		// Add the segment to the path, growing the list as required.
+
+		if (path_segments == max_segments) {
+			max_segments = max_segments == 0 ? 16 : max_segments * 2;
+			if ((new_segment_list = (path_segment *)realloc(path_segment_list,
+				max_segments * sizeof(path_segment))) == NULL) {
+				fclose(fp);
+				return(false);
+			}
+			path_segment_list = new_segment_list;
+		}
+		path_segment_list[path_segments++] = segment;
+		total_frames += segment.frames;
+	}
+	fclose(fp);
+	if (path_segments == 0) {
+		fprintf(stderr, "Camera path file %s has no segments\n", file_path);
+		return(false);
+	}
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Create a stationary camera path for the requested number of frames.
+//------------------------------------------------------------------------------
+
+static bool
+create_stationary_camera_path(int frames)
+{
+	if ((path_segment_list = (path_segment *)malloc(sizeof(path_segment))) == NULL)
+		return(false);
+	path_segment_list->frames = frames;
+	path_segment_list->move_delta = 0.0f;
+	path_segment_list->side_delta = 0.0f;
+	path_segment_list->turn_delta = 0.0f;
+	path_segment_list->look_delta = 0.0f;
+	path_segments = 1;
+	total_frames = frames;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Dump a frame as a binary PPM image.
+//------------------------------------------------------------------------------
+
+static void
+dump_frame(byte *frame_buffer_ptr, int row_pitch, int frame_no)
+{
+	char file_path[BUFSIZ];
+	FILE *fp;
+	byte *row_ptr;
+	pixel *pixel_ptr;
+	pixel frame_pixel;
+	byte rgb[3];
+	int row, col;
+
+	snprintf(file_path, BUFSIZ, "%s/frame%05d.ppm", dump_dir_path, frame_no);
+	if ((fp = fopen(file_path, "wb")) == NULL) {
+		fprintf(stderr, "Unable to create frame file %s\n", file_path);
+		return;
+	}
+	fprintf(fp, "P6\n%d %d\n255\n", window_width, window_height);
+	row_ptr = frame_buffer_ptr;
+	for (row = 0; row < window_height; row++) {
+		pixel_ptr = (pixel *)row_ptr;
+		for (col = 0; col < window_width; col++) {
+			frame_pixel = *pixel_ptr++;
+			rgb[0] = (byte)(frame_pixel >> 16);
+			rgb[1] = (byte)(frame_pixel >> 8);
+			rgb[2] = (byte)frame_pixel;
+			fwrite(rgb, 1, 3, fp);
+		}
+		row_ptr += row_pitch;
+	}
+	fclose(fp);
+}
+
+//------------------------------------------------------------------------------
+// Called by the platform on the player thread after each frame is rendered.
+// The frame time is recorded, the frame is dumped if requested, and the
+// movement deltas are set for the next frame.
+//------------------------------------------------------------------------------
+
+static void
+frame_callback(byte *frame_buffer_ptr, int row_pitch)
+{
+	std::chrono::steady_clock::time_point curr_frame_time;
+	path_segment *segment_ptr;
+
+	// Ignore any frames rendered after the end of the camera path, while the
+	// app is shutting down.
+
+	if (frames_displayed >= total_frames)
+		return;
+
+	// Record the time since the previous frame.  The first frame has nothing
+	// to be measured against, so it isn't timed.
+
+	curr_frame_time = std::chrono::steady_clock::now();
+	if (frames_displayed > 0)
+		frame_time_list[frames_displayed - 1] =
+			std::chrono::duration<float, std::milli>(curr_frame_time -
+			last_frame_time).count();
+	last_frame_time = curr_frame_time;
+
+	// Dump the frame if requested.
+
+	if (dump_dir_path != NULL && frames_displayed % dump_every == 0)
+		dump_frame(frame_buffer_ptr, row_pitch, frames_displayed);
+
+	// If the end of the camera path has been reached, stop writing spans and
+	// quit.  If the next frame is the last one, start writing its spans.
+
+	if (++frames_displayed >= total_frames) {
+		if (span_fp != NULL)
+			stop_span_stream();
+		request_quit(0);
+		return;
+	}
+	if (span_fp != NULL && frames_displayed == total_frames - 1)
+		start_span_stream(span_fp);
+
+	// Step to the path segment covering the next frame, and set the movement
+	// deltas.
+
+	while (frames_displayed >= curr_segment_end_frame &&
+		curr_segment_index < path_segments - 1) {
+		curr_segment_index++;
+		curr_segment_end_frame += path_segment_list[curr_segment_index].frames;
+	}
+	segment_ptr = &path_segment_list[curr_segment_index];
+	curr_move_delta.set(segment_ptr->move_delta);
+	curr_side_delta.set(segment_ptr->side_delta);
+	curr_turn_delta.set(segment_ptr->turn_delta);
+	curr_look_delta.set(segment_ptr->look_delta);
+}
+
+//------------------------------------------------------------------------------
+// Comparison function for sorting frame times.
+//------------------------------------------------------------------------------
+
+static int
+compare_frame_times(const void *time1_ptr, const void *time2_ptr)
+{
+	float time1 = *(const float *)time1_ptr;
+	float time2 = *(const float *)time2_ptr;
+	return(time1 < time2 ? -1 : (time1 > time2 ? 1 : 0));
+}
+
+//------------------------------------------------------------------------------
+// Write the frame times to a CSV file.
+//------------------------------------------------------------------------------
+
+static void
+write_frame_times(const char *file_path, int frames_timed)
+{
+	FILE *fp;
+	int index;
+
+	if ((fp = fopen(file_path, "w")) == NULL) {
+		fprintf(stderr, "Unable to create timing file %s\n", file_path);
+		return;
+	}
+	fprintf(fp, "frame,ms\n");
+	for (index = 0; index < frames_timed; index++)
+		fprintf(fp, "%d,%.3f\n", index + 1, frame_time_list[index]);
+	fclose(fp);
+}
+
+//------------------------------------------------------------------------------
+// Print a summary of the frame times.  This sorts the frame time list.
+//------------------------------------------------------------------------------
+
+static void
+print_summary(int frames_timed)
+{
+	float total_time_ms;
+	int index;
+
+	printf("Frames rendered: %d\n", frames_displayed);
+	if (frames_timed == 0)
+		return;
+	total_time_ms = 0.0f;
+	for (index = 0; index < frames_timed; index++)
+		total_time_ms += frame_time_list[index];
+	qsort(frame_time_list, frames_timed, sizeof(float), compare_frame_times);
+	printf("Average: %.3f ms (%.1f fps)\n", total_time_ms / frames_timed,
+		total_time_ms > 0.0f ? frames_timed * 1000.0f / total_time_ms : 0.0f);
+	printf("Minimum: %.3f ms\n", frame_time_list[0]);
+	printf("95th percentile: %.3f ms\n",
+		frame_time_list[(frames_timed * 95 - 1) / 100]);
+	printf("Maximum: %.3f ms\n", frame_time_list[frames_timed - 1]);
+}
+
+//------------------------------------------------------------------------------
+// Main entry point.
+//------------------------------------------------------------------------------
+
+int
+main(int argc, char *argv[])
+{
+	int exit_status;
+	int frames_timed;
+
+	// Parse the command line and set up the camera path.
+
+	if (!parse_command_line(argc, argv)) {
+		usage(argv[0]);
+		return(2);
+	}
+	if (path_file_path != NULL) {
+		if (!load_camera_path(path_file_path))
+			return(2);
+	} else if (!create_stationary_camera_path(requested_frames))
+		return(2);
+	curr_segment_index = 0;
+	curr_segment_end_frame = path_segment_list->frames;
+	if ((frame_time_list = (float *)malloc(total_frames * sizeof(float))) == NULL)
+		return(2);
+
+	// Open the span file.  Writing the spans starts once the frame before the
+	// last is displayed, so there must be at least two frames.
+
+	if (span_file_path != NULL) {
+		if (total_frames < 2) {
+			fprintf(stderr, "At least two frames are needed to write spans\n");
+			return(2);
+		}
+		if ((span_fp = fopen(span_file_path, "w")) == NULL) {
+			fprintf(stderr, "Unable to create span file %s\n", span_file_path);
+			return(2);
+		}
+	}
+
+	// Configure the headless platform, then run the app until the camera path
+	// is finished.
+
+	if (window_width_arg > 0 && window_height_arg > 0)
+		set_main_window_size(window_width_arg, window_height_arg);
+	set_time_step(time_step_ms_arg);
+	set_frame_timeout(timeout_secs * 1000);
+	set_frame_callback(frame_callback);
+	exit_status = run_app(NULL, 0, (char *)spot_file_path);
+
+	// Report the frame times.
+
+	frames_timed = frames_displayed > 1 ? frames_displayed - 1 : 0;
+	if (timing_file_path != NULL)
+		write_frame_times(timing_file_path, frames_timed);
+	print_summary(frames_timed);
+	if (span_fp != NULL)
+		fclose(span_fp);
+	free(frame_time_list);
+	free(path_segment_list);
+	return(exit_status);
+}
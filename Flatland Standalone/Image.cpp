@@ -37,10 +37,16 @@
 #include <string.h>
 
 extern "C" {
+#ifdef _WIN32
 #include "Jpeg\jinclude.h"
 #include "Jpeg\jpeglib.h"
 #include "Jpeg\jerror.h"
-#include "LibPNG\png.h"
+#else
+#include <jpeglib.h>
+#include <jerror.h>
+#define SIZEOF(object)	((size_t)sizeof(object))
+#endif
+#include "LibPNG/png.h"
 }
 
 #include "Classes.h"
@@ -49,6 +55,7 @@ extern "C" {
 #include "Parser.h"
 #include "Platform.h"
 #include "Plugin.h"
+#include "Portable.h"
 #include "Spans.h"
 
 //------------------------------------------------------------------------------
@@ -1097,6 +1104,7 @@ void
 load_PNG(bool force_32_bit_pixels)
 {
 	RGBcolour colour;
+	int colour_type, bit_depth, row_bytes;
 
 	// Initialise the number of pixmaps loaded, the transparent flag, the loop flag, and the number of colours.
 
@@ -1149,8 +1157,8 @@ load_PNG(bool force_32_bit_pixels)
 	png_read_info(png_ptr, info_ptr);
 	image_width = png_get_image_width(png_ptr, info_ptr);
 	image_height = png_get_image_height(png_ptr, info_ptr);
-	int colour_type = png_get_color_type(png_ptr, info_ptr);
-	int bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+	colour_type = png_get_color_type(png_ptr, info_ptr);
+	bit_depth = png_get_bit_depth(png_ptr, info_ptr);
 
 	// Set various transformations in order to obtain a 32-bit RGBA image.
 
@@ -1182,7 +1190,7 @@ load_PNG(bool force_32_bit_pixels)
 	// Create a buffer to hold the transformed image data, and an array of row pointers to point into the image data,
 	// then read the image.
 
-	int row_bytes = png_get_rowbytes(png_ptr, info_ptr);
+	row_bytes = png_get_rowbytes(png_ptr, info_ptr);
 	NEWARRAY(image_data, imagebyte, image_width * image_height * 4);
 	if (image_data == NULL) {
 		goto got_error;
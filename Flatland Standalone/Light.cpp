@@ -8,6 +8,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <math.h>
+#include <float.h>
 #include "Classes.h"
 #include "Fileio.h"
 #include "Light.h"
@@ -23,6 +24,15 @@
 
 #define	ONE_OVER_765		0.001307189f
 
+// Select the SSE2 lighting code if the compiler is targeting it (it's always
+// present on x64), otherwise vertices are lit by plain C++.
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHT_SSE2
+#include <emmintrin.h>
+#endif
+
 // Maximum active lights.
 
 int max_active_lights;
@@ -38,10 +48,66 @@ static float ambient_red, ambient_green, ambient_blue;
 static float master_intensity;
 static float master_red, master_green, master_blue;
 
+// Lighting stamp, and the lighting stamp of the last change to the ambient
+// light or master intensity.
+
+unsigned int lighting_stamp;
+static unsigned int global_lighting_stamp;
+
 // Distance list used to determine closest lights.
 
 static float distance_list[ACTIVE_LIGHTS_LIMIT];
 
+#ifdef LIGHT_SSE2
+
+// Number of active lights lit at once by the SSE2 lighting code.
+
+#define LIGHT_LANES			4
+
+// The active lights in structure-of-arrays form, with room for the maximum
+// number of active lights rounded up to a whole number of lanes.
+
+#define LANE_LIGHTS			((ACTIVE_LIGHTS_LIMIT + LIGHT_LANES - 1) & ~(LIGHT_LANES - 1))
+
+struct light_lanes {
+	float pos_x[LANE_LIGHTS], pos_y[LANE_LIGHTS], pos_z[LANE_LIGHTS];
+	float dir_x[LANE_LIGHTS], dir_y[LANE_LIGHTS], dir_z[LANE_LIGHTS];
+	float radius[LANE_LIGHTS];
+	float one_on_radius[LANE_LIGHTS];
+	float cos_cone_angle[LANE_LIGHTS];
+	float cone_angle_M[LANE_LIGHTS];
+	float intensity[LANE_LIGHTS];
+	float red[LANE_LIGHTS], green[LANE_LIGHTS], blue[LANE_LIGHTS];
+	float spot[LANE_LIGHTS];			// 1 for a spot light, 0 otherwise.
+	float flood[LANE_LIGHTS];			// 1 for a flood light, 0 otherwise.
+};
+
+static light_lanes active_lanes;
+
+#endif
+
+// Number of squares along each side of a light grid cell.
+
+#define LIGHT_CELL_SQUARES	4
+
+// Light grid entry, referring to a global light or a light in a fixed block.
+
+struct light_entry {
+	light *light_ptr;					// Pointer to light.
+	block *block_ptr;					// Pointer to block (NULL if global).
+	vertex light_pos;					// Position of light in world.
+	light_entry *next_entry_ptr;		// Next entry in the same cell.
+};
+
+// The light grid, which divides the map into cells and holds a list of the
+// global and fixed block lights in each cell, and the list of lights that are
+// outside of the map.  Lights in movable blocks are not kept in the grid.
+
+static light_entry **light_grid;
+static int light_grid_columns, light_grid_rows, light_grid_levels;
+static float light_cell_size;
+static light_entry *outside_light_list;
+
 //------------------------------------------------------------------------------
 // Get the ambient light.
 //------------------------------------------------------------------------------
@@ -65,6 +131,7 @@ set_ambient_light(float brightness, RGBcolour colour)
 	ambient_red = colour.red * brightness;
 	ambient_green = colour.green * brightness;
 	ambient_blue = colour.blue * brightness;
+	global_lighting_stamp = ++lighting_stamp;
 }
 
 //------------------------------------------------------------------------------
@@ -74,12 +141,68 @@ set_ambient_light(float brightness, RGBcolour colour)
 void
 set_master_intensity(float brightness)
 {
+	if (brightness != master_intensity)
+		global_lighting_stamp = ++lighting_stamp;
 	master_intensity = brightness;
 	master_red = 255.0f * brightness;
 	master_green = 255.0f * brightness;
 	master_blue = 255.0f * brightness;
 }
 
+//------------------------------------------------------------------------------
+// Get the position of a light in the world.  If a translation has been
+// supplied, add it to the light's position, otherwise use the map coordinates
+// in the light itself.
+//------------------------------------------------------------------------------
+
+static vertex
+get_light_position(light *light_ptr, vertex *translation_ptr)
+{
+	vertex translation;
+
+	if (translation_ptr != NULL)
+		return(light_ptr->position + *translation_ptr);
+	translation.set_map_translation(light_ptr->map_coords.column, 
+		light_ptr->map_coords.row, light_ptr->map_coords.level);
+	return(light_ptr->position + translation);
+}
+
+//------------------------------------------------------------------------------
+// Add a light at the given position to the closest light list, if it is closer
+// to the given vertex than any light already in the list.
+//------------------------------------------------------------------------------
+
+static void
+add_closest_light(light_ref *active_light_list, light *light_ptr, 
+				  vertex *light_pos_ptr, vertex *vertex_ptr)
+{
+	int	j, k;
+	vector rel_pos;
+	float distance;
+
+	// Compute the distance from the light to the vertex.
+
+	rel_pos = *light_pos_ptr - *vertex_ptr;
+	distance = (rel_pos.dx * rel_pos.dx) + (rel_pos.dy * rel_pos.dy) + 
+		(rel_pos.dz * rel_pos.dz);
+
+	// If this light is closer than any in the list, insert it into the list.
+	// The list is kept sorted from nearest to furthest.
+
+	for (j = 0; j < max_active_lights; j++) {
+		if (distance_list[j] < 0.0 || distance < distance_list[j]) {
+			for (k = max_active_lights - 1; k > j; k--) {
+				distance_list[k] = distance_list[k - 1];
+				active_light_list[k] = active_light_list[k - 1];
+			}
+			distance_list[j] = distance;
+			active_light_list[j].light_ptr = light_ptr;
+			active_light_list[j].light_pos = *light_pos_ptr;
+			break;
+		}
+	}
+}
+
 //------------------------------------------------------------------------------
 // Search a given list of lights for the closest to the given vertex.
 //------------------------------------------------------------------------------
@@ -90,54 +213,12 @@ find_closest_lights_in_light_list(light_ref *active_light_list,
 								  vertex *vertex_ptr)
 {
 	light *light_ptr;
-	int	j, k;
-	bool done;
 	vertex light_pos;
-	vector rel_pos;
-	float distance;
 
 	light_ptr = light_list;
 	while (light_ptr != NULL) {
-
-		// Compute the distance from the light to the vertex.  If a translation
-		// has been supplied, add it to the light's position, otherwise use the
-		// map coordinates in the light itself.
-
-		light_pos = light_ptr->position;
-		if (translation_ptr != NULL)
-			light_pos = light_pos + *translation_ptr;
-		else {
-			vertex translation;
-			translation.set_map_translation(light_ptr->map_coords.column, light_ptr->map_coords.row, light_ptr->map_coords.level);
-			light_pos = light_pos + translation;
-		}
-		rel_pos = light_pos - *vertex_ptr;
-		distance = (rel_pos.dx * rel_pos.dx) + (rel_pos.dy * rel_pos.dy) + 
-			(rel_pos.dz * rel_pos.dz);
-
-		// If this light is closer than any in the list, insert it into the
-		// list.  The list is kept sorted from nearest to furthest.
-
-		j = 0;
-		done = false;
-		while (j < max_active_lights && !done) {
-			if (distance_list[j] < 0.0 || distance < distance_list[j]) {
-				if (j < max_active_lights - 1) {
-					for (k = max_active_lights - 1; k > j; k--) {
-						distance_list[k] = distance_list[k - 1];
-						active_light_list[k] = active_light_list[k - 1];
-					}
-				}
-				distance_list[j] = distance;
-				active_light_list[j].light_ptr = light_ptr;
-				active_light_list[j].light_pos = light_pos;
-				done = true;
-			}
-			j++;
-		}
-
-		// Check the next light.
-
+		light_pos = get_light_position(light_ptr, translation_ptr);
+		add_closest_light(active_light_list, light_ptr, &light_pos, vertex_ptr);
 		light_ptr = light_ptr->next_light_ptr;
 	}
 }
@@ -159,6 +240,270 @@ find_closest_lights_in_block_list(light_ref *active_light_list,
 	}
 }
 
+//------------------------------------------------------------------------------
+// Get a pointer to the light grid cell list holding the given position, or the
+// list of lights outside of the map.
+//------------------------------------------------------------------------------
+
+static light_entry **
+get_light_cell_list(vertex *light_pos_ptr)
+{
+	int column, row, level;
+
+	column = (int)floor(light_pos_ptr->x / light_cell_size);
+	level = (int)floor(light_pos_ptr->y / light_cell_size);
+	row = (int)floor(light_pos_ptr->z / light_cell_size);
+	if (column < 0 || column >= light_grid_columns || row < 0 || 
+		row >= light_grid_rows || level < 0 || level >= light_grid_levels)
+		return(&outside_light_list);
+	return(&light_grid[(level * light_grid_rows + row) * light_grid_columns + 
+		column]);
+}
+
+//------------------------------------------------------------------------------
+// Add the lights in the given list to the light grid.  If a block is given, the
+// lights are translated by the block's translation, otherwise they are global
+// lights.
+//------------------------------------------------------------------------------
+
+void
+add_lights_to_grid(light *light_list, block *block_ptr)
+{
+	light *light_ptr;
+	light_entry *entry_ptr;
+	light_entry **cell_list_ptr;
+
+	if (light_grid == NULL)
+		return;
+	light_ptr = light_list;
+	while (light_ptr != NULL) {
+		NEW(entry_ptr, light_entry);
+		if (entry_ptr == NULL)
+			memory_error("light grid entry");
+		entry_ptr->light_ptr = light_ptr;
+		entry_ptr->block_ptr = block_ptr;
+		entry_ptr->light_pos = get_light_position(light_ptr, 
+			block_ptr != NULL ? &block_ptr->translation : NULL);
+		cell_list_ptr = get_light_cell_list(&entry_ptr->light_pos);
+		entry_ptr->next_entry_ptr = *cell_list_ptr;
+		*cell_list_ptr = entry_ptr;
+		light_ptr = light_ptr->next_light_ptr;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Remove the lights in the given list from the light grid.  The block, if
+// given, must still have the translation it had when its lights were added.
+//------------------------------------------------------------------------------
+
+void
+remove_lights_from_grid(light *light_list, block *block_ptr)
+{
+	light *light_ptr;
+	light_entry *entry_ptr;
+	light_entry **entry_ptr_ptr;
+	vertex light_pos;
+
+	if (light_grid == NULL)
+		return;
+	light_ptr = light_list;
+	while (light_ptr != NULL) {
+		light_pos = get_light_position(light_ptr, 
+			block_ptr != NULL ? &block_ptr->translation : NULL);
+		entry_ptr_ptr = get_light_cell_list(&light_pos);
+		while ((entry_ptr = *entry_ptr_ptr) != NULL) {
+			if (entry_ptr->light_ptr == light_ptr) {
+				*entry_ptr_ptr = entry_ptr->next_entry_ptr;
+				DEL(entry_ptr, light_entry);
+				break;
+			}
+			entry_ptr_ptr = &entry_ptr->next_entry_ptr;
+		}
+		light_ptr = light_ptr->next_light_ptr;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Create the light grid to cover the map, and add the global lights to it.
+// Lights in fixed blocks are added as the blocks are placed on the map.
+//------------------------------------------------------------------------------
+
+void
+create_light_grid(void)
+{
+	int cells;
+
+	destroy_light_grid();
+	light_cell_size = units_per_block * LIGHT_CELL_SQUARES;
+	light_grid_columns = (world_ptr->columns + LIGHT_CELL_SQUARES - 1) / 
+		LIGHT_CELL_SQUARES;
+	light_grid_rows = (world_ptr->rows + LIGHT_CELL_SQUARES - 1) / 
+		LIGHT_CELL_SQUARES;
+	light_grid_levels = (world_ptr->levels + LIGHT_CELL_SQUARES - 1) / 
+		LIGHT_CELL_SQUARES;
+	cells = light_grid_columns * light_grid_rows * light_grid_levels;
+	NEWARRAY(light_grid, light_entry *, cells);
+	if (light_grid == NULL)
+		memory_error("light grid");
+	memset(light_grid, 0, cells * sizeof(light_entry *));
+	add_lights_to_grid(global_light_list, NULL);
+}
+
+//------------------------------------------------------------------------------
+// Destroy the light grid.
+//------------------------------------------------------------------------------
+
+void
+destroy_light_grid(void)
+{
+	int cells, cell_index;
+	light_entry *next_entry_ptr;
+
+	if (light_grid != NULL) {
+		cells = light_grid_columns * light_grid_rows * light_grid_levels;
+		for (cell_index = 0; cell_index < cells; cell_index++) {
+			while (light_grid[cell_index] != NULL) {
+				next_entry_ptr = light_grid[cell_index]->next_entry_ptr;
+				DEL(light_grid[cell_index], light_entry);
+				light_grid[cell_index] = next_entry_ptr;
+			}
+		}
+		DELARRAY(light_grid, light_entry *, cells);
+		light_grid = NULL;
+	}
+	while (outside_light_list != NULL) {
+		next_entry_ptr = outside_light_list->next_entry_ptr;
+		DEL(outside_light_list, light_entry);
+		outside_light_list = next_entry_ptr;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Add the lights in a light grid entry list to the closest light list.
+//------------------------------------------------------------------------------
+
+static void
+find_closest_lights_in_entry_list(light_ref *active_light_list, 
+								  light_entry *entry_list, vertex *vertex_ptr)
+{
+	light_entry *entry_ptr = entry_list;
+	while (entry_ptr != NULL) {
+		add_closest_light(active_light_list, entry_ptr->light_ptr, 
+			&entry_ptr->light_pos, vertex_ptr);
+		entry_ptr = entry_ptr->next_entry_ptr;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Return the distance from a coordinate to the nearest edge of a range of
+// light grid cells along one axis, ignoring edges on the boundary of the grid
+// since there are no cells beyond them.
+//------------------------------------------------------------------------------
+
+static float
+get_distance_to_cell_range(float coord, int min_cell, int max_cell, int cells)
+{
+	float distance, edge_distance;
+
+	distance = FLT_MAX;
+	if (min_cell > 0) {
+		edge_distance = coord - min_cell * light_cell_size;
+		if (edge_distance < distance)
+			distance = edge_distance;
+	}
+	if (max_cell < cells - 1) {
+		edge_distance = (max_cell + 1) * light_cell_size - coord;
+		if (edge_distance < distance)
+			distance = edge_distance;
+	}
+	return(distance);
+}
+
+//------------------------------------------------------------------------------
+// Search the light grid for the closest lights to the given vertex.  The cells
+// are visited in rings of increasing size around the cell holding the vertex,
+// stopping once the closest light list is full and no unvisited cell can hold
+// a closer light.
+//------------------------------------------------------------------------------
+
+static void
+find_closest_lights_in_grid(light_ref *active_light_list, vertex *vertex_ptr)
+{
+	int centre_column, centre_row, centre_level;
+	int min_column, min_row, min_level, max_column, max_row, max_level;
+	int column, row, level, level_step;
+	int ring, max_ring;
+	float distance, edge_distance;
+
+	// Search the lights outside of the map first.
+
+	find_closest_lights_in_entry_list(active_light_list, outside_light_list,
+		vertex_ptr);
+
+	// Determine the cell holding the vertex, clamped to the grid, and the
+	// largest ring needed to cover the grid from there.
+
+	centre_column = (int)floor(vertex_ptr->x / light_cell_size);
+	centre_level = (int)floor(vertex_ptr->y / light_cell_size);
+	centre_row = (int)floor(vertex_ptr->z / light_cell_size);
+	centre_column = MAX(MIN(centre_column, light_grid_columns - 1), 0);
+	centre_row = MAX(MIN(centre_row, light_grid_rows - 1), 0);
+	centre_level = MAX(MIN(centre_level, light_grid_levels - 1), 0);
+	max_ring = MAX(centre_column, light_grid_columns - 1 - centre_column);
+	max_ring = MAX(max_ring, MAX(centre_row, light_grid_rows - 1 - centre_row));
+	max_ring = MAX(max_ring, MAX(centre_level, 
+		light_grid_levels - 1 - centre_level));
+
+	// Visit each ring of cells in turn.
+
+	for (ring = 0; ring <= max_ring; ring++) {
+		min_column = MAX(centre_column - ring, 0);
+		max_column = MIN(centre_column + ring, light_grid_columns - 1);
+		min_row = MAX(centre_row - ring, 0);
+		max_row = MIN(centre_row + ring, light_grid_rows - 1);
+		min_level = MAX(centre_level - ring, 0);
+		max_level = MIN(centre_level + ring, light_grid_levels - 1);
+		for (column = min_column; column <= max_column; column++)
+			for (row = min_row; row <= max_row; row++) {
+
+				// If this column and row are on the ring, every level is
+				// visited, otherwise only the bottom and top levels are.
+
+				if (ring == 0 || column == centre_column - ring || 
+					column == centre_column + ring || 
+					row == centre_row - ring || row == centre_row + ring)
+					level_step = 1;
+				else
+					level_step = ring * 2;
+				for (level = centre_level - ring; level <= centre_level + ring;
+					level += level_step)
+					if (level >= min_level && level <= max_level)
+						find_closest_lights_in_entry_list(active_light_list,
+							light_grid[(level * light_grid_rows + row) * 
+							light_grid_columns + column], vertex_ptr);
+			}
+
+		// If the closest light list is full, and the furthest light in it is
+		// no further away than the nearest cell outside of this ring, no
+		// unvisited cell can hold a closer light.
+
+		if (distance_list[max_active_lights - 1] >= 0.0f) {
+			distance = get_distance_to_cell_range(vertex_ptr->x, min_column, 
+				max_column, light_grid_columns);
+			edge_distance = get_distance_to_cell_range(vertex_ptr->y, 
+				min_level, max_level, light_grid_levels);
+			if (edge_distance < distance)
+				distance = edge_distance;
+			edge_distance = get_distance_to_cell_range(vertex_ptr->z, min_row,
+				max_row, light_grid_rows);
+			if (edge_distance < distance)
+				distance = edge_distance;
+			if (distance_list[max_active_lights - 1] <= distance * distance)
+				break;
+		}
+	}
+}
+
 //------------------------------------------------------------------------------
 // Determine the active lights for the given block, which are the closest
 // lights to the given vertex.
@@ -168,40 +513,67 @@ void
 set_active_lights(light_ref *active_light_list, vertex *vertex_ptr)
 {
 	int index;
-	vertex translation;
 
 	// Initialise the closest light list, and the distance list.
 
+	if (max_active_lights == 0)
+		return;
 	for (index = 0; index < max_active_lights; index++) {
 		active_light_list[index].light_ptr = NULL;
 		distance_list[index] = -1.0f;
 	}
 
-	// Search through the global list of lights, as well as any lights in the
-	// movable and fixed block list, and remember at most the three closest.
+	// Search through the lights in the movable block list, then the light
+	// grid for the global lights and the lights in the fixed block list.  If
+	// the light grid doesn't exist yet, search the lists directly.
 
-	find_closest_lights_in_light_list(active_light_list, global_light_list, 
-		NULL, vertex_ptr);
 	find_closest_lights_in_block_list(active_light_list, movable_block_list, 
 		vertex_ptr);
-	find_closest_lights_in_block_list(active_light_list, fixed_block_list, 
-		vertex_ptr);
+	if (light_grid != NULL)
+		find_closest_lights_in_grid(active_light_list, vertex_ptr);
+	else {
+		find_closest_lights_in_light_list(active_light_list, global_light_list,
+			NULL, vertex_ptr);
+		find_closest_lights_in_block_list(active_light_list, fixed_block_list, 
+			vertex_ptr);
+	}
 }
 
 //------------------------------------------------------------------------------
-// Compute the lit colour of a vertex using the given active light list.
+// Return the lighting stamp of the most recent change to the ambient light,
+// master intensity, orb light or the given active lights.  Lighting cached
+// since then is still valid.
 //------------------------------------------------------------------------------
 
-void
-compute_vertex_colour(light_ref *active_light_list, vertex *vertex_ptr, 
-					  vector *normal_ptr, RGBcolour *colour_ptr)
+unsigned int
+get_lighting_stamp(light_ref *active_light_list)
 {
 	int index;
 	light *light_ptr;
-	vector light_vector;
+	unsigned int stamp;
+
+	stamp = global_lighting_stamp;
+	if (orb_light_ptr != NULL && orb_light_ptr->stamp > stamp)
+		stamp = orb_light_ptr->stamp;
+	for (index = 0; index < max_active_lights; index++) {
+		light_ptr = active_light_list[index].light_ptr;
+		if (light_ptr != NULL && light_ptr->stamp > stamp)
+			stamp = light_ptr->stamp;
+	}
+	return(stamp);
+}
+
+//------------------------------------------------------------------------------
+// Compute the colour of a vertex with the given normal vector before the active
+// lights are added, from the ambient light and the orb light.
+//------------------------------------------------------------------------------
+
+static void
+compute_unlit_colour(vector *normal_ptr, float *red_ptr, float *green_ptr,
+					 float *blue_ptr)
+{
 	float red, green, blue;
-	float dot, dot2, distance;
-	float intensity;
+	float dot;
 
 	// Initialise the additive polygon colour to be the ambient colour.
 
@@ -224,6 +596,65 @@ compute_vertex_colour(light_ref *active_light_list, vertex *vertex_ptr,
 		}
 	}
 
+	// Return the additive polygon colour.
+
+	*red_ptr = red;
+	*green_ptr = green;
+	*blue_ptr = blue;
+}
+
+//------------------------------------------------------------------------------
+// Set the final colour of a vertex from the additive colour of all lights.
+//------------------------------------------------------------------------------
+
+static void
+set_vertex_colour(float red, float green, float blue, RGBcolour *colour_ptr)
+{
+	// Adjust the final vertex colour by the master intensity, making sure the
+	// component values stay within 0 and 255.
+
+	red += master_red;
+	if (FLT(red, 0.0f))
+		red = 0.0f;
+	else if (FGT(red, 255.0f))
+		red = 255.0f;
+	green += master_green;
+	if (FLT(green, 0.0f))
+		green = 0.0f;
+	else if (FGT(green, 255.0f))
+		green = 255.0f;
+	blue += master_blue;
+	if (FLT(blue, 0.0f))
+		blue = 0.0f;
+	else if (FGT(blue, 255.0f))
+		blue = 255.0f;
+
+	// Set the final vertex colour.
+
+	colour_ptr->red = red;
+	colour_ptr->green = green;
+	colour_ptr->blue = blue;
+}
+
+//------------------------------------------------------------------------------
+// Compute the lit colour of a vertex using the given active light list.
+//------------------------------------------------------------------------------
+
+void
+compute_vertex_colour(light_ref *active_light_list, vertex *vertex_ptr, 
+					  vector *normal_ptr, RGBcolour *colour_ptr)
+{
+	int index;
+	light *light_ptr;
+	vector light_vector;
+	float red, green, blue;
+	float dot, dot2, distance;
+	float intensity;
+
+	// Initialise the additive polygon colour from the ambient and orb lights.
+
+	compute_unlit_colour(normal_ptr, &red, &green, &blue);
+
 	// Now step through the list of active lights.
 
 	for (index = 0; index < max_active_lights; index++) {
@@ -291,30 +722,239 @@ compute_vertex_colour(light_ref *active_light_list, vertex *vertex_ptr,
 		}
 	}
 
-	// Adjust the final vertex colour by the master intensity, making sure the
-	// component values stay within 0 and 255.
+	// Set the final vertex colour.
 
-	red += master_red;
-	if (FLT(red, 0.0f))
-		red = 0.0f;
-	else if (FGT(red, 255.0f))
-		red = 255.0f;
-	green += master_green;
-	if (FLT(green, 0.0f))
-		green = 0.0f;
-	else if (FGT(green, 255.0f))
-		green = 255.0f;
-	blue += master_blue;
-	if (FLT(blue, 0.0f))
-		blue = 0.0f;
-	else if (FGT(blue, 255.0f))
-		blue = 255.0f;
+	set_vertex_colour(red, green, blue, colour_ptr);
+}
 
-	// Set the final vertex colour.
+#ifdef LIGHT_SSE2
 
-	colour_ptr->red = red;
-	colour_ptr->green = green;
-	colour_ptr->blue = blue;
+//------------------------------------------------------------------------------
+// Copy the given active light list into the active light lanes, and return the
+// number of light groups to process.
+//------------------------------------------------------------------------------
+
+static int
+set_active_light_lanes(light_ref *active_light_list)
+{
+	int index, groups;
+	light *light_ptr;
+
+	groups = (max_active_lights + LIGHT_LANES - 1) / LIGHT_LANES;
+	for (index = 0; index < groups * LIGHT_LANES; index++) {
+
+		// An unused lane, or one holding a light that doesn't illuminate
+		// vertices, is given a negative radius and no intensity.
+
+		light_ptr = index < max_active_lights ? 
+			active_light_list[index].light_ptr : NULL;
+		if (light_ptr == NULL || (light_ptr->style != STATIC_POINT_LIGHT &&
+			light_ptr->style != PULSATING_POINT_LIGHT && 
+			light_ptr->style != STATIC_SPOT_LIGHT && 
+			light_ptr->style != REVOLVING_SPOT_LIGHT &&
+			light_ptr->style != SEARCHING_SPOT_LIGHT)) {
+			active_lanes.pos_x[index] = 0.0f;
+			active_lanes.pos_y[index] = 0.0f;
+			active_lanes.pos_z[index] = 0.0f;
+			active_lanes.dir_x[index] = 0.0f;
+			active_lanes.dir_y[index] = 0.0f;
+			active_lanes.dir_z[index] = 0.0f;
+			active_lanes.radius[index] = -1.0f;
+			active_lanes.one_on_radius[index] = 0.0f;
+			active_lanes.cos_cone_angle[index] = 0.0f;
+			active_lanes.cone_angle_M[index] = 0.0f;
+			active_lanes.intensity[index] = 0.0f;
+			active_lanes.red[index] = 0.0f;
+			active_lanes.green[index] = 0.0f;
+			active_lanes.blue[index] = 0.0f;
+			active_lanes.spot[index] = 0.0f;
+			active_lanes.flood[index] = 0.0f;
+			continue;
+		}
+
+		// Copy the light into the lane.
+
+		active_lanes.pos_x[index] = active_light_list[index].light_pos.x;
+		active_lanes.pos_y[index] = active_light_list[index].light_pos.y;
+		active_lanes.pos_z[index] = active_light_list[index].light_pos.z;
+		active_lanes.dir_x[index] = light_ptr->dir.dx;
+		active_lanes.dir_y[index] = light_ptr->dir.dy;
+		active_lanes.dir_z[index] = light_ptr->dir.dz;
+		active_lanes.radius[index] = light_ptr->radius;
+		active_lanes.one_on_radius[index] = light_ptr->one_on_radius;
+		active_lanes.cos_cone_angle[index] = light_ptr->cos_cone_angle;
+		active_lanes.cone_angle_M[index] = light_ptr->cone_angle_M;
+		active_lanes.intensity[index] = light_ptr->intensity;
+		active_lanes.red[index] = light_ptr->colour.red;
+		active_lanes.green[index] = light_ptr->colour.green;
+		active_lanes.blue[index] = light_ptr->colour.blue;
+		active_lanes.spot[index] = light_ptr->style == STATIC_SPOT_LIGHT ||
+			light_ptr->style == REVOLVING_SPOT_LIGHT || 
+			light_ptr->style == SEARCHING_SPOT_LIGHT ? 1.0f : 0.0f;
+		active_lanes.flood[index] = light_ptr->flood ? 1.0f : 0.0f;
+	}
+	return(groups);
+}
+
+//------------------------------------------------------------------------------
+// Add the colour of the lights in the active light lanes to a vertex, four
+// lights at a time.  This performs the same calculations as
+// compute_vertex_colour, for point and spot lights at once, and adds the light
+// colours to the vertex colour in the same order.
+//------------------------------------------------------------------------------
+
+static void
+add_active_light_lanes(int groups, vertex *vertex_ptr, vector *normal_ptr,
+					   float *red_ptr, float *green_ptr, float *blue_ptr)
+{
+	int group, lane, offset;
+	__m128 zero, one, epsilon, sign_mask;
+	__m128 vertex_x, vertex_y, vertex_z, normal_x, normal_y, normal_z;
+	__m128 light_x, light_y, light_z, distance, one_on_distance;
+	__m128 radius, spot_mask, flood_mask, cos_cone_angle;
+	__m128 dot, cone_dot, cone, intensity, lit_mask, outside_cone_mask;
+	float red_list[LIGHT_LANES], green_list[LIGHT_LANES];
+	float blue_list[LIGHT_LANES];
+
+	zero = _mm_setzero_ps();
+	one = _mm_set1_ps(1.0f);
+	epsilon = _mm_set1_ps(EPSILON);
+	sign_mask = _mm_set1_ps(-0.0f);
+	vertex_x = _mm_set1_ps(vertex_ptr->x);
+	vertex_y = _mm_set1_ps(vertex_ptr->y);
+	vertex_z = _mm_set1_ps(vertex_ptr->z);
+	normal_x = _mm_set1_ps(normal_ptr->dx);
+	normal_y = _mm_set1_ps(normal_ptr->dy);
+	normal_z = _mm_set1_ps(normal_ptr->dz);
+	for (group = 0; group < groups; group++) {
+		offset = group * LIGHT_LANES;
+
+		// Compute the normalised vector from the vertex to each light, and the
+		// distance to the light.  As with vector::normalise, a vector too
+		// short to normalise is left as it is.
+
+		light_x = _mm_sub_ps(_mm_loadu_ps(&active_lanes.pos_x[offset]), 
+			vertex_x);
+		light_y = _mm_sub_ps(_mm_loadu_ps(&active_lanes.pos_y[offset]), 
+			vertex_y);
+		light_z = _mm_sub_ps(_mm_loadu_ps(&active_lanes.pos_z[offset]), 
+			vertex_z);
+		distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(light_x, light_x), _mm_mul_ps(light_y, light_y)),
+			_mm_mul_ps(light_z, light_z)));
+		lit_mask = _mm_cmpgt_ps(distance, epsilon);
+		one_on_distance = _mm_or_ps(_mm_and_ps(lit_mask, 
+			_mm_div_ps(one, distance)), _mm_andnot_ps(lit_mask, one));
+		light_x = _mm_mul_ps(light_x, one_on_distance);
+		light_y = _mm_mul_ps(light_y, one_on_distance);
+		light_z = _mm_mul_ps(light_z, one_on_distance);
+
+		// Compute the cosine of the angle between the light ray and the
+		// normal vector, and between the light ray and the spot light
+		// direction.
+
+		dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(light_x, normal_x), 
+			_mm_mul_ps(light_y, normal_y)), _mm_mul_ps(light_z, normal_z));
+		cone_dot = _mm_xor_ps(_mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(light_x, _mm_loadu_ps(&active_lanes.dir_x[offset])),
+			_mm_mul_ps(light_y, _mm_loadu_ps(&active_lanes.dir_y[offset]))),
+			_mm_mul_ps(light_z, _mm_loadu_ps(&active_lanes.dir_z[offset]))),
+			sign_mask);
+
+		// A light illuminates the vertex if the vertex is within it's radius
+		// and facing it, and for a spot light, inside the cone.
+
+		radius = _mm_loadu_ps(&active_lanes.radius[offset]);
+		spot_mask = _mm_cmpneq_ps(_mm_loadu_ps(&active_lanes.spot[offset]),
+			zero);
+		flood_mask = _mm_cmpneq_ps(_mm_loadu_ps(&active_lanes.flood[offset]),
+			zero);
+		cos_cone_angle = _mm_loadu_ps(&active_lanes.cos_cone_angle[offset]);
+		outside_cone_mask = _mm_andnot_ps(_mm_cmpgt_ps(cone_dot, 
+			cos_cone_angle), spot_mask);
+		lit_mask = _mm_andnot_ps(outside_cone_mask, _mm_and_ps(
+			_mm_cmple_ps(distance, radius), _mm_cmpgt_ps(dot, zero)));
+
+		// Compute the intensity of each light, which is the light's own
+		// intensity for a flood light.  Otherwise it's multiplied by the
+		// cosine of the angle to the normal vector, the position within the
+		// cone for a spot light, and the fraction of the distance to the
+		// light's radius.
+
+		intensity = _mm_loadu_ps(&active_lanes.intensity[offset]);
+		cone = _mm_or_ps(_mm_and_ps(spot_mask, _mm_mul_ps(
+			_mm_sub_ps(cone_dot, cos_cone_angle), 
+			_mm_loadu_ps(&active_lanes.cone_angle_M[offset]))),
+			_mm_andnot_ps(spot_mask, one));
+		intensity = _mm_or_ps(_mm_and_ps(flood_mask, intensity),
+			_mm_andnot_ps(flood_mask, _mm_mul_ps(_mm_mul_ps(
+			_mm_mul_ps(intensity, dot), cone), _mm_mul_ps(
+			_mm_sub_ps(radius, distance), 
+			_mm_loadu_ps(&active_lanes.one_on_radius[offset])))));
+		intensity = _mm_and_ps(lit_mask, intensity);
+
+		// Add the colour of each light to the vertex colour.
+
+		_mm_storeu_ps(red_list, _mm_mul_ps(
+			_mm_loadu_ps(&active_lanes.red[offset]), intensity));
+		_mm_storeu_ps(green_list, _mm_mul_ps(
+			_mm_loadu_ps(&active_lanes.green[offset]), intensity));
+		_mm_storeu_ps(blue_list, _mm_mul_ps(
+			_mm_loadu_ps(&active_lanes.blue[offset]), intensity));
+		for (lane = 0; lane < LIGHT_LANES; lane++) {
+			*red_ptr += red_list[lane];
+			*green_ptr += green_list[lane];
+			*blue_ptr += blue_list[lane];
+		}
+	}
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+// Compute the lit colour of a list of vertices sharing the same normal vector,
+// using the given active light list.  When SSE2 is available the active lights
+// are processed four at a time, otherwise each vertex is lit by
+// compute_vertex_colour.  The SSE2 code performs the same operations in the
+// same order, so the colours match compute_vertex_colour to within floating
+// point rounding (less than 0.01 of a colour component), except that a vertex
+// within rounding distance of the radius of a flood light, or the cone edge of
+// a spot light, may fall on the other side of it.  A single vertex is always
+// lit by compute_vertex_colour, since filling the lanes would cost more than
+// it saves.
+//------------------------------------------------------------------------------
+
+void
+compute_vertex_colours(light_ref *active_light_list, int vertices, 
+					   vertex *vertex_list, vector *normal_ptr,
+					   RGBcolour *colour_list)
+{
+	int vertex_no;
+#ifdef LIGHT_SSE2
+	int groups;
+	float unlit_red, unlit_green, unlit_blue;
+	float red, green, blue;
+
+	if (vertices == 1) {
+		compute_vertex_colour(active_light_list, vertex_list, normal_ptr,
+			colour_list);
+		return;
+	}
+	groups = set_active_light_lanes(active_light_list);
+	compute_unlit_colour(normal_ptr, &unlit_red, &unlit_green, &unlit_blue);
+	for (vertex_no = 0; vertex_no < vertices; vertex_no++) {
+		red = unlit_red;
+		green = unlit_green;
+		blue = unlit_blue;
+		add_active_light_lanes(groups, &vertex_list[vertex_no], normal_ptr, 
+			&red, &green, &blue);
+		set_vertex_colour(red, green, blue, &colour_list[vertex_no]);
+	}
+#else
+	for (vertex_no = 0; vertex_no < vertices; vertex_no++)
+		compute_vertex_colour(active_light_list, &vertex_list[vertex_no],
+			normal_ptr, &colour_list[vertex_no]);
+#endif
 }
 
 //------------------------------------------------------------------------------
@@ -332,3 +972,45 @@ compute_vertex_brightness(light_ref *active_light_list, vertex *vertex_ptr,
 	return((vertex_colour.red + vertex_colour.blue + 
 		vertex_colour.green) * ONE_OVER_765);
 }
+
+//------------------------------------------------------------------------------
+// Compute the brightness of a list of vertices, each with its own normal
+// vector, using the given active light list.  As with compute_vertex_colours,
+// the active lights are processed four at a time when SSE2 is available, so
+// the brightness matches compute_vertex_brightness to within floating point
+// rounding, except at the edge of a light; a single vertex is always lit by
+// compute_vertex_brightness.
+//------------------------------------------------------------------------------
+
+void
+compute_vertex_brightnesses(light_ref *active_light_list, int vertices,
+							vertex *vertex_list, vector *normal_list,
+							float *brightness_list)
+{
+	int vertex_no;
+#ifdef LIGHT_SSE2
+	int groups;
+	float red, green, blue;
+	RGBcolour vertex_colour;
+
+	if (vertices == 1) {
+		brightness_list[0] = compute_vertex_brightness(active_light_list,
+			vertex_list, normal_list);
+		return;
+	}
+	groups = set_active_light_lanes(active_light_list);
+	for (vertex_no = 0; vertex_no < vertices; vertex_no++) {
+		compute_unlit_colour(&normal_list[vertex_no], &red, &green, &blue);
+		add_active_light_lanes(groups, &vertex_list[vertex_no], 
+			&normal_list[vertex_no], &red, &green, &blue);
+		set_vertex_colour(red, green, blue, &vertex_colour);
+		brightness_list[vertex_no] = (vertex_colour.red + vertex_colour.blue +
+			vertex_colour.green) * ONE_OVER_765;
+	}
+#else
+	for (vertex_no = 0; vertex_no < vertices; vertex_no++)
+		brightness_list[vertex_no] = compute_vertex_brightness(
+			active_light_list, &vertex_list[vertex_no], 
+			&normal_list[vertex_no]);
+#endif
+}
@@ -11,6 +11,10 @@
 
 extern int max_active_lights;
 
+// Lighting stamp, incremented whenever something that affects lighting changes.
+
+extern unsigned int lighting_stamp;
+
 // Externally visible functions.
 
 void
@@ -22,13 +26,38 @@ set_ambient_light(float brightness, RGBcolour colour);
 void
 set_master_intensity(float brightness);
 
+void
+create_light_grid(void);
+
+void
+destroy_light_grid(void);
+
+void
+add_lights_to_grid(light *light_list, block *block_ptr);
+
+void
+remove_lights_from_grid(light *light_list, block *block_ptr);
+
 void
 set_active_lights(light_ref *active_light_list, vertex *vertex_ptr);
 
+unsigned int
+get_lighting_stamp(light_ref *active_light_list);
+
 void
 compute_vertex_colour(light_ref *active_light_list, vertex *vertex_ptr, 
 					  vector *normal_ptr, RGBcolour *colour_ptr);
 
+void
+compute_vertex_colours(light_ref *active_light_list, int vertices, 
+					   vertex *vertex_list, vector *normal_ptr,
+					   RGBcolour *colour_list);
+
 float
 compute_vertex_brightness(light_ref *active_light_list, vertex *vertex_ptr, 
 						  vector *normal_ptr);
+
+void
+compute_vertex_brightnesses(light_ref *active_light_list, int vertices,
+							vertex *vertex_list, vector *normal_list,
+							float *brightness_list);
@@ -16,10 +16,12 @@
 #include "Main.h"
 #include "Memory.h"
 #include "Parser.h"
+#include "Profile.h"
 #include "Render.h"
 #include "Spans.h"
 #include "Platform.h"
 #include "Plugin.h"
+#include "Portable.h"
 #include "Utils.h"
 #include "SimKin.h"
 
@@ -224,6 +226,10 @@ int start_time_ms, curr_time_ms, clocktimer_time_ms;
 int frames_rendered;
 int polygons_rendered;
 
+// Number of polygons whose cached lighting was reused or had to be computed.
+
+int lit_polygon_hits, lit_polygon_misses;
+
 // Current mouse position.
 
 int mouse_x;
@@ -314,11 +320,14 @@ video_texture *scaled_video_texture_list;
 trigger *active_trigger_list[512];
 int active_trigger_count;
 
-// Queue of active scripts.
+// Queue of active scripts, the scripts executing on each script thread (NULL
+// if a script thread is free), and a flag indicating if a global method is
+// executing.
 
 trigger *active_script_list[256];
 int active_script_count;
-bool script_executing;
+trigger *executing_script_list[SCRIPT_THREADS];
+bool global_script_executing;
 
 // List of action tied to the global clock.
 
@@ -360,12 +369,17 @@ static string curr_spot_entrance;
 
 static const char *curr_link_URL;
 
-// Collision data.
+// Collision data.  The list of collision meshes to check and the list that
+// overlapping movable blocks are found in are grown as needed.  The player is
+// kept at least MAP_EDGE_MARGIN units inside the far edges of the map.
 
+#define MAP_EDGE_MARGIN	0.1f
 static float player_fall_delta;
-static COL_MESH *col_mesh_list[512];
-static VEC3 mesh_pos_list[512];
-static int col_meshes;
+static COL_MESH **col_mesh_list;
+static VEC3 *mesh_pos_list;
+static int col_meshes, max_col_meshes;
+static block **overlapping_block_list;
+static int max_overlapping_blocks;
 
 // Flag indicating if player viewpoint has been set.
 
@@ -471,6 +485,20 @@ log_stats(void)
 		diagnose("Average frame rate was %f frames per second",
 			(float)frames_rendered / elapsed_time);
 	}
+
+	// Report the percentage of lit polygons whose cached lighting was reused.
+
+	if (lit_polygon_hits + lit_polygon_misses > 0)
+		diagnose("Lighting cache hit rate was %f%% (%d hits, %d misses)",
+			(float)lit_polygon_hits * 100.0f / 
+			(lit_polygon_hits + lit_polygon_misses), lit_polygon_hits,
+			lit_polygon_misses);
+
+	// Log and write the frame profile.
+
+#ifdef FRAME_PROFILE
+	end_profile();
+#endif
 }
 
 //------------------------------------------------------------------------------
@@ -836,7 +864,9 @@ start_up_spot(void)
 	active_trigger_count = 0;
 	active_script_list[0] = NULL;
 	active_script_count = 0;
-	script_executing = false;
+	for (int script_thread_no = 0; script_thread_no < SCRIPT_THREADS; script_thread_no++)
+		executing_script_list[script_thread_no] = NULL;
+	global_script_executing = false;
 	active_clock_action_list[0] = NULL;
 	active_clock_action_count = 0;
 
@@ -909,7 +939,7 @@ start_up_spot(void)
 
 		// Set loading message in the title.
 
-		set_title("Loading %s", spot_file_name);
+		set_title("Loading %s", (char *)spot_file_name);
 
 		// Show the full spot URL in the edit box, or the current spot URL if
 		// the spot entrance is "default".
@@ -981,7 +1011,15 @@ start_up_spot(void)
 	clocktimer_time_ms = 0;
 	frames_rendered = 0;
 	polygons_rendered = 0;
+	lit_polygon_hits = 0;
+	lit_polygon_misses = 0;
 	player_viewpoint_set = true;
+
+	// Start the frame profile.
+
+#ifdef FRAME_PROFILE
+	start_profile();
+#endif
 	player_fall_delta = 0.0f;
 
 	// Initiate the downloading of the first custom texture or wave.
@@ -1011,9 +1049,9 @@ start_up_spot(void)
 	// Call the "start" method of the global SimKin script, if there is one,
 	// and wait for it to complete.
 
-	script_executing = call_global_method("start");
-	while (script_executing)
-		script_executing = resume_script();
+	global_script_executing = call_global_method("start");
+	while (global_script_executing)
+		global_script_executing = resume_script(0, SCRIPT_TIME_SLICE_MS);
 
 	// Indicate success.
 
@@ -1041,15 +1079,19 @@ shut_down_spot(void)
 	log_stats();
 
 	// Call the "stop" method of the global SimKin script, if there is
-	// one, then shut down SimKin.  We must terminate any script currently
+	// one, then shut down SimKin.  We must terminate any scripts currently
 	// executing before we can call the "stop" method, then we wait for it to 
 	// complete.
 
-	if (script_executing)
-		terminate_script();
-	script_executing = call_global_method("stop");
-	while (script_executing)
-		script_executing = resume_script();
+	for (int script_thread_no = 0; script_thread_no < SCRIPT_THREADS; script_thread_no++) {
+		if (executing_script_list[script_thread_no] != NULL) {
+			terminate_script(script_thread_no);
+			executing_script_list[script_thread_no] = NULL;
+		}
+	}
+	global_script_executing = call_global_method("stop");
+	while (global_script_executing)
+		global_script_executing = resume_script(0, SCRIPT_TIME_SLICE_MS);
 	shut_down_simkin();
 
 #ifdef STREAMING_MEDIA
@@ -1094,8 +1136,9 @@ shut_down_spot(void)
 	if (world_ptr != NULL)
 		DEL(world_ptr, world);
 
-	// Delete the movable block list.
+	// Delete the movable block grid and movable block list.
 
+	destroy_movable_block_grid();
 	while (movable_block_list != NULL) {
 		next_block_ptr = movable_block_list;
 		while (movable_block_list != NULL) {
@@ -1121,8 +1164,9 @@ shut_down_spot(void)
 		imagemap_list = next_imagemap_ptr;
 	}
 
-	// Delete all lights in the global light list.
+	// Destroy the light grid, then delete all lights in the global light list.
 
+	destroy_light_grid();
 	while (global_light_list != NULL) {
 		next_light_ptr = global_light_list->next_light_ptr;
 		DEL(global_light_list, light);
@@ -1326,7 +1370,7 @@ handle_exit(const char *exit_URL, const char *exit_target, bool is_spot_URL, boo
 
 			if (!download_URL(spot_URL, NULL, true)) {
 				fatal_error("Unable to download 3DML document", 
-					"Unable to download 3DML document from %s", spot_URL);
+					"Unable to download 3DML document from %s", (char *)spot_URL);
 				left_mouse_clicked.reset_event();
 				return(true);
 			}
@@ -1471,6 +1515,88 @@ check_for_mouse_selection(void)
 	}
 }
 
+//------------------------------------------------------------------------------
+// Add a block's collision mesh to the list of meshes to check for collisions,
+// doubling the size of the list if it's full.  If there isn't enough memory to
+// do so, the mesh is left out and false is returned.
+//------------------------------------------------------------------------------
+
+static bool
+add_col_mesh(block *block_ptr)
+{
+	COL_MESH **new_col_mesh_list;
+	VEC3 *new_mesh_pos_list;
+	int new_max_col_meshes;
+
+	// If the list is full, double its size.
+
+	if (col_meshes == max_col_meshes) {
+		new_max_col_meshes = max_col_meshes > 0 ? max_col_meshes * 2 : 64;
+		NEWARRAY(new_col_mesh_list, COL_MESH *, new_max_col_meshes);
+		if (new_col_mesh_list == NULL)
+			return(false);
+		NEWARRAY(new_mesh_pos_list, VEC3, new_max_col_meshes);
+		if (new_mesh_pos_list == NULL) {
+			DELARRAY(new_col_mesh_list, COL_MESH *, new_max_col_meshes);
+			return(false);
+		}
+		if (col_mesh_list != NULL) {
+			memcpy(new_col_mesh_list, col_mesh_list, 
+				col_meshes * sizeof(COL_MESH *));
+			memcpy(new_mesh_pos_list, mesh_pos_list, col_meshes * sizeof(VEC3));
+			DELARRAY(col_mesh_list, COL_MESH *, max_col_meshes);
+			DELARRAY(mesh_pos_list, VEC3, max_col_meshes);
+		}
+		col_mesh_list = new_col_mesh_list;
+		mesh_pos_list = new_mesh_pos_list;
+		max_col_meshes = new_max_col_meshes;
+	}
+
+	// Add the block's collision mesh and position to the list.
+
+	col_mesh_list[col_meshes] = block_ptr->col_mesh_ptr;
+	mesh_pos_list[col_meshes].x = block_ptr->translation.x;
+	mesh_pos_list[col_meshes].y = block_ptr->translation.y;
+	mesh_pos_list[col_meshes].z = block_ptr->translation.z;
+	col_meshes++;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Find the movable blocks that overlap a bounding box, making the list they
+// are found in big enough to hold them all, and return how many there are.  If
+// there isn't enough memory to do so, only the blocks that fit are returned.
+//------------------------------------------------------------------------------
+
+static int
+find_overlapping_movable_blocks(vertex *min_box_ptr, vertex *max_box_ptr)
+{
+	block **new_block_list;
+	int new_max_blocks;
+	int blocks;
+
+	blocks = find_movable_blocks_in_box(min_box_ptr, max_box_ptr, 
+		overlapping_block_list, max_overlapping_blocks);
+	if (blocks > max_overlapping_blocks) {
+		new_max_blocks = max_overlapping_blocks > 0 ? 
+			max_overlapping_blocks : 64;
+		while (new_max_blocks < blocks)
+			new_max_blocks *= 2;
+		NEWARRAY(new_block_list, block *, new_max_blocks);
+		if (new_block_list == NULL) {
+			memory_warning("overlapping movable block list");
+			return(max_overlapping_blocks);
+		}
+		if (overlapping_block_list != NULL)
+			DELARRAY(overlapping_block_list, block *, max_overlapping_blocks);
+		overlapping_block_list = new_block_list;
+		max_overlapping_blocks = new_max_blocks;
+		blocks = find_movable_blocks_in_box(min_box_ptr, max_box_ptr, 
+			overlapping_block_list, max_overlapping_blocks);
+	}
+	return(blocks);
+}
+
 //------------------------------------------------------------------------------
 // Create a list of blocks that overlap the bounding box of a new player
 // position.
@@ -1484,9 +1610,10 @@ get_overlapping_blocks(float x, float y, float z,
 	int min_level, min_row, min_column;
 	int max_level, max_row, max_column;
 	int level, row, column;
+	square *square_ptr;
 	block *block_ptr;
-	COL_MESH *col_mesh_ptr;
-	vertex min_bbox, max_bbox;
+	int blocks, index;
+	bool added;
 
 	// Compute a bounding box for the new view, and determine which blocks are
 	// at the corners of this bounding box.  Note that min_row and max_row are
@@ -1512,48 +1639,53 @@ get_overlapping_blocks(float x, float y, float z,
 		min_level--;
 
 	// Step through the range of overlapping blocks and add them to a list of
-	// blocks to check for collisions.
+	// blocks to check for collisions.  If a square's chunk doesn't exist, the
+	// rest of the chunk's row is skipped.
 
 	col_meshes = 0;
+	added = true;
 	for (level = min_level; level <= max_level; level++)
 		for (row = min_row; row <= max_row; row++)
-			for (column = min_column; column <= max_column; column++)
-				if ((block_ptr = world_ptr->get_block_ptr(column, row, level))
-					!= NULL) {
-					if (block_ptr->solid && block_ptr->col_mesh_ptr != NULL) {
-						col_mesh_list[col_meshes] = block_ptr->col_mesh_ptr;
-						mesh_pos_list[col_meshes].x = block_ptr->translation.x;
-						mesh_pos_list[col_meshes].y = block_ptr->translation.y;
-						mesh_pos_list[col_meshes].z = block_ptr->translation.z;
-						col_meshes++;
-					}
+			for (column = min_column; column <= max_column; column++) {
+				if ((square_ptr = world_ptr->find_square_ptr(column, row, level)) == NULL) {
+					column |= CHUNK_COLUMNS - 1;
+					continue;
 				}
+				if ((block_ptr = square_ptr->block_ptr) != NULL &&
+					block_ptr->solid && block_ptr->col_mesh_ptr != NULL)
+					added = add_col_mesh(block_ptr) && added;
+			}
 
-	// Step through the list of movable blocks, and add them to the list of
-	// blocks to check for collisions.
+	// Find the movable blocks that overlap the bounding box, and add them to
+	// the list of blocks to check for collisions.
 
-	block_ptr = movable_block_list;
-	while (block_ptr != NULL) {
-		if (block_ptr->solid && block_ptr->col_mesh_ptr != NULL) {
-			col_mesh_ptr = block_ptr->col_mesh_ptr;
-			min_bbox.x = col_mesh_ptr->minBox.x + block_ptr->translation.x;
-			min_bbox.y = col_mesh_ptr->minBox.y + block_ptr->translation.y;
-			min_bbox.z = col_mesh_ptr->minBox.z + block_ptr->translation.z;
-			max_bbox.x = col_mesh_ptr->maxBox.x + block_ptr->translation.x;
-			max_bbox.y = col_mesh_ptr->maxBox.y + block_ptr->translation.y;
-			max_bbox.z = col_mesh_ptr->maxBox.z + block_ptr->translation.z;
-			if (!(min_bbox.x > max_view.x || max_bbox.x < min_view.x ||
-				  min_bbox.y > max_view.y || max_bbox.y < min_view.y ||
-				  min_bbox.z > max_view.z || max_bbox.z < min_view.z)) {
-				col_mesh_list[col_meshes] = block_ptr->col_mesh_ptr;
-				mesh_pos_list[col_meshes].x = block_ptr->translation.x;
-				mesh_pos_list[col_meshes].y = block_ptr->translation.y;
-				mesh_pos_list[col_meshes].z = block_ptr->translation.z;
-				col_meshes++;
-			}
-		}
-		block_ptr = block_ptr->next_block_ptr;
-	}
+	blocks = find_overlapping_movable_blocks(&min_view, &max_view);
+	for (index = 0; index < blocks; index++)
+		added = add_col_mesh(overlapping_block_list[index]) && added;
+
+	// If any block had to be left out, report it.
+
+	if (!added)
+		memory_warning("collision mesh list");
+}
+
+//------------------------------------------------------------------------------
+// Clamp a position to the map.  The position is kept a little inside the far
+// edges, so that it's always in one of the map's squares.
+//------------------------------------------------------------------------------
+
+static void
+clamp_to_map(vertex *position_ptr)
+{
+	position_ptr->x = FMAX(position_ptr->x, 0.0f);
+	position_ptr->x = FMIN(position_ptr->x, 
+		world_ptr->columns * units_per_block - MAP_EDGE_MARGIN);
+	position_ptr->y = FMAX(position_ptr->y, 0.0f);
+	position_ptr->y = FMIN(position_ptr->y, 
+		world_ptr->levels * units_per_block - MAP_EDGE_MARGIN);
+	position_ptr->z = FMAX(position_ptr->z, 0.0f);
+	position_ptr->z = FMIN(position_ptr->z, 
+		world_ptr->rows * units_per_block - MAP_EDGE_MARGIN);
 }
 
 //------------------------------------------------------------------------------
@@ -1566,16 +1698,19 @@ adjust_trajectory(vector &trajectory, float elapsed_time)
 {
 	vector new_trajectory;
 	vertex old_position, new_position;
+	vector segment_trajectory;
 	float floor_y;
 	float jump_delta;
-	int column, row, level;
+	float sweep_extent;
+	int segments, segment;
+	COL_AABOX sweep_box;
+	VEC3 sweep_position, sweep_trajectory;
 
-	// Truncate the trajectory so that it does not exceed the player step height,
-	// if necessary, then subtract the possibly truncated trajectory from the original.
+	// The player's collision box is swept along the whole trajectory, so it
+	// doesn't need to be truncated to keep the player from passing through
+	// thin walls.
 
 	new_trajectory = trajectory;
-	new_trajectory.truncate(player_step_height);
-	trajectory -= new_trajectory;
 
 	// If there is a jump delta and no fall delta or fly mode active, apply the jump delta to the trajectory, 
 	// then reduce the jump delta by a fixed amount until it reaches zero.
@@ -1590,31 +1725,56 @@ adjust_trajectory(vector &trajectory, float elapsed_time)
 	}
 	curr_jump_delta.set(jump_delta);
 
-	// If the new player position is off the map, don't move the player at all
-	// and make the floor height invalid.
+	// If the new player position is off the map, shorten the trajectory so
+	// that it stops at the edge of the map.
 
 	old_position = player_viewpoint.position;
 	new_position = old_position + new_trajectory;
-	new_position.get_map_position(&column, &row, &level);
-	if (new_position.x < 0.0 || column >= world_ptr->columns || 
-		new_position.z < 0.0 || row < 0 ||
-		new_position.y < 0.0 || level >= world_ptr->levels) {
-		new_position = old_position;
-		floor_y = -1.0f;
-	}
+	clamp_to_map(&new_position);
+	new_trajectory = new_position - old_position;
 
-	// Otherwise get the list of blocks that overlap the trajectory path,
-	// and check for collisions along that path, adjusting the player's new
-	// position approapiately.
+	// Move the player's collision box along the trajectory, sliding it along
+	// anything it runs into, then step it up onto anything low enough and find
+	// the floor height where it ends up.  Unless fly mode is active, the bottom
+	// of the box is raised by the step height while it slides, so that anything
+	// low enough to step onto doesn't stop the player.
 
-	else {
-		get_overlapping_blocks(new_position.x, new_position.y, new_position.z, 
-			old_position.x, old_position.y, old_position.z);
-		COL_checkCollisions(col_mesh_list, mesh_pos_list, col_meshes,
-			&new_position.x, &new_position.y, &new_position.z,
-			old_position.x, old_position.y, old_position.z,
-			&floor_y, player_step_height, &player_collision_box);
+	sweep_box = player_collision_box;
+	if (!fly_mode.get()) {
+		sweep_box.maxDim.y -= player_step_height / 2.0f;
+		sweep_box.offsToCentre.y += player_step_height / 2.0f;
+	}
+	VEC_set(&sweep_position, old_position.x, old_position.y, old_position.z);
+
+	// The trajectory is swept in segments no longer than a block, each of
+	// which is checked against the blocks within its length of where it
+	// starts, since sliding along a wall can take the player anywhere within
+	// that range, and stepping up can raise the player by the step height.
+	// This keeps the number of blocks checked proportional to the length of
+	// the trajectory, rather than to its cube.
+
+	segments = MAX((int)ceil(new_trajectory.length() / units_per_block), 1);
+	segment_trajectory = new_trajectory * (1.0f / segments);
+	sweep_extent = segment_trajectory.length();
+	for (segment = 0; segment < segments; segment++) {
+		get_overlapping_blocks(sweep_position.x + sweep_extent, 
+			sweep_position.y + sweep_extent + player_step_height,
+			sweep_position.z + sweep_extent,
+			sweep_position.x - sweep_extent, sweep_position.y - sweep_extent,
+			sweep_position.z - sweep_extent);
+		VEC_set(&sweep_trajectory, segment_trajectory.dx, 
+			segment_trajectory.dy, segment_trajectory.dz);
+		COL_moveAABox(col_mesh_list, mesh_pos_list, col_meshes,
+			&player_collision_box, &sweep_box, &sweep_position,
+			&sweep_trajectory, &floor_y, player_step_height);
 	}
+	new_position.x = sweep_position.x;
+	new_position.y = sweep_position.y;
+	new_position.z = sweep_position.z;
+
+	// If sliding took the player off the map, put them back on the edge.
+
+	clamp_to_map(&new_position);
 	
 	// If fly mode is not active and the floor height is valid, do a gravity check.
 
@@ -1675,8 +1835,8 @@ adjust_trajectory(vector &trajectory, float elapsed_time)
 }
 
 //------------------------------------------------------------------------------
-// Find a trigger on the active script queue with the same script ID and
-// block pointer as the given trigger.
+// Find a trigger on the active script queue or executing on a script thread
+// with the same script ID and block pointer as the given trigger.
 //------------------------------------------------------------------------------
 
 static bool
@@ -1687,6 +1847,12 @@ find_active_script(trigger *trigger_ptr)
 			active_script_list[j]->block_ptr == trigger_ptr->block_ptr)
 			return(true);
 	}
+	for (int j = 0; j < SCRIPT_THREADS; j++) {
+		if (executing_script_list[j] != NULL &&
+			executing_script_list[j]->script_def_ptr->ID == trigger_ptr->script_def_ptr->ID &&
+			executing_script_list[j]->block_ptr == trigger_ptr->block_ptr)
+			return(true);
+	}
 	return(false);
 }
 
@@ -1734,6 +1900,70 @@ add_trigger_to_active_list(square *square_ptr, block *block_ptr,
 	}
 }
 
+//------------------------------------------------------------------------------
+// Step the scripts for this frame.  Each script executing on a script thread is
+// resumed, and free script threads are given scripts from the head of the
+// active script queue, with all of these scripts sharing a budget of
+// SCRIPT_FRAME_BUDGET_MS.  A script that uses up its share is paused until the
+// next frame.  The script threads are visited in a different order each frame,
+// so that a script isn't always the one left waiting once the budget is spent.
+// Scripts only run while the player thread waits for them, so any changes they
+// make to the world happen at this point in the frame.
+//------------------------------------------------------------------------------
+
+static void
+step_scripts(void)
+{
+	static int first_script_thread_no;
+	int script_thread_no, script_thread_index, scripts;
+	int time_slice_ms, end_time_ms;
+	trigger *trigger_ptr;
+
+	// Count the scripts that will be executed this frame, and divide the
+	// budget between them.
+
+	scripts = 0;
+	for (script_thread_no = 0; script_thread_no < SCRIPT_THREADS; script_thread_no++) {
+		if (executing_script_list[script_thread_no] != NULL)
+			scripts++;
+	}
+	scripts += MIN(active_script_count, SCRIPT_THREADS - scripts);
+	if (scripts == 0)
+		return;
+	time_slice_ms = MAX(SCRIPT_FRAME_BUDGET_MS / scripts, 1);
+	end_time_ms = get_real_time_ms() + SCRIPT_FRAME_BUDGET_MS;
+
+	// Visit each script thread until the budget is used up.
+
+	for (script_thread_index = 0; script_thread_index < SCRIPT_THREADS; script_thread_index++) {
+		if (get_real_time_ms() >= end_time_ms)
+			break;
+		script_thread_no = (first_script_thread_no + script_thread_index) % SCRIPT_THREADS;
+
+		// If a script is executing on this script thread, resume it.
+
+		if (executing_script_list[script_thread_no] != NULL && 
+			!resume_script(script_thread_no, time_slice_ms))
+			executing_script_list[script_thread_no] = NULL;
+
+		// While this script thread is free and there is time left, execute
+		// the script at the head of the active script queue on it.  When a
+		// script starts, it is removed from the head of the queue.
+
+		while (executing_script_list[script_thread_no] == NULL && active_script_count != 0 &&
+			get_real_time_ms() < end_time_ms) {
+			trigger_ptr = active_script_list[0];
+			for (int j = 0; j < active_script_count; j++)
+				active_script_list[j] = active_script_list[j + 1];
+			active_script_count--;
+			if (execute_script(script_thread_no, trigger_ptr->block_ptr, trigger_ptr->script_def_ptr, 
+				time_slice_ms))
+				executing_script_list[script_thread_no] = trigger_ptr;
+		}
+	}
+	first_script_thread_no = (first_script_thread_no + 1) % SCRIPT_THREADS;
+}
+
 //------------------------------------------------------------------------------
 // Step through the given trigger list, adding those that are included in the
 // given trigger flags to the active trigger list.
@@ -2330,6 +2560,8 @@ execute_ripple_action(action *action_ptr)
 	float *temp;
 
 	block_ptr = action_ptr->trigger_ptr->block_ptr;			
+	if (!block_ptr->unshare_geometry())
+		return;
 	s = (int)sqrt((float)action_ptr->vertices);
 	drop = (int)((float)rand() / RAND_MAX * 100);
 	if (drop < action_ptr->droprate * 100) {
@@ -2376,6 +2608,7 @@ execute_ripple_action(action *action_ptr)
 	temp = action_ptr->prev_step_ptr;
 	action_ptr->prev_step_ptr = action_ptr->curr_step_ptr;
 	action_ptr->curr_step_ptr = temp;
+	block_ptr->invalidate_lighting();
  }
 
 //------------------------------------------------------------------------------
@@ -2386,9 +2619,16 @@ static void
 execute_spin_action(action *action_ptr, int time_diff)
 {
 	block *block_ptr = action_ptr->trigger_ptr->block_ptr;
-	block_ptr->rotate_x(action_ptr->spin_angles.x * (float)time_diff / 1000.0f);
-	block_ptr->rotate_y(action_ptr->spin_angles.y * (float)time_diff / 1000.0f);
-	block_ptr->rotate_z(action_ptr->spin_angles.z * (float)time_diff / 1000.0f);
+
+	// Only rotate around the axes the block is actually spinning around, since
+	// each rotation updates the whole block.
+
+	if (action_ptr->spin_angles.x != 0.0f)
+		block_ptr->rotate_x(action_ptr->spin_angles.x * (float)time_diff / 1000.0f);
+	if (action_ptr->spin_angles.y != 0.0f)
+		block_ptr->rotate_y(action_ptr->spin_angles.y * (float)time_diff / 1000.0f);
+	if (action_ptr->spin_angles.z != 0.0f)
+		block_ptr->rotate_z(action_ptr->spin_angles.z * (float)time_diff / 1000.0f);
 }
 
 //------------------------------------------------------------------------------
@@ -2419,6 +2659,7 @@ execute_orbit_action(action *action_ptr,int time_diff)
 	block_ptr->translation.y = center_ptr->translation.y +
 							(float)(sin(RAD((float)(action_ptr->temp) / 1000.0f) + 180.0f) * 
 							action_ptr->spin_angles.y / texels_per_unit);
+	update_movable_block_in_grid(block_ptr);
 }
 
 //------------------------------------------------------------------------------
@@ -2482,6 +2723,7 @@ execute_move_action(action *action_ptr, int time_diff)
 	block_ptr->translation.x += movex / texels_per_unit;
 	block_ptr->translation.y += movey / texels_per_unit;
 	block_ptr->translation.z += movez / texels_per_unit;
+	update_movable_block_in_grid(block_ptr);
 		
 	if (done == 3) {				
 		try {
@@ -2976,6 +3218,11 @@ render_next_frame(void)
 	hyperlink *exit_ptr;
 	block *block_ptr;
 	float old_visible_radius;
+	bool result;
+
+	// Start timing the next frame.
+
+	NEXT_PROFILE_FRAME();
 
 	// Update the current time in milliseconds, and compute the elapsed time in seconds.
 
@@ -3119,13 +3366,11 @@ render_next_frame(void)
 		side_delta * cosf(RAD(player_viewpoint.turn_angle + 90.0f));
 
 	// Adjust the trajectory to take in account collisions, then move the player along this trajectory.
-	// Note that there is a maximum distance the player can move in order for collision detection to
-	// be accurate, so it may be necessary to adjust the trajectory more than once.
 
-	do {
-		new_trajectory = adjust_trajectory(trajectory, elapsed_time);
-		player_viewpoint.position = player_viewpoint.position + new_trajectory;
-	} while (FNE(trajectory.dx, 0.0f) || FNE(trajectory.dz, 0.0f));
+	START_PROFILE(PROFILE_COLLISION);
+	new_trajectory = adjust_trajectory(trajectory, elapsed_time);
+	STOP_PROFILE(PROFILE_COLLISION);
+	player_viewpoint.position = player_viewpoint.position + new_trajectory;
 
 	// Set a flag indicating whether the viewpoint has changed.
 
@@ -3134,13 +3379,16 @@ render_next_frame(void)
 
 	// Update all lights and sounds.
 
+	START_PROFILE(PROFILE_LIGHTS);
 	update_all_lights(elapsed_time);
+	STOP_PROFILE(PROFILE_LIGHTS);
 	if (sound_on)
 		update_all_sounds();
 
 	// Move the player viewpoint to eye height, then create a vertex that is the end point
 	// of a vector extending from the eye point along the direction of sight, and determine
-	// which square it lands in, which becomes the builder square if its on the map.
+	// which square it lands in, which becomes the builder square if its on the map.  This is only done in
+	// build mode, since getting the square allocates the chunk of the map that holds it.
 
 	player_viewpoint.position.y += player_dimensions.y;
 	vertex builder_vertex(0.0f, 0.0f, units_per_block * 2.0f);
@@ -3148,7 +3396,7 @@ render_next_frame(void)
 	builder_vertex.rotate_y(player_viewpoint.turn_angle);
 	builder_vertex += player_viewpoint.position;
 	builder_vertex.get_map_position(&column, &row, &level);
-	if (column >= 0 && column < world_ptr->columns && row >= 0 && row < world_ptr->rows &&
+	if (build_mode.get() && column >= 0 && column < world_ptr->columns && row >= 0 && row < world_ptr->rows &&
 		level >= (world_ptr->ground_level_exists? 1 : 0) && level < world_ptr->levels - 1) {
 		builder_square_ptr = world_ptr->get_square_ptr(column, row, level);
 	} else {
@@ -3161,28 +3409,17 @@ render_next_frame(void)
 
 	render_frame();
 	player_viewpoint.position.y -= player_dimensions.y;
+	START_PROFILE(PROFILE_DISPLAY);
 	display_frame_buffer();
+	STOP_PROFILE(PROFILE_DISPLAY);
 	frames_rendered++;
 
-	// If there is a script currently executing, resume it.  Otherwise execute
-	// the script at the head of the active script queue.  When a script
-	// completes, it is removed from the head of the queue.
+	// Resume the scripts executing on the script threads, and start scripts
+	// from the active script queue on free script threads.
 
-	if (script_executing) {
-		if (!(script_executing = resume_script()) && 
-			active_script_count != 0) {
-			for (int j = 0; j < active_script_count; j++)
-				active_script_list[j] = active_script_list[j + 1];
-			active_script_count--;
-		}
-	} else if (active_script_count != 0) {
-		if (!(script_executing = execute_script(active_script_list[0]->block_ptr, 
-			active_script_list[0]->script_def_ptr))) {
-			for (int j = 0; j < active_script_count; j++)
-				active_script_list[j] = active_script_list[j + 1];
-			active_script_count--;
-		}
-	}
+	START_PROFILE(PROFILE_SCRIPTS);
+	step_scripts();
+	STOP_PROFILE(PROFILE_SCRIPTS);
 
 	// Check for a mouse selection and a left and right mouse clicked event.
 
@@ -3243,6 +3480,7 @@ render_next_frame(void)
 	// the currently and previously selected areas, followed by the list of
 	// global triggers.
 
+	START_PROFILE(PROFILE_TRIGGERS);
 	process_prev_selected_square();
 	process_curr_selected_square();
 	process_prev_selected_area();
@@ -3259,14 +3497,19 @@ render_next_frame(void)
 	// Execute the list of active triggers.
 
 	player_block_replaced = false;
-	if (!execute_active_trigger_list())
+	result = execute_active_trigger_list();
+	STOP_PROFILE(PROFILE_TRIGGERS);
+	if (!result)
 		return(false);
 
 	// Check if global timer is ready - if so then activate triggers tied 
 	// to the master clock.
 
 	if (curr_time_ms - clocktimer_time_ms > 50) {
-		if (!execute_global_clock_action_list(curr_time_ms - clocktimer_time_ms))
+		START_PROFILE(PROFILE_CLOCK_ACTIONS);
+		result = execute_global_clock_action_list(curr_time_ms - clocktimer_time_ms);
+		STOP_PROFILE(PROFILE_CLOCK_ACTIONS);
+		if (!result)
 			return(false);
 		clocktimer_time_ms = curr_time_ms;
 	}
@@ -3314,7 +3557,7 @@ render_next_frame(void)
 	// over an exit on a block, and a fixed block takes precedence over a
 	// movable one.
 
-	square_ptr = world_ptr->get_square_ptr(player_column, player_row, player_level);
+	square_ptr = world_ptr->find_square_ptr(player_column, player_row, player_level);
 	exit_ptr = NULL;
 	if (square_ptr != NULL) {
 		if (square_ptr->exit_ptr != NULL && (square_ptr->exit_ptr->trigger_flags & STEP_ON)) {
@@ -3543,6 +3786,8 @@ resume_spot(void)
 
 	start_time_ms = get_time_ms();
 	frames_rendered = 0;
+	lit_polygon_hits = 0;
+	lit_polygon_misses = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -3564,6 +3809,12 @@ init_player(void)
 	blockset_list_ptr = NULL;
 	last_refresh_time_ms = 0;
 	refresh_count = 0;
+	col_mesh_list = NULL;
+	mesh_pos_list = NULL;
+	col_meshes = 0;
+	max_col_meshes = 0;
+	overlapping_block_list = NULL;
+	max_overlapping_blocks = 0;
 
 	// Initialise key down list.
 
@@ -3591,7 +3842,7 @@ static void
 shut_down_player(void)
 {
 	// Delete the cached blockset list and loaded blockset lists, and clean up
-	// the renderer and collision detection code.
+	// the renderer, collision detection code and SimKin.
 
 	delete_cached_blockset_list();
 	if (blockset_list_ptr != NULL)
@@ -3600,6 +3851,16 @@ shut_down_player(void)
 		DEL(old_blockset_list_ptr, blockset_list);
 	clean_up_renderer();
 	COL_exit();
+	clean_up_simkin();
+
+	// Delete the collision mesh list and overlapping movable block list.
+
+	if (col_mesh_list != NULL) {
+		DELARRAY(col_mesh_list, COL_MESH *, max_col_meshes);
+		DELARRAY(mesh_pos_list, VEC3, max_col_meshes);
+	}
+	if (overlapping_block_list != NULL)
+		DELARRAY(overlapping_block_list, block *, max_overlapping_blocks);
 }
 
 //------------------------------------------------------------------------------
@@ -3613,9 +3874,9 @@ init_player_window(void)
 
 	visible_radius = (float)visible_block_radius.get() * units_per_block;
 
-	// Initialise free span list and the span buffer.
+	// Initialise the frame arena and the span buffer.
 
-	init_free_span_list();
+	init_frame_arena();
 	span_buffer_ptr = NULL;
 
 	// Set the viewport based upon the window size and the
@@ -3623,8 +3884,9 @@ init_player_window(void)
 
 	set_viewport(window_width, window_height);
 
-	// If hardware acceleration is not enabled, create the span buffer.
-	// Make sure its at least BUILDER_ICON_HEIGHT rows in height.
+	// If hardware acceleration is not enabled, create the span buffer and
+	// start the render threads.  Make sure the span buffer is at least
+	// BUILDER_ICON_HEIGHT rows in height.
 
 	if (!hardware_acceleration) {
 		NEW(span_buffer_ptr, span_buffer);
@@ -3633,6 +3895,7 @@ init_player_window(void)
 			display_low_memory_error();
 			return(false);
 		}
+		start_render_threads();
 	}
 
 	// Create the image caches.
@@ -3651,11 +3914,12 @@ shut_down_player_window(void)
 
 	delete_image_caches();
 
-	// Delete span buffer and free span list.
+	// Stop the render threads, and delete span buffer and frame arena.
 
+	stop_render_threads();
 	if (span_buffer_ptr != NULL)
 		DEL(span_buffer_ptr, span_buffer);
-	delete_free_span_list();
+	delete_frame_arena();
 
 	// Signal the plugin thread that the player window has been shut down.
 
@@ -3736,7 +4000,7 @@ bool
 refresh_player_window(void)
 {
 	if ((++refresh_count & 255) == 0) {
-		int curr_time_ms = get_time_ms();
+		int curr_time_ms = get_real_time_ms();
 		if (curr_time_ms >= last_refresh_time_ms + 100) {
 			last_refresh_time_ms = curr_time_ms;
 			if (player_window_shutdown_requested.event_sent()) {
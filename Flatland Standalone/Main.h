@@ -199,6 +199,10 @@ extern int start_time_ms, curr_time_ms;
 extern int frames_rendered;
 extern int polygons_rendered;
 
+// Number of polygons whose cached lighting was reused or had to be computed.
+
+extern int lit_polygon_hits, lit_polygon_misses;
+
 // Current mouse position.
 
 extern int mouse_x;
@@ -289,11 +293,12 @@ extern video_texture *scaled_video_texture_list;
 extern trigger *active_trigger_list[512];
 extern int active_trigger_count;
 
-// Queue of active scripts.
+// Queue of active scripts, and the scripts executing on each script thread.
 
 extern trigger *active_script_list[256];
 extern int active_script_count;
-extern bool script_executing;
+extern trigger *executing_script_list[SCRIPT_THREADS];
+extern bool global_script_executing;
 
 // List of action tied to the global clock.
 
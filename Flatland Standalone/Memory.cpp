@@ -12,6 +12,7 @@
 #include "Parser.h"
 #include "Platform.h"
 #include "Plugin.h"
+#include "Portable.h"
 
 #ifdef MEM_TRACE
 
@@ -34,6 +35,12 @@ static int peak_bytes_allocated;
 static int curr_allocations;
 static int peak_allocations;
 
+// The bytes allocated from the frame arena in the current frame, and the peak
+// bytes allocated from it in any one frame.
+
+static int curr_frame_bytes_allocated;
+static int peak_frame_bytes_allocated;
+
 #if TRACE_LEVEL >= 1
 
 // List of object types that are being traced.
@@ -54,17 +61,26 @@ static object object_list[MAX_OBJECTS];
 
 #endif // MEM_TRACE
 
-// Linked list of free spans.
+// Number of bytes in each frame arena block, and the alignment of every
+// object allocated from it.
 
-static span *free_span_list;
+#define FRAME_BLOCK_SIZE	65536
+#define FRAME_ALIGNMENT		8
 
-// Linked list of free transformed vertices.
+// Frame arena block.
 
-static tvertex *free_tvertex_list;
+struct frame_block {
+	byte data[FRAME_BLOCK_SIZE];
+	frame_block *next_frame_block_ptr;
+};
 
-// Linked list of free transformed polygons.
+// Frame arena: a linked list of frame blocks that is reused every frame, the
+// frame block currently being allocated from, and the offset of the next free
+// byte in that block.
 
-static tpolygon *free_tpolygon_list;
+static frame_block *frame_block_list;
+static frame_block *curr_frame_block_ptr;
+static int next_frame_byte;
 
 // Screen polygon list, the last screen polygon in the list, and the
 // current screen polygon.
@@ -136,6 +152,8 @@ start_trace(void)
 	peak_bytes_allocated = 0;
 	curr_allocations = 0;
 	peak_allocations = 0;
+	curr_frame_bytes_allocated = 0;
+	peak_frame_bytes_allocated = 0;
 #if TRACE_LEVEL >= 1
 	objects = 0;
 #endif
@@ -294,6 +312,8 @@ end_trace(void)
 
 	diagnose("Peak allocation of %d bytes in %d allocations", 
 		peak_bytes_allocated, peak_allocations);
+	diagnose("Peak allocation of %d bytes from the frame arena in one frame",
+		peak_frame_bytes_allocated);
 	if (curr_bytes_allocated > 0)
 		diagnose("*** Memory leak: %d bytes are still allocated", 
 			curr_bytes_allocated);
@@ -326,48 +346,114 @@ end_trace(void)
 //==============================================================================
 
 //------------------------------------------------------------------------------
-// Free span list management.
+// Frame arena management.
 //------------------------------------------------------------------------------
 
-// Initialise the free span list.
+// Initialise the frame arena.
 
 void
-init_free_span_list(void)
+init_frame_arena(void)
 {
-	free_span_list = NULL;
+	frame_block_list = NULL;
+	curr_frame_block_ptr = NULL;
+	next_frame_byte = 0;
 }
 
-// Delete the free span list.
+// Delete the frame arena.
 
 void
-delete_free_span_list(void)
+delete_frame_arena(void)
 {
-	span *next_span_ptr;
+	frame_block *next_frame_block_ptr;
 
-	while (free_span_list != NULL) {
-		next_span_ptr = free_span_list->next_span_ptr;
-		DEL(free_span_list, span);
-		free_span_list = next_span_ptr;
+	while (frame_block_list != NULL) {
+		next_frame_block_ptr = frame_block_list->next_frame_block_ptr;
+		DEL(frame_block_list, frame_block);
+		frame_block_list = next_frame_block_ptr;
 	}
+	curr_frame_block_ptr = NULL;
+	next_frame_byte = 0;
+}
+
+// Reclaim every object allocated from the frame arena in one step.  The frame
+// blocks are kept for reuse by the next frame.
+
+void
+reset_frame_arena(void)
+{
+	curr_frame_block_ptr = frame_block_list;
+	next_frame_byte = 0;
+#ifdef MEM_TRACE
+	curr_frame_bytes_allocated = 0;
+#endif
+}
+
+// Return a pointer to the given number of bytes in the frame arena, or NULL if
+// we are out of memory.
+
+static void *
+new_frame_bytes(int bytes)
+{
+	frame_block *frame_block_ptr;
+	void *ptr;
+
+	// Round the size up so that the next object is aligned.
+
+	bytes = (bytes + FRAME_ALIGNMENT - 1) & ~(FRAME_ALIGNMENT - 1);
+
+	// If there is no current frame block or it doesn't have room, move onto
+	// the next frame block in the list, creating it if necessary.
+
+	if (curr_frame_block_ptr == NULL || 
+		next_frame_byte + bytes > FRAME_BLOCK_SIZE) {
+		if (curr_frame_block_ptr != NULL)
+			frame_block_ptr = curr_frame_block_ptr->next_frame_block_ptr;
+		else
+			frame_block_ptr = frame_block_list;
+		if (frame_block_ptr == NULL) {
+			NEW(frame_block_ptr, frame_block);
+			if (frame_block_ptr == NULL)
+				return(NULL);
+			frame_block_ptr->next_frame_block_ptr = NULL;
+			if (curr_frame_block_ptr != NULL)
+				curr_frame_block_ptr->next_frame_block_ptr = frame_block_ptr;
+			else
+				frame_block_list = frame_block_ptr;
+		}
+		curr_frame_block_ptr = frame_block_ptr;
+		next_frame_byte = 0;
+	}
+
+	// Return the next free bytes in the current frame block.
+
+	ptr = &curr_frame_block_ptr->data[next_frame_byte];
+	next_frame_byte += bytes;
+#ifdef MEM_TRACE
+	curr_frame_bytes_allocated += bytes;
+	if (curr_frame_bytes_allocated > peak_frame_bytes_allocated)
+		peak_frame_bytes_allocated = curr_frame_bytes_allocated;
+#endif
+	return(ptr);
 }
 
-// Return a pointer the next free span, or NULL if we are out of memory.
+// Return a pointer to a new span in the frame arena, or NULL if we are out of
+// memory.  The span constructor is not run on arena memory, so the cache entry
+// pointer it would have cleared is cleared here.
 
 span *
 new_span(void)
 {
 	span *span_ptr;
 
-	span_ptr = free_span_list;
+	span_ptr = (span *)new_frame_bytes(sizeof(span));
 	if (span_ptr != NULL)
-		free_span_list = span_ptr->next_span_ptr;
-	else
-		NEW(span_ptr, span);
+		span_ptr->cache_entry_ptr = NULL;
 	return(span_ptr);
 }
 
 // Return a pointer the next free span, after initialising it with the old
-// span data.
+// span data.  The cache entry is looked up again for each span when it is
+// rendered, so the copy starts without one.
 
 span *
 dup_span(span *old_span_ptr)
@@ -375,119 +461,29 @@ dup_span(span *old_span_ptr)
 	span *span_ptr;
 
 	span_ptr = new_span();
-	if (span_ptr != NULL)
+	if (span_ptr != NULL) {
 		*span_ptr = *old_span_ptr;
-	return(span_ptr);
-}
-
-// Add the span to the head of the free span list, and return a pointer to the
-// next span.
-
-span *
-del_span(span *span_ptr)
-{
-	span *next_span_ptr = span_ptr->next_span_ptr;
-	span_ptr->next_span_ptr = free_span_list;
-	free_span_list = span_ptr;
-	return(next_span_ptr);
-}
-
-//------------------------------------------------------------------------------
-// Free transformed vertex management.
-//------------------------------------------------------------------------------
-
-// Initialise the free transformed vertex list.
-
-void
-init_free_tvertex_list(void)
-{
-	free_tvertex_list = NULL;
-}
-
-// Delete the free transformed vertex list.
-
-void
-delete_free_tvertex_list(void)
-{
-	while (free_tvertex_list != NULL) {
-		tvertex *next_tvertex_ptr = free_tvertex_list->next_tvertex_ptr;
-		DEL(free_tvertex_list, tvertex);
-		free_tvertex_list = next_tvertex_ptr;
+		span_ptr->cache_entry_ptr = NULL;
 	}
+	return(span_ptr);
 }
 
-// Return a pointer the next free transformed vertex, or NULL if we are out of memory.
+// Return a pointer to a new transformed vertex in the frame arena, or NULL if
+// we are out of memory.
 
 tvertex *
 new_tvertex(void)
 {
-	tvertex *tvertex_ptr = free_tvertex_list;
-	if (tvertex_ptr != NULL) {
-		free_tvertex_list = tvertex_ptr->next_tvertex_ptr;
-	} else {
-		NEW(tvertex_ptr, tvertex);
-	}
-	return tvertex_ptr;
-}
-
-// Add the transformed vertex to the head of the free transformed vertex list, and return a pointer to the next transformed vertex.
-
-tvertex *
-del_tvertex(tvertex *tvertex_ptr)
-{
-	tvertex *next_tvertex_ptr = tvertex_ptr->next_tvertex_ptr;
-	tvertex_ptr->next_tvertex_ptr = free_tvertex_list;
-	free_tvertex_list = tvertex_ptr;
-	return(next_tvertex_ptr);
-}
-
-//------------------------------------------------------------------------------
-// Free transformed polygon management.
-//------------------------------------------------------------------------------
-
-// Initialise the free transformed polygon list.
-
-void
-init_free_tpolygon_list(void)
-{
-	free_tpolygon_list = NULL;
+	return((tvertex *)new_frame_bytes(sizeof(tvertex)));
 }
 
-// Delete the free transformed polygon list.
-
-void
-delete_free_tpolygon_list(void)
-{
-	while (free_tpolygon_list != NULL) {
-		tpolygon *next_tpolygon_ptr = free_tpolygon_list->next_tpolygon_ptr;
-		DEL(free_tpolygon_list, tpolygon);
-		free_tpolygon_list = next_tpolygon_ptr;
-	}
-}
-
-// Return a pointer the next free transformed polygon, or NULL if we are out of memory.
+// Return a pointer to a new transformed polygon in the frame arena, or NULL if
+// we are out of memory.
 
 tpolygon *
 new_tpolygon(void)
 {
-	tpolygon *tpolygon_ptr = free_tpolygon_list;
-	if (tpolygon_ptr != NULL) {
-		free_tpolygon_list = tpolygon_ptr->next_tpolygon_ptr;
-	} else {
-		NEW(tpolygon_ptr, tpolygon);
-	}
-	return tpolygon_ptr;
-}
-
-// Add the transformed polygon to the head of the free transformed polygon list, and return a pointer to the next transformed polygon.
-
-tpolygon *
-del_tpolygon(tpolygon *tpolygon_ptr)
-{
-	tpolygon *next_tpolygon_ptr = tpolygon_ptr->next_tpolygon_ptr;
-	tpolygon_ptr->next_tpolygon_ptr = free_tpolygon_list;
-	free_tpolygon_list = tpolygon_ptr;
-	return(next_tpolygon_ptr);
+	return((tpolygon *)new_frame_bytes(sizeof(tpolygon)));
 }
 
 //------------------------------------------------------------------------------
@@ -73,13 +73,17 @@ end_trace();
 
 #endif
 
-// Functions for managing free spans.
+// Functions for managing the frame arena, from which spans, transformed
+// vertices and transformed polygons are allocated.
 
 void
-init_free_span_list(void);
+init_frame_arena(void);
 
 void
-delete_free_span_list(void);
+delete_frame_arena(void);
+
+void
+reset_frame_arena(void);
 
 span *
 new_span(void);
@@ -87,37 +91,12 @@ new_span(void);
 span *
 dup_span(span *old_span_ptr);
 
-span *
-del_span(span *span_ptr);
-
-// Functions for managing free transformed vertices.
-
-void
-init_free_tvertex_list(void);
-
-void
-delete_free_tvertex_list(void);
-
 tvertex *
 new_tvertex(void);
 
-tvertex *
-del_tvertex(tvertex *tvertex_ptr);
-
-// Functions for managing free transformed polygons.
-
-void
-init_free_tpolygon_list(void);
-
-void
-delete_free_tpolygon_list(void);
-
 tpolygon *
 new_tpolygon(void);
 
-tpolygon *
-del_tpolygon(tpolygon *tpolygon_ptr);
-
 // Functions for managing screen polygons.
 
 void
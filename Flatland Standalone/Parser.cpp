@@ -9,9 +9,8 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
-#include <direct.h>
 #include <time.h>
-#include "Unzip\unzip.h"
+#include "Unzip/unzip.h"
 #include "Classes.h"
 #include "Fileio.h"
 #include "Main.h"
@@ -19,6 +18,7 @@
 #include "Parser.h"
 #include "Platform.h"
 #include "Plugin.h"
+#include "Portable.h"
 #include "Utils.h"
 
 // String buffer for error messages.
@@ -761,13 +761,13 @@ URL_to_file_path(const char *URL)
 	else
 		file_path = URL;
 		
-	// Replace forward slashes with back slashes, and vertical bars to colons
+	// Replace forward slashes with the path separator, and vertical bars to colons
 	// in the file path.
 
 	char_ptr = file_path;
 	while (*char_ptr) {
 		if (*char_ptr == '/')
-			*char_ptr = '\\';
+			*char_ptr = PATH_SEPARATOR;
 		else if (*char_ptr == '|')
 			*char_ptr = ':';
 		char_ptr++;
@@ -968,7 +968,7 @@ download_blockset(const char *URL, const char *name)
 	while (folder) {
 		cache_file_path = cache_file_path + folder;
 		_mkdir(cache_file_path);
-		cache_file_path = cache_file_path + "\\";
+		cache_file_path = cache_file_path + PATH_SEPARATOR_STRING;
 		folder = strtok(NULL, "/\\");
 	}
 	cache_file_path = cache_file_path + file_name;
@@ -1703,7 +1703,7 @@ warning(int line_no, const char *format, ...)
 
 	// Add the line number of entity to the message.
 
-	write_error_log("<B>Warning on line %d of %s:</B> %s.\n<BR>\n", line_no, file_stack_ptr->file_URL, message);
+	write_error_log("<B>Warning on line %d of %s:</B> %s.\n<BR>\n", line_no, (char *)file_stack_ptr->file_URL, (char *)message);
 }
 
 //------------------------------------------------------------------------------
@@ -1741,9 +1741,9 @@ warning(const char *format, ...)
 		// URL.
 
 		else if (file_stack_ptr->text_file)
-			warning(file_stack_ptr->line_no, "%s", file_stack_ptr->file_URL, message);
+			warning(file_stack_ptr->line_no, "%s", (char *)file_stack_ptr->file_URL, (char *)message);
 		else
-			write_error_log("<B>Warning in %s:</B> %s.\n<BR>\n", file_stack_ptr->file_URL, message);
+			write_error_log("<B>Warning in %s:</B> %s.\n<BR>\n", (char *)file_stack_ptr->file_URL, (char *)message);
 	} 
 	
 	// Otherwise just write a generic error format.
@@ -1780,7 +1780,7 @@ error(int line_no, const char *format, ...)
 
 	// Add the line number of the entity to it.
 
-	bprintf(error_str, ERROR_MSG_SIZE, "<B>Error on line %d of %s:</B> %s.\n<BR>\n", line_no, file_stack_ptr->file_URL, message);
+	bprintf(error_str, ERROR_MSG_SIZE, "<B>Error on line %d of %s:</B> %s.\n<BR>\n", line_no, (char *)file_stack_ptr->file_URL, (char *)message);
 
 	// Throw the error message.
 
@@ -1820,9 +1820,9 @@ error(const char *format, ...)
 		// URL.
 
 		else if (file_stack_ptr->text_file)
-			error(file_stack_ptr->line_no, "%s", file_stack_ptr->file_URL, message);
+			error(file_stack_ptr->line_no, "%s", (char *)file_stack_ptr->file_URL, (char *)message);
 		else
-			bprintf(error_str, ERROR_MSG_SIZE, "<B>Error in %s:</B> %s.\n<BR>\n", file_stack_ptr->file_URL, message);
+			bprintf(error_str, ERROR_MSG_SIZE, "<B>Error in %s:</B> %s.\n<BR>\n", (char *)file_stack_ptr->file_URL, (char *)message);
 	} 
 	
 	// Otherwise just display a generic error format.
@@ -2297,7 +2297,7 @@ parse_integer_in_value(int *int_ptr)
 // Parse the current file token as an integer range.
 //------------------------------------------------------------------------------
 
-static bool
+bool
 parse_integer_range(intrange *intrange_ptr)
 {
 	if (!parse_integer_in_value(&intrange_ptr->min))
@@ -3347,7 +3347,7 @@ extract_text(string *string_ptr, const char *buffer, int length,
 
 				if (*end_ch_ptr != '\0' || ch_value < 0x20 || ch_value > 0x7e) {
 					DELARRAY(new_buffer, char, length + 1);
-					error(file_token_line_no, "<I>&%s;</I> is not a valid character reference", entity_name);
+					error(file_token_line_no, "<I>&%s;</I> is not a valid character reference", (char *)entity_name);
 				}
 
 				// Store the literal character in the new buffer.
@@ -3369,7 +3369,7 @@ extract_text(string *string_ptr, const char *buffer, int length,
 				}
 				if (entity_ref_ptr->name == NULL) {
 					DELARRAY(new_buffer, char, length + 1);
-					error(file_token_line_no, "<I>&%s;</I> is an undefined entity reference", entity_name);
+					error(file_token_line_no, "<I>&%s;</I> is an undefined entity reference", (char *)entity_name);
 				}
 			}
 		}
@@ -3586,7 +3586,7 @@ extract_token(void)
 			}
 		}
 		if (invalid_identifier) 
-			error(file_token_line_no, "<I>%s</I> was not expected here", file_token_string);
+			error(file_token_line_no, "<I>%s</I> was not expected here", (char *)file_token_string);
 	}
 
 	// Update the file buffer pointer in the top file.
@@ -3662,15 +3662,15 @@ parse_attribute(void)
 	// Parse the attribute name identifier.
 	
 	if (file_token != TOKEN_IDENTIFIER)
-		error(file_token_line_no, "Expected an attribute name rather than <I>%s</I>", file_token_string);
+		error(file_token_line_no, "Expected an attribute name rather than <I>%s</I>", (char *)file_token_string);
 	attr_name = file_token_string;
 
 	// Parse the equals sign symbol, followed by the attribute value string.
 
 	if (read_token() != TOKEN_EQUALS_SIGN)
-		error(file_token_line_no, "Expected <I>=</I> rather than <I>%s</I>", file_token_string);
+		error(file_token_line_no, "Expected <I>=</I> rather than <I>%s</I>", (char *)file_token_string);
 	if (read_token() != TOKEN_STRING)
-		error(file_token_line_no, "Expected an attribute value string rather than <I>%s</I>", file_token_string);
+		error(file_token_line_no, "Expected an attribute value string rather than <I>%s</I>", (char *)file_token_string);
 
 	// Create an attribute, and initialise it with the parsed token and value,
 	// then return a pointer to it.
@@ -3759,11 +3759,11 @@ parse_nested_entity_list(const char *end_tag_name)
 
 		case TOKEN_OPEN_END_TAG:
 			if (read_token() != TOKEN_IDENTIFIER)
-				error(file_token_line_no, "Expected a tag name rather than <I>%s</I>", file_token_string);
+				error(file_token_line_no, "Expected a tag name rather than <I>%s</I>", (char *)file_token_string);
 			if ((strict_XML_compliance && strcmp(file_token_string, end_tag_name)) ||
 				(!strict_XML_compliance && _stricmp(file_token_string, end_tag_name)) || 
 				read_token() != TOKEN_CLOSE_TAG)
-				error(file_token_line_no, "Expected <I>&lt;/%s&gt;</I> rather than <I>&lt;/%s&gt;</I>", end_tag_name, file_token_string);
+				error(file_token_line_no, "Expected <I>&lt;/%s&gt;</I> rather than <I>&lt;/%s&gt;</I>", (char *)end_tag_name, (char *)file_token_string);
 			return(entity_list);
 
 		// If we've come to the end of the file, and there is no end token
@@ -3776,7 +3776,7 @@ parse_nested_entity_list(const char *end_tag_name)
 		// Any other token is invalid.
 
 		default:
-			error(file_token_line_no, "Expected a tag or text rather than <I>%s</I>", file_token_string);
+			error(file_token_line_no, "Expected a tag or text rather than <I>%s</I>", (char *)file_token_string);
 		}
 
 		// Add the entity to the end of the entity list.
@@ -3808,7 +3808,7 @@ parse_tag(bool *is_start_tag)
 	// Read the tag name identifier, and remember the line it was on.
 
 	if (read_token() != TOKEN_IDENTIFIER)
-		error(file_token_line_no, "Expected a tag name rather than <I>%s</I>", file_token_string);
+		error(file_token_line_no, "Expected a tag name rather than <I>%s</I>", (char *)file_token_string);
 	tag_name = file_token_string;
 	tag_line_no = file_token_line_no;
 
@@ -3898,7 +3898,7 @@ parse_start_tag(int start_tag_token)
 		case TOKEN_OPEN_TAG:
 			entity_ptr = parse_tag(&is_start_tag);
 			if (!is_start_tag || (tag_token = get_token(entity_ptr->text)) == TOKEN_NONE || tag_token != start_tag_token)
-				error(entity_ptr->line_no, "Expected <I>&lt;%s&gt;</I> rather than <I>&lt;%s&gt;</I>", get_name(start_tag_token), entity_ptr->text);
+				error(entity_ptr->line_no, "Expected <I>&lt;%s&gt;</I> rather than <I>&lt;%s&gt;</I>", (char *)(get_name(start_tag_token)), (char *)entity_ptr->text);
 			return(entity_ptr);
 
 		// If we've come to the end of the file, this is an error.
@@ -3910,7 +3910,7 @@ parse_start_tag(int start_tag_token)
 		// Any other token is invalid.
 
 		default:
-			error(file_token_line_no, "Expected <I>&lt;%s&gt;</I> rather than <I>%s</I>", file_token_string);
+			error(file_token_line_no, "Expected <I>&lt;%s&gt;</I> rather than <I>%s</I>", (char *)file_token_string);
 		}
 	}
 }
@@ -4121,13 +4121,13 @@ parse_attribute_list(attr_def *attr_def_list, int attributes, bool attr_error_as
 	attr_ptr = entity_ptr->attr_list;
 	while (attr_ptr != NULL) {
 		if ((attr_token = get_token(attr_ptr->name)) == TOKEN_NONE)
-			warning("Unrecognised attribute name <I>%s</I>", attr_ptr->name);
+			warning("Unrecognised attribute name <I>%s</I>", (char *)attr_ptr->name);
 		else {
 			attr_def_ptr = attr_def_list;
 			for (index = 0; index < attributes; index++) {
 				if (attr_token == attr_def_ptr->token) {
 					if (parsed_attribute[index])
-						warning("Duplicate <I>%s</I> attribute encountered", attr_ptr->name);
+						warning("Duplicate <I>%s</I> attribute encountered", (char *)attr_ptr->name);
 					else {
 						start_parsing_value(tag_token, attr_token, attr_ptr->value, attr_def_ptr->required, attr_error_as_warning);
 						if (parse_attribute_value(attr_def_ptr->value_type, attr_def_ptr->value_ptr) && stop_parsing_value(true))
@@ -4139,7 +4139,7 @@ parse_attribute_list(attr_def *attr_def_list, int attributes, bool attr_error_as
 			}
 		}
 		if (index == attributes)
-			warning("The <I>%s</I> tag does not have <I>%s</I> as an attribute", entity_ptr->text, attr_ptr->name);
+			warning("The <I>%s</I> tag does not have <I>%s</I> as an attribute", (char *)entity_ptr->text, (char *)attr_ptr->name);
 		attr_ptr = attr_ptr->next_attr_ptr;
 	}
 
@@ -4149,7 +4149,7 @@ parse_attribute_list(attr_def *attr_def_list, int attributes, bool attr_error_as
 	attr_def_ptr = attr_def_list;
 	for (index = 0; index < attributes; index++) {
 		if (attr_def_ptr->required && !parsed_attribute[index]) {
-			warning("The <I>%s</I> attribute is missing from the <I>%s</I> tag; skipping over this tag", get_name(attr_def_ptr->token), entity_ptr->text);
+			warning("The <I>%s</I> attribute is missing from the <I>%s</I> tag; skipping over this tag", (char *)(get_name(attr_def_ptr->token)), (char *)entity_ptr->text);
 			got_all_required_attributes = false;
 		}
 		attr_def_ptr++;
@@ -4409,7 +4409,7 @@ parse_next_nested_tag(int start_tag_token, tag_def *tag_def_list, bool allow_tex
 			// If the tag name of this entity does not resolve to a valid token, generate a warning.
 
 			if ((*tag_token = get_token(entity_ptr->text)) == TOKEN_NONE)
-				warning(entity_ptr->line_no, "Unrecognised tag name <I>%s</I>", entity_ptr->text);
+				warning(entity_ptr->line_no, "Unrecognised tag name <I>%s</I>", (char *)entity_ptr->text);
 
 			// Otherwise attempt to match the tag entity against the tag definition list.
 
@@ -4422,7 +4422,7 @@ parse_next_nested_tag(int start_tag_token, tag_def *tag_def_list, bool allow_tex
 						// If the tag entity has a nested entity list but shouldn't, generate a warning.
 
 						if (entity_ptr->nested_entity_list != NULL && !tag_def_ptr->is_start_tag)
-							warning("The <I>%s</I> tag does not permit anything inside of it", entity_ptr->text);
+							warning("The <I>%s</I> tag does not permit anything inside of it", (char *)entity_ptr->text);
 
 						// Parse the attribute list, if there is one.  If there are missing or bad required attributes,
 						// break out of this loop and switch case, and skip over this tag entity below.
@@ -4435,7 +4435,7 @@ parse_next_nested_tag(int start_tag_token, tag_def *tag_def_list, bool allow_tex
 					tag_def_ptr++;
 				}
 				if (tag_def_ptr->token == TOKEN_NONE) {
-					warning(entity_ptr->line_no, "The <I>%s</I> tag is not permitted inside of the <I>%s</I> tag", entity_ptr->text, get_name(start_tag_token));
+					warning(entity_ptr->line_no, "The <I>%s</I> tag is not permitted inside of the <I>%s</I> tag", (char *)entity_ptr->text, (char *)(get_name(start_tag_token)));
 				}
 			}
 		}
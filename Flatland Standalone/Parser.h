@@ -3,7 +3,7 @@
 // This code is licensed under the MIT license (see LICENCE file for details).
 //******************************************************************************
 
-#include "tokens.h"
+#include "Tokens.h"
 
 // Attribute definition structure.
 
@@ -217,7 +217,7 @@ run_event_loop();
 // Thread functions.
 
 unsigned long
-start_thread(void (*thread_func)(void *arg_list));
+start_thread(void (*thread_func)(void *arg_list), void *arg_list = NULL);
 
 void
 wait_for_thread_termination(unsigned long thread_handle);
@@ -225,6 +225,9 @@ wait_for_thread_termination(unsigned long thread_handle);
 void
 decrease_thread_priority(void);
 
+int
+get_processor_count(void);
+
 // Main window functions (called by the plugin thread only).
 
 void
@@ -252,16 +255,16 @@ app_window_is_minimised(void);
 // Message functions.
 
 void
-debug_message(char *format, ...);
+debug_message(const char *format, ...);
 
 void
-fatal_error(char *title, char *format, ...);
+fatal_error(const char *title, const char *format, ...);
 
 void
-information(char *title, char *format, ...);
+information(const char *title, const char *format, ...);
 
 bool
-query(char *title, bool yes_no_format, char *format, ...);
+query(const char *title, bool yes_no_format, const char *format, ...);
 
 // URL functions.
 
@@ -395,6 +398,9 @@ clear_builder_frame_buffer();
 
 // Software rendering functions (called by the player thread only).
 
+int
+get_lit_image_size(int image_dimensions, int *lit_image_levels_ptr);
+
 bool
 create_lit_image(cache_entry *cache_entry_ptr, int image_dimensions);
 
@@ -521,11 +527,16 @@ enable_mouse_look_mode(void);
 void
 disable_mouse_look_mode(void);
 
-// Time function.
+// Time functions.  The game time returned by get_time_ms() may be simulated,
+// so anything that must be bounded in real time, such as a script's time
+// slice, uses get_real_time_ms() instead.
 
 int
 get_time_ms(void);
 
+int
+get_real_time_ms(void);
+
 // Functions to load wave data.
 
 bool
@@ -561,6 +572,20 @@ stop_sound(sound *sound_ptr);
 void
 update_sound(sound *sound_ptr, vertex *translation_ptr);
 
+// Headless functions (POSIX platform only, called by the command-line runner).
+
+void
+set_frame_callback(void (*frame_callback)(byte *frame_buffer_ptr, int row_pitch));
+
+void
+set_time_step(int time_step_ms);
+
+void
+set_frame_timeout(int frame_timeout_ms);
+
+void
+request_quit(int exit_status);
+
 #ifdef STREAMING_MEDIA
 
 // Functions to control playing of streaming media.
@@ -9,7 +9,6 @@
 #include <string.h>
 #include <time.h>
 #include <math.h>
-#include <direct.h>
 #include "Classes.h"
 #include "Fileio.h"
 #include "Image.h"
@@ -18,7 +17,7 @@
 #include "Parser.h"
 #include "Platform.h"
 #include "Plugin.h"
-#include "resource.h"
+#include "Portable.h"
 #include "SimKin.h"
 #include "Spans.h"
 
@@ -104,6 +103,9 @@ semaphore<int> curr_turn_rate;
 semaphore<float> master_brightness;
 semaphore<bool> use_classic_controls;
 semaphore<int> visible_block_radius;
+semaphore<int> render_thread_count;
+semaphore<int> texture_cache_size;
+semaphore<bool> texel_shading;
 semaphore<bool> fly_mode;
 semaphore<bool> build_mode;
 semaphore<block_def *> selected_block_def_ptr;
@@ -1336,6 +1338,9 @@ run_app(void *instance_handle, int show_command, char *spot_file_path)
 	master_brightness.create_semaphore();
 	use_classic_controls.create_semaphore();
 	visible_block_radius.create_semaphore();
+	render_thread_count.create_semaphore();
+	texture_cache_size.create_semaphore();
+	texel_shading.create_semaphore();
 	downloaded_URL.create_semaphore();
 	downloaded_file_path.create_semaphore();
 	fly_mode.create_semaphore();
@@ -1488,6 +1493,9 @@ shut_down_app()
 	master_brightness.destroy_semaphore();
 	use_classic_controls.destroy_semaphore();
 	visible_block_radius.destroy_semaphore();
+	render_thread_count.destroy_semaphore();
+	texture_cache_size.destroy_semaphore();
+	texel_shading.destroy_semaphore();
 	downloaded_URL.destroy_semaphore();
 	downloaded_file_path.destroy_semaphore();
 	fly_mode.destroy_semaphore();
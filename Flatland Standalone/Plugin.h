@@ -15,6 +15,10 @@
 
 #define DEFAULT_VIEW_RADIUS			50
 
+// Default texture cache size (in megabytes).
+
+#define DEFAULT_TEXTURE_CACHE_SIZE	64
+
 // Minimum, maximum and default move rates (in units of blocks).
 
 #define MIN_MOVE_RATE				1
@@ -106,6 +110,9 @@ extern semaphore<int> curr_turn_rate;
 extern semaphore<float> master_brightness;
 extern semaphore<bool> use_classic_controls;
 extern semaphore<int> visible_block_radius;
+extern semaphore<int> render_thread_count;
+extern semaphore<int> texture_cache_size;
+extern semaphore<bool> texel_shading;
 extern semaphore<bool> fly_mode;
 extern semaphore<bool> build_mode;
 extern semaphore<block_def *> selected_block_def_ptr;
@@ -0,0 +1,61 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// The shared modules use the names of the Microsoft C runtime.  On other
+// systems this maps those names onto their POSIX equivalents; the functions
+// that have no direct equivalent are implemented in Posix.cpp.  It also defines
+// the path separator, for the modules that build file paths.
+
+#ifdef _WIN32
+
+#include <direct.h>
+#include <io.h>
+
+// The character that separates the directories in a file path.
+
+#define PATH_SEPARATOR			'\\'
+#define PATH_SEPARATOR_STRING	"\\"
+
+#else
+
+#include <limits.h>
+#include <stdio.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define PATH_SEPARATOR			'/'
+#define PATH_SEPARATOR_STRING	"/"
+
+#define _MAX_PATH				PATH_MAX
+#define _A_SUBDIR				0x10
+
+#define stricmp					strcasecmp
+#define _stricmp				strcasecmp
+#define _strnicmp				strncasecmp
+#define _vsnprintf				vsnprintf
+#define _mkdir(dir_path)		mkdir(dir_path, 0777)
+
+// File information returned by _findfirst and _findnext.
+
+struct _finddata_t {
+	unsigned attrib;
+	long size;
+	char name[NAME_MAX + 1];
+};
+
+long
+_findfirst(const char *path, struct _finddata_t *file_info_ptr);
+
+int
+_findnext(long find_handle, struct _finddata_t *file_info_ptr);
+
+int
+_findclose(long find_handle);
+
+char *
+_fullpath(char *full_path, const char *path, size_t size);
+
+#endif
@@ -0,0 +1,2572 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Headless implementation of the platform API, for POSIX systems.  There are
+// no windows, no sound and no hardware acceleration: the software renderer
+// draws into an in-memory 32-bit frame buffer, which is handed to a callback
+// after every frame.  This is driven by the command-line runner in
+// "Flatland Headless.cpp".
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <math.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Classes.h"
+#include "Fileio.h"
+#include "Image.h"
+#include "Light.h"
+#include "Main.h"
+#include "Memory.h"
+#include "Parser.h"
+#include "Platform.h"
+#include "Plugin.h"
+#include "Portable.h"
+#include "Raster.h"
+#include "Render.h"
+#include "Spans.h"
+#include "Utils.h"
+
+//==============================================================================
+// Global definitions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Event class.
+//------------------------------------------------------------------------------
+
+// Event data, which behaves like an auto-reset event: a sent event stays
+// signalled until one thread sees it.
+
+struct event_data {
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool signalled;
+};
+
+// Default constructor initialises event handle and value.
+
+event::event()
+{
+	event_handle = NULL;
+	event_value = false;
+}
+
+// Default destructor does nothing.
+
+event::~event()
+{
+}
+
+// Method to create the event handle.
+
+void
+event::create_event(void)
+{
+	event_data *event_data_ptr;
+
+	NEW(event_data_ptr, event_data);
+	if (event_data_ptr != NULL)
+		event_data_ptr->signalled = false;
+	event_handle = event_data_ptr;
+}
+
+// Method to destroy the event handle.
+
+void
+event::destroy_event(void)
+{
+	event_data *event_data_ptr = (event_data *)event_handle;
+	if (event_data_ptr != NULL) {
+		DEL(event_data_ptr, event_data);
+		event_handle = NULL;
+	}
+}
+
+// Method to send an event.
+
+void
+event::send_event(bool value)
+{
+	event_data *event_data_ptr = (event_data *)event_handle;
+	std::lock_guard<std::mutex> lock(event_data_ptr->mutex);
+	event_value = value;
+	event_data_ptr->signalled = true;
+	event_data_ptr->condition.notify_one();
+}
+
+// Method to reset an event.
+
+void
+event::reset_event(void)
+{
+	event_data *event_data_ptr = (event_data *)event_handle;
+	std::lock_guard<std::mutex> lock(event_data_ptr->mutex);
+	event_data_ptr->signalled = false;
+	event_value = false;
+}
+
+// Method to check if an event has been sent.
+
+bool
+event::event_sent(void)
+{
+	event_data *event_data_ptr = (event_data *)event_handle;
+	std::lock_guard<std::mutex> lock(event_data_ptr->mutex);
+	if (!event_data_ptr->signalled)
+		return(false);
+	event_data_ptr->signalled = false;
+	return(true);
+}
+
+// Method to wait for an event.
+
+bool
+event::wait_for_event(void)
+{
+	event_data *event_data_ptr = (event_data *)event_handle;
+	std::unique_lock<std::mutex> lock(event_data_ptr->mutex);
+	while (!event_data_ptr->signalled)
+		event_data_ptr->condition.wait(lock);
+	event_data_ptr->signalled = false;
+	return(event_value);
+}
+
+//------------------------------------------------------------------------------
+// Global variables.
+//------------------------------------------------------------------------------
+
+// Application directory.
+
+string app_dir;
+
+// Display and texture pixel formats.
+
+pixel_format display_pixel_format;
+pixel_format texture_pixel_format;
+
+// Largest texture size permitted.
+
+int max_texture_size;
+
+// Display properties.
+
+int window_width;
+int window_height;
+float half_window_width;
+float half_window_height;
+
+// Flag indicating whether the main window is ready.
+
+bool main_window_ready;
+
+// Flag indicating whether sound is on.
+
+bool sound_on;
+
+// Selected cached blockset and loaded blockset (for builder window).
+
+cached_blockset *selected_cached_blockset_ptr;
+blockset *loaded_blockset_ptr;
+
+//==============================================================================
+// Local definitions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Miscellaneous classes.
+//------------------------------------------------------------------------------
+
+// State of a directory search started by _findfirst.
+
+struct find_data {
+	DIR *dir_ptr;
+	char dir_path[_MAX_PATH];
+	char pattern[NAME_MAX + 1];
+};
+
+// Wave format, as read from the "fmt " chunk of a wave file.
+
+struct wave_format {
+	word format_tag;
+	word channels;
+	int samples_per_second;
+	int bytes_per_second;
+	word block_align;
+	word bits_per_sample;
+};
+
+//------------------------------------------------------------------------------
+// Local variables.
+//------------------------------------------------------------------------------
+
+// Default size of the main window, used if the runner didn't set one.
+
+#define DEFAULT_WINDOW_WIDTH	640
+#define DEFAULT_WINDOW_HEIGHT	480
+
+// The display depth is always 32 bits.
+
+#define DISPLAY_DEPTH			32
+
+// Time between calls to the timer callback, in milliseconds.
+
+#define TIMER_PERIOD_MS			30
+
+// Pixel mask table for component sizes of 1 to 8 bits.
+
+static int pixel_mask_table[8] = {
+	0x80, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC, 0xFE, 0xFF
+};
+
+// Lighting tables.
+
+static pixel *light_table[BRIGHTNESS_LEVELS];
+
+// The standard colour palette.
+
+static RGBcolour standard_RGB_palette[256];
+
+// Builder pixel format.
+
+static pixel_format builder_pixel_format;
+
+// Flag indicating whether a label is currently visible, the label text,
+// and the texture to hold it.
+
+static bool label_visible;
+static string label_text;
+static texture *label_texture_ptr;
+
+// Title text.
+
+static string title_text;
+
+// 32-bit frame buffer for the main window, and 32-bit frame buffer used to
+// create builder icons.
+
+static byte *main_frame_buffer_ptr;
+static byte *builder_frame_buffer_ptr;
+
+// Flag indicating whether the main render target is selected.
+
+static bool main_render_target_selected;
+
+// Current frame buffer being used by the software renderer,
+// along with its row pitch (in bytes), it's pixel depth (in bites),
+// and a pointer to its pixel format.
+
+static byte *frame_buffer_ptr;
+static int frame_buffer_row_pitch;
+static int frame_buffer_depth;
+static pixel_format *frame_buffer_pixel_format_ptr;
+
+// App window data.
+
+static bool main_window_exists;
+static void (*quit_callback_ptr)();
+
+// Main window data.
+
+static void (*key_callback_ptr)(bool key_down, byte key_code);
+static void (*mouse_callback_ptr)(int x, int y, int button_code);
+static void (*timer_callback_ptr)(void);
+static void (*resize_callback_ptr)(void *window_handle, int width, int height);
+static void (*display_callback_ptr)(void);
+
+// Headless runner data: the callback to receive each frame, the fixed time
+// step (zero for real time), the time allowed between frames before giving
+// up (zero for no limit), and the exit status (negative until a quit is
+// requested).
+
+static void (*frame_callback_ptr)(byte *frame_buffer_ptr, int row_pitch);
+static int time_step_ms;
+static int frame_timeout_ms;
+static semaphore<int> exit_status;
+
+// Start time of the real time clock, the simulated time when a fixed time
+// step is used, and the real time the last frame was displayed.
+
+static std::chrono::steady_clock::time_point clock_start_time;
+static semaphore<int> simulated_time_ms;
+static semaphore<int> last_frame_time_ms;
+
+//==============================================================================
+// Private functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Functions to display error messages that begin with common phrases.
+//------------------------------------------------------------------------------
+
+static void
+failed_to_create(const char *message)
+{
+	diagnose("Failed to create the %s", message);
+}
+
+//------------------------------------------------------------------------------
+// Create an 8-bit pixmap with a 2-colour palette and assigned it to the given
+// texture.  The pixmap will be used for displaying text.
+//------------------------------------------------------------------------------
+
+static bool
+create_pixmap_for_text(texture *texture_ptr, int width, int height,
+					   RGBcolour text_colour, RGBcolour *bg_colour_ptr)
+{
+	pixmap *pixmap_ptr;
+	RGBcolour RGB_palette[2];
+
+	// Create the pixmap object and initialise it.
+
+	NEWARRAY(pixmap_ptr, pixmap, 1);
+	if (pixmap_ptr == NULL)
+		return(false);
+	pixmap_ptr->bytes_per_pixel = 1;
+	pixmap_ptr->image_size = width * height;
+	pixmap_ptr->size_index = get_size_index(width, height);
+	NEWARRAY(pixmap_ptr->image_ptr, imagebyte, pixmap_ptr->image_size);
+	if (pixmap_ptr->image_ptr == NULL)
+		return(false);
+	pixmap_ptr->width = width;
+	pixmap_ptr->height = height;
+	if (bg_colour_ptr == NULL)
+		pixmap_ptr->transparent_index = 2;
+	else
+		pixmap_ptr->transparent_index = -1;
+
+	// Initialise the pixel with either the background colour or the
+	// transparent index.
+
+	if (bg_colour_ptr == NULL)
+		memset(pixmap_ptr->image_ptr, 2, pixmap_ptr->image_size);
+	else
+		memset(pixmap_ptr->image_ptr, 0, pixmap_ptr->image_size);
+
+	// Initialise the texture.
+
+	texture_ptr->bytes_per_pixel = 1;
+	texture_ptr->transparent = (bg_colour_ptr == NULL);
+	texture_ptr->width = width;
+	texture_ptr->height = height;
+	texture_ptr->pixmaps = 1;
+	texture_ptr->pixmap_list = pixmap_ptr;
+
+	// Use a two-colour palette containing the background and text colours as
+	// the only entries.
+
+	if (bg_colour_ptr != NULL)
+		RGB_palette[0].set(*bg_colour_ptr);
+	RGB_palette[1].set(text_colour);
+	if (!texture_ptr->create_RGB_palette(2, BRIGHTNESS_LEVELS, RGB_palette))
+		return(false);
+
+	// Create the texture and display palette lists.
+
+	if (!texture_ptr->create_texture_palette_list() ||
+		!texture_ptr->create_display_palette_list())
+		return(false);
+
+	// Indicate success.
+
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Function to compute constants for converting a colour component to a value
+// that forms part of a pixel value.
+//------------------------------------------------------------------------------
+
+static void
+set_component(pixel component_mask, pixel &pixel_mask, int &right_shift,
+			  int &left_shift)
+{
+	int component_size;
+
+	// Count the number of zero bits in the component mask, starting from the
+	// rightmost bit.  This is the left shift.
+
+	left_shift = 0;
+	while ((component_mask & 1) == 0 && left_shift < 32) {
+		component_mask >>= 1;
+		left_shift++;
+	}
+
+	// Count the number of one bits in the component mask, starting from the
+	// rightmost bit.  This is the component size.
+
+	component_size = 0;
+	while ((component_mask & 1) == 1 && left_shift + component_size < 32) {
+		component_mask >>= 1;
+		component_size++;
+	}
+	if (component_size > 8)
+		component_size = 8;
+
+	// Compute the right shift as 8 - component size.  Use the component size to
+	// look up the pixel mask in a table.
+
+	right_shift = 8 - component_size;
+	pixel_mask = pixel_mask_table[component_size - 1];
+}
+
+//------------------------------------------------------------------------------
+// Set up a pixel format based upon the component masks.
+//------------------------------------------------------------------------------
+
+static void
+set_pixel_format(pixel_format *pixel_format_ptr, pixel red_comp_mask,
+				 pixel green_comp_mask, pixel blue_comp_mask,
+				 pixel alpha_comp_mask)
+{
+	set_component(red_comp_mask, pixel_format_ptr->red_mask,
+		pixel_format_ptr->red_right_shift, pixel_format_ptr->red_left_shift);
+	set_component(green_comp_mask, pixel_format_ptr->green_mask,
+		pixel_format_ptr->green_right_shift, pixel_format_ptr->green_left_shift);
+	set_component(blue_comp_mask, pixel_format_ptr->blue_mask,
+		pixel_format_ptr->blue_right_shift, pixel_format_ptr->blue_left_shift);
+	pixel_format_ptr->alpha_comp_mask = alpha_comp_mask;
+}
+
+//------------------------------------------------------------------------------
+// Allocate and create the light tables.
+//------------------------------------------------------------------------------
+
+static bool
+create_light_tables(void)
+{
+	int table, index;
+	float red, green, blue;
+	float brightness;
+	RGBcolour colour;
+
+	// Create a light table for each brightness level.
+
+	for (table = 0; table < BRIGHTNESS_LEVELS; table++) {
+
+		// Create a table of 32768 pixels.
+
+		if ((light_table[table] = new pixel[65536]) == NULL)
+			return(false);
+
+		// Choose a brightness factor for this table.
+
+		brightness = (float)(MAX_BRIGHTNESS_INDEX - table) /
+			(float)MAX_BRIGHTNESS_INDEX;
+
+		// Step through the 32768 RGB combinations, and convert each one to a
+		// display pixel at the chosen brightness.
+
+		index = 0;
+		for (red = 0.0f; red < 256.0f; red += 8.0f)
+			for (green = 0.0f; green < 256.0f; green += 8.0f)
+				for (blue = 0.0f; blue < 256.0f; blue += 8.0f) {
+					colour.set_RGB(red, green, blue);
+					colour.adjust_brightness(brightness);
+					light_table[table][index] = RGB_to_display_pixel(colour);
+					index++;
+				}
+	}
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Create the standard palette (a 6x6x6 colour cube).
+//------------------------------------------------------------------------------
+
+static void
+create_standard_palette()
+{
+	int index, red, green, blue;
+
+	// Create the 6x6x6 colour cube.
+
+	index = 0;
+	for (red = 0; red < 6; red++)
+		for (green = 0; green < 6; green++)
+			for (blue = 0; blue < 6; blue++) {
+				standard_RGB_palette[index].red = (byte)(0x33 * red);
+				standard_RGB_palette[index].green = (byte)(0x33 * green);
+				standard_RGB_palette[index].blue = (byte)(0x33 * blue);
+				index++;
+			}
+
+	// Assign the usual menu colour to the next available palette entry.
+
+	standard_RGB_palette[index].red = 0xf0;
+	standard_RGB_palette[index].green = 0xf0;
+	standard_RGB_palette[index].blue = 0xf0;
+	index++;
+
+	// Fill the remaining palette entries with black.
+
+	while (index < 256) {
+		standard_RGB_palette[index].red = 0;
+		standard_RGB_palette[index].green = 0;
+		standard_RGB_palette[index].blue = 0;
+		index++;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Write a message to the standard error stream, prefixed by a title if there
+// is one.
+//------------------------------------------------------------------------------
+
+static void
+write_message(const char *title, const char *message)
+{
+	if (title != NULL)
+		fprintf(stderr, "%s: %s\n", title, message);
+	else
+		fprintf(stderr, "%s\n", message);
+	fflush(stderr);
+}
+
+//------------------------------------------------------------------------------
+// Create a directory if it doesn't already exist.
+//------------------------------------------------------------------------------
+
+static void
+create_directory(const char *dir_path)
+{
+	struct stat stat_buffer;
+
+	if (stat(dir_path, &stat_buffer) != 0)
+		mkdir(dir_path, 0755);
+}
+
+//------------------------------------------------------------------------------
+// Copy a file.
+//------------------------------------------------------------------------------
+
+static bool
+copy_file(const char *source_file_path, const char *target_file_path)
+{
+	FILE *source_fp, *target_fp;
+	char buffer[BUFSIZ];
+	size_t bytes;
+	bool result;
+
+	if ((source_fp = fopen(source_file_path, "rb")) == NULL)
+		return(false);
+	if ((target_fp = fopen(target_file_path, "wb")) == NULL) {
+		fclose(source_fp);
+		return(false);
+	}
+	result = true;
+	while ((bytes = fread(buffer, 1, BUFSIZ, source_fp)) > 0) {
+		if (fwrite(buffer, 1, bytes, target_fp) != bytes) {
+			result = false;
+			break;
+		}
+	}
+	fclose(source_fp);
+	fclose(target_fp);
+	return(result);
+}
+
+//------------------------------------------------------------------------------
+// Read a little-endian 16-bit or 32-bit value from a buffer.
+//------------------------------------------------------------------------------
+
+static word
+read_word(byte *buffer_ptr)
+{
+	return((word)(buffer_ptr[0] | (buffer_ptr[1] << 8)));
+}
+
+static int
+read_int(byte *buffer_ptr)
+{
+	return(buffer_ptr[0] | (buffer_ptr[1] << 8) | (buffer_ptr[2] << 16) |
+		(buffer_ptr[3] << 24));
+}
+
+//==============================================================================
+// Semaphore functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Create a semaphore, and return a handle to it.  A recursive mutex is used
+// since the Win32 critical sections it replaces may be entered more than once
+// by the same thread.
+//------------------------------------------------------------------------------
+
+void *
+create_semaphore(void)
+{
+	std::recursive_mutex *mutex_ptr;
+
+	NEW(mutex_ptr, std::recursive_mutex);
+	return(mutex_ptr);
+}
+
+//------------------------------------------------------------------------------
+// Destroy a semaphore.
+//------------------------------------------------------------------------------
+
+void
+destroy_semaphore(void *semaphore_handle)
+{
+	std::recursive_mutex *mutex_ptr = (std::recursive_mutex *)semaphore_handle;
+	if (mutex_ptr != NULL)
+		DEL(mutex_ptr, std::recursive_mutex);
+}
+
+//------------------------------------------------------------------------------
+// Raise a semaphore.
+//------------------------------------------------------------------------------
+
+void
+raise_semaphore(void *semaphore_handle)
+{
+	((std::recursive_mutex *)semaphore_handle)->lock();
+}
+
+//------------------------------------------------------------------------------
+// Lower a semaphore.
+//------------------------------------------------------------------------------
+
+void
+lower_semaphore(void *semaphore_handle)
+{
+	((std::recursive_mutex *)semaphore_handle)->unlock();
+}
+
+//==============================================================================
+// Start up and shut down functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Start up the platform API.
+//------------------------------------------------------------------------------
+
+bool
+start_up_platform_API(void * /* instance_handle */, int /* show_command */, void (*quit_callback)())
+{
+	char buffer[_MAX_PATH];
+	char *app_name;
+	ssize_t length;
+	FILE *fp;
+
+	// Initialise global variables.
+
+	quit_callback_ptr = quit_callback;
+	main_window_exists = false;
+	main_window_ready = false;
+
+	// Start the clock, and create the semaphores used by the runner.
+
+	clock_start_time = std::chrono::steady_clock::now();
+	exit_status.create_semaphore();
+	simulated_time_ms.create_semaphore();
+	last_frame_time_ms.create_semaphore();
+	exit_status.set(-1);
+	simulated_time_ms.set(0);
+	last_frame_time_ms.set(0);
+
+	// Find the path to the executable, and strip out the file name.  If that
+	// can't be done, use the current directory.
+
+	if ((length = readlink("/proc/self/exe", buffer, _MAX_PATH - 1)) > 0) {
+		buffer[length] = '\0';
+		app_name = strrchr(buffer, '/') + 1;
+		*app_name = '\0';
+	} else if (getcwd(buffer, _MAX_PATH - 1) != NULL)
+		strcat(buffer, "/");
+	else
+		strcpy(buffer, "./");
+	app_dir = buffer;
+
+	// Determine the path to the Flatland directory, and create it if it
+	// doesn't exist yet.
+
+	flatland_dir = app_dir + "Flatland/";
+	create_directory(flatland_dir);
+
+	// Determine the path to various files in the Flatland directory.
+
+	log_file_path = flatland_dir + "log.txt";
+	error_log_file_path = flatland_dir + "errlog.html";
+	prev_error_log_file_path = flatland_dir + "prev_errlog.html";
+	config_file_path = flatland_dir + "config.txt";
+	version_file_path = flatland_dir + "version.txt";
+	curr_spot_file_path = flatland_dir + "curr_spot.txt";
+	cache_file_path = flatland_dir + "cache.txt";
+	new_rover_file_path = flatland_dir + "new_rover.txt";
+
+	// Clear the log file.
+
+	if ((fp = fopen(log_file_path, "w")) != NULL)
+		fclose(fp);
+
+	// Return sucess status.
+
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Shut down the platform API.
+//------------------------------------------------------------------------------
+
+void
+shut_down_platform_API(void)
+{
+	exit_status.destroy_semaphore();
+	simulated_time_ms.destroy_semaphore();
+	last_frame_time_ms.destroy_semaphore();
+}
+
+//------------------------------------------------------------------------------
+// Start up the software renderer.
+//------------------------------------------------------------------------------
+
+static bool
+start_up_software_renderer(void)
+{
+	// Create the frame buffer.
+
+	if (!create_frame_buffer())
+		return(false);
+
+	// Select the main render target.
+
+	select_main_render_target();
+
+	// Indicate success.
+
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Shut down the software renderer.
+//------------------------------------------------------------------------------
+
+static void
+shut_down_software_renderer(void)
+{
+	destroy_frame_buffer();
+}
+
+//------------------------------------------------------------------------------
+// Application event loop.  There are no window messages to dispatch, so the
+// timer callback is simply called periodically until a quit is requested, or
+// no frame has been displayed for too long.
+//------------------------------------------------------------------------------
+
+int
+run_event_loop()
+{
+	int status;
+
+	last_frame_time_ms.set(get_real_time_ms());
+	while ((status = exit_status.get()) < 0) {
+		if (timer_callback_ptr != NULL)
+			(*timer_callback_ptr)();
+		if (frame_timeout_ms > 0 &&
+			get_real_time_ms() - last_frame_time_ms.get() >= frame_timeout_ms) {
+			write_message(NULL, "No frame was displayed before the timeout expired");
+			status = 1;
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(TIMER_PERIOD_MS));
+	}
+	if (quit_callback_ptr != NULL)
+		(*quit_callback_ptr)();
+	return(status);
+}
+
+//==============================================================================
+// Thread functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Start a thread.
+//------------------------------------------------------------------------------
+
+unsigned long
+start_thread(void (*thread_func)(void *arg_list), void *arg_list)
+{
+	std::thread *thread_ptr;
+
+	try {
+		thread_ptr = new std::thread(thread_func, arg_list);
+	}
+	catch (...) {
+		return(0);
+	}
+	return((unsigned long)thread_ptr);
+}
+
+//------------------------------------------------------------------------------
+// Wait for a thread to terminate.
+//------------------------------------------------------------------------------
+
+void
+wait_for_thread_termination(unsigned long thread_handle)
+{
+	std::thread *thread_ptr = (std::thread *)thread_handle;
+	if (thread_ptr->joinable())
+		thread_ptr->join();
+	delete thread_ptr;
+}
+
+//------------------------------------------------------------------------------
+// Decrease a thread's priority.  Thread priorities are left alone, so that
+// timings taken on a benchmark host aren't skewed by the scheduler.
+//------------------------------------------------------------------------------
+
+void
+decrease_thread_priority(void)
+{
+}
+
+//------------------------------------------------------------------------------
+// Return the number of logical processors.
+//------------------------------------------------------------------------------
+
+int
+get_processor_count(void)
+{
+	int processors = (int)std::thread::hardware_concurrency();
+	return(processors > 0 ? processors : 1);
+}
+
+//==============================================================================
+// Main window functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Set the main window size.
+//------------------------------------------------------------------------------
+
+void
+set_main_window_size(int width, int height)
+{
+	window_width = width;
+	window_height = height;
+	half_window_width = (float)width / 2.0f;
+	half_window_height = (float) height / 2.0f;
+}
+
+//------------------------------------------------------------------------------
+// Create the main window, which is just the frame buffer.
+//------------------------------------------------------------------------------
+
+bool
+create_main_window(void (*key_callback)(bool key_down, byte key_code),
+				   void (*mouse_callback)(int x, int y, int button_code),
+				   void (*timer_callback)(void),
+				   void (*resize_callback)(void *window_handle, int width,
+										   int height),
+				   void (*display_callback)(void))
+{
+	int index;
+
+	// Do nothing if the main window already exists.
+
+	if (main_window_exists)
+		return(false);
+
+	// Initialise the global variables.
+
+	main_frame_buffer_ptr = NULL;
+	builder_frame_buffer_ptr = NULL;
+	frame_buffer_ptr = NULL;
+	label_texture_ptr = NULL;
+	label_visible = false;
+	max_texture_size = MAX_TEXTURE_SIZE;
+	for (index = 0; index < BRIGHTNESS_LEVELS; index++)
+		light_table[index] = NULL;
+
+	// Set the maximum number of active lights.
+
+	max_active_lights = ACTIVE_LIGHTS_LIMIT;
+
+	// Use the main window size set by the runner, or the default size.
+
+	main_window_exists = true;
+	if (window_width <= 0 || window_height <= 0)
+		set_main_window_size(DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT);
+
+	// Save the pointers to the callback functions.
+
+	key_callback_ptr = key_callback;
+	mouse_callback_ptr = mouse_callback;
+	timer_callback_ptr = timer_callback;
+	resize_callback_ptr = resize_callback;
+	display_callback_ptr = display_callback;
+
+	// There is no hardware accelerated renderer, so start up the software
+	// renderer.
+
+	hardware_acceleration = false;
+	if (!start_up_software_renderer()) {
+		fatal_error("Flatland cannot start up", "Flatland was unable to "
+			"create a frame buffer.");
+		return(false);
+	}
+
+	// The texture pixel format is 1555 ARGB, and the display and builder pixel
+	// formats are 8888 ARGB.
+
+	set_pixel_format(&texture_pixel_format, 0x7c00, 0x03e0, 0x001f, 0x8000);
+	set_pixel_format(&builder_pixel_format, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+	set_pixel_format(&display_pixel_format, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+
+	// Create the standard RGB colour palette.
+
+	create_standard_palette();
+
+	// Create the light tables.
+
+	if (!create_light_tables()) {
+		failed_to_create("light tables");
+		return(false);
+	}
+
+	// Create the label texture.
+
+	if (!create_label_texture()) {
+		failed_to_create("label texture");
+		return(false);
+	}
+
+	// There is no sound.
+
+	sound_on = false;
+
+	// Indicate the main window is ready.
+
+	main_window_ready = true;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Resize the main window.
+//------------------------------------------------------------------------------
+
+void
+resize_main_window()
+{
+}
+
+//------------------------------------------------------------------------------
+// Destroy the main window.
+//------------------------------------------------------------------------------
+
+void
+destroy_main_window(void)
+{
+	int index;
+
+	// Do nothing if the main window doesn't exist.
+
+	if (!main_window_exists)
+		return;
+
+	// Destroy the label texture.
+
+	destroy_label_texture();
+
+	// Delete the light tables.
+
+	for (index = 0; index < BRIGHTNESS_LEVELS; index++) {
+		if (light_table[index] != NULL) {
+			delete []light_table[index];
+			light_table[index] = NULL;
+		}
+	}
+
+	// Shut down the software renderer.
+
+	shut_down_software_renderer();
+
+	// Reset the main window flag and the main window ready flag.
+
+	main_window_exists = false;
+	main_window_ready = false;
+}
+
+//------------------------------------------------------------------------------
+// Determine if the app window is currently minimised.
+//------------------------------------------------------------------------------
+
+bool
+app_window_is_minimised(void)
+{
+	return(false);
+}
+
+//==============================================================================
+// Message functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Function to display a message on the standard error stream.
+//------------------------------------------------------------------------------
+
+void
+debug_message(const char *format, ...)
+{
+	va_list arg_ptr;
+	char message[BUFSIZ];
+
+	// Create a message string by parsing the variable argument list according
+	// to the contents of the format string.
+
+	va_start(arg_ptr, format);
+	vbprintf(message, BUFSIZ, format, arg_ptr);
+	va_end(arg_ptr);
+	fputs(message, stderr);
+}
+
+//------------------------------------------------------------------------------
+// Function to display a fatal error message.  There's nobody to read it, so
+// the runner is asked to quit with a failure status.
+//------------------------------------------------------------------------------
+
+void
+fatal_error(const char *title, const char *format, ...)
+{
+	va_list arg_ptr;
+	char message[BUFSIZ];
+
+	va_start(arg_ptr, format);
+	vbprintf(message, BUFSIZ, format, arg_ptr);
+	va_end(arg_ptr);
+	write_message(title, message);
+	request_quit(1);
+}
+
+//------------------------------------------------------------------------------
+// Function to display an informational message.
+//------------------------------------------------------------------------------
+
+void
+information(const char *title, const char *format, ...)
+{
+	va_list arg_ptr;
+	char message[BUFSIZ];
+
+	va_start(arg_ptr, format);
+	vbprintf(message, BUFSIZ, format, arg_ptr);
+	va_end(arg_ptr);
+	write_message(title, message);
+}
+
+//------------------------------------------------------------------------------
+// Function to display a query.  There's nobody to answer it, so the answer is
+// always no.
+//------------------------------------------------------------------------------
+
+bool
+query(const char *title, bool /* yes_no_format */, const char *format, ...)
+{
+	va_list arg_ptr;
+	char message[BUFSIZ];
+
+	va_start(arg_ptr, format);
+	vbprintf(message, BUFSIZ, format, arg_ptr);
+	va_end(arg_ptr);
+	write_message(title, message);
+	return(false);
+}
+
+//==============================================================================
+// URL functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Open a URL in the default external app.
+//------------------------------------------------------------------------------
+
+void
+open_URL_in_default_app(const char *URL)
+{
+	write_message("Not opening URL", URL);
+}
+
+//------------------------------------------------------------------------------
+// Download a URL to a file or the cache.  Only local files are supported; if
+// no file path was provided the file is used where it is, otherwise it is
+// copied to that file path.
+//------------------------------------------------------------------------------
+
+bool
+download_URL_to_file(const char *URL, char *file_path_buffer, bool /* no_cache */)
+{
+	const char *file_path;
+	struct stat stat_buffer;
+
+	// Strip the "file://" scheme if present, and reject any other scheme.
+
+	if (!strncasecmp(URL, "file://localhost/", 17))
+		file_path = URL + 16;
+	else if (!strncasecmp(URL, "file://", 7))
+		file_path = URL + 7;
+	else if (strstr(URL, "://") != NULL) {
+		write_message("Cannot download URL", URL);
+		return(false);
+	} else
+		file_path = URL;
+
+	// Make sure the file exists.
+
+	if (stat(file_path, &stat_buffer) != 0 || !S_ISREG(stat_buffer.st_mode))
+		return(false);
+
+	// If no file path was provided, return the path to the file itself.
+	// Otherwise copy it to the file path provided.
+
+	if (*file_path_buffer == '\0') {
+		strncpy(file_path_buffer, file_path, _MAX_PATH - 1);
+		file_path_buffer[_MAX_PATH - 1] = '\0';
+		return(true);
+	}
+	return(copy_file(file_path, file_path_buffer));
+}
+
+//------------------------------------------------------------------------------
+// Open a file dialog.
+//------------------------------------------------------------------------------
+
+bool
+open_file_dialog(char * /* file_path_buffer */, int /* buffer_size */)
+{
+	return(false);
+}
+
+//==============================================================================
+// Dialog windows, none of which exist.
+//==============================================================================
+
+void
+open_new_spot_window(void)
+{
+}
+
+void
+close_new_spot_window(void)
+{
+}
+
+void
+open_light_window(float /* brightness */, void (* /* light_callback */)(float brightness,
+				  bool window_closed))
+{
+}
+
+void
+close_light_window(void)
+{
+}
+
+void
+open_options_window(int /* viewing_distance_value */, bool /* use_classic_controls_value */,
+					int /* move_rate_value */, int /* turn_rate_value */, bool /* force_software_rendering */,
+					void (* /* options_callback */)(int option_ID, int option_value))
+{
+}
+
+void
+close_options_window(void)
+{
+}
+
+void
+open_about_window(void)
+{
+}
+
+void
+close_about_window(void)
+{
+}
+
+void
+open_help_window(void)
+{
+}
+
+void
+close_help_window(void)
+{
+}
+
+void
+open_blockset_manager_window(void)
+{
+}
+
+void
+close_blockset_manager_window(void)
+{
+}
+
+void
+open_builder_window()
+{
+}
+
+void
+close_builder_window()
+{
+}
+
+//==============================================================================
+// Bitmap functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Create a 32-bit bitmap of the given size.  The bitmap handle is the pixel
+// data itself.
+//------------------------------------------------------------------------------
+
+static bitmap *
+create_bitmap(int width, int height)
+{
+	bitmap *bitmap_ptr;
+
+	NEW(bitmap_ptr, bitmap);
+	if (bitmap_ptr == NULL)
+		return(NULL);
+	NEWARRAY(bitmap_ptr->pixels, byte, width * height * 4);
+	if (bitmap_ptr->pixels == NULL) {
+		DEL(bitmap_ptr, bitmap);
+		return(NULL);
+	}
+	bitmap_ptr->handle = bitmap_ptr->pixels;
+	bitmap_ptr->width = width;
+	bitmap_ptr->height = height;
+	bitmap_ptr->bytes_per_row = width * 4;
+	return(bitmap_ptr);
+}
+
+//------------------------------------------------------------------------------
+// Create a bitmap and initialize it with the first pixmap of the given texture.
+// The bitmap will use 32-bit pixels regardless of the pixel depth of the
+// texture.
+//------------------------------------------------------------------------------
+
+bitmap *
+create_bitmap_from_texture(texture *texture_ptr)
+{
+	bitmap *bitmap_ptr;
+
+	// Create the bitmap object.
+
+	if ((bitmap_ptr = create_bitmap(texture_ptr->width, texture_ptr->height)) == NULL)
+		return(NULL);
+
+	// Copy the pixel data from the first pixmap of the texture into the bitmap.  Note we only support 8-bit or 32-bit pixel pixmaps.
+
+	pixmap *pixmap_ptr = texture_ptr->pixmap_list;
+	switch (texture_ptr->bytes_per_pixel) {
+	case 1:
+		{
+			byte *source_ptr = pixmap_ptr->image_ptr;
+			pixel *target_ptr = (pixel *)bitmap_ptr->pixels;
+			for (int row = 0; row < texture_ptr->height; row++) {
+				for (int col = 0; col < texture_ptr->width; col++) {
+					int pixel = *source_ptr++;
+					if (pixel == pixmap_ptr->transparent_index) {
+						*target_ptr++ = 0;
+					} else {
+						RGBcolour colour = texture_ptr->RGB_palette[pixel];
+						*target_ptr++ = 0xFF000000 | ((byte)colour.red << 16) | ((byte)colour.green << 8) | (byte)colour.blue;
+					}
+				}
+			}
+		}
+		break;
+	case 4:
+		memcpy(bitmap_ptr->pixels, pixmap_ptr->image_ptr, texture_ptr->width * texture_ptr->height * 4);
+	}
+	return(bitmap_ptr);
+}
+
+//------------------------------------------------------------------------------
+// Create a bitmap and initialize it with the builder frame buffer.
+//------------------------------------------------------------------------------
+
+bitmap *
+create_bitmap_from_builder_render_target()
+{
+	bitmap *bitmap_ptr;
+
+	if ((bitmap_ptr = create_bitmap(BUILDER_ICON_WIDTH, BUILDER_ICON_HEIGHT)) == NULL)
+		return(NULL);
+	memcpy(bitmap_ptr->pixels, builder_frame_buffer_ptr, BUILDER_ICON_WIDTH * BUILDER_ICON_HEIGHT * 4);
+	return(bitmap_ptr);
+}
+
+//------------------------------------------------------------------------------
+// Destroy a bitmap handle.
+//------------------------------------------------------------------------------
+
+void
+destroy_bitmap_handle(void *bitmap_handle)
+{
+	byte *pixels = (byte *)bitmap_handle;
+	if (pixels != NULL)
+		DELARRAY(pixels, byte, 0);
+}
+
+//==============================================================================
+// Label functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Create the label texture.
+//------------------------------------------------------------------------------
+
+bool
+create_label_texture(void)
+{
+	RGBcolour bg_colour, text_colour;
+
+	// Create the label texture.
+
+	NEW(label_texture_ptr, texture);
+	if (label_texture_ptr == NULL)
+		return(false);
+	bg_colour.set_RGB(0x33, 0x33, 0x33);
+	text_colour.set_RGB(0xff, 0xcc, 0x66);
+	if (!create_pixmap_for_text(label_texture_ptr, max_texture_size,
+		TASK_BAR_HEIGHT, text_colour, &bg_colour))
+		return(false);
+
+	// Indicate success.
+
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Destroy the label texture.
+//------------------------------------------------------------------------------
+
+void
+destroy_label_texture(void)
+{
+	if (label_texture_ptr != NULL) {
+		DEL(label_texture_ptr, texture);
+		label_texture_ptr = NULL;
+	}
+}
+
+//==============================================================================
+// Frame buffer functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Select the main render target.
+//------------------------------------------------------------------------------
+
+void
+select_main_render_target()
+{
+	main_render_target_selected = true;
+}
+
+//------------------------------------------------------------------------------
+// Select the builder render target.
+//------------------------------------------------------------------------------
+
+void
+select_builder_render_target()
+{
+	main_render_target_selected = false;
+}
+
+//------------------------------------------------------------------------------
+// Create the frame buffer.
+//------------------------------------------------------------------------------
+
+bool
+create_frame_buffer(void)
+{
+	// Create the 32-bit frame buffer for the main window, cleared to black.
+
+	if ((main_frame_buffer_ptr = new byte[window_width * window_height * 4]) == NULL) {
+		failed_to_create("frame buffer");
+		return(false);
+	}
+	memset(main_frame_buffer_ptr, 0, window_width * window_height * 4);
+
+	// Create a 32-bit frame buffer used to render builder icons.
+
+	if ((builder_frame_buffer_ptr = new byte[BUILDER_ICON_WIDTH * BUILDER_ICON_HEIGHT * 4]) == NULL) {
+		failed_to_create("builder frame buffer");
+		return(false);
+	}
+
+	// Return success status.
+
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Recreate the frame buffer.  Only used by the hardware accelerated renderer.
+//------------------------------------------------------------------------------
+
+bool
+recreate_frame_buffer(void)
+{
+	return(false);
+}
+
+//------------------------------------------------------------------------------
+// Destroy the frame buffer.
+//------------------------------------------------------------------------------
+
+void
+destroy_frame_buffer(void)
+{
+	if (main_frame_buffer_ptr != NULL) {
+		delete []main_frame_buffer_ptr;
+		main_frame_buffer_ptr = NULL;
+	}
+	if (builder_frame_buffer_ptr != NULL) {
+		delete []builder_frame_buffer_ptr;
+		builder_frame_buffer_ptr = NULL;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Lock the frame buffer.
+//------------------------------------------------------------------------------
+
+bool
+lock_frame_buffer()
+{
+	// Don't do anything if the frame buffer is already locked.
+
+	if (frame_buffer_ptr != NULL) {
+		return true;
+	}
+
+	// Use the builder frame buffer if the builder render target has been
+	// selected, otherwise the main frame buffer.
+
+	if (!main_render_target_selected) {
+		frame_buffer_ptr = builder_frame_buffer_ptr;
+		frame_buffer_row_pitch = BUILDER_ICON_WIDTH * 4;
+		frame_buffer_pixel_format_ptr = &builder_pixel_format;
+	} else {
+		frame_buffer_ptr = main_frame_buffer_ptr;
+		frame_buffer_row_pitch = window_width * 4;
+		frame_buffer_pixel_format_ptr = &display_pixel_format;
+	}
+	frame_buffer_depth = DISPLAY_DEPTH;
+
+	// Return success status.
+
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Unlock the frame buffer.
+//------------------------------------------------------------------------------
+
+void
+unlock_frame_buffer(void)
+{
+	frame_buffer_ptr = NULL;
+}
+
+//------------------------------------------------------------------------------
+// Display the frame buffer, by handing it to the frame callback.  If a fixed
+// time step is in use, the simulated time advances by one step per frame.
+//------------------------------------------------------------------------------
+
+bool
+display_frame_buffer(void)
+{
+	if (time_step_ms > 0)
+		simulated_time_ms.set(simulated_time_ms.get() + time_step_ms);
+	last_frame_time_ms.set(get_real_time_ms());
+	if (frame_callback_ptr != NULL)
+		(*frame_callback_ptr)(main_frame_buffer_ptr, window_width * 4);
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Clear the frame buffer (hardware renderer only).
+//------------------------------------------------------------------------------
+
+void
+clear_frame_buffer(void)
+{
+}
+
+//------------------------------------------------------------------------------
+// Method to clear a rectangle in the builder frame buffer (software renderer only).
+//------------------------------------------------------------------------------
+
+void
+clear_builder_frame_buffer(void)
+{
+	memset(builder_frame_buffer_ptr, 0, BUILDER_ICON_WIDTH * BUILDER_ICON_HEIGHT * 4);
+}
+
+//==============================================================================
+// Software rendering functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Return the size in bytes of a lit image with the given dimensions, and
+// optionally the number of mipmap levels in it.
+//------------------------------------------------------------------------------
+
+int
+get_lit_image_size(int image_dimensions, int *lit_image_levels_ptr)
+{
+	int lit_bytes_per_pixel;
+	int lit_image_size;
+	int lit_image_levels;
+
+	// Make room for every mipmap level, down to 1x1.  The size is rounded up
+	// to a whole double word, since texels are gathered a double word at a
+	// time.
+
+	lit_bytes_per_pixel = frame_buffer_depth == 16 ? 2 : 4;
+	lit_image_size = 0;
+	lit_image_levels = 0;
+	while (image_dimensions > 0) {
+		lit_image_size += image_dimensions * image_dimensions *
+			lit_bytes_per_pixel;
+		lit_image_levels++;
+		image_dimensions >>= 1;
+	}
+	if (lit_image_levels_ptr != NULL)
+		*lit_image_levels_ptr = lit_image_levels;
+	return((lit_image_size + 3) & ~3);
+}
+
+//------------------------------------------------------------------------------
+// Create the lit image for a cache entry.
+//------------------------------------------------------------------------------
+
+bool
+create_lit_image(cache_entry *cache_entry_ptr, int image_dimensions)
+{
+	cache_entry_ptr->lit_image_size = get_lit_image_size(image_dimensions,
+		&cache_entry_ptr->lit_image_levels);
+	NEWARRAY(cache_entry_ptr->lit_image_ptr, cachebyte, cache_entry_ptr->lit_image_size);
+	return cache_entry_ptr->lit_image_ptr != NULL;
+}
+
+//------------------------------------------------------------------------------
+// Set a lit image for the given cache entry.
+//------------------------------------------------------------------------------
+
+void
+set_lit_image(cache_entry *cache_entry_ptr, int image_dimensions)
+{
+	pixmap *pixmap_ptr;
+	pixel *palette_ptr;
+	int transparent_index;
+	int lit_bytes_per_pixel;
+	pixel red_comp_mask, green_comp_mask, blue_comp_mask;
+
+	// Get the transparent index and a pointer to the palette for the desired
+	// brightness index.  16-bit pixmaps are lit through the light table.
+
+	pixmap_ptr = cache_entry_ptr->pixmap_ptr;
+	if (pixmap_ptr->bytes_per_pixel == 1) {
+		transparent_index = pixmap_ptr->transparent_index;
+		palette_ptr = pixmap_ptr->display_palette_list +
+			cache_entry_ptr->brightness_index * pixmap_ptr->colours;
+	} else {
+		transparent_index = -1;
+		palette_ptr = light_table[cache_entry_ptr->brightness_index];
+	}
+
+	// Convert the unlit image to a 32-bit lit image.  The transparency mask
+	// is set on every opaque pixel.
+
+	lit_bytes_per_pixel = frame_buffer_depth == 16 ? 2 : 4;
+	convert_image(pixmap_ptr->image_ptr, pixmap_ptr->width, pixmap_ptr->height,
+		pixmap_ptr->bytes_per_pixel, palette_ptr, transparent_index,
+		frame_buffer_pixel_format_ptr->alpha_comp_mask,
+		cache_entry_ptr->lit_image_ptr, image_dimensions, lit_bytes_per_pixel,
+		image_dimensions * lit_bytes_per_pixel);
+
+	// Build the mipmap levels from the lit image.
+
+	get_component_masks(frame_buffer_pixel_format_ptr, red_comp_mask,
+		green_comp_mask, blue_comp_mask);
+	build_mipmaps(cache_entry_ptr->lit_image_ptr, image_dimensions,
+		lit_bytes_per_pixel, red_comp_mask, green_comp_mask, blue_comp_mask,
+		frame_buffer_pixel_format_ptr->alpha_comp_mask);
+}
+
+//------------------------------------------------------------------------------
+// Render a colour span to the frame buffer.
+//------------------------------------------------------------------------------
+
+void
+render_colour_span(span *span_ptr)
+{
+	byte *fb_ptr;
+
+	// Ignore span if it has zero width.
+
+	if (span_ptr->start_sx == span_ptr->end_sx)
+		return;
+
+	// Calculate the frame buffer pointer, and render the span.
+
+	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy +
+		span_ptr->start_sx * (frame_buffer_depth >> 3);
+	draw_colour_span(fb_ptr, frame_buffer_depth, span_ptr->colour_pixel,
+		span_ptr->end_sx - span_ptr->start_sx);
+}
+
+//------------------------------------------------------------------------------
+// Render a transparent span to the frame buffer.  If texels are being shaded,
+// the lit image is at full brightness and the span's brightness is applied as
+// it is drawn.  The mipmap level is chosen from the span's texel step.
+//------------------------------------------------------------------------------
+
+void
+render_transparent_span(span *span_ptr)
+{
+	cache_entry *cache_entry_ptr;
+	texel_shade shade, *shade_ptr;
+	byte *fb_ptr;
+
+	// Ignore span if it has zero width.
+
+	if (span_ptr->start_sx == span_ptr->end_sx)
+		return;
+
+	// Set up the texel shading if it's needed.
+
+	if (shade_texels && span_ptr->brightness_index > 0) {
+		set_texel_shade(&shade, frame_buffer_pixel_format_ptr,
+			span_ptr->brightness_index);
+		shade_ptr = &shade;
+	} else
+		shade_ptr = NULL;
+
+	// Get the lit image data, calculate the frame buffer pointer, and render
+	// the span.  The cache entry was looked up on the player thread before
+	// rendering started; if there is no lit image the span is left undrawn.
+
+	cache_entry_ptr = span_ptr->cache_entry_ptr;
+	if (cache_entry_ptr == NULL)
+		return;
+	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy +
+		span_ptr->start_sx * (frame_buffer_depth >> 3);
+	draw_texture_span(fb_ptr, frame_buffer_depth, span_ptr, cache_entry_ptr,
+		frame_buffer_pixel_format_ptr->alpha_comp_mask, shade_ptr,
+		get_span_mipmap_level(span_ptr, cache_entry_ptr->lit_image_levels));
+}
+
+//------------------------------------------------------------------------------
+// Render a popup span to the frame buffer.
+//------------------------------------------------------------------------------
+
+void
+render_popup_span(span *span_ptr)
+{
+	pixmap *pixmap_ptr;
+	byte *image_ptr, *fb_ptr;
+	pixel *palette_ptr;
+	int transparent_index = 0;
+	pixel transparency_mask32 = 0;
+	int image_width, span_width;
+	fixed u, v;
+
+	// Ignore span if it has zero width.
+
+	if (span_ptr->start_sx == span_ptr->end_sx)
+		return;
+
+	// Get the pointer to the pixmap to render, the display palette for
+	// the desired brightness level, the transparent colour index or mask,
+	// and the image width (in bytes).
+
+	pixmap_ptr = span_ptr->pixmap_ptr;
+	if (pixmap_ptr->bytes_per_pixel == 2) {
+		palette_ptr = light_table[span_ptr->brightness_index];
+		transparency_mask32 = texture_pixel_format.alpha_comp_mask;
+		image_width = pixmap_ptr->width * 2;
+		u = ((int)span_ptr->start_span.u_on_tz % pixmap_ptr->width) * 2;
+	} else {
+		palette_ptr = pixmap_ptr->display_palette_list +
+			span_ptr->brightness_index * pixmap_ptr->colours;
+		transparent_index = pixmap_ptr->transparent_index;
+		image_width = pixmap_ptr->width;
+		u = (int)span_ptr->start_span.u_on_tz % pixmap_ptr->width;
+	}
+	v = (int)span_ptr->start_span.v_on_tz % pixmap_ptr->height;
+
+	// Get the pointer to the starting pixel in the frame buffer, and the
+	// image pointer.
+
+	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy + (span_ptr->start_sx << 2);
+	image_ptr = pixmap_ptr->image_ptr + v * image_width;
+
+	// Render the span.
+
+	span_width = span_ptr->end_sx - span_ptr->start_sx;
+	draw_linear_span(fb_ptr, 32, pixmap_ptr->bytes_per_pixel == 2, image_ptr,
+		palette_ptr, transparent_index, transparency_mask32, image_width,
+		span_width, u);
+}
+
+//------------------------------------------------------------------------------
+// Render a line to the frame buffer.
+//------------------------------------------------------------------------------
+
+static void
+render_line(spoint *spoint1_ptr, spoint *spoint2_ptr, pixel pixel_colour)
+{
+	int x0 = (int)spoint1_ptr->sx;
+	int y0 = (int)spoint1_ptr->sy;
+	int x1 = (int)spoint2_ptr->sx;
+	int y1 = (int)spoint2_ptr->sy;
+	int dx = abs(x1 - x0);
+	int sx = x0 < x1 ? 1 : -1;
+	int dy = abs(y1 - y0);
+	int sy = y0 < y1 ? 1 : -1;
+	int err = (dx > dy ? dx : -dy) / 2;
+	for (;;) {
+		if (x0 >= 0 && x0 < window_width && y0 >= 0 && y0 < window_height)
+			*(pixel *)(frame_buffer_ptr + frame_buffer_row_pitch * y0 + (x0 << 2)) = pixel_colour;
+		if (x0 == x1 && y0 == y1) {
+			break;
+		}
+		int e2 = err;
+		if (e2 > -dx) {
+			err -= dy;
+			x0 += sx;
+		}
+		if (e2 < dy) {
+			err += dx;
+			y0 += sy;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Render a list of lines to the frame buffer.
+//------------------------------------------------------------------------------
+
+void
+render_lines(spoint *spoint_list, int spoints, RGBcolour colour)
+{
+	pixel pixel_colour = RGB_to_display_pixel(colour);
+	for (int i = 0; i < spoints; i += 2) {
+		spoint *spoint1_ptr = spoint_list++;
+		spoint *spoint2_ptr = spoint_list++;
+		render_line(spoint1_ptr, spoint2_ptr, pixel_colour);
+	}
+}
+
+//==============================================================================
+// Function to determine intersection of the mouse with a polygon.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Determine whether a ray from the origin intersects the given triangle on
+// either side, using the Moller-Trumbore test.
+//------------------------------------------------------------------------------
+
+static bool
+ray_intersects_triangle(vector *ray_direction_ptr, tvertex *tvertex0_ptr,
+						tvertex *tvertex1_ptr, tvertex *tvertex2_ptr)
+{
+	float edge1_x, edge1_y, edge1_z, edge2_x, edge2_y, edge2_z;
+	float p_x, p_y, p_z, q_x, q_y, q_z;
+	float det, one_on_det, u, v, t;
+
+	edge1_x = tvertex1_ptr->x - tvertex0_ptr->x;
+	edge1_y = tvertex1_ptr->y - tvertex0_ptr->y;
+	edge1_z = tvertex1_ptr->z - tvertex0_ptr->z;
+	edge2_x = tvertex2_ptr->x - tvertex0_ptr->x;
+	edge2_y = tvertex2_ptr->y - tvertex0_ptr->y;
+	edge2_z = tvertex2_ptr->z - tvertex0_ptr->z;
+	p_x = ray_direction_ptr->dy * edge2_z - ray_direction_ptr->dz * edge2_y;
+	p_y = ray_direction_ptr->dz * edge2_x - ray_direction_ptr->dx * edge2_z;
+	p_z = ray_direction_ptr->dx * edge2_y - ray_direction_ptr->dy * edge2_x;
+	det = edge1_x * p_x + edge1_y * p_y + edge1_z * p_z;
+	if (det > -1e-20f && det < 1e-20f)
+		return(false);
+	one_on_det = 1.0f / det;
+	u = -(tvertex0_ptr->x * p_x + tvertex0_ptr->y * p_y + tvertex0_ptr->z * p_z) * one_on_det;
+	if (u < 0.0f || u > 1.0f)
+		return(false);
+	q_x = tvertex0_ptr->z * edge1_y - tvertex0_ptr->y * edge1_z;
+	q_y = tvertex0_ptr->x * edge1_z - tvertex0_ptr->z * edge1_x;
+	q_z = tvertex0_ptr->y * edge1_x - tvertex0_ptr->x * edge1_y;
+	v = (ray_direction_ptr->dx * q_x + ray_direction_ptr->dy * q_y + ray_direction_ptr->dz * q_z) * one_on_det;
+	if (v < 0.0f || u + v > 1.0f)
+		return(false);
+	t = (edge2_x * q_x + edge2_y * q_y + edge2_z * q_z) * one_on_det;
+	return(t >= 0.0f);
+}
+
+bool
+mouse_intersects_with_polygon(float /* mouse_x */, float /* mouse_y */, vector *camera_direction_ptr, tpolygon *tpolygon_ptr)
+{
+	tvertex *tvertex0_ptr = tpolygon_ptr->tvertex_list;
+	tvertex *tvertex1_ptr = tvertex0_ptr->next_tvertex_ptr;
+	tvertex *tvertex2_ptr = tvertex1_ptr->next_tvertex_ptr;
+	while (tvertex2_ptr) {
+		if (ray_intersects_triangle(camera_direction_ptr, tvertex0_ptr, tvertex1_ptr, tvertex2_ptr)) {
+			return true;
+		}
+		tvertex0_ptr = tvertex1_ptr;
+		tvertex1_ptr = tvertex2_ptr;
+		tvertex2_ptr = tvertex2_ptr->next_tvertex_ptr;
+	}
+	return false;
+}
+
+//==============================================================================
+// Hardware rendering functions, which are never called since there is no
+// hardware accelerated renderer.
+//==============================================================================
+
+void
+hardware_set_projection_transform(float /* viewport_width */, float /* viewport_height */, float /* near_z */, float /* far_z */)
+{
+}
+
+void
+hardware_set_skybox_transform(float /* turn_angle_radians */, float /* look_angle_radians */)
+{
+}
+
+void
+hardware_update_fog_settings(bool /* enabled */, fog * /* fog_ptr */, float /* max_radius */)
+{
+}
+
+void *
+hardware_create_texture(int /* image_size_index */)
+{
+	return(NULL);
+}
+
+void
+hardware_destroy_texture(void * /* hardware_texture_ptr */)
+{
+}
+
+void
+hardware_set_texture(cache_entry * /* cache_entry_ptr */)
+{
+}
+
+void
+hardware_render_2D_polygon(pixmap * /* pixmap_ptr */, RGBcolour /* colour */, float /* brightness */,
+					       float /* sx */, float /* sy */, float /* width */, float /* height */,
+						   float /* start_u */, float /* start_v */, float /* end_u */, float /* end_v */)
+{
+}
+
+void
+hardware_render_polygon(tpolygon * /* tpolygon_ptr */)
+{
+}
+
+void
+hardware_render_lines(vertex * /* vertex_list */, int /* vertices */, RGBcolour /* colour */)
+{
+}
+
+bool
+hardware_set_skybox(skybox_def * /* skybox_def_ptr */, float /* skybox_brightness */)
+{
+	return(false);
+}
+
+void
+hardware_render_skybox()
+{
+}
+
+//==============================================================================
+// 2D drawing functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Draw a pixmap at the given brightness index onto the frame buffer at the
+// given (x,y) coordinates.
+//------------------------------------------------------------------------------
+
+void
+draw_pixmap(pixmap *pixmap_ptr, int brightness_index, int x, int y, int width, int height)
+{
+	int clipped_x, clipped_y;
+	int clipped_width, clipped_height;
+	byte *image_ptr, *fb_ptr;
+	int fb_bytes_per_row;
+	int row;
+	pixel *palette_ptr;
+	int transparent_index = 0;
+	pixel transparency_mask32 = 0;
+	int image_width;
+	fixed u, v;
+
+	// If the pixmap is completely off screen then return without having drawn
+	// anything.
+
+	if (x >= window_width || y >= window_height ||
+		x + width <= 0 || y + height <= 0)
+		return;
+
+	// If the frame buffer x or y coordinates are negative, then we clamp them
+	// at zero and adjust the image coordinates and size to match.
+
+	if (x < 0) {
+		clipped_x = -x;
+		clipped_width = width - clipped_x;
+		x = 0;
+	} else {
+		clipped_x = 0;
+		clipped_width = width;
+	}
+	if (y < 0) {
+		clipped_y = -y;
+		clipped_height = height - clipped_y;
+		y = 0;
+	} else {
+		clipped_y = 0;
+		clipped_height = height;
+	}
+
+	// If the pixmap crosses the right or bottom edge of the display, we must
+	// adjust the size of the area we are going to draw even further.
+
+	if (x + clipped_width > window_width)
+		clipped_width = window_width - x;
+	if (y + clipped_height > window_height)
+		clipped_height = window_height - y;
+
+	// Determine the transprency mask or index, and the palette pointer.  For
+	// 16-bit pixmaps, the image width must be doubled to give the width in
+	// bytes.
+
+	if (pixmap_ptr->bytes_per_pixel == 2) {
+		transparency_mask32 = texture_pixel_format.alpha_comp_mask;
+		palette_ptr = light_table[brightness_index];
+		image_width = pixmap_ptr->width * 2;
+		u = (clipped_x % pixmap_ptr->width) * 2;
+	} else {
+		palette_ptr = pixmap_ptr->display_palette_list +
+			brightness_index * pixmap_ptr->colours;
+		transparent_index = pixmap_ptr->transparent_index;
+		image_width = pixmap_ptr->width;
+		u = clipped_x % pixmap_ptr->width;
+	}
+	v = clipped_y % pixmap_ptr->height;
+
+	// Compute the starting frame buffer and image pointers.
+
+	fb_bytes_per_row = window_width * 4;
+	fb_ptr = main_frame_buffer_ptr + (y * fb_bytes_per_row) + (x * 4);
+	image_ptr = pixmap_ptr->image_ptr + v * image_width;
+
+	// Now render the pixmap.
+
+	for (row = 0; row < clipped_height; row++) {
+		draw_linear_span(fb_ptr, 32, pixmap_ptr->bytes_per_pixel == 2, image_ptr,
+			palette_ptr, transparent_index, transparency_mask32, image_width,
+			clipped_width, u);
+		fb_ptr += fb_bytes_per_row;
+		image_ptr += image_width;
+	}
+}
+
+//==============================================================================
+// Colour functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Convert an RGB colour to a display pixel.
+//------------------------------------------------------------------------------
+
+pixel
+RGB_to_display_pixel(RGBcolour colour)
+{
+	pixel red, green, blue;
+
+	// Compute the pixel for this RGB colour.
+
+	red = (pixel)colour.red & display_pixel_format.red_mask;
+	red >>= display_pixel_format.red_right_shift;
+	red <<= display_pixel_format.red_left_shift;
+	green = (pixel)colour.green & display_pixel_format.green_mask;
+	green >>= display_pixel_format.green_right_shift;
+	green <<= display_pixel_format.green_left_shift;
+	blue = (pixel)colour.blue & display_pixel_format.blue_mask;
+	blue >>= display_pixel_format.blue_right_shift;
+	blue <<= display_pixel_format.blue_left_shift;
+	return(red | green | blue);
+}
+
+//------------------------------------------------------------------------------
+// Convert an RGB colour to a texture pixel.
+//------------------------------------------------------------------------------
+
+pixel
+RGB_to_texture_pixel(RGBcolour colour)
+{
+	pixel red, green, blue, alpha;
+
+	// Compute the pixel for this RGB colour.
+
+	red = (pixel)colour.red & texture_pixel_format.red_mask;
+	red >>= texture_pixel_format.red_right_shift;
+	red <<= texture_pixel_format.red_left_shift;
+	green = (pixel)colour.green & texture_pixel_format.green_mask;
+	green >>= texture_pixel_format.green_right_shift;
+	green <<= texture_pixel_format.green_left_shift;
+	blue = (pixel)colour.blue & texture_pixel_format.blue_mask;
+	blue >>= texture_pixel_format.blue_right_shift;
+	blue <<= texture_pixel_format.blue_left_shift;
+	alpha = colour.alpha ? texture_pixel_format.alpha_comp_mask : 0;
+	return(red | green | blue | alpha);
+}
+
+//------------------------------------------------------------------------------
+// Return an index to the nearest colour in the standard palette.
+//------------------------------------------------------------------------------
+
+byte
+get_standard_palette_index(RGBcolour colour)
+{
+	int index, nearest_index;
+	float red_diff, green_diff, blue_diff;
+	float distance, nearest_distance;
+
+	nearest_index = 0;
+	nearest_distance = 3.0f * 256.0f * 256.0f;
+	for (index = 0; index < 256; index++) {
+		red_diff = (byte)colour.red - standard_RGB_palette[index].red;
+		green_diff = (byte)colour.green - standard_RGB_palette[index].green;
+		blue_diff = (byte)colour.blue - standard_RGB_palette[index].blue;
+		distance = red_diff * red_diff + green_diff * green_diff + blue_diff * blue_diff;
+		if (distance < nearest_distance) {
+			nearest_index = index;
+			nearest_distance = distance;
+		}
+	}
+	return((byte)nearest_index);
+}
+
+//==============================================================================
+// App window functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Get the title.
+//------------------------------------------------------------------------------
+
+const char *
+get_title(void)
+{
+	return(title_text);
+}
+
+//------------------------------------------------------------------------------
+// Set the title.  If the format is NULL, reset the existing title.
+//------------------------------------------------------------------------------
+
+void
+set_title(char *format, ...)
+{
+	va_list arg_ptr;
+	char title[BUFSIZ];
+
+	if (format != NULL) {
+		va_start(arg_ptr, format);
+		vbprintf(title, BUFSIZ, format, arg_ptr);
+		va_end(arg_ptr);
+		title_text = title;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Set the status text.  There is no status bar.
+//------------------------------------------------------------------------------
+
+void
+set_status_text(int /* status_box_index */, char * /* format */, ...)
+{
+}
+
+//------------------------------------------------------------------------------
+// Set the spot URL.  There is no edit box to show it in.
+//------------------------------------------------------------------------------
+
+void
+set_spot_URL(string /* spot_URL */)
+{
+}
+
+//------------------------------------------------------------------------------
+// Display a label.  There is no mouse cursor for it to follow, so the label
+// text is remembered but never drawn.
+//------------------------------------------------------------------------------
+
+void
+show_label(const char *label)
+{
+	if (label != NULL) {
+		label_visible = true;
+		label_text = label;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Hide the label.
+//------------------------------------------------------------------------------
+
+void
+hide_label(void)
+{
+	label_visible = false;
+}
+
+//------------------------------------------------------------------------------
+// Initialise a popup.  There is no font renderer, so the foreground texture is
+// created but no text is drawn on it.
+//------------------------------------------------------------------------------
+
+void
+init_popup(popup *popup_ptr)
+{
+	texture *bg_texture_ptr;
+	int popup_width, popup_height;
+
+	// If this popup has a background texture, create it's display palette
+	// list, and set the size of the popup to be the size of the background
+	// texture.  Otherwise use the popup's default size.
+
+	if ((bg_texture_ptr = popup_ptr->bg_texture_ptr) != NULL) {
+		if (bg_texture_ptr->bytes_per_pixel == 1)
+			bg_texture_ptr->create_display_palette_list();
+		popup_width = bg_texture_ptr->width;
+		popup_height = bg_texture_ptr->height;
+	} else {
+		popup_width = popup_ptr->width;
+		popup_height = popup_ptr->height;
+	}
+
+	// If this popup requires a foreground texture, create the pixmap for it.
+
+	if (popup_ptr->create_foreground)
+		create_pixmap_for_text(popup_ptr->fg_texture_ptr, popup_width,
+			popup_height, popup_ptr->text_colour,
+			popup_ptr->transparent_background ? NULL : &popup_ptr->colour);
+}
+
+//==============================================================================
+// Cursor and mouse functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Get the position of the mouse.  There is no mouse, so the position is always
+// outside of the main window.
+//------------------------------------------------------------------------------
+
+void
+get_mouse_position(int *x, int *y, bool /* relative */)
+{
+	*x = -1;
+	*y = -1;
+}
+
+void
+set_arrow_cursor(void)
+{
+}
+
+void
+set_movement_cursor(arrow /* movement_arrow */)
+{
+}
+
+void
+set_hand_cursor(void)
+{
+}
+
+void
+set_crosshair_cursor(void)
+{
+}
+
+void
+enable_mouse_look_mode(void)
+{
+}
+
+void
+disable_mouse_look_mode(void)
+{
+}
+
+//==============================================================================
+// Time functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Get the time in milliseconds.  If a fixed time step is in use, this is the
+// simulated time, which only advances as frames are displayed; otherwise it's
+// the real time since the platform API started up.
+//------------------------------------------------------------------------------
+
+int
+get_time_ms(void)
+{
+	if (time_step_ms > 0)
+		return(simulated_time_ms.get());
+	return(get_real_time_ms());
+}
+
+//------------------------------------------------------------------------------
+// Get the real time since the platform API started up, in milliseconds, even
+// if a fixed time step is in use.
+//------------------------------------------------------------------------------
+
+int
+get_real_time_ms(void)
+{
+	return((int)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - clock_start_time).count());
+}
+
+//==============================================================================
+// Sound functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Load wave data into a wave object.  The wave is parsed so that bad wave
+// files are reported just as they are on other platforms, even though it will
+// never be played.
+//------------------------------------------------------------------------------
+
+bool
+load_wave_data(wave *wave_ptr, char *wave_file_buffer, int wave_file_size)
+{
+	byte *buffer_ptr, *end_ptr, *chunk_ptr;
+	int chunk_size;
+	wave_format *wave_format_ptr;
+	char *wave_data_ptr;
+	int wave_data_size;
+
+	// Verify we've got a wave file by checking the RIFF header.
+
+	buffer_ptr = (byte *)wave_file_buffer;
+	end_ptr = buffer_ptr + wave_file_size;
+	if (wave_file_size < 12 || strncmp((char *)buffer_ptr, "RIFF", 4) ||
+		strncmp((char *)buffer_ptr + 8, "WAVE", 4))
+		return(false);
+
+	// Step through the chunks, looking for the fmt and data chunks.
+
+	wave_format_ptr = NULL;
+	wave_data_ptr = NULL;
+	wave_data_size = 0;
+	chunk_ptr = buffer_ptr + 12;
+	while (chunk_ptr + 8 <= end_ptr && wave_data_ptr == NULL) {
+		chunk_size = read_int(chunk_ptr + 4);
+		if (chunk_size < 0 || chunk_size > end_ptr - chunk_ptr - 8)
+			break;
+
+		// Read the wave format, and verify that the wave is in PCM format.
+
+		if (!strncmp((char *)chunk_ptr, "fmt ", 4) && wave_format_ptr == NULL) {
+			if (chunk_size < 16 || read_word(chunk_ptr + 8) != 1)
+				return(false);
+			NEW(wave_format_ptr, wave_format);
+			if (wave_format_ptr == NULL)
+				return(false);
+			wave_format_ptr->format_tag = read_word(chunk_ptr + 8);
+			wave_format_ptr->channels = read_word(chunk_ptr + 10);
+			wave_format_ptr->samples_per_second = read_int(chunk_ptr + 12);
+			wave_format_ptr->bytes_per_second = read_int(chunk_ptr + 16);
+			wave_format_ptr->block_align = read_word(chunk_ptr + 20);
+			wave_format_ptr->bits_per_sample = read_word(chunk_ptr + 22);
+		}
+
+		// Read the wave data into a buffer.
+
+		else if (!strncmp((char *)chunk_ptr, "data", 4) && wave_format_ptr != NULL) {
+			wave_data_size = chunk_size;
+			if ((wave_data_ptr = new char[wave_data_size]) == NULL) {
+				DEL(wave_format_ptr, wave_format);
+				return(false);
+			}
+			memcpy(wave_data_ptr, chunk_ptr + 8, wave_data_size);
+		}
+
+		// Chunks are padded to an even size.
+
+		chunk_ptr += 8 + ((chunk_size + 1) & ~1);
+	}
+
+	// If either chunk is missing, fail.
+
+	if (wave_data_ptr == NULL) {
+		if (wave_format_ptr != NULL)
+			DEL(wave_format_ptr, wave_format);
+		return(false);
+	}
+
+	// Set up the wave structure and return with success.
+
+	wave_ptr->format_ptr = wave_format_ptr;
+	wave_ptr->data_ptr = wave_data_ptr;
+	wave_ptr->data_size = wave_data_size;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Destroy the wave data in the given wave object.
+//------------------------------------------------------------------------------
+
+void
+destroy_wave_data(wave *wave_ptr)
+{
+	if (wave_ptr->format_ptr != NULL)
+		DEL((wave_format *)wave_ptr->format_ptr, wave_format);
+	if (wave_ptr->data_ptr != NULL)
+		delete []wave_ptr->data_ptr;
+}
+
+//------------------------------------------------------------------------------
+// Sound buffers are never created, since there is no sound device.  Creation
+// succeeds as long as there is wave data, so that spots load without warnings.
+//------------------------------------------------------------------------------
+
+void
+update_sound_buffer(void * /* sound_buffer_ptr */, char * /* data_ptr */, int /* data_size */,
+					int /* data_start */)
+{
+}
+
+bool
+create_sound_buffer(sound *sound_ptr)
+{
+	wave *wave_ptr = sound_ptr->wave_ptr;
+	return(wave_ptr != NULL && wave_ptr->data_size > 0);
+}
+
+void
+destroy_sound_buffer(sound *sound_ptr)
+{
+	sound_ptr->sound_buffer_ptr = NULL;
+}
+
+void
+set_sound_volume(sound * /* sound_ptr */, float /* volume */)
+{
+}
+
+void
+play_sound(sound * /* sound_ptr */, bool /* looped */)
+{
+}
+
+void
+stop_sound(sound * /* sound_ptr */)
+{
+}
+
+void
+update_sound(sound * /* sound_ptr */, vertex * /* translation_ptr */)
+{
+}
+
+//==============================================================================
+// Headless functions.
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Set the function to be called with the frame buffer after every frame.
+//------------------------------------------------------------------------------
+
+void
+set_frame_callback(void (*frame_callback)(byte *frame_buffer_ptr, int row_pitch))
+{
+	frame_callback_ptr = frame_callback;
+}
+
+//------------------------------------------------------------------------------
+// Set a fixed time step per frame, or zero to use the real time.
+//------------------------------------------------------------------------------
+
+void
+set_time_step(int time_step)
+{
+	time_step_ms = time_step;
+}
+
+//------------------------------------------------------------------------------
+// Set the longest time allowed between frames, or zero for no limit.
+//------------------------------------------------------------------------------
+
+void
+set_frame_timeout(int frame_timeout)
+{
+	frame_timeout_ms = frame_timeout;
+}
+
+//------------------------------------------------------------------------------
+// Request that the event loop quit with the given exit status.
+//------------------------------------------------------------------------------
+
+void
+request_quit(int status)
+{
+	exit_status.set(status);
+}
+
+//==============================================================================
+// C runtime functions used by the shared modules that have no direct POSIX
+// equivalent (see Portable.h).
+//==============================================================================
+
+//------------------------------------------------------------------------------
+// Start searching for files that match a path with a wildcard file name, and
+// return the first one.  Either slash may separate the directory from the file
+// name, and the Windows wildcard "*.*" matches every file.
+//------------------------------------------------------------------------------
+
+long
+_findfirst(const char *path, struct _finddata_t *file_info_ptr)
+{
+	find_data *find_data_ptr;
+	const char *name_ptr;
+	int dir_path_length;
+
+	// Split the path into the directory path and the file name pattern.
+
+	name_ptr = path + strlen(path);
+	while (name_ptr > path && name_ptr[-1] != '/' && name_ptr[-1] != '\\')
+		name_ptr--;
+	dir_path_length = (int)(name_ptr - path);
+	if (dir_path_length >= _MAX_PATH || strlen(name_ptr) > NAME_MAX)
+		return(-1);
+
+	// Open the directory.
+
+	NEW(find_data_ptr, find_data);
+	if (find_data_ptr == NULL)
+		return(-1);
+	if (dir_path_length == 0)
+		strcpy(find_data_ptr->dir_path, "./");
+	else {
+		strncpy(find_data_ptr->dir_path, path, dir_path_length);
+		find_data_ptr->dir_path[dir_path_length] = '\0';
+	}
+	if (!strcmp(name_ptr, "*.*"))
+		strcpy(find_data_ptr->pattern, "*");
+	else
+		strcpy(find_data_ptr->pattern, name_ptr);
+	if ((find_data_ptr->dir_ptr = opendir(find_data_ptr->dir_path)) == NULL) {
+		DEL(find_data_ptr, find_data);
+		return(-1);
+	}
+
+	// Return the first matching file, if there is one.
+
+	if (_findnext((long)find_data_ptr, file_info_ptr) != 0) {
+		_findclose((long)find_data_ptr);
+		return(-1);
+	}
+	return((long)find_data_ptr);
+}
+
+//------------------------------------------------------------------------------
+// Return the next file that matches the search, or -1 if there are no more.
+//------------------------------------------------------------------------------
+
+int
+_findnext(long find_handle, struct _finddata_t *file_info_ptr)
+{
+	find_data *find_data_ptr = (find_data *)find_handle;
+	struct dirent *dir_entry_ptr;
+	struct stat stat_buffer;
+	string file_path;
+
+	while ((dir_entry_ptr = readdir(find_data_ptr->dir_ptr)) != NULL) {
+		if (fnmatch(find_data_ptr->pattern, dir_entry_ptr->d_name, 0) != 0)
+			continue;
+		file_path = find_data_ptr->dir_path;
+		file_path += dir_entry_ptr->d_name;
+		if (stat(file_path, &stat_buffer) != 0)
+			continue;
+		strcpy(file_info_ptr->name, dir_entry_ptr->d_name);
+		file_info_ptr->attrib = S_ISDIR(stat_buffer.st_mode) ? _A_SUBDIR : 0;
+		file_info_ptr->size = (long)stat_buffer.st_size;
+		return(0);
+	}
+	return(-1);
+}
+
+//------------------------------------------------------------------------------
+// End a search.
+//------------------------------------------------------------------------------
+
+int
+_findclose(long find_handle)
+{
+	find_data *find_data_ptr = (find_data *)find_handle;
+
+	closedir(find_data_ptr->dir_ptr);
+	DEL(find_data_ptr, find_data);
+	return(0);
+}
+
+//------------------------------------------------------------------------------
+// Convert a path to an absolute path.  Unlike realpath, the file need not
+// exist.
+//------------------------------------------------------------------------------
+
+char *
+_fullpath(char *full_path, const char *path, size_t size)
+{
+	char resolved_path[PATH_MAX];
+	string absolute_path;
+
+	if (realpath(path, resolved_path) != NULL)
+		absolute_path = resolved_path;
+	else if (*path == '/')
+		absolute_path = path;
+	else {
+		if (getcwd(resolved_path, PATH_MAX) == NULL)
+			return(NULL);
+		absolute_path = resolved_path;
+		absolute_path += "/";
+		absolute_path += path;
+	}
+	if (strlen(absolute_path) >= size)
+		return(NULL);
+	strcpy(full_path, absolute_path);
+	return(full_path);
+}
@@ -0,0 +1,268 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "Classes.h"
+#include "Parser.h"
+#include "Platform.h"
+#include "Plugin.h"
+#include "Profile.h"
+
+#ifdef FRAME_PROFILE
+
+// Number of frames kept in the ring buffer.
+
+#define PROFILE_FRAMES	1024
+
+// Timings for one frame.  All times are in microseconds; the start time of a
+// frame is relative to the start of the profile, and the start time of a phase
+// is when it was first entered during the frame.
+
+struct profile_frame {
+	int frame_no;
+	double start_time_us;
+	float frame_time_us;
+	float phase_start_time_us[PROFILE_PHASES];
+	float phase_time_us[PROFILE_PHASES];
+	int phase_calls[PROFILE_PHASES];
+};
+
+// Names of the phases.
+
+static const char *phase_name_list[PROFILE_PHASES] = {
+	"scripts",
+	"triggers",
+	"clock_actions",
+	"collision",
+	"lights",
+	"render_map",
+	"transform_clip",
+	"span_insertion",
+	"textured_spans",
+	"colour_spans",
+	"transparent_spans",
+	"parallel_spans",
+	"display"
+};
+
+// Ring buffer of frame timings, the number of frames completed, and a pointer
+// to the frame currently being timed (NULL if there isn't one).
+
+static profile_frame profile_frame_list[PROFILE_FRAMES];
+static int profile_frames;
+static profile_frame *curr_profile_frame_ptr;
+
+// Total time spent in each phase and in all frames since the profile started.
+
+static double total_phase_time_us[PROFILE_PHASES];
+static double total_frame_time_us;
+
+// The time the profile started, and the time each phase was last entered.
+
+static std::chrono::steady_clock::time_point profile_start_time;
+static double phase_entry_time_us[PROFILE_PHASES];
+
+//------------------------------------------------------------------------------
+// Get the time since the profile started, in microseconds.
+//------------------------------------------------------------------------------
+
+static double
+get_profile_time_us(void)
+{
+	return(std::chrono::duration<double, std::micro>(
+		std::chrono::steady_clock::now() - profile_start_time).count());
+}
+
+//------------------------------------------------------------------------------
+// Start the profile, discarding any frames already profiled.
+//------------------------------------------------------------------------------
+
+void
+start_profile(void)
+{
+	int phase;
+
+	profile_start_time = std::chrono::steady_clock::now();
+	profile_frames = 0;
+	curr_profile_frame_ptr = NULL;
+	for (phase = 0; phase < PROFILE_PHASES; phase++)
+		total_phase_time_us[phase] = 0.0;
+	total_frame_time_us = 0.0;
+}
+
+//------------------------------------------------------------------------------
+// Enter a phase.
+//------------------------------------------------------------------------------
+
+void
+start_profile_phase(profile_phase phase)
+{
+	double time_us;
+
+	if (curr_profile_frame_ptr == NULL)
+		return;
+	time_us = get_profile_time_us();
+	if (curr_profile_frame_ptr->phase_calls[phase] == 0)
+		curr_profile_frame_ptr->phase_start_time_us[phase] =
+			(float)(time_us - curr_profile_frame_ptr->start_time_us);
+	phase_entry_time_us[phase] = time_us;
+}
+
+//------------------------------------------------------------------------------
+// Leave a phase, adding the time spent in it to the current frame.
+//------------------------------------------------------------------------------
+
+void
+stop_profile_phase(profile_phase phase)
+{
+	if (curr_profile_frame_ptr == NULL)
+		return;
+	curr_profile_frame_ptr->phase_time_us[phase] +=
+		(float)(get_profile_time_us() - phase_entry_time_us[phase]);
+	curr_profile_frame_ptr->phase_calls[phase]++;
+}
+
+//------------------------------------------------------------------------------
+// Complete the current frame, if there is one, and start timing the next.
+//------------------------------------------------------------------------------
+
+void
+next_profile_frame(void)
+{
+	double time_us;
+	int phase;
+
+	time_us = get_profile_time_us();
+	if (curr_profile_frame_ptr != NULL) {
+		curr_profile_frame_ptr->frame_time_us =
+			(float)(time_us - curr_profile_frame_ptr->start_time_us);
+		total_frame_time_us += curr_profile_frame_ptr->frame_time_us;
+		for (phase = 0; phase < PROFILE_PHASES; phase++)
+			total_phase_time_us[phase] +=
+				curr_profile_frame_ptr->phase_time_us[phase];
+		profile_frames++;
+	}
+	curr_profile_frame_ptr = &profile_frame_list[profile_frames % PROFILE_FRAMES];
+	memset(curr_profile_frame_ptr, 0, sizeof(profile_frame));
+	curr_profile_frame_ptr->frame_no = profile_frames;
+	curr_profile_frame_ptr->start_time_us = time_us;
+}
+
+//------------------------------------------------------------------------------
+// Write the frames in the ring buffer to a CSV file, one row per frame.
+//------------------------------------------------------------------------------
+
+static bool
+write_profile_CSV(const char *file_path, int first_frame_no)
+{
+	FILE *fp;
+	profile_frame *frame_ptr;
+	int frame_no, phase;
+
+	if ((fp = fopen(file_path, "w")) == NULL)
+		return(false);
+	fprintf(fp, "frame,start_us,frame_us");
+	for (phase = 0; phase < PROFILE_PHASES; phase++)
+		fprintf(fp, ",%s_us", phase_name_list[phase]);
+	fprintf(fp, "\n");
+	for (frame_no = first_frame_no; frame_no < profile_frames; frame_no++) {
+		frame_ptr = &profile_frame_list[frame_no % PROFILE_FRAMES];
+		fprintf(fp, "%d,%.1f,%.1f", frame_ptr->frame_no,
+			frame_ptr->start_time_us, frame_ptr->frame_time_us);
+		for (phase = 0; phase < PROFILE_PHASES; phase++)
+			fprintf(fp, ",%.1f", frame_ptr->phase_time_us[phase]);
+		fprintf(fp, "\n");
+	}
+	fclose(fp);
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Write the frames in the ring buffer to a file in Chrome's trace event format,
+// which can be loaded into chrome://tracing.  Frames appear on one track and
+// each phase on a track of its own.  Phases that are entered many times per
+// frame, such as span insertion, are shown as a single slice starting when the
+// phase was first entered and lasting for the total time spent in it.
+//------------------------------------------------------------------------------
+
+static bool
+write_profile_trace(const char *file_path, int first_frame_no)
+{
+	FILE *fp;
+	profile_frame *frame_ptr;
+	int frame_no, phase;
+
+	if ((fp = fopen(file_path, "w")) == NULL)
+		return(false);
+	fprintf(fp, "{\"traceEvents\":[\n");
+	fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+		"\"args\":{\"name\":\"frame\"}}");
+	for (phase = 0; phase < PROFILE_PHASES; phase++)
+		fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+			"\"tid\":%d,\"args\":{\"name\":\"%s\"}}", phase + 2,
+			phase_name_list[phase]);
+	for (frame_no = first_frame_no; frame_no < profile_frames; frame_no++) {
+		frame_ptr = &profile_frame_list[frame_no % PROFILE_FRAMES];
+		fprintf(fp, ",\n{\"name\":\"frame %d\",\"ph\":\"X\",\"pid\":1,"
+			"\"tid\":1,\"ts\":%.1f,\"dur\":%.1f}", frame_ptr->frame_no,
+			frame_ptr->start_time_us, frame_ptr->frame_time_us);
+		for (phase = 0; phase < PROFILE_PHASES; phase++) {
+			if (frame_ptr->phase_calls[phase] == 0)
+				continue;
+			fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,"
+				"\"tid\":%d,\"ts\":%.1f,\"dur\":%.1f,"
+				"\"args\":{\"frame\":%d,\"calls\":%d}}", phase_name_list[phase],
+				phase + 2, frame_ptr->start_time_us +
+				frame_ptr->phase_start_time_us[phase],
+				frame_ptr->phase_time_us[phase], frame_ptr->frame_no,
+				frame_ptr->phase_calls[phase]);
+		}
+	}
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// End the profile: log the average time per frame spent in each phase, and
+// write the frames in the ring buffer to "profile.csv" and "profile.json" in
+// the Flatland directory.  Note the render map phase includes the transform,
+// clip and span insertion phases of the polygons it renders.
+//------------------------------------------------------------------------------
+
+void
+end_profile(void)
+{
+	string csv_file_path, trace_file_path;
+	int first_frame_no, phase;
+
+	if (profile_frames == 0)
+		return;
+
+	// Log the averages.
+
+	diagnose("Average frame time was %.1f microseconds over %d frames",
+		total_frame_time_us / profile_frames, profile_frames);
+	for (phase = 0; phase < PROFILE_PHASES; phase++)
+		diagnose("Average time in phase %s was %.1f microseconds (%.1f%%)",
+			phase_name_list[phase], total_phase_time_us[phase] / profile_frames,
+			total_frame_time_us > 0.0 ? total_phase_time_us[phase] * 100.0 /
+			total_frame_time_us : 0.0);
+
+	// Write the frames still in the ring buffer.
+
+	first_frame_no = profile_frames > PROFILE_FRAMES ?
+		profile_frames - PROFILE_FRAMES : 0;
+	csv_file_path = flatland_dir + "profile.csv";
+	trace_file_path = flatland_dir + "profile.json";
+	if (!write_profile_CSV(csv_file_path, first_frame_no))
+		diagnose("Unable to write frame profile to %s", (char *)csv_file_path);
+	if (!write_profile_trace(trace_file_path, first_frame_no))
+		diagnose("Unable to write frame trace to %s", (char *)trace_file_path);
+}
+
+#endif // FRAME_PROFILE
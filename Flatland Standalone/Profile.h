@@ -0,0 +1,59 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// The frame profiler is only compiled in if FRAME_PROFILE is defined; otherwise
+// the profiling macros expand to nothing.
+
+#ifdef FRAME_PROFILE
+
+// Phases of a frame that are timed.
+
+enum profile_phase {
+	PROFILE_SCRIPTS,
+	PROFILE_TRIGGERS,
+	PROFILE_CLOCK_ACTIONS,
+	PROFILE_COLLISION,
+	PROFILE_LIGHTS,
+	PROFILE_RENDER_MAP,
+	PROFILE_TRANSFORM_CLIP,
+	PROFILE_SPAN_INSERTION,
+	PROFILE_TEXTURED_SPANS,
+	PROFILE_COLOUR_SPANS,
+	PROFILE_TRANSPARENT_SPANS,
+	PROFILE_PARALLEL_SPANS,
+	PROFILE_DISPLAY,
+	PROFILE_PHASES
+};
+
+// Macros for timing a phase.
+
+#define START_PROFILE(phase)	start_profile_phase(phase)
+#define STOP_PROFILE(phase)		stop_profile_phase(phase)
+#define NEXT_PROFILE_FRAME()	next_profile_frame()
+
+// Functions for profiling frames.
+
+void
+start_profile(void);
+
+void
+start_profile_phase(profile_phase phase);
+
+void
+stop_profile_phase(profile_phase phase);
+
+void
+next_profile_frame(void);
+
+void
+end_profile(void);
+
+#else
+
+#define START_PROFILE(phase)
+#define STOP_PROFILE(phase)
+#define NEXT_PROFILE_FRAME()
+
+#endif
@@ -0,0 +1,942 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Classes.h"
+#include "Raster.h"
+
+// Select the widest instruction set the compiler is targeting.  AVX2 adds
+// 8-wide texel gathers; SSE2 (always present on x64) vectorises the (u,v)
+// stepping and the frame buffer writes; anything else uses plain C++.
+
+#if defined(__AVX2__)
+#define RASTER_AVX2
+#endif
+
+#if defined(RASTER_AVX2) || defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTER_SSE2
+#endif
+
+#if defined(RASTER_AVX2)
+#include <immintrin.h>
+#elif defined(RASTER_SSE2)
+#include <emmintrin.h>
+#endif
+
+// Number of SPAN_WIDTH pieces whose end points are computed in one batch,
+// and the size of the (u,v) lists used to hold them (rounded up so that the
+// vector code may write a whole register past the last end point).
+
+#define UV_BATCH			8
+#define UV_LIST_SIZE		(UV_BATCH + 4)
+
+// Macro to compute the index of a texel in a lit image from fixed point (u,v)
+// coordinates.  The mask occupies the integer part of the coordinates, and the
+// shift moves the integer part of v to the row offset.
+
+#define TEXEL_INDEX(u,v,mask,shift) \
+	((((u) & (mask)) >> FRAC_BITS) | (((v) & (mask)) >> (shift)))
+
+// Indices into the list of vectors used to shade texels.
+
+#define SHADE_SCALE			0
+#define SHADE_RED			1
+#define SHADE_GREEN			2
+#define SHADE_BLUE			3
+#define SHADE_KEEP			4
+#define SHADE_VECTORS		5
+
+//------------------------------------------------------------------------------
+// Write a pixel to a 16, 24 or 32-bit frame buffer.  A 24-bit write leaves the
+// byte following the pixel untouched.
+//------------------------------------------------------------------------------
+
+static inline void
+put_pixel16(byte *fb_ptr, pixel pixel_value)
+{
+	*(word *)fb_ptr = (word)pixel_value;
+}
+
+static inline void
+put_pixel24(byte *fb_ptr, pixel pixel_value)
+{
+	fb_ptr[0] = (byte)pixel_value;
+	fb_ptr[1] = (byte)(pixel_value >> 8);
+	fb_ptr[2] = (byte)(pixel_value >> 16);
+}
+
+static inline void
+put_pixel32(byte *fb_ptr, pixel pixel_value)
+{
+	*(pixel *)fb_ptr = pixel_value;
+}
+
+//------------------------------------------------------------------------------
+// Scale the red, green and blue components of a texel by the shading
+// brightness, leaving all other bits untouched.
+//------------------------------------------------------------------------------
+
+static inline pixel
+shade_texel(pixel texel, texel_shade *shade_ptr)
+{
+	pixel scale = shade_ptr->scale;
+
+	return(((((texel & shade_ptr->red_mask) * scale) >> 8) &
+		shade_ptr->red_mask) |
+		((((texel & shade_ptr->green_mask) * scale) >> 8) &
+		shade_ptr->green_mask) |
+		((((texel & shade_ptr->blue_mask) * scale) >> 8) &
+		shade_ptr->blue_mask) |
+		(texel & ~(shade_ptr->red_mask | shade_ptr->green_mask |
+		shade_ptr->blue_mask)));
+}
+
+//------------------------------------------------------------------------------
+// Return the lit pixel for a single unlit texel, with the transparency mask
+// set if the texel is opaque.
+//------------------------------------------------------------------------------
+
+static inline pixel
+get_lit_pixel(byte *image_ptr, int bytes_per_pixel, pixel *palette_ptr,
+			  int transparent_index, pixel transparency_mask)
+{
+	int index;
+
+	// An 8-bit texel is opaque unless it's the transparent index; a 16-bit
+	// texel is opaque if the top bit is set.
+
+	if (bytes_per_pixel == 1) {
+		index = *image_ptr;
+		if (index == transparent_index)
+			return(palette_ptr[index]);
+	} else {
+		index = *(word *)image_ptr;
+		if ((index & 0x8000) == 0)
+			return(palette_ptr[index]);
+		index &= 0x7fff;
+	}
+	return(palette_ptr[index] | transparency_mask);
+}
+
+//------------------------------------------------------------------------------
+// Convert a run of texels from one row of an unlit image to a row of a lit
+// image.
+//------------------------------------------------------------------------------
+
+static void
+convert_texels(byte *image_ptr, int bytes_per_pixel, pixel *palette_ptr,
+			   int transparent_index, pixel transparency_mask,
+			   byte *new_image_ptr, int new_bytes_per_pixel, int texels)
+{
+	pixel lit_pixel;
+	int texel_index;
+
+	// A 32-bit image is simply copied.
+
+	if (bytes_per_pixel == 4) {
+		memcpy(new_image_ptr, image_ptr, texels * 4);
+		return;
+	}
+
+	// Convert eight texels at a time by gathering them from the palette.
+
+	texel_index = 0;
+
+#ifdef RASTER_AVX2
+	__m256i zero_vec = _mm256_setzero_si256();
+	__m256i mask_vec = _mm256_set1_epi32((int)transparency_mask);
+	__m256i index_vec, opaque_vec, pixel_vec;
+
+	for (; texel_index + 8 <= texels; texel_index += 8) {
+		if (bytes_per_pixel == 1) {
+			index_vec = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i *)(image_ptr + texel_index)));
+			opaque_vec = _mm256_cmpeq_epi32(index_vec, _mm256_set1_epi32(transparent_index));
+			opaque_vec = _mm256_cmpeq_epi32(opaque_vec, zero_vec);
+		} else {
+			index_vec = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)(image_ptr + (texel_index << 1))));
+			opaque_vec = _mm256_cmpeq_epi32(_mm256_and_si256(index_vec, _mm256_set1_epi32(0x8000)), zero_vec);
+			opaque_vec = _mm256_cmpeq_epi32(opaque_vec, zero_vec);
+			index_vec = _mm256_and_si256(index_vec, _mm256_set1_epi32(0x7fff));
+		}
+		pixel_vec = _mm256_i32gather_epi32((const int *)palette_ptr, index_vec, 4);
+		pixel_vec = _mm256_or_si256(pixel_vec, _mm256_and_si256(opaque_vec, mask_vec));
+		if (new_bytes_per_pixel == 2) {
+			pixel_vec = _mm256_and_si256(pixel_vec, _mm256_set1_epi32(0xffff));
+			pixel_vec = _mm256_permute4x64_epi64(_mm256_packus_epi32(pixel_vec, pixel_vec), 0x08);
+			_mm_storeu_si128((__m128i *)(new_image_ptr + (texel_index << 1)), _mm256_castsi256_si128(pixel_vec));
+		} else
+			_mm256_storeu_si256((__m256i *)(new_image_ptr + (texel_index << 2)), pixel_vec);
+	}
+#endif
+
+	// Convert the remaining texels one at a time.
+
+	for (; texel_index < texels; texel_index++) {
+		lit_pixel = get_lit_pixel(image_ptr + texel_index * bytes_per_pixel,
+			bytes_per_pixel, palette_ptr, transparent_index, transparency_mask);
+		if (new_bytes_per_pixel == 2)
+			put_pixel16(new_image_ptr + (texel_index << 1), lit_pixel);
+		else
+			put_pixel32(new_image_ptr + (texel_index << 2), lit_pixel);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Convert an 8-bit, 16-bit or 32-bit image into a square 16-bit or 32-bit lit
+// image, tiling the image if it's smaller than the lit image.  8-bit and
+// 16-bit images are lit through the given palette, and the transparency mask
+// is set on every opaque pixel.
+//------------------------------------------------------------------------------
+
+void
+convert_image(byte *image_ptr, int image_width, int image_height,
+			  int bytes_per_pixel, pixel *palette_ptr, int transparent_index,
+			  pixel transparency_mask, byte *new_image_ptr,
+			  int new_image_dimensions, int new_bytes_per_pixel,
+			  int new_row_pitch)
+{
+	byte *row_ptr, *new_row_ptr;
+	int image_row_pitch;
+	int row, column, texels;
+
+	// Convert each row of the lit image from the corresponding row of the
+	// unlit image, wrapping back to the first row and column as needed.
+
+	image_row_pitch = image_width * bytes_per_pixel;
+	for (row = 0; row < new_image_dimensions; row++) {
+		row_ptr = image_ptr + (row % image_height) * image_row_pitch;
+		new_row_ptr = new_image_ptr + row * new_row_pitch;
+		for (column = 0; column < new_image_dimensions; column += texels) {
+			texels = new_image_dimensions - column;
+			if (texels > image_width)
+				texels = image_width;
+			convert_texels(row_ptr, bytes_per_pixel, palette_ptr,
+				transparent_index, transparency_mask,
+				new_row_ptr + column * new_bytes_per_pixel, new_bytes_per_pixel,
+				texels);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Get the masks of the red, green and blue components within a pixel of the
+// given format.
+//------------------------------------------------------------------------------
+
+void
+get_component_masks(pixel_format *format_ptr, pixel &red_comp_mask,
+					pixel &green_comp_mask, pixel &blue_comp_mask)
+{
+	red_comp_mask = (format_ptr->red_mask >> format_ptr->red_right_shift) <<
+		format_ptr->red_left_shift;
+	green_comp_mask = (format_ptr->green_mask >> format_ptr->green_right_shift)
+		<< format_ptr->green_left_shift;
+	blue_comp_mask = (format_ptr->blue_mask >> format_ptr->blue_right_shift) <<
+		format_ptr->blue_left_shift;
+}
+
+//------------------------------------------------------------------------------
+// Set up the texel shading for a brightness index, using the component masks
+// of the given display pixel format.
+//------------------------------------------------------------------------------
+
+void
+set_texel_shade(texel_shade *shade_ptr, pixel_format *format_ptr,
+				int brightness_index)
+{
+	shade_ptr->scale = (256 * (MAX_BRIGHTNESS_INDEX - brightness_index) +
+		MAX_BRIGHTNESS_INDEX / 2) / MAX_BRIGHTNESS_INDEX;
+	get_component_masks(format_ptr, shade_ptr->red_mask, shade_ptr->green_mask,
+		shade_ptr->blue_mask);
+}
+
+//------------------------------------------------------------------------------
+// Return the average of a 2x2 block of lit texels, computed separately for each
+// component.  Only opaque texels contribute to the average, and the result is
+// opaque if at least half of the texels are.
+//------------------------------------------------------------------------------
+
+static pixel
+average_texels(pixel *texel_list, pixel red_comp_mask, pixel green_comp_mask,
+			   pixel blue_comp_mask, pixel transparency_mask)
+{
+	pixel red_sum, green_sum, blue_sum;
+	int texels, opaque_texels;
+	int index;
+
+	// Count the opaque texels.  If there are none, average all four texels.
+
+	opaque_texels = 0;
+	for (index = 0; index < 4; index++)
+		if (texel_list[index] & transparency_mask)
+			opaque_texels++;
+
+	// Sum the components of the texels to be averaged.
+
+	red_sum = 0;
+	green_sum = 0;
+	blue_sum = 0;
+	texels = 0;
+	for (index = 0; index < 4; index++)
+		if (opaque_texels == 0 || (texel_list[index] & transparency_mask)) {
+			red_sum += texel_list[index] & red_comp_mask;
+			green_sum += texel_list[index] & green_comp_mask;
+			blue_sum += texel_list[index] & blue_comp_mask;
+			texels++;
+		}
+
+	// Return the average texel, setting the transparency mask if it's opaque.
+
+	return(((red_sum / texels) & red_comp_mask) |
+		((green_sum / texels) & green_comp_mask) |
+		((blue_sum / texels) & blue_comp_mask) |
+		(opaque_texels >= 2 ? transparency_mask : 0));
+}
+
+//------------------------------------------------------------------------------
+// Build the mipmap levels of a square 16-bit or 32-bit lit image.  Each level
+// follows the one before it in memory, and is half its dimensions; the first
+// level must already hold the lit image.
+//------------------------------------------------------------------------------
+
+void
+build_mipmaps(byte *image_ptr, int image_dimensions, int bytes_per_pixel,
+			  pixel red_comp_mask, pixel green_comp_mask,
+			  pixel blue_comp_mask, pixel transparency_mask)
+{
+	byte *new_image_ptr;
+	int new_image_dimensions;
+	pixel texel_list[4];
+	int row, column, index;
+	int texel_offset, offset;
+
+	// Each level is made by averaging each 2x2 block of texels in the level
+	// before it.  The blocks never straddle the edge of the image, so tiling
+	// is preserved.
+
+	while (image_dimensions > 1) {
+		new_image_ptr = image_ptr + image_dimensions * image_dimensions *
+			bytes_per_pixel;
+		new_image_dimensions = image_dimensions >> 1;
+		for (row = 0; row < new_image_dimensions; row++)
+			for (column = 0; column < new_image_dimensions; column++) {
+				texel_offset = (row << 1) * image_dimensions + (column << 1);
+				for (index = 0; index < 4; index++) {
+					offset = texel_offset + (index >> 1) * image_dimensions +
+						(index & 1);
+					if (bytes_per_pixel == 2)
+						texel_list[index] = ((word *)image_ptr)[offset];
+					else
+						texel_list[index] = ((pixel *)image_ptr)[offset];
+				}
+				index = row * new_image_dimensions + column;
+				if (bytes_per_pixel == 2)
+					put_pixel16(new_image_ptr + (index << 1),
+						average_texels(texel_list, red_comp_mask,
+						green_comp_mask, blue_comp_mask, transparency_mask));
+				else
+					put_pixel32(new_image_ptr + (index << 2),
+						average_texels(texel_list, red_comp_mask,
+						green_comp_mask, blue_comp_mask, transparency_mask));
+			}
+		image_ptr = new_image_ptr;
+		image_dimensions = new_image_dimensions;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Choose the mipmap level to render a texture mapped span with, from the
+// number of texels stepped per pixel at the centre of the span.  The level is
+// the one at which this step is closest to but not more than one texel.
+//------------------------------------------------------------------------------
+
+int
+get_span_mipmap_level(span *span_ptr, int levels)
+{
+	float half_width;
+	float one_on_tz, u_on_tz, v_on_tz;
+	float delta_u, delta_v, texel_step;
+	int level;
+
+	// Compute 1/tz, u/tz and v/tz at the centre of the span.  A zero starting
+	// 1/tz is treated as one, as it is when the span is drawn.
+
+	half_width = (span_ptr->end_sx - span_ptr->start_sx) * 0.5f;
+	one_on_tz = span_ptr->start_span.one_on_tz;
+	if (one_on_tz == 0.0f)
+		one_on_tz = 1.0f;
+	one_on_tz += span_ptr->delta_span.one_on_tz * half_width;
+	if (one_on_tz <= 0.0f)
+		return(0);
+	u_on_tz = span_ptr->start_span.u_on_tz +
+		span_ptr->delta_span.u_on_tz * half_width;
+	v_on_tz = span_ptr->start_span.v_on_tz +
+		span_ptr->delta_span.v_on_tz * half_width;
+
+	// Differentiate u and v with respect to the screen x coordinate, and use
+	// the larger of the two as the texel step.
+
+	delta_u = (span_ptr->delta_span.u_on_tz * one_on_tz -
+		u_on_tz * span_ptr->delta_span.one_on_tz) / (one_on_tz * one_on_tz);
+	delta_v = (span_ptr->delta_span.v_on_tz * one_on_tz -
+		v_on_tz * span_ptr->delta_span.one_on_tz) / (one_on_tz * one_on_tz);
+	texel_step = FMAX(fabsf(delta_u), fabsf(delta_v));
+
+	// Halve the texel step for each level until it's under two texels.
+
+	level = 0;
+	while (texel_step >= 2.0f && level < levels - 1) {
+		texel_step *= 0.5f;
+		level++;
+	}
+	return(level);
+}
+
+//------------------------------------------------------------------------------
+// Render a colour span to a 16, 24 or 32-bit frame buffer.
+//------------------------------------------------------------------------------
+
+void
+draw_colour_span(byte *fb_ptr, int fb_depth, pixel colour_pixel,
+				 int span_width)
+{
+	int pixel_index;
+
+	pixel_index = 0;
+	switch (fb_depth) {
+	case 16:
+
+#ifdef RASTER_SSE2
+		for (; pixel_index + 8 <= span_width; pixel_index += 8)
+			_mm_storeu_si128((__m128i *)(fb_ptr + (pixel_index << 1)),
+				_mm_set1_epi16((short)colour_pixel));
+#endif
+
+		for (; pixel_index < span_width; pixel_index++)
+			put_pixel16(fb_ptr + (pixel_index << 1), colour_pixel);
+		break;
+	case 24:
+		for (; pixel_index < span_width; pixel_index++)
+			put_pixel24(fb_ptr + pixel_index * 3, colour_pixel);
+		break;
+	case 32:
+
+#ifdef RASTER_SSE2
+		for (; pixel_index + 4 <= span_width; pixel_index += 4)
+			_mm_storeu_si128((__m128i *)(fb_ptr + (pixel_index << 2)),
+				_mm_set1_epi32((int)colour_pixel));
+#endif
+
+		for (; pixel_index < span_width; pixel_index++)
+			put_pixel32(fb_ptr + (pixel_index << 2), colour_pixel);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Compute the fixed point (u,v) coordinates at a list of span end points,
+// which are spaced SPAN_WIDTH pixels apart starting at the given end point.
+//------------------------------------------------------------------------------
+
+static void
+compute_span_uv(span_data *start_span_ptr, span_data *scaled_delta_span_ptr,
+				int first_point, int points, fixed *u_list, fixed *v_list)
+{
+	int point;
+
+#ifdef RASTER_SSE2
+
+	// Compute four end points at a time, with a single divide for all four
+	// 1/tz values.
+
+	__m128 point_vec, tz_vec;
+	for (point = 0; point < points; point += 4) {
+		point_vec = _mm_add_ps(_mm_set1_ps((float)(first_point + point)),
+			_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+		tz_vec = _mm_div_ps(_mm_set1_ps(65536.0f),
+			_mm_add_ps(_mm_set1_ps(start_span_ptr->one_on_tz),
+			_mm_mul_ps(point_vec, _mm_set1_ps(scaled_delta_span_ptr->one_on_tz))));
+		_mm_storeu_si128((__m128i *)(u_list + point), _mm_cvtps_epi32(_mm_mul_ps(tz_vec,
+			_mm_add_ps(_mm_set1_ps(start_span_ptr->u_on_tz),
+			_mm_mul_ps(point_vec, _mm_set1_ps(scaled_delta_span_ptr->u_on_tz))))));
+		_mm_storeu_si128((__m128i *)(v_list + point), _mm_cvtps_epi32(_mm_mul_ps(tz_vec,
+			_mm_add_ps(_mm_set1_ps(start_span_ptr->v_on_tz),
+			_mm_mul_ps(point_vec, _mm_set1_ps(scaled_delta_span_ptr->v_on_tz))))));
+	}
+
+#else
+
+	float point_no, tz;
+	for (point = 0; point < points; point++) {
+		point_no = (float)(first_point + point);
+		tz = 65536.0f / (start_span_ptr->one_on_tz +
+			point_no * scaled_delta_span_ptr->one_on_tz);
+		u_list[point] = (fixed)lrintf((start_span_ptr->u_on_tz +
+			point_no * scaled_delta_span_ptr->u_on_tz) * tz);
+		v_list[point] = (fixed)lrintf((start_span_ptr->v_on_tz +
+			point_no * scaled_delta_span_ptr->v_on_tz) * tz);
+	}
+
+#endif
+
+}
+
+#if defined(RASTER_AVX2)
+
+//------------------------------------------------------------------------------
+// Gather eight texels from a lit image.  Texels in a 16-bit lit image are read
+// via the aligned double word that holds them, so that the gather never reads
+// past the end of the image.
+//------------------------------------------------------------------------------
+
+static inline __m256i
+gather_texels(byte *image_ptr, int fb_depth, __m256i u_vec, __m256i v_vec,
+			  __m256i mask_vec, __m128i shift_count)
+{
+	__m256i index_vec, dword_vec, half_shift_vec;
+
+	index_vec = _mm256_or_si256(
+		_mm256_srli_epi32(_mm256_and_si256(u_vec, mask_vec), FRAC_BITS),
+		_mm256_srl_epi32(_mm256_and_si256(v_vec, mask_vec), shift_count));
+	if (fb_depth == 16) {
+		dword_vec = _mm256_i32gather_epi32((const int *)image_ptr,
+			_mm256_srli_epi32(index_vec, 1), 4);
+		half_shift_vec = _mm256_slli_epi32(_mm256_and_si256(index_vec,
+			_mm256_set1_epi32(1)), 4);
+		return(_mm256_and_si256(_mm256_srlv_epi32(dword_vec, half_shift_vec),
+			_mm256_set1_epi32(0xffff)));
+	}
+	return(_mm256_i32gather_epi32((const int *)image_ptr, index_vec, 4));
+}
+
+//------------------------------------------------------------------------------
+// Shade eight texels.  No component straddles a 16-bit lane, so each can be
+// scaled with an unsigned high multiply by the scale shifted into the top byte.
+//------------------------------------------------------------------------------
+
+static inline __m256i
+shade_texels(__m256i texel_vec, __m256i *shade_vec_list)
+{
+	__m256i scale_vec = shade_vec_list[SHADE_SCALE];
+
+	return(_mm256_or_si256(_mm256_or_si256(
+		_mm256_and_si256(_mm256_mulhi_epu16(_mm256_and_si256(texel_vec,
+			shade_vec_list[SHADE_RED]), scale_vec), shade_vec_list[SHADE_RED]),
+		_mm256_and_si256(_mm256_mulhi_epu16(_mm256_and_si256(texel_vec,
+			shade_vec_list[SHADE_GREEN]), scale_vec), shade_vec_list[SHADE_GREEN])),
+		_mm256_or_si256(
+		_mm256_and_si256(_mm256_mulhi_epu16(_mm256_and_si256(texel_vec,
+			shade_vec_list[SHADE_BLUE]), scale_vec), shade_vec_list[SHADE_BLUE]),
+		_mm256_and_si256(texel_vec, shade_vec_list[SHADE_KEEP]))));
+}
+
+#elif defined(RASTER_SSE2)
+
+//------------------------------------------------------------------------------
+// Gather four texels from a lit image.  SSE2 has no gather instruction, so the
+// indices are computed in parallel and the loads are done one at a time.
+//------------------------------------------------------------------------------
+
+static inline __m128i
+gather_texels(byte *image_ptr, int fb_depth, __m128i u_vec, __m128i v_vec,
+			  __m128i mask_vec, __m128i shift_count)
+{
+	int index_list[4];
+
+	_mm_storeu_si128((__m128i *)index_list, _mm_or_si128(
+		_mm_srli_epi32(_mm_and_si128(u_vec, mask_vec), FRAC_BITS),
+		_mm_srl_epi32(_mm_and_si128(v_vec, mask_vec), shift_count)));
+	if (fb_depth == 16)
+		return(_mm_setr_epi32(((word *)image_ptr)[index_list[0]],
+			((word *)image_ptr)[index_list[1]], ((word *)image_ptr)[index_list[2]],
+			((word *)image_ptr)[index_list[3]]));
+	return(_mm_setr_epi32(((int *)image_ptr)[index_list[0]],
+		((int *)image_ptr)[index_list[1]], ((int *)image_ptr)[index_list[2]],
+		((int *)image_ptr)[index_list[3]]));
+}
+
+//------------------------------------------------------------------------------
+// Shade four texels.  No component straddles a 16-bit lane, so each can be
+// scaled with an unsigned high multiply by the scale shifted into the top byte.
+//------------------------------------------------------------------------------
+
+static inline __m128i
+shade_texels(__m128i texel_vec, __m128i *shade_vec_list)
+{
+	__m128i scale_vec = shade_vec_list[SHADE_SCALE];
+
+	return(_mm_or_si128(_mm_or_si128(
+		_mm_and_si128(_mm_mulhi_epu16(_mm_and_si128(texel_vec,
+			shade_vec_list[SHADE_RED]), scale_vec), shade_vec_list[SHADE_RED]),
+		_mm_and_si128(_mm_mulhi_epu16(_mm_and_si128(texel_vec,
+			shade_vec_list[SHADE_GREEN]), scale_vec), shade_vec_list[SHADE_GREEN])),
+		_mm_or_si128(
+		_mm_and_si128(_mm_mulhi_epu16(_mm_and_si128(texel_vec,
+			shade_vec_list[SHADE_BLUE]), scale_vec), shade_vec_list[SHADE_BLUE]),
+		_mm_and_si128(texel_vec, shade_vec_list[SHADE_KEEP]))));
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+// Render up to SPAN_WIDTH texture mapped pixels with linearly interpolated
+// (u,v) coordinates, skipping pixels whose texel is transparent.  If a shading
+// brightness is given, each texel is shaded before it is written.
+//------------------------------------------------------------------------------
+
+static void
+draw_texels(byte *fb_ptr, int fb_depth, byte *image_ptr, int mask, int shift,
+			pixel transparency_mask, texel_shade *shade_ptr, fixed u, fixed v,
+			fixed delta_u, fixed delta_v, int pixels)
+{
+	pixel texel;
+	int pixel_index;
+
+	pixel_index = 0;
+
+#if defined(RASTER_AVX2)
+
+	// Render eight pixels at a time for 16-bit and 32-bit frame buffers,
+	// blending each texel with the frame buffer according to its
+	// transparency.
+
+	if (fb_depth != 24 && pixels >= 8) {
+		__m256i u_vec, v_vec, delta_u_vec, delta_v_vec, mask_vec, zero_vec;
+		__m256i transparency_mask_vec, texel_vec, transparent_vec;
+		__m256i shade_vec_list[SHADE_VECTORS];
+		__m128i shift_count, texel16_vec, transparent16_vec, old16_vec;
+
+		u_vec = _mm256_setr_epi32(u, u + delta_u, u + delta_u * 2,
+			u + delta_u * 3, u + delta_u * 4, u + delta_u * 5, u + delta_u * 6,
+			u + delta_u * 7);
+		v_vec = _mm256_setr_epi32(v, v + delta_v, v + delta_v * 2,
+			v + delta_v * 3, v + delta_v * 4, v + delta_v * 5, v + delta_v * 6,
+			v + delta_v * 7);
+		delta_u_vec = _mm256_set1_epi32(delta_u << 3);
+		delta_v_vec = _mm256_set1_epi32(delta_v << 3);
+		mask_vec = _mm256_set1_epi32(mask);
+		shift_count = _mm_cvtsi32_si128(shift);
+		transparency_mask_vec = _mm256_set1_epi32((int)transparency_mask);
+		zero_vec = _mm256_setzero_si256();
+		if (shade_ptr != NULL) {
+			shade_vec_list[SHADE_SCALE] =
+				_mm256_set1_epi16((short)(shade_ptr->scale << 8));
+			shade_vec_list[SHADE_RED] =
+				_mm256_set1_epi32((int)shade_ptr->red_mask);
+			shade_vec_list[SHADE_GREEN] =
+				_mm256_set1_epi32((int)shade_ptr->green_mask);
+			shade_vec_list[SHADE_BLUE] =
+				_mm256_set1_epi32((int)shade_ptr->blue_mask);
+			shade_vec_list[SHADE_KEEP] = _mm256_set1_epi32(
+				(int)~(shade_ptr->red_mask | shade_ptr->green_mask |
+				shade_ptr->blue_mask));
+		}
+		for (; pixel_index + 8 <= pixels; pixel_index += 8) {
+			texel_vec = gather_texels(image_ptr, fb_depth, u_vec, v_vec,
+				mask_vec, shift_count);
+			if (shade_ptr != NULL)
+				texel_vec = shade_texels(texel_vec, shade_vec_list);
+			transparent_vec = _mm256_cmpeq_epi32(_mm256_and_si256(texel_vec,
+				transparency_mask_vec), zero_vec);
+			if (fb_depth == 16) {
+				texel16_vec = _mm256_castsi256_si128(_mm256_permute4x64_epi64(
+					_mm256_packus_epi32(texel_vec, texel_vec), 0x08));
+				transparent16_vec = _mm256_castsi256_si128(_mm256_permute4x64_epi64(
+					_mm256_packs_epi32(transparent_vec, transparent_vec), 0x08));
+				old16_vec = _mm_loadu_si128((__m128i *)fb_ptr);
+				_mm_storeu_si128((__m128i *)fb_ptr,
+					_mm_blendv_epi8(texel16_vec, old16_vec, transparent16_vec));
+				fb_ptr += 16;
+			} else {
+				_mm256_storeu_si256((__m256i *)fb_ptr, _mm256_blendv_epi8(texel_vec,
+					_mm256_loadu_si256((__m256i *)fb_ptr), transparent_vec));
+				fb_ptr += 32;
+			}
+			u_vec = _mm256_add_epi32(u_vec, delta_u_vec);
+			v_vec = _mm256_add_epi32(v_vec, delta_v_vec);
+			u += delta_u << 3;
+			v += delta_v << 3;
+		}
+	}
+
+#elif defined(RASTER_SSE2)
+
+	// Render four pixels at a time for 32-bit frame buffers, and eight pixels
+	// at a time for 16-bit frame buffers, blending each texel with the frame
+	// buffer according to its transparency.
+
+	if (fb_depth != 24 && pixels >= 4) {
+		__m128i u_vec, v_vec, delta_u_vec, delta_v_vec, mask_vec, zero_vec;
+		__m128i transparency_mask_vec, texel_vec, transparent_vec, old_vec;
+		__m128i texel2_vec, transparent2_vec;
+		__m128i shade_vec_list[SHADE_VECTORS];
+		__m128i shift_count;
+
+		u_vec = _mm_setr_epi32(u, u + delta_u, u + delta_u * 2, u + delta_u * 3);
+		v_vec = _mm_setr_epi32(v, v + delta_v, v + delta_v * 2, v + delta_v * 3);
+		delta_u_vec = _mm_set1_epi32(delta_u << 2);
+		delta_v_vec = _mm_set1_epi32(delta_v << 2);
+		mask_vec = _mm_set1_epi32(mask);
+		shift_count = _mm_cvtsi32_si128(shift);
+		transparency_mask_vec = _mm_set1_epi32((int)transparency_mask);
+		zero_vec = _mm_setzero_si128();
+		if (shade_ptr != NULL) {
+			shade_vec_list[SHADE_SCALE] =
+				_mm_set1_epi16((short)(shade_ptr->scale << 8));
+			shade_vec_list[SHADE_RED] = _mm_set1_epi32((int)shade_ptr->red_mask);
+			shade_vec_list[SHADE_GREEN] =
+				_mm_set1_epi32((int)shade_ptr->green_mask);
+			shade_vec_list[SHADE_BLUE] = _mm_set1_epi32((int)shade_ptr->blue_mask);
+			shade_vec_list[SHADE_KEEP] = _mm_set1_epi32(
+				(int)~(shade_ptr->red_mask | shade_ptr->green_mask |
+				shade_ptr->blue_mask));
+		}
+		if (fb_depth == 16) {
+			for (; pixel_index + 8 <= pixels; pixel_index += 8) {
+				texel_vec = gather_texels(image_ptr, fb_depth, u_vec, v_vec,
+					mask_vec, shift_count);
+				transparent_vec = _mm_cmpeq_epi32(_mm_and_si128(texel_vec,
+					transparency_mask_vec), zero_vec);
+				u_vec = _mm_add_epi32(u_vec, delta_u_vec);
+				v_vec = _mm_add_epi32(v_vec, delta_v_vec);
+				texel2_vec = gather_texels(image_ptr, fb_depth, u_vec, v_vec,
+					mask_vec, shift_count);
+				transparent2_vec = _mm_cmpeq_epi32(_mm_and_si128(texel2_vec,
+					transparency_mask_vec), zero_vec);
+				u_vec = _mm_add_epi32(u_vec, delta_u_vec);
+				v_vec = _mm_add_epi32(v_vec, delta_v_vec);
+				if (shade_ptr != NULL) {
+					texel_vec = shade_texels(texel_vec, shade_vec_list);
+					texel2_vec = shade_texels(texel2_vec, shade_vec_list);
+				}
+
+				// SSE2 can only pack with signed saturation, so sign extend the
+				// 16-bit texels first.
+
+				texel_vec = _mm_packs_epi32(
+					_mm_srai_epi32(_mm_slli_epi32(texel_vec, 16), 16),
+					_mm_srai_epi32(_mm_slli_epi32(texel2_vec, 16), 16));
+				transparent_vec = _mm_packs_epi32(transparent_vec, transparent2_vec);
+				old_vec = _mm_loadu_si128((__m128i *)fb_ptr);
+				_mm_storeu_si128((__m128i *)fb_ptr, _mm_or_si128(
+					_mm_and_si128(transparent_vec, old_vec),
+					_mm_andnot_si128(transparent_vec, texel_vec)));
+				fb_ptr += 16;
+				u += delta_u << 3;
+				v += delta_v << 3;
+			}
+		} else {
+			for (; pixel_index + 4 <= pixels; pixel_index += 4) {
+				texel_vec = gather_texels(image_ptr, fb_depth, u_vec, v_vec,
+					mask_vec, shift_count);
+				if (shade_ptr != NULL)
+					texel_vec = shade_texels(texel_vec, shade_vec_list);
+				transparent_vec = _mm_cmpeq_epi32(_mm_and_si128(texel_vec,
+					transparency_mask_vec), zero_vec);
+				old_vec = _mm_loadu_si128((__m128i *)fb_ptr);
+				_mm_storeu_si128((__m128i *)fb_ptr, _mm_or_si128(
+					_mm_and_si128(transparent_vec, old_vec),
+					_mm_andnot_si128(transparent_vec, texel_vec)));
+				fb_ptr += 16;
+				u_vec = _mm_add_epi32(u_vec, delta_u_vec);
+				v_vec = _mm_add_epi32(v_vec, delta_v_vec);
+				u += delta_u << 2;
+				v += delta_v << 2;
+			}
+		}
+	}
+
+#endif
+
+	// Render the remaining pixels one at a time.
+
+	switch (fb_depth) {
+	case 16:
+		for (; pixel_index < pixels; pixel_index++) {
+			texel = ((word *)image_ptr)[TEXEL_INDEX(u, v, mask, shift)];
+			if (texel & transparency_mask)
+				put_pixel16(fb_ptr, shade_ptr != NULL ?
+					shade_texel(texel, shade_ptr) : texel);
+			fb_ptr += 2;
+			u += delta_u;
+			v += delta_v;
+		}
+		break;
+	case 24:
+		for (; pixel_index < pixels; pixel_index++) {
+			texel = ((pixel *)image_ptr)[TEXEL_INDEX(u, v, mask, shift)];
+			if (texel & transparency_mask)
+				put_pixel24(fb_ptr, shade_ptr != NULL ?
+					shade_texel(texel, shade_ptr) : texel);
+			fb_ptr += 3;
+			u += delta_u;
+			v += delta_v;
+		}
+		break;
+	case 32:
+		for (; pixel_index < pixels; pixel_index++) {
+			texel = ((pixel *)image_ptr)[TEXEL_INDEX(u, v, mask, shift)];
+			if (texel & transparency_mask)
+				put_pixel32(fb_ptr, shade_ptr != NULL ?
+					shade_texel(texel, shade_ptr) : texel);
+			fb_ptr += 4;
+			u += delta_u;
+			v += delta_v;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Render a perspective correct, possibly transparent texture mapped span to a
+// 16, 24 or 32-bit frame buffer.  The (u,v) coordinates are computed exactly
+// every SPAN_WIDTH pixels, and linearly interpolated in between.  If shade_ptr
+// is not NULL, the lit image is at full brightness and each texel is shaded to
+// the span's brightness as it is drawn.  The texels are read from the given
+// mipmap level of the lit image.
+//------------------------------------------------------------------------------
+
+void
+draw_texture_span(byte *fb_ptr, int fb_depth, span *span_ptr,
+				  cache_entry *cache_entry_ptr, pixel transparency_mask,
+				  texel_shade *shade_ptr, int level)
+{
+	span_data start_span, scaled_delta_span;
+	fixed u_list[UV_LIST_SIZE], v_list[UV_LIST_SIZE];
+	fixed delta_u, delta_v;
+	byte *image_ptr;
+	int image_dimensions, image_mask, image_shift;
+	int bytes_per_pixel, lit_bytes_per_pixel;
+	int pixels_left, pixels;
+	int first_point, points, point;
+	int level_no;
+
+	// Ignore span if it has zero width.
+
+	pixels_left = span_ptr->end_sx - span_ptr->start_sx;
+	if (pixels_left <= 0)
+		return;
+
+	// Locate the mipmap level, which follows the larger levels in the lit
+	// image, and adjust the u/v coordinate mask and v coordinate shift to suit
+	// its dimensions.
+
+	image_ptr = cache_entry_ptr->lit_image_ptr;
+	image_dimensions = (cache_entry_ptr->lit_image_mask >> FRAC_BITS) + 1;
+	lit_bytes_per_pixel = fb_depth == 16 ? 2 : 4;
+	for (level_no = 0; level_no < level; level_no++) {
+		image_ptr += image_dimensions * image_dimensions * lit_bytes_per_pixel;
+		image_dimensions >>= 1;
+	}
+	image_mask = (cache_entry_ptr->lit_image_mask >> level) & INT_MASK;
+	image_shift = cache_entry_ptr->lit_image_shift + level;
+
+	// Get the starting 1/tz value; if it is zero, make it one (this is used
+	// by sky spans to ensure they are furthest from the viewer, rather than
+	// using a tiny 1/tz value that introduces errors into the texture
+	// coordinates).
+
+	start_span = span_ptr->start_span;
+	if (start_span.one_on_tz == 0.0f)
+		start_span.one_on_tz = 1.0f;
+
+	// Pre-scale the deltas for faster calculations when rendering spans that
+	// are SPAN_WIDTH in width.
+
+	scaled_delta_span.one_on_tz = span_ptr->delta_span.one_on_tz * SPAN_WIDTH;
+	scaled_delta_span.u_on_tz = span_ptr->delta_span.u_on_tz * SPAN_WIDTH;
+	scaled_delta_span.v_on_tz = span_ptr->delta_span.v_on_tz * SPAN_WIDTH;
+
+	// Render the span SPAN_WIDTH pixels at a time, computing the (u,v)
+	// coordinates at the end points in batches.  The last piece may be
+	// shorter, but is interpolated as if it were a full SPAN_WIDTH.
+
+	bytes_per_pixel = fb_depth >> 3;
+	first_point = 0;
+	while (pixels_left > 0) {
+		points = ((pixels_left + SPAN_WIDTH - 1) >> SPAN_SHIFT) + 1;
+		if (points > UV_BATCH + 1)
+			points = UV_BATCH + 1;
+		compute_span_uv(&start_span, &scaled_delta_span, first_point, points,
+			u_list, v_list);
+		if (level > 0)
+			for (point = 0; point < points; point++) {
+				u_list[point] >>= level;
+				v_list[point] >>= level;
+			}
+		for (point = 1; point < points; point++) {
+			pixels = pixels_left < SPAN_WIDTH ? pixels_left : SPAN_WIDTH;
+			delta_u = (u_list[point] - u_list[point - 1]) >> SPAN_SHIFT;
+			delta_v = (v_list[point] - v_list[point - 1]) >> SPAN_SHIFT;
+			draw_texels(fb_ptr, fb_depth, image_ptr, image_mask, image_shift,
+				transparency_mask, shade_ptr, u_list[point - 1],
+				v_list[point - 1], delta_u, delta_v, pixels);
+			fb_ptr += pixels * bytes_per_pixel;
+			pixels_left -= pixels;
+		}
+		first_point += points - 1;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Render an unscaled span of an 8-bit or 16-bit image into a 16, 24 or 32-bit
+// frame buffer, lighting each texel through the palette and skipping those that
+// are transparent.  The image width and u are given in bytes, and u wraps back
+// to zero when it reaches the image width.
+//------------------------------------------------------------------------------
+
+void
+draw_linear_span(byte *fb_ptr, int fb_depth, bool image_is_16_bit,
+				 byte *image_ptr, pixel *palette_ptr, int transparent_index,
+				 pixel transparency_mask, int image_width, int span_width,
+				 fixed u)
+{
+	int bytes_per_pixel, texel_bytes;
+	int index;
+	pixel lit_pixel;
+
+	bytes_per_pixel = fb_depth >> 3;
+	texel_bytes = image_is_16_bit ? 2 : 1;
+	while (span_width-- > 0) {
+
+		// Get the texel; if it's transparent, skip this pixel, otherwise
+		// use it as an index into the palette to obtain the lit pixel.
+
+		if (image_is_16_bit) {
+			index = *(word *)(image_ptr + u);
+			if (index & transparency_mask)
+				index &= 0x7fff;
+			else
+				index = -1;
+		} else {
+			index = image_ptr[u];
+			if (index == transparent_index)
+				index = -1;
+		}
+		if (index >= 0) {
+			lit_pixel = palette_ptr[index];
+			switch (fb_depth) {
+			case 16:
+				put_pixel16(fb_ptr, lit_pixel);
+				break;
+			case 24:
+				put_pixel24(fb_ptr, lit_pixel);
+				break;
+			case 32:
+				put_pixel32(fb_ptr, lit_pixel);
+			}
+		}
+
+		// Advance the frame buffer pointer, and advance u, wrapping to zero if
+		// it equals image_width.
+
+		fb_ptr += bytes_per_pixel;
+		u += texel_bytes;
+		if (u >= image_width)
+			u = 0;
+	}
+}
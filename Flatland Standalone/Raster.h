@@ -0,0 +1,59 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Width of a linearly interpolated texture span.
+
+#define SPAN_WIDTH			32
+#define SPAN_SHIFT			5
+
+// Brightness to shade texels to as they are drawn, as a scale from 0 to 256,
+// and the masks of the red, green and blue components within a display pixel.
+
+struct texel_shade {
+	pixel scale;
+	pixel red_mask;
+	pixel green_mask;
+	pixel blue_mask;
+};
+
+// Externally visible functions.
+
+void
+convert_image(byte *image_ptr, int image_width, int image_height,
+			  int bytes_per_pixel, pixel *palette_ptr, int transparent_index,
+			  pixel transparency_mask, byte *new_image_ptr,
+			  int new_image_dimensions, int new_bytes_per_pixel,
+			  int new_row_pitch);
+
+void
+get_component_masks(pixel_format *format_ptr, pixel &red_comp_mask,
+					pixel &green_comp_mask, pixel &blue_comp_mask);
+
+void
+set_texel_shade(texel_shade *shade_ptr, pixel_format *format_ptr,
+				int brightness_index);
+
+void
+build_mipmaps(byte *image_ptr, int image_dimensions, int bytes_per_pixel,
+			  pixel red_comp_mask, pixel green_comp_mask,
+			  pixel blue_comp_mask, pixel transparency_mask);
+
+int
+get_span_mipmap_level(span *span_ptr, int levels);
+
+void
+draw_colour_span(byte *fb_ptr, int fb_depth, pixel colour_pixel,
+				 int span_width);
+
+void
+draw_texture_span(byte *fb_ptr, int fb_depth, span *span_ptr,
+				  cache_entry *cache_entry_ptr, pixel transparency_mask,
+				  texel_shade *shade_ptr, int level);
+
+void
+draw_linear_span(byte *fb_ptr, int fb_depth, bool image_is_16_bit,
+				 byte *image_ptr, pixel *palette_ptr, int transparent_index,
+				 pixel transparency_mask, int image_width, int span_width,
+				 fixed u);
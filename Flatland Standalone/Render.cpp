@@ -16,6 +16,7 @@
 #include "Parser.h"
 #include "Platform.h"
 #include "Plugin.h"
+#include "Profile.h"
 #include "Render.h"
 #include "Spans.h"
 #include "Utils.h"
@@ -26,6 +27,12 @@
 #define INTERSECTS_FRUSTUM	1
 #define INSIDE_FRUSTUM		2
 
+// Maximum number of threads that render spans, and the number of frame buffer
+// rows in each band handed to a render thread.
+
+#define MAX_RENDER_THREADS	32
+#define ROWS_PER_BAND		8
+
 // List of solid colour spans, transparent transformed polygons and colour transformed polygons.
 
 static span *colour_span_list;
@@ -56,17 +63,42 @@ static vertex block_centre;
 
 static vertex block_translation;
 
+// The lighting stamp that the cached lighting of the current block's polygons
+// must have to be reused.
+
+static unsigned int curr_lighting_stamp;
+
 // The current block's transformed vertex list.
 
 static int max_block_vertices;
 static vertex *block_tvertex_list;
 
-// The current polygon's vertex colour list and front face visible flag.
+// The transformed bounding box corners of the last block and chunk compared
+// against the frustum.
+
+static vertex block_tbbox_list[8];
+static vertex chunk_tbbox_list[8];
+
+// The current polygon's vertex colour list, world vertex list (used for
+// lighting) and front face visible flag.
 
 static int max_polygon_vertices;
 static RGBcolour *vertex_colour_list;
+static vertex *polygon_vertex_list;
 static bool front_face_visible;
 
+// The centroid, normal vector and brightness of each of the current block's
+// polygons that were lit in a batch by the software renderer, the numbers of
+// those polygons, and a flag indicating whether the current block's polygons
+// were lit this way.
+
+static int max_block_polygons;
+static vertex *polygon_centroid_list;
+static vector *polygon_normal_list;
+static float *polygon_brightness_list;
+static int *lit_polygon_no_list;
+static bool block_polygons_lit;
+
 // Variables used to keep track of currently rendered polygon.
 
 static int spoints;						// Number of spoints.
@@ -130,6 +162,21 @@ static float curr_orb_width, curr_orb_height;
 
 static bool rendering_block_as_bitmap;
 
+// Number of threads rendering spans (including the player thread), and the
+// number of span buffer rows to render in the current frame.
+
+static int render_threads;
+static int render_rows;
+
+// Render thread handles and numbers, and the events used to start a render
+// thread on a frame and to signal when it is done.  Entry zero is the player
+// thread.
+
+static unsigned long render_thread_handle_list[MAX_RENDER_THREADS];
+static int render_thread_no_list[MAX_RENDER_THREADS];
+static event render_start_event_list[MAX_RENDER_THREADS];
+static event render_done_event_list[MAX_RENDER_THREADS];
+
 // Values saved during rendering of blocks as bitmaps.
 
 static float saved_units_per_block;
@@ -147,8 +194,14 @@ init_renderer(void)
 {
 	block_tvertex_list = NULL;
 	vertex_colour_list = NULL;
+	polygon_vertex_list = NULL;
+	polygon_centroid_list = NULL;
+	polygon_normal_list = NULL;
+	polygon_brightness_list = NULL;
+	lit_polygon_no_list = NULL;
 	temp_spoint_list = NULL;
 	rendering_block_as_bitmap = false;
+	render_threads = 1;
 }
 
 //------------------------------------------------------------------------------
@@ -164,17 +217,20 @@ set_up_renderer(void)
 	polygon_def *polygon_def_ptr;
 
 	// Step through all block definitions, and remember the most vertices
-	// seen in a block and polygon.  The minimum is four (required for the
-	// ground block).
+	// seen in a block and polygon, and the most polygons seen in a block.  The
+	// minimum is four vertices (required for the ground block) and one polygon.
 
 	max_block_vertices = 4;
 	max_polygon_vertices = 4;
+	max_block_polygons = 1;
 	blockset_ptr = blockset_list_ptr->first_blockset_ptr;
 	while (blockset_ptr != NULL) {
 		block_def_ptr = blockset_ptr->block_def_list;
 		while (block_def_ptr != NULL) {
 			if (block_def_ptr->vertices > max_block_vertices)
 				max_block_vertices = block_def_ptr->vertices;
+			if (block_def_ptr->polygons > max_block_polygons)
+				max_block_polygons = block_def_ptr->polygons;
 			for (polygon_no = 0; polygon_no < block_def_ptr->polygons;
 				polygon_no++) {
 				polygon_def_ptr = &block_def_ptr->polygon_def_list[polygon_no];
@@ -189,6 +245,8 @@ set_up_renderer(void)
 	while (block_def_ptr != NULL) {
 		if (block_def_ptr->vertices > max_block_vertices)
 			max_block_vertices = block_def_ptr->vertices;
+		if (block_def_ptr->polygons > max_block_polygons)
+			max_block_polygons = block_def_ptr->polygons;
 		for (polygon_no = 0; polygon_no < block_def_ptr->polygons; 
 			polygon_no++) {
 			polygon_def_ptr = &block_def_ptr->polygon_def_list[polygon_no];
@@ -198,11 +256,6 @@ set_up_renderer(void)
 		block_def_ptr = block_def_ptr->next_block_def_ptr;
 	}
 
-	// Initialise the free transformed vertex and polygon lists.
-
-	init_free_tvertex_list();
-	init_free_tpolygon_list();
-
 	// Initialise the screen polygon list.  The maximum number of screen points
 	// per polygon must be the maximum number of polygon vertices + 5; this
 	// caters for polygons clipped to the viewing plane and the four screen
@@ -222,6 +275,22 @@ set_up_renderer(void)
 	if (vertex_colour_list == NULL)
 		memory_error("vertex colour list");
 
+	// Create the polygon vertex list.
+
+	NEWARRAY(polygon_vertex_list, vertex, max_polygon_vertices);
+	if (polygon_vertex_list == NULL)
+		memory_error("polygon vertex list");
+
+	// Create the lists used to light a block's polygons in a batch.
+
+	NEWARRAY(polygon_centroid_list, vertex, max_block_polygons);
+	NEWARRAY(polygon_normal_list, vector, max_block_polygons);
+	NEWARRAY(polygon_brightness_list, float, max_block_polygons);
+	NEWARRAY(lit_polygon_no_list, int, max_block_polygons);
+	if (polygon_centroid_list == NULL || polygon_normal_list == NULL ||
+		polygon_brightness_list == NULL || lit_polygon_no_list == NULL)
+		memory_error("polygon lighting lists");
+
 	// Create the temp screen point list.
 
 	NEWARRAY(temp_spoint_list, spoint, max_polygon_vertices + 5);
@@ -245,6 +314,26 @@ clean_up_renderer(void)
 		DELARRAY(vertex_colour_list, RGBcolour, max_polygon_vertices);
 		vertex_colour_list = NULL;
 	}
+	if (polygon_vertex_list != NULL) {
+		DELARRAY(polygon_vertex_list, vertex, max_polygon_vertices);
+		polygon_vertex_list = NULL;
+	}
+	if (polygon_centroid_list != NULL) {
+		DELARRAY(polygon_centroid_list, vertex, max_block_polygons);
+		polygon_centroid_list = NULL;
+	}
+	if (polygon_normal_list != NULL) {
+		DELARRAY(polygon_normal_list, vector, max_block_polygons);
+		polygon_normal_list = NULL;
+	}
+	if (polygon_brightness_list != NULL) {
+		DELARRAY(polygon_brightness_list, float, max_block_polygons);
+		polygon_brightness_list = NULL;
+	}
+	if (lit_polygon_no_list != NULL) {
+		DELARRAY(lit_polygon_no_list, int, max_block_polygons);
+		lit_polygon_no_list = NULL;
+	}
 	if (temp_spoint_list != NULL) {
 		DELARRAY(temp_spoint_list, spoint, max_polygon_vertices + 5);
 		temp_spoint_list = NULL;
@@ -474,7 +563,8 @@ polygon_visible(polygon *polygon_ptr, float angle)
 
 	// If the polygon is not active, it's invisible.
 
-	if (!polygon_ptr->active)
+	if (!curr_block_ptr->polygon_active_list[polygon_ptr - 
+		curr_block_ptr->polygon_list])
 		return(false);
 
 	// If the polygon has zero faces, it's invisible.
@@ -560,6 +650,99 @@ get_polygon_bounding_box(spoint *&first_spoint_ptr, spoint *&last_spoint_ptr,
 	}
 }
 
+//------------------------------------------------------------------------------
+// Project a transformed vertex onto the screen and extend the given range of
+// screen y coordinates to include it.  If the vertex is behind the viewing
+// plane FALSE is returned, since its projection can't be relied upon.
+//------------------------------------------------------------------------------
+
+static bool
+add_tvertex_to_row_range(vertex *tvertex_ptr, float *top_sy_ptr,
+						 float *bottom_sy_ptr)
+{
+	float sy;
+
+	if (tvertex_ptr->z < 1.0f)
+		return(false);
+	sy = half_frame_buffer_height - tvertex_ptr->y * vert_scaling_factor *
+		half_frame_buffer_height / tvertex_ptr->z;
+	if (sy < *top_sy_ptr)
+		*top_sy_ptr = sy;
+	if (sy > *bottom_sy_ptr)
+		*bottom_sy_ptr = sy;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Determine whether a polygon of the current block will only cover span buffer
+// rows that are already fully covered, in which case every span it would add
+// is rejected and it doesn't need to be lit, projected or rendered.
+//------------------------------------------------------------------------------
+
+static bool
+polygon_occluded(polygon_def *polygon_def_ptr)
+{
+	float top_sy, bottom_sy;
+	int vertex_no;
+
+	// If no span buffer rows are fully covered yet, the polygon can't be
+	// occluded.
+
+	if (span_buffer_ptr->covered_rows == 0)
+		return(false);
+
+	// Determine the range of screen y coordinates covered by the polygon's
+	// transformed vertices.
+
+	PREPARE_VERTEX_DEF_LIST(polygon_def_ptr);
+	top_sy = frame_buffer_height;
+	bottom_sy = 0.0f;
+	for (vertex_no = 0; vertex_no < polygon_def_ptr->vertices; vertex_no++)
+		if (!add_tvertex_to_row_range(
+			&block_tvertex_list[vertex_def_list[vertex_no].vertex_no],
+			&top_sy, &bottom_sy))
+			return(false);
+
+	// Check whether the span buffer rows in this range are fully covered,
+	// allowing an extra row either side for rounding errors.
+
+	return(span_rows_covered((int)FCEIL(top_sy) - 1, (int)FCEIL(bottom_sy) + 1));
+}
+
+//------------------------------------------------------------------------------
+// Determine whether a transformed bounding box will only cover span buffer rows
+// that are already fully covered, in which case nothing inside it can be
+// visible.
+//------------------------------------------------------------------------------
+
+static bool
+bbox_occluded(vertex *tbbox_list)
+{
+	float top_sy, bottom_sy;
+	int corner_no;
+
+	// If no span buffer rows are fully covered yet, the bounding box can't be
+	// occluded.
+
+	if (span_buffer_ptr->covered_rows == 0)
+		return(false);
+
+	// Determine the range of screen y coordinates covered by the transformed
+	// bounding box.
+
+	top_sy = frame_buffer_height;
+	bottom_sy = 0.0f;
+	for (corner_no = 0; corner_no < 8; corner_no++)
+		if (!add_tvertex_to_row_range(&tbbox_list[corner_no], &top_sy,
+			&bottom_sy))
+			return(false);
+
+	// Check whether the span buffer rows in this range are fully covered,
+	// allowing an extra row either side for rounding errors.
+
+	return(span_rows_covered((int)FCEIL(top_sy) - 1, (int)FCEIL(bottom_sy) + 1));
+}
+
 //------------------------------------------------------------------------------
 // Clip a transformed 3D line to the viewing plane at z = 1.
 //------------------------------------------------------------------------------
@@ -1341,6 +1524,80 @@ create_transformed_polygon(polygon_def *polygon_def_ptr, pixmap *pixmap_ptr, par
 	return tpolygon_ptr;
 }
 
+//------------------------------------------------------------------------------
+// Return a pointer to the cached lighting of the given polygon in the current
+// block, or NULL if the polygon's lighting isn't cached.  Polygons rendered at
+// a turn angle (i.e. sprites) aren't cached, since the angle may change from
+// frame to frame.
+//------------------------------------------------------------------------------
+
+static lit_polygon *
+get_lit_polygon(polygon *polygon_ptr, float turn_angle)
+{
+	if (rendering_block_as_bitmap || curr_block_ptr->lit_polygon_list == NULL ||
+		!FEQ(turn_angle, 0.0f))
+		return(NULL);
+	return(&curr_block_ptr->lit_polygon_list[polygon_ptr - 
+		curr_block_ptr->polygon_list]);
+}
+
+//------------------------------------------------------------------------------
+// Return TRUE if the cached lighting of a polygon can be reused.
+//------------------------------------------------------------------------------
+
+static bool
+lit_polygon_valid(lit_polygon *lit_polygon_ptr)
+{
+	return(lit_polygon_ptr->stamp >= curr_lighting_stamp &&
+		lit_polygon_ptr->front_face == front_face_visible);
+}
+
+//------------------------------------------------------------------------------
+// Light the current block's polygons at their centroids in one batch, as the
+// software renderer does, saving the brightness of each visible polygon whose
+// cached lighting can't be reused for render_polygon() to pick up.  The
+// polygons aren't tested against the frustum, since most polygons of a visible
+// block are visible too.  The current block's vertices must already have been
+// transformed.
+//------------------------------------------------------------------------------
+
+static void
+light_polygons_in_block(void)
+{
+	int polygon_no, lit_polygons;
+	polygon *polygon_ptr;
+	vector *normal_ptr;
+
+	// Collect the centroid and normal vector of each polygon that needs to be
+	// lit, reversing the normal vector if the back of the polygon is visible.
+
+	lit_polygons = 0;
+	for (polygon_no = 0; polygon_no < curr_block_ptr->polygons; polygon_no++) {
+		polygon_ptr = &curr_block_ptr->polygon_list[polygon_no];
+		if (!polygon_visible(polygon_ptr, 0.0f) ||
+			lit_polygon_valid(&curr_block_ptr->lit_polygon_list[polygon_no]))
+			continue;
+		polygon_centroid_list[lit_polygons] = polygon_ptr->centroid + block_translation;
+		normal_ptr = &polygon_normal_list[lit_polygons];
+		*normal_ptr = polygon_ptr->normal_vector;
+		if (!front_face_visible)
+			*normal_ptr = -*normal_ptr;
+		lit_polygon_no_list[lit_polygons] = polygon_no;
+		lit_polygons++;
+	}
+
+	// Light the polygons, then move each brightness to the place of its
+	// polygon in the brightness list.  Since the polygons were collected in
+	// order, no brightness is overwritten before it's moved.
+
+	if (lit_polygons > 0)
+		compute_vertex_brightnesses(curr_block_ptr->active_light_list, lit_polygons,
+			polygon_centroid_list, polygon_normal_list, polygon_brightness_list);
+	while (--lit_polygons >= 0)
+		polygon_brightness_list[lit_polygon_no_list[lit_polygons]] = 
+			polygon_brightness_list[lit_polygons];
+}
+
 //------------------------------------------------------------------------------
 // Render a polygon.
 //------------------------------------------------------------------------------
@@ -1361,6 +1618,8 @@ render_polygon(polygon *polygon_ptr, float turn_angle)
 	part *part_ptr;
 	texture *texture_ptr;
 	pixmap *pixmap_ptr;
+	lit_polygon *lit_polygon_ptr;
+	bool lighting_cached;
 	float sy, end_sy;
 	vertex centre(units_per_half_block, units_per_half_block, units_per_half_block);
 
@@ -1411,44 +1670,61 @@ render_polygon(polygon *polygon_ptr, float turn_angle)
 		half_texel_v = 1.953125e-3;
 	}
 
+	// Get a pointer to the cached lighting of the polygon, if any, and
+	// determine whether it can be reused.
+
+	lit_polygon_ptr = get_lit_polygon(polygon_ptr, turn_angle);
+	lighting_cached = lit_polygon_ptr != NULL && lit_polygon_valid(lit_polygon_ptr);
+
 	// If hardware acceleration is enabled...
 
 	if (hardware_acceleration) {
 		int vertex_no;
-		RGBcolour *vertex_colour_ptr;
-		vertex polygon_vertex;
+		vertex *polygon_vertex_ptr;
 		tpolygon *tpolygon_ptr;
 
-		// Compute the normalised lit colour for all polygon vertices, after rotating them by the turn angle.
-		// If the turn angle is zero, we skip that step to save time.
+		// If the polygon's cached lighting is still valid, use the normalised lit colours from it.  Otherwise
+		// compute the world position of all polygon vertices, after rotating them by the turn angle (if the turn
+		// angle is zero, we skip that step to save time), then light them all in one batch and normalise the
+		// lit colours.
 
 		PREPARE_VERTEX_LIST(curr_block_ptr);
 		PREPARE_VERTEX_DEF_LIST(polygon_def_ptr);
-		if (FEQ(turn_angle, 0.0f)) {
+		if (lighting_cached) {
+			for (vertex_no = 0; vertex_no < polygon_def_ptr->vertices; vertex_no++)
+				vertex_colour_list[vertex_no] = lit_polygon_ptr->colour_list[vertex_no];
+			lit_polygon_hits++;
+		} else if (rendering_block_as_bitmap) {
 			for (vertex_no = 0; vertex_no < polygon_def_ptr->vertices; vertex_no++) {
-				polygon_vertex = *VERTEX_PTR(vertex_no) + curr_block_ptr->translation;
-				vertex_colour_ptr = &vertex_colour_list[vertex_no];
-				if (rendering_block_as_bitmap) {
-					vertex_colour_ptr->set_RGB(255.0f, 255.0f, 255.0f);
-				} else {
-					compute_vertex_colour(curr_block_ptr->active_light_list, &polygon_vertex, &normal_vector, vertex_colour_ptr);
-				}
-				vertex_colour_ptr->normalise();
+				vertex_colour_list[vertex_no].set_RGB(255.0f, 255.0f, 255.0f);
+				vertex_colour_list[vertex_no].normalise();
 			}
 		} else {
 			for (vertex_no = 0; vertex_no < polygon_def_ptr->vertices; vertex_no++) {
-				polygon_vertex = *VERTEX_PTR(vertex_no);
-				polygon_vertex -= centre;
-				polygon_vertex.rotate_y(turn_angle);
-				polygon_vertex += block_centre;
-				vertex_colour_ptr = &vertex_colour_list[vertex_no];
-				if (rendering_block_as_bitmap) {
-					vertex_colour_ptr->set_RGB(255.0f, 255.0f, 255.0f);
+				polygon_vertex_ptr = &polygon_vertex_list[vertex_no];
+				if (FEQ(turn_angle, 0.0f)) {
+					*polygon_vertex_ptr = *VERTEX_PTR(vertex_no) + curr_block_ptr->translation;
 				} else {
-					compute_vertex_colour(curr_block_ptr->active_light_list, &polygon_vertex, &normal_vector, vertex_colour_ptr);
+					*polygon_vertex_ptr = *VERTEX_PTR(vertex_no);
+					*polygon_vertex_ptr -= centre;
+					polygon_vertex_ptr->rotate_y(turn_angle);
+					*polygon_vertex_ptr += block_centre;
 				}
-				vertex_colour_ptr->normalise();
 			}
+			compute_vertex_colours(curr_block_ptr->active_light_list, polygon_def_ptr->vertices, 
+				polygon_vertex_list, &normal_vector, vertex_colour_list);
+			for (vertex_no = 0; vertex_no < polygon_def_ptr->vertices; vertex_no++)
+				vertex_colour_list[vertex_no].normalise();
+		}
+
+		// If the polygon's lighting was computed and can be cached, do so.
+
+		if (lit_polygon_ptr != NULL && !lighting_cached) {
+			for (vertex_no = 0; vertex_no < polygon_def_ptr->vertices; vertex_no++)
+				lit_polygon_ptr->colour_list[vertex_no] = vertex_colour_list[vertex_no];
+			lit_polygon_ptr->stamp = lighting_stamp;
+			lit_polygon_ptr->front_face = front_face_visible;
+			lit_polygon_misses++;
 		}
 
 		// If this polygon has no pixmap, blend it's colour with the vertex colours.
@@ -1459,11 +1735,13 @@ render_polygon(polygon *polygon_ptr, float turn_angle)
 
 		// Create the transformed polygon.
 
+		START_PROFILE(PROFILE_TRANSFORM_CLIP);
 		tpolygon_ptr = create_transformed_polygon(polygon_def_ptr, pixmap_ptr, part_ptr);
 
 		// Scale the texture interpolants in the main screen point list.
 
 		scale_tvertex_texture_interpolants(pixmap_ptr, tpolygon_ptr->tvertex_list, part_ptr->texture_style);
+		STOP_PROFILE(PROFILE_TRANSFORM_CLIP);
 
 		// Add the transformed polygon to a list in the pixmap if it has a texture, a special transparent list if it's
 		// translucent or transparent, or a special colour list if it has no texture.
@@ -1492,13 +1770,39 @@ render_polygon(polygon *polygon_ptr, float turn_angle)
 	else {
 		spoint *left_spoint_ptr, *right_spoint_ptr;
 
+		// If the polygon belongs to a fixed block and falls entirely on span
+		// buffer rows that are already fully covered, it's occluded.  Movable
+		// blocks are exempt, since their spans may replace spans already in
+		// the buffer.
+
+		if (!curr_block_movable && polygon_occluded(polygon_def_ptr))
+			return;
+
 		// Compute the brightness at the polygon centroid, and compute the colour pixel.
 
+		// If the polygon's cached lighting is still valid, use the brightness from it.
+
 		polygon_centroid = polygon_ptr->centroid + block_translation;
 		if (rendering_block_as_bitmap) {
 			brightness = 1.0f;
+		} else if (lighting_cached) {
+			brightness = lit_polygon_ptr->brightness;
+			lit_polygon_hits++;
 		} else {
-			brightness = compute_vertex_brightness(curr_block_ptr->active_light_list, &polygon_centroid, &normal_vector);
+
+			// If the block's polygons were lit in a batch, every visible polygon whose
+			// cached lighting couldn't be reused was lit, including this one.
+
+			if (block_polygons_lit && lit_polygon_ptr != NULL)
+				brightness = polygon_brightness_list[polygon_ptr - curr_block_ptr->polygon_list];
+			else
+				brightness = compute_vertex_brightness(curr_block_ptr->active_light_list, &polygon_centroid, &normal_vector);
+			if (lit_polygon_ptr != NULL) {
+				lit_polygon_ptr->brightness = brightness;
+				lit_polygon_ptr->stamp = lighting_stamp;
+				lit_polygon_ptr->front_face = front_face_visible;
+				lit_polygon_misses++;
+			}
 		}
 		brightness_index = get_brightness_index(brightness);
 		colour = part_ptr->colour;
@@ -1516,12 +1820,15 @@ render_polygon(polygon *polygon_ptr, float turn_angle)
 		// against the window.  If there are no screen points left after this
 		// process, the polygon was off-screen and does not need to be rendered.
 			
+		START_PROFILE(PROFILE_TRANSFORM_CLIP);
 		if (polygon_visibility == INTERSECTS_FRUSTUM) {
 			clip_and_project_3D_polygon(polygon_def_ptr, pixmap_ptr);
 			if (spoints > 0)
 				clip_2D_polygon();
-			if (spoints == 0)
+			if (spoints == 0) {
+				STOP_PROFILE(PROFILE_TRANSFORM_CLIP);
 				return;
+			}
 		} 
 	
 		// If the polygon is completely inside the frustum, just project it onto
@@ -1529,6 +1836,7 @@ render_polygon(polygon *polygon_ptr, float turn_angle)
 
 		else
 			project_3D_polygon(polygon_def_ptr, pixmap_ptr);
+		STOP_PROFILE(PROFILE_TRANSFORM_CLIP);
 
 		// Remember the number of screen points.
 
@@ -1572,6 +1880,7 @@ render_polygon(polygon *polygon_ptr, float turn_angle)
 		// vertex, until we've reached the bottom vertex or the bottom of
 		// the display.
 
+		START_PROFILE(PROFILE_SPAN_INSERTION);
 		while (sy < frame_buffer_height) {
 
 			// Add this span to the span buffer.
@@ -1601,6 +1910,7 @@ render_polygon(polygon *polygon_ptr, float turn_angle)
 			} else if (!prepare_next_right_edge(sy))
 				break;
 		}
+		STOP_PROFILE(PROFILE_SPAN_INSERTION);
 
 		// Determine whether this polygon is selected.
 
@@ -1724,78 +2034,73 @@ vertex_inside_frustum(vertex *vertex_ptr)
 }
 
 //------------------------------------------------------------------------------
-// Determine if the block at the given translation is outside, inside or
-// intersecting the frustum.
+// Determine if the given bounding box is outside, inside or intersecting the
+// frustum.  The transformed corners of the bounding box are stored in the given
+// list for use by bbox_occluded().
 //------------------------------------------------------------------------------
 
 static int
-compare_block_against_frustum(block *block_ptr)
+compare_bbox_against_frustum(vertex *min_bbox_ptr, vertex *max_bbox_ptr,
+							 vertex *tbbox_list)
 {
-	COL_MESH *col_mesh_ptr;
 	float min_x, min_y, min_z, max_x, max_y, max_z;
-	vertex bbox[8], tbbox[8];
+	vertex bbox[8];
 	int corners, planes;
 	vector *normal_vector_ptr;
 	float plane_offset;
 
-	// Calculate the block's bounding box.  If the block has no collision mesh,
-	// then simply assume it's always visible.
-
-	col_mesh_ptr = block_ptr->col_mesh_ptr;
-	if (col_mesh_ptr == NULL)
-		return(INSIDE_FRUSTUM);
-	min_x = col_mesh_ptr->minBox.x + block_ptr->translation.x;
-	min_y = col_mesh_ptr->minBox.y + block_ptr->translation.y;
-	min_z = col_mesh_ptr->minBox.z + block_ptr->translation.z;
-	max_x = col_mesh_ptr->maxBox.x + block_ptr->translation.x;
-	max_y = col_mesh_ptr->maxBox.y + block_ptr->translation.y;
-	max_z = col_mesh_ptr->maxBox.z + block_ptr->translation.z;
+	min_x = min_bbox_ptr->x;
+	min_y = min_bbox_ptr->y;
+	min_z = min_bbox_ptr->z;
+	max_x = max_bbox_ptr->x;
+	max_y = max_bbox_ptr->y;
+	max_z = max_bbox_ptr->z;
 
 	// Create the corner vertices of the bounding box, and transform it.
 
 	bbox[0].x = min_x;
 	bbox[0].y = min_y;
 	bbox[0].z = min_z;
-	transform_vertex(&bbox[0], &tbbox[0]);
+	transform_vertex(&bbox[0], &tbbox_list[0]);
 
 	bbox[1].x = max_x;
 	bbox[1].y = min_y;
 	bbox[1].z = min_z;
-	transform_vertex(&bbox[1], &tbbox[1]);
+	transform_vertex(&bbox[1], &tbbox_list[1]);
 
 	bbox[2].x = min_x;
 	bbox[2].y = max_y;
 	bbox[2].z = min_z;
-	transform_vertex(&bbox[2], &tbbox[2]);
+	transform_vertex(&bbox[2], &tbbox_list[2]);
 
 	bbox[3].x = max_x;
 	bbox[3].y = max_y;
 	bbox[3].z = min_z;
-	transform_vertex(&bbox[3], &tbbox[3]);
+	transform_vertex(&bbox[3], &tbbox_list[3]);
 
 	bbox[4].x = min_x;
 	bbox[4].y = min_y;
 	bbox[4].z = max_z;
-	transform_vertex(&bbox[4], &tbbox[4]);
+	transform_vertex(&bbox[4], &tbbox_list[4]);
 
 	bbox[5].x = max_x;
 	bbox[5].y = min_y;
 	bbox[5].z = max_z;
-	transform_vertex(&bbox[5], &tbbox[5]);
+	transform_vertex(&bbox[5], &tbbox_list[5]);
 
 	bbox[6].x = min_x;
 	bbox[6].y = max_y;
 	bbox[6].z = max_z;
-	transform_vertex(&bbox[6], &tbbox[6]);
+	transform_vertex(&bbox[6], &tbbox_list[6]);
 
 	bbox[7].x = max_x;
 	bbox[7].y = max_y;
 	bbox[7].z = max_z;
-	transform_vertex(&bbox[7], &tbbox[7]);
+	transform_vertex(&bbox[7], &tbbox_list[7]);
 
 	// For each frustum plane, count the number of bounding box corners which
-	// are on the inside.  If none are, the block is outside the frustum 
-	// completely.  Otherwise the block is inside or intersects the frustum.
+	// are on the inside.  If none are, the bounding box is outside the frustum
+	// completely.  Otherwise it is inside or intersects the frustum.
  
 	planes = 0;
 	for (int plane_index = 0; plane_index < FRUSTUM_PLANES; plane_index++) {
@@ -1803,9 +2108,9 @@ compare_block_against_frustum(block *block_ptr)
 		plane_offset = frustum_plane_offset_list[plane_index];
 		corners = 0;
 		for (int vertex_index = 0; vertex_index < 8; vertex_index++)
-			if (FLE(normal_vector_ptr->dx * tbbox[vertex_index].x + 
-				normal_vector_ptr->dy * tbbox[vertex_index].y + 
-				normal_vector_ptr->dz * tbbox[vertex_index].z + plane_offset,
+			if (FLE(normal_vector_ptr->dx * tbbox_list[vertex_index].x + 
+				normal_vector_ptr->dy * tbbox_list[vertex_index].y + 
+				normal_vector_ptr->dz * tbbox_list[vertex_index].z + plane_offset,
 				0.0f))
 			corners++;
 		if (corners == 0)
@@ -1818,12 +2123,41 @@ compare_block_against_frustum(block *block_ptr)
 			planes++;
 	}
 
-	// If the block was inside of all planes, then it's inside the frustum,
-	// otherwise it intersects.
+	// If the bounding box was inside of all planes, then it's inside the
+	// frustum, otherwise it intersects.
 
 	return(planes == FRUSTUM_PLANES ? INSIDE_FRUSTUM : INTERSECTS_FRUSTUM);
 }
 
+//------------------------------------------------------------------------------
+// Determine if the given block is outside, inside or intersecting the frustum.
+//------------------------------------------------------------------------------
+
+static int
+compare_block_against_frustum(block *block_ptr)
+{
+	COL_MESH *col_mesh_ptr;
+	vertex min_bbox, max_bbox;
+
+	// Calculate the block's bounding box.  If the block has no collision mesh,
+	// then simply assume it's always visible.
+
+	col_mesh_ptr = block_ptr->col_mesh_ptr;
+	if (col_mesh_ptr == NULL)
+		return(INSIDE_FRUSTUM);
+	min_bbox.x = col_mesh_ptr->minBox.x + block_ptr->translation.x;
+	min_bbox.y = col_mesh_ptr->minBox.y + block_ptr->translation.y;
+	min_bbox.z = col_mesh_ptr->minBox.z + block_ptr->translation.z;
+	max_bbox.x = col_mesh_ptr->maxBox.x + block_ptr->translation.x;
+	max_bbox.y = col_mesh_ptr->maxBox.y + block_ptr->translation.y;
+	max_bbox.z = col_mesh_ptr->maxBox.z + block_ptr->translation.z;
+
+	// Compare the bounding box against the frustum.  The transformed corners
+	// are kept for the occlusion test in render_block().
+
+	return(compare_bbox_against_frustum(&min_bbox, &max_bbox, block_tbbox_list));
+}
+
 //------------------------------------------------------------------------------
 // Render a square as a wireframe cube.
 //------------------------------------------------------------------------------
@@ -1940,6 +2274,15 @@ render_block(square *square_ptr, block *block_ptr, bool movable)
 		OUTSIDE_FRUSTUM)
 		return;
 
+	// If not using hardware acceleration, and this is a fixed block that isn't
+	// a sprite, ignore it if its bounding box falls entirely on span buffer
+	// rows that are already fully covered.
+
+	if (!hardware_acceleration && !movable && block_ptr->col_mesh_ptr != NULL &&
+		!(block_ptr->block_def_ptr->type & SPRITE_BLOCK) &&
+		bbox_occluded(block_tbbox_list))
+		return;
+
 	// Remember the square and block pointers, and whether the block is movable.
 
 	curr_square_ptr = square_ptr;
@@ -1971,8 +2314,26 @@ render_block(square *square_ptr, block *block_ptr, bool movable)
 	if (block_ptr->set_active_lights) {
 		set_active_lights(block_ptr->active_light_list, &block_centre);
 		block_ptr->set_active_lights = false;
+		block_ptr->invalidate_lighting();
 	}
 
+	// Create the block's lit polygon list if it doesn't exist yet, and if the
+	// block has moved since it was last lit invalidate it's cached lighting.
+	// Then determine the lighting stamp the cached lighting must have to be
+	// reused.  If the lit polygon list can't be created the polygons are
+	// simply lit every frame.
+
+	if (block_ptr->lit_polygon_list == NULL && block_ptr->polygons > 0)
+		block_ptr->create_lit_polygon_list();
+	if (block_ptr->translation != block_ptr->lit_translation) {
+		block_ptr->lit_translation = block_ptr->translation;
+		block_ptr->invalidate_lighting();
+	}
+	curr_lighting_stamp = get_lighting_stamp(block_ptr->active_light_list);
+	if (block_ptr->lit_stamp > curr_lighting_stamp)
+		curr_lighting_stamp = block_ptr->lit_stamp;
+	block_polygons_lit = false;
+
 	// If the block is a sprite...
 
 	if (curr_block_type & SPRITE_BLOCK) {
@@ -2086,12 +2447,24 @@ render_block(square *square_ptr, block *block_ptr, bool movable)
 		// Transform the vertices by the block's position, then the player's
 		// position, turn angle and look angle, storing them in a global list.
 
+		START_PROFILE(PROFILE_TRANSFORM_CLIP);
 		for (int vertex_no = 0; vertex_no < curr_block_ptr->vertices; 
 			vertex_no++) {
 			temp_vertex = curr_block_ptr->vertex_list[vertex_no] +
 				curr_block_ptr->translation;
 			transform_vertex(&temp_vertex, &block_tvertex_list[vertex_no]);
 		}
+		STOP_PROFILE(PROFILE_TRANSFORM_CLIP);
+
+		// If the software renderer is caching the lighting of the block's
+		// polygons, light the ones that need it in one batch.
+
+		if (!hardware_acceleration && !rendering_block_as_bitmap &&
+			curr_block_ptr->lit_polygon_list != NULL &&
+			curr_block_ptr->polygons <= max_block_polygons) {
+			light_polygons_in_block();
+			block_polygons_lit = true;
+		}
 
 		// If the block is not movable and has a BSP tree, traverse it to 
 		// render the polygons in front-to-back order.  Otherwise render the 
@@ -2117,25 +2490,97 @@ render_block(square *square_ptr, block *block_ptr, bool movable)
 }
 
 //------------------------------------------------------------------------------
-// Render the block on the given square.
+// Return the coordinate at the given place in the implicit BSP order of the
+// coordinates between a minimum and maximum along one axis: first the camera
+// coordinate and those above it in increasing order, then those below it in
+// decreasing order.
+//------------------------------------------------------------------------------
+
+static int
+get_BSP_coordinate(int place, int camera_coord, int min_coord, int max_coord)
+{
+	int first_coord, coords_above;
+
+	first_coord = camera_coord > min_coord ? camera_coord : min_coord;
+	coords_above = max_coord - first_coord + 1;
+	if (coords_above < 0)
+		coords_above = 0;
+	if (place < coords_above)
+		return(first_coord + place);
+	first_coord = camera_coord - 1 < max_coord ? camera_coord - 1 : max_coord;
+	return(first_coord - (place - coords_above));
+}
+
+//------------------------------------------------------------------------------
+// Render the specified range of blocks in a chunk in an implicit BSP order.
 //------------------------------------------------------------------------------
 
 static void
-render_block_on_square(int column, int row, int level)
+render_blocks_in_chunk(square_chunk *chunk_ptr, int min_column, int min_row,
+					   int min_level, int max_column, int max_row,
+					   int max_level)
 {
+	int columns, rows, levels;
+	int column_no, row_no, level_no;
+	int column, row, level;
 	square *square_ptr;
-	block *block_ptr;
 
-	// Get a pointer to the square and its block.  If the location is invalid,
-	// or there is no block on the squarem, there is nothing to render.
+	// If the chunk has no blocks, there is nothing to render.
 
-	if ((square_ptr = world_ptr->get_square_ptr(column, row, level)) == NULL || (block_ptr = square_ptr->block_ptr) == NULL) {
+	if (!chunk_ptr->bounds_valid)
+		chunk_ptr->update_bounds();
+	if (chunk_ptr->blocks == 0)
 		return;
-	}
 
-	// Now render the block, which is not movable.
+	// If the chunk's bounding box is outside the frustum, ignore it.  If not
+	// using hardware acceleration, also ignore it if its bounding box falls
+	// entirely on span buffer rows that are already fully covered.
+
+	if (chunk_ptr->bounded) {
+		if (compare_bbox_against_frustum(&chunk_ptr->min_bbox,
+			&chunk_ptr->max_bbox, chunk_tbbox_list) == OUTSIDE_FRUSTUM)
+			return;
+		if (!hardware_acceleration && chunk_ptr->occludable &&
+			bbox_occluded(chunk_tbbox_list))
+			return;
+	}
 
-	render_block(square_ptr, block_ptr, false);
+	// Clip the range of squares to those in the chunk.
+
+	if (min_column < chunk_ptr->column)
+		min_column = chunk_ptr->column;
+	if (max_column > chunk_ptr->column + CHUNK_COLUMNS - 1)
+		max_column = chunk_ptr->column + CHUNK_COLUMNS - 1;
+	if (min_row < chunk_ptr->row)
+		min_row = chunk_ptr->row;
+	if (max_row > chunk_ptr->row + CHUNK_ROWS - 1)
+		max_row = chunk_ptr->row + CHUNK_ROWS - 1;
+	if (min_level < chunk_ptr->level)
+		min_level = chunk_ptr->level;
+	if (max_level > chunk_ptr->level + CHUNK_LEVELS - 1)
+		max_level = chunk_ptr->level + CHUNK_LEVELS - 1;
+	columns = max_column - min_column + 1;
+	rows = max_row - min_row + 1;
+	levels = max_level - min_level + 1;
+
+	// Render the block on each square in the range, in the same order that
+	// render_blocks_on_map() visits chunks.
+
+	for (column_no = 0; column_no < columns; column_no++) {
+		column = get_BSP_coordinate(column_no, camera_column, min_column,
+			max_column);
+		for (row_no = 0; row_no < rows; row_no++) {
+			row = get_BSP_coordinate(row_no, camera_row, min_row, max_row);
+			for (level_no = 0; level_no < levels; level_no++) {
+				level = get_BSP_coordinate(level_no, camera_level, min_level,
+					max_level);
+				square_ptr = &chunk_ptr->square_list[CHUNK_SQUARE_INDEX(column,
+					row, level)];
+				if (square_ptr->block_ptr != NULL)
+					render_block(square_ptr, square_ptr->block_ptr, false);
+			}
+		}
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -2146,43 +2591,74 @@ static void
 render_blocks_on_map(int min_column, int min_row, int min_level,
 					 int max_column, int max_row, int max_level)
 {
-	int column, row, level;
+	int camera_chunk_column, camera_chunk_row, camera_chunk_level;
+	int min_chunk_column, min_chunk_row, min_chunk_level;
+	int max_chunk_column, max_chunk_row, max_chunk_level;
+	int chunk_columns, chunk_rows, chunk_levels;
+	int column_no, row_no, level_no;
+	int chunk_column, chunk_row, chunk_level;
+	square_chunk *chunk_ptr;
 
-	// Get the map position the camera is in.
+	// Get the map position the camera is in, and the chunk that position is in.
 
 	camera_position.get_map_position(&camera_column, &camera_row, &camera_level);
-
-	// Traverse the blocks in an implicit BSP order: first the columns to the
+	camera_chunk_column = camera_column >> CHUNK_COLUMN_SHIFT;
+	camera_chunk_row = camera_row >> CHUNK_ROW_SHIFT;
+	camera_chunk_level = camera_level >> CHUNK_LEVEL_SHIFT;
+
+	// Clip the range of squares to the map, and determine the range of chunks
+	// that hold them.
+
+	if (min_column < 0)
+		min_column = 0;
+	if (max_column >= world_ptr->columns)
+		max_column = world_ptr->columns - 1;
+	if (min_row < 0)
+		min_row = 0;
+	if (max_row >= world_ptr->rows)
+		max_row = world_ptr->rows - 1;
+	if (min_level < 0)
+		min_level = 0;
+	if (max_level >= world_ptr->levels)
+		max_level = world_ptr->levels - 1;
+	if (min_column > max_column || min_row > max_row || min_level > max_level)
+		return;
+	min_chunk_column = min_column >> CHUNK_COLUMN_SHIFT;
+	min_chunk_row = min_row >> CHUNK_ROW_SHIFT;
+	min_chunk_level = min_level >> CHUNK_LEVEL_SHIFT;
+	max_chunk_column = max_column >> CHUNK_COLUMN_SHIFT;
+	max_chunk_row = max_row >> CHUNK_ROW_SHIFT;
+	max_chunk_level = max_level >> CHUNK_LEVEL_SHIFT;
+	chunk_columns = max_chunk_column - min_chunk_column + 1;
+	chunk_rows = max_chunk_row - min_chunk_row + 1;
+	chunk_levels = max_chunk_level - min_chunk_level + 1;
+
+	// Traverse the chunks in an implicit BSP order: first the columns to the
 	// right and left of the camera, then the rows to the south and north of
-	// the camera, then the levels above and below the camera.  The camera block
-	// is rendered first.
-
-	for (column = camera_column; column <= max_column; column++) {
-		for (row = camera_row; row <= max_row; row++) {
-			for (level = camera_level; level <= max_level; level++)
-				render_block_on_square(column, row, level);
-			for (level = camera_level - 1; level >= min_level; level--)
-				render_block_on_square(column, row, level);
-		}
-		for (row = camera_row - 1; row >= min_row; row--) {
-			for (level = camera_level; level <= max_level; level++)
-				render_block_on_square(column, row, level);
-			for (level = camera_level - 1; level >= min_level; level--)
-				render_block_on_square(column, row, level);
-		}
-	}
-	for (column = camera_column - 1; column >= min_column; column--) {
-		for (row = camera_row; row <= max_row; row++) {
-			for (level = camera_level; level <= max_level; level++)
-				render_block_on_square(column, row, level);
-			for (level = camera_level - 1; level >= min_level; level--)
-				render_block_on_square(column, row, level);
-		}
-		for (row = camera_row - 1; row >= min_row; row--) {
-			for (level = camera_level; level <= max_level; level++)
-				render_block_on_square(column, row, level);
-			for (level = camera_level - 1; level >= min_level; level--)
-				render_block_on_square(column, row, level);
+	// the camera, then the levels above and below the camera, starting with the
+	// chunk the camera is in.  The squares within each chunk are traversed in
+	// the same order.  A square can only be hidden by squares that are no
+	// further from the camera along every axis, on the same side of it, and
+	// those are always rendered first.  Chunks that have never been written to,
+	// hold no blocks, or are outside the frustum are skipped without visiting
+	// their squares.
+
+	for (column_no = 0; column_no < chunk_columns; column_no++) {
+		chunk_column = get_BSP_coordinate(column_no, camera_chunk_column,
+			min_chunk_column, max_chunk_column);
+		for (row_no = 0; row_no < chunk_rows; row_no++) {
+			chunk_row = get_BSP_coordinate(row_no, camera_chunk_row,
+				min_chunk_row, max_chunk_row);
+			for (level_no = 0; level_no < chunk_levels; level_no++) {
+				chunk_level = get_BSP_coordinate(level_no, camera_chunk_level,
+					min_chunk_level, max_chunk_level);
+				chunk_ptr = world_ptr->chunk_map[(chunk_level *
+					world_ptr->chunk_rows + chunk_row) *
+					world_ptr->chunk_columns + chunk_column];
+				if (chunk_ptr != NULL)
+					render_blocks_in_chunk(chunk_ptr, min_column, min_row,
+						min_level, max_column, max_row, max_level);
+			}
 		}
 	}
 }
@@ -2211,6 +2687,7 @@ render_player_block(void)
 	if (player_block_ptr->set_active_lights) {
 		set_active_lights(player_block_ptr->active_light_list, &player_viewpoint.position);
 		player_block_ptr->set_active_lights = false;
+		player_block_ptr->invalidate_lighting();
 	}
 	
 	// Render the player block.
@@ -2760,17 +3237,33 @@ render_textured_polygons(texture *texture_ptr)
 	for (int pixmap_no = 0; pixmap_no < texture_ptr->pixmaps; pixmap_no++) {
 		pixmap *pixmap_ptr = &texture_ptr->pixmap_list[pixmap_no];
 
-		// Render all the transformed polygons in the pixmap via hardware, removing them from the pixmap as we go.
+		// Render all the transformed polygons in the pixmap via hardware, then
+		// empty the list; the polygons themselves are reclaimed when the frame
+		// arena is reset.
 
 		tpolygon *tpolygon_ptr = pixmap_ptr->tpolygon_list;
 		while (tpolygon_ptr != NULL) {
 			hardware_render_polygon(tpolygon_ptr);
-			tpolygon_ptr = del_tpolygon(tpolygon_ptr);
+			tpolygon_ptr = tpolygon_ptr->next_tpolygon_ptr;
 		}
 		pixmap_ptr->tpolygon_list = NULL;
 	}
 }
 
+//------------------------------------------------------------------------------
+// Look up the cache entry for a textured span.  This must be done on the player
+// thread, since it may modify the image cache and the lit images in it; the
+// span is then rendered with the cache entry it holds, which is NULL if there
+// was no memory for one.
+//------------------------------------------------------------------------------
+
+static void
+set_span_cache_entry(span *span_ptr)
+{
+	span_ptr->cache_entry_ptr = get_cache_entry(span_ptr->pixmap_ptr,
+		span_ptr->brightness_index);
+}
+
 //------------------------------------------------------------------------------
 // Render the spans that use the given texture to the frame buffer.
 //------------------------------------------------------------------------------
@@ -2797,9 +3290,11 @@ render_textured_spans(texture *texture_ptr)
 			while (span_ptr != NULL) {
 				if (span_ptr->is_popup)
 					render_popup_span(span_ptr);
-				else
+				else {
+					set_span_cache_entry(span_ptr);
 					render_transparent_span(span_ptr);
-				span_ptr = del_span(span_ptr);
+				}
+				span_ptr = span_ptr->next_span_ptr;
 			}
 			pixmap_ptr->span_lists[index] = NULL;
 		}
@@ -2892,13 +3387,13 @@ static void
 render_colour_polygons_or_spans(void)
 {
 	// If using hardware acceleration, render the transformed polygons in the solid colour transformed polygon list via hardware,
-	// removing them from the list in the process.
+	// then empty the list.
 
 	if (hardware_acceleration) {
 		tpolygon *tpolygon_ptr = colour_tpolygon_list;
 		while (tpolygon_ptr != NULL) {
 			hardware_render_polygon(tpolygon_ptr);
-			tpolygon_ptr = del_tpolygon(tpolygon_ptr);
+			tpolygon_ptr = tpolygon_ptr->next_tpolygon_ptr;
 		}
 		colour_tpolygon_list = NULL;
 	}
@@ -2909,7 +3404,7 @@ render_colour_polygons_or_spans(void)
 		span *span_ptr = colour_span_list;
 		while (span_ptr != NULL) {
 			render_colour_span(span_ptr);
-			span_ptr = del_span(span_ptr);
+			span_ptr = span_ptr->next_span_ptr;
 		}
 	}
 }
@@ -2926,19 +3421,19 @@ render_transparent_polygons_or_spans(void)
 	span *span_ptr;
 
 	// If using hardware acceleration, render the transformed polygons in the transparent transformed polygon list in back to front order,
-	// via hardware, removing them from the list in the process.
+	// via hardware, then empty the list.
 
 	if (hardware_acceleration) {
 		tpolygon *tpolygon_ptr = transparent_tpolygon_list;
 		while (tpolygon_ptr != NULL) {
 			hardware_render_polygon(tpolygon_ptr);
-			tpolygon_ptr = del_tpolygon(tpolygon_ptr);
+			tpolygon_ptr = tpolygon_ptr->next_tpolygon_ptr;
 		}
 		transparent_tpolygon_list = NULL;
 	}
 
 	// If not using hardware acceleration, render the transparent spans from
-	// each span buffer row in back to front order, removing them as we go.
+	// each span buffer row in back to front order.
 	// Spans that have a texture of unlimited size are only used by popups, and
 	// are rendered as linear texture-mapped spans.
 
@@ -2949,14 +3444,185 @@ render_transparent_polygons_or_spans(void)
 			while (span_ptr != NULL) {
 				if (span_ptr->is_popup)
 					render_popup_span(span_ptr);
-				else
+				else {
+					set_span_cache_entry(span_ptr);
 					render_transparent_span(span_ptr);
-				span_ptr = del_span(span_ptr);
+				}
+				span_ptr = span_ptr->next_span_ptr;
 			}
 		}
 	}
 }
 
+//------------------------------------------------------------------------------
+// Render the opaque spans in a span buffer row, followed by the transparent
+// spans in back to front order.  The spans are left in the row.
+//------------------------------------------------------------------------------
+
+static void
+render_spans_in_row(int row)
+{
+	span_row *span_row_ptr;
+	span *span_ptr;
+
+	span_row_ptr = (*span_buffer_ptr)[row];
+	span_ptr = span_row_ptr->opaque_span_list;
+	while (span_ptr != NULL) {
+		if (span_ptr->pixmap_ptr == NULL)
+			render_colour_span(span_ptr);
+		else if (span_ptr->is_popup)
+			render_popup_span(span_ptr);
+		else
+			render_transparent_span(span_ptr);
+		span_ptr = span_ptr->next_span_ptr;
+	}
+	span_ptr = span_row_ptr->transparent_span_list;
+	while (span_ptr != NULL) {
+		if (span_ptr->is_popup)
+			render_popup_span(span_ptr);
+		else
+			render_transparent_span(span_ptr);
+		span_ptr = span_ptr->next_span_ptr;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Render the spans in every band of rows assigned to the given render thread.
+// Bands are dealt out to the render threads in turn, so each thread always
+// renders the same rows and the result does not depend on thread timing.
+//------------------------------------------------------------------------------
+
+static void
+render_spans_in_bands(int thread_no)
+{
+	int band_start_row, band_end_row;
+	int row;
+
+	for (band_start_row = thread_no * ROWS_PER_BAND; band_start_row < render_rows;
+		band_start_row += render_threads * ROWS_PER_BAND) {
+		band_end_row = MIN(band_start_row + ROWS_PER_BAND, render_rows);
+		for (row = band_start_row; row < band_end_row; row++)
+			render_spans_in_row(row);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Render thread.  Each time the start event is sent with a value of TRUE, the
+// thread renders its bands and sends the done event; a value of FALSE causes
+// the thread to exit.
+//------------------------------------------------------------------------------
+
+static void
+render_thread(void *arg_list)
+{
+	int thread_no = *(int *)arg_list;
+
+	while (render_start_event_list[thread_no].wait_for_event()) {
+		render_spans_in_bands(thread_no);
+		render_done_event_list[thread_no].send_event(true);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Start the render threads.  The number of threads is taken from the
+// configuration, with zero meaning one thread per processor.
+//------------------------------------------------------------------------------
+
+void
+start_render_threads(void)
+{
+	int thread_no;
+
+	// Determine the number of render threads, which includes the player
+	// thread.
+
+	render_threads = render_thread_count.get();
+	if (render_threads <= 0)
+		render_threads = get_processor_count();
+	render_threads = MAX(MIN(render_threads, MAX_RENDER_THREADS), 1);
+
+	// Create the events and start each render thread other than the player
+	// thread.  If a thread fails to start, carry on with the threads that
+	// did.
+
+	for (thread_no = 1; thread_no < render_threads; thread_no++) {
+		render_thread_no_list[thread_no] = thread_no;
+		render_start_event_list[thread_no].create_event();
+		render_done_event_list[thread_no].create_event();
+		if ((render_thread_handle_list[thread_no] = start_thread(render_thread,
+			&render_thread_no_list[thread_no])) == 0) {
+			render_start_event_list[thread_no].destroy_event();
+			render_done_event_list[thread_no].destroy_event();
+			diagnose("Failed to start render thread %d", thread_no);
+			render_threads = thread_no;
+			break;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Stop the render threads.
+//------------------------------------------------------------------------------
+
+void
+stop_render_threads(void)
+{
+	int thread_no;
+
+	for (thread_no = 1; thread_no < render_threads; thread_no++) {
+		render_start_event_list[thread_no].send_event(false);
+		wait_for_thread_termination(render_thread_handle_list[thread_no]);
+		render_start_event_list[thread_no].destroy_event();
+		render_done_event_list[thread_no].destroy_event();
+	}
+	render_threads = 1;
+}
+
+//------------------------------------------------------------------------------
+// Render all spans in the span buffer using the render threads.  The spans are
+// left in the span buffer until it is next cleared.
+//------------------------------------------------------------------------------
+
+static void
+render_spans_in_parallel(void)
+{
+	int row;
+	span_row *span_row_ptr;
+	span *span_ptr;
+	int thread_no;
+
+	// Look up the cache entry of every textured span before the render threads
+	// start, since the image cache and the lit images in it may only be
+	// modified by the player thread.  The render threads only read the cache
+	// entries held by the spans.
+
+	render_rows = (int)frame_buffer_height;
+	for (row = 0; row < render_rows; row++) {
+		span_row_ptr = (*span_buffer_ptr)[row];
+		span_ptr = span_row_ptr->opaque_span_list;
+		while (span_ptr != NULL) {
+			if (span_ptr->pixmap_ptr != NULL && !span_ptr->is_popup)
+				set_span_cache_entry(span_ptr);
+			span_ptr = span_ptr->next_span_ptr;
+		}
+		span_ptr = span_row_ptr->transparent_span_list;
+		while (span_ptr != NULL) {
+			if (!span_ptr->is_popup)
+				set_span_cache_entry(span_ptr);
+			span_ptr = span_ptr->next_span_ptr;
+		}
+	}
+
+	// Start the render threads, render the player thread's share of the
+	// bands, then wait for the render threads to finish.
+
+	for (thread_no = 1; thread_no < render_threads; thread_no++)
+		render_start_event_list[thread_no].send_event(true);
+	render_spans_in_bands(0);
+	for (thread_no = 1; thread_no < render_threads; thread_no++)
+		render_done_event_list[thread_no].wait_for_event();
+}
+
 //------------------------------------------------------------------------------
 // Make all popups in the list with rollover triggers visible.
 //------------------------------------------------------------------------------
@@ -3077,8 +3743,10 @@ render_frame(void)
 	else
 		lock_frame_buffer();
 
-	// Reset the span and transformed polygon lists.
+	// Reclaim the spans, transformed vertices and transformed polygons from
+	// the last frame, then reset the span and transformed polygon lists.
 
+	reset_frame_arena();
 	colour_span_list = NULL;
 	transparent_tpolygon_list = NULL;
 	colour_tpolygon_list = NULL;
@@ -3227,8 +3895,10 @@ render_frame(void)
 
 	// Render the blocks on the map that insect with the view frustum.
 
+	START_PROFILE(PROFILE_RENDER_MAP);
 	compute_view_bounding_box();
 	render_map();
+	STOP_PROFILE(PROFILE_RENDER_MAP);
 
 	// If not using hardware acceleration...
 
@@ -3282,30 +3952,52 @@ render_frame(void)
 
 	// Render all movable blocks.
 	
+	START_PROFILE(PROFILE_RENDER_MAP);
 	render_movable_blocks();
 
 	// If there is a player block, render it last.
 
 	if (player_block_ptr != NULL)
 		render_player_block();
+	STOP_PROFILE(PROFILE_RENDER_MAP);
 
-	// If not using hardware acceleration, add spans to their associated
-	// pixmaps.
+	// If not using hardware acceleration and there are multiple render
+	// threads, render the span buffer one band of rows per thread.
 
-	if (!hardware_acceleration) {
-		add_spans_to_pixmaps();
+	if (!hardware_acceleration && render_threads > 1) {
+		START_PROFILE(PROFILE_PARALLEL_SPANS);
+		render_spans_in_parallel();
+		STOP_PROFILE(PROFILE_PARALLEL_SPANS);
 	}
 
-	// Step through each pixmap in each texture, rendering any polygons/spans
-	// listed in these pixmaps.
+	// Otherwise...
 
-	render_textured_polygons_or_spans();
+	else {
 
-	// Render the colour polygons/spans, followed by the transparent 
-	// polygons/spans.
+		// If not using hardware acceleration, add spans to their associated
+		// pixmaps.
 
-	render_colour_polygons_or_spans();
-	render_transparent_polygons_or_spans();
+		START_PROFILE(PROFILE_TEXTURED_SPANS);
+		if (!hardware_acceleration) {
+			add_spans_to_pixmaps();
+		}
+
+		// Step through each pixmap in each texture, rendering any polygons/spans
+		// listed in these pixmaps.
+
+		render_textured_polygons_or_spans();
+		STOP_PROFILE(PROFILE_TEXTURED_SPANS);
+
+		// Render the colour polygons/spans, followed by the transparent 
+		// polygons/spans.
+
+		START_PROFILE(PROFILE_COLOUR_SPANS);
+		render_colour_polygons_or_spans();
+		STOP_PROFILE(PROFILE_COLOUR_SPANS);
+		START_PROFILE(PROFILE_TRANSPARENT_SPANS);
+		render_transparent_polygons_or_spans();
+		STOP_PROFILE(PROFILE_TRANSPARENT_SPANS);
+	}
 
 	// If build mode is active, render the builder square as a wireframe cube.
 
@@ -3414,8 +4106,10 @@ render_block_as_bitmap(block *block_ptr)
 		lock_frame_buffer();
 	}
 
-	// Reset the span and transformed polygon lists.
+	// Reclaim the spans, transformed vertices and transformed polygons from
+	// the last frame, then reset the span and transformed polygon lists.
 
+	reset_frame_arena();
 	if (hardware_acceleration) {
 		transparent_tpolygon_list = NULL;
 		colour_tpolygon_list = NULL;
@@ -14,6 +14,12 @@ set_up_renderer(void);
 void 
 clean_up_renderer(void);
 
+void
+start_render_threads(void);
+
+void
+stop_render_threads(void);
+
 void
 translate_vertex(vertex *old_vertex_ptr, vertex *new_vertex_ptr);
 
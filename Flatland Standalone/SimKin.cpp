@@ -3,14 +3,17 @@
 // This code is licensed under the MIT license (see LICENCE file for details).
 //******************************************************************************
 
-#include "simkin\skInterpreter.h"
-#include "simkin\skStatementStepper.h"
-#include "simkin\skElementExecutable.h"
-#include "simkin\skParseNode.h"
-#include "simkin\skRValueArray.h"
-#include "simkin\skParseException.h"
-#include "simkin\skRuntimeException.h"
-#include "Simkin\skInputSource.h"
+#include "Simkin/skInterpreter.h"
+#include "Simkin/skStatementStepper.h"
+#include "Simkin/skElementExecutable.h"
+#include "Simkin/skParseNode.h"
+#include "Simkin/skMethodTable.h"
+#include "Simkin/skStringList.h"
+#include "Simkin/skRValueArray.h"
+#include "Simkin/skParseException.h"
+#include "Simkin/skRuntimeException.h"
+#include "Simkin/skInputSource.h"
+#include <atomic>
 #include <time.h>
 #include <math.h>
 #include <stdio.h>
@@ -24,11 +27,19 @@
 #include "SimKin.h"
 #include "Utils.h"
 
-// The SimKin interpreter and context object.
+// The SimKin interpreter, and the context used when loading scripts into
+// SimKin objects (this belongs to the first script thread).
 
 static skInterpreter *simkin_interpreter_ptr;
 static skExecutableContext *simkin_context_ptr;
 
+// The shared parse trees of the scripts parsed so far.  These are kept while
+// no interpreter exists, so that a spot that is reloaded, or another spot
+// with the same scripts, doesn't parse them again.  They are only deleted by
+// clean_up_simkin().
+
+static skMethodTable *shared_script_table_ptr;
+
 // Macro to create a SimKin object, and add it to the global variable list.
 
 #define NEW_SIMKIN_OBJECT(simkin_object_ptr, simkin_object, name) \
@@ -39,19 +50,44 @@ static skExecutableContext *simkin_context_ptr;
 	simkin_interpreter_ptr->addGlobalVariable(name, simkin_variable); \
 }
 
-// Flag indicating if SimKin is running.
+// Interval between checks of the clock that the number of statements executed
+// per check is calibrated to.
+
+#define SCRIPT_CHECK_INTERVAL_MS	1
+
+// Number of statements executed between checks of the clock, and the maximum
+// this can be calibrated to.  The maximum bounds how far a script can overrun
+// its time slice when its statements suddenly become slower.
+
+#define MAX_STATEMENTS_PER_CHECK	1024
+
+static int statements_per_check;
 
-static bool running;
+// Name of the file that compiled scripts are cached in, the signature and
+// version at the start of it, and the maximum number of scripts it may hold.
+// The version must be changed whenever the format of the file changes.  Only
+// the byte code representation of a script can be cached, so the cache is not
+// used if SimKin is built to execute parse trees directly.
 
-// Simkin thread handle and events.
+#ifndef EXECUTE_PARSENODES
 
-static unsigned long simkin_thread_handle;
-static event simkin_thread_initialised;
-static event perform_command;
-static event command_completed;
-static int script_start_time_ms, script_resume_time_ms;
+#define SCRIPT_CACHE_FILE_NAME	"scripts.cache"
+#define SCRIPT_CACHE_SIGNATURE	"FLATLAND SCRIPT CACHE"
+#define SCRIPT_CACHE_VERSION	1
+#define MAX_CACHED_SCRIPTS		4096
 
-// Command code, script or method name (if required), and block that owns it.
+// Compiled scripts loaded from the cache are given this line number, so that
+// they can be told apart from scripts parsed during this session.
+
+#define CACHED_SCRIPT_LINE_NO	-1
+
+// Number of scripts loaded from the cache.
+
+static int cached_scripts;
+
+#endif
+
+// Command codes.
 
 #define EXECUTE_SCRIPT		0
 #define CALL_GLOBAL_METHOD	1
@@ -59,10 +95,245 @@ static int script_start_time_ms, script_resume_time_ms;
 #define TERMINATE_SCRIPT	3
 #define TERMINATE_SIMKIN	4
 
-static int command_code;
-static skString simkin_method_name;
-static script_def *simkin_script_def_ptr;
-static block *simkin_block_ptr;
+// A script thread executes one script at a time on its own stack, so that the
+// script can be paused part way through and resumed later while scripts on the
+// other script threads make progress.  Only one script thread runs at once: the
+// player thread sends it a command, then waits until the script completes or
+// is paused.  The termination requested flag is set by the player thread just
+// before it sends a TERMINATE_SCRIPT or TERMINATE_SIMKIN command, so that a
+// running script can check for it without polling the perform command event.
+
+struct script_thread {
+	unsigned long thread_handle;	// Thread handle.
+	event perform_command;			// Event sent by the player thread.
+	event command_completed;		// Event sent when a command completes.
+	std::atomic<bool> termination_requested;
+	int command_code;				// Command code.
+	skString method_name;			// Method name (if required).
+	script_def *script_def_ptr;		// Script to execute (if required).
+	block *block_ptr;				// Block that owns the script.
+	skExecutableContext *context_ptr;	// Context with this thread's stack.
+	bool running;					// TRUE if the thread is running.
+	int time_slice_ms;				// Time slice for the script.
+	int resume_time_ms;				// Time the script was last resumed.
+	int check_time_ms;				// Time of the last check of the clock.
+};
+
+// The script threads, the event used to signal that a script thread has
+// initialised, and the script thread that the current thread is running.
+
+static script_thread script_thread_list[SCRIPT_THREADS];
+static event script_thread_initialised;
+static thread_local script_thread *curr_script_thread_ptr;
+
+// Symbols for the field, attribute and method names recognised by the SimKin
+// objects.  These are registered with SimKin before any script is parsed, so
+// that each identifier is looked up once and the objects can dispatch on an
+// integer rather than comparing strings.  A symbol of zero means the name is
+// not one of these.
+
+enum simkin_symbol {
+	NO_SYMBOL,
+	ABS_SYMBOL,
+	ACOS_SYMBOL,
+	ANGLE_X_SYMBOL,
+	ANGLE_Y_SYMBOL,
+	APPEND_SYMBOL,
+	ASIN_SYMBOL,
+	ATAN_SYMBOL,
+	BBOX_SYMBOL,
+	BLUE_SYMBOL,
+	BRIGHTNESS_SYMBOL,
+	CAMERA_SYMBOL,
+	COLOR_SYMBOL,
+	COLOUR_SYMBOL,
+	COLUMN_SYMBOL,
+	COLUMNS_SYMBOL,
+	COS_SYMBOL,
+	DEG_SYMBOL,
+	DELAY_SYMBOL,
+	DELETE_SYMBOL,
+	DENSITY_SYMBOL,
+	DIMENSIONS_SYMBOL,
+	ELEMENTS_SYMBOL,
+	ENDRADIUS_SYMBOL,
+	FILE_SYMBOL,
+	FREE_ARRAY_SYMBOL,
+	GET_BLOCK_SYMBOL,
+	GET_BLOCKS_SYMBOL,
+	GET_VERTICES_SYMBOL,
+	GREEN_SYMBOL,
+	HOUR_SYMBOL,
+	HREF_SYMBOL,
+	INSERT_SYMBOL,
+	LEVEL_SYMBOL,
+	LEVELS_SYMBOL,
+	LOCATION_SYMBOL,
+	LOG_SYMBOL,
+	LOOK_ANGLE_SYMBOL,
+	MAX_X_SYMBOL,
+	MAX_Y_SYMBOL,
+	MAX_Z_SYMBOL,
+	MILLISECOND_SYMBOL,
+	MIN_X_SYMBOL,
+	MIN_Y_SYMBOL,
+	MIN_Z_SYMBOL,
+	MINIMUM_SYMBOL,
+	MINUTE_SYMBOL,
+	MOVABLE_SYMBOL,
+	MOVE_BLOCK_SYMBOL,
+	NAME_SYMBOL,
+	NEW_ARRAY_SYMBOL,
+	ORIENT_SYMBOL,
+	ORIENTATION_SYMBOL,
+	ORIGIN_SYMBOL,
+	PI_SYMBOL,
+	PLAYBACK_SYMBOL,
+	POSITION_SYMBOL,
+	PREPEND_SYMBOL,
+	RAD_SYMBOL,
+	RANDOM_SYMBOL,
+	RANGE_SYMBOL,
+	RED_SYMBOL,
+	RESET_VERTICES_SYMBOL,
+	ROTATE_X_SYMBOL,
+	ROTATE_Y_SYMBOL,
+	ROTATE_Z_SYMBOL,
+	ROW_SYMBOL,
+	ROWS_SYMBOL,
+	SECOND_SYMBOL,
+	SET_SYMBOL,
+	SET_BLOCK_SYMBOL,
+	SET_MANY_SYMBOL,
+	SET_VERTICES_SYMBOL,
+	SETFRAME_SYMBOL,
+	SETLOOP_SYMBOL,
+	SIN_SYMBOL,
+	SIZE_SYMBOL,
+	SQRT_SYMBOL,
+	STARTRADIUS_SYMBOL,
+	STYLE_SYMBOL,
+	SYMBOL_SYMBOL,
+	TAN_SYMBOL,
+	TARGET_SYMBOL,
+	TEXT_SYMBOL,
+	TEXTURE_SYMBOL,
+	TIME_SYMBOL,
+	TITLE_SYMBOL,
+	TURN_ANGLE_SYMBOL,
+	USER_CAN_LOOK_SYMBOL,
+	USER_CAN_MOVE_SYMBOL,
+	VERSION_SYMBOL,
+	VERTEX_SYMBOL,
+	VERTICES_SYMBOL,
+	VOLUME_SYMBOL,
+	X_SYMBOL,
+	Y_SYMBOL,
+	Z_SYMBOL,
+	SIMKIN_SYMBOLS
+};
+
+// Names of the symbols, in the same order as above.
+
+static const char *simkin_symbol_name_list[SIMKIN_SYMBOLS] = {
+	NULL,
+	"abs",
+	"acos",
+	"angle_x",
+	"angle_y",
+	"append",
+	"asin",
+	"atan",
+	"bbox",
+	"blue",
+	"brightness",
+	"camera",
+	"color",
+	"colour",
+	"column",
+	"columns",
+	"cos",
+	"deg",
+	"delay",
+	"delete",
+	"density",
+	"dimensions",
+	"elements",
+	"endradius",
+	"file",
+	"free_array",
+	"get_block",
+	"get_blocks",
+	"get_vertices",
+	"green",
+	"hour",
+	"href",
+	"insert",
+	"level",
+	"levels",
+	"location",
+	"log",
+	"look_angle",
+	"max_x",
+	"max_y",
+	"max_z",
+	"millisecond",
+	"min_x",
+	"min_y",
+	"min_z",
+	"minimum",
+	"minute",
+	"movable",
+	"move_block",
+	"name",
+	"new_array",
+	"orient",
+	"orientation",
+	"origin",
+	"pi",
+	"playback",
+	"position",
+	"prepend",
+	"rad",
+	"random",
+	"range",
+	"red",
+	"reset_vertices",
+	"rotate_x",
+	"rotate_y",
+	"rotate_z",
+	"row",
+	"rows",
+	"second",
+	"set",
+	"set_block",
+	"set_many",
+	"set_vertices",
+	"setframe",
+	"setloop",
+	"sin",
+	"size",
+	"sqrt",
+	"startradius",
+	"style",
+	"symbol",
+	"tan",
+	"target",
+	"text",
+	"texture",
+	"time",
+	"title",
+	"turn_angle",
+	"user_can_look",
+	"user_can_move",
+	"version",
+	"vertex",
+	"vertices",
+	"volume",
+	"x",
+	"y",
+	"z"
+};
 
 // Script definition list.
 
@@ -126,6 +397,7 @@ public:
 bool 
 vertex_simkin_object::getValueAt(const skRValue& array_index, const skString& attribute, skRValue& value)
 {
+	int attribute_symbol = attribute.symbol();
 	int vertex_index;
 	vertex *vertex_ptr;
 
@@ -138,6 +410,12 @@ vertex_simkin_object::getValueAt(const skRValue& array_index, const skString& at
 		return(false);
 	}
 
+	// If this vertex list belongs to a block, use the block's current vertex
+	// list, since it may have been given its own copy of the geometry.
+
+	if (block_ptr != NULL)
+		vertex_list = block_ptr->vertex_list;
+
 	// Verify the vertex index is within range, then get a pointer to the vertex
 	// in the vertex list.
 
@@ -149,11 +427,11 @@ vertex_simkin_object::getValueAt(const skRValue& array_index, const skString& at
 	// If the attribute is "x", "y", or "z",  return the approapiate coordinate
 	// of the vertex in texel units, without the block translation.
 
-	if (attribute == "x")
+	if (attribute_symbol == X_SYMBOL)
 		value = vertex_ptr->x * texels_per_unit;
-	else if (attribute == "y")
+	else if (attribute_symbol == Y_SYMBOL)
 		value = vertex_ptr->y * texels_per_unit;
-	else if (attribute == "z")
+	else if (attribute_symbol == Z_SYMBOL)
 		value = vertex_ptr->z * texels_per_unit;
 	else
 		return(false);
@@ -168,6 +446,7 @@ vertex_simkin_object::getValueAt(const skRValue& array_index, const skString& at
 bool 
 vertex_simkin_object::setValueAt(const skRValue& array_index, const skString& attribute, const skRValue& value)
 {
+	int attribute_symbol = attribute.symbol();
 	block_def *block_def_ptr;
 	int vertex_index;
 	vertex *vertex_ptr;
@@ -183,12 +462,16 @@ vertex_simkin_object::setValueAt(const skRValue& array_index, const skString& at
 	}
 
 	// If this vertex list belongs to a block, and it is not movable, do 
-	// nothing.
+	// nothing.  Otherwise make sure the block has its own geometry before
+	// changing it.
 
 	if (block_ptr != NULL) {
 		block_def_ptr = block_ptr->block_def_ptr;
 		if (!block_def_ptr->movable)
 			return(true);
+		if (!block_ptr->unshare_geometry())
+			return(false);
+		vertex_list = block_ptr->vertex_list;
 	}
 
 	// Verify the vertex index is within range, then get a pointer to the vertex
@@ -203,11 +486,11 @@ vertex_simkin_object::setValueAt(const skRValue& array_index, const skString& at
 	// the vertex from texel units, with the block translation included.
 
 	vertex_coord = value.floatValue() / texels_per_unit;
-	if (attribute == "x")
+	if (attribute_symbol == X_SYMBOL)
 		vertex_ptr->x = vertex_coord;
-	else if (attribute == "y")
+	else if (attribute_symbol == Y_SYMBOL)
 		vertex_ptr->y = vertex_coord;
-	else if (attribute == "z")
+	else if (attribute_symbol == Z_SYMBOL)
 		vertex_ptr->z = vertex_coord;
 	else
 		return(false);
@@ -227,6 +510,7 @@ vertex_simkin_object::setValueAt(const skRValue& array_index, const skString& at
 bool 
 vertex_simkin_object::method(const skString& method, skRValueArray& arguments, skRValue& returnValue, skExecutableContext& ctxt)
 {
+	int method_symbol = method.symbol();
 	block_def *block_def_ptr;
 	int vertices_to_change, vertex_index, vertex_no;
 	vertex *vertex_ptr;
@@ -241,17 +525,21 @@ vertex_simkin_object::method(const skString& method, skRValueArray& arguments, s
 	}
 
 	// If this vertex list belongs to a block, and it is not movable, do 
-	// nothing.
+	// nothing.  Otherwise make sure the block has its own geometry before
+	// changing it.
 
 	if (block_ptr != NULL) {
 		block_def_ptr = block_ptr->block_def_ptr;
 		if (!block_def_ptr->movable)
 			return(true);
+		if (!block_ptr->unshare_geometry())
+			return(false);
+		vertex_list = block_ptr->vertex_list;
 	}
 
 	// If the method is "set", update all coordinates of a vertex at once...
 
-	if (method == "set") {
+	if (method_symbol == SET_SYMBOL) {
 		if (arguments.entries() != 4)
 			return(false);
 		vertex_index = arguments[0].intValue();
@@ -271,7 +559,7 @@ vertex_simkin_object::method(const skString& method, skRValueArray& arguments, s
 	// If the method is "set_many", update the coordinates of more than one
 	// vertex at once...
 
-	else if (method == "set_many") {
+	else if (method_symbol == SET_MANY_SYMBOL) {
 		if ((arguments.entries() - 1) % 4 != 0)
 			return(false);
 		vertices_to_change = arguments[0].intValue();
@@ -397,6 +685,9 @@ static bool
 get_block_value(block *block_ptr, const skString& field, 
 				const skString& attribute, skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
+
 	// If the block pointer is NULL, this this block has been removed from
 	// the map and can no longer be accessed.
 
@@ -412,7 +703,7 @@ get_block_value(block *block_ptr, const skString& field,
 
 	block_def *block_def_ptr = block_ptr->block_def_ptr;
 	COL_MESH *col_mesh_ptr = block_ptr->col_mesh_ptr;
-	if (field == "location") {
+	if (field_symbol == LOCATION_SYMBOL) {
 		int column, row, level;
 
 		// Determine the map position from the translation.
@@ -423,17 +714,17 @@ get_block_value(block *block_ptr, const skString& field,
 
 		// Now return the desired value.
 
-		if (attribute == "column")
+		if (attribute_symbol == COLUMN_SYMBOL)
 			value = column + 1;
-		else if (attribute == "row")
+		else if (attribute_symbol == ROW_SYMBOL)
 			value = row + 1;
-		else if (attribute == "level")
+		else if (attribute_symbol == LEVEL_SYMBOL)
 			value = level + 1;
-		else if (attribute == "x")
+		else if (attribute_symbol == X_SYMBOL)
 			value = block_ptr->translation.x * texels_per_unit;
-		else if (attribute == "y")
+		else if (attribute_symbol == Y_SYMBOL)
 			value = block_ptr->translation.y * texels_per_unit;
-		else if (attribute == "z")
+		else if (attribute_symbol == Z_SYMBOL)
 			value = block_ptr->translation.z * texels_per_unit;
 		else
 			return(false);
@@ -443,12 +734,12 @@ get_block_value(block *block_ptr, const skString& field,
 	// the approapiate coordinate of the block's origin.  Note that this field
 	// is not available for sprites.
 
-	else if (field == "origin" && block_def_ptr->type == STRUCTURAL_BLOCK) {
-		if (attribute == "x")
+	else if (field_symbol == ORIGIN_SYMBOL && block_def_ptr->type == STRUCTURAL_BLOCK) {
+		if (attribute_symbol == X_SYMBOL)
 			value = block_ptr->block_origin.x * texels_per_unit;
-		else if (attribute == "y")
+		else if (attribute_symbol == Y_SYMBOL)
 			value = block_ptr->block_origin.y * texels_per_unit;
-		else if (attribute == "z")
+		else if (attribute_symbol == Z_SYMBOL)
 			value = block_ptr->block_origin.z * texels_per_unit;
 		else
 			return(false);
@@ -458,18 +749,18 @@ get_block_value(block *block_ptr, const skString& field,
 	// "max_x", "max_y", "max_z", return the aproapiate coordinate of the
 	// block's bounding box.
 
-	else if (field == "bbox" && col_mesh_ptr != NULL) {
-		if (attribute == "min_x")
+	else if (field_symbol == BBOX_SYMBOL && col_mesh_ptr != NULL) {
+		if (attribute_symbol == MIN_X_SYMBOL)
 			value = col_mesh_ptr->minBox.x * texels_per_unit;
-		else if (attribute == "min_y")
+		else if (attribute_symbol == MIN_Y_SYMBOL)
 			value = col_mesh_ptr->minBox.y * texels_per_unit;
-		else if (attribute == "min_z")
+		else if (attribute_symbol == MIN_Z_SYMBOL)
 			value = col_mesh_ptr->minBox.z * texels_per_unit;
-		else if (attribute == "max_x")
+		else if (attribute_symbol == MAX_X_SYMBOL)
 			value = col_mesh_ptr->maxBox.x * texels_per_unit;
-		else if (attribute == "max_y")
+		else if (attribute_symbol == MAX_Y_SYMBOL)
 			value = col_mesh_ptr->maxBox.y * texels_per_unit;
-		else if (attribute == "max_z")
+		else if (attribute_symbol == MAX_Z_SYMBOL)
 			value = col_mesh_ptr->maxBox.z * texels_per_unit;
 		else
 			return(false);
@@ -477,31 +768,31 @@ get_block_value(block *block_ptr, const skString& field,
 
 	// If the field is "vertices", return the number of vertices in the block.
 
-	else if (field == "vertices")
+	else if (field_symbol == VERTICES_SYMBOL)
 		value = block_ptr->vertices;
 
 	// If the field is "vertex", return the vertex SimKin object, if it exists.
 
-	else if (field == "vertex")
+	else if (field_symbol == VERTEX_SYMBOL)
 		value = get_vertex_simkin_object(block_ptr);
 
 	// If the field is "symbol", return the symbol of the block.
 
-	else if (field == "symbol") {
+	else if (field_symbol == SYMBOL_SYMBOL) {
 		skString symbol = (char *)block_def_ptr->get_symbol();
 		value = symbol;
 	}
 
 	// If the field is "name", return the name of the block.
 
-	else if (field == "name") {
+	else if (field_symbol == NAME_SYMBOL) {
 		skString symbol = (char *)block_def_ptr->name;
 		value = symbol;
 	}
 
 	// If the field is "movable", return the movable flag.
 
-	else if (field == "movable")
+	else if (field_symbol == MOVABLE_SYMBOL)
 		value = block_def_ptr->movable;
 
 	// All other fields are errors.
@@ -522,6 +813,8 @@ static bool
 set_block_value(block *block_ptr, const skString& field, 
 				const skString& attribute, skRValue value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
 	int old_min_column, old_min_row, old_min_level;
 	int old_max_column, old_max_row, old_max_level;
 	int new_min_column, new_min_row, new_min_level;
@@ -540,7 +833,7 @@ set_block_value(block *block_ptr, const skString& field,
 	// block is movable, set the approapiate coordinate of the block.
 
 	block_def *block_def_ptr = block_ptr->block_def_ptr;
-	if (field == "location" && block_def_ptr->movable) {
+	if (field_symbol == LOCATION_SYMBOL && block_def_ptr->movable) {
 
 		// If this block has lights, calculate the old bounding box for them.
 
@@ -551,14 +844,15 @@ set_block_value(block *block_ptr, const skString& field,
 
 		// Now update the specified attribute.
 
-		if (attribute == "x")
+		if (attribute_symbol == X_SYMBOL)
 			block_ptr->translation.x = value.floatValue() / texels_per_unit;
-		else if (attribute == "y")
+		else if (attribute_symbol == Y_SYMBOL)
 			block_ptr->translation.y = value.floatValue() / texels_per_unit;
-		else if (attribute == "z")
+		else if (attribute_symbol == Z_SYMBOL)
 			block_ptr->translation.z = value.floatValue() / texels_per_unit;
 		else
 			return(false);
+		update_movable_block_in_grid(block_ptr);
 
 		// If this block has lights, calculating the new bounding box for them.
 		// If the old and new bounding boxes are different, then reset the
@@ -584,13 +878,13 @@ set_block_value(block *block_ptr, const skString& field,
 	// block is structural and movable, set the approapiate coordinate of the
 	// block's origin.
 
-	else if (field == "origin" && block_def_ptr->type == STRUCTURAL_BLOCK
+	else if (field_symbol == ORIGIN_SYMBOL && block_def_ptr->type == STRUCTURAL_BLOCK
 		&& block_def_ptr->movable) {
-		if (attribute == "x")
+		if (attribute_symbol == X_SYMBOL)
 			block_ptr->block_origin.x = value.floatValue() / texels_per_unit;
-		else if (attribute == "y")
+		else if (attribute_symbol == Y_SYMBOL)
 			block_ptr->block_origin.y = value.floatValue() / texels_per_unit;
-		else if (attribute == "z")
+		else if (attribute_symbol == Z_SYMBOL)
 			block_ptr->block_origin.z = value.floatValue() / texels_per_unit;
 		else
 			return(false);
@@ -614,6 +908,8 @@ static bool
 call_block_method(block *block_ptr, const skString& method,
 				  skRValueArray& arguments, skRValue& returnValue)
 {
+	int method_symbol = method.symbol();
+
 	// If the block pointer is NULL, this this block has been removed from
 	// the map and can no longer be accessed.
 
@@ -632,7 +928,7 @@ call_block_method(block *block_ptr, const skString& method,
 
 	// If the method is "reset_vertices", do just that and update the block.
 
-	if (method == "reset_vertices") {
+	if (method_symbol == RESET_VERTICES_SYMBOL) {
 		if (arguments.entries() != 0)
 			return(false);
 		block_ptr->reset_vertices();
@@ -642,7 +938,7 @@ call_block_method(block *block_ptr, const skString& method,
 	// If the method is "get_vertices", create a new vertex SimKin object with
 	// a copy of the block's vertices in it.
 
-	else if (method == "get_vertices") {
+	else if (method_symbol == GET_VERTICES_SYMBOL) {
 		vertex *vertex_list;
 		skRValue *simkin_value_ptr;
 		int index;
@@ -676,7 +972,7 @@ call_block_method(block *block_ptr, const skString& method,
 	// If the method is "set_vertices", copy the vertex list in the given
 	// vertex SimKin object to the block's vertex list, and update the block.
 
-	else if (method == "set_vertices") {
+	else if (method_symbol == SET_VERTICES_SYMBOL) {
 		vertex_simkin_object *vertex_simkin_object_ptr;
 		int index;
 
@@ -699,6 +995,8 @@ call_block_method(block *block_ptr, const skString& method,
 		// Copy the vertex list in the object to the block's vertex list,
 		// and update the block data.
 
+		if (!block_ptr->unshare_geometry())
+			return(false);
 		for (index = 0; index < block_ptr->vertices; index++)
 			block_ptr->vertex_list[index] = 
 				vertex_simkin_object_ptr->vertex_list[index];
@@ -707,7 +1005,7 @@ call_block_method(block *block_ptr, const skString& method,
 
 	// If the method is "orient"...
 
-	else if (method == "orient") {
+	else if (method_symbol == ORIENT_SYMBOL) {
 		skString compass_direction;
 		orientation block_orientation;
 
@@ -782,7 +1080,7 @@ call_block_method(block *block_ptr, const skString& method,
 	// If the method is "rotate_x", rotate the block around the X axis by the
 	// angle given as an argument.
 
-	else if (method == "rotate_x") {
+	else if (method_symbol == ROTATE_X_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		block_ptr->rotate_x(pos_adjust_angle(arguments[0].floatValue()));
@@ -791,7 +1089,7 @@ call_block_method(block *block_ptr, const skString& method,
 	// If the method is "rotate_y", rotate the block around the Y axis by the
 	// angle given as an argument.
 
-	else if (method == "rotate_y") {
+	else if (method_symbol == ROTATE_Y_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		block_ptr->rotate_y(pos_adjust_angle(arguments[0].floatValue()));
@@ -800,19 +1098,19 @@ call_block_method(block *block_ptr, const skString& method,
 	// If the method is "rotate_z", rotate the block around the Z axis by the
 	// angle given as an argument.
 
-	else if (method == "rotate_z") {
+	else if (method_symbol == ROTATE_Z_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		block_ptr->rotate_z(pos_adjust_angle(arguments[0].floatValue()));
 	}
 
-	else if (method == "setframe") {
+	else if (method_symbol == SETFRAME_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		block_ptr->set_frame(arguments[0].intValue());
 	}
 
-	else if (method == "setloop") {
+	else if (method_symbol == SETLOOP_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		block_ptr->set_nextloop(arguments[0].intValue());
@@ -843,9 +1141,11 @@ public:
 bool 
 array_simkin_object::getValue(const skString& field, const skString& attribute, skRValue& value)
 {
+	int field_symbol = field.symbol();
+
 	// If the field is "elements", return the number of elements in the array.
 
-	if (field == "elements") {
+	if (field_symbol == ELEMENTS_SYMBOL) {
 		value = skRValue(array.entries());
 		return(true);
 	}
@@ -895,10 +1195,12 @@ array_simkin_object::setValueAt(const skRValue& array_index, const skString& att
 bool
 array_simkin_object::method(const skString& method, skRValueArray& arguments, skRValue& returnValue, skExecutableContext& ctxt)
 {	
+	int method_symbol = method.symbol();
+
 	// If the method is "insert", insert the value in the second argument
 	// before the index in the first argument.
 
-	if (method == "insert") {
+	if (method_symbol == INSERT_SYMBOL) {
 		if (arguments.entries() != 2)
 			return(false);
 		array.insert(arguments[1], arguments[0].intValue());
@@ -907,7 +1209,7 @@ array_simkin_object::method(const skString& method, skRValueArray& arguments, sk
 	// If the method is "prepend", prepend the value in the first argument.
 	// This is the same as insert(0, value).
 
-	else if (method == "prepend") {
+	else if (method_symbol == PREPEND_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		array.prepend(arguments[0]);
@@ -915,7 +1217,7 @@ array_simkin_object::method(const skString& method, skRValueArray& arguments, sk
 
 	// If the method is "append", append the value in the first argument.
 
-	else if (method == "append") {
+	else if (method_symbol == APPEND_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		array.append(arguments[0]);
@@ -924,7 +1226,7 @@ array_simkin_object::method(const skString& method, skRValueArray& arguments, sk
 	// If the method is "delete", delete the value at the index in the first
 	// argument.
 
-	else if (method == "delete") {
+	else if (method_symbol == DELETE_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		array.deleteElt(arguments[0].intValue());
@@ -961,9 +1263,12 @@ public:
 bool 
 spot_simkin_object::getValue(const skString& field, const skString& attribute, skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
+
 	// If the field is "title", return the current title string.
 
-	if (field == "title") {
+	if (field_symbol == TITLE_SYMBOL) {
 		skString title = get_title();
 		value = title;
 	} 
@@ -972,19 +1277,19 @@ spot_simkin_object::getValue(const skString& field, const skString& attribute, s
 	// return that current time attribute.  If the attribute is "millisecond",
 	// return the number of milliseconds since Windows started.
 
-	else if (field == "time") {
+	else if (field_symbol == TIME_SYMBOL) {
 		struct tm *time_ptr;
 		time_t time_secs;
 
 		time(&time_secs);
 		time_ptr = localtime(&time_secs);
-		if (attribute == "second")
+		if (attribute_symbol == SECOND_SYMBOL)
 			value = time_ptr->tm_sec;
-		else if (attribute == "minute")
+		else if (attribute_symbol == MINUTE_SYMBOL)
 			value = time_ptr->tm_min;
-		else if (attribute == "hour")
+		else if (attribute_symbol == HOUR_SYMBOL)
 			value = time_ptr->tm_hour;
-		else if (attribute == "millisecond")
+		else if (attribute_symbol == MILLISECOND_SYMBOL)
 			value = get_time_ms() - start_time_ms;
 		else
 			return(false);
@@ -993,14 +1298,14 @@ spot_simkin_object::getValue(const skString& field, const skString& attribute, s
 	// If the field is "user_can_move" or "user_can_look",
 	// then return the approapiate global flag value.
 
-	else if (field == "user_can_move")
+	else if (field_symbol == USER_CAN_MOVE_SYMBOL)
 		value = enable_player_translation;
-	else if (field == "user_can_look")
+	else if (field_symbol == USER_CAN_LOOK_SYMBOL)
 		value = enable_player_rotation;
 
 	// If the field is "version", then return the Flatland version string.
 
-	else if (field == "version")
+	else if (field_symbol == VERSION_SYMBOL)
 		value = skString(version_number_to_string(ROVER_VERSION_NUMBER));
 	
 	// All other fields are passed to the default getValue function for
@@ -1019,21 +1324,23 @@ spot_simkin_object::getValue(const skString& field, const skString& attribute, s
 bool 
 spot_simkin_object::setValue(const skString& field, const skString& attribute, const skRValue& value)
 {
+	int field_symbol = field.symbol();
+
 	// If the field is "title", set the current title.
 
-	if (field == "title") {
+	if (field_symbol == TITLE_SYMBOL) {
 		spot_title = (const char *)value.str();
-		set_title("%s", spot_title);
+		set_title("%s", (char *)spot_title);
 		return(true);
 	}
 
 	// If the field is "user_can_move" or "user_can_look",
 	// then set the approapiate global flag value.
 
-	else if (field == "user_can_move") {
+	else if (field_symbol == USER_CAN_MOVE_SYMBOL) {
 		enable_player_translation = value.boolValue();
 		return(true);
-	} else if (field == "user_can_look") {
+	} else if (field_symbol == USER_CAN_LOOK_SYMBOL) {
 		enable_player_rotation = value.boolValue();
 		return(true);
 	}
@@ -1049,9 +1356,11 @@ spot_simkin_object::setValue(const skString& field, const skString& attribute, c
 bool
 spot_simkin_object::method(const skString& method, skRValueArray& arguments, skRValue& returnValue, skExecutableContext& ctxt)
 {
+	int method_symbol = method.symbol();
+
 	// If the method is "log", write a message to the log file.
 
-	if (method == "log") {
+	if (method_symbol == LOG_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		skString message = arguments[0].str();
@@ -1061,7 +1370,7 @@ spot_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 	// If the method is "new_array", create a new array SimKin object and
 	// return a pointer to it.
 
-	else if (method == "new_array") {
+	else if (method_symbol == NEW_ARRAY_SYMBOL) {
 		array_simkin_object *array_simkin_object_ptr;
 
 		if (arguments.entries() != 0)
@@ -1073,7 +1382,7 @@ spot_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 	// If the method is "free_array", free the array SimKin object given as
 	// an argument.
 
-	else if (method == "free_array") {
+	else if (method_symbol == FREE_ARRAY_SYMBOL) {
 		array_simkin_object *array_simkin_object_ptr;
 
 		if (arguments.entries() != 1)
@@ -1087,7 +1396,7 @@ spot_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 	// processing.
 
 	else
-        return(skElementExecutable::method(method, arguments, returnValue, *simkin_context_ptr));
+        return(skElementExecutable::method(method, arguments, returnValue, ctxt));
 
 	// Indicate success.
 
@@ -1110,9 +1419,11 @@ public:
 bool 
 math_simkin_object::getValue(const skString& field, const skString& attribute, skRValue& value)
 {
+	int field_symbol = field.symbol();
+
 	// If the field is "pi", return the value of Pi.
 
-	if (field == "pi")
+	if (field_symbol == PI_SYMBOL)
 		value = PI;
 
 	// All other field names are errors.
@@ -1128,10 +1439,12 @@ math_simkin_object::getValue(const skString& field, const skString& attribute, s
 bool
 math_simkin_object::method(const skString& method, skRValueArray& arguments, skRValue& returnValue, skExecutableContext& ctxt)
 {
+	int method_symbol = method.symbol();
+
 	// If the method is "random", return a random number between the first
 	// and second argument.
 
-	if (method == "random") {
+	if (method_symbol == RANDOM_SYMBOL) {
  		if (arguments.entries() != 2)
 			return(false);
 		int min = arguments[0].intValue();
@@ -1141,7 +1454,7 @@ math_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 
 	// If the method is "sqrt", return the square root of the first argument.
 
-	else if (method == "sqrt") {
+	else if (method_symbol == SQRT_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		returnValue = (float)sqrt(arguments[0].floatValue());
@@ -1149,7 +1462,7 @@ math_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 
 	// If the method is "sin", return the sine of the first argument.
 
-	else if (method == "sin") {
+	else if (method_symbol == SIN_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		returnValue = (float)sin(arguments[0].floatValue());
@@ -1157,7 +1470,7 @@ math_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 
 	// If the method is "cos", return the cosine of the first argument.
 
-	else if (method == "cos") {
+	else if (method_symbol == COS_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		returnValue = (float)cos(arguments[0].floatValue());
@@ -1165,7 +1478,7 @@ math_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 
 	// If the method is "tan", return the tangent of the first argument.
 
-	else if (method == "tan") {
+	else if (method_symbol == TAN_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		returnValue = (float)tan(arguments[0].floatValue());
@@ -1173,7 +1486,7 @@ math_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 
 	// If the method is "asin", return the arc sine of the first argument.
 
-	else if (method == "asin") {
+	else if (method_symbol == ASIN_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		returnValue = (float)asin(arguments[0].floatValue());
@@ -1181,7 +1494,7 @@ math_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 
 	// If the method is "acos", return the arc cosine of the first argument.
 
-	else if (method == "acos") {
+	else if (method_symbol == ACOS_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		returnValue = (float)acos(arguments[0].floatValue());
@@ -1189,7 +1502,7 @@ math_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 
 	// If the method is "atan", return the arc tangent of the first argument.
 
-	else if (method == "atan") {
+	else if (method_symbol == ATAN_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		returnValue = (float)atan(arguments[0].floatValue());
@@ -1198,7 +1511,7 @@ math_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 	// If the method is "rad", convert the first argument from degrees to
 	// radians.
 
-	else if (method == "rad") {
+	else if (method_symbol == RAD_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		returnValue = RAD(arguments[0].floatValue());
@@ -1207,7 +1520,7 @@ math_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 	// If the method is "deg", convert the first argument from radius to
 	// degrees.
 
-	else if (method == "deg") {
+	else if (method_symbol == DEG_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		returnValue = DEG(arguments[0].floatValue());
@@ -1215,7 +1528,7 @@ math_simkin_object::method(const skString& method, skRValueArray& arguments, skR
 
 	// The the method is "abs", return the absolute value of the first argument.
 
-	else if (method == "abs") {
+	else if (method_symbol == ABS_SYMBOL) {
 		if (arguments.entries() != 1)
 			return(false);
 		returnValue = (float)fabs(arguments[0].floatValue());
@@ -1247,21 +1560,24 @@ public:
 bool 
 sky_simkin_object::getValue(const skString& field, const skString& attribute, skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
+
 	// If the field is "brightness", return the sky brightness value as a
 	// percentage.
 
-	if (field == "brightness")
+	if (field_symbol == BRIGHTNESS_SYMBOL)
 		value = sky_brightness * 100.0f;
 
 	// If the field is "colour", and the attribute is "red", "green" or "blue",
 	// return the approapiate component of the unlit sky colour.
 
-	else if (field == "colour" || field == "color") {
-		if (attribute == "red")
+	else if (field_symbol == COLOUR_SYMBOL || field_symbol == COLOR_SYMBOL) {
+		if (attribute_symbol == RED_SYMBOL)
 			value = unlit_sky_colour.red;
-		else if (attribute == "green")
+		else if (attribute_symbol == GREEN_SYMBOL)
 			value = unlit_sky_colour.green;
-		else if (attribute == "blue")
+		else if (attribute_symbol == BLUE_SYMBOL)
 			value = unlit_sky_colour.blue;
 		else
 			return(false);
@@ -1270,7 +1586,7 @@ sky_simkin_object::getValue(const skString& field, const skString& attribute, sk
 	// If the field is "texture", return the URL of the sky texture, or an
 	// empty string if there is no sky texture.
 
-	else if (field == "texture") {
+	else if (field_symbol == TEXTURE_SYMBOL) {
 		skString texture_URL;
 		if (sky_texture_ptr != NULL)
 			texture_URL = sky_texture_ptr->URL;
@@ -1292,10 +1608,13 @@ sky_simkin_object::getValue(const skString& field, const skString& attribute, sk
 bool 
 sky_simkin_object::setValue(const skString& field, const skString& attribute, const skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
+
 	// If the field is "brightness", set the sky brightness from a percentage,
 	// clamping it to a value between 0 and 1.
 
-	if (field == "brightness") {
+	if (field_symbol == BRIGHTNESS_SYMBOL) {
 		sky_brightness = value.floatValue() / 100.0f;
 		if (sky_brightness < 0.0f)
 			sky_brightness = 0.0f;
@@ -1305,12 +1624,12 @@ sky_simkin_object::setValue(const skString& field, const skString& attribute, co
 
 	// If the field is "colour", set the unlit sky colour.
 
-	else if (field == "colour" || field == "color") {
-		if (attribute == "red")
+	else if (field_symbol == COLOUR_SYMBOL || field_symbol == COLOR_SYMBOL) {
+		if (attribute_symbol == RED_SYMBOL)
 			unlit_sky_colour.red = value.floatValue();
-		else if (attribute == "green")
+		else if (attribute_symbol == GREEN_SYMBOL)
 			unlit_sky_colour.green = value.floatValue();
-		else if (attribute == "blue")
+		else if (attribute_symbol == BLUE_SYMBOL)
 			unlit_sky_colour.blue = value.floatValue();
 		else
 			return(false);
@@ -1318,7 +1637,7 @@ sky_simkin_object::setValue(const skString& field, const skString& attribute, co
 	
 	// If the field is "texture", load the custom sky texture.
 
-	else if (field == "texture") {
+	else if (field_symbol == TEXTURE_SYMBOL) {
 		load_custom_texture(custom_sky_texture_ptr, (const char *)value.str());
 		return(true);
 	}
@@ -1356,6 +1675,8 @@ ambient_light_simkin_object::getValue(const skString& field,
 									  const skString& attribute,
 									  skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
 	float brightness;
 	RGBcolour colour;
 
@@ -1366,18 +1687,18 @@ ambient_light_simkin_object::getValue(const skString& field,
 	// If the field is "brightness", return the ambient brightness as a
 	// percentage.
 
-	if (field == "brightness")
+	if (field_symbol == BRIGHTNESS_SYMBOL)
 		value = brightness * 100.0f;
 
 	// If the field is "colour" or "color", and the attribute is "red", "green"
 	// or "blue", return the approapiate ambient colour component.
 
-	else if (field == "colour" || field == "color") {
-		if (attribute == "red")
+	else if (field_symbol == COLOUR_SYMBOL || field_symbol == COLOR_SYMBOL) {
+		if (attribute_symbol == RED_SYMBOL)
 			value = colour.red;
-		else if (attribute == "green")
+		else if (attribute_symbol == GREEN_SYMBOL)
 			value = colour.green;
-		else if (attribute == "blue")
+		else if (attribute_symbol == BLUE_SYMBOL)
 			value = colour.blue;
 		else
 			return(false);
@@ -1398,6 +1719,8 @@ ambient_light_simkin_object::getValue(const skString& field,
 bool 
 ambient_light_simkin_object::setValue(const skString& field, const skString& attribute, const skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
 	float brightness;
 	RGBcolour colour;
 
@@ -1408,7 +1731,7 @@ ambient_light_simkin_object::setValue(const skString& field, const skString& att
 	// If the field is "brightness, set the ambient brightness from a
 	// percentage, clamped to a value between 0 and 1.
 
-	if (field == "brightness") {
+	if (field_symbol == BRIGHTNESS_SYMBOL) {
 		brightness = value.floatValue() / 100.0f;
 		if (brightness < 0.0f)
 			brightness = 0.0f;
@@ -1419,12 +1742,12 @@ ambient_light_simkin_object::setValue(const skString& field, const skString& att
 	// If the field is "colour" or "color" and the attribute is "red", "green"
 	// or "blue", set the approapiate ambient colour component.
 
-	else if (field == "colour" || field == "color") {
-		if (attribute == "red")
+	else if (field_symbol == COLOUR_SYMBOL || field_symbol == COLOR_SYMBOL) {
+		if (attribute_symbol == RED_SYMBOL)
 			colour.red = value.floatValue();
-		else if (attribute == "green")
+		else if (attribute_symbol == GREEN_SYMBOL)
 			colour.green = value.floatValue();
-		else if (attribute == "blue")
+		else if (attribute_symbol == BLUE_SYMBOL)
 			colour.blue = value.floatValue();
 		else
 			return(false);
@@ -1458,6 +1781,9 @@ public:
 bool 
 ambient_sound_simkin_object::getValue(const skString& field, const skString& attribute, skRValue& value)
 {	
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
+
 	// If the ambient sound does not exist, then none of the fields or
 	// field attributes are accessible.
 
@@ -1467,7 +1793,7 @@ ambient_sound_simkin_object::getValue(const skString& field, const skString& att
 	// If the field is "file", return the URL of the wave file, or an empty
 	// string if there is no wave file.
 
-	if (field == "file") {
+	if (field_symbol == FILE_SYMBOL) {
 		skString wave_URL;
 		if (ambient_sound_ptr->wave_ptr != NULL)
 			wave_URL = ambient_sound_ptr->wave_ptr->URL;
@@ -1477,12 +1803,12 @@ ambient_sound_simkin_object::getValue(const skString& field, const skString& att
 	// If the field is "volume", return the volume of the ambient sound as a
 	// percentage.
 
-	else if (field == "volume")
+	else if (field_symbol == VOLUME_SYMBOL)
 		value = ambient_sound_ptr->volume * 100.0f;
 
 	// If the field is "playback", return the playback mode.
 
-	else if (field == "playback") {
+	else if (field_symbol == PLAYBACK_SYMBOL) {
 		skString playback_mode(value_to_string(VALUE_PLAYBACK_MODE, ambient_sound_ptr->playback_mode));
 		value = playback_mode;
 	}
@@ -1490,11 +1816,11 @@ ambient_sound_simkin_object::getValue(const skString& field, const skString& att
 	// If the field is "delay" and the attribute is "minimum" or "range", get
 	// the corresponding value. 
 
-	else if (field == "delay") {
-		if (attribute == "" || attribute == "minimum")
+	else if (field_symbol == DELAY_SYMBOL) {
+		if (attribute == "" || attribute_symbol == MINIMUM_SYMBOL)
 			value = (float)ambient_sound_ptr->delay_range.min_delay_ms / 
 				1000.0f;
-		else if (attribute == "range")
+		else if (attribute_symbol == RANGE_SYMBOL)
 			value = (float)ambient_sound_ptr->delay_range.delay_range_ms /
 				1000.0f;
 		else
@@ -1516,6 +1842,8 @@ ambient_sound_simkin_object::getValue(const skString& field, const skString& att
 bool 
 ambient_sound_simkin_object::setValue(const skString& field, const skString& attribute, const skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
 	float volume;
 	skString value_str;
 
@@ -1529,7 +1857,7 @@ ambient_sound_simkin_object::setValue(const skString& field, const skString& att
 	// existing sound buffe), and if it needs to be downloaded and no wave file
 	// downloading is in progress, then start it up.
 	
-	if (field == "file") {
+	if (field_symbol == FILE_SYMBOL) {
 		stop_sound(ambient_sound_ptr);
 		ambient_sound_ptr->in_range = false;
 		destroy_sound_buffer(ambient_sound_ptr);
@@ -1540,7 +1868,7 @@ ambient_sound_simkin_object::setValue(const skString& field, const skString& att
 	// If the field is "volume", set the volume of the ambient sound from a
 	// percentage, clamping it to a value between 0 and 1.
 
-	else if (field == "volume") {
+	else if (field_symbol == VOLUME_SYMBOL) {
 		volume = value.floatValue() / 100.0f;
 		if (volume < 0.0f)
 			volume = 0.0f;
@@ -1552,7 +1880,7 @@ ambient_sound_simkin_object::setValue(const skString& field, const skString& att
 	// If the field is "playback", set the playback mode, clear the played
 	// once and in range flags, and stop the sound.
 
-	else if (field == "playback") {
+	else if (field_symbol == PLAYBACK_SYMBOL) {
 		value_str = value.str();
 		if (parse_playback_mode((char *)(const char *)value_str, 
 			&ambient_sound_ptr->playback_mode)) {
@@ -1566,15 +1894,15 @@ ambient_sound_simkin_object::setValue(const skString& field, const skString& att
 	// the delay range to zero.  If an attribute of "minimum" or "range" is 
 	// supplied, set the corresponding value. 
 
-	else if (field == "delay") {
+	else if (field_symbol == DELAY_SYMBOL) {
 		if (attribute == "") {
 			ambient_sound_ptr->delay_range.min_delay_ms = 
 				(int)(value.floatValue() * 1000.0f);
 			ambient_sound_ptr->delay_range.delay_range_ms = 0;
-		} else if (attribute == "minimum")
+		} else if (attribute_symbol == MINIMUM_SYMBOL)
 			ambient_sound_ptr->delay_range.min_delay_ms =
 				(int)(value.floatValue() * 1000.0f);
-		else if (attribute == "range")
+		else if (attribute_symbol == RANGE_SYMBOL)
 			ambient_sound_ptr->delay_range.delay_range_ms =
 				(int)(value.floatValue() * 1000.0f);
 		else
@@ -1607,6 +1935,9 @@ public:
 bool 
 orb_simkin_object::getValue(const skString& field, const skString& attribute, skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
+
 	// If the orb does not exist, then none of the fields or field attributes
 	// are accessible.
 
@@ -1616,18 +1947,18 @@ orb_simkin_object::getValue(const skString& field, const skString& attribute, sk
 	// If the field was "brightness", return the orb brightness as a
 	// percentage.
 
-	if (field == "brightness")
+	if (field_symbol == BRIGHTNESS_SYMBOL)
 		value = orb_brightness * 100.0f;
 
 	// If the field was "colour" and the attribute was "red", "green" or "blue",
 	// return the approapiate component of the orb's light colour.
 
-	else if (field == "colour" || field == "color") {
-		if (attribute == "red")
+	else if (field_symbol == COLOUR_SYMBOL || field_symbol == COLOR_SYMBOL) {
+		if (attribute_symbol == RED_SYMBOL)
 			value = orb_light_ptr->colour.red;
-		else if (attribute == "green")
+		else if (attribute_symbol == GREEN_SYMBOL)
 			value = orb_light_ptr->colour.green;
-		else if (attribute == "blue")
+		else if (attribute_symbol == BLUE_SYMBOL)
 			value = orb_light_ptr->colour.blue;
 		else
 			return(false);
@@ -1636,10 +1967,10 @@ orb_simkin_object::getValue(const skString& field, const skString& attribute, sk
 	// If the field was "position" and the attribute was "angle_x" or "angle_y",
 	// return the approapiate orb direction angle.
 
-	else if (field == "position") {
-		if (attribute == "angle_x")
+	else if (field_symbol == POSITION_SYMBOL) {
+		if (attribute_symbol == ANGLE_X_SYMBOL)
 			value = orb_direction.angle_x;
-		else if (attribute == "angle_y")
+		else if (attribute_symbol == ANGLE_Y_SYMBOL)
 			value = orb_direction.angle_y;
 		else
 			return(false);
@@ -1648,7 +1979,7 @@ orb_simkin_object::getValue(const skString& field, const skString& attribute, sk
 	// If the field is "texture", return the URL of the orb texture, or an
 	// empty string if there is no orb texture.
 
-	else if (field == "texture") {
+	else if (field_symbol == TEXTURE_SYMBOL) {
 		if (orb_texture_ptr != NULL) {
 			skString texture_URL(orb_texture_ptr->URL);
 			value = texture_URL;
@@ -1661,7 +1992,7 @@ orb_simkin_object::getValue(const skString& field, const skString& attribute, sk
 	// If the field is "href", return the URL of the orb exit, or an empty
 	// string if there is no URL set.
 
-	else if (field == "href") {
+	else if (field_symbol == HREF_SYMBOL) {
 		if (orb_exit_ptr != NULL) {
 			skString exit_URL(orb_exit_ptr->URL);
 			value = exit_URL;
@@ -1674,7 +2005,7 @@ orb_simkin_object::getValue(const skString& field, const skString& attribute, sk
 	// If the field is "target", return the window target of the orb exit,
 	// or an empty string if there is no target set.
 
-	else if (field == "target") {
+	else if (field_symbol == TARGET_SYMBOL) {
 		if (orb_exit_ptr != NULL) {
 			skString exit_URL(orb_exit_ptr->target);
 			value = exit_URL;
@@ -1687,7 +2018,7 @@ orb_simkin_object::getValue(const skString& field, const skString& attribute, sk
 	// If the field is "text", return the label of the orb exit, or an empty 
 	// string if there is no label set.
 
-	else if (field == "text") {
+	else if (field_symbol == TEXT_SYMBOL) {
 		if (orb_exit_ptr != NULL) {
 			skString exit_URL(orb_exit_ptr->label);
 			value = exit_URL;
@@ -1712,6 +2043,9 @@ orb_simkin_object::getValue(const skString& field, const skString& attribute, sk
 bool 
 orb_simkin_object::setValue(const skString& field, const skString& attribute, const skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
+
 	direction orb_light_direction;
 
 	// If the orb does not exist, then none of the fields or field attributes
@@ -1723,7 +2057,7 @@ orb_simkin_object::setValue(const skString& field, const skString& attribute, co
 	// If the field is "brightness", set the orb brightness from a percentage,
 	// clamped to a value between 0 and 1.
 
-	if (field == "brightness") {
+	if (field_symbol == BRIGHTNESS_SYMBOL) {
 		orb_brightness = value.floatValue() / 100.0f;
 		if (orb_brightness < 0.0f)
 			orb_brightness = 0.0f;
@@ -1734,12 +2068,12 @@ orb_simkin_object::setValue(const skString& field, const skString& attribute, co
 	// If the field is "colour" and the attribute is "red", "green" or "blue",
 	// set the approapiate component of the orb's light colour.
 
-	else if (field == "colour" || field == "color") {
-		if (attribute == "red")
+	else if (field_symbol == COLOUR_SYMBOL || field_symbol == COLOR_SYMBOL) {
+		if (attribute_symbol == RED_SYMBOL)
 			orb_light_ptr->colour.red = value.floatValue();
-		else if (attribute == "green")
+		else if (attribute_symbol == GREEN_SYMBOL)
 			orb_light_ptr->colour.green = value.floatValue();
-		else if (attribute == "blue")
+		else if (attribute_symbol == BLUE_SYMBOL)
 			orb_light_ptr->colour.blue = value.floatValue();
 		else
 			return(false);
@@ -1748,10 +2082,10 @@ orb_simkin_object::setValue(const skString& field, const skString& attribute, co
 	// If the field is "position", and the attribute is "angle_x" or "angle_y",
 	// set the approapiate orb direction angle.
 
-	else if (field == "position") {
-		if (attribute == "angle_x")
+	else if (field_symbol == POSITION_SYMBOL) {
+		if (attribute_symbol == ANGLE_X_SYMBOL)
 			orb_direction.angle_x = value.floatValue();
-		else if (attribute == "angle_y")
+		else if (attribute_symbol == ANGLE_Y_SYMBOL)
 			orb_direction.angle_y = value.floatValue();
 		else
 			return(false);
@@ -1759,7 +2093,7 @@ orb_simkin_object::setValue(const skString& field, const skString& attribute, co
 	
 	// If the field is "texture", load the custom orb texture.
 
-	else if (field == "texture") {
+	else if (field_symbol == TEXTURE_SYMBOL) {
 		load_custom_texture(custom_orb_texture_ptr, (const char *)value.str());
 		return(true);
 	} 
@@ -1767,7 +2101,7 @@ orb_simkin_object::setValue(const skString& field, const skString& attribute, co
 	// If the field is "href", set the URL of the orb exit, creating the exit
 	// if necessary.
 
-	else if (field == "href") {
+	else if (field_symbol == HREF_SYMBOL) {
 		if (orb_exit_ptr == NULL) {
 			NEW(orb_exit_ptr, hyperlink);
 			if (orb_exit_ptr == NULL)
@@ -1780,7 +2114,7 @@ orb_simkin_object::setValue(const skString& field, const skString& attribute, co
 	// If the field is "target", set the window target of the orb exit,
 	// creating the exit if necessary.
 
-	else if (field == "target") {
+	else if (field_symbol == TARGET_SYMBOL) {
 		if (orb_exit_ptr == NULL) {
 			NEW(orb_exit_ptr, hyperlink);
 			if (orb_exit_ptr == NULL)
@@ -1793,7 +2127,7 @@ orb_simkin_object::setValue(const skString& field, const skString& attribute, co
 	// If the field is "text", return the label of the orb exit, or an empty 
 	// string if there is no label set.
 
-	else if (field == "text") {
+	else if (field_symbol == TEXT_SYMBOL) {
 		if (orb_exit_ptr == NULL) {
 			NEW(orb_exit_ptr, hyperlink);
 			if (orb_exit_ptr == NULL)
@@ -1836,6 +2170,9 @@ public:
 bool 
 fog_simkin_object::getValue(const skString& field, const skString& attribute, skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
+
 	// If the fog does not exist, then none of the fields or field attributes
 	// are accessible.
 
@@ -1844,18 +2181,18 @@ fog_simkin_object::getValue(const skString& field, const skString& attribute, sk
 
 	// If the field was "style", return the fog style
 
-	if (field == "style")
+	if (field_symbol == STYLE_SYMBOL)
 			value = global_fog.style;
 
 	// If the field was "colour" and the attribute was "red", "green" or "blue",
 	// return the appropriate component of the fog's light colour.
 
-	else if (field == "colour" || field == "color") {
-		if (attribute == "red")
+	else if (field_symbol == COLOUR_SYMBOL || field_symbol == COLOR_SYMBOL) {
+		if (attribute_symbol == RED_SYMBOL)
 			value = global_fog.colour.red;
-		else if (attribute == "green")
+		else if (attribute_symbol == GREEN_SYMBOL)
 			value = global_fog.colour.green;
-		else if (attribute == "blue")
+		else if (attribute_symbol == BLUE_SYMBOL)
 			value = global_fog.colour.blue;
 		else
 			return(false);
@@ -1864,17 +2201,17 @@ fog_simkin_object::getValue(const skString& field, const skString& attribute, sk
 	// If the field was "radius" 
 	// return the fog radius.
 
-	else if (field == "startradius") {
+	else if (field_symbol == STARTRADIUS_SYMBOL) {
 			value = global_fog.start_radius;
 	}
 
-	else if (field == "endradius") {
+	else if (field_symbol == ENDRADIUS_SYMBOL) {
 			value = global_fog.end_radius;
 	}
 		
 	// If the field is "density", return the fog density
 
-	else if (field == "density") {
+	else if (field_symbol == DENSITY_SYMBOL) {
 			value = global_fog.density * 100.0f;
 	}
 
@@ -1893,6 +2230,8 @@ fog_simkin_object::getValue(const skString& field, const skString& attribute, sk
 bool 
 fog_simkin_object::setValue(const skString& field, const skString& attribute, const skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
 
 	// If the fog does not exist, then none of the fields or field attributes
 	// are accessible.
@@ -1901,7 +2240,7 @@ fog_simkin_object::setValue(const skString& field, const skString& attribute, co
 		return(false);
 
 	// If the field was "style", set the fog style
-	if (field == "style") {
+	if (field_symbol == STYLE_SYMBOL) {
 		if (value.intValue() == EXPONENTIAL_FOG || value.intValue() == LINEAR_FOG)
 			global_fog.style = value.intValue() ;
 	}
@@ -1909,12 +2248,12 @@ fog_simkin_object::setValue(const skString& field, const skString& attribute, co
 	// If the field was "colour" and the attribute was "red", "green" or "blue",
 	// set the appropriate component of the fog's light colour.
 
-	else if (field == "colour" || field == "color") {
-		if (attribute == "red")
+	else if (field_symbol == COLOUR_SYMBOL || field_symbol == COLOR_SYMBOL) {
+		if (attribute_symbol == RED_SYMBOL)
 			global_fog.colour.red = value.floatValue();
-		else if (attribute == "green")
+		else if (attribute_symbol == GREEN_SYMBOL)
 			global_fog.colour.green = value.floatValue();
-		else if (attribute == "blue")
+		else if (attribute_symbol == BLUE_SYMBOL)
 			global_fog.colour.blue = value.floatValue();
 		else
 			return(false);
@@ -1923,17 +2262,17 @@ fog_simkin_object::setValue(const skString& field, const skString& attribute, co
 	// If the field was "radius" 
 	// set the fog radius.
 
-	else if (field == "startradius") {
+	else if (field_symbol == STARTRADIUS_SYMBOL) {
 			global_fog.start_radius = value.floatValue();
 	}
 
-	else  if (field == "endradius") {
+	else  if (field_symbol == ENDRADIUS_SYMBOL) {
 			global_fog.end_radius = value.floatValue();
 	}
 		
 	// If the field is "density", set the fog density
 
-	else if (field == "density") {
+	else if (field_symbol == DENSITY_SYMBOL) {
 		global_fog.density = value.floatValue() / 100.0f;
 		if (global_fog.density < 0.0f)
 			global_fog.density = 0.0f;
@@ -1971,15 +2310,18 @@ public:
 bool 
 map_simkin_object::getValue(const skString& field, const skString& attribute, skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
+
 	// If the field is "dimensions" and the attribute is "column", "row" or
 	// "level", return the appropiate map dimension.
 
-	if (field == "dimensions") {
-		if (attribute == "columns")
+	if (field_symbol == DIMENSIONS_SYMBOL) {
+		if (attribute_symbol == COLUMNS_SYMBOL)
 			value = world_ptr->columns;
-		else if (attribute == "rows")
+		else if (attribute_symbol == ROWS_SYMBOL)
 			value = world_ptr->rows;
-		else if (attribute == "levels") {
+		else if (attribute_symbol == LEVELS_SYMBOL) {
 			if (world_ptr->ground_level_exists)
 				value = world_ptr->levels - 2;
 			else
@@ -1999,11 +2341,13 @@ map_simkin_object::getValue(const skString& field, const skString& attribute, sk
 bool
 map_simkin_object::method(const skString& method, skRValueArray& arguments, skRValue& returnValue, skExecutableContext& ctxt)
 {
+	int method_symbol = method.symbol();
+
 	// If the method is "get_block", return a pointer to the SimKin object
 	// associated with the block with the given symbol or at the given 
 	// location, otherwise return a NULL object.
 
-    if (method == "get_block") {
+    if (method_symbol == GET_BLOCK_SYMBOL) {
 
 		// If there is one argument, assume it's a symbol...
 
@@ -2049,7 +2393,7 @@ map_simkin_object::method(const skString& method, skRValueArray& arguments, skRV
 			level = arguments[2].intValue() - 1;
  			if (world_ptr->ground_level_exists)
 				level++;
-			if ((square_ptr = world_ptr->get_square_ptr(column, row, level)) != NULL && (block_ptr = square_ptr->block_ptr) != NULL)
+			if ((square_ptr = world_ptr->find_square_ptr(column, row, level)) != NULL && (block_ptr = square_ptr->block_ptr) != NULL)
 				returnValue = get_block_simkin_object(block_ptr);
 			else {
 				skRValue value;
@@ -2065,7 +2409,7 @@ map_simkin_object::method(const skString& method, skRValueArray& arguments, skRV
 			level = arguments[2].intValue() - 1;
  			if (world_ptr->ground_level_exists)
 				level++;
-			if ((square_ptr = world_ptr->get_square_ptr(column, row, level)) != NULL && (block_ptr = square_ptr->block_ptr) != NULL)
+			if ((square_ptr = world_ptr->find_square_ptr(column, row, level)) != NULL && (block_ptr = square_ptr->block_ptr) != NULL)
 				returnValue = get_block_simkin_object(block_ptr);
 
 			// Otherwise step through the movable block list, and return the
@@ -2095,7 +2439,7 @@ map_simkin_object::method(const skString& method, skRValueArray& arguments, skRV
 
 	// If the method is "get_blocks"...
 
-	else if (method == "get_blocks") {
+	else if (method_symbol == GET_BLOCKS_SYMBOL) {
 		array_simkin_object *array_simkin_object_ptr;
 
 		// If there is one argument, assume it's a symbol...
@@ -2153,7 +2497,7 @@ map_simkin_object::method(const skString& method, skRValueArray& arguments, skRV
 			level = arguments[2].intValue() - 1;
  			if (world_ptr->ground_level_exists)
 				level++;
-			if ((square_ptr = world_ptr->get_square_ptr(column, row, level)) != NULL && (block_ptr = square_ptr->block_ptr) != NULL)
+			if ((square_ptr = world_ptr->find_square_ptr(column, row, level)) != NULL && (block_ptr = square_ptr->block_ptr) != NULL)
 				array_simkin_object_ptr->array.append(get_block_simkin_object(block_ptr));
 
 			// Now step through the movable block list, and add all blocks
@@ -2178,7 +2522,7 @@ map_simkin_object::method(const skString& method, skRValueArray& arguments, skRV
 	// location.  The symbol "." or ".." causes the block at the given
 	// location to be removed instead of added.
 
-	else if (method == "set_block") {
+	else if (method_symbol == SET_BLOCK_SYMBOL) {
 		int column, row, level;
 		skString symbol_str;
 		square *square_ptr;
@@ -2222,7 +2566,7 @@ map_simkin_object::method(const skString& method, skRValueArray& arguments, skRV
 	// another.  If the source location is empty, the target location will
 	// also become empty.
 
-	else if (method == "move_block") {
+	else if (method_symbol == MOVE_BLOCK_SYMBOL) {
 		int source_column, source_row, source_level;
 		int target_column, target_row, target_level;
 		square *source_square_ptr, *target_square_ptr;
@@ -2249,7 +2593,7 @@ map_simkin_object::method(const skString& method, skRValueArray& arguments, skRV
 
 		// Get the squares at the source and target locations.
 
-		source_square_ptr = world_ptr->get_square_ptr(source_column, source_row, source_level);
+		source_square_ptr = world_ptr->find_square_ptr(source_column, source_row, source_level);
 		target_square_ptr = world_ptr->get_square_ptr(target_column, target_row, target_level);
 
 		// If the target location was invalid, then simply remove the block
@@ -2271,6 +2615,7 @@ map_simkin_object::method(const skString& method, skRValueArray& arguments, skRV
 			if (source_square_ptr != NULL && source_square_ptr->block_ptr != NULL) {
 				block_ptr = source_square_ptr->block_ptr;
 				source_square_ptr->block_ptr = NULL;
+				world_ptr->invalidate_chunk(source_column, source_row, source_level);
 
 				// Reset the active polygons adjacent to this square.
 
@@ -2290,6 +2635,7 @@ map_simkin_object::method(const skString& method, skRValueArray& arguments, skRV
 					compute_light_list_bounding_box(block_ptr->light_list, block_ptr->translation, min_column, min_row, min_level,
 						max_column, max_row, max_level);
 					reset_active_lights(min_column, min_row, min_level,  max_column, max_row, max_level);
+					remove_lights_from_grid(block_ptr->light_list, block_ptr);
 				}
 			}
 
@@ -2307,6 +2653,8 @@ map_simkin_object::method(const skString& method, skRValueArray& arguments, skRV
 
 			if (block_ptr != NULL) {
 				target_square_ptr->block_ptr = block_ptr;
+				block_ptr->square_ptr = target_square_ptr;
+				world_ptr->invalidate_chunk(target_column, target_row, target_level);
 
 				// Step through the trigger list, and update the square and
 				// block pointers of each one.
@@ -2341,6 +2689,7 @@ map_simkin_object::method(const skString& method, skRValueArray& arguments, skRV
 					compute_light_list_bounding_box(block_ptr->light_list, block_ptr->translation, min_column, min_row, min_level,
 						max_column, max_row, max_level);
 					reset_active_lights(min_column, min_row, min_level, max_column, max_row, max_level);
+					add_lights_to_grid(block_ptr->light_list, block_ptr);
 				}
 			}
 		}
@@ -2416,7 +2765,7 @@ scripted_block_simkin_object::method(const skString& method, skRValueArray& argu
 	// are passed to the default method function for processing.
 
 	if (!call_block_method(block_ptr, method, arguments, returnValue))
-		return(skElementExecutable::method(method, arguments, returnValue, *simkin_context_ptr));
+		return(skElementExecutable::method(method, arguments, returnValue, ctxt));
 
 	// Return a success indicator.
 
@@ -2477,11 +2826,14 @@ public:
 bool 
 player_simkin_object::getValue(const skString& field, const skString& attribute, skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
+
 	// If the field is "location" and the attribute is "column", "row" or
 	// "level", or "x", "y" or "z", return the approapiate coordinate of the 
 	// player
 
-	if (field == "location") {
+	if (field_symbol == LOCATION_SYMBOL) {
 		vertex translation;
 		int column, row, level;
 
@@ -2493,17 +2845,17 @@ player_simkin_object::getValue(const skString& field, const skString& attribute,
 
 		// Now return the desired value.
 
-		if (attribute == "column")
+		if (attribute_symbol == COLUMN_SYMBOL)
 			value = column + 1;
-		else if (attribute == "row")
+		else if (attribute_symbol == ROW_SYMBOL)
 			value = row + 1;
-		else if (attribute == "level")
+		else if (attribute_symbol == LEVEL_SYMBOL)
 			value = level + 1;
-		else if (attribute == "x")
+		else if (attribute_symbol == X_SYMBOL)
 			value = player_viewpoint.position.x * texels_per_unit;
-		else if (attribute == "y")
+		else if (attribute_symbol == Y_SYMBOL)
 			value = player_viewpoint.position.y * texels_per_unit;
-		else if (attribute == "z")
+		else if (attribute_symbol == Z_SYMBOL)
 			value = player_viewpoint.position.z * texels_per_unit;
 		else
 			return(false);
@@ -2512,10 +2864,10 @@ player_simkin_object::getValue(const skString& field, const skString& attribute,
 	// If the field is "orientation" and the attribute is "turn_angle" or
 	// "look_angle", return the angle around the appropiate axis.
 
-	else if (field == "orientation") {
-		if (attribute == "look_angle")
+	else if (field_symbol == ORIENTATION_SYMBOL) {
+		if (attribute_symbol == LOOK_ANGLE_SYMBOL)
 			value = player_viewpoint.look_angle;
-		else if (attribute == "turn_angle")
+		else if (attribute_symbol == TURN_ANGLE_SYMBOL)
 			value = player_viewpoint.turn_angle;
 		else
 			return(false);
@@ -2524,12 +2876,12 @@ player_simkin_object::getValue(const skString& field, const skString& attribute,
 	// If the field is "camera" and the attribute is "x", "y" or "z",
 	// return the appropiate camera offset.
 
-	else if (field == "camera") {
-		if (attribute == "x")
+	else if (field_symbol == CAMERA_SYMBOL) {
+		if (attribute_symbol == X_SYMBOL)
 			value = player_camera_offset.dx * texels_per_unit;
-		else if (attribute == "y")
+		else if (attribute_symbol == Y_SYMBOL)
 			value = player_camera_offset.dy * texels_per_unit;
-		else if (attribute == "z")
+		else if (attribute_symbol == Z_SYMBOL)
 			value = player_camera_offset.dz * texels_per_unit;
 		else
 			return(false);
@@ -2538,12 +2890,12 @@ player_simkin_object::getValue(const skString& field, const skString& attribute,
 	// If the field is "camera" and the attribute is "x", "y" or "z",
 	// return the appropiate camera offset.
 
-	else if (field == "camera") {
-		if (attribute == "x")
+	else if (field_symbol == CAMERA_SYMBOL) {
+		if (attribute_symbol == X_SYMBOL)
 			value = player_camera_offset.dx * texels_per_unit;
-		else if (attribute == "y")
+		else if (attribute_symbol == Y_SYMBOL)
 			value = player_camera_offset.dy * texels_per_unit;
-		else if (attribute == "z")
+		else if (attribute_symbol == Z_SYMBOL)
 			value = player_camera_offset.dz * texels_per_unit;
 		else
 			return(false);
@@ -2552,12 +2904,12 @@ player_simkin_object::getValue(const skString& field, const skString& attribute,
 	// If the field is "size" and the attribute is "x", "y" or "z",
 	// return the appropiate player dimension.
 
-	else if (field == "size") {
-		if (attribute == "x")
+	else if (field_symbol == SIZE_SYMBOL) {
+		if (attribute_symbol == X_SYMBOL)
 			value = player_dimensions.x * texels_per_unit;
-		else if (attribute == "y")
+		else if (attribute_symbol == Y_SYMBOL)
 			value = player_dimensions.y * texels_per_unit;
-		else if (attribute == "z")
+		else if (attribute_symbol == Z_SYMBOL)
 			value = player_dimensions.z * texels_per_unit;
 		else
 			return(false);
@@ -2573,17 +2925,20 @@ player_simkin_object::getValue(const skString& field, const skString& attribute,
 bool 
 player_simkin_object::setValue(const skString& field, const skString& attribute, const skRValue& value)
 {
+	int field_symbol = field.symbol();
+	int attribute_symbol = attribute.symbol();
+
 	// If the field is "location", the attribute is "x", "y" or "z", and the
 	// block is movable, set the approapiate coordinate of the player.
 
-	if (field == "location") {
-		if (attribute == "x")
+	if (field_symbol == LOCATION_SYMBOL) {
+		if (attribute_symbol == X_SYMBOL)
 			player_viewpoint.position.x = value.floatValue() / 
 				texels_per_unit;
-		else if (attribute == "y")
+		else if (attribute_symbol == Y_SYMBOL)
 			player_viewpoint.position.y = value.floatValue() / 
 				texels_per_unit;
-		else if (attribute == "z")
+		else if (attribute_symbol == Z_SYMBOL)
 			player_viewpoint.position.z = value.floatValue() / 
 				texels_per_unit;
 		else
@@ -2593,13 +2948,13 @@ player_simkin_object::setValue(const skString& field, const skString& attribute,
 	// If the field is "orientation", and the attribute is "look_angle" or
 	// "turn_angle" set the appropiate angle of the player.
 
-	else if (field == "orientation") {
+	else if (field_symbol == ORIENTATION_SYMBOL) {
 
 		// Set the new orientation angle.
 
-		if (attribute == "look_angle")
+		if (attribute_symbol == LOOK_ANGLE_SYMBOL)
 			player_viewpoint.look_angle = neg_adjust_angle(value.floatValue());
-		else if (attribute == "turn_angle")
+		else if (attribute_symbol == TURN_ANGLE_SYMBOL)
 			player_viewpoint.turn_angle = pos_adjust_angle(value.floatValue());
 		else
 			return(false);
@@ -2608,12 +2963,12 @@ player_simkin_object::setValue(const skString& field, const skString& attribute,
 	// If the field is "camera" and the attribute is "x", "y" or "z",
 	// set the appropiate camera offset.
 
-	else if (field == "camera") {
-		if (attribute == "x")
+	else if (field_symbol == CAMERA_SYMBOL) {
+		if (attribute_symbol == X_SYMBOL)
 			player_camera_offset.dx = value.floatValue() / texels_per_unit;
-		else if (attribute == "y")
+		else if (attribute_symbol == Y_SYMBOL)
 			player_camera_offset.dy = value.floatValue() / texels_per_unit;
-		else if (attribute == "z")
+		else if (attribute_symbol == Z_SYMBOL)
 			player_camera_offset.dz = value.floatValue() / texels_per_unit;
 		else
 			return(false);
@@ -2622,12 +2977,12 @@ player_simkin_object::setValue(const skString& field, const skString& attribute,
 	// If the field is "size", the player does not have a block, and the
 	// attribute is "x", "y" or "z", set the appropiate player dimension.
 
-	else if (field == "size" && player_block_ptr == NULL) {
-		if (attribute == "x")
+	else if (field_symbol == SIZE_SYMBOL && player_block_ptr == NULL) {
+		if (attribute_symbol == X_SYMBOL)
 			player_dimensions.x = value.floatValue() / texels_per_unit;
-		else if (attribute == "y")
+		else if (attribute_symbol == Y_SYMBOL)
 			player_dimensions.y = value.floatValue() / texels_per_unit;
-		else if (attribute == "z")
+		else if (attribute_symbol == Z_SYMBOL)
 			player_dimensions.z = value.floatValue() / texels_per_unit;
 		else
 			return(false);
@@ -2662,35 +3017,69 @@ public:
 	void breakpoint(const skStackFrame *stack_frame);
 };
 
-// Handle pausing or terminating the script being executed.
+// Handle pausing or terminating the script being executed.  This is called
+// once every statements_per_check statements rather than after every statement,
+// and the number of statements is calibrated so that the clock is checked
+// roughly every SCRIPT_CHECK_INTERVAL_MS.  The calibration needs a clock with
+// millisecond resolution, so it uses get_real_time_ms(), which is based on the
+// performance counter on Windows and on the steady clock elsewhere.
 
 bool
 statement_stepper::handle_pause_or_termination(void)
 {
-	// If the script has been running for at least 10 ms, then wait until a
-	// RESUME_SCRIPT, TERMINATE_SCRIPT or TERMINATE_SIMKIN command is sent.
-	
-	int curr_time_ms = get_time_ms();
-	if (curr_time_ms >= script_resume_time_ms + 10) {
-		command_completed.send_event(false);
-		perform_command.wait_for_event();
-		if (command_code == TERMINATE_SCRIPT || 
-			command_code == TERMINATE_SIMKIN)
-			return(false);
-		script_resume_time_ms = get_time_ms();
-	}
+	script_thread *script_thread_ptr = curr_script_thread_ptr;
+	int curr_time_ms, elapsed_time_ms;
 
 	// If a TERMINATE_SCRIPT or TERMINATE_SIMKIN command was sent, then
-	// stop executing this script.
+	// receive it and stop executing this script.
 
-	else if (perform_command.event_sent()) {
-		switch (command_code) {
+	if (script_thread_ptr->termination_requested) {
+		script_thread_ptr->perform_command.wait_for_event();
+		script_thread_ptr->termination_requested = false;
+		if (script_thread_ptr->command_code == TERMINATE_SIMKIN)
+			script_thread_ptr->running = false;
+		return(false);
+	}
+
+	// If the script has used up its time slice, then wait until a
+	// RESUME_SCRIPT, TERMINATE_SCRIPT or TERMINATE_SIMKIN command is sent.
+	
+	curr_time_ms = get_real_time_ms();
+	if (curr_time_ms >= script_thread_ptr->resume_time_ms + 
+		script_thread_ptr->time_slice_ms) {
+		script_thread_ptr->command_completed.send_event(false);
+		script_thread_ptr->perform_command.wait_for_event();
+		script_thread_ptr->termination_requested = false;
+		switch (script_thread_ptr->command_code) {
 		case TERMINATE_SIMKIN:
-			running = false;
+			script_thread_ptr->running = false;
+			// fall through
 		case TERMINATE_SCRIPT:
 			return(false);
 		}
+		script_thread_ptr->resume_time_ms = get_real_time_ms();
+		script_thread_ptr->check_time_ms = script_thread_ptr->resume_time_ms;
+		return(true);
+	}
+
+	// Double the number of statements per check if the clock hasn't moved
+	// since the last check.  If more time than the check interval has passed,
+	// use the measured time per statement to scale the number of statements
+	// down to what fits in the check interval, so that a run of slow
+	// statements is caught at the next check rather than after several.
+
+	elapsed_time_ms = curr_time_ms - script_thread_ptr->check_time_ms;
+	if (elapsed_time_ms == 0) {
+		if (statements_per_check < MAX_STATEMENTS_PER_CHECK)
+			statements_per_check *= 2;
+	} else if (elapsed_time_ms > SCRIPT_CHECK_INTERVAL_MS) {
+		statements_per_check = statements_per_check * 
+			SCRIPT_CHECK_INTERVAL_MS / elapsed_time_ms;
+		if (statements_per_check < 1)
+			statements_per_check = 1;
 	}
+	script_thread_ptr->check_time_ms = curr_time_ms;
+	simkin_interpreter_ptr->setStatementStepperInterval(statements_per_check);
 
 	// Continue execution of the script.
 
@@ -2750,7 +3139,7 @@ static player_simkin_object *player_simkin_object_ptr;
 //------------------------------------------------------------------------------
 
 static void
-perform_script_execution(void)
+perform_script_execution(script_thread *script_thread_ptr)
 {
 	skMethodDefNode *script_simkin_object_ptr;
 	skRValueArray args;
@@ -2758,14 +3147,20 @@ perform_script_execution(void)
 
 	try {
 
-		// If the script definition has not yet be parsed, do so now.
-
-		if (simkin_script_def_ptr->script_simkin_object_ptr == NULL)
-			simkin_script_def_ptr->script_simkin_object_ptr =
-				simkin_interpreter_ptr->parseString("block", 
-					(char *)simkin_script_def_ptr->script, *simkin_context_ptr);
+		// If the script definition has not yet be parsed, do so now.  The
+		// parse tree is shared with every other script definition with the
+		// same text, and belongs to the interpreter.
+
+		script_def *script_def_ptr = script_thread_ptr->script_def_ptr;
+		if (script_def_ptr->script_simkin_object_ptr == NULL) {
+			skStringList param_names;
+			script_def_ptr->script_simkin_object_ptr =
+				simkin_interpreter_ptr->parseSharedExternalParams("block",
+					param_names, (char *)script_def_ptr->script,
+					*script_thread_ptr->context_ptr);
+		}
 		script_simkin_object_ptr = 
-			(skMethodDefNode *)simkin_script_def_ptr->script_simkin_object_ptr;
+			(skMethodDefNode *)script_def_ptr->script_simkin_object_ptr;
 
 		// Now execute the script, using either the block or the spot object
 		// as the target.  In the case of a block being the target, references 
@@ -2773,18 +3168,18 @@ perform_script_execution(void)
 		// the block is removed from the map during script execution.  The
 		// references will be automatically disposed of after script execution.
 
-		if (simkin_block_ptr != NULL) {
+		if (script_thread_ptr->block_ptr != NULL) {
 			skRValue block_simkin_value =
-				get_block_simkin_object(simkin_block_ptr);
+				get_block_simkin_object(script_thread_ptr->block_ptr);
 			skRValue vertex_simkin_value =
-				get_vertex_simkin_object(simkin_block_ptr);
+				get_vertex_simkin_object(script_thread_ptr->block_ptr);
 			simkin_interpreter_ptr->executeParseTree("block", 
 				block_simkin_value.obj(), script_simkin_object_ptr, args, 
-				return_value, *simkin_context_ptr);
+				return_value, *script_thread_ptr->context_ptr);
 		} else {
 			simkin_interpreter_ptr->executeParseTree("spot", 
 				spot_simkin_object_ptr, script_simkin_object_ptr, args, 
-				return_value, *simkin_context_ptr);
+				return_value, *script_thread_ptr->context_ptr);
 		}
 	}
 	catch (skRuntimeException e) {
@@ -2808,13 +3203,14 @@ perform_script_execution(void)
 //------------------------------------------------------------------------------
 
 static void
-perform_method_call(void)
+perform_method_call(script_thread *script_thread_ptr)
 {
 	skRValueArray args;
 	skRValue return_value;
 
 	try {
-		spot_simkin_object_ptr->method(simkin_method_name, args, return_value, *simkin_context_ptr);
+		spot_simkin_object_ptr->method(script_thread_ptr->method_name, args, 
+			return_value, *script_thread_ptr->context_ptr);
 	}
 	catch (skRuntimeException e) {
 		diagnose("%s", (const char *)e.toString());
@@ -2832,107 +3228,553 @@ perform_method_call(void)
 	}
 }
 
+#ifndef EXECUTE_PARSENODES
+
 //------------------------------------------------------------------------------
-// Simkin thread.
+// Compute the FNV-1a hash of a script cache key.
 //------------------------------------------------------------------------------
 
-static void
-simkin_thread(void *arg_list)
+static unsigned int
+hash_script_cache_key(const skString &key)
 {
-	// Initialise all global variables.
+	const unsigned char *byte_ptr;
+	unsigned int hash, bytes, index;
+
+	byte_ptr = (const unsigned char *)key.c_str();
+	bytes = key.length() * sizeof(Char);
+	hash = 2166136261U;
+	for (index = 0; index < bytes; index++) {
+		hash ^= byte_ptr[index];
+		hash *= 16777619U;
+	}
+	return(hash);
+}
 
-	simkin_interpreter_ptr = NULL;
-	spot_simkin_object_ptr = NULL;
-	math_simkin_object_ptr = NULL;
-	sky_simkin_object_ptr = NULL;
-	ambient_light_simkin_object_ptr = NULL;
-	ambient_sound_simkin_object_ptr = NULL;
-	orb_simkin_object_ptr = NULL;
-	fog_simkin_object_ptr = NULL;
-	map_simkin_object_ptr = NULL;
-	player_simkin_object_ptr = NULL;
+//------------------------------------------------------------------------------
+// Functions to write an integer or a string to the script cache file.
+//------------------------------------------------------------------------------
 
-	// The rest of the initialisation needs to occur in a try block.
+static bool
+write_script_cache_int(FILE *fp, int value)
+{
+	return(fwrite(&value, sizeof(int), 1, fp) == 1);
+}
 
-	try {
+static bool
+write_script_cache_string(FILE *fp, const skString &value)
+{
+	int length = value.length();
 
-		// Create and the interpreter.
+	return(write_script_cache_int(fp, length) && (length == 0 ||
+		fwrite(value.c_str(), sizeof(Char), length, fp) == (size_t)length));
+}
 
-		if ((simkin_interpreter_ptr = new skInterpreter) == NULL)
-			throw false;
+//------------------------------------------------------------------------------
+// Functions to read an integer or a string from the script cache file.
+//------------------------------------------------------------------------------
 
-		// Create the context.
+static bool
+read_script_cache_int(FILE *fp, int &value)
+{
+	return(fread(&value, sizeof(int), 1, fp) == 1);
+}
 
-		if ((simkin_context_ptr = new skExecutableContext(simkin_interpreter_ptr)) == NULL)
-			throw false;
+static bool
+read_script_cache_string(FILE *fp, skString &value)
+{
+	Char *buffer;
+	int length;
+	bool success;
 
-		// Create a statement stepper and associate it with the interpreter.
+	if (!read_script_cache_int(fp, length) || length < 0)
+		return(false);
+	if (length == 0) {
+		value = skString();
+		return(true);
+	}
+	NEWARRAY(buffer, Char, length);
+	if (buffer == NULL)
+		return(false);
+	success = fread(buffer, sizeof(Char), length, fp) == (size_t)length;
+	if (success)
+		value = skString(buffer, length);
+	DELARRAY(buffer, Char, length);
+	return(success);
+}
 
-		if ((statement_stepper_ptr = new statement_stepper) == NULL)
-			throw false;
-		simkin_interpreter_ptr->setStatementStepper(statement_stepper_ptr);
-
-		// Create the pre-defined SimKin objects.
-
-		NEW_SIMKIN_OBJECT(spot_simkin_object_ptr, spot_simkin_object, "spot");
-		NEW_SIMKIN_OBJECT(math_simkin_object_ptr, math_simkin_object, "math");
-		NEW_SIMKIN_OBJECT(sky_simkin_object_ptr, sky_simkin_object, "sky");
-		NEW_SIMKIN_OBJECT(ambient_light_simkin_object_ptr, 
-			ambient_light_simkin_object, "ambient_light");
-		NEW_SIMKIN_OBJECT(ambient_sound_simkin_object_ptr,
-			ambient_sound_simkin_object, "ambient_sound");
-		NEW_SIMKIN_OBJECT(orb_simkin_object_ptr, orb_simkin_object, "orb");
-		NEW_SIMKIN_OBJECT(fog_simkin_object_ptr, fog_simkin_object, "fog");
-		NEW_SIMKIN_OBJECT(map_simkin_object_ptr, map_simkin_object, "map");
-		NEW_SIMKIN_OBJECT(player_simkin_object_ptr, player_simkin_object, 
-			"player");
+//------------------------------------------------------------------------------
+// Write a compiled script and its key to the script cache file.
+//------------------------------------------------------------------------------
 
-		// Signal the player thread that initialisation was successful.
+static bool
+write_cached_script(FILE *fp, const skString &key, skMethodDefNode *script_ptr)
+{
+	skIdListNode *params_ptr;
+	int index, count;
+
+	// Write the hash and the key.
+
+	if (!write_script_cache_int(fp, hash_script_cache_key(key)) ||
+		!write_script_cache_string(fp, key))
+		return(false);
+
+	// Write the identifier indices of the parameters, or -1 if there is no
+	// parameter list.
 
-		simkin_thread_initialised.send_event(true);
+	skCompiledCode &code = script_ptr->getCompiledCode();
+	params_ptr = script_ptr->getParams();
+	count = params_ptr != NULL ? params_ptr->numIds() : -1;
+	if (!write_script_cache_int(fp, count))
+		return(false);
+	for (index = 0; index < count; index++)
+		if (!write_script_cache_int(fp, params_ptr->getId(index)->getId()))
+			return(false);
+
+	// Write the byte code, followed by the identifiers and literals it
+	// refers to.
+
+	count = code.getPC();
+	if (!write_script_cache_int(fp, count))
+		return(false);
+	for (index = 0; index < count; index++)
+		if (!write_script_cache_int(fp, code.getInstructionWord(index)))
+			return(false);
+	count = code.numIds();
+	if (!write_script_cache_int(fp, count))
+		return(false);
+	for (index = 0; index < count; index++)
+		if (!write_script_cache_string(fp, code.getId(index)))
+			return(false);
+	count = code.numStrings();
+	if (!write_script_cache_int(fp, count))
+		return(false);
+	for (index = 0; index < count; index++)
+		if (!write_script_cache_string(fp, code.getString(index)))
+			return(false);
+	count = code.numInts();
+	if (!write_script_cache_int(fp, count))
+		return(false);
+	for (index = 0; index < count; index++)
+		if (!write_script_cache_int(fp, code.getInt(index)))
+			return(false);
+	count = code.numFloats();
+	if (!write_script_cache_int(fp, count))
+		return(false);
+	for (index = 0; index < count; index++) {
+		float value = code.getFloat(index);
+		if (fwrite(&value, sizeof(float), 1, fp) != 1)
+			return(false);
 	}
+	return(true);
+}
 
-	// On any caught error, signal the player thread that initialisation was
-	// unsuccessful, and terminate the thread.
+//------------------------------------------------------------------------------
+// Read the parameters and compiled code of a script from the script cache file.
+//------------------------------------------------------------------------------
 
-	catch (...) {
-		simkin_thread_initialised.send_event(false);
-		return;
+static bool
+read_cached_script_code(FILE *fp, skMethodDefNode *script_ptr)
+{
+	skIdListNode *params_ptr;
+	skStringList identifiers;
+	skString value;
+	int index, count, int_value;
+	float float_value;
+
+	// Read the identifier indices of the parameters.
+
+	if (!read_script_cache_int(fp, count))
+		return(false);
+	if (count >= 0) {
+		if ((params_ptr = new skIdListNode(0)) == NULL)
+			return(false);
+		script_ptr->setParams(params_ptr);
+		for (index = 0; index < count; index++) {
+			if (!read_script_cache_int(fp, int_value))
+				return(false);
+			params_ptr->addId(new skIdNode(0, int_value, NULL, NULL));
+		}
 	}
 
-	// Loop until a request to terminate the thread has been recieved.
+	// Read the byte code, followed by the identifiers and literals it refers
+	// to.  The identifiers are moved into the compiled code as a list, so
+	// that they keep the indices the byte code refers to them by.
+
+	skCompiledCode &code = script_ptr->getCompiledCode();
+	if (!read_script_cache_int(fp, count))
+		return(false);
+	for (index = 0; index < count; index++) {
+		if (!read_script_cache_int(fp, int_value))
+			return(false);
+		code.addInstructionWord((USize)int_value);
+	}
+	if (!read_script_cache_int(fp, count))
+		return(false);
+	for (index = 0; index < count; index++) {
+		if (!read_script_cache_string(fp, value))
+			return(false);
+		identifiers.append(value);
+		value.symbol();
+	}
+	code.moveIdentifiers(identifiers);
+	if (!read_script_cache_int(fp, count))
+		return(false);
+	for (index = 0; index < count; index++) {
+		if (!read_script_cache_string(fp, value))
+			return(false);
+		code.addString(value);
+	}
+	if (!read_script_cache_int(fp, count))
+		return(false);
+	for (index = 0; index < count; index++) {
+		if (!read_script_cache_int(fp, int_value))
+			return(false);
+		code.addInt(int_value);
+	}
+	if (!read_script_cache_int(fp, count))
+		return(false);
+	for (index = 0; index < count; index++) {
+		if (fread(&float_value, sizeof(float), 1, fp) != 1)
+			return(false);
+		code.addFloat(float_value);
+	}
+	return(true);
+}
 
-	running = true;
-	while (running) {
+//------------------------------------------------------------------------------
+// Verify that the parameters and byte code of a script read from the script
+// cache file only refer to identifiers, literals and byte codes that exist, so
+// that a corrupted entry can't make the interpreter read outside of them.
+//------------------------------------------------------------------------------
 
-		// Wait for the next command request.  This ensures that this
-		// thread is not using up valuable CPU time while it has nothing
-		// to do.
+static bool
+valid_cached_script_code(skMethodDefNode *script_ptr)
+{
+	skIdListNode *params_ptr;
+	skCompiledCode::skInstruction instruction;
+	int ids, strings, ints, floats;
+	int index, count, param1, param2;
+
+	skCompiledCode &code = script_ptr->getCompiledCode();
+	ids = code.numIds();
+	strings = code.numStrings();
+	ints = code.numInts();
+	floats = code.numFloats();
+
+	// Check the identifier indices of the parameters.
+
+	params_ptr = script_ptr->getParams();
+	count = params_ptr != NULL ? params_ptr->numIds() : 0;
+	for (index = 0; index < count; index++) {
+		param1 = params_ptr->getId(index)->getId();
+		if (param1 < 0 || param1 >= ids)
+			return(false);
+	}
 
-		perform_command.wait_for_event();
+	// Check each instruction: its byte code, any identifier or literal index
+	// it has, and any count of instructions it skips over, which is held in
+	// the word that follows the instruction.
 
-		// Perform the command.
-			
-		switch (command_code) {
-		case EXECUTE_SCRIPT:
-			script_start_time_ms = get_time_ms();
-			script_resume_time_ms = script_start_time_ms;
-			perform_script_execution();
+	count = code.getPC();
+	for (index = 0; index < count; index++) {
+		if ((code.getInstructionWord(index) >> 24) >= skCompiledCode::b_NUMCODES)
+			return(false);
+		code.getInstruction(index, instruction, param1, param2);
+		switch (instruction) {
+		case skCompiledCode::b_ForEach:
+		case skCompiledCode::b_Id:
+		case skCompiledCode::b_IdWithMethod:
+			if (param1 != NOT_PRESENT_INDEX && param1 >= ids)
+				return(false);
 			break;
-		case CALL_GLOBAL_METHOD:
-			script_start_time_ms = get_time_ms();
-			script_resume_time_ms = script_start_time_ms;
-			perform_method_call();
+		case skCompiledCode::b_IdList:
+			if (param2 != NOT_PRESENT_INDEX && param2 >= ids)
+				return(false);
+			break;
+		case skCompiledCode::b_QualifierIndex:
+			if ((param1 != NOT_PRESENT_INDEX && param1 >= ids) ||
+				index + 1 >= count ||
+				code.getByteCount(index + 1) < 0 ||
+				index + 2 + code.getByteCount(index + 1) > count)
+				return(false);
+			index++;
+			break;
+		case skCompiledCode::b_String:
+			if (param1 != NOT_PRESENT_INDEX && param1 >= strings)
+				return(false);
+			break;
+		case skCompiledCode::b_Int:
+			if (param1 >= ints)
+				return(false);
+			break;
+		case skCompiledCode::b_Float:
+			if (param1 >= floats)
+				return(false);
+			break;
+		case skCompiledCode::b_StatList:
+		case skCompiledCode::b_StatsSize:
+		case skCompiledCode::b_CaseList:
+			if (index + 1 >= count ||
+				code.getByteCount(index + 1) < 0 ||
+				index + code.getByteCount(index + 1) > count)
+				return(false);
+			index++;
+			break;
+		default:
 			break;
-		case TERMINATE_SIMKIN:
-			running = false;
 		}
+	}
+	return(true);
+}
 
-		// Signal the player thread that the command was completed.
+//------------------------------------------------------------------------------
+// Read a compiled script and its key from the script cache file, and add it to
+// the interpreter's shared parse trees.
+//------------------------------------------------------------------------------
+
+static bool
+read_cached_script(FILE *fp, skInterpreter *interpreter_ptr)
+{
+	skMethodDefNode *script_ptr;
+	skString key;
+	int hash;
+
+	// Read the hash and the key, and verify that they match.
+
+	if (!read_script_cache_int(fp, hash) ||
+		!read_script_cache_string(fp, key) ||
+		(unsigned int)hash != hash_script_cache_key(key))
+		return(false);
+
+	// Create the script, which has no statements since only the compiled
+	// code is executed, then read its parameters and compiled code, and
+	// reject it if they aren't consistent.
+
+	if ((script_ptr = new skMethodDefNode(CACHED_SCRIPT_LINE_NO,
+		(skStatListNode *)NULL)) == NULL)
+		return(false);
+	if (!read_cached_script_code(fp, script_ptr) ||
+		!valid_cached_script_code(script_ptr)) {
+		delete script_ptr;
+		return(false);
+	}
+
+	// Hand the script over to the interpreter.
+
+	interpreter_ptr->addSharedParseTree(key, script_ptr);
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Read the compiled scripts in the given script cache file into the shared
+// parse trees of the given interpreter, if the file exists and was written by
+// the same version of the interpreter.  Returns the number of scripts read.
+//------------------------------------------------------------------------------
+
+int
+read_script_cache(skInterpreter *interpreter_ptr, const char *file_path)
+{
+	FILE *fp;
+	skString signature;
+	int version, codes, word_size, scripts, script_no;
+
+	// Open the cache file, and verify that the signature and version match,
+	// and that the byte code set and its encoding are unchanged.
+
+	if ((fp = fopen(file_path, "rb")) == NULL)
+		return(0);
+	if (!read_script_cache_string(fp, signature) ||
+		!(signature == SCRIPT_CACHE_SIGNATURE) ||
+		!read_script_cache_int(fp, version) ||
+		version != SCRIPT_CACHE_VERSION ||
+		!read_script_cache_int(fp, codes) ||
+		codes != skCompiledCode::b_NUMCODES ||
+		!read_script_cache_int(fp, word_size) ||
+		word_size != sizeof(USize) ||
+		!read_script_cache_int(fp, scripts) || scripts < 0) {
+		fclose(fp);
+		return(0);
+	}
+
+	// Read the scripts, stopping at the first one that is truncated or
+	// corrupted.
+
+	for (script_no = 0; script_no < scripts && script_no < MAX_CACHED_SCRIPTS;
+		script_no++) {
+		if (!read_cached_script(fp, interpreter_ptr)) {
+			diagnose("Script cache is corrupted; only %d of %d scripts loaded",
+				script_no, scripts);
+			break;
+		}
+	}
+	fclose(fp);
+	return(script_no);
+}
+
+//------------------------------------------------------------------------------
+// Write the shared parse trees of the given interpreter to the given script
+// cache file.  Scripts parsed during this session are written first, so that
+// they are kept if the cache is full.  If the cache could not be written in
+// full, it is removed so that a truncated cache isn't read next time.
+//------------------------------------------------------------------------------
+
+bool
+write_script_cache(skInterpreter *interpreter_ptr, const char *file_path)
+{
+	FILE *fp;
+	int scripts, pass;
+	bool success;
+
+	// Count the scripts.
+
+	const skMethodTable &script_table = interpreter_ptr->getSharedParseTrees();
+	skTSHashTableIterator<skMethodDefNode> count_iter(script_table);
+	scripts = 0;
+	while (count_iter())
+		scripts++;
+	if (scripts > MAX_CACHED_SCRIPTS)
+		scripts = MAX_CACHED_SCRIPTS;
+
+	// Write the header.
+
+	if ((fp = fopen(file_path, "wb")) == NULL)
+		return(false);
+	success = write_script_cache_string(fp, skString(SCRIPT_CACHE_SIGNATURE)) &&
+		write_script_cache_int(fp, SCRIPT_CACHE_VERSION) &&
+		write_script_cache_int(fp, skCompiledCode::b_NUMCODES) &&
+		write_script_cache_int(fp, sizeof(USize)) &&
+		write_script_cache_int(fp, scripts);
+
+	// Write the scripts parsed during this session on the first pass, and the
+	// scripts loaded from the cache on the second pass.
+
+	for (pass = 0; pass < 2 && success && scripts > 0; pass++) {
+		skTSHashTableIterator<skMethodDefNode> iter(script_table);
+		while (success && scripts > 0 && iter()) {
+			skMethodDefNode *script_ptr = iter.value();
+			if ((script_ptr->getLineNum() == CACHED_SCRIPT_LINE_NO) ==
+				(pass == 1)) {
+				success = write_cached_script(fp, iter.key(), script_ptr);
+				scripts--;
+			}
+		}
+	}
+	if (fclose(fp) != 0)
+		success = false;
+	if (!success)
+		remove(file_path);
+	return(success);
+}
+
+//------------------------------------------------------------------------------
+// Load the scripts compiled during previous sessions from the script cache
+// file in the Flatland directory.
+//------------------------------------------------------------------------------
+
+static void
+load_script_cache(void)
+{
+	string cache_file_path;
+
+	cache_file_path = flatland_dir + SCRIPT_CACHE_FILE_NAME;
+	cached_scripts = read_script_cache(simkin_interpreter_ptr, cache_file_path);
+}
+
+//------------------------------------------------------------------------------
+// Save the compiled scripts to the script cache file in the Flatland
+// directory, if any were parsed during this session.
+//------------------------------------------------------------------------------
+
+static void
+save_script_cache(void)
+{
+	string cache_file_path;
+	int scripts;
+
+	// Count the scripts, and if none were parsed during this session there is
+	// no need to save the cache.
+
+	if (simkin_interpreter_ptr == NULL)
+		return;
+	skTSHashTableIterator<skMethodDefNode>
+		iter(simkin_interpreter_ptr->getSharedParseTrees());
+	scripts = 0;
+	while (iter())
+		scripts++;
+	if (scripts == cached_scripts)
+		return;
+	cached_scripts = scripts;
+
+	// Write the cache.
+
+	cache_file_path = flatland_dir + SCRIPT_CACHE_FILE_NAME;
+	if (!write_script_cache(simkin_interpreter_ptr, cache_file_path))
+		diagnose("Unable to write script cache to %s", (char *)cache_file_path);
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+// Create the SimKin interpreter, the statement stepper and the pre-defined
+// SimKin objects.  This is done by the first script thread.
+//------------------------------------------------------------------------------
 
-		command_completed.send_event(true);
+static void
+create_simkin_interpreter(void)
+{
+	// Create the interpreter.
+
+	if ((simkin_interpreter_ptr = new skInterpreter) == NULL)
+		throw false;
+
+	// Create a statement stepper and associate it with the interpreter.
+
+	if ((statement_stepper_ptr = new statement_stepper) == NULL)
+		throw false;
+	simkin_interpreter_ptr->setStatementStepper(statement_stepper_ptr);
+	statements_per_check = 1;
+	simkin_interpreter_ptr->setStatementStepperInterval(statements_per_check);
+
+	// Have scripts and block methods with the same text share one parse tree.
+	// Give the interpreter the parse trees kept from the previous spot, or if
+	// this is the first spot, load the scripts compiled during previous
+	// sessions.
+
+	simkin_interpreter_ptr->setShareParseTrees(true);
+	if (shared_script_table_ptr != NULL) {
+		simkin_interpreter_ptr->adoptSharedParseTrees(shared_script_table_ptr);
+		shared_script_table_ptr = NULL;
 	}
+#ifndef EXECUTE_PARSENODES
+	else
+		load_script_cache();
+#endif
+
+	// Create the pre-defined SimKin objects.
+
+	NEW_SIMKIN_OBJECT(spot_simkin_object_ptr, spot_simkin_object, "spot");
+	NEW_SIMKIN_OBJECT(math_simkin_object_ptr, math_simkin_object, "math");
+	NEW_SIMKIN_OBJECT(sky_simkin_object_ptr, sky_simkin_object, "sky");
+	NEW_SIMKIN_OBJECT(ambient_light_simkin_object_ptr, 
+		ambient_light_simkin_object, "ambient_light");
+	NEW_SIMKIN_OBJECT(ambient_sound_simkin_object_ptr,
+		ambient_sound_simkin_object, "ambient_sound");
+	NEW_SIMKIN_OBJECT(orb_simkin_object_ptr, orb_simkin_object, "orb");
+	NEW_SIMKIN_OBJECT(fog_simkin_object_ptr, fog_simkin_object, "fog");
+	NEW_SIMKIN_OBJECT(map_simkin_object_ptr, map_simkin_object, "map");
+	NEW_SIMKIN_OBJECT(player_simkin_object_ptr, player_simkin_object, 
+		"player");
+}
+
+//------------------------------------------------------------------------------
+// Delete the pre-defined SimKin objects, the statement stepper and the SimKin
+// interpreter.  This is done by the first script thread, after all the other
+// script threads have terminated.
+//------------------------------------------------------------------------------
 
+static void
+delete_simkin_interpreter(void)
+{
 	// Delete the pre-defined SimKin objects.
 
 	if (spot_simkin_object_ptr != NULL)
@@ -2959,12 +3801,117 @@ simkin_thread(void *arg_list)
 	simkin_interpreter_ptr->setStatementStepper(NULL);
 	delete statement_stepper_ptr;
 
-	// Delete the global context and interpreter.
+	// Keep the shared parse trees for the next spot, then delete the
+	// interpreter.
 
-	delete simkin_context_ptr;
+	shared_script_table_ptr = simkin_interpreter_ptr->releaseSharedParseTrees();
 	delete simkin_interpreter_ptr;
 }
 
+//------------------------------------------------------------------------------
+// Script thread.
+//------------------------------------------------------------------------------
+
+static void
+simkin_thread(void *arg_list)
+{
+	script_thread *script_thread_ptr = (script_thread *)arg_list;
+	bool first_script_thread = script_thread_ptr == script_thread_list;
+
+	// Remember which script thread this is, for the statement stepper.
+
+	curr_script_thread_ptr = script_thread_ptr;
+	script_thread_ptr->context_ptr = NULL;
+
+	// The rest of the initialisation needs to occur in a try block.
+
+	try {
+
+		// If this is the first script thread, create the interpreter and the
+		// pre-defined SimKin objects.
+
+		if (first_script_thread)
+			create_simkin_interpreter();
+
+		// Create the context, which holds the stack of the script being
+		// executed by this thread.
+
+		if ((script_thread_ptr->context_ptr = 
+			new skExecutableContext(simkin_interpreter_ptr)) == NULL)
+			throw false;
+		if (first_script_thread)
+			simkin_context_ptr = script_thread_ptr->context_ptr;
+
+		// Signal the player thread that initialisation was successful.
+
+		script_thread_initialised.send_event(true);
+	}
+
+	// On any caught error, signal the player thread that initialisation was
+	// unsuccessful, and terminate the thread.
+
+	catch (...) {
+		script_thread_initialised.send_event(false);
+		return;
+	}
+
+	// Loop until a request to terminate the thread has been recieved.
+
+	script_thread_ptr->running = true;
+	while (script_thread_ptr->running) {
+
+		// Wait for the next command request.  This ensures that this
+		// thread is not using up valuable CPU time while it has nothing
+		// to do.
+
+		script_thread_ptr->perform_command.wait_for_event();
+		script_thread_ptr->termination_requested = false;
+
+		// Perform the command.
+			
+		switch (script_thread_ptr->command_code) {
+		case EXECUTE_SCRIPT:
+			script_thread_ptr->resume_time_ms = get_real_time_ms();
+			script_thread_ptr->check_time_ms = script_thread_ptr->resume_time_ms;
+			perform_script_execution(script_thread_ptr);
+			break;
+		case CALL_GLOBAL_METHOD:
+			script_thread_ptr->resume_time_ms = get_real_time_ms();
+			script_thread_ptr->check_time_ms = script_thread_ptr->resume_time_ms;
+			perform_method_call(script_thread_ptr);
+			break;
+		case TERMINATE_SIMKIN:
+			script_thread_ptr->running = false;
+		}
+
+		// Signal the player thread that the command was completed.
+
+		script_thread_ptr->command_completed.send_event(true);
+	}
+
+	// Delete the context, and if this is the first script thread, the
+	// interpreter and the pre-defined SimKin objects.
+
+	delete script_thread_ptr->context_ptr;
+	if (first_script_thread)
+		delete_simkin_interpreter();
+}
+
+//------------------------------------------------------------------------------
+// Send a command to a script thread, and wait for it to complete or for the
+// script to be paused.  Returns TRUE if the script was paused.
+//------------------------------------------------------------------------------
+
+static bool
+send_script_command(script_thread *script_thread_ptr, int command_code)
+{
+	script_thread_ptr->command_code = command_code;
+	if (command_code == TERMINATE_SCRIPT || command_code == TERMINATE_SIMKIN)
+		script_thread_ptr->termination_requested = true;
+	script_thread_ptr->perform_command.send_event(true);
+	return(!script_thread_ptr->command_completed.wait_for_event());
+}
+
 //------------------------------------------------------------------------------
 // Start up SimKin.
 //------------------------------------------------------------------------------
@@ -2972,23 +3919,61 @@ simkin_thread(void *arg_list)
 bool
 start_up_simkin(void)
 {
+	script_thread *script_thread_ptr;
+	int symbol, script_thread_no;
+
+	// Register the symbols recognised by the SimKin objects.
+
+	for (symbol = 1; symbol < SIMKIN_SYMBOLS; symbol++)
+		skString::addSymbol(simkin_symbol_name_list[symbol], symbol);
+
 	// Initialise the script definition list.
 
 	script_def_list = NULL;
 	curr_script_def_ID = 0;
 
-	// Create the events used to communicate between the player and SimKin
-	// threads.
+	// Initialise the global variables.
 
-	simkin_thread_initialised.create_event();
-	perform_command.create_event();
-	command_completed.create_event();
-	
-	// Start the SimKin thread, and wait for it to send an event indicating
-	// whether it initialised or not.
+	simkin_interpreter_ptr = NULL;
+	simkin_context_ptr = NULL;
+	spot_simkin_object_ptr = NULL;
+	math_simkin_object_ptr = NULL;
+	sky_simkin_object_ptr = NULL;
+	ambient_light_simkin_object_ptr = NULL;
+	ambient_sound_simkin_object_ptr = NULL;
+	orb_simkin_object_ptr = NULL;
+	fog_simkin_object_ptr = NULL;
+	map_simkin_object_ptr = NULL;
+	player_simkin_object_ptr = NULL;
+
+	// Create the event used to signal that a script thread has initialised.
+
+	script_thread_initialised.create_event();
 
-	return((simkin_thread_handle = start_thread(simkin_thread)) > 0 &&
-		simkin_thread_initialised.wait_for_event());
+	// Start the script threads one at a time, waiting for each to send an
+	// event indicating whether it initialised or not.  The first script
+	// thread creates the interpreter used by the others.
+
+	for (script_thread_no = 0; script_thread_no < SCRIPT_THREADS; 
+		script_thread_no++) {
+		script_thread_ptr = &script_thread_list[script_thread_no];
+		script_thread_ptr->thread_handle = 0;
+		script_thread_ptr->termination_requested = false;
+		script_thread_ptr->perform_command.create_event();
+		script_thread_ptr->command_completed.create_event();
+	}
+	for (script_thread_no = 0; script_thread_no < SCRIPT_THREADS; 
+		script_thread_no++) {
+		script_thread_ptr = &script_thread_list[script_thread_no];
+		if ((script_thread_ptr->thread_handle = start_thread(simkin_thread,
+			script_thread_ptr)) == 0)
+			return(false);
+		if (!script_thread_initialised.wait_for_event()) {
+			script_thread_ptr->thread_handle = 0;
+			return(false);
+		}
+	}
+	return(true);
 }
 
 //------------------------------------------------------------------------------
@@ -2998,32 +3983,68 @@ start_up_simkin(void)
 void
 shut_down_simkin(void)
 {
+	script_thread *script_thread_ptr;
 	script_def *next_script_def_ptr;
-
-	// Send the simkin thread a request to terminate, then wait for it to
-	// do so.
-
-	if (simkin_thread_handle >= 0) {
-		command_code = TERMINATE_SIMKIN;
-		perform_command.send_event(true);
-		wait_for_thread_termination(simkin_thread_handle);
+	int script_thread_no;
+
+	// Save the compiled scripts while the interpreter still exists.
+
+#ifndef EXECUTE_PARSENODES
+	save_script_cache();
+#endif
+
+	// Send each script thread a request to terminate, then wait for it to
+	// do so.  The first script thread is terminated last, since it deletes
+	// the interpreter.
+
+	for (script_thread_no = SCRIPT_THREADS - 1; script_thread_no >= 0; 
+		script_thread_no--) {
+		script_thread_ptr = &script_thread_list[script_thread_no];
+		if (script_thread_ptr->thread_handle != 0) {
+			script_thread_ptr->command_code = TERMINATE_SIMKIN;
+			script_thread_ptr->termination_requested = true;
+			script_thread_ptr->perform_command.send_event(true);
+			wait_for_thread_termination(script_thread_ptr->thread_handle);
+			script_thread_ptr->thread_handle = 0;
+		}
 	}
 
-	// Destroy the events used to communicate with the simkin thread.
+	// Destroy the events used to communicate with the script threads.
 
-	simkin_thread_initialised.destroy_event();
-	perform_command.destroy_event();
-	command_completed.destroy_event();
+	script_thread_initialised.destroy_event();
+	for (script_thread_no = 0; script_thread_no < SCRIPT_THREADS; 
+		script_thread_no++) {
+		script_thread_ptr = &script_thread_list[script_thread_no];
+		script_thread_ptr->perform_command.destroy_event();
+		script_thread_ptr->command_completed.destroy_event();
+	}
 
 	// Delete the script definition list.
 
 	while (script_def_list != NULL) {
 		next_script_def_ptr = script_def_list->next_script_def_ptr;
-		if (script_def_list->script_simkin_object_ptr != NULL)
-			delete (skMethodDefNode *)script_def_list->script_simkin_object_ptr;
 		DEL(script_def_list, script_def);
 		script_def_list = next_script_def_ptr;
 	}
+
+	// Remove the symbols registered by start_up_simkin(), since they are
+	// registered again for the next spot.
+
+	skString::clearSymbols();
+}
+
+//------------------------------------------------------------------------------
+// Clean up SimKin, deleting the parse trees kept between spots.  This must only
+// be called when SimKin is shut down.
+//------------------------------------------------------------------------------
+
+void
+clean_up_simkin(void)
+{
+	if (shared_script_table_ptr != NULL) {
+		delete shared_script_table_ptr;
+		shared_script_table_ptr = NULL;
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -3041,7 +4062,8 @@ set_global_script(const char *script)
 		global_script = "<DEFINE>\n";
 		global_script += script;
 		global_script += "</DEFINE>";
-		spot_simkin_object_ptr->load("spot", skInputString((char *)global_script), *simkin_context_ptr);
+		skInputString global_script_input((char *)global_script);
+		spot_simkin_object_ptr->load("spot", global_script_input, *simkin_context_ptr);
 	}
 	catch (...) {
 		diagnose("Unable to load script into spot object");
@@ -3081,7 +4103,8 @@ create_block_simkin_object(block *block_ptr, const char *script)
 			block_script = "<DEFINE>\n";
 			block_script += script;
 			block_script += "</DEFINE>";
-			block_simkin_object_ptr->load("block", skInputString((char *)block_script), *simkin_context_ptr);
+			skInputString block_script_input((char *)block_script);
+			block_simkin_object_ptr->load("block", block_script_input, *simkin_context_ptr);
 			block_simkin_object_ptr->block_ptr = block_ptr;
 			block_ptr->scripted = true;
 			block_ptr->block_simkin_object_ptr = simkin_value_ptr;
@@ -3089,7 +4112,7 @@ create_block_simkin_object(block *block_ptr, const char *script)
 		catch (...) {
 			delete simkin_value_ptr;
 			diagnose("Unable to load script into block '%s'",
-				block_ptr->block_def_ptr->get_symbol());
+				(char *)(block_ptr->block_def_ptr->get_symbol()));
 		}
 	}
 
@@ -3188,59 +4211,63 @@ create_script_def(const char *script)
 }
 
 //------------------------------------------------------------------------------
-// Execute a script directly, using the specified block's SimKin object, or the
-// spot SimKin object if the specified block is NULL.  Returns TRUE if the
-// script completed within it's allotted time slot, or FALSE if the script has
-// been paused awaiting another time slot.
+// Execute a script on the given script thread, using the specified block's
+// SimKin object, or the spot SimKin object if the specified block is NULL.
+// Returns TRUE if the script has been paused awaiting another time slice, or
+// FALSE if the script completed within the given time slice.
 //------------------------------------------------------------------------------
 
 bool
-execute_script(block *block_ptr, script_def *script_def_ptr)
+execute_script(int script_thread_no, block *block_ptr, 
+			   script_def *script_def_ptr, int time_slice_ms)
 {
-	command_code = EXECUTE_SCRIPT;
-	simkin_script_def_ptr = script_def_ptr;
-	simkin_block_ptr = block_ptr;
-	perform_command.send_event(true);
-	return(!command_completed.wait_for_event());
+	script_thread *script_thread_ptr = &script_thread_list[script_thread_no];
+
+	script_thread_ptr->script_def_ptr = script_def_ptr;
+	script_thread_ptr->block_ptr = block_ptr;
+	script_thread_ptr->time_slice_ms = time_slice_ms;
+	return(send_script_command(script_thread_ptr, EXECUTE_SCRIPT));
 }
 
 //------------------------------------------------------------------------------
-// Call a method on the spot SimKin object.  No error is generated if the method
-// does not exist.  Returns TRUE if the method completed within it's allotted
-// time slot, or FALSE if the method has been paused awaiting another time slot.
+// Call a method on the spot SimKin object, using the first script thread.  No
+// error is generated if the method does not exist.  Returns TRUE if the method
+// has been paused awaiting another time slice, or FALSE if the method
+// completed within it's allotted time slice.
 //------------------------------------------------------------------------------
 
 bool
 call_global_method(const char *method_name)
 {
-	command_code = CALL_GLOBAL_METHOD;
-	simkin_method_name = method_name;
-	perform_command.send_event(true);
-	return(!command_completed.wait_for_event());
+	script_thread *script_thread_ptr = &script_thread_list[0];
+
+	script_thread_ptr->method_name = method_name;
+	script_thread_ptr->time_slice_ms = SCRIPT_TIME_SLICE_MS;
+	return(send_script_command(script_thread_ptr, CALL_GLOBAL_METHOD));
 }
 
 //------------------------------------------------------------------------------
-// Resume the SimKin script currently being executed.  Returns TRUE if the 
-// script completed within it's allotted time slot, or FALSE if the script
-// has been paused again.
+// Resume the SimKin script paused on the given script thread.  Returns TRUE if
+// the script has been paused again, or FALSE if the script completed within the
+// given time slice.
 //------------------------------------------------------------------------------
 
 bool
-resume_script(void)
+resume_script(int script_thread_no, int time_slice_ms)
 {
-	command_code = RESUME_SCRIPT;
-	perform_command.send_event(true);
-	return(!command_completed.wait_for_event());
+	script_thread *script_thread_ptr = &script_thread_list[script_thread_no];
+
+	script_thread_ptr->time_slice_ms = time_slice_ms;
+	return(send_script_command(script_thread_ptr, RESUME_SCRIPT));
 }
 
 //------------------------------------------------------------------------------
-// Terminate the SimKin script currently being executed, if any.
+// Terminate the SimKin script paused on the given script thread, if any.
 //------------------------------------------------------------------------------
 
 void
-terminate_script(void)
+terminate_script(int script_thread_no)
 {
-	command_code = TERMINATE_SCRIPT;
-	perform_command.send_event(true);
-	command_completed.wait_for_event();
-}
\ No newline at end of file
+	send_script_command(&script_thread_list[script_thread_no], 
+		TERMINATE_SCRIPT);
+}
@@ -3,12 +3,17 @@
 // This code is licensed under the MIT license (see LICENCE file for details).
 //******************************************************************************
 
+class skInterpreter;
+
 bool
 start_up_simkin(void);
 
 void
 shut_down_simkin(void);
 
+void
+clean_up_simkin(void);
+
 void
 set_global_script(const char *script);
 
@@ -28,13 +33,20 @@ script_def *
 create_script_def(const char *script);
 
 bool
-execute_script(block *block_ptr, script_def *script_def_ptr);
+execute_script(int script_thread_no, block *block_ptr, 
+			   script_def *script_def_ptr, int time_slice_ms);
 
 bool
 call_global_method(const char *method_name);
 
 bool
-resume_script(void);
+resume_script(int script_thread_no, int time_slice_ms);
 
 void
-terminate_script(void);
\ No newline at end of file
+terminate_script(int script_thread_no);
+
+int
+read_script_cache(skInterpreter *interpreter_ptr, const char *file_path);
+
+bool
+write_script_cache(skInterpreter *interpreter_ptr, const char *file_path);
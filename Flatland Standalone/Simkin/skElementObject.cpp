@@ -592,11 +592,23 @@ EXPORT_C bool skElementObject::method(const skString& s,skRValueArray& args,skRV
               RELEASE_VARIABLE(delims);
             }
             code=code.removeInitialBlankLines();
-            ctxt.getInterpreter()->executeStringExternalParams(location,this,paramList,code,args,ret,&methNode,ctxt);
-            if (methNode){
-              if (m_MethodCache==0)
-                m_MethodCache=skNEW(skMethodTable);
-              m_MethodCache->insertKeyAndValue(s,methNode);
+            skInterpreter * interp=ctxt.getInterpreter();
+            if (interp->getShareParseTrees()){
+              // the parse tree belongs to the interpreter, and is shared with other objects which have the same method
+              methNode=interp->parseSharedExternalParams(location,paramList,code,ctxt);
+              if (methNode){
+                if (m_MethodCache==0)
+                  m_MethodCache=skNEW(skMethodTable(DEFAULT_skSHashTable_SIZE,false));
+                m_MethodCache->insertKeyAndValue(s,methNode);
+                interp->executeParseTree(location,this,methNode,args,ret,ctxt);
+              }
+            }else{
+              interp->executeStringExternalParams(location,this,paramList,code,args,ret,&methNode,ctxt);
+              if (methNode){
+                if (m_MethodCache==0)
+                  m_MethodCache=skNEW(skMethodTable);
+                m_MethodCache->insertKeyAndValue(s,methNode);
+              }
             }
           }else
             bRet=skExecutable::method(s,args,ret,ctxt);
@@ -24,7 +24,7 @@
 
 #include "skString.h"
 #include "skElement.h"
-#include "..\expat\expat.h"
+#include "../Expat/expat.h"
 #include "skExecutableContext.h"
 
 class CLASSEXPORT skInputSource;
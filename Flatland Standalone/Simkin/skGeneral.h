@@ -53,12 +53,19 @@
 
 typedef unsigned int USize;
 
+#ifdef __GNUC__
+// GCC's standard headers can't be included once min and max are macros
+#include <algorithm>
+using std::max;
+using std::min;
+#else
 #ifndef max
 #define max(a,b) (((a)>(b))?(a):(b))
 #endif
 #ifndef min
 #define min(a,b) (((a)<(b))?(a):(b))
 #endif
+#endif
 
 // Windows Specific Thread Control...
 // We use this for skInterpreter::getInterpreter()
@@ -114,7 +121,8 @@ typedef unsigned int USize;
 #define USE_FLOATING_POINT 1
 
 // define this to enable execution scripts via the parse tree, rather than the new smaller representation
-#define EXECUTE_PARSENODES 1
+// (Flatland executes the byte code, which is what its compiled script cache holds)
+//#define EXECUTE_PARSENODES 1
 
 
 #if defined(USE_DEBUG_NEW)
@@ -179,7 +187,7 @@ inline void ExitSystem()
 }
 #else
 #define STREAMS_ENABLED
-#if (_MSC_VER>1300)
+#if (_MSC_VER>1300) || defined(__GNUC__)
 #define STL_STREAMS 1
 #endif
 #define EXCEPTIONS_DEFINED
@@ -33,11 +33,13 @@
 #include "skStatementStepper.h"
 #include "skStackFrame.h"
 #include "skConstants.h"
+#include "skMethodTable.h"
 
 skNAMED_LITERAL(CannotGetField,skSTR("Cannot get field "));
 skNAMED_LITERAL(FromANonObject,skSTR("  from a non-object\n"));
 skNAMED_LITERAL(CannotSetField,skSTR("Cannot set field "));
 skNAMED_LITERAL(OnANonObject,skSTR(" on a non-object\n"));
+skNAMED_LITERAL(comma,skSTR(","));
 
 // switch on additional info about functioning of the interpreter
 //#define TRACING_EXECUTION 1
@@ -45,7 +47,8 @@ skNAMED_LITERAL(OnANonObject,skSTR(" on a non-object\n"));
 //---------------------------------------------------
 EXPORT_C skInterpreter::skInterpreter()
   //---------------------------------------------------
-  : m_Tracing(false),m_TraceCallback(0),m_StatementStepper(0)
+  : m_Tracing(false),m_TraceCallback(0),m_StatementStepper(0),m_StepperInterval(1),m_StepperCountdown(1),
+    m_ShareParseTrees(false),m_SharedParseTrees(0)
 {
 #ifndef __SYMBIAN32__
 // don't call this function in Symbian, as it could leave
@@ -66,9 +69,10 @@ EXPORT_C void skInterpreter::init()
 skInterpreter::~skInterpreter()
   //---------------------------------------------------
 {
+  delete m_SharedParseTrees;
 }
 //---------------------------------------------------
-void skInterpreter::addLocalVariable(skRValueTable& var,const skString& name,skRValue value)
+void skInterpreter::addLocalVariable(skRValueTable& var,const skString& name,const skRValue& value)
   //---------------------------------------------------
 {
   skRValue * pvalue=var.value(name);
@@ -251,6 +255,86 @@ EXPORT_C skMethodDefNode * skInterpreter::parseExternalParams(const skString& lo
   }
   return methNode;
 }
+// number of slots in the table of shared parse trees
+static const USize SHARED_PARSE_TREE_SLOTS=211;
+//---------------------------------------------------
+EXPORT_C skMethodDefNode * skInterpreter::parseSharedExternalParams(const skString& location,skStringList& paramNames,const skString& code,skExecutableContext& user_ctxt)
+  //---------------------------------------------------
+{                                     
+#ifdef TRACING_EXECUTION
+  trace(skSTR("skInterpreter::parseSharedExternalParams"));
+#endif
+  skString key=sharedParseTreeKey(paramNames,code);
+  skMethodDefNode * methNode=0;
+  if (m_SharedParseTrees)
+    methNode=m_SharedParseTrees->value(key);
+  if (methNode==0){
+    methNode=parseExternalParams(location,paramNames,code,user_ctxt);
+    if (methNode)
+      addSharedParseTree(key,methNode);
+  }
+  return methNode;
+}
+//---------------------------------------------------
+EXPORT_C skString skInterpreter::sharedParseTreeKey(const skStringList& paramNames,const skString& code)
+  //---------------------------------------------------
+{
+  // the parameter names are separated by commas, and the code follows a newline, which can't appear in a name
+  skString key;
+  for (unsigned int i=0;i<paramNames.entries();i++){
+    if (i>0)
+      key+=s_comma;
+    key+=paramNames[i];
+  }
+  key+=s_cr;
+  key+=code;
+  return key;
+}
+//---------------------------------------------------
+EXPORT_C void skInterpreter::addSharedParseTree(const skString& key,skMethodDefNode * parseTree)
+  //---------------------------------------------------
+{
+  if (m_SharedParseTrees==0)
+    m_SharedParseTrees=skNEW(skMethodTable(SHARED_PARSE_TREE_SLOTS,true));
+  m_SharedParseTrees->insertKeyAndValue(key,parseTree);
+}
+//---------------------------------------------------
+EXPORT_C const skMethodTable& skInterpreter::getSharedParseTrees() const
+  //---------------------------------------------------
+{
+  if (m_SharedParseTrees==0)
+    ((skInterpreter *)this)->m_SharedParseTrees=skNEW(skMethodTable(SHARED_PARSE_TREE_SLOTS,true));
+  return *m_SharedParseTrees;
+}
+//---------------------------------------------------
+EXPORT_C skMethodTable * skInterpreter::releaseSharedParseTrees()
+  //---------------------------------------------------
+{
+  skMethodTable * parseTrees=m_SharedParseTrees;
+  m_SharedParseTrees=0;
+  return parseTrees;
+}
+//---------------------------------------------------
+EXPORT_C void skInterpreter::adoptSharedParseTrees(skMethodTable * parseTrees)
+  //---------------------------------------------------
+{
+  if (parseTrees!=m_SharedParseTrees){
+    delete m_SharedParseTrees;
+    m_SharedParseTrees=parseTrees;
+  }
+}
+//---------------------------------------------------
+EXPORT_C void skInterpreter::setShareParseTrees(bool enable)
+  //---------------------------------------------------
+{
+  m_ShareParseTrees=enable;
+}
+//---------------------------------------------------
+EXPORT_C bool skInterpreter::getShareParseTrees() const
+  //---------------------------------------------------
+{
+  return m_ShareParseTrees;
+}
 //---------------------------------------------------
 EXPORT_C void skInterpreter::executeStringExternalParams(const skString& location,skiExecutable * obj,skStringList& paramNames,const skString& code,skRValueArray& args,skRValue& r,skMethodDefNode** keepParseNode,skExecutableContext& user_ctxt)
   //---------------------------------------------------
@@ -460,6 +544,15 @@ EXPORT_C void skInterpreter::setStatementStepper(skStatementStepper * stepper)
   m_StatementStepper=stepper;
 }
 //------------------------------------------
+EXPORT_C void skInterpreter::setStatementStepperInterval(int interval)
+  //------------------------------------------
+{
+  if (interval<1)
+    interval=1;
+  m_StepperInterval=interval;
+  m_StepperCountdown=interval;
+}
+//------------------------------------------
 #ifdef EXECUTE_PARSENODES
 skExprNode * skInterpreter::parseExpression(const skString& location,const skString& expression,skExecutableContext& ctxt)
 #else
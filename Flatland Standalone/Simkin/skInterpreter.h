@@ -34,6 +34,7 @@ class CLASSEXPORT skStringList;
 class CLASSEXPORT skMethodDefNode;
 class CLASSEXPORT skTraceCallback;
 class CLASSEXPORT skStatementStepper;
+class CLASSEXPORT skMethodTable;
 
 #ifndef EXCEPTIONS_DEFINED
 #include "skScriptError.h"
@@ -80,6 +81,56 @@ class CLASSEXPORT skInterpreter : public skExecutable
    * @exception Symbian - a leaving function
    */
   IMPORT_C skMethodDefNode * parseExternalParams(const skString& location,skStringList& paramNames,const skString& code,skExecutableContext& ctxt);
+  /**
+   * this function works like parseExternalParams, except that the parse tree is kept by the interpreter and shared with
+   * any other script with the same parameters and code, so that each unique script is only parsed once.
+   * @param location - a string describing where this code is located, this will appear in any error messages
+   * @param paramNames - a list of parameter names
+   * @param code - a string of Simkin code, which does *not* include the parameter declarations
+   * @param ctxt context object to receive errors
+   * @return returns a parse tree, if the syntax was valid. The caller must *not* free this tree.
+   * @exception skParseException - if a syntax error is encountered
+   * @exception Symbian - a leaving function
+   */
+  IMPORT_C skMethodDefNode * parseSharedExternalParams(const skString& location,skStringList& paramNames,const skString& code,skExecutableContext& ctxt);
+  /**
+   * this function returns the key that a shared parse tree for the given parameters and code is kept under
+   * @param paramNames - a list of parameter names
+   * @param code - a string of Simkin code, which does *not* include the parameter declarations
+   */
+  static IMPORT_C skString sharedParseTreeKey(const skStringList& paramNames,const skString& code);
+  /**
+   * this function adds a parse tree to the shared parse trees, for example one restored from a cache. The interpreter takes ownership of the tree.
+   * @param key - the key returned by sharedParseTreeKey for the parameters and code of the tree
+   * @param parseTree - the parse tree
+   */
+  IMPORT_C void addSharedParseTree(const skString& key,skMethodDefNode * parseTree);
+  /**
+   * this function returns the table of shared parse trees, so that they can be saved to a cache
+   */
+  IMPORT_C const skMethodTable& getSharedParseTrees() const;
+  /**
+   * this function removes the table of shared parse trees from the interpreter and returns it, so that the trees can
+   * outlive the interpreter and be given to the next one with adoptSharedParseTrees. The caller takes ownership of the table.
+   * @return the table, or 0 if no trees have been shared
+   */
+  IMPORT_C skMethodTable * releaseSharedParseTrees();
+  /**
+   * this function gives the interpreter a table of shared parse trees released by another interpreter, replacing any
+   * trees it already has. The interpreter takes ownership of the table.
+   * @param parseTrees - the table, which may be 0
+   */
+  IMPORT_C void adoptSharedParseTrees(skMethodTable * parseTrees);
+  /**
+   * this function controls whether element objects share the parse trees of their methods with other objects that have
+   * methods with the same parameters and code. This should be set before any methods are called.
+   * @param enable - true to share parse trees
+   */
+  IMPORT_C void setShareParseTrees(bool enable);
+  /**
+   * this function returns true if element objects share the parse trees of their methods
+   */
+  IMPORT_C bool getShareParseTrees() const;
   /**
    * this function parses and executes script which is assumed to belong
    * to the object passed in.
@@ -266,6 +317,12 @@ class CLASSEXPORT skInterpreter : public skExecutable
    * @param stepper the stepper object, or 0 to clear
    */
   IMPORT_C void setStatementStepper(skStatementStepper * stepper);
+  /** this method sets how often the statement stepper is called. By default it is called for every statement, but if
+   * the stepper only needs to check the time or whether to stop, calling it less often saves the overhead of doing so
+   * after each statement. The interval may be changed by the stepper itself, and takes effect immediately.
+   * @param interval the number of statements executed for each call to the stepper, at least 1
+   */
+  IMPORT_C void setStatementStepperInterval(int interval);
 
   /**
    * This method reports a runtime error by throwing a skRuntimeException
@@ -508,15 +565,17 @@ class CLASSEXPORT skInterpreter : public skExecutable
    * @param value  - the value of the variable
    * @exception Symbian - a leaving function
    */
-  void addLocalVariable(skRValueTable& var,const skString& name,skRValue value); 
+  void addLocalVariable(skRValueTable& var,const skString& name,const skRValue& value); 
   /** This method checks whether a field name includes the indirection character
    * @param ctxt - the current source code context
    * @param obj - the object owning the current method
    * @param var - the local variables
    * @param name - the name being checked
+   * @param indirect_name - receives the de-referenced name, if the name includes the indirection character
+   * @return the name, or indirect_name if the name was de-referenced
    * @exception Symbian - a leaving function
    */
-  inline skString checkIndirectId(skStackFrame& frame,const skString& name); 
+  inline const skString& checkIndirectId(skStackFrame& frame,const skString& name,skString& indirect_name); 
   /** This method finds a value associated with a given name
    * @param frame - the current stack frame
    * @param name - the name being checked
@@ -603,8 +662,8 @@ class CLASSEXPORT skInterpreter : public skExecutable
   bool insertValue(skStackFrame& frame,skRValue& robject,const skString& name, const skString& attr,const skRValue& value);
 
 #ifndef EXECUTE_PARSENODES
-  void getIdNode(skCompiledCode& code,USize& pc,skString& id,bool& has_array,bool& is_method);
-  void getIdNodes(skCompiledCode& code,USize& pc,int& num_ids,skString& attribute);
+  const skString& getIdNode(skCompiledCode& code,USize& pc,bool& has_array,bool& is_method);
+  const skString& getIdNodes(skCompiledCode& code,USize& pc,int& num_ids);
 #endif
 
   // Variables
@@ -616,23 +675,31 @@ class CLASSEXPORT skInterpreter : public skExecutable
   skTraceCallback * m_TraceCallback; 
   /** This variable points to an associated object which receives information about which statements are being executed */
   skStatementStepper * m_StatementStepper; // the statement stepper
+  /** This is the number of statements executed for each call to the statement stepper */
+  int m_StepperInterval;
+  /** This is the number of statements left to execute before the statement stepper is next called */
+  int m_StepperCountdown;
+  /** This flag controls whether element objects share the parse trees of their methods */
+  bool m_ShareParseTrees;
+  /** This is the table of shared parse trees, keyed by their parameters and code */
+  skMethodTable * m_SharedParseTrees;
   /**
    * null object
    */
   skNull m_Null;
 };      
 //---------------------------------------------------
-inline skString skInterpreter::checkIndirectId(skStackFrame& frame,const skString& name)
+inline const skString& skInterpreter::checkIndirectId(skStackFrame& frame,const skString& name,skString& indirect_name)
 //---------------------------------------------------
 {
   // look for an initial "@" in a field name, and de-reference it if necessary
-  skString ret=name;
   if (name.at(0)=='@'){
-    ret=name.substr(1,name.length()-1);
+    skString ret=name.substr(1,name.length()-1);
     skRValue new_name=findValue(frame,ret,0,skString());
-    ret=new_name.str();
+    indirect_name=new_name.str();
+    return indirect_name;
   }
-  return ret;
+  return name;
 }       
 //---------------------------------------------------
 inline skNull& skInterpreter::getNull()
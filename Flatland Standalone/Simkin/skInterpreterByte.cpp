@@ -36,17 +36,19 @@ skLITERAL_STRING(OnMiddle," on ");
 skLITERAL_STRING(CannotFindField,"Cannot find field ");
 
 //---------------------------------------------------
-inline void skInterpreter::getIdNodes(skCompiledCode& code,USize& pc,int& num_ids,skString& attribute)
+// these return references to the identifiers in the code's table, rather than copies
+//---------------------------------------------------
+inline const skString& skInterpreter::getIdNodes(skCompiledCode& code,USize& pc,int& num_ids)
 //---------------------------------------------------
 {
   int attrib_id;
   skCompiledCode::skInstruction ins;
   code.getInstruction(pc++,ins,num_ids,attrib_id);
   assert(ins==skCompiledCode::b_IdList);
-  attribute=code.getId(attrib_id);
+  return code.getId(attrib_id);
 }
 //---------------------------------------------------
-inline void skInterpreter::getIdNode(skCompiledCode& code,USize& pc,skString& id,bool& has_array,bool& is_method)
+inline const skString& skInterpreter::getIdNode(skCompiledCode& code,USize& pc,bool& has_array,bool& is_method)
 //---------------------------------------------------
 {
   int id_index;
@@ -54,7 +56,7 @@ inline void skInterpreter::getIdNode(skCompiledCode& code,USize& pc,skString& id
   code.getInstruction(pc++,ins,id_index,has_array);
   assert(ins==skCompiledCode::b_Id || ins==skCompiledCode::b_IdWithMethod);
   is_method=(ins==skCompiledCode::b_IdWithMethod);
-  id=code.getId(id_index);
+  return code.getId(id_index);
 }
 //---------------------------------------------------
 skRValue skInterpreter::evaluate(skStackFrame& frame,skCompiledCode& code,USize& pc)
@@ -72,16 +74,12 @@ skRValue skInterpreter::evaluate(skStackFrame& frame,skCompiledCode& code,USize&
   code.getInstruction(pc++,ins,param1,param2);
   switch(ins){
   case skCompiledCode::b_IdList:{
-    skString method_name;
-    SAVE_VARIABLE(method_name);
     int num_ids=param1;
-    skString attribute;
-    SAVE_VARIABLE(attribute);
-    attribute=code.getId(param2);
+    const skString& attribute=code.getId(param2);
     if (num_ids==1){
       bool has_array_index;
       bool is_method;
-      getIdNode(code,pc,method_name,has_array_index,is_method);
+      const skString& method_name=getIdNode(code,pc,has_array_index,is_method);
       if (is_method==false){
         if (has_array_index){
           skRValue array_index;
@@ -92,11 +90,8 @@ skRValue skInterpreter::evaluate(skStackFrame& frame,skCompiledCode& code,USize&
         }else{
           r=findValue(frame,method_name,0,attribute);
         }
-      }else{
-        skRValue caller;
-        caller.assignObject(frame.getObject());
-        makeMethodCall(frame,code,pc,caller,method_name,has_array_index,attribute,r);
-      }
+      }else
+        makeMethodCall(frame,code,pc,frame.getObjectValue(),method_name,has_array_index,attribute,r);
     }else{
       skRValue robject;
       SAVE_VARIABLE(robject);
@@ -104,7 +99,7 @@ skRValue skInterpreter::evaluate(skStackFrame& frame,skCompiledCode& code,USize&
       bool has_array_index;
       bool is_method;
       skString blank;
-      getIdNode(code,pc,method_name,has_array_index,is_method);
+      const skString& method_name=getIdNode(code,pc,has_array_index,is_method);
       if (is_method==false){
         if (has_array_index){
           skRValue array_field;
@@ -125,8 +120,6 @@ skRValue skInterpreter::evaluate(skStackFrame& frame,skCompiledCode& code,USize&
         makeMethodCall(frame,code,pc,robject,method_name,has_array_index,attribute,r);
       RELEASE_VARIABLE(robject);
     }
-    RELEASE_VARIABLE(attribute);
-    RELEASE_VARIABLE(method_name);
     break;
   }
   case skCompiledCode::b_String:
@@ -288,10 +281,10 @@ skRValue skInterpreter::findValue(skStackFrame& frame,const skString& name,const
 {              
   skRValue r;
   SAVE_VARIABLE(r);
-  skString valueName;
+  skString indirect_name;
   skString blank;
-  SAVE_VARIABLE(valueName);
-  valueName=checkIndirectId(frame,name);
+  SAVE_VARIABLE(indirect_name);
+  const skString& valueName=checkIndirectId(frame,name,indirect_name);
   if (valueName.length()){
     // first check some built-ins: true, false and self
     if (valueName==s_true)
@@ -302,17 +295,14 @@ skRValue skInterpreter::findValue(skStackFrame& frame,const skString& name,const
       r.assignObject(&m_Null);
     else if (valueName==s_self){
       if (attrib.length() || array_index){
-        skRValue caller;
-        SAVE_VARIABLE(caller);
-        caller.assignObject(frame.getObject());
+        skRValue& caller=frame.getObjectValue();
         if (array_index){
           extractArrayValue(frame,caller,*array_index,attrib,r);
         }else
           if (extractValue(frame,caller,blank,attrib,r)==false)
             runtimeError(frame,skString::addStrings(s_CannotGetAttribute,attrib.ptr(),s_cr));
-        RELEASE_VARIABLE(caller);
       }else
-        r.assignObject(frame.getObject());
+        r=frame.getObjectValue();
     }else{
       // otherwise look up the scope hierarchy
       skRValue * pvalue=0;
@@ -333,9 +323,7 @@ skRValue skInterpreter::findValue(skStackFrame& frame,const skString& name,const
         }
       }else{
         // then in the instance fields
-        skRValue caller;
-        SAVE_VARIABLE(caller);
-        caller.assignObject(frame.getObject());
+        skRValue& caller=frame.getObjectValue();
         bool found=false;
         if (array_index)
           found=extractFieldArrayValue(frame,caller,valueName,*array_index,attrib,r);
@@ -361,11 +349,10 @@ skRValue skInterpreter::findValue(skStackFrame& frame,const skString& name,const
           }else
             runtimeError(frame,skString::addStrings(s_FieldStart,valueName.ptr(),s_NotFound));
         }       
-        RELEASE_VARIABLE(caller);
       } 
     }
   }
-  RELEASE_VARIABLE(valueName);
+  RELEASE_VARIABLE(indirect_name);
   RELEASE_VARIABLE(r);
   return r;
 }
@@ -388,37 +375,31 @@ void skInterpreter::followIdList(skStackFrame& frame,skCompiledCode& code,USize&
   //---------------------------------------------------
 {
   // skip down the id.id.id list, resolving each as we go along, we exclude the final id in the list
-  skString name;
-  SAVE_VARIABLE(name);
+  skString indirect_name;
+  SAVE_VARIABLE(indirect_name);
   skRValue array_index;
   SAVE_VARIABLE(array_index);
   bool has_array_index;
   bool is_method;
   skString blank;
-  getIdNode(code,pc,name,has_array_index,is_method);
+  const skString& first_name=getIdNode(code,pc,has_array_index,is_method);
   if (has_array_index)
     array_index=evaluate(frame,code,pc);
   //  trace("followIdList: %s - %d ids\n",(const char *)name,idList->m_Ids.entries());
   if (is_method==false){
     if (has_array_index)
-      object=findValue(frame,name,&array_index,blank);
+      object=findValue(frame,first_name,&array_index,blank);
     else
-      object=findValue(frame,name,0,blank);
-  }else{
-    skRValue caller;
-    SAVE_VARIABLE(caller);
-    caller.assignObject(frame.getObject(),false);
-    makeMethodCall(frame,code,pc,caller,name,has_array_index,blank,object);
-    RELEASE_VARIABLE(caller);
-  }
+      object=findValue(frame,first_name,0,blank);
+  }else
+    makeMethodCall(frame,code,pc,frame.getObjectValue(),first_name,has_array_index,blank,object);
   for (int i=1;i<num_ids-1;i++){
 #ifndef EXCEPTIONS_DEFINED
     if (frame.getContext().getError().getErrorCode()!=skScriptError::NONE)
       break;
 #endif
-    getIdNode(code,pc,name,has_array_index,is_method);
+    const skString& name=checkIndirectId(frame,getIdNode(code,pc,has_array_index,is_method),indirect_name);
     //    trace("followIdList: %d: %s\n",i,(const char *)name);
-    name=checkIndirectId(frame,name);
     skRValue result;
     SAVE_VARIABLE(result);
     if (is_method==false){
@@ -433,7 +414,7 @@ void skInterpreter::followIdList(skStackFrame& frame,skCompiledCode& code,USize&
     RELEASE_VARIABLE(result);
   }
   RELEASE_VARIABLE(array_index);
-  RELEASE_VARIABLE(name);
+  RELEASE_VARIABLE(indirect_name);
 }
 //---------------------------------------------------
 bool skInterpreter::insertArrayValue(skStackFrame& frame,skCompiledCode& code,USize& pc,skRValue& robject, const skString& attr,const skRValue& value)
@@ -469,7 +450,8 @@ bool skInterpreter::extractArrayValue(skStackFrame& frame,skRValue& robject,cons
 void skInterpreter::makeMethodCall(skStackFrame& frame,skCompiledCode& code,USize& pc,skRValue& robject,const skString& method_name,bool has_array_index,const skString& attribute, skRValue& ret)
   //---------------------------------------------------
 {
-  skString checked_method_name=checkIndirectId(frame,method_name);
+  skString indirect_name;
+  const skString& checked_method_name=checkIndirectId(frame,method_name,indirect_name);
   skRValue array_index;
   SAVE_VARIABLE(array_index);
   if (has_array_index)
@@ -528,36 +510,25 @@ skRValue  skInterpreter::evalMethod(skStackFrame& frame,skCompiledCode& code,USi
   skRValue ret;
   SAVE_VARIABLE(ret);
   int num_ids;
-  skString attribute;
-  SAVE_VARIABLE(attribute);
-  getIdNodes(code,pc,num_ids,attribute);
+  const skString& attribute=getIdNodes(code,pc,num_ids);
   if (num_ids==1){
-    skString method_name;
-    SAVE_VARIABLE(method_name);
     bool has_array_index;
     bool is_method;
-    getIdNode(code,pc,method_name,has_array_index,is_method);
+    const skString& method_name=getIdNode(code,pc,has_array_index,is_method);
     assert(is_method==true);
-    skRValue caller;
-    SAVE_VARIABLE(caller);
-    caller.assignObject(frame.getObject());
-    makeMethodCall(frame,code,pc,caller,method_name,has_array_index,attribute,ret);
-    RELEASE_VARIABLE(caller);
-    RELEASE_VARIABLE(method_name);
+    makeMethodCall(frame,code,pc,frame.getObjectValue(),method_name,has_array_index,attribute,ret);
   }else{
     // follow the chain of Id's and then call the method
     skRValue robject;
     SAVE_VARIABLE(robject);
     followIdList(frame,code,pc,num_ids,robject);
-    skString method_name;
     bool has_array_index;
     bool is_method;
-    getIdNode(code,pc,method_name,has_array_index,is_method);
+    const skString& method_name=getIdNode(code,pc,has_array_index,is_method);
     assert(is_method==true);
     makeMethodCall(frame,code,pc,robject,method_name,has_array_index,attribute,ret);
     RELEASE_VARIABLE(robject);
   }
-  RELEASE_VARIABLE(attribute);
   RELEASE_VARIABLE(ret);
   return ret;
 }
@@ -579,6 +550,7 @@ bool skInterpreter::executeWhileStat(skStackFrame& frame,skCompiledCode& code,US
   skCompiledCode::skInstruction ins;
   code.getInstruction(pc++,ins,dummy,num_bytes);
   assert(ins==skCompiledCode::b_StatsSize);
+  num_bytes=code.getByteCount(pc++);
   USize start_pc=pc;
   while(bRet==false){
     // reset the PC
@@ -639,6 +611,7 @@ bool skInterpreter::executeSwitchStat(skStackFrame& frame,skCompiledCode& code,U
   skCompiledCode::skInstruction ins;
   code.getInstruction(pc++,ins,num_cases,num_bytes);
   assert(ins==skCompiledCode::b_CaseList);
+  num_bytes=code.getByteCount(pc++);
   skRValue testExpr;
   SAVE_VARIABLE(testExpr);
   bool case_found=false;
@@ -681,16 +654,15 @@ bool skInterpreter::executeForEachStat(skStackFrame& frame,skCompiledCode& code,
 {
   bool bRet=false;
   int num_bytes=0;
-  skString checked_id;
-  SAVE_VARIABLE(checked_id);
-  checked_id=checkIndirectId(frame,code.getId(id_index));
+  skString indirect_id;
+  SAVE_VARIABLE(indirect_id);
+  const skString& checked_id=checkIndirectId(frame,code.getId(id_index),indirect_id);
   int qualifier_index;
   skCompiledCode::skInstruction ins;
   code.getInstruction(pc++,ins,qualifier_index,num_bytes);
   assert(ins==skCompiledCode::b_QualifierIndex);
-  skString qualifier;
-  SAVE_VARIABLE(qualifier);
-  qualifier=code.getId(qualifier_index);
+  num_bytes=code.getByteCount(pc++);
+  const skString& qualifier=code.getId(qualifier_index);
   skRValue expr;
   SAVE_VARIABLE(expr);
   expr=evaluate(frame,code,pc);
@@ -725,8 +697,7 @@ bool skInterpreter::executeForEachStat(skStackFrame& frame,skCompiledCode& code,
   }else
     runtimeError(frame,skSTR("Cannot apply foreach to a non-executable object\n"));
   RELEASE_VARIABLE(expr);
-  RELEASE_VARIABLE(qualifier);
-  RELEASE_VARIABLE(checked_id);
+  RELEASE_VARIABLE(indirect_id);
   return bRet;
 }
 //---------------------------------------------------
@@ -739,13 +710,13 @@ bool skInterpreter::executeForEachStat(skStackFrame& frame,skCompiledCode& code,
   skCompiledCode::skInstruction ins;
   code.getInstruction(pc++,ins,dummy,num_bytes);
   assert(ins==skCompiledCode::b_StatsSize);
-  skString checked_id;
-  SAVE_VARIABLE(checked_id);
+  num_bytes=code.getByteCount(pc++);
+  skString indirect_id;
+  SAVE_VARIABLE(indirect_id);
   bool has_array_index;
   bool is_method;
-  getIdNode(code,pc,checked_id,has_array_index,is_method);
+  const skString& checked_id=checkIndirectId(frame,getIdNode(code,pc,has_array_index,is_method),indirect_id);
   assert(is_method==false);
-  checked_id=checkIndirectId(frame,checked_id);
   skRValue start_expr;
   SAVE_VARIABLE(start_expr);
   start_expr=evaluate(frame,code,pc);
@@ -808,7 +779,7 @@ bool skInterpreter::executeForEachStat(skStackFrame& frame,skCompiledCode& code,
   }// else do nothing
   RELEASE_VARIABLE(end_expr);
   RELEASE_VARIABLE(start_expr);
-  RELEASE_VARIABLE(checked_id);
+  RELEASE_VARIABLE(indirect_id);
   return bRet;
 }
 //---------------------------------------------------
@@ -822,24 +793,19 @@ void skInterpreter::executeAssignStat(skStackFrame& frame,skCompiledCode& code,U
   if (frame.getContext().getError().getErrorCode()==skScriptError::NONE){
 #endif
     int num_ids;
-    skString attribute;
-    SAVE_VARIABLE(attribute);
-    getIdNodes(code,pc,num_ids,attribute);
+    const skString& attribute=getIdNodes(code,pc,num_ids);
     skString blank;
-    skString field_name;
-    SAVE_VARIABLE(field_name);
+    skString indirect_name;
+    SAVE_VARIABLE(indirect_name);
     if (num_ids==1){
       bool has_array_index;
       bool is_method;
-      getIdNode(code,pc,field_name,has_array_index,is_method);
+      const skString& field_name=checkIndirectId(frame,getIdNode(code,pc,has_array_index,is_method),indirect_name);
       assert(is_method==false);
-      field_name=checkIndirectId(frame,field_name);
       // special case where there is a single id
       bool inserted=false;
       if (frame.getObject()!=0){
-        skRValue caller;
-        SAVE_VARIABLE(caller);
-        caller.assignObject(frame.getObject());
+        skRValue& caller=frame.getObjectValue();
         if (field_name==s_self){
           if (has_array_index)
             inserted=insertArrayValue(frame,code,pc,caller,attribute,value);
@@ -847,12 +813,14 @@ void skInterpreter::executeAssignStat(skStackFrame& frame,skCompiledCode& code,U
             inserted=insertValue(frame,caller,blank,attribute,value);
         }else{
           if (has_array_index){
-            caller=findValue(frame,field_name,0,blank);
-            inserted=insertArrayValue(frame,code,pc,caller,attribute,value);
+            skRValue array_field;
+            SAVE_VARIABLE(array_field);
+            array_field=findValue(frame,field_name,0,blank);
+            inserted=insertArrayValue(frame,code,pc,array_field,attribute,value);
+            RELEASE_VARIABLE(array_field);
           }else{
             if (attribute.length()>0){
               // e.g. "field:name"
-              caller.assignObject(frame.getObject());
               inserted=insertValue(frame,caller,field_name,attribute,value);
               if (inserted==false)
                 runtimeError(frame,skString::addStrings(s_SettingAttribute,attribute.ptr(),s_OnMiddle,field_name.ptr(),s_Failed));
@@ -860,7 +828,6 @@ void skInterpreter::executeAssignStat(skStackFrame& frame,skCompiledCode& code,U
               inserted=insertValue(frame,caller,field_name,attribute,value);
           }
         }
-        RELEASE_VARIABLE(caller);
       }
       if (inserted==false)
         // if the object doesn't want this variable, we add it as a local variable
@@ -872,9 +839,8 @@ void skInterpreter::executeAssignStat(skStackFrame& frame,skCompiledCode& code,U
       followIdList(frame,code,pc,num_ids,robject);
       bool has_array_index;
       bool is_method;
-      getIdNode(code,pc,field_name,has_array_index,is_method);
+      const skString& field_name=checkIndirectId(frame,getIdNode(code,pc,has_array_index,is_method),indirect_name);
       assert(is_method==false);
-      field_name=checkIndirectId(frame,field_name);
       if (has_array_index){
         skRValue array_field;
         SAVE_VARIABLE(array_field);
@@ -888,8 +854,7 @@ void skInterpreter::executeAssignStat(skStackFrame& frame,skCompiledCode& code,U
         insertValue(frame,robject,field_name,attribute,value);
       RELEASE_VARIABLE(robject);
     }
-    RELEASE_VARIABLE(field_name);
-    RELEASE_VARIABLE(attribute);
+    RELEASE_VARIABLE(indirect_name);
 #ifndef EXCEPTIONS_DEFINED
   }
 #endif
@@ -905,13 +870,16 @@ bool skInterpreter::executeStats(skStackFrame& frame,skCompiledCode& code,USize&
   if (execute_stats){
     code.getInstruction(pc++,instruction,num_stats,num_bytes);
     assert(instruction==skCompiledCode::b_StatList);
+    num_bytes=code.getByteCount(pc++);
     for (int i=0;i<num_stats;i++){
       int param1;
       int line_num;
       code.getInstruction(pc++,instruction,param1,line_num);
       frame.setLineNum(line_num);
-      if (m_StatementStepper)
+      if (m_StatementStepper && --m_StepperCountdown<=0){
+        m_StepperCountdown=m_StepperInterval;
         bRet=(m_StatementStepper->statementExecuted(frame,(int)instruction)==false);
+      }
       if (bRet==false){
         switch(instruction){
         case skCompiledCode::b_NullStat:        // param1 = 0                 param2 = line
@@ -953,6 +921,7 @@ bool skInterpreter::executeStats(skStackFrame& frame,skCompiledCode& code,USize&
     // skip over this list of statements
     code.getInstruction(pc,instruction,num_stats,num_bytes);
     assert(instruction==skCompiledCode::b_StatList);
+    num_bytes=code.getByteCount(pc+1);
     pc+=num_bytes;
   }
   return bRet;
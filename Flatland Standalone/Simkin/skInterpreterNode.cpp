@@ -48,8 +48,10 @@ bool skInterpreter::executeStats(skStackFrame& frame,skStatListNode * n,skRValue
 #endif
       frame.setLineNum(pstat->getLineNum());
       int stat_type=pstat->getType();
-      if (m_StatementStepper)
+      if (m_StatementStepper && --m_StepperCountdown<=0){
+        m_StepperCountdown=m_StepperInterval;
         bRet=(m_StatementStepper->statementExecuted(frame,stat_type)==false);
+      }
       if (bRet==false){
         switch(stat_type){
         case s_If:
@@ -86,25 +88,19 @@ void skInterpreter::followIdList(skStackFrame& frame,skIdListNode * idList,skRVa
    skString blank;
   // skip down the id.id.id list, resolving each as we go along, we exclude the final id in the list
   skIdNode * idNode=idList->getId(0);
-  skString name=idNode->getId();
-  //  trace("followIdList: %s - %d ids\n",(const char *)name,idList->m_Ids.entries());
+  skString indirect_name;
+  //  trace("followIdList: %s - %d ids\n",(const char *)idNode->getId(),idList->m_Ids.entries());
   if (idNode->getExprs()==0)
-    object=findValue(frame,name,idNode->getArrayIndex(),blank);
-  else{
-    skRValue caller;
-    SAVE_VARIABLE(caller);
-    caller.assignObject(frame.getObject(),false);
-    makeMethodCall(frame,caller,name,idNode->getArrayIndex(),blank,idNode->getExprs(),object);
-    RELEASE_VARIABLE(caller);
-  }
+    object=findValue(frame,idNode->getId(),idNode->getArrayIndex(),blank);
+  else
+    makeMethodCall(frame,frame.getObjectValue(),idNode->getId(),idNode->getArrayIndex(),blank,idNode->getExprs(),object);
   for (unsigned int i=1;i<idList->numIds()-1;i++){
 #ifndef EXCEPTIONS_DEFINED
     if (frame.getContext().getError().getErrorCode()!=skScriptError::NONE)
       break;
 #endif
     idNode=idList->getId(i);
-    name=idNode->getId();
-    name=checkIndirectId(frame,name);
+    const skString& name=checkIndirectId(frame,idNode->getId(),indirect_name);
     //    trace("followIdList: %d: %s\n",i,(const char *)name);
     skRValue result;
     SAVE_VARIABLE(result);
@@ -127,14 +123,10 @@ skRValue  skInterpreter::evalMethod(skStackFrame& frame,skIdListNode * ids)
   skRValue ret;
   SAVE_VARIABLE(ret);
   skIdNode * idNode=ids->getLastId();
-  skString method_name=idNode->getId();
-  if (ids->numIds()==1){
-    skRValue caller;
-    SAVE_VARIABLE(caller);
-    caller.assignObject(frame.getObject());
-    makeMethodCall(frame,caller,method_name,idNode->getArrayIndex(),ids->getAttribute(),idNode->getExprs(),ret);
-    RELEASE_VARIABLE(caller);
-  }else{
+  const skString& method_name=idNode->getId();
+  if (ids->numIds()==1)
+    makeMethodCall(frame,frame.getObjectValue(),method_name,idNode->getArrayIndex(),ids->getAttribute(),idNode->getExprs(),ret);
+  else{
     // follow the chain of Id's and then call the method
     skRValue robject;
     SAVE_VARIABLE(robject);
@@ -149,7 +141,8 @@ skRValue  skInterpreter::evalMethod(skStackFrame& frame,skIdListNode * ids)
 void  skInterpreter::makeMethodCall(skStackFrame& frame,skRValue& robject,const skString& method_name,skExprNode * array_index,const skString& attribute, skExprListNode * exprs,skRValue& ret)
   //---------------------------------------------------
 {
-  skString checked_method_name=checkIndirectId(frame,method_name);
+  skString indirect_name;
+  const skString& checked_method_name=checkIndirectId(frame,method_name,indirect_name);
   if (robject.type()==skRValue::T_Object){
     skRValueArray args;
     SAVE_VARIABLE(robject);
@@ -286,9 +279,9 @@ bool skInterpreter::executeForEachStat(skStackFrame& frame,skForEachNode * n,skR
   //---------------------------------------------------
 {
   bool bRet=false;
-  skString checked_id;
-  SAVE_VARIABLE(checked_id);
-     checked_id=checkIndirectId(frame,n->getId());
+  skString indirect_id;
+  SAVE_VARIABLE(indirect_id);
+  const skString& checked_id=checkIndirectId(frame,n->getId(),indirect_id);
   skRValue expr;
   SAVE_VARIABLE(expr);
   expr=evaluate(frame,n->getExpr());
@@ -320,7 +313,7 @@ bool skInterpreter::executeForEachStat(skStackFrame& frame,skForEachNode * n,skR
   }else
     runtimeError(frame,skSTR("Cannot apply foreach to a non-executable object\n"));
   RELEASE_VARIABLE(expr);
-  RELEASE_VARIABLE(checked_id);
+  RELEASE_VARIABLE(indirect_id);
   return bRet;
 }
 //---------------------------------------------------
@@ -328,9 +321,9 @@ bool skInterpreter::executeForStat(skStackFrame& frame,skForNode * n,skRValue& r
   //---------------------------------------------------
 {
   bool bRet=false;
-  skString checked_id;
-  SAVE_VARIABLE(checked_id);
-  checked_id=checkIndirectId(frame,n->getId());
+  skString indirect_id;
+  SAVE_VARIABLE(indirect_id);
+  const skString& checked_id=checkIndirectId(frame,n->getId(),indirect_id);
   skRValue start_expr;
   SAVE_VARIABLE(start_expr);
   start_expr=evaluate(frame,n->getStartExpr());
@@ -384,7 +377,7 @@ bool skInterpreter::executeForStat(skStackFrame& frame,skForNode * n,skRValue& r
   }// else do nothing
   RELEASE_VARIABLE(end_expr);
   RELEASE_VARIABLE(start_expr);
-  RELEASE_VARIABLE(checked_id);
+  RELEASE_VARIABLE(indirect_id);
   return bRet;
 }
 //---------------------------------------------------
@@ -393,10 +386,10 @@ skRValue skInterpreter::findValue(skStackFrame& frame,const skString& name,skExp
 {              
   skRValue r;
   SAVE_VARIABLE(r);
-  skString valueName;
-  SAVE_VARIABLE(valueName);
+  skString indirect_name;
+  SAVE_VARIABLE(indirect_name);
   skString blank;
-  valueName=checkIndirectId(frame,name);
+  const skString& valueName=checkIndirectId(frame,name,indirect_name);
   if (valueName.length()){
     // first check some built-ins: true, false and self
     if (valueName==s_true)
@@ -407,17 +400,14 @@ skRValue skInterpreter::findValue(skStackFrame& frame,const skString& name,skExp
       r.assignObject(&m_Null);
     else if (valueName==s_self){
       if (attrib.length() || array_index){
-        skRValue caller;
-        SAVE_VARIABLE(caller);
-        caller.assignObject(frame.getObject());
+        skRValue& caller=frame.getObjectValue();
         if (array_index){
           extractArrayValue(frame,caller,array_index,attrib,r);
         }else
           if (extractValue(frame,caller,blank,attrib,r)==false)
             runtimeError(frame,skString::addStrings(s_CannotGetAttribute,attrib.ptr(),s_cr));
-        RELEASE_VARIABLE(caller);
       }else
-        r.assignObject(frame.getObject());
+        r=frame.getObjectValue();
     }else{
       // otherwise look up the scope hierarchy
       skRValue * pvalue=0;
@@ -438,9 +428,7 @@ skRValue skInterpreter::findValue(skStackFrame& frame,const skString& name,skExp
         }
       }else{
         // then in the instance fields
-        skRValue caller;
-        SAVE_VARIABLE(caller);
-        caller.assignObject(frame.getObject());
+        skRValue& caller=frame.getObjectValue();
         bool found=false;
         if (array_index)
           found=extractFieldArrayValue(frame,caller,valueName,array_index,attrib,r);
@@ -466,11 +454,10 @@ skRValue skInterpreter::findValue(skStackFrame& frame,const skString& name,skExp
           }else
             runtimeError(frame,skString::addStrings(s_FieldStart,valueName.ptr(),s_NotFound));
         }       
-        RELEASE_VARIABLE(caller);
       } 
     }
   }
-  RELEASE_VARIABLE(valueName);
+  RELEASE_VARIABLE(indirect_name);
   RELEASE_VARIABLE(r);
   return r;
 }
@@ -517,16 +504,14 @@ void skInterpreter::executeAssignStat(skStackFrame& frame,skAssignNode * n)
   if (frame.getContext().getError().getErrorCode()==skScriptError::NONE){
 #endif
     skIdNode * idNode=n->getIds()->getLastId();
-    skString field_name;
-    SAVE_VARIABLE(field_name);
-    field_name=checkIndirectId(frame,idNode->getId());
+    skString indirect_name;
+    SAVE_VARIABLE(indirect_name);
+    const skString& field_name=checkIndirectId(frame,idNode->getId(),indirect_name);
     if (n->getIds()->numIds()==1){
       // special case where there is a single id
       bool inserted=false;
       if (frame.getObject()!=0){
-        skRValue caller;
-        SAVE_VARIABLE(caller);
-        caller.assignObject(frame.getObject());
+        skRValue& caller=frame.getObjectValue();
         if (field_name==s_self){
           if (idNode->getArrayIndex())
             inserted=insertArrayValue(frame,caller,idNode->getArrayIndex(),n->getIds()->getAttribute(),value);
@@ -534,12 +519,14 @@ void skInterpreter::executeAssignStat(skStackFrame& frame,skAssignNode * n)
             inserted=insertValue(frame,caller,blank,n->getIds()->getAttribute(),value);
         }else{
           if (idNode->getArrayIndex()){
-            caller=findValue(frame,field_name,0,blank);
-            inserted=insertArrayValue(frame,caller,idNode->getArrayIndex(),n->getIds()->getAttribute(),value);
+            skRValue array_field;
+            SAVE_VARIABLE(array_field);
+            array_field=findValue(frame,field_name,0,blank);
+            inserted=insertArrayValue(frame,array_field,idNode->getArrayIndex(),n->getIds()->getAttribute(),value);
+            RELEASE_VARIABLE(array_field);
           }else{
             if (n->getIds()->getAttribute().length()>0){
               // e.g. "field:name"
-              caller.assignObject(frame.getObject());
               inserted=insertValue(frame,caller,field_name,n->getIds()->getAttribute(),value);
               if (inserted==false)
                 runtimeError(frame,skString::addStrings(s_SettingAttribute,n->getIds()->getAttribute().ptr(),s_OnMiddle,field_name.ptr(),s_Failed));
@@ -570,7 +557,7 @@ void skInterpreter::executeAssignStat(skStackFrame& frame,skAssignNode * n)
         insertValue(frame,robject,field_name,n->getIds()->getAttribute(),value);
       RELEASE_VARIABLE(robject);
     }
-    RELEASE_VARIABLE(field_name);
+    RELEASE_VARIABLE(indirect_name);
 #ifndef EXCEPTIONS_DEFINED
   }
 #endif
@@ -608,19 +595,15 @@ skRValue skInterpreter::evaluate(skStackFrame& frame,skExprNode * n)
   case s_IdList:{
     skIdListNode * ids=(skIdListNode *)n;
     skIdNode * idNode=ids->getLastId();
-    skString method_name;
-    SAVE_VARIABLE(method_name);
-    method_name=idNode->getId();
+    skString indirect_name;
+    SAVE_VARIABLE(indirect_name);
     if (ids->numIds()==1){
       if (idNode->getExprs()==0)
-        r=findValue(frame,method_name,idNode->getArrayIndex(),ids->getAttribute());
-      else{
-        skRValue caller;
-        caller.assignObject(frame.getObject());
-        makeMethodCall(frame,caller,method_name,idNode->getArrayIndex(),ids->getAttribute(),idNode->getExprs(),r);
-      }
+        r=findValue(frame,idNode->getId(),idNode->getArrayIndex(),ids->getAttribute());
+      else
+        makeMethodCall(frame,frame.getObjectValue(),idNode->getId(),idNode->getArrayIndex(),ids->getAttribute(),idNode->getExprs(),r);
     }else{
-      method_name=checkIndirectId(frame,method_name);
+      const skString& method_name=checkIndirectId(frame,idNode->getId(),indirect_name);
       skRValue robject;
       SAVE_VARIABLE(robject);
       followIdList(frame,ids,robject);
@@ -638,7 +621,7 @@ skRValue skInterpreter::evaluate(skStackFrame& frame,skExprNode * n)
         makeMethodCall(frame,robject,method_name,idNode->getArrayIndex(),ids->getAttribute(),idNode->getExprs(),r);
       RELEASE_VARIABLE(robject);
     }
-    RELEASE_VARIABLE(method_name);
+    RELEASE_VARIABLE(indirect_name);
     break;
   }
   case s_String:
@@ -33,6 +33,39 @@ EXTERN_TEMPLATE template class CLASSEXPORT skTSHashTable<skMethodDefNode>;
  */
 class CLASSEXPORT skMethodTable : public skTSHashTable<skMethodDefNode>
 {
+ public:
+  /**
+   * default constructor, the table deletes the parse trees in it
+   */
+  skMethodTable()
+    : m_OwnsValues(true){
+  }
+  /**
+   * constructs the table with the given size
+   * @param size - the number of slots in the table
+   * @param owns_values - true if the table deletes the parse trees in it, false if they belong to another table
+   */
+  skMethodTable(USize size,bool owns_values)
+    : skTSHashTable<skMethodDefNode>(size),m_OwnsValues(owns_values){
+  }
+  /**
+   * destructor - the parse trees are only deleted if the table owns them
+   */
+  ~skMethodTable(){
+    if (!m_OwnsValues)
+      clear();
+  }
+ protected:
+  /**
+   * deletes the given parse tree, if the table owns it
+   */
+  void deleteValue(void * value){
+    if (m_OwnsValues)
+      skTSHashTable<skMethodDefNode>::deleteValue(value);
+  }
+ private:
+  /** true if the table deletes the parse trees in it */
+  bool m_OwnsValues;
 };
 
 #endif
@@ -78,11 +78,18 @@ const int NOT_PRESENT_INDEX=0xfff;
  * up to 4k literal chars per method
  * up to 4k lines per method
  * up to 4k ids in a series of field names
+ * up to 4k statements in a statement list, and 4k cases in a switch
+ *
+ * The number of bytes skipped over by a statement list, case list or loop is held in the
+ * whole of the word after its instruction, so the length of a method is not limited.
+ * A method that exceeds the other restrictions fails to compile, rather than producing
+ * corrupted byte code.
  *
  *
  */
-// integers whose absolute value is less than this will be stored directly in the byte code
-const int INLINE_INT=((1<<24)/2);
+// non-negative integers less than this will be stored directly in the byte code, as the
+// first parameter of the instruction
+const int INLINE_INT=(1<<12);
 const int PARAM_MASK=0xffffff;
 const int PARAM1_MASK=0xfff000;
 const int PARAM2_MASK=0x000fff;
@@ -101,13 +108,13 @@ class skCompiledCode
  */
 enum skInstruction{
   b_NullStat,        // param1 = 0                 param2 = line
-  b_StatList,        // param1 = num stats         param2 = number of bytes in stat list
+  b_StatList,        // param1 = num stats         param2 = 0, next word = number of bytes in stat list
   b_Switch,          // param1 = has default       param2 = line
   b_If,              // param1 = has else          param2 = line
   b_Return,          // param1 = has return expr   param2 = line
   b_While,           // param1 = 0                 param2 = line
   b_ForEach,         // param1 = id index          param2 = line
-  b_QualifierIndex,  // param1 = qualifier index   param2 = number of bytes in stat list
+  b_QualifierIndex,  // param1 = qualifier index   param2 = 0, next word = number of bytes in stat list
   b_For,             // param1 = has step expr     param2 = line
   b_Assign,          // param1 = 0                 param2 = line
   b_Method,          // param1 = 0                 param2 = line
@@ -123,13 +130,21 @@ enum skInstruction{
   b_Float,           // param1 = float index
 #endif
   b_Op,              // param1 = op type           param2 = has 2nd expression
-  b_CaseList,        // param1 = number of cases   param2 = number of byte codes in case list
-  b_StatsSize,       // param1 = 0                 param2 = number of bytes in stat list
+  b_CaseList,        // param1 = number of cases   param2 = 0, next word = number of byte codes in case list
+  b_StatsSize,       // param1 = 0                 param2 = 0, next word = number of bytes in stat list
   b_NUMCODES
 };
 
+  skCompiledCode()
+    : m_Overflowed(false){
+  }
   /** add an instruction each parameter is stored in 12 bits (4k)*/
   void addInstruction(skInstruction instruction,int parameter1,int parameter2);
+  /**
+   * Returns true if a parameter or the number of identifiers did not fit in 12 bits, in which
+   * case the byte code is not valid and must not be executed
+   */
+  bool overflowed() const;
   /** add an indentifier
    * @return the index of the indentifier, or 0xfff if the identifier is a blank string
    */
@@ -148,6 +163,18 @@ enum skInstruction{
    */
   int addFloat(float f);
 #endif
+  /**
+   * add a placeholder for the number of bytes skipped over by the preceding instruction
+   */
+  void addByteCount();
+  /**
+   * sets the number of bytes skipped over by the instruction before the given index
+   */
+  void setByteCount(USize pc,USize byte_count);
+  /**
+   * returns the number of bytes skipped over by the instruction before the given index
+   */
+  int getByteCount(USize pc) const;
   /**
    * changes the parameters of the instruction
    */
@@ -161,9 +188,9 @@ enum skInstruction{
    */
   void getInstruction(USize pc,skInstruction& instruction,int& parameter1,bool& parameter2);
   /**
-   * Returns the identifier with the given id
+   * Returns the identifier with the given id, this is a reference into the table of identifiers rather than a copy
    */
-  skString getId(int id);
+  const skString& getId(int id) const;
   /**
    * Returns the literal integer with the given id
    */
@@ -182,6 +209,32 @@ enum skInstruction{
    * Returns the index of the next instruction to be added to the list of instructions
    */
   USize getPC() const;
+  /**
+   * Returns the encoded instruction at the given index, so that the compiled code can be saved
+   */
+  USize getInstructionWord(USize pc) const;
+  /**
+   * Adds an encoded instruction, so that saved compiled code can be restored
+   */
+  void addInstructionWord(USize instruction_word);
+  /**
+   * Returns the number of identifiers
+   */
+  USize numIds() const;
+  /**
+   * Returns the number of literal strings
+   */
+  USize numStrings() const;
+  /**
+   * Returns the number of literal integers
+   */
+  USize numInts() const;
+#ifdef USE_FLOATING_POINT
+  /**
+   * Returns the number of literal floats
+   */
+  USize numFloats() const;
+#endif
 #ifdef _DEBUG_SIZE
   /**
    * Returns the overall memory used by this structure 
@@ -205,6 +258,14 @@ enum skInstruction{
    * The list of identifiers used by the instructions
    */
   skStringList m_Identifiers;
+  /**
+   * A blank identifier, returned for identifiers that are not present
+   */
+  skString m_BlankId;
+  /**
+   * Set if a parameter or the number of identifiers did not fit in 12 bits
+   */
+  bool m_Overflowed;
   /**
    * The list of literal integers used by the instructions
    */
@@ -279,6 +340,11 @@ class  skStatNode : public skParseNode {
    * @exception Symbian - a leaving function
    */
   virtual void compile(skCompiledCode& compiled_code);
+ protected:
+  /** returns the line number to store in the byte code, where later lines are given the last line number that fits in 12 bits */
+  int getCompiledLineNum() const{
+    return m_LineNum<PARAM2_MASK ? m_LineNum : PARAM2_MASK;
+  }
 #endif
 };
 class  skExprNode : public skParseNode {
@@ -432,7 +498,7 @@ class  skIdNode : public skExprNode {
     return s_Id;
   }
 #ifdef EXECUTE_PARSENODES
-  inline skString getId() const{
+  inline const skString& getId() const{
     return m_Id;
   }
 #else
@@ -520,7 +586,7 @@ class  skIdListNode : public skExprNode {
   inline void setAttribute(skString * attr){
     m_Attribute=*attr;
   }
-  inline skString getAttribute() const {
+  inline const skString& getAttribute() const {
     return m_Attribute;
   }
 #else
@@ -840,7 +906,7 @@ class  skForEachNode : public skStatNode {
     return m_Stats;
   }
 #ifdef EXECUTE_PARSENODES
-  inline skString getId() const{
+  inline const skString& getId() const{
     return m_Id;
   }
   inline skString getQualifier() const{
@@ -921,7 +987,7 @@ class  skForNode : public skStatNode {
     return m_Stats;
   }
 #ifdef EXECUTE_PARSENODES
-  inline skString getId() const{
+  inline const skString& getId() const{
     return m_Id;
   }
 #endif
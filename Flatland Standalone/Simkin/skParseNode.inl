@@ -44,6 +44,9 @@ inline void skCompiledCode::moveIdentifiers(skStringList& identifiers)
 //---------------------------------------------------
 {
   m_Identifiers.moveFrom(identifiers);
+  // the last index is reserved for identifiers that are not present
+  if (m_Identifiers.entries()>=(USize)NOT_PRESENT_INDEX)
+    m_Overflowed=true;
 }
 //---------------------------------------------------
 inline void skCompiledCode::getInstruction(USize pc,skInstruction& instruction,int& parameter1,bool& parameter2)
@@ -64,13 +67,12 @@ inline void skCompiledCode::getInstruction(USize pc,skInstruction& instruction,i
 }
   /** parameter stored in lower 24 bits (16mb)*/
 //---------------------------------------------------
-inline skString skCompiledCode::getId(int id)
+inline const skString& skCompiledCode::getId(int id) const
 //---------------------------------------------------
 {
-  skString s;
   if (id!=NOT_PRESENT_INDEX)
-    s=m_Identifiers[id];
-  return s;
+    return m_Identifiers[id];
+  return m_BlankId;
 }
 //---------------------------------------------------
 inline int skCompiledCode::getInt(int id)
@@ -108,9 +110,77 @@ inline USize skCompiledCode::getPC() const
   return m_Instructions.entries();
 }
 //---------------------------------------------------
+inline USize skCompiledCode::getInstructionWord(USize pc) const
+//---------------------------------------------------
+{
+  return m_Instructions[pc];
+}
+//---------------------------------------------------
+inline void skCompiledCode::addInstructionWord(USize instruction_word)
+//---------------------------------------------------
+{
+  m_Instructions.append(instruction_word);
+}
+//---------------------------------------------------
+inline USize skCompiledCode::numIds() const
+//---------------------------------------------------
+{
+  return m_Identifiers.entries();
+}
+//---------------------------------------------------
+inline USize skCompiledCode::numStrings() const
+//---------------------------------------------------
+{
+  return m_LiteralStrings.entries();
+}
+//---------------------------------------------------
+inline USize skCompiledCode::numInts() const
+//---------------------------------------------------
+{
+  return m_LiteralInts.entries();
+}
+#ifdef USE_FLOATING_POINT
+//---------------------------------------------------
+inline USize skCompiledCode::numFloats() const
+//---------------------------------------------------
+{
+  return m_LiteralFloats.entries();
+}
+#endif
+//---------------------------------------------------
+inline void skCompiledCode::addByteCount()
+//---------------------------------------------------
+{
+  m_Instructions.append(0);
+}
+//---------------------------------------------------
+inline void skCompiledCode::setByteCount(USize pc,USize byte_count)
+//---------------------------------------------------
+{
+  m_Instructions[pc]=byte_count;
+}
+//---------------------------------------------------
+inline int skCompiledCode::getByteCount(USize pc) const
+//---------------------------------------------------
+{
+  return (int)m_Instructions[pc];
+}
+//---------------------------------------------------
+inline bool skCompiledCode::overflowed() const
+//---------------------------------------------------
+{
+  return m_Overflowed;
+}
+//---------------------------------------------------
 inline void skCompiledCode::addInstruction(skInstruction instruction,int parameter1,int parameter2)
 //---------------------------------------------------
 {
+  // a parameter outside 12 bits would corrupt the neighbouring fields of the instruction
+  if (parameter1<0 || parameter1>PARAM2_MASK || parameter2<0 || parameter2>PARAM2_MASK){
+    m_Overflowed=true;
+    parameter1&=PARAM2_MASK;
+    parameter2&=PARAM2_MASK;
+  }
   USize ins=(USize)(((long)(instruction)<<24)+(((long)parameter1)<<12)+(long)parameter2);
   m_Instructions.append(ins);
 #ifdef _DEBUG_BYTECODES
@@ -125,6 +195,11 @@ inline void skCompiledCode::addInstruction(skInstruction instruction,int paramet
 inline void skCompiledCode::setInstruction(USize pc,skInstruction instruction,int parameter1,int parameter2)
 //---------------------------------------------------
 {
+  if (parameter1<0 || parameter1>PARAM2_MASK || parameter2<0 || parameter2>PARAM2_MASK){
+    m_Overflowed=true;
+    parameter1&=PARAM2_MASK;
+    parameter2&=PARAM2_MASK;
+  }
   USize ins=(USize)(((USize)(instruction)<<24)|((USize)(parameter1)<<12|(USize)parameter2));
   m_Instructions[pc]=ins;
 #ifdef _DEBUG_BYTECODES
@@ -151,6 +226,8 @@ inline int skCompiledCode::addId(const skString& id)
     if (index==NOT_PRESENT_INDEX){
       index=(int)i;
       m_Identifiers.append(id);
+      // look up any symbol now, rather than when the identifier is first executed
+      id.symbol();
     }
   }
   return index;
@@ -237,24 +314,26 @@ inline void skStatListNode::compile(skCompiledCode& compiled_code)
   USize start_pc=compiled_code.getPC();
   // store placeholder
   compiled_code.addInstruction(skCompiledCode::b_StatList,0,0);
+  compiled_code.addByteCount();
   for (USize i=0;i<m_Stats.entries();i++)
     m_Stats[i]->compile(compiled_code);
   // update placeholder with num entries and num bytes
-  compiled_code.setInstruction(start_pc,skCompiledCode::b_StatList,m_Stats.entries(),compiled_code.getPC()-start_pc);
+  compiled_code.setInstruction(start_pc,skCompiledCode::b_StatList,m_Stats.entries(),0);
+  compiled_code.setByteCount(start_pc+1,compiled_code.getPC()-start_pc);
 }
 //---------------------------------------------------
 inline void skStatNode::compile(skCompiledCode& compiled_code)
 //---------------------------------------------------
 {
   // store a null statement - line number is the parameter
-  compiled_code.addInstruction(skCompiledCode::b_NullStat,0,m_LineNum);
+  compiled_code.addInstruction(skCompiledCode::b_NullStat,0,getCompiledLineNum());
 }
 //---------------------------------------------------
 inline void skSwitchNode::compile(skCompiledCode& compiled_code)
 //---------------------------------------------------
 {
   // store as a parameter whether or not there is a default case and the line number
-  compiled_code.addInstruction(skCompiledCode::b_Switch,(m_Default!=0),m_LineNum);
+  compiled_code.addInstruction(skCompiledCode::b_Switch,(m_Default!=0),getCompiledLineNum());
   m_Expr->compile(compiled_code);
   m_Cases->compile(compiled_code);
   if (m_Default)
@@ -265,7 +344,7 @@ inline void skIfNode::compile(skCompiledCode& compiled_code)
 //---------------------------------------------------
 {
   // store as a parameter whether or not there are else statements and the line number
-  compiled_code.addInstruction(skCompiledCode::b_If,(m_Else!=0),m_LineNum);
+  compiled_code.addInstruction(skCompiledCode::b_If,(m_Else!=0),getCompiledLineNum());
   m_Expr->compile(compiled_code);
   m_Stats->compile(compiled_code);
   if (m_Else)
@@ -276,7 +355,7 @@ inline void skReturnNode::compile(skCompiledCode& compiled_code)
 //---------------------------------------------------
 {
   // store as a parameter whether or not there is a return expression (for future syntax...) and the line number
-  compiled_code.addInstruction(skCompiledCode::b_Return,(m_Expr!=0),m_LineNum);
+  compiled_code.addInstruction(skCompiledCode::b_Return,(m_Expr!=0),getCompiledLineNum());
   if (m_Expr)
     m_Expr->compile(compiled_code);
 }
@@ -285,38 +364,41 @@ inline void skWhileNode::compile(skCompiledCode& compiled_code)
 //---------------------------------------------------
 {
   // store the line number as parameter
-  compiled_code.addInstruction(skCompiledCode::b_While,0,m_LineNum);
+  compiled_code.addInstruction(skCompiledCode::b_While,0,getCompiledLineNum());
   USize size_pc=compiled_code.getPC();
   compiled_code.addInstruction(skCompiledCode::b_StatsSize,0,0);
+  compiled_code.addByteCount();
   m_Expr->compile(compiled_code);
   USize start_pc=compiled_code.getPC();
   m_Stats->compile(compiled_code);
   // update the stat size instruction with the number of bytes in the stats list
-  compiled_code.setInstruction(size_pc,skCompiledCode::b_StatsSize,0,compiled_code.getPC()-start_pc);
+  compiled_code.setByteCount(size_pc+1,compiled_code.getPC()-start_pc);
 }
 //---------------------------------------------------
 inline void skForEachNode::compile(skCompiledCode& compiled_code)
 //---------------------------------------------------
 {
   // this instruction includes the id and qualifier. n.b. this means there is a restriction of 4k different identifiers within a script
-  compiled_code.addInstruction(skCompiledCode::b_ForEach,m_Id,m_LineNum);
+  compiled_code.addInstruction(skCompiledCode::b_ForEach,m_Id,getCompiledLineNum());
   // now store qualifier index
   USize qualifier_pc=compiled_code.getPC();
   compiled_code.addInstruction(skCompiledCode::b_QualifierIndex,m_Qualifier,0);
+  compiled_code.addByteCount();
   m_Expr->compile(compiled_code);
   USize start_pc=compiled_code.getPC();
   m_Stats->compile(compiled_code);
   // update the qualifier instruction with the number of bytes in the stats list
-  compiled_code.setInstruction(qualifier_pc,skCompiledCode::b_QualifierIndex,m_Qualifier,compiled_code.getPC()-start_pc);
+  compiled_code.setByteCount(qualifier_pc+1,compiled_code.getPC()-start_pc);
 }
 //---------------------------------------------------
 inline void skForNode::compile(skCompiledCode& compiled_code)
 //---------------------------------------------------
 {
   // store as a parameter whether or not there is a step expression and the line number
-  compiled_code.addInstruction(skCompiledCode::b_For,(m_StepExpr!=0),m_LineNum);
+  compiled_code.addInstruction(skCompiledCode::b_For,(m_StepExpr!=0),getCompiledLineNum());
   USize size_pc=compiled_code.getPC();
   compiled_code.addInstruction(skCompiledCode::b_StatsSize,0,0);
+  compiled_code.addByteCount();
   // store the loop variable as an id
   compiled_code.addInstruction(skCompiledCode::b_Id,m_Id,false);
   m_StartExpr->compile(compiled_code);
@@ -326,14 +408,14 @@ inline void skForNode::compile(skCompiledCode& compiled_code)
   USize start_pc=compiled_code.getPC();
   m_Stats->compile(compiled_code);
   // update the stat size instruction with the number of bytes in the stats list
-  compiled_code.setInstruction(size_pc,skCompiledCode::b_StatsSize,0,compiled_code.getPC()-start_pc);
+  compiled_code.setByteCount(size_pc+1,compiled_code.getPC()-start_pc);
 }
 //---------------------------------------------------
 inline void skAssignNode::compile(skCompiledCode& compiled_code)
 //---------------------------------------------------
 {
   // store the line number as parameter
-  compiled_code.addInstruction(skCompiledCode::b_Assign,0,m_LineNum);
+  compiled_code.addInstruction(skCompiledCode::b_Assign,0,getCompiledLineNum());
   m_Expr->compile(compiled_code);
   m_Ids->compile(compiled_code);
 }
@@ -342,7 +424,7 @@ inline void skMethodStatNode::compile(skCompiledCode& compiled_code)
 //---------------------------------------------------
 {
   // store the line number as parameter
-  compiled_code.addInstruction(skCompiledCode::b_Method,0,m_LineNum);
+  compiled_code.addInstruction(skCompiledCode::b_Method,0,getCompiledLineNum());
   m_Ids->compile(compiled_code);
 }
 //---------------------------------------------------
@@ -390,7 +472,7 @@ inline void skLiteralNode::compile(skCompiledCode& compiled_code)
     compiled_code.addInstruction(skCompiledCode::b_String,compiled_code.addString(*m_String),0);
     break;
   case s_Integer:{
-    if (abs(m_Int)<INLINE_INT)
+    if (m_Int>=0 && m_Int<INLINE_INT)
       compiled_code.addInstruction(skCompiledCode::b_IntInline,m_Int,0);
     else
       compiled_code.addInstruction(skCompiledCode::b_Int,compiled_code.addInt(m_Int),0);
@@ -423,10 +505,12 @@ inline void skCaseListNode::compile(skCompiledCode& compiled_code)
   USize start_pc=compiled_code.getPC();
   // store placeholder
   compiled_code.addInstruction(skCompiledCode::b_CaseList,0,0);
+  compiled_code.addByteCount();
   for (USize i=0;i<m_Cases.entries();i++)
     m_Cases[i]->compile(compiled_code);
   // update placeholder with num cases and num bytes
-  compiled_code.setInstruction(start_pc,skCompiledCode::b_CaseList,m_Cases.entries(),compiled_code.getPC()-start_pc);
+  compiled_code.setInstruction(start_pc,skCompiledCode::b_CaseList,m_Cases.entries(),0);
+  compiled_code.setByteCount(start_pc+1,compiled_code.getPC()-start_pc);
 }
 //---------------------------------------------------
 inline void skCaseNode::compile(skCompiledCode& compiled_code)
@@ -474,6 +474,12 @@ skMethodDefNode * skParser::parseMethod()
 #ifndef EXECUTE_PARSENODES
       node->getCompiledCode().moveIdentifiers(m_Identifiers);
       node->compile();
+      if (node->getCompiledCode().overflowed()){
+        appendError(skSTR("Method is too large to compile"));
+        clearTempNodes();
+        delete node;
+        return 0;
+      }
 #endif
     }
   }
@@ -505,12 +511,19 @@ skCompiledExprNode * skParser::parseExpression()
     }else{
 #ifdef EXECUTE_PARSENODES
       node=(skExprNode *)m_TopNode;
+      m_TopNode=0;
 #else
       node=(skCompiledExprNode *)m_TopNode;
       node->getCompiledCode().moveIdentifiers(m_Identifiers);
       node->compile();
-#endif
       m_TopNode=0;
+      if (node->getCompiledCode().overflowed()){
+        appendError(skSTR("Expression is too large to compile"));
+        clearTempNodes();
+        delete node;
+        return 0;
+      }
+#endif
     }
   }
   if (node)
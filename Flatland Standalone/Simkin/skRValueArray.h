@@ -28,7 +28,12 @@ Copyright 1996-2002 Simon Whiteside
 EXTERN_TEMPLATE template class CLASSEXPORT skTVAList<skRValue>;
 #endif
 /**
- * This class provides an array of RValues
+ * The number of RValues an skRValueArray can hold before it needs to allocate memory
+ */
+const USize INLINE_RVALUE_ARRAY_SIZE=4;
+/**
+ * This class provides an array of RValues. The first few values are held within the array object itself, so that
+ * passing a few arguments to a method doesn't allocate any memory
  */
 class CLASSEXPORT skRValueArray	: public skTVAList<skRValue>
 { 
@@ -37,10 +42,31 @@ class CLASSEXPORT skRValueArray	: public skTVAList<skRValue>
    * Default Constructor: creates an array of zero size
    */
   inline skRValueArray() 
+    : skTVAList<skRValue>(m_InlineValues,INLINE_RVALUE_ARRAY_SIZE)
+    {
+    }
+  /**
+   * Copy Constructor - copies the values in the other array into this one
+   */
+  inline skRValueArray(const skRValueArray& a) 
+    : skTVAList<skRValue>(m_InlineValues,INLINE_RVALUE_ARRAY_SIZE)
     {
+      skTVAList<skRValue>::operator=(a);
     }
+  /**
+   * Assignment operator - copies the values in the other array into this one
+   */
+  inline skRValueArray& operator=(const skRValueArray& a){
+    skTVAList<skRValue>::operator=(a);
+    return *this;
+  }
   virtual ~skRValueArray(){
   }
+ private:
+  /**
+   * the values held before an array is allocated
+   */
+  skRValue m_InlineValues[INLINE_RVALUE_ARRAY_SIZE];
 };
 #endif
 
@@ -22,6 +22,7 @@
 #define skSTACKFRAME_H
 
 #include "skString.h"
+#include "skRValue.h"
 
 class CLASSEXPORT skiExecutable;
 class CLASSEXPORT skRValueTable;
@@ -69,6 +70,12 @@ public:
    * @return the owning object
    */
   skiExecutable *       getObject() const;
+  /** returns the object owning the stack frame as an RValue. This is created when first needed and kept for
+   * the life of the frame, so that looking up fields and calling methods on the object doesn't allocate an RValue
+   * each time. The caller must not change it.
+   * @return the owning object
+   */
+  skRValue&             getObjectValue();
   /** returns the local variables for this stack frame 
    * @return the current local variables
    */
@@ -103,6 +110,8 @@ private:
   skExecutableContext&  m_Context;
   /** the owner of the current code */
   skiExecutable *       m_Object;
+  /** the owner of the current code as an RValue, if it has been asked for */
+  skRValue              m_ObjectValue;
   /** local variables for this frame */
   skRValueTable&        m_Vars;
   /** parent stack frame */
@@ -140,6 +149,14 @@ inline skiExecutable * skStackFrame::getObject() const
   return m_Object;
 }
 //------------------------------------------
+inline skRValue& skStackFrame::getObjectValue()
+//------------------------------------------
+{
+  if (m_ObjectValue.type()!=skRValue::T_Object)
+    m_ObjectValue.assignObject(m_Object);
+  return m_ObjectValue;
+}
+//------------------------------------------
 inline skRValueTable& skStackFrame::getVars() const
 //------------------------------------------
 {
@@ -33,6 +33,7 @@ void P_String::init()
     buffer++;
   }
   m_Length=(USize)STRLEN(m_PString);
+  m_Symbol=-1;
 }
 #ifndef __SYMBIAN32__
 // This can leave, so not available in Symbian
@@ -42,13 +43,11 @@ skString::skString(const Char repeatChar, USize len)
 {
   // create skString of length len with repeated unsigned char
   pimp=skNEW(P_String);
-  pimp->s.m_Const=false;
-  Char * str = skARRAY_NEW(Char,len+1);
+  Char * str = pimp->allocate(len);
   USize i;
   for (i = 0; i < len; i++)
     str[i] = repeatChar;
   str[i] = 0;   // NULL string terminator
-  pimp->m_PString=str;
   pimp->init();
 }
 #endif
@@ -117,16 +116,14 @@ EXPORT_C skString skString::substr(USize start,USize s_length) const
       str=*this;
     }else{
       if (start <= length()){
-        Char * buffer=skARRAY_NEW(Char,s_length+1);
-        SAVE_POINTER(buffer);
+        P_String * pnew=skNEW(P_String);
+        SAVE_POINTER(pnew);
+        Char * buffer=pnew->allocate(s_length);
         STRNCPY(buffer,pimp->m_PString+start,s_length);
         buffer[s_length]=0;
-        P_String * pnew=skNEW(P_String);
-        pnew->s.m_Const=false;
-        pnew->m_PString=buffer;
         // call internal non-copying constructor
         str=skString(pnew);
-        RELEASE_POINTER(buffer);
+        RELEASE_POINTER(pnew);
       }
     }
   }
@@ -163,17 +160,15 @@ EXPORT_C skString operator+(const TDesC& s1,const skString& s2)
 EXPORT_C skString operator+(const Char * s1,const skString& s2)
   //---------------------------------------------------
 {
-  USize len=STRLEN(s1)+s2.length()+1;
-  Char * buffer=skARRAY_NEW(Char,len);
-  SAVE_POINTER(buffer);
+  USize len=STRLEN(s1)+s2.length();
+  P_String * pnew=skNEW(P_String);
+  SAVE_POINTER(pnew);
+  Char * buffer=pnew->allocate(len);
   STRCPY(buffer,s1);
   STRCAT(buffer,s2.c_str());
-  P_String * pnew=skNEW(P_String);
-  pnew->s.m_Const=false;
-  pnew->m_PString=buffer;
   // call internal non-copying constructor
   skString str=skString(pnew);
-  RELEASE_POINTER(buffer);
+  RELEASE_POINTER(pnew);
   return str;
 }
 //---------------------------------------------------
@@ -181,20 +176,18 @@ EXPORT_C skString skString::operator+(const skString& s)  const
   //---------------------------------------------------
 {
   if (pimp || s.pimp){
-    USize len=length()+s.length()+1;
-    Char * buffer=skARRAY_NEW(Char,len);
+    USize len=length()+s.length();
+    P_String * pnew=skNEW(P_String);
+    SAVE_POINTER(pnew);
+    Char * buffer=pnew->allocate(len);
     buffer[0]=0;
-    SAVE_POINTER(buffer);
     if (pimp)
       STRCPY(buffer,pimp->m_PString);
     if (s.pimp)
       STRCAT(buffer,s.pimp->m_PString);
-    P_String * pnew=skNEW(P_String);
-    pnew->s.m_Const=false;
-    pnew->m_PString=buffer;
     // call internal non-copying constructor
     skString str=skString(pnew);
-    RELEASE_POINTER(buffer);
+    RELEASE_POINTER(pnew);
     return str;
   }else{
     return skString();
@@ -388,8 +381,7 @@ EXPORT_C void skString::assign(const Char * s,int len)
   if (s){
     if (len){
       pimp=skNEW(P_String);
-      pimp->m_PString=skARRAY_NEW(Char,len+1);
-      pimp->s.m_Const=false;
+      pimp->allocate(len);
       memcpy(pimp->m_PString,s,sizeof(Char)*len);
       pimp->m_PString[len]=0;
       pimp->init();
@@ -397,8 +389,7 @@ EXPORT_C void skString::assign(const Char * s,int len)
       int s_len=STRLEN(s);
       if (s_len){
         pimp=skNEW(P_String);
-        pimp->m_PString=skARRAY_NEW(Char,s_len+1);
-        pimp->s.m_Const=false;
+        pimp->allocate(s_len);
         STRCPY((Char *)pimp->m_PString,s);
         pimp->init();
       }else{
@@ -769,5 +760,75 @@ EXPORT_C void skString::replaceInPlace(Char old_char,Char new_char)
         pimp->m_PString[i]=new_char;
       }
     }
+    pimp->m_Symbol=-1;
+  }
+}
+/**
+ * A registered symbol, chained into a bucket by the hash and length of its name
+ */
+struct skSymbolEntry
+{
+  const Char * m_Name;
+  USize m_Length;
+  int m_Symbol;
+  skSymbolEntry * m_Next;
+};
+static const USize SYMBOL_BUCKETS=64;
+static skSymbolEntry * g_SymbolBuckets[SYMBOL_BUCKETS];
+//---------------------------------------------------
+static USize symbolBucket(unsigned hash,USize length)
+  //---------------------------------------------------
+{
+  return (hash^length)%SYMBOL_BUCKETS;
+}
+//---------------------------------------------------
+EXPORT_C void skString::addSymbol(const Char * name,int symbol)
+  //---------------------------------------------------
+{
+  // use the same hash as P_String::init
+  unsigned hash=0;
+  const Char * buffer=name;
+  while (*buffer){
+    hash^=*buffer;
+    buffer++;
+  }
+  hash&=0xffff;
+  skSymbolEntry * entry=skNEW(skSymbolEntry);
+  entry->m_Name=name;
+  entry->m_Length=(USize)STRLEN(name);
+  entry->m_Symbol=symbol;
+  USize bucket=symbolBucket(hash,entry->m_Length);
+  entry->m_Next=g_SymbolBuckets[bucket];
+  g_SymbolBuckets[bucket]=entry;
+}
+//---------------------------------------------------
+EXPORT_C void skString::clearSymbols()
+  //---------------------------------------------------
+{
+  for (USize bucket=0;bucket<SYMBOL_BUCKETS;bucket++){
+    skSymbolEntry * entry=g_SymbolBuckets[bucket];
+    while (entry){
+      skSymbolEntry * next=entry->m_Next;
+      delete entry;
+      entry=next;
+    }
+    g_SymbolBuckets[bucket]=0;
+  }
+}
+//---------------------------------------------------
+EXPORT_C int skString::findSymbol() const
+  //---------------------------------------------------
+{
+  int symbol=0;
+  if (pimp){
+    skSymbolEntry * entry=g_SymbolBuckets[symbolBucket(pimp->s.m_Hash,pimp->m_Length)];
+    while (entry){
+      if (entry->m_Length==pimp->m_Length && STRCMP(entry->m_Name,pimp->m_PString)==0){
+        symbol=entry->m_Symbol;
+        break;
+      }
+      entry=entry->m_Next;
+    }
   }
+  return symbol;
 }
@@ -181,6 +181,23 @@ class CLASSEXPORT skString
    * Returns a hash value for this string
    */
   inline USize hash() const;
+  /**
+   * Returns the symbol registered for this string with addSymbol, or 0 if there is none.
+   * The symbol is looked up once and kept in the P_String object, so copies of an identifier share the lookup
+   */
+  inline int symbol() const;
+  /**
+   * Registers a symbol for a name, so that a host object can dispatch on an integer rather than comparing strings.
+   * Symbols should be registered before any scripts are parsed.
+   * @param name - the name, which is *not* copied
+   * @param symbol - the symbol, which must be greater than 0
+   */
+  static IMPORT_C void addSymbol(const Char * name,int symbol);
+  /**
+   * Removes all the symbols registered with addSymbol. Strings that have already looked up their symbol keep it, so the
+   * same symbols should be registered again before any more scripts are run.
+   */
+  static IMPORT_C void clearSymbols();
   /**
    * Returns a character within the string
    * @param index - the index of the character, starting at 0
@@ -411,6 +428,12 @@ class CLASSEXPORT skString
    * This method replaces a character with a different one within this string. The underlying data *is* modified
    */
   IMPORT_C void replaceInPlace(Char old_char,Char new_char);
+ private:
+  /**
+   * Finds the symbol registered for this string, or 0 if there is none
+   */
+  IMPORT_C int findSymbol() const;
+ public:
 #ifdef __SYMBIAN32__
   /**
    * Conversion operator to Symbian TCleanupItem. This is provided to allow this object to be pushed by value onto the 
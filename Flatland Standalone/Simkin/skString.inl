@@ -28,6 +28,9 @@
 #include <ctype.h>
 #endif
 
+/** strings shorter than this are stored within the P_String, rather than in a separately allocated buffer */
+const USize SHORT_STRING_SIZE=16;
+
 class   P_String 
 {
 public:
@@ -39,10 +42,16 @@ public:
   unsigned m_RefCount:15;
   unsigned m_Const:1;
   } s;
+  /** symbol registered for this string, or -1 if it hasn't been looked up yet */
+  int m_Symbol;
+  /** buffer for short strings */
+  Char m_ShortString[SHORT_STRING_SIZE];
   
   inline P_String();
   inline ~P_String();
   void init();
+  /** sets up a buffer for a string of the given length (plus the terminator), and returns it */
+  inline Char * allocate(USize len);
 
 };    
 
@@ -98,6 +107,7 @@ inline P_String::P_String()
   s.m_RefCount=1;
   s.m_Const=true;
   m_Length=0;
+  m_Symbol=-1;
 }
 //---------------------------------------------------
 inline skString::skString(const skString& s) 
@@ -117,9 +127,20 @@ inline skString::~skString()
 inline P_String::~P_String() 
   //---------------------------------------------------
 { 
-  if (s.m_Const==0) 
+  if (s.m_Const==0 && m_PString!=m_ShortString) 
     delete [] m_PString; 
 }
+//---------------------------------------------------
+inline Char * P_String::allocate(USize len)
+  //---------------------------------------------------
+{ 
+  if (len<SHORT_STRING_SIZE)
+    m_PString=m_ShortString;
+  else
+    m_PString=skARRAY_NEW(Char,len+1);
+  s.m_Const=false;
+  return m_PString;
+}
 #ifndef __SYMBIAN32__
 // This can leave, so not available in Symbian
 //---------------------------------------------------
@@ -248,6 +269,18 @@ inline USize skString::hash() const
   return hash;
 }
 //---------------------------------------------------
+inline int skString::symbol() const 
+  //---------------------------------------------------
+{
+  int symbol=0;
+  if (pimp){
+    if (pimp->m_Symbol<0)
+      pimp->m_Symbol=findSymbol();
+    symbol=pimp->m_Symbol;
+  }
+  return symbol;
+}
+//---------------------------------------------------
 inline Char skString::at(USize index) const
 //---------------------------------------------------
 {
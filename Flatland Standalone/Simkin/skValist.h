@@ -132,6 +132,13 @@ template <class T> class CLASSEXPORT skTVAList
   static void Cleanup(TAny * s);
 #endif
  protected:
+  /**
+   * Constructor - creates an empty list which keeps its items in the given array until it needs to grow beyond it.
+   * The array belongs to the caller and must last as long as the list
+   * @param fixed_array - the array
+   * @param fixed_size - the number of items the array can hold
+   */
+  skTVAList(T * fixed_array,USize fixed_size);
   /**
    * returns the index of the given item in the list, or -1 if not found
    */
@@ -146,6 +153,10 @@ template <class T> class CLASSEXPORT skTVAList
    * @exception a Symbian - a leaving function
    */
   void createArray();
+  /**
+   * Deletes the underlying array, unless it is the fixed array
+   */
+  void deleteArray();
   /**
    * the array used to represent the list
    */
@@ -158,6 +169,14 @@ template <class T> class CLASSEXPORT skTVAList
    * the number of items being used in the list
    */
   USize m_Entries;
+  /**
+   * the array supplied by a derived class, or 0
+   */
+  T*  m_FixedArray;
+  /**
+   * the size of the fixed array
+   */
+  USize m_FixedSize;
 };        
 
 #ifdef __gnuc__
@@ -170,14 +189,20 @@ template <class T> class CLASSEXPORT skTVAList
 //-----------------------------------------------------------------
 skTVALIST_PRE inline skTVAList<T>::skTVAList()
 //-----------------------------------------------------------------
-  :m_Array(0),m_ArraySize(0),m_Entries(0)
+  :m_Array(0),m_ArraySize(0),m_Entries(0),m_FixedArray(0),m_FixedSize(0)
+{
+}
+//-----------------------------------------------------------------
+skTVALIST_PRE inline skTVAList<T>::skTVAList(T * fixed_array,USize fixed_size)
+//-----------------------------------------------------------------
+  :m_Array(fixed_array),m_ArraySize(fixed_size),m_Entries(0),m_FixedArray(fixed_array),m_FixedSize(fixed_size)
 {
 }
 #ifndef __SYMBIAN32__
 //-----------------------------------------------------------------
 skTVALIST_PRE inline skTVAList<T>::skTVAList(const skTVAList& l)
 //-----------------------------------------------------------------
-  : m_ArraySize(l.m_ArraySize),m_Entries(l.m_Entries)
+  : m_ArraySize(l.m_ArraySize),m_Entries(l.m_Entries),m_FixedArray(0),m_FixedSize(0)
 {
   if(m_ArraySize){
     m_Array=skARRAY_NEW(T,m_ArraySize);
@@ -191,7 +216,13 @@ skTVALIST_PRE inline skTVAList<T>::skTVAList(const skTVAList& l)
 skTVALIST_PRE inline skTVAList<T>::~skTVAList()
 //-----------------------------------------------------------------
 {
-  if(m_Array)
+  deleteArray();
+}
+//-----------------------------------------------------------------
+skTVALIST_PRE inline void skTVAList<T>::deleteArray()
+//-----------------------------------------------------------------
+{
+  if(m_Array && m_Array!=m_FixedArray)
     delete [] m_Array;
 }
 //-----------------------------------------------------------------
@@ -207,11 +238,14 @@ skTVALIST_PRE inline void skTVAList<T>::createArray()
 skTVALIST_PRE inline void skTVAList<T>::clear()
 //-----------------------------------------------------------------
 {
+  // release the items in the fixed array, since it is not deleted
+  if (m_Array==m_FixedArray)
+    for (USize x=0;x<m_Entries;x++)
+      m_Array[x]=T();
   m_Entries=0;
-  if(m_Array)
-    delete [] m_Array;
-  m_Array=0;
-  m_ArraySize=0;
+  deleteArray();
+  m_Array=m_FixedArray;
+  m_ArraySize=m_FixedSize;
 }
 //-----------------------------------------------------------------
 skTVALIST_PRE inline USize skTVAList<T>::entries() const
@@ -332,13 +366,22 @@ skTVALIST_PRE void skTVAList<T>::moveFrom(skTVAList<T>& l)
 {
   if (&l!=this){
     clear();
-    // transfer the other list's contents across to us
-    m_ArraySize=l.m_ArraySize;
-    m_Entries=l.m_Entries;
-    m_Array=l.m_Array;
-    l.m_ArraySize=0;
-    l.m_Entries=0;
-    l.m_Array=0;
+    if (l.m_Array==l.m_FixedArray){
+      // the other list's fixed array can't be taken, so copy its contents instead
+      growTo(l.m_Entries);
+      for (USize x=0;x<l.m_Entries;x++)
+        m_Array[x]=l.m_Array[x];
+      m_Entries=l.m_Entries;
+      l.clear();
+    }else{
+      // transfer the other list's contents across to us
+      m_ArraySize=l.m_ArraySize;
+      m_Entries=l.m_Entries;
+      m_Array=l.m_Array;
+      l.m_ArraySize=l.m_FixedSize;
+      l.m_Entries=0;
+      l.m_Array=l.m_FixedArray;
+    }
   }
 }
 //-----------------------------------------------------------------
@@ -347,16 +390,14 @@ skTVALIST_PRE skTVAList<T>& skTVAList<T>::operator=(const skTVAList<T>& l)
 {
   if (&l!=this){
     clear();
-    m_ArraySize=l.m_Entries;
-    m_Entries=l.m_Entries;
-    if(m_Entries){
-      m_Array=skARRAY_NEW(T,m_Entries);
-      for (USize x=0;x<m_Entries;x++)           
-        m_Array[x]=l.m_Array[x];
-    }else{
-      m_Array=0;        // don't allocate until needed
-      m_ArraySize=0;
+    // don't allocate until needed, or if the fixed array is big enough
+    if (l.m_Entries>m_ArraySize){
+      m_ArraySize=l.m_Entries;
+      m_Array=skARRAY_NEW(T,m_ArraySize);
     }
+    m_Entries=l.m_Entries;
+    for (USize x=0;x<m_Entries;x++)           
+      m_Array[x]=l.m_Array[x];
   }
   return *this;
 }
@@ -380,7 +421,7 @@ skTVALIST_PRE void skTVAList<T>::grow()
   if(m_Array){
     for (USize x=0;x<m_Entries;x++)             
       new_array[x]=m_Array[x];
-    delete [] m_Array;
+    deleteArray();
   }
   m_Array=new_array;
 }
@@ -395,7 +436,7 @@ skTVALIST_PRE void skTVAList<T>::growTo(USize new_size)
     if(m_Array){
       for (USize x=0;x<m_Entries;x++)           
         new_array[x]=m_Array[x];
-      delete [] m_Array;
+      deleteArray();
     }
     m_Array=new_array;
   }
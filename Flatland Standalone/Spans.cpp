@@ -18,12 +18,34 @@
 
 static cache *image_cache_list[IMAGE_SIZES];
 
+// Maximum number of bytes the image caches may use (0 if they only keep what
+// each frame needs), and the number of bytes they currently use.
+
+static int cache_byte_budget;
+static int cache_bytes;
+
+// Flag indicating whether texels are shaded as they are drawn, in which case
+// only a full brightness lit image is cached for each pixmap.
+
+bool shade_texels;
+
+// Image cache hit, miss and eviction counters.
+
+int cache_hits;
+int cache_misses;
+int cache_evictions;
+
 // Dimensions of each image size.
 
 int image_dimensions_list[IMAGE_SIZES] = { 
 	2048, 1024, 512, 256, 128, 64, 32, 16, 8, 4, 2
 };
 
+// File that the polygon spans are written to as they are added to the span
+// buffer, if any.
+
+static FILE *span_stream_fp;
+
 #ifdef STREAMING_MEDIA
 
 // Semaphore for pixmap image updating.
@@ -32,6 +54,24 @@ void *image_updated_semaphore;
 
 #endif
 
+//------------------------------------------------------------------------------
+// Return the number of bytes used by a cache entry of the given image size.
+// This must match the size of the image buffer that the cache entry creates.
+//------------------------------------------------------------------------------
+
+static int
+get_cache_entry_size(int size_index)
+{
+	int image_dimensions;
+
+	// Hardware textures are always 32 bits per texel.
+
+	image_dimensions = image_dimensions_list[size_index];
+	if (hardware_acceleration)
+		return(image_dimensions * image_dimensions * 4);
+	return(get_lit_image_size(image_dimensions, NULL));
+}
+
 //------------------------------------------------------------------------------
 // Create the image caches.
 //------------------------------------------------------------------------------
@@ -39,9 +79,30 @@ void *image_updated_semaphore;
 bool
 create_image_caches(void)
 {
-	for (int size_index = 0; size_index < IMAGE_SIZES; size_index++)
+	// Set the byte budget from the texture cache size, which is in megabytes,
+	// and reset the byte count and counters.
+
+	cache_byte_budget = texture_cache_size.get() << 20;
+	cache_bytes = 0;
+	cache_hits = 0;
+	cache_misses = 0;
+	cache_evictions = 0;
+
+	// Latch the texel shading option, so that it can't change while the image
+	// caches exist.
+
+	shade_texels = texel_shading.get();
+
+	// Create the image caches, and set the size of their cache entries now
+	// so that the first cache entry of each size is counted against the byte
+	// budget.
+
+	for (int size_index = 0; size_index < IMAGE_SIZES; size_index++) {
 		if ((image_cache_list[size_index] = new cache(size_index)) == NULL)
 			return(false);
+		image_cache_list[size_index]->cache_entry_size =
+			get_cache_entry_size(size_index);
+	}
 	return(true);
 }
 
@@ -53,8 +114,35 @@ void
 delete_image_caches(void)
 {
 	for (int size_index = 0; size_index < IMAGE_SIZES; size_index++)
-		if (image_cache_list[size_index])
+		if (image_cache_list[size_index]) {
 			delete image_cache_list[size_index];
+			image_cache_list[size_index] = NULL;
+		}
+}
+
+//------------------------------------------------------------------------------
+// Release the cache entries used by a pixmap, so that they can be reused.
+//------------------------------------------------------------------------------
+
+void
+release_cache_entries(pixmap *pixmap_ptr)
+{
+	cache *image_cache_ptr;
+	cache_entry *cache_entry_ptr;
+	int index;
+
+	for (index = 0; index < BRIGHTNESS_LEVELS; index++) {
+		cache_entry_ptr = pixmap_ptr->cache_entry_list[index];
+		if (cache_entry_ptr != NULL) {
+			image_cache_ptr = image_cache_list[pixmap_ptr->size_index];
+			if (image_cache_ptr != NULL)
+				image_cache_ptr->free_cache_entry(cache_entry_ptr);
+			else {
+				cache_entry_ptr->pixmap_ptr = NULL;
+				pixmap_ptr->cache_entry_list[index] = NULL;
+			}
+		}
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -102,6 +190,51 @@ set_size_indices(texture *texture_ptr)
 			pixmap_list[pixmap_no].size_index = size_index;	
 }
 
+//------------------------------------------------------------------------------
+// Evict a cache entry, removing it's reference from the pixmap that has been
+// using it.
+//------------------------------------------------------------------------------
+
+static void
+evict_cache_entry(cache_entry *cache_entry_ptr)
+{
+	pixmap *pixmap_ptr = cache_entry_ptr->pixmap_ptr;
+	if (pixmap_ptr != NULL) {
+		pixmap_ptr->cache_entry_list[cache_entry_ptr->brightness_index] = NULL;
+		cache_entry_ptr->pixmap_ptr = NULL;
+	}
+	cache_evictions++;
+}
+
+//------------------------------------------------------------------------------
+// Return a pointer to the image cache with the least recently used cache entry
+// that wasn't referenced in this frame, or NULL if there is none.  Caches with
+// free cache entries are returned first, since they cost nothing to evict.
+//------------------------------------------------------------------------------
+
+static cache *
+get_least_recently_used_cache(void)
+{
+	cache *image_cache_ptr;
+	cache *oldest_image_cache_ptr;
+	int oldest_frame_no;
+	int size_index;
+
+	oldest_image_cache_ptr = NULL;
+	oldest_frame_no = frames_rendered;
+	for (size_index = 0; size_index < IMAGE_SIZES; size_index++) {
+		image_cache_ptr = image_cache_list[size_index];
+		if (image_cache_ptr->free_cache_entry_list != NULL)
+			return(image_cache_ptr);
+		if (image_cache_ptr->last_cache_entry_ptr != NULL &&
+			image_cache_ptr->last_cache_entry_ptr->frame_no < oldest_frame_no) {
+			oldest_image_cache_ptr = image_cache_ptr;
+			oldest_frame_no = image_cache_ptr->last_cache_entry_ptr->frame_no;
+		}
+	}
+	return(oldest_image_cache_ptr);
+}
+
 //------------------------------------------------------------------------------
 // Get the next free cache entry for the given image size.
 //------------------------------------------------------------------------------
@@ -110,63 +243,74 @@ static cache_entry *
 get_free_cache_entry(int size_index)
 {
 	cache *image_cache_ptr;
+	cache *lru_image_cache_ptr;
 	cache_entry *cache_entry_ptr;
-	cache_entry *free_cache_entry_ptr;
-	cache_entry *oldest_cache_entry_ptr;
-	int oldest_frame_no;
 
-	// Search for the first free texture cache entry, and the oldest entry that
-	// wasn't created in this frame.
+	// If there is a free cache entry for this image size, use it.
 
 	image_cache_ptr = image_cache_list[size_index];
-	free_cache_entry_ptr = NULL;
-	oldest_cache_entry_ptr = NULL;
-	oldest_frame_no = frames_rendered;
-	cache_entry_ptr = image_cache_ptr->cache_entry_list;
-	while (cache_entry_ptr != NULL) {
-		if (cache_entry_ptr->pixmap_ptr == NULL) {
-			free_cache_entry_ptr = cache_entry_ptr;
-			break;
-		}
-		if (cache_entry_ptr->frame_no < oldest_frame_no) {
-			oldest_cache_entry_ptr = cache_entry_ptr;
-			oldest_frame_no = cache_entry_ptr->frame_no;
+	if ((cache_entry_ptr = image_cache_ptr->get_free_cache_entry()) != NULL)
+		return(cache_entry_ptr);
+
+	// While adding a new cache entry would exceed the byte budget, evict the
+	// least recently used cache entry across all image sizes.  If it's the
+	// same size, reuse it; otherwise delete it to make room.  Cache entries
+	// referenced in this frame are never evicted, so the byte budget may be
+	// exceeded if a single frame needs more.
+
+	while (cache_byte_budget > 0 && 
+		cache_bytes + image_cache_ptr->cache_entry_size > cache_byte_budget &&
+		(lru_image_cache_ptr = get_least_recently_used_cache()) != NULL) {
+		if (lru_image_cache_ptr->free_cache_entry_list == NULL) {
+			cache_entry_ptr = lru_image_cache_ptr->last_cache_entry_ptr;
+			evict_cache_entry(cache_entry_ptr);
+			if (lru_image_cache_ptr == image_cache_ptr) {
+				image_cache_ptr->touch_cache_entry(cache_entry_ptr);
+				return(cache_entry_ptr);
+			}
+			lru_image_cache_ptr->free_cache_entry(cache_entry_ptr);
 		}
-		cache_entry_ptr = cache_entry_ptr->next_cache_entry_ptr;
+		lru_image_cache_ptr->delete_free_cache_entry();
+		cache_bytes -= lru_image_cache_ptr->cache_entry_size;
 	}
 
-	// If there is no free cache entry...
+	// If there is no byte budget, reuse the least recently used cache entry
+	// for this image size if it wasn't referenced in this frame.
 
-	if (free_cache_entry_ptr == NULL) {
-
-		// If there is no oldest cache entry, add a new cache entry to the list.
-		// If this fails, reuse the first cache entry in the list.
-
-		if (oldest_cache_entry_ptr == NULL && (free_cache_entry_ptr = 
-			image_cache_list[size_index]->add_cache_entry()) == NULL)
-			oldest_cache_entry_ptr = image_cache_ptr->cache_entry_list;
+	cache_entry_ptr = image_cache_ptr->last_cache_entry_ptr;
+	if (cache_byte_budget == 0 && cache_entry_ptr != NULL &&
+		cache_entry_ptr->frame_no < frames_rendered) {
+		evict_cache_entry(cache_entry_ptr);
+		image_cache_ptr->touch_cache_entry(cache_entry_ptr);
+		return(cache_entry_ptr);
+	}
 
-		// If we're reusing a cache entry, remove it's reference from the pixmap
-		// that has been using it.
+	// Add a new cache entry to the list.
 
-		if (oldest_cache_entry_ptr != NULL) {
-			pixmap *oldest_pixmap_ptr;
-			int oldest_brightness_index;
-			
-			oldest_pixmap_ptr = oldest_cache_entry_ptr->pixmap_ptr;
-			oldest_brightness_index = oldest_cache_entry_ptr->brightness_index;
-			oldest_pixmap_ptr->cache_entry_list[oldest_brightness_index] = NULL;
-			free_cache_entry_ptr = oldest_cache_entry_ptr;
-		}
+	if ((cache_entry_ptr = image_cache_ptr->add_cache_entry()) != NULL) {
+		cache_bytes += image_cache_ptr->cache_entry_size;
+		return(cache_entry_ptr);
 	}
 
-	// Return a pointer to the free cache entry.
+	// If we are out of memory, reuse the least recently used cache entry for
+	// this image size that wasn't referenced in this frame.  If there is none,
+	// NULL is returned.
 
-	return(free_cache_entry_ptr);
+	cache_entry_ptr = image_cache_ptr->last_cache_entry_ptr;
+	while (cache_entry_ptr != NULL && cache_entry_ptr->frame_no == frames_rendered)
+		cache_entry_ptr = cache_entry_ptr->prev_cache_entry_ptr;
+	if (cache_entry_ptr != NULL) {
+		evict_cache_entry(cache_entry_ptr);
+		image_cache_ptr->touch_cache_entry(cache_entry_ptr);
+	}
+	return(cache_entry_ptr);
 }
 
 //------------------------------------------------------------------------------
-// Return a cache entry for the given pixmap at the given brightness index.
+// Return a cache entry for the given pixmap at the given brightness index.  If
+// texels are being shaded in software, the full brightness entry is returned.
+// NULL is returned if there is no memory for the cache entry, and every
+// existing one of the same size is in use this frame.
 //------------------------------------------------------------------------------
 
 cache_entry *
@@ -176,6 +320,12 @@ get_cache_entry(pixmap *pixmap_ptr, int brightness_index)
 	int size_index;
 	int image_dimensions;
 
+	// If texels are being shaded in software, use the full brightness lit
+	// image.
+
+	if (shade_texels && !hardware_acceleration)
+		brightness_index = 0;
+
 	// If the cache entry already exists, return a pointer to it, after
 	// updating the frame number.
 
@@ -202,16 +352,24 @@ get_cache_entry(pixmap *pixmap_ptr, int brightness_index)
 
 #endif
 
-		// Update the frame number and return a pointer to the cache entry.
+		// On the first reference in this frame, count a cache hit, update
+		// the frame number and make the cache entry the most recently used.
 
-		cache_entry_ptr->frame_no = frames_rendered;
+		if (cache_entry_ptr->frame_no != frames_rendered) {
+			cache_hits++;
+			cache_entry_ptr->frame_no = frames_rendered;
+			image_cache_list[pixmap_ptr->size_index]->touch_cache_entry(
+				cache_entry_ptr);
+		}
 		return(cache_entry_ptr);
 	}
 
 	// Get a free cache entry for this lit image, and initialise it.
 
+	cache_misses++;
 	size_index = pixmap_ptr->size_index;
-	cache_entry_ptr = get_free_cache_entry(size_index);
+	if ((cache_entry_ptr = get_free_cache_entry(size_index)) == NULL)
+		return(NULL);
 	image_dimensions = image_dimensions_list[size_index];
 	cache_entry_ptr->lit_image_mask = (image_dimensions - 1) << FRAC_BITS;
 	cache_entry_ptr->lit_image_shift = FRAC_BITS - (IMAGE_SIZES - size_index);
@@ -236,6 +394,19 @@ get_cache_entry(pixmap *pixmap_ptr, int brightness_index)
 	return(cache_entry_ptr);
 }
 
+//------------------------------------------------------------------------------
+// Determine whether a span is opaque: either it's a solid colour span (no
+// texture), the pixmap is opaque (no transparent colour index), or it's a sky
+// span (1/tz = 0).
+//------------------------------------------------------------------------------
+
+static bool
+span_is_opaque(span *span_ptr, pixmap *pixmap_ptr)
+{
+	return(pixmap_ptr == NULL || pixmap_ptr->transparent_index == -1 ||
+		span_ptr->start_span.one_on_tz == 0.0f);
+}
+
 //------------------------------------------------------------------------------
 // Insert a span into a span buffer row.
 //------------------------------------------------------------------------------
@@ -245,11 +416,9 @@ insert_span(span_row *span_row_ptr, span *prev_span_ptr, span *new_span_ptr,
 			pixmap *pixmap_ptr)
 {
 
-	// If we have a solid colour span (no texture), the pixmap is opaque
-	// (no transparent colour index), or we have a sky span (1/tz = 0)...
+	// If the span is opaque...
 
-	if (pixmap_ptr == NULL || pixmap_ptr->transparent_index == -1 ||
-		new_span_ptr->start_span.one_on_tz == 0.0f) {
+	if (span_is_opaque(new_span_ptr, pixmap_ptr)) {
 
 		// If there is a previous span, add the new span after the
 		// previous span.
@@ -278,10 +447,197 @@ insert_span(span_row *span_row_ptr, span *prev_span_ptr, span *new_span_ptr,
 	}
 }
 
+//------------------------------------------------------------------------------
+// Return the index of the first coverage run in a span buffer row that ends
+// after the given screen x coordinate, or the number of runs if there is none.
+//------------------------------------------------------------------------------
+
+static int
+find_coverage_run(span_row *span_row_ptr, int sx)
+{
+	int low_run_no, high_run_no, mid_run_no;
+
+	low_run_no = 0;
+	high_run_no = span_row_ptr->runs;
+	while (low_run_no < high_run_no) {
+		mid_run_no = (low_run_no + high_run_no) >> 1;
+		if (span_row_ptr->run_list[mid_run_no].end_sx <= sx)
+			low_run_no = mid_run_no + 1;
+		else
+			high_run_no = mid_run_no;
+	}
+	return(low_run_no);
+}
+
+//------------------------------------------------------------------------------
+// Insert a span segment into the uncovered gap before the given coverage run
+// in a span buffer row.  If the segment is opaque, the coverage runs are
+// updated to include it.  The return value is the index of the coverage run
+// that now covers the run that followed the gap.
+//------------------------------------------------------------------------------
+
+static int
+insert_segment(span_row *span_row_ptr, int run_no, span *prev_span_ptr,
+			   span *segment_ptr, pixmap *pixmap_ptr)
+{
+	coverage_run *prev_run_ptr, *next_run_ptr, *new_run_ptr;
+
+	// If we ran out of spans, drop the segment.
+
+	if (segment_ptr == NULL)
+		return(run_no);
+
+	// If the segment is transparent it doesn't cover anything, so just insert
+	// it into the span row.
+
+	if (!span_is_opaque(segment_ptr, pixmap_ptr)) {
+		insert_span(span_row_ptr, prev_span_ptr, segment_ptr, pixmap_ptr);
+		return(run_no);
+	}
+
+	// Get pointers to the coverage runs that are adjacent to the segment, if
+	// they touch it.
+
+	prev_run_ptr = NULL;
+	if (run_no > 0 && 
+		span_row_ptr->run_list[run_no - 1].end_sx == segment_ptr->start_sx)
+		prev_run_ptr = &span_row_ptr->run_list[run_no - 1];
+	next_run_ptr = NULL;
+	if (run_no < span_row_ptr->runs &&
+		span_row_ptr->run_list[run_no].start_sx == segment_ptr->end_sx)
+		next_run_ptr = &span_row_ptr->run_list[run_no];
+
+	// If the segment fills the gap between two coverage runs, merge the next
+	// run into the previous run.
+
+	if (prev_run_ptr != NULL && next_run_ptr != NULL) {
+		prev_run_ptr->end_sx = next_run_ptr->end_sx;
+		prev_run_ptr->last_span_ptr = next_run_ptr->last_span_ptr;
+		span_row_ptr->remove_run(run_no);
+		run_no--;
+	}
+
+	// If the segment only touches the previous coverage run, extend it.
+
+	else if (prev_run_ptr != NULL) {
+		prev_run_ptr->end_sx = segment_ptr->end_sx;
+		prev_run_ptr->last_span_ptr = segment_ptr;
+	}
+
+	// If the segment only touches the next coverage run, extend it.
+
+	else if (next_run_ptr != NULL)
+		next_run_ptr->start_sx = segment_ptr->start_sx;
+
+	// Otherwise create a new coverage run for the segment.  If we ran out of
+	// memory, drop the segment rather than let it be overdrawn.
+
+	else {
+		if ((new_run_ptr = span_row_ptr->insert_run(run_no)) == NULL)
+			return(run_no);
+		new_run_ptr->start_sx = segment_ptr->start_sx;
+		new_run_ptr->end_sx = segment_ptr->end_sx;
+		new_run_ptr->last_span_ptr = segment_ptr;
+		run_no++;
+	}
+
+	// Add the segment's width to the number of pixels covered in this span
+	// row, and if the row has become fully covered count it as such.
+
+	if (span_row_ptr->covered_pixels < frame_buffer_width) {
+		span_row_ptr->covered_pixels += segment_ptr->end_sx - 
+			segment_ptr->start_sx;
+		if (span_row_ptr->covered_pixels >= frame_buffer_width)
+			span_buffer_ptr->covered_rows++;
+	}
+
+	// Insert the segment into the span row.
+
+	insert_span(span_row_ptr, prev_span_ptr, segment_ptr, pixmap_ptr);
+	return(run_no);
+}
+
+//------------------------------------------------------------------------------
+// Determine whether every span buffer row from the given top row up to (but
+// not including) the given end row is fully covered by opaque spans, in which
+// case any polygon span added to these rows would be rejected.
+//------------------------------------------------------------------------------
+
+bool
+span_rows_covered(int top_sy, int end_sy)
+{
+	int sy;
+
+	// Clamp the rows to the display.
+
+	if (top_sy < 0)
+		top_sy = 0;
+	if (end_sy > frame_buffer_height)
+		end_sy = (int)frame_buffer_height;
+
+	// If not enough rows are fully covered, don't bother checking each row.
+
+	if (span_buffer_ptr->covered_rows < end_sy - top_sy)
+		return(false);
+
+	// Check that each row is fully covered.
+
+	for (sy = top_sy; sy < end_sy; sy++)
+		if ((*span_buffer_ptr)[sy]->covered_pixels < frame_buffer_width)
+			return(false);
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// Start writing the polygon spans added to the span buffer to the given file,
+// so that they can be replayed by the span benchmark.  The file begins with
+// the frame buffer dimensions, and each span is written as it is passed to
+// add_span(): the row, the screen x coordinate, 1/tz, u/tz and v/tz of the
+// left and right edges, whether the span has a transparent pixmap, and
+// whether it is part of a popup.
+//------------------------------------------------------------------------------
+
+void
+start_span_stream(FILE *fp)
+{
+	span_stream_fp = fp;
+	fprintf(fp, "%d %d\n", (int)frame_buffer_width, (int)frame_buffer_height);
+}
+
+//------------------------------------------------------------------------------
+// Stop writing polygon spans to the span stream file.
+//------------------------------------------------------------------------------
+
+void
+stop_span_stream(void)
+{
+	span_stream_fp = NULL;
+}
+
+//------------------------------------------------------------------------------
+// Write a polygon span to the span stream file.  Floats are written with
+// enough digits to be read back exactly.
+//------------------------------------------------------------------------------
+
+static void
+write_span(int sy, edge *left_edge_ptr, edge *right_edge_ptr, 
+		   pixmap *pixmap_ptr, bool is_popup)
+{
+	fprintf(span_stream_fp, "%d %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %d %d\n",
+		sy, left_edge_ptr->sx, left_edge_ptr->one_on_tz, left_edge_ptr->u_on_tz,
+		left_edge_ptr->v_on_tz, right_edge_ptr->sx, right_edge_ptr->one_on_tz,
+		right_edge_ptr->u_on_tz, right_edge_ptr->v_on_tz,
+		pixmap_ptr != NULL && pixmap_ptr->transparent_index != -1 ? 1 : 0,
+		is_popup ? 1 : 0);
+}
+
 //------------------------------------------------------------------------------
 // Add a polygon span to the span buffer.  It is assumed that the span will be
 // behind all other spans currently in the buffer.  The return value indicates
 // whether the span was inserted or rejected.
+//
+// The coverage runs of each span buffer row are only maintained by this
+// function, so all polygon spans must be added before any movable spans are.
 //------------------------------------------------------------------------------
 
 bool
@@ -292,9 +648,16 @@ add_span(int sy, edge *left_edge_ptr, edge *right_edge_ptr, pixmap *pixmap_ptr,
 	float delta_sx, one_on_delta_sx;
 	span new_span;
 	span_row *span_row_ptr;
-	span *prev_span_ptr, *curr_span_ptr, *new_span_ptr;
+	coverage_run *run_ptr;
+	span *prev_span_ptr, *new_span_ptr;
+	int run_no;
 	bool span_inserted;
 
+	// Write the span to the span stream file, if there is one.
+
+	if (span_stream_fp != NULL)
+		write_span(sy, left_edge_ptr, right_edge_ptr, pixmap_ptr, is_popup);
+
 	// If the right screen x coordinate is less than or equal to the left
 	// screen x coordinate, switch the edges.
 
@@ -358,69 +721,60 @@ add_span(int sy, edge *left_edge_ptr, edge *right_edge_ptr, pixmap *pixmap_ptr,
 	new_span.colour_pixel = colour_pixel;
 	new_span.brightness_index = brightness_index;
 
-	// If the opaque span list is empty, just insert the new span and return.
+	// Find the first coverage run that does not end before the new span
+	// begins.  The previous span is the last span in the coverage run before
+	// it.
 
 	span_row_ptr = (*span_buffer_ptr)[sy];
-	if (span_row_ptr->opaque_span_list == NULL) {
-		span *new_span_ptr = dup_span(&new_span);
-		insert_span(span_row_ptr, NULL, new_span_ptr, pixmap_ptr);
-		return(true);
-	}
-
-	// Start at the first opaque span.
-
-	prev_span_ptr = NULL;
-	curr_span_ptr = span_row_ptr->opaque_span_list;
+	run_no = find_coverage_run(span_row_ptr, new_span.start_sx);
+	if (run_no > 0)
+		prev_span_ptr = span_row_ptr->run_list[run_no - 1].last_span_ptr;
+	else
+		prev_span_ptr = NULL;
 	span_inserted = false;
-	do {
-
-		// If the new span ends before the current span starts, insert the
-		// new span before the current span and return.
-
-		if (new_span.end_sx <= curr_span_ptr->start_sx) {
-			new_span_ptr = dup_span(&new_span);
-			insert_span(span_row_ptr, prev_span_ptr, new_span_ptr, pixmap_ptr);
-			return(true);
-		}
+	while (run_no < span_row_ptr->runs) {
+		run_ptr = &span_row_ptr->run_list[run_no];
 
-		// If the new span starts after the current span ends, move onto the
-		// next span in the row.
+		// If the new span ends before the current run starts, it fits 
+		// entirely in the gap before the current run.
 
-		if (new_span.start_sx >= curr_span_ptr->end_sx) {
-			prev_span_ptr = curr_span_ptr;
-			curr_span_ptr = curr_span_ptr->next_span_ptr;
-			continue;
-		}
+		if (new_span.end_sx <= run_ptr->start_sx)
+			break;
 
-		// If the new span starts before the current span starts, insert a new
-		// span segment before the current span that starts where the new span
-		// starts and ends where the current span starts.
+		// If the new span starts before the current run starts, insert a new
+		// span segment before the current run that starts where the new span
+		// starts and ends where the current run starts.
 
-		if (new_span.start_sx < curr_span_ptr->start_sx) {
+		if (new_span.start_sx < run_ptr->start_sx) {
 			new_span_ptr = dup_span(&new_span);
-			new_span_ptr->end_sx = curr_span_ptr->start_sx;
-			insert_span(span_row_ptr, prev_span_ptr, new_span_ptr, pixmap_ptr);
+			if (new_span_ptr != NULL)
+				new_span_ptr->end_sx = run_ptr->start_sx;
+			run_no = insert_segment(span_row_ptr, run_no, prev_span_ptr,
+				new_span_ptr, pixmap_ptr);
+			run_ptr = &span_row_ptr->run_list[run_no];
 			span_inserted = true;
 		}
 
-		// If the new span ends before the current span ends, there is nothing
+		// If the new span ends before the current run ends, there is nothing
 		// more to do.
 
-		if (new_span.end_sx <= curr_span_ptr->end_sx)
+		if (new_span.end_sx <= run_ptr->end_sx)
 			return(span_inserted);
 
 		// Advance the start of the new span to be equal to the end of the
-		// current span, then move onto the next span in the row.
+		// current run, then move onto the next run in the row.
 
-		new_span.adjust_start(curr_span_ptr->end_sx);
-		prev_span_ptr = curr_span_ptr;
-		curr_span_ptr = curr_span_ptr->next_span_ptr;
-	} while (curr_span_ptr != NULL);
+		new_span.adjust_start(run_ptr->end_sx);
+		prev_span_ptr = run_ptr->last_span_ptr;
+		run_no++;
+	}
 
-	// Insert the new span at the end of the span row.
+	// Insert what remains of the new span into the gap before the current
+	// run, or at the end of the span row.
 
 	new_span_ptr = dup_span(&new_span);
-	insert_span(span_row_ptr, prev_span_ptr, new_span_ptr, pixmap_ptr);
+	insert_segment(span_row_ptr, run_no, prev_span_ptr, new_span_ptr, 
+		pixmap_ptr);
 	return(true);
 }
 
@@ -476,10 +830,10 @@ insert_movable_span(span_row *span_row_ptr, span *prev_span_ptr,
 				if (new_span_ptr->start_sx <= span_ptr->start_sx &&
 					new_span_ptr->end_sx >= span_ptr->end_sx) {
 					if (prev_span_ptr != NULL) {
-						span_ptr = del_span(span_ptr);
+						span_ptr = span_ptr->next_span_ptr;
 						prev_span_ptr->next_span_ptr = span_ptr;
 					} else {
-						span_ptr = del_span(span_row_ptr->transparent_span_list);
+						span_ptr = span_ptr->next_span_ptr;
 						span_row_ptr->transparent_span_list = span_ptr;
 					}
 					continue;
@@ -557,14 +911,15 @@ remove_span(span_row *span_row_ptr, span *prev_span_ptr)
 {
 	span *next_span_ptr;
 
-	// Delete the span and adjust the previous span's next span
-	// pointer, or the span row's opaque span list pointer.
+	// Unlink the span by adjusting the previous span's next span pointer, or
+	// the span row's opaque span list pointer.  The span itself is reclaimed
+	// when the frame arena is reset.
 
 	if (prev_span_ptr != NULL) {
-		next_span_ptr = del_span(prev_span_ptr->next_span_ptr);
+		next_span_ptr = prev_span_ptr->next_span_ptr->next_span_ptr;
 		prev_span_ptr->next_span_ptr = next_span_ptr;
 	} else {
-		next_span_ptr = del_span(span_row_ptr->opaque_span_list);
+		next_span_ptr = span_row_ptr->opaque_span_list->next_span_ptr;
 		span_row_ptr->opaque_span_list = next_span_ptr;
 	}
 
@@ -15,6 +15,16 @@ extern void *image_updated_semaphore;
 
 #endif
 
+// Flag indicating whether texels are shaded as they are drawn.
+
+extern bool shade_texels;
+
+// Image cache hit, miss and eviction counters.
+
+extern int cache_hits;
+extern int cache_misses;
+extern int cache_evictions;
+
 // Externally visible functions.
 
 cache_entry *
@@ -26,12 +36,24 @@ create_image_caches(void);
 void
 delete_image_caches(void);
 
+void
+release_cache_entries(pixmap *pixmap_ptr);
+
 int
 get_size_index(int texture_width, int texture_height);
 
 void
 set_size_indices(texture *texture_ptr);
 
+bool
+span_rows_covered(int top_sy, int end_sy);
+
+void
+start_span_stream(FILE *fp);
+
+void
+stop_span_stream(void);
+
 bool
 add_span(int sy, edge *left_edge_ptr, edge *right_edge_ptr, pixmap *pixmap_ptr,
 		 pixel colour_pixel, int brightness_index, bool is_popup);
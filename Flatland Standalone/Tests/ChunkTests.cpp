@@ -0,0 +1,296 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Tests of the chunk map that the renderer culls whole chunks of squares with:
+// finding squares and their locations, the summary of the blocks in a chunk
+// (their number and bounding box, and whether the chunk can be culled by its
+// bounding box or tested for occlusion), and invalidating that summary.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Classes.h"
+#include "Main.h"
+#include "Memory.h"
+#include "Test.h"
+
+// The size of the map, which has a partial chunk along each edge.
+
+#define MAP_COLUMNS				40
+#define MAP_ROWS				20
+#define MAP_LEVELS				6
+
+// The block definitions used by the blocks in the tests.
+
+static block_def structural_block_def;
+static block_def sprite_block_def;
+
+//------------------------------------------------------------------------------
+// Create the world, with an empty map.
+//------------------------------------------------------------------------------
+
+static void
+create_world(void)
+{
+	NEW(world_ptr, world);
+	world_ptr->columns = MAP_COLUMNS;
+	world_ptr->rows = MAP_ROWS;
+	world_ptr->levels = MAP_LEVELS;
+	CHECK(world_ptr->create_square_map());
+}
+
+//------------------------------------------------------------------------------
+// Delete a block and its collision mesh.
+//------------------------------------------------------------------------------
+
+static void
+delete_block(block *block_ptr)
+{
+	COL_MESH *mesh_ptr = block_ptr->col_mesh_ptr;
+
+	if (mesh_ptr != NULL) {
+		delete []mesh_ptr->v;
+		delete []mesh_ptr->e;
+		delete []mesh_ptr->p;
+		delete []mesh_ptr->p4;
+		delete mesh_ptr;
+		block_ptr->col_mesh_ptr = NULL;
+	}
+	delete block_ptr;
+}
+
+//------------------------------------------------------------------------------
+// Remove the blocks from the map and delete the world.
+//------------------------------------------------------------------------------
+
+static void
+delete_world(void)
+{
+	for (int index = 0; index < world_ptr->chunks; index++) {
+		square_chunk *chunk_ptr = world_ptr->chunk_list[index];
+		for (int square_no = 0; square_no < CHUNK_SQUARES; square_no++) {
+			square *square_ptr = &chunk_ptr->square_list[square_no];
+			if (square_ptr->block_ptr != NULL) {
+				delete_block(square_ptr->block_ptr);
+				square_ptr->block_ptr = NULL;
+			}
+		}
+	}
+	DEL(world_ptr, world);
+	world_ptr = NULL;
+}
+
+//------------------------------------------------------------------------------
+// Put a block on the square at the given map position.  Unless it has no
+// collision mesh, the block's bounding box is the whole square.
+//------------------------------------------------------------------------------
+
+static block *
+add_block(int column, int row, int level, block_def *block_def_ptr,
+		  bool has_col_mesh)
+{
+	square *square_ptr;
+	block *block_ptr;
+	COL_MESH *mesh_ptr;
+
+	square_ptr = world_ptr->get_square_ptr(column, row, level);
+	block_ptr = new block;
+	block_ptr->block_def_ptr = block_def_ptr;
+	block_ptr->square_ptr = square_ptr;
+	block_ptr->translation.set(column * UNITS_PER_BLOCK,
+		level * UNITS_PER_BLOCK, row * UNITS_PER_BLOCK);
+	if (has_col_mesh) {
+		mesh_ptr = new COL_MESH;
+		mesh_ptr->numVerts = 8;
+		mesh_ptr->numEdges = 36;
+		mesh_ptr->numPolys = 12;
+		mesh_ptr->numPolyGroups = (12 + COL_POLY_LANES - 1) / COL_POLY_LANES;
+		mesh_ptr->v = new VEC3[mesh_ptr->numVerts];
+		mesh_ptr->e = new VEC3[mesh_ptr->numEdges];
+		mesh_ptr->p = new COL_POLY3[mesh_ptr->numPolys];
+		mesh_ptr->p4 = new COL_POLY4[mesh_ptr->numPolyGroups];
+		COL_convertSpriteToColMesh(mesh_ptr, 0.0f, 0.0f, 0.0f,
+			UNITS_PER_BLOCK, UNITS_PER_BLOCK, UNITS_PER_BLOCK);
+		block_ptr->col_mesh_ptr = mesh_ptr;
+	}
+	square_ptr->block_ptr = block_ptr;
+	world_ptr->invalidate_chunk(column, row, level);
+	return(block_ptr);
+}
+
+//------------------------------------------------------------------------------
+// Remove the block from the square at the given map position.
+//------------------------------------------------------------------------------
+
+static void
+remove_block(int column, int row, int level)
+{
+	square *square_ptr = world_ptr->find_square_ptr(column, row, level);
+
+	delete_block(square_ptr->block_ptr);
+	square_ptr->block_ptr = NULL;
+	world_ptr->invalidate_chunk(column, row, level);
+}
+
+//------------------------------------------------------------------------------
+// Return the chunk holding the square at the given map position.
+//------------------------------------------------------------------------------
+
+static square_chunk *
+get_chunk(int column, int row, int level)
+{
+	return(world_ptr->chunk_map[((level >> CHUNK_LEVEL_SHIFT) *
+		world_ptr->chunk_rows + (row >> CHUNK_ROW_SHIFT)) *
+		world_ptr->chunk_columns + (column >> CHUNK_COLUMN_SHIFT)]);
+}
+
+//------------------------------------------------------------------------------
+// Chunks are only created when a square in them is written to, and the
+// location of every square can be found from its address.
+//------------------------------------------------------------------------------
+
+static void
+test_square_locations(void)
+{
+	square *square_ptr;
+	int column, row, level;
+
+	create_world();
+	CHECK(world_ptr->chunk_columns == 3);
+	CHECK(world_ptr->chunk_rows == 2);
+	CHECK(world_ptr->chunk_levels == 2);
+	CHECK(world_ptr->find_square_ptr(5, 5, 1) == NULL);
+	CHECK(world_ptr->get_square_ptr(MAP_COLUMNS, 0, 0) == NULL);
+	CHECK(world_ptr->get_square_ptr(0, 0, -1) == NULL);
+
+	// Write to squares in every chunk, in a scattered order.
+
+	for (int index = 0; index < MAP_COLUMNS * MAP_ROWS * MAP_LEVELS; index++) {
+		int square_no = (index * 7919) % (MAP_COLUMNS * MAP_ROWS * MAP_LEVELS);
+		column = square_no % MAP_COLUMNS;
+		row = (square_no / MAP_COLUMNS) % MAP_ROWS;
+		level = square_no / (MAP_COLUMNS * MAP_ROWS);
+		CHECK(world_ptr->get_square_ptr(column, row, level) != NULL);
+	}
+	CHECK(world_ptr->chunks == 3 * 2 * 2);
+
+	// Check that every square's location is found, and that the chunk holding
+	// it starts at the right map position.
+
+	for (level = 0; level < MAP_LEVELS; level++)
+		for (row = 0; row < MAP_ROWS; row++)
+			for (column = 0; column < MAP_COLUMNS; column++) {
+				int found_column, found_row, found_level;
+				square_chunk *chunk_ptr;
+
+				square_ptr = world_ptr->find_square_ptr(column, row, level);
+				world_ptr->get_square_location(square_ptr, &found_column,
+					&found_row, &found_level);
+				CHECK(found_column == column && found_row == row &&
+					found_level == level);
+				chunk_ptr = get_chunk(column, row, level);
+				CHECK(chunk_ptr->column == (column & ~(CHUNK_COLUMNS - 1)) &&
+					chunk_ptr->row == (row & ~(CHUNK_ROWS - 1)) &&
+					chunk_ptr->level == (level & ~(CHUNK_LEVELS - 1)));
+			}
+	delete_world();
+}
+
+//------------------------------------------------------------------------------
+// A chunk's summary counts its blocks and encloses their bounding boxes, and
+// is marked stale when a square in the chunk changes, but not when a square in
+// another chunk does.
+//------------------------------------------------------------------------------
+
+static void
+test_chunk_summary(void)
+{
+	square_chunk *chunk_ptr, *other_chunk_ptr;
+
+	create_world();
+
+	// An empty chunk has no blocks, so it can always be culled.
+
+	world_ptr->get_square_ptr(20, 3, 1);
+	chunk_ptr = get_chunk(20, 3, 1);
+	CHECK(!chunk_ptr->bounds_valid);
+	chunk_ptr->update_bounds();
+	CHECK(chunk_ptr->bounds_valid);
+	CHECK(chunk_ptr->blocks == 0);
+
+	// Adding blocks marks the summary as stale, and updating it encloses them.
+
+	add_block(17, 2, 0, &structural_block_def, true);
+	CHECK(!chunk_ptr->bounds_valid);
+	add_block(30, 15, 3, &structural_block_def, true);
+	chunk_ptr->update_bounds();
+	CHECK(chunk_ptr->blocks == 2);
+	CHECK(chunk_ptr->bounded && chunk_ptr->occludable);
+	CHECK_NEAR(chunk_ptr->min_bbox.x, 17 * UNITS_PER_BLOCK, 1e-3f);
+	CHECK_NEAR(chunk_ptr->min_bbox.y, 0.0f, 1e-3f);
+	CHECK_NEAR(chunk_ptr->min_bbox.z, 2 * UNITS_PER_BLOCK, 1e-3f);
+	CHECK_NEAR(chunk_ptr->max_bbox.x, 31 * UNITS_PER_BLOCK, 1e-3f);
+	CHECK_NEAR(chunk_ptr->max_bbox.y, 4 * UNITS_PER_BLOCK, 1e-3f);
+	CHECK_NEAR(chunk_ptr->max_bbox.z, 16 * UNITS_PER_BLOCK, 1e-3f);
+
+	// A change to a square in another chunk leaves this chunk's summary alone,
+	// as does a change to a square off the map.
+
+	add_block(32, 2, 0, &structural_block_def, true);
+	other_chunk_ptr = get_chunk(32, 2, 0);
+	CHECK(other_chunk_ptr != chunk_ptr);
+	CHECK(chunk_ptr->bounds_valid);
+	world_ptr->invalidate_chunk(-1, 2, 0);
+	world_ptr->invalidate_chunk(20, MAP_ROWS, 0);
+	CHECK(chunk_ptr->bounds_valid);
+
+	// Removing a block marks the summary as stale, and updating it shrinks
+	// the bounding box.
+
+	remove_block(30, 15, 3);
+	CHECK(!chunk_ptr->bounds_valid);
+	chunk_ptr->update_bounds();
+	CHECK(chunk_ptr->blocks == 1);
+	CHECK_NEAR(chunk_ptr->max_bbox.x, 18 * UNITS_PER_BLOCK, 1e-3f);
+	CHECK_NEAR(chunk_ptr->max_bbox.y, UNITS_PER_BLOCK, 1e-3f);
+	CHECK_NEAR(chunk_ptr->max_bbox.z, 3 * UNITS_PER_BLOCK, 1e-3f);
+
+	// A sprite can be culled by its bounding box, but can't hide anything
+	// behind it.
+
+	add_block(18, 2, 0, &sprite_block_def, true);
+	chunk_ptr->update_bounds();
+	CHECK(chunk_ptr->blocks == 2);
+	CHECK(chunk_ptr->bounded && !chunk_ptr->occludable);
+
+	// A block without a collision mesh has no bounding box, so the chunk can
+	// only be culled if it's empty.
+
+	add_block(19, 2, 0, &structural_block_def, false);
+	chunk_ptr->update_bounds();
+	CHECK(chunk_ptr->blocks == 3);
+	CHECK(!chunk_ptr->bounded && !chunk_ptr->occludable);
+	remove_block(18, 2, 0);
+	remove_block(19, 2, 0);
+	chunk_ptr->update_bounds();
+	CHECK(chunk_ptr->blocks == 1);
+	CHECK(chunk_ptr->bounded && chunk_ptr->occludable);
+	delete_world();
+}
+
+//------------------------------------------------------------------------------
+// Run the tests.
+//------------------------------------------------------------------------------
+
+int
+main(void)
+{
+	units_per_block = UNITS_PER_BLOCK;
+	units_per_half_block = UNITS_PER_HALF_BLOCK;
+	sprite_block_def.type = SPRITE_BLOCK;
+	test_square_locations();
+	test_chunk_summary();
+	return(test_result("Chunk tests"));
+}
@@ -0,0 +1,201 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Parity tests of the poly group rejection tests: the masks returned by
+// COL_getMeshCollisionMask() and COL_getShadowMask(), which use SSE2 where it
+// is available, must match the ones returned by the scalar versions.  The
+// groups and boxes are built on a coarse grid, so that bounding boxes often
+// just touch and normals are often edge-on to the movement, which is where the
+// comparisons are most likely to disagree.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Collision/Collision.h"
+#include "Classes.h"
+#include "Main.h"
+#include "Test.h"
+
+// The number of random groups, and the boxes tested against each.
+
+#define GROUPS					4096
+#define BOXES_PER_GROUP			16
+
+//------------------------------------------------------------------------------
+// Return a random value on a grid of quarter units between the given limits.
+//------------------------------------------------------------------------------
+
+static float
+random_grid_value(int min_value, int max_value)
+{
+	return((min_value * 4 + rand() % ((max_value - min_value) * 4 + 1)) / 4.0f);
+}
+
+//------------------------------------------------------------------------------
+// Return a random normal, which is sometimes a zero vector, or has a NaN
+// component as a degenerate poly might.
+//------------------------------------------------------------------------------
+
+static void
+random_normal(float *x_ptr, float *y_ptr, float *z_ptr)
+{
+	switch (rand() % 16) {
+	case 0:
+		*x_ptr = *y_ptr = *z_ptr = 0.0f;
+		break;
+	case 1:
+		*x_ptr = -0.0f;
+		*y_ptr = 0.0f;
+		*z_ptr = -0.0f;
+		break;
+	case 2:
+		*x_ptr = NAN;
+		*y_ptr = *z_ptr = 0.0f;
+		break;
+	default:
+		*x_ptr = random_grid_value(-1, 1);
+		*y_ptr = random_grid_value(-1, 1);
+		*z_ptr = random_grid_value(-1, 1);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Fill a group with random polys, with every lane's bounding box lying within
+// a few units of the origin.
+//------------------------------------------------------------------------------
+
+static void
+random_group(COL_POLY4 *group_ptr)
+{
+	for (int lane = 0; lane < COL_POLY_LANES; lane++) {
+		group_ptr->minX[lane] = random_grid_value(-2, 2);
+		group_ptr->minY[lane] = random_grid_value(-2, 2);
+		group_ptr->minZ[lane] = random_grid_value(-2, 2);
+		group_ptr->maxX[lane] = group_ptr->minX[lane] + random_grid_value(0, 2);
+		group_ptr->maxY[lane] = group_ptr->minY[lane] + random_grid_value(0, 2);
+		group_ptr->maxZ[lane] = group_ptr->minZ[lane] + random_grid_value(0, 2);
+		random_normal(&group_ptr->normalX[lane], &group_ptr->normalY[lane],
+			&group_ptr->normalZ[lane]);
+		group_ptr->doubleSided[lane] = rand() % 4 == 0 ? -1 : 0;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Set up a random box and vector.
+//------------------------------------------------------------------------------
+
+static void
+random_box(VEC3 *box_min_ptr, VEC3 *box_max_ptr, VEC3 *vector_ptr)
+{
+	VEC_set(box_min_ptr, random_grid_value(-3, 3), random_grid_value(-3, 3),
+		random_grid_value(-3, 3));
+	VEC_set(box_max_ptr, box_min_ptr->x + random_grid_value(0, 2),
+		box_min_ptr->y + random_grid_value(0, 2),
+		box_min_ptr->z + random_grid_value(0, 2));
+	random_normal(&vector_ptr->x, &vector_ptr->y, &vector_ptr->z);
+}
+
+//------------------------------------------------------------------------------
+// Compare the masks of random groups against random boxes.
+//------------------------------------------------------------------------------
+
+static void
+test_random_groups(void)
+{
+	COL_POLY4 group;
+	VEC3 box_min, box_max, vector;
+	int mismatches = 0;
+
+	for (int group_no = 0; group_no < GROUPS; group_no++) {
+		random_group(&group);
+		for (int box_no = 0; box_no < BOXES_PER_GROUP; box_no++) {
+			random_box(&box_min, &box_max, &vector);
+			if (COL_getMeshCollisionMask(&group, &vector, &box_min, &box_max) !=
+				COL_getMeshCollisionMaskScalar(&group, &vector, &box_min,
+				&box_max))
+				mismatches++;
+
+			// The shadow test offsets the group by a mesh position, for which
+			// the random vector is reused.
+
+			if (COL_getShadowMask(&group, &vector, &box_min, &box_max) !=
+				COL_getShadowMaskScalar(&group, &vector, &box_min, &box_max))
+				mismatches++;
+		}
+	}
+	CHECK(mismatches == 0);
+}
+
+//------------------------------------------------------------------------------
+// Compare the masks of the groups of a packed box mesh, whose last group has
+// unused lanes, against boxes that overlap, touch and miss it.
+//------------------------------------------------------------------------------
+
+static void
+test_box_mesh(void)
+{
+	COL_MESH mesh;
+	VEC3 vert_list[8], edge_list[36];
+	COL_POLY3 poly_list[12];
+	COL_POLY4 group_list[(12 + COL_POLY_LANES - 1) / COL_POLY_LANES];
+	VEC3 box_min, box_max, vector, pos;
+	int mask, scalar_mask;
+
+	mesh.numVerts = 8;
+	mesh.numEdges = 36;
+	mesh.numPolys = 12;
+	mesh.numPolyGroups = (12 + COL_POLY_LANES - 1) / COL_POLY_LANES;
+	mesh.v = vert_list;
+	mesh.e = edge_list;
+	mesh.p = poly_list;
+	mesh.p4 = group_list;
+	COL_convertSpriteToColMesh(&mesh, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
+	VEC_set(&pos, 0.0f, 0.0f, 0.0f);
+	for (int offset = -4; offset <= 4; offset++) {
+		float shift = offset / 2.0f;
+		VEC_set(&box_min, shift, shift, shift);
+		VEC_set(&box_max, shift + 1.0f, shift + 1.0f, shift + 1.0f);
+		VEC_set(&vector, 1.0f, -1.0f, 0.0f);
+		for (int group = 0; group < mesh.numPolyGroups; group++) {
+			mask = COL_getMeshCollisionMask(&group_list[group], &vector,
+				&box_min, &box_max);
+			scalar_mask = COL_getMeshCollisionMaskScalar(&group_list[group],
+				&vector, &box_min, &box_max);
+			CHECK(mask == scalar_mask);
+			mask = COL_getShadowMask(&group_list[group], &pos, &box_min,
+				&box_max);
+			scalar_mask = COL_getShadowMaskScalar(&group_list[group], &pos,
+				&box_min, &box_max);
+			CHECK(mask == scalar_mask);
+		}
+	}
+
+	// A box overlapping the mesh is moving into some of its polys.
+
+	VEC_set(&box_min, 0.5f, 0.5f, 0.5f);
+	VEC_set(&box_max, 1.5f, 1.5f, 1.5f);
+	VEC_set(&vector, -1.0f, 0.0f, 0.0f);
+	mask = 0;
+	for (int group = 0; group < mesh.numPolyGroups; group++)
+		mask |= COL_getMeshCollisionMask(&group_list[group], &vector, &box_min,
+			&box_max);
+	CHECK(mask != 0);
+}
+
+//------------------------------------------------------------------------------
+// Run the tests.
+//------------------------------------------------------------------------------
+
+int
+main(void)
+{
+	srand(1);
+	units_per_block = UNITS_PER_BLOCK;
+	units_per_half_block = UNITS_PER_HALF_BLOCK;
+	test_random_groups();
+	test_box_mesh();
+	return(test_result("Collision mask tests"));
+}
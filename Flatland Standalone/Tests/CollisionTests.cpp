@@ -0,0 +1,425 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Regression tests for the swept collision of the player's box: sweeping it
+// against a poly, sliding it along walls, and moving it along a trajectory
+// with step-up, as adjust_trajectory() in Main.cpp does.  The scenes are
+// built from box meshes, so no spot needs to be loaded.
+//
+// Recorded trajectories of a player walking around a room, one move per
+// frame, are also replayed, and must end at the positions they ended at when
+// they were recorded.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Collision/Collision.h"
+#include "Classes.h"
+#include "Main.h"
+#include "Test.h"
+
+// The player's box is 0.5 units wide and deep and 1 unit high, positioned by
+// its feet, and can step up half its height, as set by set_player_size().
+
+#define PLAYER_HALF_WIDTH		0.25f
+#define PLAYER_HALF_HEIGHT		0.5f
+#define PLAYER_STEP_HEIGHT		0.5f
+
+// The scene being tested.
+
+#define MAX_SCENE_MESHES		8
+
+static COL_MESH *scene_mesh_list[MAX_SCENE_MESHES];
+static VEC3 scene_pos_list[MAX_SCENE_MESHES];
+static int scene_meshes;
+
+//------------------------------------------------------------------------------
+// Add a solid box to the scene.
+//------------------------------------------------------------------------------
+
+static void
+add_box(float min_x, float min_y, float min_z, float max_x, float max_y,
+		float max_z)
+{
+	COL_MESH *mesh_ptr;
+
+	// Create a mesh with room for a box, as COL_createSpriteColMesh() does.
+
+	mesh_ptr = new COL_MESH;
+	mesh_ptr->numVerts = 8;
+	mesh_ptr->numEdges = 36;
+	mesh_ptr->numPolys = 12;
+	mesh_ptr->numPolyGroups = (12 + COL_POLY_LANES - 1) / COL_POLY_LANES;
+	mesh_ptr->v = new VEC3[mesh_ptr->numVerts];
+	mesh_ptr->e = new VEC3[mesh_ptr->numEdges];
+	mesh_ptr->p = new COL_POLY3[mesh_ptr->numPolys];
+	mesh_ptr->p4 = new COL_POLY4[mesh_ptr->numPolyGroups];
+	COL_convertSpriteToColMesh(mesh_ptr, min_x, min_y, min_z, max_x, max_y,
+		max_z);
+
+	// Add it to the scene at the origin.
+
+	scene_mesh_list[scene_meshes] = mesh_ptr;
+	VEC_set(&scene_pos_list[scene_meshes], 0.0f, 0.0f, 0.0f);
+	scene_meshes++;
+}
+
+//------------------------------------------------------------------------------
+// Delete the boxes in the scene.
+//------------------------------------------------------------------------------
+
+static void
+clear_scene(void)
+{
+	for (int index = 0; index < scene_meshes; index++) {
+		COL_MESH *mesh_ptr = scene_mesh_list[index];
+		delete []mesh_ptr->v;
+		delete []mesh_ptr->e;
+		delete []mesh_ptr->p;
+		delete []mesh_ptr->p4;
+		delete mesh_ptr;
+	}
+	scene_meshes = 0;
+}
+
+//------------------------------------------------------------------------------
+// Set up the player's box, and the box that is swept, which has its bottom
+// raised by the step height, as in adjust_trajectory().
+//------------------------------------------------------------------------------
+
+static void
+get_player_boxes(COL_AABOX *player_box_ptr, COL_AABOX *sweep_box_ptr)
+{
+	VEC_set(&player_box_ptr->maxDim, PLAYER_HALF_WIDTH, PLAYER_HALF_HEIGHT,
+		PLAYER_HALF_WIDTH);
+	VEC_set(&player_box_ptr->offsToCentre, 0.0f, PLAYER_HALF_HEIGHT, 0.0f);
+	*sweep_box_ptr = *player_box_ptr;
+	sweep_box_ptr->maxDim.y -= PLAYER_STEP_HEIGHT / 2.0f;
+	sweep_box_ptr->offsToCentre.y += PLAYER_STEP_HEIGHT / 2.0f;
+}
+
+//------------------------------------------------------------------------------
+// Move the player's box from the given position along the given trajectory,
+// and return the new position and floor height.  The box comes to rest the
+// shadow tolerance above the floor beneath it.
+//------------------------------------------------------------------------------
+
+static VEC3
+move_player(float x, float y, float z, float dx, float dy, float dz,
+			float *floor_y_ptr)
+{
+	COL_AABOX player_box, sweep_box;
+	VEC3 position, trajectory;
+
+	get_player_boxes(&player_box, &sweep_box);
+	VEC_set(&position, x, y, z);
+	VEC_set(&trajectory, dx, dy, dz);
+	COL_moveAABox(scene_mesh_list, scene_pos_list, scene_meshes, &player_box,
+		&sweep_box, &position, &trajectory, floor_y_ptr, PLAYER_STEP_HEIGHT);
+	return(position);
+}
+
+//------------------------------------------------------------------------------
+// A box that starts touching a wall and moves into it stops at once, with a
+// unit contact normal facing back against the movement.
+//------------------------------------------------------------------------------
+
+static void
+test_sweep_starting_in_contact(void)
+{
+	COL_AABOX player_box, sweep_box;
+	VEC3 start, move, normal;
+	float toi;
+
+	add_box(1.0f, 0.0f, -2.0f, 2.0f, 3.0f, 2.0f);
+	get_player_boxes(&player_box, &sweep_box);
+	VEC_set(&start, 1.0f - PLAYER_HALF_WIDTH, 0.0f, 0.0f);
+	VEC_set(&move, 1.0f, 0.0f, 0.0f);
+	toi = COL_sweepAABox(scene_mesh_list, scene_pos_list, scene_meshes,
+		&player_box, &start, &move, &normal);
+	CHECK_NEAR(toi, 0.0f, 1e-5f);
+	CHECK(normal.x == normal.x && normal.y == normal.y && normal.z == normal.z);
+	CHECK_NEAR(VEC_length(&normal), 1.0f, 1e-4f);
+	CHECK_NEAR(normal.x, -1.0f, 1e-4f);
+	clear_scene();
+}
+
+//------------------------------------------------------------------------------
+// A box swept towards a wall stops just short of it, and one swept parallel to
+// it doesn't stop at all.
+//------------------------------------------------------------------------------
+
+static void
+test_sweep_against_wall(void)
+{
+	COL_AABOX player_box, sweep_box;
+	VEC3 start, move, normal;
+	float toi;
+
+	add_box(1.0f, 0.0f, -2.0f, 2.0f, 3.0f, 2.0f);
+	get_player_boxes(&player_box, &sweep_box);
+	VEC_set(&start, 0.0f, 0.0f, 0.0f);
+	VEC_set(&move, 1.5f, 0.0f, 0.0f);
+	toi = COL_sweepAABox(scene_mesh_list, scene_pos_list, scene_meshes,
+		&player_box, &start, &move, &normal);
+	CHECK_NEAR(toi, (1.0f - PLAYER_HALF_WIDTH) / 1.5f, 1e-4f);
+	CHECK_NEAR(normal.x, -1.0f, 1e-4f);
+	VEC_set(&move, 0.0f, 0.0f, 1.5f);
+	toi = COL_sweepAABox(scene_mesh_list, scene_pos_list, scene_meshes,
+		&player_box, &start, &move, &normal);
+	CHECK(toi >= 1.0f);
+	clear_scene();
+}
+
+//------------------------------------------------------------------------------
+// A box moved diagonally into a wall slides along it, and isn't snapped back
+// by a post that lies between its start and the end of the slide, but off the
+// path it actually took.
+//------------------------------------------------------------------------------
+
+static void
+test_slide_past_post(void)
+{
+	VEC3 position;
+	float floor_y;
+
+	add_box(-10.0f, -1.0f, -10.0f, 10.0f, 0.0f, 10.0f);
+	add_box(-10.0f, 0.0f, 1.0f, 10.0f, 3.0f, 2.0f);
+	add_box(1.4f, 0.0f, 0.1f, 1.6f, 3.0f, 0.2f);
+	position = move_player(0.0f, 0.0f, 0.0f, 3.0f, 0.0f, 3.0f, &floor_y);
+	CHECK_NEAR(position.x, 3.0f, 0.05f);
+	CHECK_NEAR(position.z, 1.0f - PLAYER_HALF_WIDTH, 0.05f);
+	CHECK_NEAR(position.y, COL_SHADOW_TOLERANCE, 1e-4f);
+	CHECK_NEAR(floor_y, COL_SHADOW_TOLERANCE, 1e-4f);
+	clear_scene();
+}
+
+//------------------------------------------------------------------------------
+// A box moved into a wall taller than the step height stops in front of it.
+//------------------------------------------------------------------------------
+
+static void
+test_wall_stops_player(void)
+{
+	VEC3 position;
+	float floor_y;
+
+	add_box(-10.0f, -1.0f, -10.0f, 10.0f, 0.0f, 10.0f);
+	add_box(1.0f, 0.0f, -10.0f, 2.0f, 3.0f, 10.0f);
+	position = move_player(0.0f, 0.0f, 0.0f, 3.0f, 0.0f, 0.0f, &floor_y);
+	CHECK(position.x < 1.0f - PLAYER_HALF_WIDTH);
+	CHECK_NEAR(position.x, 1.0f - PLAYER_HALF_WIDTH, 0.05f);
+	CHECK_NEAR(position.y, COL_SHADOW_TOLERANCE, 1e-4f);
+	clear_scene();
+}
+
+//------------------------------------------------------------------------------
+// A box moved onto a step lower than the step height ends up standing on it,
+// and a flight of two such steps can be climbed in one move.
+//------------------------------------------------------------------------------
+
+static void
+test_step_up(void)
+{
+	VEC3 position;
+	float floor_y;
+
+	add_box(-10.0f, -1.0f, -10.0f, 10.0f, 0.0f, 10.0f);
+	add_box(1.0f, 0.0f, -10.0f, 10.0f, 0.4f, 10.0f);
+	position = move_player(0.0f, 0.0f, 0.0f, 2.0f, 0.0f, 0.0f, &floor_y);
+	CHECK_NEAR(position.x, 2.0f, 1e-3f);
+	CHECK_NEAR(position.y, 0.4f + COL_SHADOW_TOLERANCE, 1e-3f);
+	CHECK_NEAR(floor_y, 0.4f + COL_SHADOW_TOLERANCE, 1e-3f);
+	clear_scene();
+
+	add_box(-10.0f, -1.0f, -10.0f, 10.0f, 0.0f, 10.0f);
+	add_box(1.0f, 0.0f, -10.0f, 10.0f, 0.4f, 10.0f);
+	add_box(2.0f, 0.0f, -10.0f, 10.0f, 0.8f, 10.0f);
+	position = move_player(0.0f, 0.0f, 0.0f, 3.0f, 0.0f, 0.0f, &floor_y);
+	CHECK_NEAR(position.x, 3.0f, 0.05f);
+	CHECK_NEAR(position.y, 0.8f + COL_SHADOW_TOLERANCE, 1e-3f);
+	clear_scene();
+}
+
+//------------------------------------------------------------------------------
+// A move swept in equal segments, each starting where the last one ended, as
+// adjust_trajectory() does with a trajectory longer than a block, ends up
+// where the same move swept in one go does: sliding along a wall, stopped by
+// one, and climbing a flight of steps.
+//------------------------------------------------------------------------------
+
+static void
+check_segmented_move(float dx, float dy, float dz, int segments)
+{
+	VEC3 position, segment_position;
+	float floor_y, segment_floor_y;
+
+	position = move_player(0.0f, 0.0f, 0.0f, dx, dy, dz, &floor_y);
+	VEC_set(&segment_position, 0.0f, 0.0f, 0.0f);
+	for (int segment = 0; segment < segments; segment++)
+		segment_position = move_player(segment_position.x, segment_position.y,
+			segment_position.z, dx / segments, dy / segments, dz / segments,
+			&segment_floor_y);
+	CHECK_NEAR(segment_position.x, position.x, 0.05f);
+	CHECK_NEAR(segment_position.y, position.y, 1e-3f);
+	CHECK_NEAR(segment_position.z, position.z, 0.05f);
+	CHECK_NEAR(segment_floor_y, floor_y, 1e-3f);
+}
+
+static void
+test_segmented_move(void)
+{
+	add_box(-10.0f, -1.0f, -10.0f, 10.0f, 0.0f, 10.0f);
+	add_box(-10.0f, 0.0f, 1.0f, 10.0f, 3.0f, 2.0f);
+	check_segmented_move(3.0f, 0.0f, 3.0f, 4);
+	check_segmented_move(0.0f, 0.0f, 3.0f, 3);
+	clear_scene();
+
+	add_box(-10.0f, -1.0f, -10.0f, 10.0f, 0.0f, 10.0f);
+	add_box(1.0f, 0.0f, -10.0f, 10.0f, 0.4f, 10.0f);
+	add_box(2.0f, 0.0f, -10.0f, 10.0f, 0.8f, 10.0f);
+	check_segmented_move(3.0f, 0.0f, 0.0f, 3);
+	check_segmented_move(3.0f, 0.0f, 1.0f, 5);
+	clear_scene();
+}
+
+//------------------------------------------------------------------------------
+// The recorded trajectories.  Each frame's move is the player's speed and
+// heading at that frame, before collision: walking into the room's corner,
+// catching the pillar's corner while turning and sliding around it, and
+// climbing onto the step.  They don't move the player up or down, since
+// gravity is applied separately.
+//------------------------------------------------------------------------------
+
+static const float corner_frame_list[][3] = {
+	{ 0.015f, 0.000f, 0.013f }, { 0.030f, 0.000f, 0.026f }, { 0.046f, 0.000f, 0.039f },
+	{ 0.061f, 0.000f, 0.052f }, { 0.075f, 0.000f, 0.066f }, { 0.090f, 0.000f, 0.079f },
+	{ 0.090f, 0.000f, 0.079f }, { 0.090f, 0.000f, 0.080f }, { 0.089f, 0.000f, 0.080f },
+	{ 0.089f, 0.000f, 0.080f }, { 0.089f, 0.000f, 0.081f }, { 0.089f, 0.000f, 0.081f },
+	{ 0.088f, 0.000f, 0.081f }, { 0.088f, 0.000f, 0.082f }, { 0.088f, 0.000f, 0.082f },
+	{ 0.087f, 0.000f, 0.082f }, { 0.087f, 0.000f, 0.082f }, { 0.087f, 0.000f, 0.083f },
+	{ 0.087f, 0.000f, 0.083f }, { 0.086f, 0.000f, 0.083f }, { 0.086f, 0.000f, 0.084f },
+	{ 0.086f, 0.000f, 0.084f }, { 0.085f, 0.000f, 0.084f }, { 0.085f, 0.000f, 0.085f },
+	{ 0.085f, 0.000f, 0.085f }, { 0.085f, 0.000f, 0.085f }, { 0.084f, 0.000f, 0.085f },
+	{ 0.084f, 0.000f, 0.086f }, { 0.084f, 0.000f, 0.086f }, { 0.083f, 0.000f, 0.086f },
+	{ 0.083f, 0.000f, 0.087f }, { 0.083f, 0.000f, 0.087f }, { 0.082f, 0.000f, 0.087f },
+	{ 0.082f, 0.000f, 0.087f }, { 0.082f, 0.000f, 0.088f }, { 0.082f, 0.000f, 0.088f },
+	{ 0.081f, 0.000f, 0.088f }, { 0.081f, 0.000f, 0.089f }, { 0.081f, 0.000f, 0.089f },
+	{ 0.080f, 0.000f, 0.089f }, { 0.080f, 0.000f, 0.089f }, { 0.080f, 0.000f, 0.090f },
+	{ 0.079f, 0.000f, 0.090f }, { 0.079f, 0.000f, 0.090f }, { 0.079f, 0.000f, 0.091f },
+	{ 0.078f, 0.000f, 0.091f }, { 0.078f, 0.000f, 0.091f }, { 0.078f, 0.000f, 0.091f },
+	{ 0.077f, 0.000f, 0.092f }, { 0.077f, 0.000f, 0.092f }, { 0.077f, 0.000f, 0.092f },
+	{ 0.076f, 0.000f, 0.092f }, { 0.076f, 0.000f, 0.093f }, { 0.076f, 0.000f, 0.093f },
+	{ 0.076f, 0.000f, 0.093f }, { 0.075f, 0.000f, 0.094f }
+};
+static const float pillar_frame_list[][3] = {
+	{ 0.020f, 0.000f, -0.003f }, { 0.040f, 0.000f, -0.006f }, { 0.059f, 0.000f, -0.009f },
+	{ 0.079f, 0.000f, -0.011f }, { 0.099f, 0.000f, -0.012f }, { 0.099f, 0.000f, -0.011f },
+	{ 0.099f, 0.000f, -0.010f }, { 0.100f, 0.000f, -0.009f }, { 0.100f, 0.000f, -0.008f },
+	{ 0.100f, 0.000f, -0.007f }, { 0.100f, 0.000f, -0.006f }, { 0.100f, 0.000f, -0.005f },
+	{ 0.100f, 0.000f, -0.004f }, { 0.100f, 0.000f, -0.003f }, { 0.100f, 0.000f, -0.002f },
+	{ 0.100f, 0.000f, -0.001f }, { 0.100f, 0.000f, 0.000f }, { 0.100f, 0.000f, 0.001f },
+	{ 0.100f, 0.000f, 0.002f }, { 0.100f, 0.000f, 0.003f }, { 0.100f, 0.000f, 0.005f },
+	{ 0.100f, 0.000f, 0.006f }, { 0.100f, 0.000f, 0.007f }, { 0.100f, 0.000f, 0.008f },
+	{ 0.100f, 0.000f, 0.009f }, { 0.100f, 0.000f, 0.010f }, { 0.099f, 0.000f, 0.011f },
+	{ 0.099f, 0.000f, 0.012f }, { 0.099f, 0.000f, 0.013f }, { 0.099f, 0.000f, 0.014f },
+	{ 0.099f, 0.000f, 0.015f }, { 0.099f, 0.000f, 0.016f }, { 0.099f, 0.000f, 0.017f },
+	{ 0.098f, 0.000f, 0.018f }, { 0.098f, 0.000f, 0.019f }, { 0.098f, 0.000f, 0.020f },
+	{ 0.098f, 0.000f, 0.021f }, { 0.098f, 0.000f, 0.022f }, { 0.097f, 0.000f, 0.023f },
+	{ 0.097f, 0.000f, 0.024f }
+};
+static const float step_frame_list[][3] = {
+	{ -0.020f, 0.000f, -0.002f }, { -0.040f, 0.000f, -0.003f }, { -0.060f, 0.000f, -0.004f },
+	{ -0.080f, 0.000f, -0.005f }, { -0.100f, 0.000f, -0.006f }, { -0.100f, 0.000f, -0.006f },
+	{ -0.100f, 0.000f, -0.005f }, { -0.100f, 0.000f, -0.005f }, { -0.100f, 0.000f, -0.004f },
+	{ -0.100f, 0.000f, -0.003f }, { -0.100f, 0.000f, -0.003f }, { -0.100f, 0.000f, -0.002f },
+	{ -0.100f, 0.000f, -0.002f }, { -0.100f, 0.000f, -0.001f }, { -0.100f, 0.000f, -0.001f },
+	{ -0.100f, 0.000f, 0.000f }, { -0.100f, 0.000f, 0.000f }, { -0.100f, 0.000f, 0.001f },
+	{ -0.100f, 0.000f, 0.001f }, { -0.100f, 0.000f, 0.002f }, { -0.100f, 0.000f, 0.002f },
+	{ -0.100f, 0.000f, 0.003f }, { -0.100f, 0.000f, 0.003f }, { -0.100f, 0.000f, 0.004f },
+	{ -0.100f, 0.000f, 0.004f }, { -0.100f, 0.000f, 0.005f }, { -0.100f, 0.000f, 0.005f },
+	{ -0.100f, 0.000f, 0.006f }, { -0.100f, 0.000f, 0.006f }, { -0.100f, 0.000f, 0.007f },
+	{ -0.100f, 0.000f, 0.007f }, { -0.100f, 0.000f, 0.008f }, { -0.100f, 0.000f, 0.009f },
+	{ -0.100f, 0.000f, 0.009f }, { -0.100f, 0.000f, 0.010f }, { -0.099f, 0.000f, 0.010f }
+};
+
+// The start of each trajectory, and the position and floor height it ended at.
+
+struct trajectory_fixture {
+	const float (*frame_list)[3];
+	int frames;
+	float start_x, start_y, start_z;
+	float end_x, end_y, end_z, end_floor_y;
+};
+
+#define FRAMES(frame_list)		frame_list, sizeof(frame_list) / sizeof(frame_list[0])
+#define TRAJECTORY_FIXTURES		3
+
+static const trajectory_fixture trajectory_fixture_list[TRAJECTORY_FIXTURES] = {
+	{ FRAMES(corner_frame_list), 0.0f, 0.0f, 0.0f,
+	  3.7401f, COL_SHADOW_TOLERANCE, 3.7424f, COL_SHADOW_TOLERANCE },
+	{ FRAMES(pillar_frame_list), -1.0f, 0.0f, -0.3f,
+	  1.1302f, COL_SHADOW_TOLERANCE, -0.1576f, COL_SHADOW_TOLERANCE },
+	{ FRAMES(step_frame_list), -1.0f, 0.0f, 0.0f,
+	  -4.399f, 0.4f + COL_SHADOW_TOLERANCE, 0.05f, 0.4f + COL_SHADOW_TOLERANCE }
+};
+
+//------------------------------------------------------------------------------
+// Replay each recorded trajectory in a room with walls to the north and east,
+// a pillar and a step, moving the player by each frame's move in turn from
+// where the last one left them.
+//------------------------------------------------------------------------------
+
+static void
+test_recorded_trajectories(void)
+{
+	VEC3 position;
+	float floor_y;
+
+	add_box(-10.0f, -1.0f, -10.0f, 10.0f, 0.0f, 10.0f);
+	add_box(-10.0f, 0.0f, 4.0f, 10.0f, 3.0f, 5.0f);
+	add_box(4.0f, 0.0f, -10.0f, 5.0f, 3.0f, 10.0f);
+	add_box(1.0f, 0.0f, -1.0f, 1.5f, 3.0f, -0.5f);
+	add_box(-6.0f, 0.0f, -4.0f, -2.0f, 0.4f, 4.0f);
+	for (int index = 0; index < TRAJECTORY_FIXTURES; index++) {
+		const trajectory_fixture *fixture_ptr = &trajectory_fixture_list[index];
+		VEC_set(&position, fixture_ptr->start_x, fixture_ptr->start_y,
+			fixture_ptr->start_z);
+		for (int frame = 0; frame < fixture_ptr->frames; frame++) {
+			const float *move = fixture_ptr->frame_list[frame];
+			position = move_player(position.x, position.y, position.z, move[0],
+				move[1], move[2], &floor_y);
+		}
+		CHECK_NEAR(position.x, fixture_ptr->end_x, 1e-3f);
+		CHECK_NEAR(position.y, fixture_ptr->end_y, 1e-3f);
+		CHECK_NEAR(position.z, fixture_ptr->end_z, 1e-3f);
+		CHECK_NEAR(floor_y, fixture_ptr->end_floor_y, 1e-3f);
+	}
+	clear_scene();
+}
+
+//------------------------------------------------------------------------------
+// Run the tests.
+//------------------------------------------------------------------------------
+
+int
+main(void)
+{
+	// The shadow height is searched for up to a block below the box, so use
+	// the block size that a spot is loaded with.
+
+	units_per_block = UNITS_PER_BLOCK;
+	units_per_half_block = UNITS_PER_HALF_BLOCK;
+	COL_init();
+	test_sweep_starting_in_contact();
+	test_sweep_against_wall();
+	test_slide_past_post();
+	test_wall_stops_player();
+	test_step_up();
+	test_segmented_move();
+	test_recorded_trajectories();
+	COL_exit();
+	return(test_result("Collision tests"));
+}
@@ -0,0 +1,148 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Tests of script time slicing in the headless runner: a spot whose timer
+// script never finishes is run with a fixed time step, so that the game time
+// only advances as frames are displayed.  The script must still be paused at
+// the end of each time slice, so the runner must display every frame and exit
+// successfully, rather than waiting on the script until it gives up.
+//
+// The path of the headless runner is passed as the only argument.  The spot
+// and its blockset, which holds nothing but an empty style file, are written
+// to the current directory.
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "Unzip/zip.h"
+#include "Test.h"
+
+// The names of the files written by the test.
+
+#define BLOCKSET_NAME		"script_test"
+#define BLOCKSET_FILE_NAME	"script_test.bset"
+#define STYLE_FILE_NAME		"script_test.style"
+#define SPOT_FILE_NAME		"script_test.3dml"
+
+// The frames to render and the time step, and how long the runner may go
+// without displaying a frame before it gives up.
+
+#define FRAMES				10
+#define TIME_STEP_MS		33
+#define TIMEOUT_SECS		20
+
+// The style file, and the spot with its looping script.  The blockset URL is
+// given the "file://localhost/" prefix, which is removed in full when it's
+// turned into a file path, so that the absolute path that follows it is kept.
+
+static const char *style_file =
+	"<STYLE NAME=\"" BLOCKSET_NAME "\" VERSION=\"1.0\">\n"
+	"</STYLE>\n";
+
+static const char *spot_file_format =
+	"<SPOT VERSION=\"3.3\">\n"
+	"<HEAD>\n"
+	"<TITLE NAME=\"Looping script test\"/>\n"
+	"<BLOCKSET HREF=\"file://localhost/%s/" BLOCKSET_FILE_NAME "\"/>\n"
+	"<MAP DIMENSIONS=\"(3,3,1)\"/>\n"
+	"</HEAD>\n"
+	"<BODY>\n"
+	"<SCRIPT TRIGGER=\"timer\" DELAY=\"0\">\n"
+	"i = 0;\n"
+	"while (1) {\n"
+	"  i = i + 1;\n"
+	"}\n"
+	"</SCRIPT>\n"
+	"<LEVEL NUMBER=\"1\">\n"
+	"...\n"
+	"...\n"
+	"...\n"
+	"</LEVEL>\n"
+	"</BODY>\n"
+	"</SPOT>\n";
+
+//------------------------------------------------------------------------------
+// Write the blockset, which is a zip archive holding the style file.
+//------------------------------------------------------------------------------
+
+static bool
+write_blockset(void)
+{
+	zipFile zip_file;
+	bool success;
+
+	if ((zip_file = zipOpen(BLOCKSET_FILE_NAME, 0)) == NULL)
+		return(false);
+	success = zipOpenNewFileInZip(zip_file, STYLE_FILE_NAME, NULL, NULL, 0,
+		NULL, 0, NULL, Z_DEFLATED, Z_DEFAULT_COMPRESSION) == ZIP_OK;
+	if (success) {
+		success = zipWriteInFileInZip(zip_file, style_file,
+			(unsigned)strlen(style_file)) == ZIP_OK;
+		success = zipCloseFileInZip(zip_file) == ZIP_OK && success;
+	}
+	return(zipClose(zip_file, NULL) == ZIP_OK && success);
+}
+
+//------------------------------------------------------------------------------
+// Write the spot, which refers to the blockset in the given directory.
+//------------------------------------------------------------------------------
+
+static bool
+write_spot(const char *dir_path)
+{
+	FILE *fp;
+	bool success;
+
+	if ((fp = fopen(SPOT_FILE_NAME, "w")) == NULL)
+		return(false);
+	success = fprintf(fp, spot_file_format, dir_path) > 0;
+	return(fclose(fp) == 0 && success);
+}
+
+//------------------------------------------------------------------------------
+// Run the headless runner on the spot, and return its exit status, or -1 if it
+// couldn't be run or was killed.
+//------------------------------------------------------------------------------
+
+static int
+run_spot(const char *runner_path, const char *dir_path)
+{
+	char command[PATH_MAX * 2 + 64];
+	int status;
+
+	snprintf(command, sizeof(command), "\"%s\" -f %d -s %d -t %d \"%s/%s\"",
+		runner_path, FRAMES, TIME_STEP_MS, TIMEOUT_SECS, dir_path,
+		SPOT_FILE_NAME);
+	status = system(command);
+	if (status == -1 || !WIFEXITED(status))
+		return(-1);
+	return(WEXITSTATUS(status));
+}
+
+//------------------------------------------------------------------------------
+// Run the tests.
+//------------------------------------------------------------------------------
+
+int
+main(int argc, char *argv[])
+{
+	char dir_path[PATH_MAX];
+
+	if (argc != 2) {
+		printf("Usage: %s headless-runner\n", argv[0]);
+		return(2);
+	}
+	CHECK(getcwd(dir_path, sizeof(dir_path)) != NULL);
+	CHECK(write_blockset());
+	CHECK(write_spot(dir_path));
+	CHECK(run_spot(argv[1], dir_path) == 0);
+	remove(SPOT_FILE_NAME);
+	remove(BLOCKSET_FILE_NAME);
+	return(test_result("Headless script tests"));
+}
@@ -0,0 +1,272 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Benchmark of polygon vertex lighting: lights the same polygons with
+// compute_vertex_colours() and with compute_vertex_colour() one vertex at a
+// time, reports the time taken by each, and checks that the colours agree.
+// It then does the same for the brightness of polygon centroids, as used by
+// the software renderer, lit in blocks with compute_vertex_brightnesses() and
+// one at a time with compute_vertex_brightness(), each with its own normal.
+// The batched code may round differently, and a vertex within rounding
+// distance of a light's radius or a spot light's cone edge may fall on the
+// other side of it, so a few vertices are allowed to differ by more.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "Classes.h"
+#include "Light.h"
+#include "Main.h"
+#include "Test.h"
+
+// The size of the test, and the rounding allowed in a colour component.
+
+#define POLYGONS				4096
+#define POLYGON_VERTICES		4
+#define PASSES					64
+#define COLOUR_TOLERANCE		0.01f
+#define BRIGHTNESS_TOLERANCE	(COLOUR_TOLERANCE / 255.0f)
+
+// The number of centroids lit in each batch, as the polygons of a block are.
+
+#define BLOCK_POLYGONS			16
+#define CENTROIDS				(POLYGONS * POLYGON_VERTICES)
+
+// The lights and the polygons being lit.
+
+static light light_list[ACTIVE_LIGHTS_LIMIT];
+static light_ref active_light_list[ACTIVE_LIGHTS_LIMIT];
+static vertex vertex_list[POLYGONS][POLYGON_VERTICES];
+static vector normal_list[POLYGONS];
+static RGBcolour batch_colour_list[POLYGONS][POLYGON_VERTICES];
+static RGBcolour scalar_colour_list[POLYGONS][POLYGON_VERTICES];
+
+// The polygon vertices are reused as the centroids lit by the software
+// renderer, each of which has its own normal.
+
+static vertex *centroid_list = &vertex_list[0][0];
+static vector centroid_normal_list[CENTROIDS];
+static float batch_brightness_list[CENTROIDS];
+static float scalar_brightness_list[CENTROIDS];
+
+//------------------------------------------------------------------------------
+// Return a random number between the given limits.
+//------------------------------------------------------------------------------
+
+static float
+random_float(float min_value, float max_value)
+{
+	return(min_value + (max_value - min_value) * (float)rand() / RAND_MAX);
+}
+
+//------------------------------------------------------------------------------
+// Set up the active lights, alternating between point and spot lights, with
+// every fourth one a flood light.
+//------------------------------------------------------------------------------
+
+static void
+set_up_lights(void)
+{
+	RGBcolour colour;
+
+	colour.set_RGB(64.0f, 64.0f, 64.0f);
+	set_ambient_light(0.5f, colour);
+	set_master_intensity(0.0f);
+	max_active_lights = ACTIVE_LIGHTS_LIMIT;
+	for (int index = 0; index < ACTIVE_LIGHTS_LIMIT; index++) {
+		light *light_ptr = &light_list[index];
+		light_ptr->style = index & 1 ? STATIC_SPOT_LIGHT : STATIC_POINT_LIGHT;
+		light_ptr->colour.set_RGB(random_float(0.0f, 255.0f),
+			random_float(0.0f, 255.0f), random_float(0.0f, 255.0f));
+		light_ptr->set_intensity(random_float(0.25f, 1.0f));
+		light_ptr->set_radius(random_float(1.0f, 3.0f));
+		light_ptr->set_cone_angle(random_float(20.0f, 60.0f));
+		light_ptr->dir.set(random_float(-1.0f, 1.0f), -1.0f,
+			random_float(-1.0f, 1.0f));
+		light_ptr->dir.normalise();
+		light_ptr->flood = (index & 3) == 3;
+		active_light_list[index].light_ptr = light_ptr;
+		active_light_list[index].light_pos.set(random_float(0.0f, 3.2f),
+			random_float(1.6f, 3.2f), random_float(0.0f, 3.2f));
+	}
+}
+
+//------------------------------------------------------------------------------
+// Set up the polygons, each with its vertices scattered around a block.
+//------------------------------------------------------------------------------
+
+static void
+set_up_polygons(void)
+{
+	for (int polygon_no = 0; polygon_no < POLYGONS; polygon_no++) {
+		normal_list[polygon_no].set(random_float(-1.0f, 1.0f),
+			random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f));
+		normal_list[polygon_no].normalise();
+		for (int vertex_no = 0; vertex_no < POLYGON_VERTICES; vertex_no++)
+			vertex_list[polygon_no][vertex_no].set(random_float(0.0f, 3.2f),
+				random_float(0.0f, 3.2f), random_float(0.0f, 3.2f));
+	}
+	for (int centroid_no = 0; centroid_no < CENTROIDS; centroid_no++) {
+		centroid_normal_list[centroid_no].set(random_float(-1.0f, 1.0f),
+			random_float(-1.0f, 1.0f), random_float(-1.0f, 1.0f));
+		centroid_normal_list[centroid_no].normalise();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Light every polygon a number of times, either in batches or one vertex at a
+// time, and return the time taken in milliseconds.
+//------------------------------------------------------------------------------
+
+static double
+light_polygons(bool batched)
+{
+	clock_t start_time = clock();
+	for (int pass = 0; pass < PASSES; pass++) {
+		for (int polygon_no = 0; polygon_no < POLYGONS; polygon_no++) {
+			if (batched)
+				compute_vertex_colours(active_light_list, POLYGON_VERTICES,
+					vertex_list[polygon_no], &normal_list[polygon_no],
+					batch_colour_list[polygon_no]);
+			else {
+				for (int vertex_no = 0; vertex_no < POLYGON_VERTICES;
+					vertex_no++)
+					compute_vertex_colour(active_light_list,
+						&vertex_list[polygon_no][vertex_no],
+						&normal_list[polygon_no],
+						&scalar_colour_list[polygon_no][vertex_no]);
+			}
+		}
+	}
+	return((double)(clock() - start_time) * 1000.0 / CLOCKS_PER_SEC);
+}
+
+//------------------------------------------------------------------------------
+// Light every centroid a number of times, either in batches the size of a
+// block or one at a time, and return the time taken in milliseconds.
+//------------------------------------------------------------------------------
+
+static double
+light_centroids(bool batched)
+{
+	clock_t start_time = clock();
+	for (int pass = 0; pass < PASSES; pass++) {
+		for (int centroid_no = 0; centroid_no < CENTROIDS;
+			centroid_no += BLOCK_POLYGONS) {
+			if (batched)
+				compute_vertex_brightnesses(active_light_list, BLOCK_POLYGONS,
+					&centroid_list[centroid_no],
+					&centroid_normal_list[centroid_no],
+					&batch_brightness_list[centroid_no]);
+			else {
+				for (int index = centroid_no; index < centroid_no +
+					BLOCK_POLYGONS; index++)
+					scalar_brightness_list[index] = compute_vertex_brightness(
+						active_light_list, &centroid_list[index],
+						&centroid_normal_list[index]);
+			}
+		}
+	}
+	return((double)(clock() - start_time) * 1000.0 / CLOCKS_PER_SEC);
+}
+
+//------------------------------------------------------------------------------
+// Compare the colours from both methods, and return the number of vertices
+// that differ by more than rounding.
+//------------------------------------------------------------------------------
+
+static int
+compare_colours(void)
+{
+	int differing_vertices = 0;
+	for (int polygon_no = 0; polygon_no < POLYGONS; polygon_no++) {
+		for (int vertex_no = 0; vertex_no < POLYGON_VERTICES; vertex_no++) {
+			RGBcolour *batch_colour_ptr = &batch_colour_list[polygon_no][vertex_no];
+			RGBcolour *scalar_colour_ptr = &scalar_colour_list[polygon_no][vertex_no];
+			if (fabs(batch_colour_ptr->red - scalar_colour_ptr->red) > COLOUR_TOLERANCE ||
+				fabs(batch_colour_ptr->green - scalar_colour_ptr->green) > COLOUR_TOLERANCE ||
+				fabs(batch_colour_ptr->blue - scalar_colour_ptr->blue) > COLOUR_TOLERANCE)
+				differing_vertices++;
+		}
+	}
+	return(differing_vertices);
+}
+
+//------------------------------------------------------------------------------
+// Compare the brightnesses from both methods, and return the number of
+// centroids that differ by more than rounding.
+//------------------------------------------------------------------------------
+
+static int
+compare_brightnesses(void)
+{
+	int differing_centroids = 0;
+	for (int centroid_no = 0; centroid_no < CENTROIDS; centroid_no++) {
+		if (fabs(batch_brightness_list[centroid_no] -
+			scalar_brightness_list[centroid_no]) > BRIGHTNESS_TOLERANCE)
+			differing_centroids++;
+	}
+	return(differing_centroids);
+}
+
+//------------------------------------------------------------------------------
+// Run the benchmark.
+//------------------------------------------------------------------------------
+
+int
+main(void)
+{
+	double scalar_time, batch_time;
+	int differing_vertices, differing_centroids;
+	float brightness;
+
+	srand(1);
+	units_per_block = UNITS_PER_BLOCK;
+	units_per_half_block = UNITS_PER_HALF_BLOCK;
+	set_up_lights();
+	set_up_polygons();
+	scalar_time = light_polygons(false);
+	batch_time = light_polygons(true);
+	printf("Lit %d vertices %d times with %d active lights\n",
+		POLYGONS * POLYGON_VERTICES, PASSES, ACTIVE_LIGHTS_LIMIT);
+	printf("compute_vertex_colour:  %.1f ms\n", scalar_time);
+	printf("compute_vertex_colours: %.1f ms\n", batch_time);
+
+	// Only the odd vertex on the edge of a light may differ by more than
+	// rounding.
+
+	differing_vertices = compare_colours();
+	printf("Vertices differing by more than rounding: %d\n", differing_vertices);
+	CHECK(differing_vertices <= POLYGONS * POLYGON_VERTICES / 1000);
+
+	// A single vertex is lit by the scalar code, so it must match exactly.
+
+	compute_vertex_colours(active_light_list, 1, vertex_list[0], &normal_list[0],
+		batch_colour_list[0]);
+	compute_vertex_colour(active_light_list, vertex_list[0], &normal_list[0],
+		scalar_colour_list[0]);
+	CHECK(batch_colour_list[0][0].red == scalar_colour_list[0][0].red &&
+		batch_colour_list[0][0].green == scalar_colour_list[0][0].green &&
+		batch_colour_list[0][0].blue == scalar_colour_list[0][0].blue);
+
+	// Do the same for the centroids.
+
+	scalar_time = light_centroids(false);
+	batch_time = light_centroids(true);
+	printf("Lit %d centroids %d times in batches of %d\n", CENTROIDS, PASSES,
+		BLOCK_POLYGONS);
+	printf("compute_vertex_brightness:   %.1f ms\n", scalar_time);
+	printf("compute_vertex_brightnesses: %.1f ms\n", batch_time);
+	differing_centroids = compare_brightnesses();
+	printf("Centroids differing by more than rounding: %d\n",
+		differing_centroids);
+	CHECK(differing_centroids <= CENTROIDS / 1000);
+	compute_vertex_brightnesses(active_light_list, 1, centroid_list,
+		centroid_normal_list, &brightness);
+	CHECK(brightness == compute_vertex_brightness(active_light_list,
+		centroid_list, centroid_normal_list));
+	return(test_result("Lighting benchmark"));
+}
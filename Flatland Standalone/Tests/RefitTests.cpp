@@ -0,0 +1,400 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Tests of refitting a block's collision mesh to its vertices, as
+// block::update() does once the mesh's triangles have been built: after the
+// block is rotated or its vertices are moved, the refitted mesh must fit the
+// new vertices and polygons, and match one built from scratch from them.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Collision/Collision.h"
+#include "Classes.h"
+#include "Main.h"
+#include "Memory.h"
+#include "Test.h"
+
+// The block is a cube with six faces: the top and bottom are single-sided,
+// three sides are double-sided, and the last side isn't solid, so it has no
+// triangles in the mesh.
+
+#define CUBE_VERTICES			8
+#define CUBE_FACES				6
+#define SINGLE_SIDED_PART		0
+#define DOUBLE_SIDED_PART		1
+#define NON_SOLID_PART			2
+
+static int face_vertex_list[CUBE_FACES][4] = {
+	{2, 3, 7, 6}, {0, 4, 5, 1}, {0, 2, 6, 4}, {1, 5, 7, 3}, {0, 1, 3, 2},
+	{4, 6, 7, 5}
+};
+static int face_part_list[CUBE_FACES] = {
+	SINGLE_SIDED_PART, SINGLE_SIDED_PART, DOUBLE_SIDED_PART, DOUBLE_SIDED_PART,
+	DOUBLE_SIDED_PART, NON_SOLID_PART
+};
+
+// The number of times the block is changed in each test.
+
+#define CHANGES					32
+
+// The block definition shared by the blocks in the tests.
+
+static block_def *cube_block_def_ptr;
+
+//------------------------------------------------------------------------------
+// Return a random number between the given limits.
+//------------------------------------------------------------------------------
+
+static float
+random_float(float min_value, float max_value)
+{
+	return(min_value + (max_value - min_value) * (float)rand() / RAND_MAX);
+}
+
+//------------------------------------------------------------------------------
+// Create the cube's block definition.
+//------------------------------------------------------------------------------
+
+static void
+create_cube_block_def(void)
+{
+	NEW(cube_block_def_ptr, block_def);
+	cube_block_def_ptr->create_part_list(3);
+	cube_block_def_ptr->part_list[DOUBLE_SIDED_PART].faces = 2;
+	cube_block_def_ptr->part_list[NON_SOLID_PART].solid = false;
+	cube_block_def_ptr->create_vertex_list(CUBE_VERTICES);
+	for (int vertex_no = 0; vertex_no < CUBE_VERTICES; vertex_no++)
+		cube_block_def_ptr->vertex_list[vertex_no].set(
+			vertex_no & 1 ? UNITS_PER_BLOCK : 0.0f,
+			vertex_no & 2 ? UNITS_PER_BLOCK : 0.0f,
+			vertex_no & 4 ? UNITS_PER_BLOCK : 0.0f);
+	cube_block_def_ptr->create_polygon_def_list(CUBE_FACES);
+	for (int face_no = 0; face_no < CUBE_FACES; face_no++) {
+		polygon_def *polygon_def_ptr =
+			&cube_block_def_ptr->polygon_def_list[face_no];
+		polygon_def_ptr->part_no = face_part_list[face_no];
+		polygon_def_ptr->part_ptr =
+			&cube_block_def_ptr->part_list[face_part_list[face_no]];
+		CHECK(polygon_def_ptr->create_vertex_def_list(4));
+		for (int vertex_no = 0; vertex_no < 4; vertex_no++)
+			polygon_def_ptr->vertex_def_list[vertex_no].vertex_no =
+				face_vertex_list[face_no][vertex_no];
+	}
+}
+
+//------------------------------------------------------------------------------
+// Create a block with its own geometry, with the given vertices, and build its
+// collision mesh from scratch.
+//------------------------------------------------------------------------------
+
+static block *
+create_block(vertex *vertex_list)
+{
+	block *block_ptr;
+
+	NEW(block_ptr, block);
+	block_ptr->block_def_ptr = cube_block_def_ptr;
+	block_ptr->square_ptr = NULL;
+	block_ptr->block_origin.set(UNITS_PER_HALF_BLOCK, UNITS_PER_HALF_BLOCK,
+		UNITS_PER_HALF_BLOCK);
+	CHECK(block_ptr->create_vertex_list(CUBE_VERTICES));
+	for (int vertex_no = 0; vertex_no < CUBE_VERTICES; vertex_no++)
+		block_ptr->vertex_list[vertex_no] = vertex_list[vertex_no];
+	CHECK(block_ptr->create_polygon_list(CUBE_FACES));
+	for (int face_no = 0; face_no < CUBE_FACES; face_no++) {
+		polygon *polygon_ptr = &block_ptr->polygon_list[face_no];
+		polygon_ptr->polygon_def_ptr =
+			&cube_block_def_ptr->polygon_def_list[face_no];
+		polygon_ptr->compute_normal_vector(block_ptr->vertex_list);
+	}
+	CHECK(COL_createBlockColMesh(block_ptr));
+	COL_convertBlockToColMesh(block_ptr);
+	return(block_ptr);
+}
+
+//------------------------------------------------------------------------------
+// Return TRUE if two vectors are identical.
+//------------------------------------------------------------------------------
+
+static bool
+same_vector(VEC3 *vector1_ptr, VEC3 *vector2_ptr)
+{
+	return(vector1_ptr->x == vector2_ptr->x &&
+		vector1_ptr->y == vector2_ptr->y && vector1_ptr->z == vector2_ptr->z);
+}
+
+//------------------------------------------------------------------------------
+// Check the geometry of a block's collision mesh against the block's vertices
+// and polygons: each solid polygon is a fan of triangles, whose edges, bounding
+// boxes and normals must be those of its vertices and polygon, and the packed
+// groups must hold the same bounding boxes and normals.
+//------------------------------------------------------------------------------
+
+static void
+check_mesh_geometry(block *block_ptr)
+{
+	COL_MESH *mesh_ptr;
+	VEC3 mesh_min, mesh_max;
+	int index, poly_no, vertex_no;
+
+	mesh_ptr = block_ptr->col_mesh_ptr;
+	for (index = 0; index < mesh_ptr->numVerts; index++) {
+		vertex *vertex_ptr = &block_ptr->vertex_list[index];
+		CHECK(mesh_ptr->v[index].x == vertex_ptr->x &&
+			mesh_ptr->v[index].y == vertex_ptr->y &&
+			mesh_ptr->v[index].z == vertex_ptr->z);
+	}
+	VEC_set(&mesh_min, 999999.0f, 999999.0f, 999999.0f);
+	VEC_set(&mesh_max, -999999.0f, -999999.0f, -999999.0f);
+	poly_no = 0;
+	for (int face_no = 0; face_no < CUBE_FACES; face_no++) {
+		polygon *polygon_ptr = &block_ptr->polygon_list[face_no];
+		polygon_def *polygon_def_ptr = polygon_ptr->polygon_def_ptr;
+		if (!polygon_def_ptr->part_ptr->solid)
+			continue;
+		for (int triangle_no = 0; triangle_no < polygon_def_ptr->vertices - 2;
+			triangle_no++) {
+			COL_POLY3 *poly_ptr = &mesh_ptr->p[poly_no];
+			int vertex_index_list[3];
+
+			vertex_index_list[0] = polygon_def_ptr->vertex_def_list[0].vertex_no;
+			vertex_index_list[1] =
+				polygon_def_ptr->vertex_def_list[triangle_no + 1].vertex_no;
+			vertex_index_list[2] =
+				polygon_def_ptr->vertex_def_list[triangle_no + 2].vertex_no;
+			for (vertex_no = 0; vertex_no < 3; vertex_no++) {
+				vertex *vertex_ptr =
+					&block_ptr->vertex_list[vertex_index_list[vertex_no]];
+				vertex *next_vertex_ptr = &block_ptr->vertex_list[
+					vertex_index_list[(vertex_no + 1) % 3]];
+				VEC3 *edge_ptr = &mesh_ptr->e[poly_ptr->edgeIdx[vertex_no]];
+
+				CHECK(poly_ptr->vIdx[vertex_no] == vertex_index_list[vertex_no]);
+				CHECK(edge_ptr->x == next_vertex_ptr->x - vertex_ptr->x &&
+					edge_ptr->y == next_vertex_ptr->y - vertex_ptr->y &&
+					edge_ptr->z == next_vertex_ptr->z - vertex_ptr->z);
+				CHECK(vertex_ptr->x >= poly_ptr->min.x &&
+					vertex_ptr->x <= poly_ptr->max.x);
+				CHECK(vertex_ptr->y >= poly_ptr->min.y &&
+					vertex_ptr->y <= poly_ptr->max.y);
+				CHECK(vertex_ptr->z >= poly_ptr->min.z &&
+					vertex_ptr->z <= poly_ptr->max.z);
+				mesh_min.x = MIN(mesh_min.x, vertex_ptr->x);
+				mesh_min.y = MIN(mesh_min.y, vertex_ptr->y);
+				mesh_min.z = MIN(mesh_min.z, vertex_ptr->z);
+				mesh_max.x = MAX(mesh_max.x, vertex_ptr->x);
+				mesh_max.y = MAX(mesh_max.y, vertex_ptr->y);
+				mesh_max.z = MAX(mesh_max.z, vertex_ptr->z);
+			}
+
+			// The normal is normalised with a square root table, so it's
+			// only close to the polygon's.
+
+			CHECK_NEAR(poly_ptr->normal.x, polygon_ptr->normal_vector.dx, 1e-3f);
+			CHECK_NEAR(poly_ptr->normal.y, polygon_ptr->normal_vector.dy, 1e-3f);
+			CHECK_NEAR(poly_ptr->normal.z, polygon_ptr->normal_vector.dz, 1e-3f);
+			poly_no++;
+		}
+	}
+	CHECK(poly_no == mesh_ptr->numPolys);
+	CHECK(same_vector(&mesh_ptr->minBox, &mesh_min));
+	CHECK(same_vector(&mesh_ptr->maxBox, &mesh_max));
+
+	// Check the packed groups, whose unused lanes must be zero.
+
+	for (index = 0; index < mesh_ptr->numPolyGroups * COL_POLY_LANES; index++) {
+		COL_POLY4 *group_ptr = &mesh_ptr->p4[index / COL_POLY_LANES];
+		int lane = index % COL_POLY_LANES;
+		if (index < mesh_ptr->numPolys) {
+			COL_POLY3 *poly_ptr = &mesh_ptr->p[index];
+			CHECK(group_ptr->minX[lane] == poly_ptr->min.x &&
+				group_ptr->minY[lane] == poly_ptr->min.y &&
+				group_ptr->minZ[lane] == poly_ptr->min.z);
+			CHECK(group_ptr->maxX[lane] == poly_ptr->max.x &&
+				group_ptr->maxY[lane] == poly_ptr->max.y &&
+				group_ptr->maxZ[lane] == poly_ptr->max.z);
+			CHECK(group_ptr->normalX[lane] == poly_ptr->normal.x &&
+				group_ptr->normalY[lane] == poly_ptr->normal.y &&
+				group_ptr->normalZ[lane] == poly_ptr->normal.z);
+			CHECK(group_ptr->doubleSided[lane] ==
+				(poly_ptr->double_sided ? -1 : 0));
+		} else {
+			CHECK(group_ptr->minX[lane] == 0.0f && group_ptr->maxX[lane] == 0.0f &&
+				group_ptr->normalX[lane] == 0.0f &&
+				group_ptr->doubleSided[lane] == 0);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Check that the refitted collision mesh of a block fits its vertices, and
+// matches the one built from scratch for a new block with the same vertices.
+//------------------------------------------------------------------------------
+
+static void
+check_refitted_mesh(block *block_ptr)
+{
+	block *new_block_ptr;
+	COL_MESH *mesh_ptr, *new_mesh_ptr;
+	int index, lane;
+
+	check_mesh_geometry(block_ptr);
+	new_block_ptr = create_block(block_ptr->vertex_list);
+	mesh_ptr = block_ptr->col_mesh_ptr;
+	new_mesh_ptr = new_block_ptr->col_mesh_ptr;
+	CHECK(mesh_ptr->topologyBuilt);
+	CHECK(mesh_ptr->numPolys == new_mesh_ptr->numPolys);
+	CHECK(same_vector(&mesh_ptr->minBox, &new_mesh_ptr->minBox));
+	CHECK(same_vector(&mesh_ptr->maxBox, &new_mesh_ptr->maxBox));
+	for (index = 0; index < mesh_ptr->numVerts; index++)
+		CHECK(same_vector(&mesh_ptr->v[index], &new_mesh_ptr->v[index]));
+	for (index = 0; index < mesh_ptr->numEdges; index++)
+		CHECK(same_vector(&mesh_ptr->e[index], &new_mesh_ptr->e[index]));
+	for (index = 0; index < mesh_ptr->numPolys; index++) {
+		COL_POLY3 *poly_ptr = &mesh_ptr->p[index];
+		COL_POLY3 *new_poly_ptr = &new_mesh_ptr->p[index];
+		for (int vertex_no = 0; vertex_no < 3; vertex_no++) {
+			CHECK(poly_ptr->vIdx[vertex_no] == new_poly_ptr->vIdx[vertex_no]);
+			CHECK(poly_ptr->edgeIdx[vertex_no] ==
+				new_poly_ptr->edgeIdx[vertex_no]);
+		}
+		CHECK(poly_ptr->normalMajorAxis == new_poly_ptr->normalMajorAxis);
+		CHECK(same_vector(&poly_ptr->min, &new_poly_ptr->min));
+		CHECK(same_vector(&poly_ptr->max, &new_poly_ptr->max));
+		CHECK(same_vector(&poly_ptr->normal, &new_poly_ptr->normal));
+		CHECK(poly_ptr->double_sided == new_poly_ptr->double_sided);
+	}
+	for (index = 0; index < mesh_ptr->numPolyGroups; index++) {
+		COL_POLY4 *group_ptr = &mesh_ptr->p4[index];
+		COL_POLY4 *new_group_ptr = &new_mesh_ptr->p4[index];
+		for (lane = 0; lane < COL_POLY_LANES; lane++) {
+			CHECK(group_ptr->minX[lane] == new_group_ptr->minX[lane] &&
+				group_ptr->minY[lane] == new_group_ptr->minY[lane] &&
+				group_ptr->minZ[lane] == new_group_ptr->minZ[lane]);
+			CHECK(group_ptr->maxX[lane] == new_group_ptr->maxX[lane] &&
+				group_ptr->maxY[lane] == new_group_ptr->maxY[lane] &&
+				group_ptr->maxZ[lane] == new_group_ptr->maxZ[lane]);
+			CHECK(group_ptr->normalX[lane] == new_group_ptr->normalX[lane] &&
+				group_ptr->normalY[lane] == new_group_ptr->normalY[lane] &&
+				group_ptr->normalZ[lane] == new_group_ptr->normalZ[lane]);
+			CHECK(group_ptr->doubleSided[lane] ==
+				new_group_ptr->doubleSided[lane]);
+		}
+	}
+	DEL(new_block_ptr, block);
+}
+
+//------------------------------------------------------------------------------
+// The mesh of a new block has two triangles for each solid face, and only the
+// double-sided faces' triangles are marked as such.
+//------------------------------------------------------------------------------
+
+static void
+test_new_mesh(void)
+{
+	block *block_ptr;
+	COL_MESH *mesh_ptr;
+	int double_sided_polys;
+
+	block_ptr = create_block(cube_block_def_ptr->vertex_list);
+	mesh_ptr = block_ptr->col_mesh_ptr;
+	CHECK(mesh_ptr->topologyBuilt);
+	CHECK(mesh_ptr->numPolys == (CUBE_FACES - 1) * 2);
+	CHECK(mesh_ptr->numPolyGroups ==
+		(mesh_ptr->numPolys + COL_POLY_LANES - 1) / COL_POLY_LANES);
+	double_sided_polys = 0;
+	for (int index = 0; index < mesh_ptr->numPolys; index++)
+		if (mesh_ptr->p[index].double_sided)
+			double_sided_polys++;
+	CHECK(double_sided_polys == 3 * 2);
+	CHECK_NEAR(mesh_ptr->minBox.x, 0.0f, 1e-5f);
+	CHECK_NEAR(mesh_ptr->maxBox.y, UNITS_PER_BLOCK, 1e-5f);
+	check_mesh_geometry(block_ptr);
+	DEL(block_ptr, block);
+}
+
+//------------------------------------------------------------------------------
+// Rotating a block refits its mesh, which then matches a new one.
+//------------------------------------------------------------------------------
+
+static void
+test_rotated_block(void)
+{
+	block *block_ptr;
+	float old_max_x;
+
+	block_ptr = create_block(cube_block_def_ptr->vertex_list);
+	old_max_x = block_ptr->col_mesh_ptr->maxBox.x;
+	for (int change_no = 0; change_no < CHANGES; change_no++) {
+		switch (change_no % 3) {
+		case 0:
+			block_ptr->rotate_y(random_float(-180.0f, 180.0f));
+			break;
+		case 1:
+			block_ptr->rotate_x(random_float(-180.0f, 180.0f));
+			break;
+		case 2:
+			block_ptr->rotate_z(random_float(-180.0f, 180.0f));
+		}
+		check_refitted_mesh(block_ptr);
+	}
+
+	// A quarter turn around the Y axis leaves the cube's bounding box as it
+	// was, and an eighth of a turn widens it.
+
+	DEL(block_ptr, block);
+	block_ptr = create_block(cube_block_def_ptr->vertex_list);
+	block_ptr->rotate_y(90.0f);
+	CHECK_NEAR(block_ptr->col_mesh_ptr->maxBox.x, old_max_x, 1e-4f);
+	block_ptr->rotate_y(45.0f);
+	CHECK(block_ptr->col_mesh_ptr->maxBox.x > old_max_x + 0.1f);
+	check_refitted_mesh(block_ptr);
+	DEL(block_ptr, block);
+}
+
+//------------------------------------------------------------------------------
+// Moving a block's vertices, as a script or an animation frame does, refits
+// its mesh, which then matches a new one.
+//------------------------------------------------------------------------------
+
+static void
+test_moved_vertices(void)
+{
+	block *block_ptr;
+
+	block_ptr = create_block(cube_block_def_ptr->vertex_list);
+	for (int change_no = 0; change_no < CHANGES; change_no++) {
+		for (int vertex_no = 0; vertex_no < CUBE_VERTICES; vertex_no++) {
+			vertex *vertex_ptr = &block_ptr->vertex_list[vertex_no];
+			vertex_ptr->x += random_float(-0.2f, 0.2f);
+			vertex_ptr->y += random_float(-0.2f, 0.2f);
+			vertex_ptr->z += random_float(-0.2f, 0.2f);
+		}
+		block_ptr->update();
+		check_refitted_mesh(block_ptr);
+	}
+	DEL(block_ptr, block);
+}
+
+//------------------------------------------------------------------------------
+// Run the tests.
+//------------------------------------------------------------------------------
+
+int
+main(void)
+{
+	srand(1);
+	units_per_block = UNITS_PER_BLOCK;
+	units_per_half_block = UNITS_PER_HALF_BLOCK;
+	COL_init();
+	create_cube_block_def();
+	test_new_mesh();
+	test_rotated_block();
+	test_moved_vertices();
+	DEL(cube_block_def_ptr, block_def);
+	COL_exit();
+	return(test_result("Refit tests"));
+}
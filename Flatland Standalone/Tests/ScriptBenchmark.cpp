@@ -0,0 +1,302 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Benchmark of SimKin object dispatch: runs the same script against two
+// objects with the same fields, attributes and methods, one that finds a name
+// by comparing it against each name in turn, as the Flatland SimKin objects
+// used to, and one that dispatches on the symbol registered for the name, as
+// they do now.  It reports the time taken by each, and checks that the
+// script returns the same result from both.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "Simkin/skInterpreter.h"
+#include "Simkin/skParseNode.h"
+#include "Simkin/skRValueArray.h"
+#include "Test.h"
+
+// The number of times the script is run on each object.
+
+#define PASSES					16
+
+// The names recognised by the objects, in the order they are tested, with
+// the names used most by the script towards the end, as "bbox" and "max_z"
+// are in the block object.  The symbols registered for them are numbered
+// from FIRST_SYMBOL in the order of these lists.
+
+#define FIELDS					12
+#define ATTRIBUTES				12
+#define METHODS					12
+#define FIRST_SYMBOL			1
+#define FIRST_ATTRIBUTE_SYMBOL	(FIRST_SYMBOL + FIELDS)
+#define FIRST_METHOD_SYMBOL		(FIRST_ATTRIBUTE_SYMBOL + ATTRIBUTES)
+
+static const char *field_name_list[FIELDS] = {
+	"name", "type", "solid", "movable", "orientation", "angle_x", "angle_y",
+	"texture", "colour", "location", "origin", "bbox"
+};
+static const char *attribute_name_list[ATTRIBUTES] = {
+	"red", "green", "blue", "column", "row", "level", "x", "y", "z", "min_x",
+	"min_y", "max_z"
+};
+static const char *method_name_list[METHODS] = {
+	"get_vertices", "reset_vertices", "set_frame", "set_loop", "move_block",
+	"replace", "rotate_x", "rotate_y", "rotate_z", "vertex", "set_texture",
+	"scale"
+};
+
+// The script, which reads, writes and calls a field, attribute and method
+// near the end of each list, as an animation script does.
+
+#define SCRIPT_LOOPS			20000
+#define STRING(value)			#value
+#define VALUE_STRING(value)		STRING(value)
+
+static const char *script =
+	"i = 0;\n"
+	"total = 0;\n"
+	"while (i < " VALUE_STRING(SCRIPT_LOOPS) ") {\n"
+	"  obj.origin:x = i;\n"
+	"  total = total + obj.location:column + obj.bbox:max_z + obj.origin:x;\n"
+	"  total = total + obj.scale(1) + obj.rotate_z(1);\n"
+	"  i = i + 1;\n"
+	"}\n"
+	"return total;\n";
+
+//------------------------------------------------------------------------------
+// The base class of the test objects, which have a value for each field and
+// attribute, and methods that return their argument scaled by the method's
+// number.  The derived classes only differ in how they find the number of a
+// name.
+//------------------------------------------------------------------------------
+
+class dispatch_object : public skExecutable
+{
+public:
+	int value_list[FIELDS][ATTRIBUTES];
+
+	dispatch_object();
+	bool getValue(const skString& field, const skString& attribute, skRValue& value);
+	bool setValue(const skString& field, const skString& attribute, const skRValue& value);
+	bool method(const skString& method, skRValueArray& arguments, skRValue& returnValue, skExecutableContext& ctxt);
+	virtual int find_field(const skString& field) = 0;
+	virtual int find_attribute(const skString& attribute) = 0;
+	virtual int find_method(const skString& method) = 0;
+};
+
+// Default constructor initialises the values.
+
+dispatch_object::dispatch_object()
+{
+	for (int field_no = 0; field_no < FIELDS; field_no++)
+		for (int attribute_no = 0; attribute_no < ATTRIBUTES; attribute_no++)
+			value_list[field_no][attribute_no] = field_no * ATTRIBUTES + attribute_no;
+}
+
+// Get the value of a field's attribute.
+
+bool
+dispatch_object::getValue(const skString& field, const skString& attribute, skRValue& value)
+{
+	int field_no = find_field(field);
+	int attribute_no = find_attribute(attribute);
+
+	if (field_no < 0 || attribute_no < 0)
+		return(false);
+	value = value_list[field_no][attribute_no];
+	return(true);
+}
+
+// Set the value of a field's attribute.
+
+bool
+dispatch_object::setValue(const skString& field, const skString& attribute, const skRValue& value)
+{
+	int field_no = find_field(field);
+	int attribute_no = find_attribute(attribute);
+
+	if (field_no < 0 || attribute_no < 0)
+		return(false);
+	value_list[field_no][attribute_no] = value.intValue();
+	return(true);
+}
+
+// Call a method.
+
+bool
+dispatch_object::method(const skString& method, skRValueArray& arguments, skRValue& returnValue, skExecutableContext&)
+{
+	int method_no = find_method(method);
+
+	if (method_no < 0 || arguments.entries() != 1)
+		return(false);
+	returnValue = arguments[0].intValue() * method_no;
+	return(true);
+}
+
+//------------------------------------------------------------------------------
+// The object that compares a name against each name in turn.
+//------------------------------------------------------------------------------
+
+class string_dispatch_object : public dispatch_object
+{
+public:
+	int find_field(const skString& field);
+	int find_attribute(const skString& attribute);
+	int find_method(const skString& method);
+};
+
+static int
+find_name(const skString& name, const char **name_list, int names)
+{
+	for (int index = 0; index < names; index++)
+		if (name == name_list[index])
+			return(index);
+	return(-1);
+}
+
+int
+string_dispatch_object::find_field(const skString& field)
+{
+	return(find_name(field, field_name_list, FIELDS));
+}
+
+int
+string_dispatch_object::find_attribute(const skString& attribute)
+{
+	return(find_name(attribute, attribute_name_list, ATTRIBUTES));
+}
+
+int
+string_dispatch_object::find_method(const skString& method)
+{
+	return(find_name(method, method_name_list, METHODS));
+}
+
+//------------------------------------------------------------------------------
+// The object that dispatches on the symbol registered for a name.
+//------------------------------------------------------------------------------
+
+class symbol_dispatch_object : public dispatch_object
+{
+public:
+	int find_field(const skString& field);
+	int find_attribute(const skString& attribute);
+	int find_method(const skString& method);
+};
+
+static int
+find_symbol(const skString& name, int first_symbol, int names)
+{
+	int symbol = name.symbol();
+
+	if (symbol >= first_symbol && symbol < first_symbol + names)
+		return(symbol - first_symbol);
+	return(-1);
+}
+
+int
+symbol_dispatch_object::find_field(const skString& field)
+{
+	return(find_symbol(field, FIRST_SYMBOL, FIELDS));
+}
+
+int
+symbol_dispatch_object::find_attribute(const skString& attribute)
+{
+	return(find_symbol(attribute, FIRST_ATTRIBUTE_SYMBOL, ATTRIBUTES));
+}
+
+int
+symbol_dispatch_object::find_method(const skString& method)
+{
+	return(find_symbol(method, FIRST_METHOD_SYMBOL, METHODS));
+}
+
+//------------------------------------------------------------------------------
+// Register the symbols for the names, as start_up_simkin() does.
+//------------------------------------------------------------------------------
+
+static void
+register_symbols(void)
+{
+	for (int index = 0; index < FIELDS; index++)
+		skString::addSymbol(field_name_list[index], FIRST_SYMBOL + index);
+	for (int index = 0; index < ATTRIBUTES; index++)
+		skString::addSymbol(attribute_name_list[index],
+			FIRST_ATTRIBUTE_SYMBOL + index);
+	for (int index = 0; index < METHODS; index++)
+		skString::addSymbol(method_name_list[index],
+			FIRST_METHOD_SYMBOL + index);
+}
+
+//------------------------------------------------------------------------------
+// Parse the script and run it a number of times against the given object,
+// returning the result of the last run and the time taken in milliseconds.
+//------------------------------------------------------------------------------
+
+static int
+run_script(dispatch_object *object_ptr, double *time_ptr)
+{
+	skInterpreter interpreter;
+	skExecutableContext context(&interpreter);
+	skMethodDefNode *parse_tree_ptr;
+	skRValueArray arguments;
+	skRValue result;
+	clock_t start_time;
+
+	interpreter.addGlobalVariable("obj", skRValue(object_ptr));
+	try {
+		parse_tree_ptr = interpreter.parseString("benchmark", script, context);
+		start_time = clock();
+		for (int pass = 0; pass < PASSES; pass++)
+			interpreter.executeParseTree("benchmark", object_ptr,
+				parse_tree_ptr, arguments, result, context);
+		*time_ptr = (double)(clock() - start_time) * 1000.0 / CLOCKS_PER_SEC;
+		delete parse_tree_ptr;
+	}
+	catch (...) {
+		printf("Unable to run the script\n");
+		*time_ptr = 0.0;
+		return(-1);
+	}
+	return(result.intValue());
+}
+
+//------------------------------------------------------------------------------
+// Run the benchmark.
+//------------------------------------------------------------------------------
+
+int
+main(void)
+{
+	string_dispatch_object string_object;
+	symbol_dispatch_object symbol_object;
+	double string_time, symbol_time;
+	int string_result, symbol_result, expected_result;
+
+	register_symbols();
+	string_result = run_script(&string_object, &string_time);
+	symbol_result = run_script(&symbol_object, &symbol_time);
+	printf("Ran a script with %d loops %d times\n", SCRIPT_LOOPS, PASSES);
+	printf("String dispatch: %.1f ms\n", string_time);
+	printf("Symbol dispatch: %.1f ms\n", symbol_time);
+
+	// Work out what the script should return.  The origin's x is set by the
+	// script, and the location's column and the bounding box's max_z keep the
+	// values set by the constructor.  The "scale" and "rotate_z" methods are
+	// the last and fourth last.
+
+	expected_result = 0;
+	for (int loop = 0; loop < SCRIPT_LOOPS; loop++)
+		expected_result += 9 * ATTRIBUTES + 3 + 11 * ATTRIBUTES + 11 + loop +
+			(METHODS - 1) + (METHODS - 4);
+	CHECK(string_result == expected_result);
+	CHECK(symbol_result == expected_result);
+	skString::clearSymbols();
+	return(test_result("Script benchmark"));
+}
@@ -0,0 +1,299 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Tests of the compiled script cache: scripts are parsed into one
+// interpreter's shared parse trees and written to a cache file, which is then
+// read into a second interpreter.  The second interpreter must find every
+// script in the cache rather than parsing it again, and running the cached
+// byte code must give the same results as running the freshly compiled byte
+// code.  A truncated cache and one written by another version must be
+// rejected without harm.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Simkin/skInterpreter.h"
+#include "Simkin/skParseNode.h"
+#include "Simkin/skMethodTable.h"
+#include "Simkin/skRValueArray.h"
+#include "Simkin/skStringList.h"
+#include "Classes.h"
+#include "SimKin.h"
+#include "Test.h"
+
+// The cache files written by the tests, in the current directory.
+
+#define CACHE_FILE_NAME			"script_cache_test.cache"
+#define TRUNCATED_FILE_NAME		"script_cache_test_truncated.cache"
+
+// The scripts, each of which takes the parameters "a" and "b" and returns a
+// value that depends on them.  Between them they use every kind of statement
+// and literal, integers too large to be held in an instruction, and a method
+// long enough that its statement list can't be skipped with a 12-bit count.
+
+#define SCRIPTS					8
+#define LONG_SCRIPT_STATEMENTS	1000
+
+static const char *script_list[SCRIPTS - 1] = {
+	"return a + b;",
+	"total = 0;\n"
+	"i = 0;\n"
+	"while (i < a) {\n"
+	"  total = total + i * b;\n"
+	"  i = i + 1;\n"
+	"}\n"
+	"return total;\n",
+	"total = 0;\n"
+	"for i = 0 to 100000 step 5000 {\n"
+	"  total = total + i + a;\n"
+	"}\n"
+	"for i = b to 0 step -1 {\n"
+	"  total = total - i;\n"
+	"}\n"
+	"return total;\n",
+	"switch (a % 3) {\n"
+	"case 0 { return \"zero\" # b; }\n"
+	"case 1 { return \"one\" # b; }\n"
+	"default { return \"two\" # b; }\n"
+	"}\n",
+	"if (a > b) {\n"
+	"  return a - b;\n"
+	"} else {\n"
+	"  if (a < b) {\n"
+	"    return b - a;\n"
+	"  }\n"
+	"}\n"
+	"return 0;\n",
+	"return (a * 1.5) + (b / 2.0) + 20000 - 16777216;",
+	"return 'x' # a # \"-\" # b;"
+};
+
+// The arguments each script is run with.
+
+#define ARGUMENT_SETS			3
+
+static const int argument_list[ARGUMENT_SETS][2] = {
+	{ 7, 3 }, { 2, 9 }, { 12, 12 }
+};
+
+//------------------------------------------------------------------------------
+// Return the text of a script, the last of which is the long script.
+//------------------------------------------------------------------------------
+
+static skString
+get_script(int script_no)
+{
+	skString script;
+
+	if (script_no < SCRIPTS - 1)
+		return(skString(script_list[script_no]));
+	script = "x = a;\n";
+	for (int statement_no = 0; statement_no < LONG_SCRIPT_STATEMENTS;
+		statement_no++)
+		script += "x = x + b;\n";
+	script += "return x;\n";
+	return(script);
+}
+
+//------------------------------------------------------------------------------
+// Parse a script through the interpreter's shared parse trees, returning the
+// parse tree, which the interpreter owns.
+//------------------------------------------------------------------------------
+
+static skMethodDefNode *
+parse_shared_script(skInterpreter &interpreter, skExecutableContext &context,
+					int script_no)
+{
+	skStringList param_names;
+
+	param_names.append(skString("a"));
+	param_names.append(skString("b"));
+	return(interpreter.parseSharedExternalParams("test", param_names,
+		get_script(script_no), context));
+}
+
+//------------------------------------------------------------------------------
+// Return the number of shared parse trees the interpreter holds.
+//------------------------------------------------------------------------------
+
+static int
+count_shared_scripts(skInterpreter &interpreter)
+{
+	skTSHashTableIterator<skMethodDefNode>
+		iter(interpreter.getSharedParseTrees());
+	int scripts = 0;
+
+	while (iter())
+		scripts++;
+	return(scripts);
+}
+
+//------------------------------------------------------------------------------
+// Run a parse tree with the given arguments, and return the result as a string.
+//------------------------------------------------------------------------------
+
+static skString
+run_script(skInterpreter &interpreter, skExecutableContext &context,
+		   skMethodDefNode *script_ptr, int argument_set)
+{
+	skRValueArray arguments;
+	skRValue result;
+
+	arguments.append(skRValue(argument_list[argument_set][0]));
+	arguments.append(skRValue(argument_list[argument_set][1]));
+	try {
+		interpreter.executeParseTree("test", NULL, script_ptr, arguments,
+			result, context);
+	}
+	catch (...) {
+		return(skString("failed"));
+	}
+	return(result.str());
+}
+
+//------------------------------------------------------------------------------
+// Copy the first half of a file to another file.
+//------------------------------------------------------------------------------
+
+static bool
+truncate_file(const char *file_path, const char *truncated_file_path)
+{
+	FILE *fp;
+	char *buffer;
+	long size;
+	bool success;
+
+	if ((fp = fopen(file_path, "rb")) == NULL)
+		return(false);
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	buffer = (char *)malloc(size);
+	success = buffer != NULL && fread(buffer, 1, size, fp) == (size_t)size;
+	fclose(fp);
+	if (success) {
+		success = (fp = fopen(truncated_file_path, "wb")) != NULL;
+		if (success) {
+			success = fwrite(buffer, 1, size / 2, fp) == (size_t)(size / 2);
+			fclose(fp);
+		}
+	}
+	free(buffer);
+	return(success);
+}
+
+//------------------------------------------------------------------------------
+// Run the tests.
+//------------------------------------------------------------------------------
+
+int
+main(void)
+{
+	skString expected_list[SCRIPTS][ARGUMENT_SETS];
+	skMethodDefNode *script_ptr;
+	FILE *fp;
+
+	// Parse and run each script in the first interpreter, then write its
+	// shared parse trees to the cache.
+
+	{
+		skInterpreter interpreter;
+		skExecutableContext context(&interpreter);
+
+		interpreter.setShareParseTrees(true);
+		for (int script_no = 0; script_no < SCRIPTS; script_no++) {
+			script_ptr = parse_shared_script(interpreter, context, script_no);
+			CHECK(script_ptr != NULL);
+			if (script_ptr == NULL)
+				continue;
+			for (int argument_set = 0; argument_set < ARGUMENT_SETS;
+				argument_set++) {
+				expected_list[script_no][argument_set] = run_script(interpreter,
+					context, script_ptr, argument_set);
+				CHECK(!(expected_list[script_no][argument_set] == "failed"));
+			}
+		}
+		CHECK(write_script_cache(&interpreter, CACHE_FILE_NAME));
+	}
+
+	// Read the cache into a second interpreter.  Each script must then be
+	// found among the shared parse trees rather than parsed and added again,
+	// and running it must give the same results.
+
+	{
+		skInterpreter interpreter;
+		skExecutableContext context(&interpreter);
+
+		interpreter.setShareParseTrees(true);
+		CHECK(read_script_cache(&interpreter, CACHE_FILE_NAME) == SCRIPTS);
+		for (int script_no = 0; script_no < SCRIPTS; script_no++) {
+			script_ptr = parse_shared_script(interpreter, context, script_no);
+			CHECK(script_ptr != NULL);
+			CHECK(count_shared_scripts(interpreter) == SCRIPTS);
+			if (script_ptr == NULL)
+				continue;
+			for (int argument_set = 0; argument_set < ARGUMENT_SETS;
+				argument_set++)
+				CHECK(run_script(interpreter, context, script_ptr,
+					argument_set) == expected_list[script_no][argument_set]);
+		}
+
+		// Writing the cache again from the scripts that were read from it
+		// must give a cache that reads back in full.
+
+		CHECK(write_script_cache(&interpreter, CACHE_FILE_NAME));
+	}
+	{
+		skInterpreter interpreter;
+
+		interpreter.setShareParseTrees(true);
+		CHECK(read_script_cache(&interpreter, CACHE_FILE_NAME) == SCRIPTS);
+	}
+
+	// A truncated cache must yield fewer scripts, each of which still runs.
+
+	CHECK(truncate_file(CACHE_FILE_NAME, TRUNCATED_FILE_NAME));
+	{
+		skInterpreter interpreter;
+		skExecutableContext context(&interpreter);
+		int scripts;
+
+		interpreter.setShareParseTrees(true);
+		scripts = read_script_cache(&interpreter, TRUNCATED_FILE_NAME);
+		CHECK(scripts < SCRIPTS);
+		for (int script_no = 0; script_no < SCRIPTS; script_no++) {
+			script_ptr = parse_shared_script(interpreter, context, script_no);
+			CHECK(script_ptr != NULL);
+			if (script_ptr != NULL)
+				CHECK(run_script(interpreter, context, script_ptr, 0) ==
+					expected_list[script_no][0]);
+		}
+	}
+
+	// A cache with a different version must be ignored.  The version follows
+	// the signature string, which is stored as its length and its characters.
+
+	if ((fp = fopen(CACHE_FILE_NAME, "r+b")) != NULL) {
+		int length, version;
+
+		CHECK(fread(&length, sizeof(int), 1, fp) == 1);
+		fseek(fp, sizeof(int) + length * sizeof(Char), SEEK_SET);
+		CHECK(fread(&version, sizeof(int), 1, fp) == 1);
+		version++;
+		fseek(fp, sizeof(int) + length * sizeof(Char), SEEK_SET);
+		CHECK(fwrite(&version, sizeof(int), 1, fp) == 1);
+		fclose(fp);
+	} else
+		CHECK(fp != NULL);
+	{
+		skInterpreter interpreter;
+
+		interpreter.setShareParseTrees(true);
+		CHECK(read_script_cache(&interpreter, CACHE_FILE_NAME) == 0);
+	}
+	remove(CACHE_FILE_NAME);
+	remove(TRUNCATED_FILE_NAME);
+	return(test_result("Script cache tests"));
+}
@@ -0,0 +1,289 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Benchmark of add_span(): fills a span buffer with frames of overlapping
+// random spans, added front to back as the renderer does, then replays the
+// spans of a real frame, and reports the time taken by each.  A separate pass
+// checks each row against a simple coverage map: the opaque spans must be
+// sorted, must not overlap, and must cover exactly the pixels covered by the
+// opaque spans added to the row.
+//
+// The real frame is read from the span stream file passed as the only
+// argument, which was written by running the headless runner with the "-r"
+// option on a spot of box pillars standing on open ground, viewed across the
+// map in a 640x480 window.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "Classes.h"
+#include "Main.h"
+#include "Memory.h"
+#include "Spans.h"
+#include "Test.h"
+
+// The largest frame buffer, the size of the random frames, and the number
+// of times each is added.
+
+#define MAX_FRAME_WIDTH			640
+#define MAX_FRAME_HEIGHT		480
+#define MAX_SPANS				100000
+#define SPANS_PER_FRAME			MAX_SPANS
+#define RANDOM_FRAMES			32
+#define STREAM_REPLAYS			256
+
+// Transparent spans use a pixmap with a transparent colour index, and so
+// don't cover anything.
+
+static pixmap transparent_pixmap;
+
+// The size of the frame buffer, and the spans added in a frame, as left and
+// right edges.
+
+static int frame_width, frame_height;
+static int spans;
+static edge left_edge_list[MAX_SPANS];
+static edge right_edge_list[MAX_SPANS];
+static int row_list[MAX_SPANS];
+static bool transparent_list[MAX_SPANS];
+static bool popup_list[MAX_SPANS];
+
+// The pixels covered in each row, computed directly.
+
+static bool coverage_map[MAX_FRAME_HEIGHT][MAX_FRAME_WIDTH];
+
+//------------------------------------------------------------------------------
+// Return a random number between the given limits.
+//------------------------------------------------------------------------------
+
+static float
+random_float(float min_value, float max_value)
+{
+	return(min_value + (max_value - min_value) * (float)rand() / RAND_MAX);
+}
+
+//------------------------------------------------------------------------------
+// Set up the spans for a random frame, mostly narrow ones with the occasional
+// wide one, and every fourth one transparent.  Polygons are clipped to the
+// display before their spans are added, so the spans lie within the frame
+// buffer.
+//------------------------------------------------------------------------------
+
+static void
+set_up_random_spans(void)
+{
+	spans = SPANS_PER_FRAME;
+	for (int span_no = 0; span_no < spans; span_no++) {
+		float width = rand() % 16 == 0 ? random_float(64.0f, frame_width) :
+			random_float(0.0f, 48.0f);
+		float left_sx = random_float(0.0f, frame_width - 1.0f);
+		row_list[span_no] = rand() % frame_height;
+		left_edge_list[span_no].sx = left_sx;
+		right_edge_list[span_no].sx = MIN(left_sx + width, frame_width);
+		left_edge_list[span_no].one_on_tz = 1.0f;
+		right_edge_list[span_no].one_on_tz = 1.0f;
+		left_edge_list[span_no].u_on_tz = 0.0f;
+		right_edge_list[span_no].u_on_tz = width;
+		left_edge_list[span_no].v_on_tz = 0.0f;
+		right_edge_list[span_no].v_on_tz = 0.0f;
+		transparent_list[span_no] = span_no % 4 == 3;
+		popup_list[span_no] = false;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Read the spans of a real frame from a span stream file, as written by
+// start_span_stream(), returning FALSE if it can't be read.
+//------------------------------------------------------------------------------
+
+static bool
+load_span_stream(const char *file_path)
+{
+	FILE *fp;
+	int transparent, popup;
+	edge *left_edge_ptr, *right_edge_ptr;
+
+	if ((fp = fopen(file_path, "r")) == NULL) {
+		printf("Unable to open span stream file %s\n", file_path);
+		return(false);
+	}
+	if (fscanf(fp, "%d %d", &frame_width, &frame_height) != 2 ||
+		frame_width <= 0 || frame_width > MAX_FRAME_WIDTH ||
+		frame_height <= 0 || frame_height > MAX_FRAME_HEIGHT) {
+		printf("Span stream file %s has an invalid frame size\n", file_path);
+		fclose(fp);
+		return(false);
+	}
+	spans = 0;
+	while (spans < MAX_SPANS) {
+		left_edge_ptr = &left_edge_list[spans];
+		right_edge_ptr = &right_edge_list[spans];
+		if (fscanf(fp, "%d %f %f %f %f %f %f %f %f %d %d", &row_list[spans],
+			&left_edge_ptr->sx, &left_edge_ptr->one_on_tz,
+			&left_edge_ptr->u_on_tz, &left_edge_ptr->v_on_tz,
+			&right_edge_ptr->sx, &right_edge_ptr->one_on_tz,
+			&right_edge_ptr->u_on_tz, &right_edge_ptr->v_on_tz, &transparent,
+			&popup) != 11)
+			break;
+		if (row_list[spans] < 0 || row_list[spans] >= frame_height) {
+			printf("Span stream file %s has a span outside the frame\n",
+				file_path);
+			fclose(fp);
+			return(false);
+		}
+		transparent_list[spans] = transparent != 0;
+		popup_list[spans] = popup != 0;
+		spans++;
+	}
+	if (!feof(fp)) {
+		printf("Span stream file %s has an invalid or excess span\n", file_path);
+		fclose(fp);
+		return(false);
+	}
+	fclose(fp);
+	return(spans > 0);
+}
+
+//------------------------------------------------------------------------------
+// Create the span buffer for the current frame size.
+//------------------------------------------------------------------------------
+
+static bool
+create_span_buffer(void)
+{
+	frame_buffer_width = (float)frame_width;
+	frame_buffer_height = (float)frame_height;
+	NEW(span_buffer_ptr, span_buffer);
+	return(span_buffer_ptr != NULL && span_buffer_ptr->create_buffer(frame_height));
+}
+
+//------------------------------------------------------------------------------
+// Add the spans of a frame to the cleared span buffer.
+//------------------------------------------------------------------------------
+
+static void
+add_spans(void)
+{
+	reset_frame_arena();
+	span_buffer_ptr->clear_buffer();
+	for (int span_no = 0; span_no < spans; span_no++)
+		add_span(row_list[span_no], &left_edge_list[span_no],
+			&right_edge_list[span_no], transparent_list[span_no] ?
+			&transparent_pixmap : NULL, 0, 0, popup_list[span_no]);
+}
+
+//------------------------------------------------------------------------------
+// Check the span buffer against the coverage map.
+//------------------------------------------------------------------------------
+
+static void
+check_span_buffer(void)
+{
+	// Build the coverage map from the opaque spans that were added, whose
+	// edges may be either way around.
+
+	memset(coverage_map, 0, sizeof(coverage_map));
+	for (int span_no = 0; span_no < spans; span_no++) {
+		if (transparent_list[span_no])
+			continue;
+		float left_sx = MIN(left_edge_list[span_no].sx, right_edge_list[span_no].sx);
+		float right_sx = MAX(left_edge_list[span_no].sx, right_edge_list[span_no].sx);
+		int start_sx = (int)FCEIL(left_sx);
+		int end_sx = (int)FCEIL(right_sx);
+		for (int sx = MAX(start_sx, 0); sx < MIN(end_sx, frame_width); sx++)
+			coverage_map[row_list[span_no]][sx] = true;
+	}
+
+	// Check each row.
+
+	for (int row = 0; row < frame_height; row++) {
+		span_row *span_row_ptr = (*span_buffer_ptr)[row];
+		int covered_pixels = 0;
+		int end_sx = 0;
+		for (span *span_ptr = span_row_ptr->opaque_span_list; span_ptr != NULL;
+			span_ptr = span_ptr->next_span_ptr) {
+			CHECK(span_ptr->start_sx >= end_sx);
+			CHECK(span_ptr->start_sx < span_ptr->end_sx);
+			for (int sx = span_ptr->start_sx; sx < span_ptr->end_sx; sx++)
+				CHECK(coverage_map[row][sx]);
+			covered_pixels += span_ptr->end_sx - span_ptr->start_sx;
+			end_sx = span_ptr->end_sx;
+		}
+		int expected_pixels = 0;
+		for (int sx = 0; sx < frame_width; sx++)
+			if (coverage_map[row][sx])
+				expected_pixels++;
+		CHECK(covered_pixels == expected_pixels);
+		CHECK(span_row_ptr->covered_pixels == expected_pixels);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Run the benchmark.
+//------------------------------------------------------------------------------
+
+int
+main(int argc, char *argv[])
+{
+	clock_t start_time;
+	double total_time;
+
+	if (argc > 2) {
+		printf("Usage: %s [span-stream-file]\n", argv[0]);
+		return(2);
+	}
+	srand(1);
+	transparent_pixmap.transparent_index = 0;
+	init_frame_arena();
+	frame_width = MAX_FRAME_WIDTH;
+	frame_height = MAX_FRAME_HEIGHT;
+	if (!create_span_buffer()) {
+		printf("Unable to create the span buffer\n");
+		return(1);
+	}
+
+	// Time the random frames, each with a new set of spans, then check the
+	// span buffer from the last one.
+
+	total_time = 0.0;
+	for (int frame_no = 0; frame_no < RANDOM_FRAMES; frame_no++) {
+		set_up_random_spans();
+		start_time = clock();
+		add_spans();
+		total_time += (double)(clock() - start_time) * 1000.0 / CLOCKS_PER_SEC;
+	}
+	printf("Added %d random spans to a %dx%d span buffer %d times\n", spans,
+		frame_width, frame_height, RANDOM_FRAMES);
+	printf("add_span: %.1f ms per frame\n", total_time / RANDOM_FRAMES);
+	check_span_buffer();
+	DEL(span_buffer_ptr, span_buffer);
+
+	// Time the replay of the real frame, if one was given, then check the span
+	// buffer.
+
+	if (argc == 2) {
+		bool loaded = load_span_stream(argv[1]);
+		CHECK(loaded);
+		if (loaded) {
+			if (!create_span_buffer()) {
+				printf("Unable to create the span buffer\n");
+				return(1);
+			}
+			start_time = clock();
+			for (int replay = 0; replay < STREAM_REPLAYS; replay++)
+				add_spans();
+			total_time = (double)(clock() - start_time) * 1000.0 / CLOCKS_PER_SEC;
+			printf("Added %d recorded spans to a %dx%d span buffer %d times\n",
+				spans, frame_width, frame_height, STREAM_REPLAYS);
+			printf("add_span: %.3f ms per frame\n", total_time / STREAM_REPLAYS);
+			check_span_buffer();
+			DEL(span_buffer_ptr, span_buffer);
+		}
+	}
+	delete_frame_arena();
+	return(test_result("Span benchmark"));
+}
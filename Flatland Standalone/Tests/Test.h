@@ -0,0 +1,44 @@
+//******************************************************************************
+// Copyright (C) 2018 Flatland Online Inc., Philip Stephens, Michael Powers.
+// This code is licensed under the MIT license (see LICENCE file for details).
+//******************************************************************************
+
+// Checks shared by the test programs.  A failed check is reported with its
+// file and line, and the program's exit status is the number of checks that
+// failed, so CTest treats any failure as a failed test.
+
+#include <math.h>
+#include <stdio.h>
+
+static int failed_checks;
+
+#define CHECK(condition) \
+{ \
+	if (!(condition)) { \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		failed_checks++; \
+	} \
+}
+
+#define CHECK_NEAR(value, expected, tolerance) \
+{ \
+	float check_value = (float)(value); \
+	float check_expected = (float)(expected); \
+	if (!(fabs(check_value - check_expected) <= (tolerance))) { \
+		printf("%s:%d: check failed: %s is %g, expected %g\n", __FILE__, \
+			__LINE__, #value, check_value, check_expected); \
+		failed_checks++; \
+	} \
+}
+
+// Report the result of the tests and return the exit status.
+
+static int
+test_result(const char *test_name)
+{
+	if (failed_checks > 0)
+		printf("%s: %d checks failed\n", test_name, failed_checks);
+	else
+		printf("%s: all checks passed\n", test_name);
+	return(failed_checks);
+}
@@ -10,7 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "..\zlib\zlib.h"
+#include "../zlib/zlib.h"
 #include "ioapi.h"
 
 
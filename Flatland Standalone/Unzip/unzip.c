@@ -38,7 +38,7 @@ woven in by Terry Thorsen 1/2003.
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "..\zlib\zlib.h"
+#include "../zlib/zlib.h"
 #include "unzip.h"
 
 #ifdef STDC
@@ -14,7 +14,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
-#include "..\zlib\zlib.h"
+#include "../zlib/zlib.h"
 #include "zip.h"
 
 #ifdef STDC
@@ -16,6 +16,7 @@
 #include "Parser.h"
 #include "Platform.h"
 #include "Plugin.h"
+#include "Portable.h"
 #include "SimKin.h"
 #include "Utils.h"
 
@@ -33,6 +34,21 @@ static int adj_block_level[6] = { 0, 0, 1, 0, 0, -1 };
 
 bool curr_URL_opened;
 
+// Number of squares along each side of a movable block grid cell.
+
+#define MOVABLE_CELL_SQUARES	4
+
+// The movable block grid, which divides the map into cells and holds a list of
+// the movable blocks whose translation lies in each cell, and the list of
+// movable blocks outside of the map.  The collision box of every movable block
+// lies within the movable block extent of it's translation.
+
+static block **movable_block_grid;
+static int movable_grid_columns, movable_grid_rows, movable_grid_levels;
+static float movable_cell_size;
+static block *outside_movable_block_list;
+static float movable_block_extent;
+
 //------------------------------------------------------------------------------
 // Return a pointer to the block with the given single character symbol.
 //------------------------------------------------------------------------------
@@ -190,7 +206,7 @@ load_texture(blockset *blockset_ptr, char *texture_URL, bool add_to_blockset, bo
 			blockset_ptr = blockset_list_ptr->find_blockset_by_name(blockset_name);
 		}
 		if (blockset_ptr == NULL) {
-			warning("There is no blockset with name \"%s\"", blockset_name);
+			warning("There is no blockset with name \"%s\"", (char *)blockset_name);
 			return(NULL);
 		}
 
@@ -512,7 +528,7 @@ load_wave(blockset *blockset_ptr, char *wave_URL)
 				blockset_ptr = blockset_ptr->next_blockset_ptr;
 			}
 			if (blockset_ptr == NULL) {
-				warning("There is no blockset with name \"%s\"", blockset_name);
+				warning("There is no blockset with name \"%s\"", (char *)blockset_name);
 				return(NULL);
 			}
 		}
@@ -834,6 +850,7 @@ init_sprite_collision_box(block *block_ptr)
 	float max_x, max_y;
 	float z, min_z, max_z;
 	float x_radius;
+	int column, row, level;
 
 	// Initialise the minimum and maximum coordinates to the first vertex.
  
@@ -872,6 +889,14 @@ init_sprite_collision_box(block *block_ptr)
 	
 	COL_convertSpriteToColMesh(block_ptr->col_mesh_ptr, min_x, min_y, min_z,
 		max_x, max_y, max_z);
+
+	// If this is a fixed sprite, the bounding box of the chunk it's in must be
+	// recomputed.
+
+	if (block_ptr->square_ptr != NULL && !block_ptr->block_def_ptr->movable) {
+		world_ptr->get_square_location(block_ptr->square_ptr, &column, &row, &level);
+		world_ptr->invalidate_chunk(column, row, level);
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -1059,6 +1084,7 @@ void
 reset_active_lights(int min_column, int min_row, int min_level, 
 					int max_column, int max_row, int max_level)
 {
+	square *square_ptr;
 	block *block_ptr;
 
 	// Clamp the minimum and maximum coordinates of the bounding box to the
@@ -1078,12 +1104,17 @@ reset_active_lights(int min_column, int min_row, int min_level,
 		max_level = world_ptr->levels;
 
 	// Now step through all blocks in the bounding box, setting the flags to
-	// calculate the active lights.
+	// calculate the active lights.  If a square's chunk doesn't exist, the
+	// rest of the chunk's row is skipped.
 
 	for (int level = min_level; level <= max_level; level++)
 		for (int row = min_row; row <= max_row; row++)
 			for (int column = min_column; column < max_column; column++) {
-				block_ptr = world_ptr->get_block_ptr(column, row, level);
+				if ((square_ptr = world_ptr->find_square_ptr(column, row, level)) == NULL) {
+					column |= CHUNK_COLUMNS - 1;
+					continue;
+				}
+				block_ptr = square_ptr->block_ptr;
 				if (block_ptr != NULL)
 					block_ptr->set_active_lights = true;
 			}
@@ -1093,7 +1124,7 @@ reset_active_lights(int min_column, int min_row, int min_level,
 // Create a new block, which is a translated version of a block definition.
 //------------------------------------------------------------------------------
 
-static block *
+block *
 create_new_block(block_def *block_def_ptr, square *square_ptr, 
 				 vertex translation)		 
 {
@@ -1128,11 +1159,14 @@ create_new_block(block_def *block_def_ptr, square *square_ptr,
 	}
 
 	// If the block is a structural block, transform it into it's final
-	// orientation and translation.
+	// orientation and translation, unless it is sharing the geometry of the
+	// block definition, which is already in that orientation.
 
 	if (block_def_ptr->type == STRUCTURAL_BLOCK) {
-		block_ptr->reset_vertices();
-		block_ptr->orient();
+		if (!block_ptr->shared_geometry) {
+			block_ptr->reset_vertices();
+			block_ptr->orient();
+		}
 	}
 
 	// If the block is a sprite, initialise it directly.
@@ -1503,7 +1537,7 @@ compute_active_polygons(block *block_ptr, int column, int row, int level,
 	for (polygon_no = 0; polygon_no < block_ptr->polygons; polygon_no++) {
 		polygon_ptr = &block_ptr->polygon_list[polygon_no];
 		polygon_def_ptr = polygon_ptr->polygon_def_ptr;
-		polygon_active_ptr = &polygon_ptr->active;
+		polygon_active_ptr = &block_ptr->polygon_active_list[polygon_no];
 		part_ptr = polygon_def_ptr->part_ptr;
 		switch (part_ptr->faces) {
 		case 0:
@@ -1538,7 +1572,8 @@ compute_active_polygons(block *block_ptr, int column, int row, int level,
 			adj_polygon_no++) {
 			adj_polygon_ptr = &adj_block_ptr->polygon_list[adj_polygon_no];
 			adj_polygon_def_ptr = adj_polygon_ptr->polygon_def_ptr;
-			adj_polygon_active_ptr = &adj_polygon_ptr->active;
+			adj_polygon_active_ptr = 
+				&adj_block_ptr->polygon_active_list[adj_polygon_no];
 			adj_part_ptr = adj_polygon_def_ptr->part_ptr;
 			if (adj_part_ptr->faces != 1 || !adj_polygon_ptr->side || 
 				adj_polygon_ptr->direction != adj_direction)
@@ -1599,7 +1634,8 @@ reset_active_polygons(int column, int row, int level)
 			adj_polygon_no++) {
 			adj_polygon_ptr = &adj_block_ptr->polygon_list[adj_polygon_no];
 			adj_polygon_def_ptr = adj_polygon_ptr->polygon_def_ptr;
-			adj_polygon_active_ptr = &adj_polygon_ptr->active;
+			adj_polygon_active_ptr = 
+				&adj_block_ptr->polygon_active_list[adj_polygon_no];
 			adj_part_ptr = adj_polygon_def_ptr->part_ptr;
 			if (adj_polygon_ptr->side && adj_part_ptr->faces == 1 &&
 				adj_polygon_ptr->direction == adj_direction)
@@ -1719,6 +1755,7 @@ add_fixed_block(block_def *block_def_ptr, square *square_ptr, bool update_active
 	block_ptr = create_new_block(block_def_ptr, square_ptr, translation);
 	square_ptr->block_ptr = block_ptr;
 	square_ptr->curr_block_symbol = world_ptr->map_style == SINGLE_MAP ? block_def_ptr->single_symbol : block_def_ptr->double_symbol;
+	world_ptr->invalidate_chunk(column, row, level);
 
 	// If this block has a light, sound, popup or trigger list, or an entrance,
 	// add it to the fixed block list.
@@ -1730,6 +1767,11 @@ add_fixed_block(block_def *block_def_ptr, square *square_ptr, bool update_active
 		fixed_block_list = block_ptr;
 	}
 
+	// If this block has a light list, add the lights to the light grid.
+
+	if (block_ptr->light_list != NULL)
+		add_lights_to_grid(block_ptr->light_list, block_ptr);
+
 	// If the active polygons of the new block and adjacent blocks must be
 	// updated, do so.
 
@@ -1760,6 +1802,253 @@ add_fixed_block(block_def *block_def_ptr, square *square_ptr, bool update_active
 	return(block_ptr);
 }
 
+//------------------------------------------------------------------------------
+// Return the index of the movable block grid cell holding the given position,
+// or -1 if it's outside of the map or there is no grid.
+//------------------------------------------------------------------------------
+
+static int
+get_movable_cell(vertex *position_ptr)
+{
+	int column, row, level;
+
+	if (movable_block_grid == NULL)
+		return(-1);
+	column = (int)floor(position_ptr->x / movable_cell_size);
+	level = (int)floor(position_ptr->y / movable_cell_size);
+	row = (int)floor(position_ptr->z / movable_cell_size);
+	if (column < 0 || column >= movable_grid_columns || row < 0 || 
+		row >= movable_grid_rows || level < 0 || level >= movable_grid_levels)
+		return(-1);
+	return((level * movable_grid_rows + row) * movable_grid_columns + column);
+}
+
+//------------------------------------------------------------------------------
+// Return a pointer to the list of movable blocks in the given grid cell.
+//------------------------------------------------------------------------------
+
+static block **
+get_movable_cell_list(int cell)
+{
+	if (cell < 0)
+		return(&outside_movable_block_list);
+	return(&movable_block_grid[cell]);
+}
+
+//------------------------------------------------------------------------------
+// Enlarge the movable block extent, if necessary, to cover the collision box
+// of the given block.
+//------------------------------------------------------------------------------
+
+static void
+update_movable_block_extent(block *block_ptr)
+{
+	COL_MESH *col_mesh_ptr;
+
+	if ((col_mesh_ptr = block_ptr->col_mesh_ptr) == NULL)
+		return;
+	movable_block_extent = MAX(movable_block_extent, 
+		MAX(FABS(col_mesh_ptr->minBox.x), FABS(col_mesh_ptr->maxBox.x)));
+	movable_block_extent = MAX(movable_block_extent, 
+		MAX(FABS(col_mesh_ptr->minBox.y), FABS(col_mesh_ptr->maxBox.y)));
+	movable_block_extent = MAX(movable_block_extent, 
+		MAX(FABS(col_mesh_ptr->minBox.z), FABS(col_mesh_ptr->maxBox.z)));
+}
+
+//------------------------------------------------------------------------------
+// Add a movable block to the movable block grid cell holding it's translation.
+//------------------------------------------------------------------------------
+
+static void
+add_block_to_movable_grid(block *block_ptr)
+{
+	block **cell_list_ptr;
+
+	update_movable_block_extent(block_ptr);
+	block_ptr->movable_cell = get_movable_cell(&block_ptr->translation);
+	cell_list_ptr = get_movable_cell_list(block_ptr->movable_cell);
+	block_ptr->next_cell_block_ptr = *cell_list_ptr;
+	*cell_list_ptr = block_ptr;
+	block_ptr->in_movable_grid = true;
+}
+
+//------------------------------------------------------------------------------
+// Remove a movable block from the movable block grid.
+//------------------------------------------------------------------------------
+
+static void
+remove_block_from_movable_grid(block *block_ptr)
+{
+	block **block_ptr_ptr;
+
+	if (!block_ptr->in_movable_grid)
+		return;
+	block_ptr_ptr = get_movable_cell_list(block_ptr->movable_cell);
+	while (*block_ptr_ptr != NULL) {
+		if (*block_ptr_ptr == block_ptr) {
+			*block_ptr_ptr = block_ptr->next_cell_block_ptr;
+			break;
+		}
+		block_ptr_ptr = &(*block_ptr_ptr)->next_cell_block_ptr;
+	}
+	block_ptr->next_cell_block_ptr = NULL;
+	block_ptr->in_movable_grid = false;
+}
+
+//------------------------------------------------------------------------------
+// Create the movable block grid to cover the map.  Movable blocks are added to
+// it as they are placed on the map.
+//------------------------------------------------------------------------------
+
+void
+create_movable_block_grid(void)
+{
+	int cells;
+
+	destroy_movable_block_grid();
+	movable_cell_size = units_per_block * MOVABLE_CELL_SQUARES;
+	movable_grid_columns = (world_ptr->columns + MOVABLE_CELL_SQUARES - 1) / 
+		MOVABLE_CELL_SQUARES;
+	movable_grid_rows = (world_ptr->rows + MOVABLE_CELL_SQUARES - 1) / 
+		MOVABLE_CELL_SQUARES;
+	movable_grid_levels = (world_ptr->levels + MOVABLE_CELL_SQUARES - 1) / 
+		MOVABLE_CELL_SQUARES;
+	cells = movable_grid_columns * movable_grid_rows * movable_grid_levels;
+	NEWARRAY(movable_block_grid, block *, cells);
+	if (movable_block_grid == NULL)
+		memory_error("movable block grid");
+	memset(movable_block_grid, 0, cells * sizeof(block *));
+}
+
+//------------------------------------------------------------------------------
+// Destroy the movable block grid.  The blocks themselves are not deleted.
+//------------------------------------------------------------------------------
+
+void
+destroy_movable_block_grid(void)
+{
+	if (movable_block_grid != NULL) {
+		DELARRAY(movable_block_grid, block *, movable_grid_columns * 
+			movable_grid_rows * movable_grid_levels);
+		movable_block_grid = NULL;
+	}
+	outside_movable_block_list = NULL;
+	movable_block_extent = 0.0f;
+}
+
+//------------------------------------------------------------------------------
+// Update a movable block's place in the movable block grid after it's
+// translation or collision box has changed.
+//------------------------------------------------------------------------------
+
+void
+update_movable_block_in_grid(block *block_ptr)
+{
+	if (!block_ptr->in_movable_grid)
+		return;
+	update_movable_block_extent(block_ptr);
+	if (get_movable_cell(&block_ptr->translation) != block_ptr->movable_cell) {
+		remove_block_from_movable_grid(block_ptr);
+		add_block_to_movable_grid(block_ptr);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Add the solid movable blocks in the given list whose collision box overlaps
+// the given bounding box to a block list, and return the new number of blocks
+// found.  Blocks found once the list is full are counted but not added.
+//------------------------------------------------------------------------------
+
+static int
+find_movable_blocks_in_list(block *cell_block_list, vertex *min_box_ptr,
+							vertex *max_box_ptr, block **block_list, 
+							int blocks, int max_blocks)
+{
+	block *block_ptr;
+	COL_MESH *col_mesh_ptr;
+	vertex min_bbox, max_bbox;
+
+	block_ptr = cell_block_list;
+	while (block_ptr != NULL) {
+		if (block_ptr->solid && block_ptr->col_mesh_ptr != NULL) {
+			col_mesh_ptr = block_ptr->col_mesh_ptr;
+			min_bbox.x = col_mesh_ptr->minBox.x + block_ptr->translation.x;
+			min_bbox.y = col_mesh_ptr->minBox.y + block_ptr->translation.y;
+			min_bbox.z = col_mesh_ptr->minBox.z + block_ptr->translation.z;
+			max_bbox.x = col_mesh_ptr->maxBox.x + block_ptr->translation.x;
+			max_bbox.y = col_mesh_ptr->maxBox.y + block_ptr->translation.y;
+			max_bbox.z = col_mesh_ptr->maxBox.z + block_ptr->translation.z;
+			if (!(min_bbox.x > max_box_ptr->x || max_bbox.x < min_box_ptr->x ||
+				  min_bbox.y > max_box_ptr->y || max_bbox.y < min_box_ptr->y ||
+				  min_bbox.z > max_box_ptr->z || max_bbox.z < min_box_ptr->z)) {
+				if (blocks < max_blocks)
+					block_list[blocks] = block_ptr;
+				blocks++;
+			}
+		}
+		block_ptr = block_ptr->next_cell_block_ptr;
+	}
+	return(blocks);
+}
+
+//------------------------------------------------------------------------------
+// Find the solid movable blocks whose collision box overlaps the given
+// bounding box, and return how many there are.  Only the first max_blocks are
+// put in the block list, so if more are returned the caller must make the list
+// bigger and search again.  Only the movable block grid cells that could hold
+// such a block are searched, along with the movable blocks outside of the map.
+//------------------------------------------------------------------------------
+
+int
+find_movable_blocks_in_box(vertex *min_box_ptr, vertex *max_box_ptr, 
+						   block **block_list, int max_blocks)
+{
+	int min_column, min_row, min_level;
+	int max_column, max_row, max_level;
+	int column, row, level;
+	int blocks;
+
+	// Search the movable blocks outside of the map first.
+
+	blocks = find_movable_blocks_in_list(outside_movable_block_list, 
+		min_box_ptr, max_box_ptr, block_list, 0, max_blocks);
+	if (movable_block_grid == NULL)
+		return(blocks);
+
+	// Determine the range of cells that could hold the translation of a block
+	// that overlaps the bounding box, clamped to the grid.
+
+	min_column = (int)floor((min_box_ptr->x - movable_block_extent) / 
+		movable_cell_size);
+	min_level = (int)floor((min_box_ptr->y - movable_block_extent) / 
+		movable_cell_size);
+	min_row = (int)floor((min_box_ptr->z - movable_block_extent) / 
+		movable_cell_size);
+	max_column = (int)floor((max_box_ptr->x + movable_block_extent) / 
+		movable_cell_size);
+	max_level = (int)floor((max_box_ptr->y + movable_block_extent) / 
+		movable_cell_size);
+	max_row = (int)floor((max_box_ptr->z + movable_block_extent) / 
+		movable_cell_size);
+	min_column = MAX(min_column, 0);
+	min_row = MAX(min_row, 0);
+	min_level = MAX(min_level, 0);
+	max_column = MIN(max_column, movable_grid_columns - 1);
+	max_row = MIN(max_row, movable_grid_rows - 1);
+	max_level = MIN(max_level, movable_grid_levels - 1);
+
+	// Search the blocks in each cell.
+
+	for (level = min_level; level <= max_level; level++)
+		for (row = min_row; row <= max_row; row++)
+			for (column = min_column; column <= max_column; column++)
+				blocks = find_movable_blocks_in_list(movable_block_grid[
+					(level * movable_grid_rows + row) * movable_grid_columns + 
+					column], min_box_ptr, max_box_ptr, block_list, blocks, 
+					max_blocks);
+	return(blocks);
+}
+
 //------------------------------------------------------------------------------
 // Add a new movable block to the map at the given map position, using the
 // given block definition as the template.
@@ -1780,10 +2069,11 @@ add_movable_block(block_def *block_def_ptr, square *square_ptr, vertex translati
 	square_ptr->movable_block_ptr = block_ptr;
 	square_ptr->curr_block_symbol = world_ptr->map_style == SINGLE_MAP ? block_def_ptr->single_symbol : block_def_ptr->double_symbol;
 
-	// Add the block to the movable block list.
+	// Add the block to the movable block list and the movable block grid.
 
 	block_ptr->next_block_ptr = movable_block_list;
 	movable_block_list = block_ptr;
+	add_block_to_movable_grid(block_ptr);
 
 	// If this block has a start action on it fire it up.
 
@@ -1847,6 +2137,7 @@ remove_block_from_square(square *square_ptr)
 			max_row, max_level);
 		reset_active_lights(min_column, min_row, min_level, max_column, max_row,
 			max_level);
+		remove_lights_from_grid(block_ptr->light_list, block_ptr);
 	}
 
 	// If this block has a sound list, stop all sounds in that list.
@@ -1886,6 +2177,7 @@ remove_block_from_square(square *square_ptr)
 
 	square_ptr->block_ptr = NULL;
 	square_ptr->curr_block_symbol = NULL_BLOCK_SYMBOL;
+	world_ptr->invalidate_chunk(column, row, level);
 }
 
 //------------------------------------------------------------------------------
@@ -1936,6 +2228,7 @@ remove_movable_block(block *block_ptr)
 		movable_block_list = curr_block_ptr->next_block_ptr;
 	else
 		prev_block_ptr->next_block_ptr = curr_block_ptr->next_block_ptr;
+	remove_block_from_movable_grid(block_ptr);
 
 	// Check to see if there are any clock actions to remove.
 
@@ -2410,13 +2703,22 @@ init_spot(void)
 	create_orb();
 	create_ground_block_def();
 
+	// Create the light grid, which will hold the global lights and the lights
+	// in the fixed blocks created below, and the movable block grid.
+
+	create_light_grid();
+	create_movable_block_grid();
+
 	// Step through the map and create a block for each occupied square.
 	// Undefined or invalid map symbols are replaced by the empty block.
 
 	for (level = 0; level < world_ptr->levels; level++)
 		for (row = 0; row < world_ptr->rows; row++)
 			for (column = 0; column < world_ptr->columns; column++) {
-				square_ptr = world_ptr->get_square_ptr(column, row, level);
+				if ((square_ptr = world_ptr->find_square_ptr(column, row, level)) == NULL) {
+					column |= CHUNK_COLUMNS - 1;
+					continue;
+				}
 				block_symbol = square_ptr->curr_block_symbol;
 				if (block_symbol != NULL_BLOCK_SYMBOL) {
 
@@ -2441,7 +2743,7 @@ init_spot(void)
 
 					if (block_def_ptr != NULL) {
 						if (!block_def_ptr->allow_entrance && square_has_entrance(square_ptr))
-							warning("Block \"%s\" cannot be placed on an entrance square", block_def_ptr->name);
+							warning("Block \"%s\" cannot be placed on an entrance square", (char *)block_def_ptr->name);
 						else if (block_def_ptr->movable) {
 							translation.set_map_translation(column, row, level);
 							add_movable_block(block_def_ptr, square_ptr, translation);
@@ -2480,7 +2782,7 @@ init_spot(void)
 		if (ambient_sound_ptr->wave_ptr->blockset_ptr != NULL && 
 			!create_sound_buffer(ambient_sound_ptr))
 			warning("Unable to create sound buffer for wave file %s",
-				ambient_sound_ptr->wave_ptr->URL);
+				(char *)ambient_sound_ptr->wave_ptr->URL);
 	}
 
 	// Step through the custom block definitions, and update all parts that
@@ -2552,7 +2854,7 @@ loading_message(const char *URL)
 
 	// Display the file name on the task bar.
 
-	set_title("Loading %s", file_name);
+	set_title("Loading %s", (char *)file_name);
 }
 
 //------------------------------------------------------------------------------
@@ -2689,7 +2991,7 @@ initiate_first_download(void)
 	// spot title on the task bar.
 
 	if (curr_custom_texture_ptr == NULL && curr_custom_wave_ptr == NULL) {
-		set_title("%s", spot_title);
+		set_title("%s", (char *)spot_title);
 	}
 }
 
@@ -2859,7 +3161,7 @@ update_waves_in_sound_list(sound *sound_list, wave *wave_ptr)
 	while (sound_ptr != NULL) {
 		if (sound_ptr->wave_ptr == wave_ptr && !create_sound_buffer(sound_ptr))
 			warning("Unable to create sound buffer for wave file %s",
-				sound_ptr->wave_ptr->URL);
+				(char *)sound_ptr->wave_ptr->URL);
 		sound_ptr = sound_ptr->next_sound_ptr;
 	}
 }
@@ -2892,7 +3194,7 @@ update_wave_dependancies(wave *wave_ptr)
 	if (ambient_sound_ptr && ambient_sound_ptr->wave_ptr == wave_ptr &&
 		!create_sound_buffer(ambient_sound_ptr))
 		warning("Unable to create sound buffer for wave file %s",
-			ambient_sound_ptr->wave_ptr->URL);
+			(char *)ambient_sound_ptr->wave_ptr->URL);
 
 	// Create the sound buffer for all of the sounds that depend on the given
 	// wave.
@@ -2929,7 +3231,7 @@ handle_current_download(void)
 		// generate a warning.
 
 		if (download_status == 0 || !load_image(curr_URL, curr_file_path, curr_custom_texture_ptr))
-			warning("Unable to download custom texture from %s", curr_URL);
+			warning("Unable to download custom texture from %s", (char *)curr_URL);
 		
 		// Otherwise update all texture dependancies.
 
@@ -2950,7 +3252,7 @@ handle_current_download(void)
 
 		if (download_status == 0 || !load_wave_file(curr_URL, curr_file_path, 
 			curr_custom_wave_ptr))
-			warning("Unable to download custom sound from %s", curr_URL);
+			warning("Unable to download custom sound from %s", (char *)curr_URL);
 
 		// Otherwise update the wave dependancies. 
 
@@ -2966,7 +3268,7 @@ handle_current_download(void)
 	// the task bar.
 
 	if (curr_custom_texture_ptr == NULL && curr_custom_wave_ptr == NULL) {
-		set_title("%s", spot_title);
+		set_title("%s", (char *)spot_title);
 	}
 }
 
@@ -108,6 +108,19 @@ remove_block_from_square(square *square_ptr);
 void
 remove_movable_block(block *block_ptr);
 
+void
+create_movable_block_grid(void);
+
+void
+destroy_movable_block_grid(void);
+
+void
+update_movable_block_in_grid(block *block_ptr);
+
+int
+find_movable_blocks_in_box(vertex *min_box_ptr, vertex *max_box_ptr, 
+						   block **block_list, int max_blocks);
+
 int
 get_brightness_index(float brightness);
 
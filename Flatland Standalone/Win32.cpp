@@ -56,6 +56,7 @@ using namespace DirectX;
 #include "Parser.h"
 #include "Platform.h"
 #include "Plugin.h"
+#include "Raster.h"
 #include "Render.h"
 #include "Spans.h"
 #include "Utils.h"
@@ -676,6 +677,12 @@ static void (*display_callback_ptr)(void);
 
 static HWND new_spot_window_handle;
 
+// Performance counter frequency and the count when the platform API started
+// up, used by the real time clock.
+
+static LARGE_INTEGER performance_frequency;
+static LARGE_INTEGER performance_start_count;
+
 // Light window data.
 
 static HWND light_window_handle;
@@ -771,106 +778,6 @@ static vk_to_keycode key_code_table[KEY_CODES] = {
 	{VK_DECIMAL, NUMPAD_PERIOD_KEY}
 };
 
-// Width of a linearly interpolated texture span.
-
-#define SPAN_WIDTH			32
-#define SPAN_SHIFT			5
-
-// Two constants used to load immediate floating point values into floating
-// point registers.
-
-const float const_1 = 1.0;
-const float fixed_shift = 65536.0;
-
-// Assembly macro for fast float to fixed point conversion for texture (u,v)
-// coordinates.
-
-#define COMPUTE_UV(u,v,u_on_tz,v_on_tz,end_tz) __asm \
-{ \
-	__asm fld	fixed_shift \
-	__asm fmul	end_tz \
-	__asm fld	st(0) \
-	__asm fmul	u_on_tz \
-	__asm fistp	DWORD PTR u \
-	__asm fmul  v_on_tz \
-	__asm fistp DWORD PTR v \
-}
-
-// Assembly macro for drawing a possibly transparent 16-bit pixel.
-
-#define DRAW_TRANSPARENT_PIXEL16(label) __asm \
-{ \
-	__asm mov edi, ebx \
-	__asm and edi, ecx \
-	__asm shr edi, FRAC_BITS \
-	__asm mov eax, edx \
-	__asm and eax, ecx \
-	__asm and eax, INT_MASK \
-	__asm shr eax, cl \
-	__asm or  edi, eax \
-	__asm mov eax, image_ptr \
-	__asm mov ax, [eax + edi * 2] \
-	__asm test ax, transparency_mask16 \
-	__asm jz label \
-	__asm mov [esi], ax \
-} __asm { \
-label: \
-	__asm add ebx, delta_u \
-	__asm add edx, delta_v \
-	__asm add esi, 2 \
-}
-
-// Assembly macro for drawing a possibly transparent 24-bit pixel.
-
-#define DRAW_TRANSPARENT_PIXEL24(label) __asm \
-{ \
-	__asm mov edi, ebx \
-	__asm and edi, ecx \
-	__asm shr edi, FRAC_BITS \
-	__asm mov eax, edx \
-	__asm and eax, ecx \
-	__asm and eax, INT_MASK \
-	__asm shr eax, cl \
-	__asm or  edi, eax \
-	__asm mov eax, image_ptr \
-	__asm mov eax, [eax + edi * 4] \
-	__asm test eax, transparency_mask24 \
-	__asm jz label \
-	__asm mov edi, [esi] \
-	__asm and edi, 0xff000000 \
-	__asm or edi, eax \
-	__asm mov [esi], edi \
-} __asm { \
-label: \
-	__asm add ebx, delta_u \
-	__asm add edx, delta_v \
-	__asm add esi, 3 \
-}
-
-// Assembly macro for drawing a possibly transparent 32-bit pixel.
-
-#define DRAW_TRANSPARENT_PIXEL32(label) __asm \
-{ \
-	__asm mov edi, ebx \
-	__asm and edi, ecx \
-	__asm shr edi, FRAC_BITS \
-	__asm mov eax, edx \
-	__asm and eax, ecx \
-	__asm and eax, INT_MASK \
-	__asm shr eax, cl \
-	__asm or  edi, eax \
-	__asm mov eax, image_ptr \
-	__asm mov eax, [eax + edi * 4] \
-	__asm test eax, transparency_mask32 \
-	__asm jz label \
-	__asm mov [esi], eax \
-} __asm { \
-label: \
-	__asm add ebx, delta_u \
-	__asm add edx, delta_v \
-	__asm add esi, 4 \
-}
-
 //==============================================================================
 // Private functions.
 //==============================================================================
@@ -2393,6 +2300,11 @@ start_up_platform_API(void *instance_handle, int show_command, void (*quit_callb
 	app_instance_handle = (HINSTANCE)instance_handle;
 	quit_callback_ptr = quit_callback;
 
+	// Start the real time clock.
+
+	QueryPerformanceFrequency(&performance_frequency);
+	QueryPerformanceCounter(&performance_start_count);
+
 	// Initialise the common control DLL.
 
 	InitCommonControls();
@@ -3312,9 +3224,9 @@ run_event_loop()
 //------------------------------------------------------------------------------
 
 unsigned long
-start_thread(void (*thread_func)(void *arg_list))
+start_thread(void (*thread_func)(void *arg_list), void *arg_list)
 {
-	return(_beginthread(thread_func, 0, NULL));
+	return(_beginthread(thread_func, 0, arg_list));
 }
 
 //------------------------------------------------------------------------------
@@ -3337,6 +3249,19 @@ decrease_thread_priority(void)
 	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
 }
 
+//------------------------------------------------------------------------------
+// Return the number of logical processors.
+//------------------------------------------------------------------------------
+
+int
+get_processor_count(void)
+{
+	SYSTEM_INFO system_info;
+
+	GetSystemInfo(&system_info);
+	return((int)system_info.dwNumberOfProcessors);
+}
+
 //==============================================================================
 // Main window functions.
 //==============================================================================
@@ -3936,7 +3861,7 @@ app_window_is_minimised(void)
 //------------------------------------------------------------------------------
 
 void
-debug_message(char *format, ...)
+debug_message(const char *format, ...)
 {
 	va_list arg_ptr;
 	char message[BUFSIZ];
@@ -3955,7 +3880,7 @@ debug_message(char *format, ...)
 //------------------------------------------------------------------------------
 
 void
-fatal_error(char *title, char *format, ...)
+fatal_error(const char *title, const char *format, ...)
 {
 	va_list arg_ptr;
 	char message[BUFSIZ];
@@ -3979,7 +3904,7 @@ fatal_error(char *title, char *format, ...)
 //------------------------------------------------------------------------------
 
 void
-information(char *title, char *format, ...)
+information(const char *title, const char *format, ...)
 {
 	va_list arg_ptr;
 	char message[BUFSIZ];
@@ -4003,7 +3928,7 @@ information(char *title, char *format, ...)
 //------------------------------------------------------------------------------
 
 bool
-query(char *title, bool yes_no_format, char *format, ...)
+query(const char *title, bool yes_no_format, const char *format, ...)
 {
 	va_list arg_ptr;
 	char message[BUFSIZ];
@@ -5917,13 +5842,45 @@ clear_builder_frame_buffer(void)
 // Software rendering functions.
 //==============================================================================
 
+//------------------------------------------------------------------------------
+// Return the size in bytes of a lit image with the given dimensions, and
+// optionally the number of mipmap levels in it.
+//------------------------------------------------------------------------------
+
+int
+get_lit_image_size(int image_dimensions, int *lit_image_levels_ptr)
+{
+	int lit_bytes_per_pixel;
+	int lit_image_size;
+	int lit_image_levels;
+
+	// Make room for every mipmap level, down to 1x1.  The size is rounded up
+	// to a whole double word, since texels are gathered a double word at a
+	// time.
+
+	lit_bytes_per_pixel = frame_buffer_depth == 16 ? 2 : 4;
+	lit_image_size = 0;
+	lit_image_levels = 0;
+	while (image_dimensions > 0) {
+		lit_image_size += image_dimensions * image_dimensions *
+			lit_bytes_per_pixel;
+		lit_image_levels++;
+		image_dimensions >>= 1;
+	}
+	if (lit_image_levels_ptr != NULL)
+		*lit_image_levels_ptr = lit_image_levels;
+	return((lit_image_size + 3) & ~3);
+}
+
+//------------------------------------------------------------------------------
+// Create the lit image for a cache entry.
+//------------------------------------------------------------------------------
+
 bool
 create_lit_image(cache_entry *cache_entry_ptr, int image_dimensions)
 {
-	if (frame_buffer_depth == 16)
-		cache_entry_ptr->lit_image_size = image_dimensions * image_dimensions * 2;
-	else
-		cache_entry_ptr->lit_image_size = image_dimensions * image_dimensions * 4;
+	cache_entry_ptr->lit_image_size = get_lit_image_size(image_dimensions,
+		&cache_entry_ptr->lit_image_levels);
 	NEWARRAY(cache_entry_ptr->lit_image_ptr, cachebyte, cache_entry_ptr->lit_image_size);
 	return cache_entry_ptr->lit_image_ptr != NULL;
 }
@@ -5936,1846 +5893,173 @@ void
 set_lit_image(cache_entry *cache_entry_ptr, int image_dimensions)
 {
 	pixmap *pixmap_ptr;
-	byte *image_ptr, *end_image_ptr, *new_image_ptr;
 	pixel *palette_ptr;
 	int transparent_index;
-	word transparency_mask16;
-	pixel transparency_mask32;
-	int image_width, image_height;
-	int lit_image_dimensions;
-	int column_index;
+	int lit_bytes_per_pixel;
+	pixel red_comp_mask, green_comp_mask, blue_comp_mask;
 
-	// Get the unlit image pointer and it's dimensions, and set a pointer to
-	// the end of the image data.
+	// Get the transparent index and a pointer to the palette for the desired
+	// brightness index.  16-bit pixmaps are lit through the light table.
 
 	pixmap_ptr = cache_entry_ptr->pixmap_ptr;
-	image_ptr = pixmap_ptr->image_ptr;
-	image_width = pixmap_ptr->width * pixmap_ptr->bytes_per_pixel;
-	image_height = pixmap_ptr->height;
-	end_image_ptr = image_ptr + image_width * image_height;
-
-	// Put the transparent index in a static variable so that the assembly code
-	// can get to it, and get a pointer to the palette for the desired brightness
-	// index.
-
 	if (pixmap_ptr->bytes_per_pixel == 1) {
 		transparent_index = pixmap_ptr->transparent_index;
 		palette_ptr = pixmap_ptr->display_palette_list +
 			cache_entry_ptr->brightness_index * pixmap_ptr->colours;
-	} else
+	} else {
+		transparent_index = -1;
 		palette_ptr = light_table[cache_entry_ptr->brightness_index];
+	}
 
-	// Get the start address of the lit image and it's dimensions.
-
-	new_image_ptr = cache_entry_ptr->lit_image_ptr;
-	lit_image_dimensions = image_dimensions;
-
-	// If the pixmap is a 16-bit image...
-
-	if (pixmap_ptr->bytes_per_pixel == 2) {
-		switch (frame_buffer_depth) {
-
-		// If the frame buffer depth is 16, convert the unlit image to a 16-bit lit image.
-
-		case 16:
-
-			// Get the transparency mask.
-
-			transparency_mask16 = (word)frame_buffer_pixel_format_ptr->alpha_comp_mask;
-		
-			// Perform the conversion.
-
-			__asm {
-
-				// EBX: holds pointer to current row of old image.
-				// EDX: holds pointer to current pixel of new image.
-				// EDI: holds the number of rows left to copy.
-
-				mov ebx, image_ptr
-				mov edx, new_image_ptr
-				mov edi, lit_image_dimensions
-
-			next_row1:
-
-				// ESI: holds number of columns left to copy.
-
-				mov esi, lit_image_dimensions
-
-				// Clear old image offset.
-
-				mov eax, 0
-				mov column_index, eax
-
-			next_column1:
-
-				// Get the unlit 16-bit pixel from the old image, use it to 
-				// obtain the lit 16-bit pixel, and store it in the new image.
-				// The transparency mask must be transfered from the unlit to
-				// lit pixel.
-
-				mov eax, 0
-				mov ecx, column_index
-				mov ax, [ebx + ecx]
-				mov ecx, palette_ptr
-				test ax, 0x8000
-				jnz opaque_pixel1
-				mov ax, [ecx + eax * 4]
-				jmp store_pixel1
-			opaque_pixel1:
-				and ax, 0x7fff
-				mov ax, [ecx + eax * 4]
-				or ax, transparency_mask16
-			store_pixel1:
-				mov [edx], ax
-
-				// Increment the old image offset, wrapping back to zero if the 
-				// end of the row is reached.
-
-				mov eax, column_index
-				add eax, 2
-				cmp eax, image_width 
-				jl next_pixel1
-				mov eax, 0
-			next_pixel1:
-				mov column_index, eax
-
-				// Increment the new image pointer.
-
-				add edx, 2
-
-				// Decrement the column counter, and copy next pixel in row if
-				// there are any left.
-
-				dec esi
-				jnz next_column1
-
-				// Increment the old image row pointer, and wrap back to the
-				// first row if the end of the image has been reached.
-
-				add ebx, image_width
-				cmp ebx, end_image_ptr
-				jl skip_wrap1
-				mov ebx, image_ptr
-
-			skip_wrap1:
-
-				// Decrement the row counter, and copy next row if there are any
-				// left.
-
-				dec edi
-				jnz next_row1
-			}
-			break;
-
-		// If the frame buffer depth is 24 or 32, convert the unlit image to a 32-bit lit image.
-
-		case 24:
-		case 32:
-
-			// Get the transparency mask.
-
-			transparency_mask32 = frame_buffer_pixel_format_ptr->alpha_comp_mask;
-
-			// Perform the conversion.
-
-			__asm {
-			
-				// EBX: holds pointer to current row of old image.
-				// EDX: holds pointer to current pixel of new image.
-				// EDI: holds the number of rows left to copy.
-
-				mov ebx, image_ptr
-				mov edx, new_image_ptr
-				mov edi, lit_image_dimensions
-
-			next_row2:
-
-				// ESI: holds number of columns left to copy.
-
-				mov esi, lit_image_dimensions
-
-				// Clear old image offset.
-
-				mov eax, 0
-				mov column_index, eax
-
-			next_column2:
-
-				// Get the unlit 16-bit index from the old image, use it to
-				// obtain the 32-bit pixel, and store it in the new image.
-				// The transparency mask must be transfered from the unlit to
-				// lit pixel.
-
-				mov eax, 0
-				mov ecx, column_index
-				mov ax, [ebx + ecx]
-				mov ecx, palette_ptr
-				test ax, 0x8000
-				jnz opaque_pixel2
-				mov eax, [ecx + eax * 4]	
-				jmp store_pixel2
-			opaque_pixel2:
-				and ax, 0x7fff
-				mov eax, [ecx + eax * 4]
-				or eax, transparency_mask32
-			store_pixel2:
-				mov [edx], eax
-
-				// Increment the old image offset, wrapping back to zero if the 
-				// end of the row is reached.
-
-				mov eax, column_index
-				add eax, 2
-				cmp eax, image_width 
-				jl next_pixel2
-				mov eax, 0
-			next_pixel2:
-				mov column_index, eax
-
-				// Increment the new image pointer.
-
-				add edx, 4
-
-				// Decrement the column counter, and copy next pixel in row if
-				// there are any left.
-
-				dec esi
-				jnz next_column2
-
-				// Increment the old image row pointer, and wrap back to the
-				// first row if the end of the image has been reached.
-
-				add ebx, image_width
-				cmp ebx, end_image_ptr
-				jl skip_wrap2
-				mov ebx, image_ptr
-
-			skip_wrap2:
-
-				// Decrement the row counter, and copy next row if there are any
-				// left.
-
-				dec edi
-				jnz next_row2
-			}
-		}
-	} 
-	
-	// If the pixmap is an 8-bit image...
-
-	else {
-		switch (frame_buffer_depth) {
-
-		// If the frame buffer depth is 16, convert the unlit image to a 16-bit lit image...
-
-		case 16:
-
-			// Get the transparency mask.
-
-			transparency_mask16 = (word)frame_buffer_pixel_format_ptr->alpha_comp_mask;
-
-			// Perform the conversion.
-
-			__asm {
-			
-				// EBX: holds pointer to current row of old image.
-				// EDX: holds pointer to current pixel of new image.
-				// EDI: holds the number of rows left to copy.
-
-				mov ebx, image_ptr
-				mov edx, new_image_ptr
-				mov edi, lit_image_dimensions
-
-			next_row3:
-
-				// ESI: holds number of columns left to copy.
-
-				mov esi, lit_image_dimensions
-
-				// Clear old image offset.
-
-				mov eax, 0
-				mov column_index, eax
-
-			next_column3:
-
-				// Get the current 8-bit index from the old image, use it to
-				// obtain the 16-bit pixel, and store it in the new image.  If 
-				// the 8-bit index is not the transparent index, mark the pixel as
-				// opaque by setting the transparency mask.
-
-				mov eax, 0
-				mov ecx, column_index
-				mov al, [ebx + ecx]
-				mov ecx, palette_ptr
-				cmp eax, transparent_index
-				jne opaque_pixel3
-				mov ax, [ecx + eax * 4]	
-				jmp store_pixel3
-			opaque_pixel3:
-				mov ax, [ecx + eax * 4]
-				or ax, transparency_mask16
-			store_pixel3:
-				mov [edx], ax
-
-				// Increment the old image offset, wrapping back to zero if the 
-				// end of the row is reached.
-
-				mov eax, column_index
-				inc eax
-				cmp eax, image_width 
-				jl next_pixel3
-				mov eax, 0
-			next_pixel3:
-				mov column_index, eax
-
-				// Increment the new image pointer.
-
-				add edx, 2
-
-				// Decrement the column counter, and copy next pixel in row if
-				// there are any left.
-
-				dec esi
-				jnz next_column3
-
-				// Increment the old image row pointer, and wrap back to the
-				// first row if the end of the image has been reached.
-
-				add ebx, image_width
-				cmp ebx, end_image_ptr
-				jl skip_wrap3
-				mov ebx, image_ptr
-
-			skip_wrap3:
-
-				// Decrement the row counter, and copy next row if there are any
-				// left.
-
-				dec edi
-				jnz next_row3
-			}
-			break;
-
-		// If the display depth is 24 or 32, convert the unlit image to a 32-bit
-		// lit image...
-
-		case 24:
-		case 32:
-
-			// Get the transparency mask.
-
-			transparency_mask32 = frame_buffer_pixel_format_ptr->alpha_comp_mask;
-
-			// Perform the conversion.
-
-			__asm {
-			
-				// EBX: holds pointer to current row of old image.
-				// EDX: holds pointer to current pixel of new image.
-				// EDI: holds the number of rows left to copy.
-
-				mov ebx, image_ptr
-				mov edx, new_image_ptr
-				mov edi, lit_image_dimensions
-
-			next_row4:
-
-				// ESI: holds number of columns left to copy.
-
-				mov esi, lit_image_dimensions
-
-				// Clear old image offset.
-
-				mov eax, 0
-				mov column_index, eax
-
-			next_column4:
-
-				// Get the current 8-bit index from the old image, use it to
-				// obtain the 24-bit pixel, and store it in the new image.  If 
-				// the 8-bit index is not the transparent index, mark the pixel as
-				// opaque by setting the tranparency mask.
-
-				mov eax, 0
-				mov ecx, column_index
-				mov al, [ebx + ecx]
-				mov ecx, palette_ptr
-				cmp eax, transparent_index
-				jne opaque_pixel4
-				mov eax, [ecx + eax * 4]	
-				jmp store_pixel4
-			opaque_pixel4:
-				mov eax, [ecx + eax * 4]
-				or eax, transparency_mask32
-			store_pixel4:
-				mov [edx], eax
-
-				// Increment the old image offset, wrapping back to zero if the 
-				// end of the row is reached.
-
-				mov eax, column_index
-				inc eax
-				cmp eax, image_width 
-				jl next_pixel4
-				mov eax, 0
-			next_pixel4:
-				mov column_index, eax
-
-				// Increment the new image pointer.
-
-				add edx, 4
-
-				// Decrement the column counter, and copy next pixel in row if
-				// there are any left.
-
-				dec esi
-				jnz next_column4
-
-				// Increment the old image row pointer, and wrap back to the
-				// first row if the end of the image has been reached.
-
-				add ebx, image_width
-				cmp ebx, end_image_ptr
-				jl skip_wrap4
-				mov ebx, image_ptr
+	// Convert the unlit image to a 16-bit lit image if the frame buffer depth
+	// is 16, or a 32-bit lit image if the frame buffer depth is 24 or 32.  The
+	// transparency mask is set on every opaque pixel.
 
-			skip_wrap4:
+	lit_bytes_per_pixel = frame_buffer_depth == 16 ? 2 : 4;
+	convert_image(pixmap_ptr->image_ptr, pixmap_ptr->width, pixmap_ptr->height,
+		pixmap_ptr->bytes_per_pixel, palette_ptr, transparent_index,
+		frame_buffer_pixel_format_ptr->alpha_comp_mask,
+		cache_entry_ptr->lit_image_ptr, image_dimensions, lit_bytes_per_pixel,
+		image_dimensions * lit_bytes_per_pixel);
 
-				// Decrement the row counter, and copy next row if there are any
-				// left.
+	// Build the mipmap levels from the lit image.
 
-				dec edi
-				jnz next_row4
-			}
-		}
-	}
+	get_component_masks(frame_buffer_pixel_format_ptr, red_comp_mask,
+		green_comp_mask, blue_comp_mask);
+	build_mipmaps(cache_entry_ptr->lit_image_ptr, image_dimensions,
+		lit_bytes_per_pixel, red_comp_mask, green_comp_mask, blue_comp_mask,
+		frame_buffer_pixel_format_ptr->alpha_comp_mask);
 }
 
 //------------------------------------------------------------------------------
-// Render a colour span to a 16-bit frame buffer.
+// Render a colour span to the frame buffer.
 //------------------------------------------------------------------------------
 
-static void
-render_colour_span16(span *span_ptr)
+void
+render_colour_span(span *span_ptr)
 {
 	byte *fb_ptr;
-	word colour_pixel16;
-	int span_width;
 
 	// Ignore span if it has zero width.
 
 	if (span_ptr->start_sx == span_ptr->end_sx)
 		return;
 
-	// Calculate the frame buffer pointer and span width.
-
-	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy + (span_ptr->start_sx << 1);
-	span_width = span_ptr->end_sx - span_ptr->start_sx;
-
-	// Get the 16-bit colour pixel.
-
-	colour_pixel16 = (word)span_ptr->colour_pixel;
-
-	// Render the span into the 16-bit frame buffer.
-
-	__asm {
-
-		// Put the texture colour into AX, the image pointer into EBX, and
-		// the span width into ECX.
-
-		mov ax, colour_pixel16
-		mov ebx, fb_ptr
-		mov ecx, span_width
-
-	next_pixel16:
-
-		// Store the texture colour in the frame buffer, then advance the
-		// frame buffer pointer.
-
-		mov [ebx], ax
-		add ebx, 2
+	// Calculate the frame buffer pointer, and render the span.
 
-		// Decrement the loop counter, and continue if we haven't filled the
-		// whole span yet.
-
-		dec ecx
-		jnz next_pixel16
-	}
+	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy +
+		span_ptr->start_sx * (frame_buffer_depth >> 3);
+	draw_colour_span(fb_ptr, frame_buffer_depth, span_ptr->colour_pixel,
+		span_ptr->end_sx - span_ptr->start_sx);
 }
 
 //------------------------------------------------------------------------------
-// Render a colour span to a 24-bit frame buffer.
+// Render a transparent span to the frame buffer.  If texels are being shaded,
+// the lit image is at full brightness and the span's brightness is applied as
+// it is drawn.  The mipmap level is chosen from the span's texel step.
 //------------------------------------------------------------------------------
 
-static void
-render_colour_span24(span *span_ptr)
+void
+render_transparent_span(span *span_ptr)
 {
+	cache_entry *cache_entry_ptr;
+	texel_shade shade, *shade_ptr;
 	byte *fb_ptr;
-	pixel colour_pixel24;
-	int span_width;
 
 	// Ignore span if it has zero width.
 
 	if (span_ptr->start_sx == span_ptr->end_sx)
 		return;
 
-	// Calculate the frame buffer pointer and span width.
-
-	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy + span_ptr->start_sx * 3;
-	span_width = span_ptr->end_sx - span_ptr->start_sx;
-
-	// Get the 24-bit colour pixel.
-
-	colour_pixel24 = span_ptr->colour_pixel;
-
-	// Render the span into the 24-bit frame buffer.
-
-	__asm {
-
-		// Put the texture colour into EAX, the image pointer into EBX, and
-		// the span width into ECX.
-
-		mov eax, colour_pixel24
-		mov ebx, fb_ptr
-		mov ecx, span_width
-
-	next_pixel24:
-
-		// Store the texture colour in the frame buffer, then advance the
-		// frame buffer pointer.
+	// Set up the texel shading if it's needed.
 
-		mov edx, [ebx]
-		and edx, 0xff000000
-		or edx, eax
-		mov [ebx], edx
-		add ebx, 3
+	if (shade_texels && span_ptr->brightness_index > 0) {
+		set_texel_shade(&shade, frame_buffer_pixel_format_ptr,
+			span_ptr->brightness_index);
+		shade_ptr = &shade;
+	} else
+		shade_ptr = NULL;
 
-		// Decrement the loop counter, and continue if we haven't filled the
-		// whole span yet.
+	// Get the lit image data, calculate the frame buffer pointer, and render
+	// the span.  The cache entry was looked up on the player thread before
+	// rendering started; if there is no lit image the span is left undrawn.
 
-		dec ecx
-		jnz next_pixel24
-	}
+	cache_entry_ptr = span_ptr->cache_entry_ptr;
+	if (cache_entry_ptr == NULL)
+		return;
+	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy +
+		span_ptr->start_sx * (frame_buffer_depth >> 3);
+	draw_texture_span(fb_ptr, frame_buffer_depth, span_ptr, cache_entry_ptr,
+		frame_buffer_pixel_format_ptr->alpha_comp_mask, shade_ptr,
+		get_span_mipmap_level(span_ptr, cache_entry_ptr->lit_image_levels));
 }
 
 //------------------------------------------------------------------------------
-// Render a colour span to a 32-bit frame buffer.
+// Render a popup span to the frame buffer.
 //------------------------------------------------------------------------------
 
-static void
-render_colour_span32(span *span_ptr)
+void
+render_popup_span(span *span_ptr)
 {
-	byte *fb_ptr;
-	pixel colour_pixel32;
-	int span_width;
+	pixmap *pixmap_ptr;
+	byte *image_ptr, *fb_ptr;
+	pixel *palette_ptr;
+	int transparent_index = 0;
+	pixel transparency_mask32 = 0;
+	int image_width, span_width;
+	fixed u, v;
 
 	// Ignore span if it has zero width.
 
 	if (span_ptr->start_sx == span_ptr->end_sx)
 		return;
 
-	// Calculate the frame buffer pointer and span width.
-
-	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy + (span_ptr->start_sx << 2);
-	span_width = span_ptr->end_sx - span_ptr->start_sx;
-
-	// Get the 32-bit colour pixel.
-
-	colour_pixel32 = span_ptr->colour_pixel;
-
-	// Render the span into the 32-bit frame buffer.
-
-	__asm {
-
-		// Put the texture colour into EAX, the image pointer into EBX, and
-		// the span width into ECX.
-
-		mov eax, colour_pixel32
-		mov ebx, fb_ptr
-		mov ecx, span_width
-
-	next_pixel32:
-
-		// Store the texture colour in the frame buffer, then advance the
-		// frame buffer pointer.
+	// Get the pointer to the pixmap to render, the display palette for
+	// the desired brightness level, the transparent colour index or mask,
+	// and the image width (in bytes).
+	
+	pixmap_ptr = span_ptr->pixmap_ptr;
+	if (pixmap_ptr->bytes_per_pixel == 2) {
+		palette_ptr = light_table[span_ptr->brightness_index];
+		transparency_mask32 = texture_pixel_format.alpha_comp_mask;
+		image_width = pixmap_ptr->width * 2;
+		u = ((int)span_ptr->start_span.u_on_tz % pixmap_ptr->width) * 2;
+	} else {
+		palette_ptr = pixmap_ptr->display_palette_list + 
+			span_ptr->brightness_index * pixmap_ptr->colours;
+		transparent_index = pixmap_ptr->transparent_index;
+		image_width = pixmap_ptr->width;
+		u = (int)span_ptr->start_span.u_on_tz % pixmap_ptr->width;
+	}
+	v = (int)span_ptr->start_span.v_on_tz % pixmap_ptr->height;
 
-		mov [ebx], eax
-		add ebx, 4
+	// Get the pointer to the starting pixel in the frame buffer, and the
+	// image pointer.
+	
+	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy +
+		span_ptr->start_sx * (frame_buffer_depth >> 3);
+	image_ptr = pixmap_ptr->image_ptr + v * image_width;
 
-		// Decrement the loop counter, and continue if we haven't filled the
-		// whole span yet.
+	// Render the span.
 
-		dec ecx
-		jnz next_pixel32
-	}
+	span_width = span_ptr->end_sx - span_ptr->start_sx;
+	draw_linear_span(fb_ptr, frame_buffer_depth, pixmap_ptr->bytes_per_pixel == 2,
+		image_ptr, palette_ptr, transparent_index, transparency_mask32,
+		image_width, span_width, u);
 }
 
 //------------------------------------------------------------------------------
-// Render a colour span to the frame buffer.
+// Render a pixel to the frame buffer.
 //------------------------------------------------------------------------------
 
-void
-render_colour_span(span *span_ptr)
+static void
+render_pixel16(int x, int y, pixel pixel_colour)
 {
-	switch (frame_buffer_depth) {
-	case 16:
-		render_colour_span16(span_ptr);
-		break;
-	case 24:
-		render_colour_span24(span_ptr);
-		break;
-	case 32:
-		render_colour_span32(span_ptr);
-	}
+	*(word *)(frame_buffer_ptr + frame_buffer_row_pitch * y + (x << 1)) = pixel_colour;
 }
 
-//------------------------------------------------------------------------------
-// Render a transparent span to a 16-bit frame buffer.
-//------------------------------------------------------------------------------
-
 static void
-render_transparent_span16(span *span_ptr)
-{
-	cache_entry *cache_entry_ptr;
-	float start_one_on_tz;
-	float end_one_on_tz, end_tz;
-	int span_start_sx, span_end_sx, end_sx;
-	float u_on_tz, v_on_tz;
-	fixed u, v;
-	fixed end_u, end_v;
-	fixed delta_u, delta_v;
-	span_data scaled_delta_span;
-	byte *image_ptr, *fb_ptr;
-	int mask, shift;
-	word transparency_mask16;
-	int span_width;
-
-	// Ignore span if it has zero width.
-
-	if (span_ptr->start_sx == span_ptr->end_sx)
-		return;
-
-	// Get the lit image data.
-
-	cache_entry_ptr = get_cache_entry(span_ptr->pixmap_ptr, span_ptr->brightness_index);
-	image_ptr = cache_entry_ptr->lit_image_ptr;
-	mask = cache_entry_ptr->lit_image_mask;
-	shift = cache_entry_ptr->lit_image_shift;
-
-	// Pre-scale the deltas for faster calculations when rendering spans that
-	// are SPAN_WIDTH in width.
-
-	scaled_delta_span.one_on_tz = span_ptr->delta_span.one_on_tz * SPAN_WIDTH;
-	scaled_delta_span.u_on_tz = span_ptr->delta_span.u_on_tz * SPAN_WIDTH;
-	scaled_delta_span.v_on_tz = span_ptr->delta_span.v_on_tz * SPAN_WIDTH;
-
-	// Get the starting 1/tz value; if it is zero, make it one (this is used
-	// by sky spans to ensure they are furthest from the viewer, rather than
-	// using a tiny 1/tz value that introduces errors into the texture
-	// coordinates).
-
-	start_one_on_tz = span_ptr->start_span.one_on_tz;
-	if (start_one_on_tz == 0.0)
-		start_one_on_tz = 1.0;
-
-	// Get the pointer to the starting pixel in the frame buffer.
-	
-	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy + (span_ptr->start_sx << 1);
-
-	// Get the transparency mask.
-
-	transparency_mask16 = (word)frame_buffer_pixel_format_ptr->alpha_comp_mask;
-
-	// Compute (u,v) for that pixel.  We are now representing (u,v) as true fixed
-	// point values for speed.
-
-	u_on_tz = span_ptr->start_span.u_on_tz;
-	v_on_tz = span_ptr->start_span.v_on_tz;
-	end_tz = 1.0f / start_one_on_tz;
-	COMPUTE_UV(u, v, u_on_tz, v_on_tz, end_tz);
-
-	// Compute the start and end data for the first span.
-
-	span_start_sx = span_ptr->start_sx;
-	span_end_sx = span_ptr->start_sx + SPAN_WIDTH;
-	end_sx = span_ptr->end_sx;
-	end_one_on_tz = start_one_on_tz + scaled_delta_span.one_on_tz;
-	end_tz = 1.0f / end_one_on_tz;
-
-	// Now render the row one span at a time, until we have less than a span's
-	// width of pixels left.
-
-	while (span_end_sx < end_sx) {
-			
-		// Compute (end_u, end_v) and (delta_u, delta_v) for this span, 
-		// storing them as fixed point numbers for speed.  We also compute
-		// the ending 1/tz value for the *next* span.
-		
-		u_on_tz += scaled_delta_span.u_on_tz;
-		v_on_tz += scaled_delta_span.v_on_tz;
-		COMPUTE_UV(end_u, end_v, u_on_tz, v_on_tz, end_tz);
-		delta_u = (end_u - u) >> SPAN_SHIFT;
-		delta_v = (end_v - v) >> SPAN_SHIFT;
-		end_one_on_tz += scaled_delta_span.one_on_tz;
-
-		// The rest of the render span code is done in assembler for speed...
-
-		__asm {
-
-			// Start computing 1/one_on_tz for the next span (the floating 
-			// point divide will overlap the span render loop on a Pentium).
-
-			fld const_1
-			fdiv end_one_on_tz
-
-			// Put u in EBX and v in EDX.
-
-			mov ebx, u
-			mov edx, v
-
-			// Combine the mask and shift in ECX; the mask occupies the top 
-			// word, and the shift occupies CL.
-
-			mov ecx, mask
-			or  ecx, shift
-
-			// Move the frame buffer pointer into ESI.
-
-			mov esi, fb_ptr
-
-			// Render the pixels in the span.
-
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_1)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_2)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_3)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_4)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_5)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_6)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_7)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_8)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_9)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_10)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_11)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_12)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_13)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_14)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_15)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_16)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_17)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_18)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_19)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_20)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_21)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_22)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_23)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_24)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_25)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_26)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_27)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_28)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_29)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_30)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_31)
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16_32)
-
-			// Save new value of frame buffer
-
-			mov fb_ptr, esi
-
-			// Store the result of 1/one_on_tz in end_tz (this computation
-			// should be well and truly completed by now).
-
-			fstp end_tz
-		}
-
-		// Get ready for the next span.
-
-		u = end_u;
-		v = end_v;
-		span_start_sx = span_end_sx;
-		span_end_sx += SPAN_WIDTH;
-	}
-
-	// If there are pixels left, render one more shorter span.
-
-	if (span_start_sx < end_sx) {
-
-		// Compute (end_u, end_v) and (delta_u, delta_v) for this span,
-		// storing them as fixed point numbers for speed.
-		
-		u_on_tz += scaled_delta_span.u_on_tz;
-		v_on_tz += scaled_delta_span.v_on_tz;
-		COMPUTE_UV(end_u, end_v, u_on_tz, v_on_tz, end_tz);
-		delta_u = (end_u - u) >> SPAN_SHIFT;
-		delta_v = (end_v - v) >> SPAN_SHIFT;
-
-		// Compute the size of this last span.
-
-		span_width = (end_sx - span_start_sx) << 8;
-
-		// Render the span...
-
-		__asm {
-
-			// Put u in EBX and v in EDX.
-
-			mov ebx, u
-			mov edx, v
-
-			// Combine the mask, shift and span width in ECX; the mask
-			// occupies the top word, the shift occupies CL, and the span
-			// width occupies CH.
-
-			mov ecx, mask
-			or  ecx, shift
-			or	ecx, span_width
-
-			// Move the the frame buffer pointer into ESI.
-
-			mov esi, fb_ptr
-
-			// Render span_width texture mapped pixels.
-
-		next_pixel16:
-			DRAW_TRANSPARENT_PIXEL16(skip_pixel16)
-			dec ch
-			jnz next_pixel16
-			
-			// Save new value of the frame buffer pointer.
-
-			mov fb_ptr, esi
-		}
-	}
-}
-
-//------------------------------------------------------------------------------
-// Render a transparent span to a 24-bit frame buffer.
-//------------------------------------------------------------------------------
-
-static void
-render_transparent_span24(span *span_ptr)
-{
-	cache_entry *cache_entry_ptr;
-	float start_one_on_tz;
-	float end_one_on_tz, end_tz;
-	int span_start_sx, span_end_sx, end_sx;
-	float u_on_tz, v_on_tz;
-	fixed u, v;
-	fixed end_u, end_v;
-	fixed delta_u, delta_v;
-	span_data scaled_delta_span;
-	byte *image_ptr, *fb_ptr;
-	int mask, shift;
-	pixel transparency_mask24;
-	int span_width;
-
-	// Ignore span if it has zero width.
-
-	if (span_ptr->start_sx == span_ptr->end_sx)
-		return;
-
-	// Get the lit image data.
-
-	cache_entry_ptr = get_cache_entry(span_ptr->pixmap_ptr, span_ptr->brightness_index);
-	image_ptr = cache_entry_ptr->lit_image_ptr;
-	mask = cache_entry_ptr->lit_image_mask;
-	shift = cache_entry_ptr->lit_image_shift;
-
-	// Pre-scale the deltas for faster calculations when rendering spans that
-	// are SPAN_WIDTH in width.
-
-	scaled_delta_span.one_on_tz = span_ptr->delta_span.one_on_tz * SPAN_WIDTH;
-	scaled_delta_span.u_on_tz = span_ptr->delta_span.u_on_tz * SPAN_WIDTH;
-	scaled_delta_span.v_on_tz = span_ptr->delta_span.v_on_tz * SPAN_WIDTH;
-
-	// Get the starting 1/tz value; if it is zero, make it one (this is used
-	// by sky spans to ensure they are furthest from the viewer, rather than
-	// using a tiny 1/tz value that introduces errors into the texture
-	// coordinates).
-
-	start_one_on_tz = span_ptr->start_span.one_on_tz;
-	if (start_one_on_tz == 0.0)
-		start_one_on_tz = 1.0;
-
-	// Get the pointer to the starting pixel in the frame buffer.
-	
-	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy + (span_ptr->start_sx * 3);
-
-	// Get the transparency mask.
-
-	transparency_mask24 = frame_buffer_pixel_format_ptr->alpha_comp_mask;
-
-	// Compute (u,v) for that pixel.  We are now representing (u,v) as true fixed
-	// point values for speed.
-
-	u_on_tz = span_ptr->start_span.u_on_tz;
-	v_on_tz = span_ptr->start_span.v_on_tz;
-	end_tz = 1.0f / start_one_on_tz;
-	COMPUTE_UV(u, v, u_on_tz, v_on_tz, end_tz);
-
-	// Compute the start and end data for the first span.
-
-	span_start_sx = span_ptr->start_sx;
-	span_end_sx = span_ptr->start_sx + SPAN_WIDTH;
-	end_sx = span_ptr->end_sx;
-	end_one_on_tz = start_one_on_tz + scaled_delta_span.one_on_tz;
-	end_tz = 1.0f / end_one_on_tz;
-
-	// Now render the row one span at a time, until we have less than a span's
-	// width of pixels left.
-
-	while (span_end_sx < end_sx) {
-			
-		// Compute (end_u, end_v) and (delta_u, delta_v) for this span, 
-		// storing them as fixed point numbers for speed.  We also compute
-		// the ending 1/tz value for the *next* span.
-		
-		u_on_tz += scaled_delta_span.u_on_tz;
-		v_on_tz += scaled_delta_span.v_on_tz;
-		COMPUTE_UV(end_u, end_v, u_on_tz, v_on_tz, end_tz);
-		delta_u = (end_u - u) >> SPAN_SHIFT;
-		delta_v = (end_v - v) >> SPAN_SHIFT;
-		end_one_on_tz += scaled_delta_span.one_on_tz;
-
-		// The rest of the render span code is done in assembler for speed...
-
-		__asm {
-
-			// Start computing 1/one_on_tz for the next span (the floating 
-			// point divide will overlap the span render loop on a Pentium).
-
-			fld const_1
-			fdiv end_one_on_tz
-
-			// Put u in EBX and v in EDX.
-
-			mov ebx, u
-			mov edx, v
-
-			// Combine the mask and shift in ECX; the mask occupies the top 
-			// word, and the shift occupies CL.
-
-			mov ecx, mask
-			or  ecx, shift
-
-			// Move the frame buffer pointer into ESI.
-
-			mov esi, fb_ptr
-
-			// Render the pixels in the span.
-
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_1)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_2)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_3)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_4)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_5)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_6)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_7)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_8)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_9)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_10)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_11)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_12)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_13)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_14)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_15)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_16)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_17)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_18)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_19)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_20)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_21)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_22)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_23)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_24)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_25)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_26)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_27)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_28)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_29)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_30)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_31)
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24_32)
-
-			// Save new value of frame buffer
-
-			mov fb_ptr, esi
-
-			// Store the result of 1/one_on_tz in end_tz (this computation
-			// should be well and truly completed by now).
-
-			fstp end_tz
-		}
-
-		// Get ready for the next span.
-
-		u = end_u;
-		v = end_v;
-		span_start_sx = span_end_sx;
-		span_end_sx += SPAN_WIDTH;
-	}
-
-	// If there are pixels left, render one more shorter span.
-
-	if (span_start_sx < end_sx) {
-
-		// Compute (end_u, end_v) and (delta_u, delta_v) for this span,
-		// storing them as fixed point numbers for speed.
-		
-		u_on_tz += scaled_delta_span.u_on_tz;
-		v_on_tz += scaled_delta_span.v_on_tz;
-		COMPUTE_UV(end_u, end_v, u_on_tz, v_on_tz, end_tz);
-		delta_u = (end_u - u) >> SPAN_SHIFT;
-		delta_v = (end_v - v) >> SPAN_SHIFT;
-
-		// Compute the size of this last span.
-
-		span_width = (end_sx - span_start_sx) << 8;
-
-		// Render the span...
-
-		__asm {
-
-			// Put u in EBX and v in EDX.
-
-			mov ebx, u
-			mov edx, v
-
-			// Combine the mask, shift and span width in ECX; the mask
-			// occupies the top word, the shift occupies CL, and the span
-			// width occupies CH.
-
-			mov ecx, mask
-			or  ecx, shift
-			or	ecx, span_width
-
-			// Move the the frame buffer pointer into ESI.
-
-			mov esi, fb_ptr
-
-			// Render span_width texture mapped pixels.
-
-		next_pixel24:
-			DRAW_TRANSPARENT_PIXEL24(skip_pixel24)
-			dec ch
-			jnz next_pixel24
-			
-			// Save new value of the frame buffer pointer.
-
-			mov fb_ptr, esi
-		}
-	}
-}
-
-//------------------------------------------------------------------------------
-// Render a transparent span to a 32-bit frame buffer.
-//------------------------------------------------------------------------------
-
-static void
-render_transparent_span32(span *span_ptr)
-{
-	cache_entry *cache_entry_ptr;
-	float start_one_on_tz;
-	float end_one_on_tz, end_tz;
-	int span_start_sx, span_end_sx, end_sx;
-	float u_on_tz, v_on_tz;
-	fixed u, v;
-	fixed end_u, end_v;
-	fixed delta_u, delta_v;
-	span_data scaled_delta_span;
-	byte *image_ptr, *fb_ptr;
-	int mask, shift;
-	pixel transparency_mask32;
-	int span_width;
-
-	// Ignore span if it has zero width.
-
-	if (span_ptr->start_sx == span_ptr->end_sx)
-		return;
-
-	// Get the lit image data.
-
-	cache_entry_ptr = get_cache_entry(span_ptr->pixmap_ptr, 
-		span_ptr->brightness_index);
-	image_ptr = cache_entry_ptr->lit_image_ptr;
-	mask = cache_entry_ptr->lit_image_mask;
-	shift = cache_entry_ptr->lit_image_shift;
-
-	// Pre-scale the deltas for faster calculations when rendering spans that
-	// are SPAN_WIDTH in width.
-
-	scaled_delta_span.one_on_tz = span_ptr->delta_span.one_on_tz * SPAN_WIDTH;
-	scaled_delta_span.u_on_tz = span_ptr->delta_span.u_on_tz * SPAN_WIDTH;
-	scaled_delta_span.v_on_tz = span_ptr->delta_span.v_on_tz * SPAN_WIDTH;
-
-	// Get the starting 1/tz value; if it is zero, make it one (this is used
-	// by sky spans to ensure they are furthest from the viewer, rather than
-	// using a tiny 1/tz value that introduces errors into the texture
-	// coordinates).
-
-	start_one_on_tz = span_ptr->start_span.one_on_tz;
-	if (start_one_on_tz == 0.0)
-		start_one_on_tz = 1.0;
-
-	// Get the pointer to the starting pixel in the frame buffer.
-	
-	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy + (span_ptr->start_sx << 2);
-
-	// Get the transparency mask.
-
-	transparency_mask32 = frame_buffer_pixel_format_ptr->alpha_comp_mask;
-
-	// Compute (u,v) for that pixel.  We are now representing (u,v) as true fixed
-	// point values for speed.
-
-	u_on_tz = span_ptr->start_span.u_on_tz;
-	v_on_tz = span_ptr->start_span.v_on_tz;
-	end_tz = 1.0f / start_one_on_tz;
-	COMPUTE_UV(u, v, u_on_tz, v_on_tz, end_tz);
-
-	// Compute the start and end data for the first span.
-
-	span_start_sx = span_ptr->start_sx;
-	span_end_sx = span_ptr->start_sx + SPAN_WIDTH;
-	end_sx = span_ptr->end_sx;
-	end_one_on_tz = start_one_on_tz + scaled_delta_span.one_on_tz;
-	end_tz = 1.0f / end_one_on_tz;
-
-	// Now render the row one span at a time, until we have less than a span's
-	// width of pixels left.
-
-	while (span_end_sx < end_sx) {
-			
-		// Compute (end_u, end_v) and (delta_u, delta_v) for this span, 
-		// storing them as fixed point numbers for speed.  We also compute
-		// the ending 1/tz value for the *next* span.
-		
-		u_on_tz += scaled_delta_span.u_on_tz;
-		v_on_tz += scaled_delta_span.v_on_tz;
-		COMPUTE_UV(end_u, end_v, u_on_tz, v_on_tz, end_tz);
-		delta_u = (end_u - u) >> SPAN_SHIFT;
-		delta_v = (end_v - v) >> SPAN_SHIFT;
-		end_one_on_tz += scaled_delta_span.one_on_tz;
-
-		// The rest of the render span code is done in assembler for speed...
-
-		__asm {
-
-			// Start computing 1/one_on_tz for the next span (the floating 
-			// point divide will overlap the span render loop on a Pentium).
-
-			fld const_1
-			fdiv end_one_on_tz
-
-			// Put u in EBX and v in EDX.
-
-			mov ebx, u
-			mov edx, v
-
-			// Combine the mask and shift in ECX; the mask occupies the top 
-			// word, and the shift occupies CL.
-
-			mov ecx, mask
-			or  ecx, shift
-
-			// Move the frame buffer pointer into ESI.
-
-			mov esi, fb_ptr
-
-			// Render the pixels in the span.
-
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_1)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_2)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_3)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_4)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_5)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_6)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_7)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_8)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_9)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_10)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_11)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_12)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_13)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_14)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_15)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_16)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_17)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_18)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_19)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_20)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_21)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_22)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_23)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_24)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_25)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_26)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_27)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_28)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_29)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_30)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_31)
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32_32)
-
-			// Save new value of frame buffer
-
-			mov fb_ptr, esi
-
-			// Store the result of 1/one_on_tz in end_tz (this computation
-			// should be well and truly completed by now).
-
-			fstp end_tz
-		}
-
-		// Get ready for the next span.
-
-		u = end_u;
-		v = end_v;
-		span_start_sx = span_end_sx;
-		span_end_sx += SPAN_WIDTH;
-	}
-
-	// If there are pixels left, render one more shorter span.
-
-	if (span_start_sx < end_sx) {
-
-		// Compute (end_u, end_v) and (delta_u, delta_v) for this span,
-		// storing them as fixed point numbers for speed.
-		
-		u_on_tz += scaled_delta_span.u_on_tz;
-		v_on_tz += scaled_delta_span.v_on_tz;
-		COMPUTE_UV(end_u, end_v, u_on_tz, v_on_tz, end_tz);
-		delta_u = (end_u - u) >> SPAN_SHIFT;
-		delta_v = (end_v - v) >> SPAN_SHIFT;
-
-		// Compute the size of this last span.
-
-		span_width = (end_sx - span_start_sx) << 8;
-
-		// Render the span...
-
-		__asm {
-
-			// Put u in EBX and v in EDX.
-
-			mov ebx, u
-			mov edx, v
-
-			// Combine the mask, shift and span width in ECX; the mask
-			// occupies the top word, the shift occupies CL, and the span
-			// width occupies CH.
-
-			mov ecx, mask
-			or  ecx, shift
-			or	ecx, span_width
-
-			// Move the the frame buffer pointer into ESI.
-
-			mov esi, fb_ptr
-
-			// Render span_width texture mapped pixels.
-
-		next_pixel32:
-			DRAW_TRANSPARENT_PIXEL32(skip_pixel32)
-			dec ch
-			jnz next_pixel32
-			
-			// Save new value of the frame buffer pointer.
-
-			mov fb_ptr, esi
-		}
-	}
-}
-
-//------------------------------------------------------------------------------
-// Render a transparent span to the frame buffer.
-//------------------------------------------------------------------------------
-
-void
-render_transparent_span(span *span_ptr)
-{
-	switch (frame_buffer_depth) {
-	case 16:
-		render_transparent_span16(span_ptr);
-		break;
-	case 24:
-		render_transparent_span24(span_ptr);
-		break;
-	case 32:
-		render_transparent_span32(span_ptr);
-	}
-}
-
-//------------------------------------------------------------------------------
-// Render a linear span into a 16-bit frame buffer.
-//------------------------------------------------------------------------------
-
-static void
-render_linear_span16(bool image_is_16_bit, byte *image_ptr, byte *fb_ptr,
-					 pixel *palette_ptr, int transparent_index,
-					 pixel transparency_mask32, int image_width, int span_width,
-					 fixed u)
-{
-	// If the image is 16 bit...
-
-	if (image_is_16_bit) {
-		__asm {
-
-			// Put u in EBX, image_width in ECX and span_width in EDX.
-
-			mov ebx, u
-			mov ecx, image_width
-			mov edx, span_width
-
-			// Put the frame buffer pointer in ESI.
-
-			mov esi, fb_ptr
-
-		next_pixel16a:
-
-			// Load the 16-bit image pixel into EAX.  If it's transparent, skip it.
-			
-			mov eax, 0
-			mov edi, image_ptr
-			mov ax, [edi + ebx]
-			test eax, transparency_mask32
-			jz skip_pixel16a
-
-			// Use the unlit 16-bit pixel as an index into the palette to obtain
-			// the lit 16-bit pixel, which we then store in the frame buffer.
-
-			mov edi, palette_ptr
-			mov ax, [edi + eax * 4]
-			mov [esi], ax
-
-		skip_pixel16a:
-
-			// Advance the frame buffer pointer.
-
-			add esi, 2
-
-			// Advance u, wrapping to zero if it equals image_width.
-
-			add ebx, 2
-			cmp ebx, ecx
-			jl done_pixel16a
-			mov ebx, 0
-
-		done_pixel16a:
-
-			// If there are still pixels to render, repeat loop.
-
-			dec edx
-			jnz next_pixel16a
-		}
-	}
-
-	// If the image is 8 bit...
-
-	else {
-		__asm {
-
-			// Put u in EBX, image_width in ECX and span_width in EDX.
-
-			mov ebx, u
-			mov ecx, image_width
-			mov edx, span_width
-
-			// Put the frame buffer pointer in ESI.
-
-			mov esi, fb_ptr
-
-		next_pixel16b:
-
-			// Load the 8-bit image pixel into EAX.  If it's the transparent
-			// colour index, skip this pixel.
-			
-			mov eax, 0
-			mov edi, image_ptr
-			mov al, [edi + ebx]
-			cmp eax, transparent_index
-			je skip_pixel16b
-
-			// Use the 8-bit pixel as an index into the palette to obtain the 
-			// 16-bit pixel, which we then store in the frame buffer.
-
-			mov edi, palette_ptr
-			mov ax, [edi + eax * 4]
-			mov [esi], ax
-
-		skip_pixel16b:
-
-			// Advance the frame buffer pointer.
-
-			add esi, 2
-
-			// Advance u, wrapping to zero if it equals image_width.
-
-			inc ebx
-			cmp ebx, ecx
-			jl done_pixel16b
-			mov ebx, 0
-
-		done_pixel16b:
-
-			// If there are still pixels to render, repeat loop.
-
-			dec edx
-			jnz next_pixel16b
-		}
-	}
-}
-
-//------------------------------------------------------------------------------
-// Render a linear span into a 24-bit frame buffer.
-//------------------------------------------------------------------------------
-
-static void
-render_linear_span24(bool image_is_16_bit, byte *image_ptr, byte *fb_ptr,
-					 pixel *palette_ptr, int transparent_index,
-					 pixel transparency_mask32, int image_width, int span_width,
-					 fixed u)
-{
-	// If the image is 16 bit...
-
-	if (image_is_16_bit) {
-		__asm {
-
-			// Put u in EBX, image_width in ECX and span_width in EDX.
-
-			mov ebx, u
-			mov ecx, image_width
-			mov edx, span_width
-
-		next_pixel24a:
-
-			// Load the 16-bit image pixel into EAX.  If it's transparent,
-			// skip this pixel.
-			
-			mov eax, 0
-			mov edi, image_ptr
-			mov ax, [edi + ebx]
-			test eax, transparency_mask32
-			jz skip_pixel24a
-
-			// Use the 16-bit pixel as an index into the palette to obtain the 
-			// 24-bit pixel, which we then store in the frame buffer.
-
-			mov edi, fb_ptr
-			mov esi, [edi]
-			and esi, 0xff000000
-			mov edi, palette_ptr
-			or esi, [edi + eax * 4]
-			mov edi, fb_ptr
-			mov [edi], esi
-
-		skip_pixel24a:
-
-			// Advance the frame buffer pointer.
-
-			add edi, 3
-			mov fb_ptr, edi
-
-			// Advance u, wrapping to zero if it equals image_width.
-
-			add ebx, 2
-			cmp ebx, ecx
-			jl done_pixel24a
-			mov ebx, 0
-
-		done_pixel24a:
-
-			// If there are still pixels to render, repeat loop.
-
-			dec edx
-			jnz next_pixel24a
-		}
-	}
-
-	// If the image is 8 bit...
-	
-	else {
-		__asm {
-
-			// Put u in EBX, image_width in ECX and span_width in EDX.
-
-			mov ebx, u
-			mov ecx, image_width
-			mov edx, span_width
-
-		next_pixel24b:
-
-			// Load the 8-bit image pixel into EAX.  If it's the transparent
-			// colour index, skip this pixel.
-			
-			mov eax, 0
-			mov edi, image_ptr
-			mov al, [edi + ebx]
-			cmp eax, transparent_index
-			je skip_pixel24b
-
-			// Use the 8-bit pixel as an index into the palette to obtain the 
-			// 24-bit pixel, which we then store in the frame buffer.
-
-			mov edi, fb_ptr
-			mov esi, [edi]
-			and esi, 0xff000000
-			mov edi, palette_ptr
-			or esi, [edi + eax * 4]
-			mov edi, fb_ptr
-			mov [edi], esi
-
-		skip_pixel24b:
-
-			// Advance the frame buffer pointer.
-
-			add edi, 3
-			mov fb_ptr, edi
-
-			// Advance u, wrapping to zero if it equals image_width.
-
-			inc ebx
-			cmp ebx, ecx
-			jl done_pixel24b
-			mov ebx, 0
-
-		done_pixel24b:
-
-			// If there are still pixels to render, repeat loop.
-
-			dec edx
-			jnz next_pixel24b
-		}
-	}
-}
-
-//------------------------------------------------------------------------------
-// Render a linear span into a 32-bit frame buffer.
-//------------------------------------------------------------------------------
-
-static void
-render_linear_span32(bool image_is_16_bit, byte *image_ptr, byte *fb_ptr,
-					 pixel *palette_ptr, int transparent_index,
-					 pixel transparency_mask32, int image_width, int span_width,
-					 fixed u)
-{
-	// If the image is 16 bit...
-
-	if (image_is_16_bit) {
-		__asm {
-
-			// Put u in EBX, image_width in ECX and span_width in EDX.
-
-			mov ebx, u
-			mov ecx, image_width
-			mov edx, span_width
-
-			// Put the frame buffer pointer in ESI.
-
-			mov esi, fb_ptr
-
-		next_pixel32a:
-
-			// Load the 16-bit image pixel into EAX.  If it's transparent,
-			// skip this pixel.
-
-			mov eax, 0
-			mov edi, image_ptr
-			mov ax, [edi + ebx]
-			test eax, transparency_mask32
-			jz skip_pixel32a
-
-			// Use the 16-bit pixel as an index into the palette to obtain the 
-			// 32-bit pixel, which we then store in the frame buffer.
-
-			mov edi, palette_ptr
-			mov eax, [edi + eax * 4]
-			mov [esi], eax
-
-		skip_pixel32a:
-
-			// Advance the frame buffer pointer.
-
-			add esi, 4
-
-			// Advance u, wrapping to zero if it equals image_width.
-
-			add ebx, 2
-			cmp ebx, ecx
-			jl done_pixel32a
-			mov ebx, 0
-
-		done_pixel32a:
-
-			// If there are still pixels to render, repeat loop.
-
-			dec edx
-			jnz next_pixel32a
-		}
-	}
-
-	// If the pixmap is 8 bit...
-	
-	else {
-		__asm {
-
-			// Put u in EBX, image_width in ECX and span_width in EDX.
-
-			mov ebx, u
-			mov ecx, image_width
-			mov edx, span_width
-
-			// Put the frame buffer pointer in ESI.
-
-			mov esi, fb_ptr
-
-		next_pixel32b:
-
-			// Advance the frame buffer pointer.
-
-			mov eax, 0
-			mov edi, image_ptr
-			mov al, [edi + ebx]
-			cmp eax, transparent_index
-			je skip_pixel32b
-
-			// Use the 8-bit pixel as an index into the palette to obtain the 
-			// 24-bit pixel, which we then store in the frame buffer.
-
-			mov edi, palette_ptr
-			mov eax, [edi + eax * 4]
-			mov [esi], eax
-
-		skip_pixel32b:
-
-			// Advance the frame buffer pointer.
-
-			add esi, 4
-
-			// Advance u, wrapping to zero if it equals image_width.
-
-			inc ebx
-			cmp ebx, ecx
-			jl done_pixel32b
-			mov ebx, 0
-
-		done_pixel32b:
-
-			// If there are still pixels to render, repeat loop.
-
-			dec edx
-			jnz next_pixel32b
-		}
-	}
-}
-
-//------------------------------------------------------------------------------
-// Render a popup span into a 16-bit frame buffer.
-//------------------------------------------------------------------------------
-
-static void
-render_popup_span16(span *span_ptr)
-{
-	pixmap *pixmap_ptr;
-	byte *image_ptr, *fb_ptr;
-	pixel *palette_ptr;
-	int transparent_index;
-	pixel transparency_mask32;
-	int image_width, span_width;
-	fixed u, v;
-
-	// Ignore span if it has zero width.
-
-	if (span_ptr->start_sx == span_ptr->end_sx)
-		return;
-
-	// Get the pointer to the pixmap to render, the display palette for
-	// the desired brightness level, the transparent colour index or mask,
-	// and the image width (in bytes).
-	
-	pixmap_ptr = span_ptr->pixmap_ptr;
-	if (pixmap_ptr->bytes_per_pixel == 2) {
-		palette_ptr = light_table[span_ptr->brightness_index];
-		transparency_mask32 = texture_pixel_format.alpha_comp_mask;
-		image_width = pixmap_ptr->width * 2;
-		u = ((int)span_ptr->start_span.u_on_tz % pixmap_ptr->width) * 2;
-	} else {
-		palette_ptr = pixmap_ptr->display_palette_list + 
-			span_ptr->brightness_index * pixmap_ptr->colours;
-		transparent_index = pixmap_ptr->transparent_index;
-		image_width = pixmap_ptr->width;
-		u = (int)span_ptr->start_span.u_on_tz % pixmap_ptr->width;
-	}
-	v = (int)span_ptr->start_span.v_on_tz % pixmap_ptr->height;
-
-	// Get the pointer to the starting pixel in the frame buffer.
-	
-	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy + (span_ptr->start_sx << 1);
-
-	// Compute the image pointer.
-
-	image_ptr = pixmap_ptr->image_ptr + v * image_width;
-
-	// Compute the span width.
-
-	span_width = span_ptr->end_sx - span_ptr->start_sx;
-
-	// Render the span
-
-	render_linear_span16(pixmap_ptr->bytes_per_pixel == 2, image_ptr, fb_ptr,
-		palette_ptr, transparent_index, transparency_mask32, image_width,
-		span_width, u);
-}
-
-//------------------------------------------------------------------------------
-// Render a popup span into a 24-bit frame buffer.
-//------------------------------------------------------------------------------
-
-static void
-render_popup_span24(span *span_ptr)
-{
-	pixmap *pixmap_ptr;
-	byte *image_ptr, *fb_ptr;
-	pixel *palette_ptr;
-	int transparent_index;
-	pixel transparency_mask32;
-	int image_width, span_width;
-	fixed u, v;
-
-	// Ignore span if it has zero width.
-
-	if (span_ptr->start_sx == span_ptr->end_sx)
-		return;
-
-	// Get the pointer to the pixmap to render, the display palette for
-	// the desired brightness level, the transparent colour index or mask,
-	// and the image width (in bytes).
-	
-	pixmap_ptr = span_ptr->pixmap_ptr;
-	if (pixmap_ptr->bytes_per_pixel == 2) {
-		palette_ptr = light_table[span_ptr->brightness_index];
-		transparency_mask32 = texture_pixel_format.alpha_comp_mask;
-		image_width = pixmap_ptr->width * 2;
-		u = ((int)span_ptr->start_span.u_on_tz % pixmap_ptr->width) * 2;
-	} else {
-		palette_ptr = pixmap_ptr->display_palette_list + 
-			span_ptr->brightness_index * pixmap_ptr->colours;
-		transparent_index = pixmap_ptr->transparent_index;
-		image_width = pixmap_ptr->width;
-		u = (int)span_ptr->start_span.u_on_tz % pixmap_ptr->width;
-	}
-	v = (int)span_ptr->start_span.v_on_tz % pixmap_ptr->height;
-
-	// Get the pointer to the starting pixel in the frame buffer.
-	
-	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy + span_ptr->start_sx * 3;
-
-	// Compute the image pointer.
-
-	image_ptr = pixmap_ptr->image_ptr + v * image_width;
-
-	// Compute the span width.
-
-	span_width = span_ptr->end_sx - span_ptr->start_sx;
-
-	// Render the span.
-
-	render_linear_span24(pixmap_ptr->bytes_per_pixel == 2, image_ptr, fb_ptr,
-		palette_ptr, transparent_index, transparency_mask32, image_width,
-		span_width, u);
-}
-
-
-//------------------------------------------------------------------------------
-// Render a popup span into a 32-bit frame buffer.
-//------------------------------------------------------------------------------
-
-static void
-render_popup_span32(span *span_ptr)
-{
-	pixmap *pixmap_ptr;
-	byte *image_ptr, *fb_ptr;
-	pixel *palette_ptr;
-	int transparent_index;
-	pixel transparency_mask32 = 0;
-	int image_width, span_width;
-	fixed u, v;
-
-	// Ignore span if it has zero width.
-
-	if (span_ptr->start_sx == span_ptr->end_sx)
-		return;
-
-	// Get the pointer to the pixmap to render, the display palette for
-	// the desired brightness level, the transparent colour index or mask,
-	// and the image width (in bytes).
-	
-	pixmap_ptr = span_ptr->pixmap_ptr;
-	if (pixmap_ptr->bytes_per_pixel == 2) {
-		palette_ptr = light_table[span_ptr->brightness_index];
-		transparency_mask32 = texture_pixel_format.alpha_comp_mask;
-		image_width = pixmap_ptr->width * 2;
-		u = ((int)span_ptr->start_span.u_on_tz % pixmap_ptr->width) * 2;
-	} else {
-		palette_ptr = pixmap_ptr->display_palette_list + 
-			span_ptr->brightness_index * pixmap_ptr->colours;
-		transparent_index = pixmap_ptr->transparent_index;
-		image_width = pixmap_ptr->width;
-		u = (int)span_ptr->start_span.u_on_tz % pixmap_ptr->width;
-	}
-	v = (int)span_ptr->start_span.v_on_tz % pixmap_ptr->height;
-
-	// Get the pointer to the starting pixel in the frame buffer.
-	
-	fb_ptr = frame_buffer_ptr + frame_buffer_row_pitch * span_ptr->sy + (span_ptr->start_sx << 2);
-
-	// Compute the image pointer.
-
-	image_ptr = pixmap_ptr->image_ptr + v * image_width;
-
-	// Compute the span width.
-
-	span_width = span_ptr->end_sx - span_ptr->start_sx;
-
-	// Render the span.
-
-	render_linear_span32(pixmap_ptr->bytes_per_pixel == 2, image_ptr, fb_ptr,
-		palette_ptr, transparent_index, transparency_mask32, image_width,
-		span_width, u);
-}
-
-//------------------------------------------------------------------------------
-// Render a popup span to the frame buffer.
-//------------------------------------------------------------------------------
-
-void
-render_popup_span(span *span_ptr)
-{
-	switch (frame_buffer_depth) {
-	case 16:
-		render_popup_span16(span_ptr);
-		break;
-	case 24:
-		render_popup_span24(span_ptr);
-		break;
-	case 32:
-		render_popup_span32(span_ptr);
-	}
-}
-
-//------------------------------------------------------------------------------
-// Render a pixel to the frame buffer.
-//------------------------------------------------------------------------------
-
-static void
-render_pixel16(int x, int y, pixel pixel_colour)
-{
-	*(word *)(frame_buffer_ptr + frame_buffer_row_pitch * y + (x << 1)) = pixel_colour;
-}
-
-static void
-render_pixel24(int x, int y, pixel pixel_colour)
+render_pixel24(int x, int y, pixel pixel_colour)
 {
 	word *fb_ptr = (word *)(frame_buffer_ptr + frame_buffer_row_pitch * y + (x * 3));
 	*fb_ptr = (*fb_ptr & 0xFF000000) | (pixel_colour & 0x00FFFFFF);
@@ -7976,15 +6260,11 @@ hardware_set_texture(cache_entry *cache_entry_ptr)
 	ID3D11Texture2D *d3d_texture_ptr;
 	D3D11_MAPPED_SUBRESOURCE d3d_mapped_subresource;
 	byte *surface_ptr;
-	int row_pitch, row_gap;
+	int row_pitch;
 	int image_dimensions;
 	pixmap *pixmap_ptr;
-	byte *image_ptr, *end_image_ptr, *new_image_ptr;
 	pixel *palette_ptr;
 	int transparent_index;
-	pixel transparency_mask32;
-	int image_width, image_height;
-	int column_index;
 
 	// Get the image dimensions and texture object.
 
@@ -8000,189 +6280,26 @@ hardware_set_texture(cache_entry *cache_entry_ptr)
 	}
 	surface_ptr = (byte *)d3d_mapped_subresource.pData;
 	row_pitch = d3d_mapped_subresource.RowPitch;
-	row_gap = row_pitch - image_dimensions * 4;
 
-	// Get the unlit image pointer and it's dimensions, and set a pointer to
-	// the end of the image data.
+	// If the pixmap is an 8-bit image, get the transparent index and palette
+	// pointer.
 
 	pixmap_ptr = cache_entry_ptr->pixmap_ptr;
-	image_ptr = pixmap_ptr->image_ptr;
-	image_width = pixmap_ptr->width * pixmap_ptr->bytes_per_pixel;
-	image_height = pixmap_ptr->height;
-	end_image_ptr = image_ptr + image_width * image_height;
-
-	// If the pixmap is an 8-bit image, put the transparent index and palette 
-	// pointer in static variables so that the assembly code can get to them.
-	// Also put the transparency mask into a static variable.
-
 	if (pixmap_ptr->bytes_per_pixel == 1) {
 		transparent_index = pixmap_ptr->transparent_index;
 		palette_ptr = pixmap_ptr->texture_palette_list;
+	} else {
+		transparent_index = -1;
+		palette_ptr = NULL;
 	}
-	transparency_mask32 = texture_pixel_format.alpha_comp_mask;
-
-	// Get the start address of the lit image.
-
-	new_image_ptr = surface_ptr;
-
-	// If the pixmap is a 32-bit image, simply copy it to the new image buffer.
-
-	if (pixmap_ptr->bytes_per_pixel == 4) {
-		__asm {
-		
-			// EBX: holds pointer to current row of old image.
-			// EDX: holds pointer to current pixel of new image.
-			// EDI: holds the number of rows left to copy.
-
-			mov ebx, image_ptr
-			mov edx, new_image_ptr
-			mov edi, image_dimensions
-
-		next_row:
-
-			// ECX: holds the old image offset.
-			// ESI: holds number of columns left to copy.
-
-			mov ecx, 0
-			mov esi, image_dimensions
-
-		next_column:
-
-			// Get the current 32-bit pixel from the old image, and store it in
-			// the new image.
-
-			mov eax, [ebx + ecx]
-			mov [edx], eax
-
-			// Increment the old image offset, wrapping back to zero if the 
-			// end of the row is reached.
-
-			add ecx, 4
-			cmp ecx, image_width 
-			jl next_pixel
-			mov ecx, 0
-
-		next_pixel:
-
-			// Increment the new image pointer.
-
-			add edx, 4
-
-			// Decrement the column counter, and copy next pixel in row if
-			// there are any left.
-
-			dec esi
-			jnz next_column
-
-			// Increment the old image row pointer, and wrap back to the
-			// first row if the end of the image has been reached.
-
-			add ebx, image_width
-			cmp ebx, end_image_ptr
-			jl skip_wrap
-			mov ebx, image_ptr
-
-		skip_wrap:
-
-			// Skip over the gap in the new image row.
-
-			add edx, row_gap
-
-			// Decrement the row counter, and copy next row if there are any
-			// left.
-
-			dec edi
-			jnz next_row
-		}
-	}
-
-	// If the pixmap is an 8-bit image, convert it to a 32-bit lit image.
-
-	else {
-		__asm {
-		
-			// EBX: holds pointer to current row of old image.
-			// EDX: holds pointer to current pixel of new image.
-			// EDI: holds the number of rows left to copy.
-
-			mov ebx, image_ptr
-			mov edx, new_image_ptr
-			mov edi, image_dimensions
-
-		next_row2:
-
-			// ESI: holds number of columns left to copy.
-
-			mov esi, image_dimensions
-
-			// Clear old image offset.
-
-			mov eax, 0
-			mov column_index, eax
-
-		next_column2:
-
-			// Get the current 8-bit index from the old image, use it to
-			// obtain the 32-bit pixel, and store it in the new image.  If 
-			// the 8-bit index is not the transparent index, mark the pixel as
-			// opaque by setting the transparency mask.
-
-			mov eax, 0
-			mov ecx, column_index
-			mov al, [ebx + ecx]
-			mov ecx, palette_ptr
-			cmp eax, transparent_index
-			jne opaque_pixel2
-			mov eax, [ecx + eax * 4]	
-			jmp store_pixel2
-		opaque_pixel2:
-			mov eax, [ecx + eax * 4]
-			or eax, transparency_mask32
-		store_pixel2:
-			mov [edx], eax
-
-			// Increment the old image offset, wrapping back to zero if the 
-			// end of the row is reached.
-
-			mov eax, column_index
-			inc eax
-			cmp eax, image_width 
-			jl next_pixel2
-			mov eax, 0
-		next_pixel2:
-			mov column_index, eax
-
-			// Increment the new image pointer.
-
-			add edx, 4
-
-			// Decrement the column counter, and copy next pixel in row if
-			// there are any left.
-
-			dec esi
-			jnz next_column2
 
-			// Increment the old image row pointer, and wrap back to the
-			// first row if the end of the image has been reached.
+	// If the pixmap is a 32-bit image, simply copy it to the texture surface,
+	// otherwise convert the 8-bit image to a 32-bit image.
 
-			add ebx, image_width
-			cmp ebx, end_image_ptr
-			jl skip_wrap2
-			mov ebx, image_ptr
-
-		skip_wrap2:
-
-			// Skip over the gap in the new image row.
-
-			add edx, row_gap
-
-			// Decrement the row counter, and copy next row if there are any
-			// left.
-
-			dec edi
-			jnz next_row2
-		}
-	}
+	convert_image(pixmap_ptr->image_ptr, pixmap_ptr->width, pixmap_ptr->height,
+		pixmap_ptr->bytes_per_pixel == 4 ? 4 : 1, palette_ptr, transparent_index,
+		texture_pixel_format.alpha_comp_mask, surface_ptr, image_dimensions, 4,
+		row_pitch);
 
 	// Unlock the texture surface.
 
@@ -8218,13 +6335,13 @@ hardware_render_2D_polygon(pixmap *pixmap_ptr, RGBcolour colour, float brightnes
 	D3D11_MAPPED_SUBRESOURCE d3d_mapped_subresource;
 	hardware_vertex *vertex_buffer_ptr;
 
-	// If the polygon has a pixmap, get the cache entry and enable the texture,
-	// and use a grayscale colour for lighting.
+	// If the polygon has a pixmap with a cache entry, enable the texture, and
+	// use a grayscale colour for lighting.
 	
-	if (pixmap_ptr != NULL) {
+	cache_entry *cache_entry_ptr = pixmap_ptr != NULL ? get_cache_entry(pixmap_ptr, 0) : NULL;
+	if (cache_entry_ptr != NULL) {
 		d3d_device_context_ptr->VSSetShader(d3d_texture_vertex_shader_ptr, NULL, 0);
 		d3d_device_context_ptr->PSSetShader(d3d_texture_pixel_shader_ptr, NULL, 0);
-		cache_entry *cache_entry_ptr = get_cache_entry(pixmap_ptr, 0);
 		hardware_texture *hardware_texture_ptr = (hardware_texture *)cache_entry_ptr->hardware_texture_ptr;
 		d3d_device_context_ptr->PSSetShaderResources(0, 1, &hardware_texture_ptr->d3d_shader_resource_view_ptr);
 		colour.red = brightness;
@@ -8289,14 +6406,14 @@ hardware_render_polygon(tpolygon *tpolygon_ptr)
 	D3D11_MAPPED_SUBRESOURCE d3d_mapped_subresource;
 	hardware_vertex *vertex_buffer_ptr;
 
-	// If the polygon has a pixmap, use the texture shaders with the shader resource view for the pixmap's texture,
-	// otherwise use the colour shaders.
+	// If the polygon has a pixmap with a cache entry, use the texture shaders with the shader resource view for the
+	// pixmap's texture, otherwise use the colour shaders.
 
 	pixmap_ptr = tpolygon_ptr->pixmap_ptr;
-	if (pixmap_ptr != NULL) {
+	cache_entry *cache_entry_ptr = pixmap_ptr != NULL ? get_cache_entry(pixmap_ptr, 0) : NULL;
+	if (cache_entry_ptr != NULL) {
 		d3d_device_context_ptr->VSSetShader(d3d_texture_vertex_shader_ptr, NULL, 0);
 		d3d_device_context_ptr->PSSetShader(d3d_texture_pixel_shader_ptr, NULL, 0);
-		cache_entry *cache_entry_ptr = get_cache_entry(pixmap_ptr, 0);
 		hardware_texture *hardware_texture_ptr = (hardware_texture *)cache_entry_ptr->hardware_texture_ptr;
 		d3d_device_context_ptr->PSSetShaderResources(0, 1, &hardware_texture_ptr->d3d_shader_resource_view_ptr);
 	} else {
@@ -8304,7 +6421,7 @@ hardware_render_polygon(tpolygon *tpolygon_ptr)
 		d3d_device_context_ptr->PSSetShader(d3d_colour_pixel_shader_ptr, NULL, 0);	
 	}
 
-	// Fill the vertex buffer with transformed vertices from the polygon, removing the vertices from the polygon in the process.
+	// Fill the vertex buffer with transformed vertices from the polygon, then empty the polygon's vertex list.
 
 	if (FAILED(d3d_device_context_ptr->Map(d3d_vertex_buffer_ptr, 0, D3D11_MAP_WRITE_DISCARD, 0, &d3d_mapped_subresource))) {
 		diagnose("Failed to map vertex buffer");
@@ -8315,7 +6432,7 @@ hardware_render_polygon(tpolygon *tpolygon_ptr)
 	int vertices = 0;
 	while (tvertex_ptr && vertices < MAX_VERTICES) {
 		add_tvertex_to_buffer(vertex_buffer_ptr, tvertex_ptr, tpolygon_ptr);
-		tvertex_ptr = del_tvertex(tvertex_ptr);
+		tvertex_ptr = tvertex_ptr->next_tvertex_ptr;
 		vertices++;
 	}
 	tpolygon_ptr->tvertex_list = NULL;
@@ -8397,6 +6514,8 @@ hardware_set_skybox(skybox_def *skybox_def_ptr, float skybox_brightness)
 	for (int i = 0; i < 6; i++) {
 		texture *skybox_texture_ptr = skybox_def_ptr->skybox_texture_list[i];
 		cache_entry *cache_entry_ptr = get_cache_entry(&skybox_texture_ptr->pixmap_list[0], 0);
+		if (cache_entry_ptr == NULL)
+			return false;
 		skybox_hardware_texture_list[i] = (hardware_texture *)cache_entry_ptr->hardware_texture_ptr;
 	}
 
@@ -8605,7 +6724,7 @@ draw_pixmap(pixmap *pixmap_ptr, int brightness_index, int x, int y, int width, i
 		break;
 	case 2:
 		for (row = 0; row < clipped_height; row++) {
-			render_linear_span16(pixmap_ptr->bytes_per_pixel == 2, image_ptr, fb_ptr,
+			draw_linear_span(fb_ptr, 16, pixmap_ptr->bytes_per_pixel == 2, image_ptr,
 				palette_ptr, transparent_index, transparency_mask32, image_width,
 				span_width, u);
 			fb_ptr += fb_bytes_per_row;
@@ -8614,7 +6733,7 @@ draw_pixmap(pixmap *pixmap_ptr, int brightness_index, int x, int y, int width, i
 		break;
 	case 3:
 		for (row = 0; row < clipped_height; row++) {
-			render_linear_span24(pixmap_ptr->bytes_per_pixel == 2, image_ptr, fb_ptr,
+			draw_linear_span(fb_ptr, 24, pixmap_ptr->bytes_per_pixel == 2, image_ptr,
 				palette_ptr, transparent_index, transparency_mask32, image_width,
 				span_width, u);
 			fb_ptr += fb_bytes_per_row;
@@ -8623,7 +6742,7 @@ draw_pixmap(pixmap *pixmap_ptr, int brightness_index, int x, int y, int width, i
 		break;
 	case 4:
 		for (row = 0; row < clipped_height; row++) {
-			render_linear_span32(pixmap_ptr->bytes_per_pixel == 2, image_ptr, fb_ptr,
+			draw_linear_span(fb_ptr, 32, pixmap_ptr->bytes_per_pixel == 2, image_ptr,
 				palette_ptr, transparent_index, transparency_mask32, image_width,
 				span_width, u);
 			fb_ptr += fb_bytes_per_row;
@@ -8943,6 +7062,24 @@ get_time_ms(void)
 	return(GetTickCount());
 }
 
+//------------------------------------------------------------------------------
+// Get the real time since the platform API started up, in milliseconds.  This
+// uses the performance counter rather than GetTickCount(), which only advances
+// every 10 to 16 ms, so that short intervals such as a script's time slice can
+// be measured.
+//------------------------------------------------------------------------------
+
+int
+get_real_time_ms(void)
+{
+	LARGE_INTEGER performance_count;
+
+	QueryPerformanceCounter(&performance_count);
+	return((int)((performance_count.QuadPart -
+		performance_start_count.QuadPart) * 1000 /
+		performance_frequency.QuadPart));
+}
+
 //------------------------------------------------------------------------------
 // Load wave data into a wave object.
 //------------------------------------------------------------------------------